@@ -25,6 +25,7 @@
 #include "config.h"
 #include "al.h"
 #include "dsp.h"
+#include "dspSIMD.h"
 
 namespace AL {
 
@@ -88,6 +89,89 @@ class DspSSE86 : public Dsp {
       };
 #endif
 
+//---------------------------------------------------------
+//   DspSIMD
+//    Vectorized routines of the instruction set chosen
+//    at startup, see dspSIMD.h.
+//---------------------------------------------------------
+
+class DspSIMD : public Dsp {
+      const DspKernels* _k;
+
+   public:
+      DspSIMD(const DspKernels* k) : _k(k) {}
+      virtual ~DspSIMD() {}
+
+      virtual float peak(float* buf, unsigned n, float current) {
+            return _k->peak(buf, n, current);
+            }
+      virtual void applyGainToBuffer(float* buf, unsigned n, float gain) {
+            _k->applyGainToBuffer(buf, n, gain);
+            }
+      virtual void mixWithGain(float* dst, float* src, unsigned n, float gain) {
+            _k->mixWithGain(dst, src, n, gain);
+            }
+      virtual void mix(float* dst, float* src, unsigned n) {
+            _k->mix(dst, src, n);
+            }
+      virtual void cpy(float* dst, float* src, unsigned n, bool addDenormal = false) {
+            if (addDenormal)
+                  _k->cpyWithBias(dst, src, n, denormalBias);
+            else
+                  memcpy(dst, src, sizeof(float) * n);
+            }
+      virtual void cpyWithGain(float* dst, const float* src, unsigned n, float gain) {
+            _k->cpyWithGain(dst, src, n, gain);
+            }
+      virtual void panMix(float* dstL, float* dstR, const float* src, unsigned n, float gainL, float gainR) {
+            _k->panMix(dstL, dstR, src, n, gainL, gainR);
+            }
+      virtual void deinterleave(float** dst, const float* src, unsigned channels, unsigned n, bool add) {
+            if (channels == 2)
+                  _k->deinterleave2(dst[0], dst[1], src, n, add);
+            else
+                  Dsp::deinterleave(dst, src, channels, n, add);
+            }
+      virtual void interleave(float* dst, const float* const* src, unsigned channels, unsigned n, float limit) {
+            if (channels == 2)
+                  _k->interleave2(dst, src[0], src[1], n, limit);
+            else
+                  Dsp::interleave(dst, src, channels, n, limit);
+            }
+      virtual float peakRms(const float* buf, unsigned n, float current, float* sumSquares) {
+            return _k->peakRms(buf, n, current, sumSquares);
+            }
+      };
+
+//---------------------------------------------------------
+//   dspKernelsAvailable
+//---------------------------------------------------------
+
+int dspKernelsAvailable(const DspKernels** list, int max)
+      {
+      int n = 0;
+#if defined(__i386__) || defined(__x86_64__)
+      __builtin_cpu_init();
+#ifdef DSP_AVX512
+      if (n < max && __builtin_cpu_supports("avx512f"))
+            list[n++] = dspKernelsAVX512();
+#endif
+#ifdef DSP_AVX2
+      if (n < max && __builtin_cpu_supports("avx2"))
+            list[n++] = dspKernelsAVX2();
+#endif
+#ifdef DSP_SSE2
+      if (n < max && __builtin_cpu_supports("sse2"))
+            list[n++] = dspKernelsSSE2();
+#endif
+#endif
+#ifdef DSP_NEON
+      if (n < max)
+            list[n++] = dspKernelsNEON();
+#endif
+      return n;
+      }
+
 //---------------------------------------------------------
 //   initDsp
 //---------------------------------------------------------
@@ -137,6 +221,14 @@ void initDsp()
             }
       // fall through to not hardware optimized routines
 #endif
+      const DspKernels* k = 0;
+      if (dspKernelsAvailable(&k, 1)) {
+            if(debugMsg)
+              printf("Muse: using %s optimized dsp routines\n", k->name);
+            dsp = new DspSIMD(k);
+            return;
+            }
+
       if(debugMsg)
         printf("Muse: using unoptimized non-SSE dsp routines\n");
       dsp = new Dsp();
@@ -190,4 +282,35 @@ void Dsp::cpy(float* dst, float* src, unsigned n, bool addDenormal)
 #endif
 }
 
+void Dsp::deinterleave(float** dst, const float* src, unsigned channels, unsigned n, bool add)
+{
+  if(add)
+  {
+    for(unsigned i = 0; i < n; ++i)
+      for(unsigned ch = 0; ch < channels; ++ch)
+        dst[ch][i] += *src++;
+  }
+  else
+  {
+    for(unsigned i = 0; i < n; ++i)
+      for(unsigned ch = 0; ch < channels; ++ch)
+        dst[ch][i] = *src++;
+  }
+}
+
+void Dsp::interleave(float* dst, const float* const* src, unsigned channels, unsigned n, float limit)
+{
+  for(unsigned i = 0; i < n; ++i)
+  {
+    for(unsigned ch = 0; ch < channels; ++ch)
+    {
+      const float f = src[ch][i];
+      if(f > 0.0f)
+        *dst++ = f < limit ? f : limit;
+      else
+        *dst++ = f > -limit ? f : -limit;
+    }
+  }
+}
+
 } // namespace AL
@@ -70,6 +70,51 @@ class Dsp {
                   dst[i] += src[i];
             }
       virtual void cpy(float* dst, float* src, unsigned n, bool addDenormal = false);
+      // dst = src * gain
+      virtual void cpyWithGain(float* dst, const float* src, unsigned n, float gain) {
+            for (unsigned i = 0; i < n; ++i)
+                  dst[i] = src[i] * gain;
+            }
+      // Like cpyWithGain, but the gain is multiplied by factor before each sample.
+      // Returns the gain of the last sample.
+      // The ramps are not vectorized: Each gain depends on the one before, in double
+      //  precision, and the result must match the per-sample volume smoothing exactly.
+      double cpyWithRamp(float* dst, const float* src, unsigned n, double gain, double factor) {
+            for (unsigned i = 0; i < n; ++i) {
+                  gain *= factor;
+                  dst[i] = src[i] * gain;
+                  }
+            return gain;
+            }
+      // Like cpyWithRamp, but adds to dst.
+      double mixWithRamp(float* dst, const float* src, unsigned n, double gain, double factor) {
+            for (unsigned i = 0; i < n; ++i) {
+                  gain *= factor;
+                  dst[i] += src[i] * gain;
+                  }
+            return gain;
+            }
+      // Mono to stereo: dstL = src * gainL, dstR = src * gainR
+      virtual void panMix(float* dstL, float* dstR, const float* src, unsigned n, float gainL, float gainR) {
+            for (unsigned i = 0; i < n; ++i) {
+                  dstL[i] = src[i] * gainL;
+                  dstR[i] = src[i] * gainR;
+                  }
+            }
+      // Splits n interleaved frames of src into the channel buffers, replacing or adding to them.
+      virtual void deinterleave(float** dst, const float* src, unsigned channels, unsigned n, bool add);
+      // Interleaves n frames of the channel buffers into dst, clipping the samples to +-limit.
+      virtual void interleave(float* dst, const float* const* src, unsigned channels, unsigned n, float limit);
+      // Like peak, and adds the sum of the squares of the samples to sumSquares, for rms metering.
+      virtual float peakRms(const float* buf, unsigned n, float current, float* sumSquares) {
+            float sq = 0.0f;
+            for (unsigned i = 0; i < n; ++i) {
+                  current = f_max(current, fabsf(buf[i]));
+                  sq += buf[i] * buf[i];
+                  }
+            *sumSquares += sq;
+            return current;
+            }
 /*      
       {
 // Changed by T356. Not defined. Where are these???
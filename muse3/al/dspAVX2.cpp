@@ -0,0 +1,84 @@
+//=============================================================================
+//  AL
+//  Audio Utility Library
+//
+//  dspAVX2.cpp
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//=============================================================================
+
+// Compiled with -mavx2. Do not include anything else here, see dspSIMD.h.
+
+#include <immintrin.h>
+#include "dspKernels.h"
+
+namespace AL {
+
+namespace {
+
+struct VecAVX2 {
+      typedef __m256 Reg;
+      enum { Width = 8 };
+
+      static inline Reg load(const float* p)       { return _mm256_loadu_ps(p); }
+      static inline void store(float* p, Reg v)    { _mm256_storeu_ps(p, v); }
+      static inline Reg set1(float f)              { return _mm256_set1_ps(f); }
+      static inline Reg add(Reg a, Reg b)          { return _mm256_add_ps(a, b); }
+      static inline Reg mul(Reg a, Reg b)          { return _mm256_mul_ps(a, b); }
+      static inline Reg min(Reg a, Reg b)          { return _mm256_min_ps(a, b); }
+      static inline Reg max(Reg a, Reg b)          { return _mm256_max_ps(a, b); }
+      static inline Reg abs(Reg v)                 { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v); }
+
+      static inline float hmax(Reg v) {
+            __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+            m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+            return _mm_cvtss_f32(m);
+            }
+
+      static inline float hsum(Reg v) {
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+            return _mm_cvtss_f32(s);
+            }
+
+      // L0 R0 .. L7 R7 -> L0 .. L7, R0 .. R7
+      static inline void deinterleave2(const float* p, Reg& l, Reg& r) {
+            const Reg a = _mm256_loadu_ps(p);
+            const Reg b = _mm256_loadu_ps(p + 8);
+            // Per 128 bit lane: L0 L1 L4 L5 | L2 L3 L6 L7, then put the 64 bit pairs in order.
+            l = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0x88)), 0xd8));
+            r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0xdd)), 0xd8));
+            }
+
+      // L0 .. L7, R0 .. R7 -> L0 R0 .. L7 R7
+      static inline void interleave2(float* p, Reg l, Reg r) {
+            // Per 128 bit lane: L0 R0 L1 R1 | L4 R4 L5 R5, and L2 R2 L3 R3 | L6 R6 L7 R7.
+            const Reg lo = _mm256_unpacklo_ps(l, r);
+            const Reg hi = _mm256_unpackhi_ps(l, r);
+            _mm256_storeu_ps(p,     _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+            }
+      };
+
+} // anonymous namespace
+
+const DspKernels* dspKernelsAVX2()
+      {
+      return kernelTable<VecAVX2>("AVX2");
+      }
+
+} // namespace AL
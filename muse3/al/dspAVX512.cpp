@@ -0,0 +1,91 @@
+//=============================================================================
+//  AL
+//  Audio Utility Library
+//
+//  dspAVX512.cpp
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//=============================================================================
+
+// Compiled with -mavx512f. Do not include anything else here, see dspSIMD.h.
+
+#include <immintrin.h>
+#include "dspKernels.h"
+
+namespace AL {
+
+namespace {
+
+struct VecAVX512 {
+      typedef __m512 Reg;
+      enum { Width = 16 };
+
+      static inline Reg load(const float* p)       { return _mm512_loadu_ps(p); }
+      static inline void store(float* p, Reg v)    { _mm512_storeu_ps(p, v); }
+      static inline Reg set1(float f)              { return _mm512_set1_ps(f); }
+      static inline Reg add(Reg a, Reg b)          { return _mm512_add_ps(a, b); }
+      static inline Reg mul(Reg a, Reg b)          { return _mm512_mul_ps(a, b); }
+      static inline Reg min(Reg a, Reg b)          { return _mm512_min_ps(a, b); }
+      static inline Reg max(Reg a, Reg b)          { return _mm512_max_ps(a, b); }
+      // Clear the sign bits. Integer and/andnot on floats need AVX512DQ, so go through the integer registers.
+      static inline Reg abs(Reg v) {
+            return _mm512_castsi512_ps(_mm512_and_epi32(_mm512_castps_si512(v), _mm512_set1_epi32(0x7fffffff)));
+            }
+      static inline float hmax(Reg v) {
+            float a[Width];
+            _mm512_storeu_ps(a, v);
+            float m = a[0];
+            for (int i = 1; i < Width; ++i)
+                  if (a[i] > m)
+                        m = a[i];
+            return m;
+            }
+
+      static inline float hsum(Reg v) {
+            float a[Width];
+            _mm512_storeu_ps(a, v);
+            float s = a[0];
+            for (int i = 1; i < Width; ++i)
+                  s += a[i];
+            return s;
+            }
+
+      // L0 R0 .. L15 R15 -> L0 .. L15, R0 .. R15
+      static inline void deinterleave2(const float* p, Reg& l, Reg& r) {
+            const Reg a = _mm512_loadu_ps(p);
+            const Reg b = _mm512_loadu_ps(p + 16);
+            const __m512i even = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
+            const __m512i odd  = _mm512_set_epi32(31, 29, 27, 25, 23, 21, 19, 17, 15, 13, 11, 9, 7, 5, 3, 1);
+            l = _mm512_permutex2var_ps(a, even, b);
+            r = _mm512_permutex2var_ps(a, odd, b);
+            }
+
+      // L0 .. L15, R0 .. R15 -> L0 R0 .. L15 R15
+      static inline void interleave2(float* p, Reg l, Reg r) {
+            const __m512i first  = _mm512_set_epi32(23, 7, 22, 6, 21, 5, 20, 4, 19, 3, 18, 2, 17, 1, 16, 0);
+            const __m512i second = _mm512_set_epi32(31, 15, 30, 14, 29, 13, 28, 12, 27, 11, 26, 10, 25, 9, 24, 8);
+            _mm512_storeu_ps(p,      _mm512_permutex2var_ps(l, first, r));
+            _mm512_storeu_ps(p + 16, _mm512_permutex2var_ps(l, second, r));
+            }
+      };
+
+} // anonymous namespace
+
+const DspKernels* dspKernelsAVX512()
+      {
+      return kernelTable<VecAVX512>("AVX-512");
+      }
+
+} // namespace AL
@@ -0,0 +1,222 @@
+//=============================================================================
+//  AL
+//  Audio Utility Library
+//
+//  dspKernels.h
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//=============================================================================
+
+//---------------------------------------------------------
+//   Generic vectorized dsp kernels
+//    Only to be included by the instruction set specific
+//     source files (dspAVX2.cpp etc.), after defining the
+//     vector traits class V with:
+//      typedef ... Reg;  enum { Width = ... };
+//      load, store, set1, add, mul, min, max, abs, hmax,
+//      hsum, deinterleave2, interleave2
+//     min and max must return the second operand if the
+//      first one is a NaN, like the SSE instructions do.
+//    Everything here is in an anonymous namespace so that
+//     each of those files gets its own private copy.
+//    Buffers need not be aligned.
+//---------------------------------------------------------
+
+#ifndef __DSP_KERNELS_H__
+#define __DSP_KERNELS_H__
+
+#include "dspSIMD.h"
+
+namespace AL {
+namespace {
+
+template <class V> float kPeak(const float* buf, unsigned n, float current)
+      {
+      typename V::Reg m = V::set1(current);
+      unsigned i = 0;
+      for (; i + V::Width <= n; i += V::Width)
+            m = V::max(m, V::abs(V::load(buf + i)));
+      current = V::hmax(m);
+      for (; i < n; ++i) {
+            const float f = buf[i] < 0.0f ? -buf[i] : buf[i];
+            if (f > current)
+                  current = f;
+            }
+      return current;
+      }
+
+template <class V> void kApplyGainToBuffer(float* buf, unsigned n, float gain)
+      {
+      const typename V::Reg g = V::set1(gain);
+      unsigned i = 0;
+      for (; i + V::Width <= n; i += V::Width)
+            V::store(buf + i, V::mul(V::load(buf + i), g));
+      for (; i < n; ++i)
+            buf[i] *= gain;
+      }
+
+template <class V> void kMixWithGain(float* dst, const float* src, unsigned n, float gain)
+      {
+      const typename V::Reg g = V::set1(gain);
+      unsigned i = 0;
+      for (; i + V::Width <= n; i += V::Width)
+            V::store(dst + i, V::add(V::load(dst + i), V::mul(V::load(src + i), g)));
+      for (; i < n; ++i)
+            dst[i] += src[i] * gain;
+      }
+
+template <class V> void kMix(float* dst, const float* src, unsigned n)
+      {
+      unsigned i = 0;
+      for (; i + V::Width <= n; i += V::Width)
+            V::store(dst + i, V::add(V::load(dst + i), V::load(src + i)));
+      for (; i < n; ++i)
+            dst[i] += src[i];
+      }
+
+template <class V> void kCpyWithBias(float* dst, const float* src, unsigned n, float bias)
+      {
+      const typename V::Reg b = V::set1(bias);
+      unsigned i = 0;
+      for (; i + V::Width <= n; i += V::Width)
+            V::store(dst + i, V::add(V::load(src + i), b));
+      for (; i < n; ++i)
+            dst[i] = src[i] + bias;
+      }
+
+template <class V> void kCpyWithGain(float* dst, const float* src, unsigned n, float gain)
+      {
+      const typename V::Reg g = V::set1(gain);
+      unsigned i = 0;
+      for (; i + V::Width <= n; i += V::Width)
+            V::store(dst + i, V::mul(V::load(src + i), g));
+      for (; i < n; ++i)
+            dst[i] = src[i] * gain;
+      }
+
+template <class V> void kPanMix(float* dstL, float* dstR, const float* src, unsigned n, float gainL, float gainR)
+      {
+      const typename V::Reg gl = V::set1(gainL);
+      const typename V::Reg gr = V::set1(gainR);
+      unsigned i = 0;
+      for (; i + V::Width <= n; i += V::Width) {
+            const typename V::Reg s = V::load(src + i);
+            V::store(dstL + i, V::mul(s, gl));
+            V::store(dstR + i, V::mul(s, gr));
+            }
+      for (; i < n; ++i) {
+            dstL[i] = src[i] * gainL;
+            dstR[i] = src[i] * gainR;
+            }
+      }
+
+template <class V> void kDeinterleave2(float* dstL, float* dstR, const float* src, unsigned n, bool add)
+      {
+      unsigned i = 0;
+      typename V::Reg l, r;
+      if (add) {
+            for (; i + V::Width <= n; i += V::Width) {
+                  V::deinterleave2(src + 2 * i, l, r);
+                  V::store(dstL + i, V::add(V::load(dstL + i), l));
+                  V::store(dstR + i, V::add(V::load(dstR + i), r));
+                  }
+            for (; i < n; ++i) {
+                  dstL[i] += src[2 * i];
+                  dstR[i] += src[2 * i + 1];
+                  }
+            }
+      else {
+            for (; i + V::Width <= n; i += V::Width) {
+                  V::deinterleave2(src + 2 * i, l, r);
+                  V::store(dstL + i, l);
+                  V::store(dstR + i, r);
+                  }
+            for (; i < n; ++i) {
+                  dstL[i] = src[2 * i];
+                  dstR[i] = src[2 * i + 1];
+                  }
+            }
+      }
+
+// The peak as kPeak, plus the sum of the squares of the samples added to sumSquares.
+// The sum is done in a different order than Dsp::peakRms(), so it may differ in the last bits.
+template <class V> float kPeakRms(const float* buf, unsigned n, float current, float* sumSquares)
+      {
+      typename V::Reg m = V::set1(current);
+      typename V::Reg sq = V::set1(0.0f);
+      unsigned i = 0;
+      for (; i + V::Width <= n; i += V::Width) {
+            const typename V::Reg v = V::load(buf + i);
+            m = V::max(m, V::abs(v));
+            sq = V::add(sq, V::mul(v, v));
+            }
+      current = V::hmax(m);
+      float s = V::hsum(sq);
+      for (; i < n; ++i) {
+            const float f = buf[i] < 0.0f ? -buf[i] : buf[i];
+            if (f > current)
+                  current = f;
+            s += buf[i] * buf[i];
+            }
+      *sumSquares += s;
+      return current;
+      }
+
+// Same clipping as Dsp::interleave(), including a NaN becoming -limit.
+static inline float kClip(float f, float limit)
+      {
+      if (f > 0.0f)
+            return f < limit ? f : limit;
+      return f > -limit ? f : -limit;
+      }
+
+template <class V> void kInterleave2(float* dst, const float* srcL, const float* srcR, unsigned n, float limit)
+      {
+      const typename V::Reg lo = V::set1(-limit);
+      const typename V::Reg hi = V::set1(limit);
+      unsigned i = 0;
+      for (; i + V::Width <= n; i += V::Width) {
+            const typename V::Reg l = V::min(V::max(V::load(srcL + i), lo), hi);
+            const typename V::Reg r = V::min(V::max(V::load(srcR + i), lo), hi);
+            V::interleave2(dst + 2 * i, l, r);
+            }
+      for (; i < n; ++i) {
+            dst[2 * i]     = kClip(srcL[i], limit);
+            dst[2 * i + 1] = kClip(srcR[i], limit);
+            }
+      }
+
+template <class V> const DspKernels* kernelTable(const char* name)
+      {
+      static const DspKernels table = {
+            name,
+            kPeak<V>,
+            kApplyGainToBuffer<V>,
+            kMixWithGain<V>,
+            kMix<V>,
+            kCpyWithBias<V>,
+            kCpyWithGain<V>,
+            kPanMix<V>,
+            kDeinterleave2<V>,
+            kPeakRms<V>,
+            kInterleave2<V>
+            };
+      return &table;
+      }
+
+} // anonymous namespace
+} // namespace AL
+
+#endif
@@ -0,0 +1,69 @@
+//=============================================================================
+//  AL
+//  Audio Utility Library
+//
+//  dspNEON.cpp
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//=============================================================================
+
+// 64 bit ARM only, where NEON is always available.
+// Do not include anything else here, see dspSIMD.h.
+
+#include <arm_neon.h>
+#include "dspKernels.h"
+
+namespace AL {
+
+namespace {
+
+struct VecNEON {
+      typedef float32x4_t Reg;
+      enum { Width = 4 };
+
+      static inline Reg load(const float* p)       { return vld1q_f32(p); }
+      static inline void store(float* p, Reg v)    { vst1q_f32(p, v); }
+      static inline Reg set1(float f)              { return vdupq_n_f32(f); }
+      static inline Reg add(Reg a, Reg b)          { return vaddq_f32(a, b); }
+      static inline Reg mul(Reg a, Reg b)          { return vmulq_f32(a, b); }
+      // The NaN variants return the number, like the SSE instructions do for a NaN first operand.
+      static inline Reg min(Reg a, Reg b)          { return vminnmq_f32(a, b); }
+      static inline Reg max(Reg a, Reg b)          { return vmaxnmq_f32(a, b); }
+      static inline Reg abs(Reg v)                 { return vabsq_f32(v); }
+      static inline float hmax(Reg v)              { return vmaxvq_f32(v); }
+      static inline float hsum(Reg v)              { return vaddvq_f32(v); }
+
+      static inline void deinterleave2(const float* p, Reg& l, Reg& r) {
+            const float32x4x2_t v = vld2q_f32(p);
+            l = v.val[0];
+            r = v.val[1];
+            }
+
+      static inline void interleave2(float* p, Reg l, Reg r) {
+            float32x4x2_t v;
+            v.val[0] = l;
+            v.val[1] = r;
+            vst2q_f32(p, v);
+            }
+      };
+
+} // anonymous namespace
+
+const DspKernels* dspKernelsNEON()
+      {
+      return kernelTable<VecNEON>("NEON");
+      }
+
+} // namespace AL
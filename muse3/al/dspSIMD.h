@@ -0,0 +1,68 @@
+//=============================================================================
+//  AL
+//  Audio Utility Library
+//
+//  dspSIMD.h
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//=============================================================================
+
+#ifndef __DSP_SIMD_H__
+#define __DSP_SIMD_H__
+
+namespace AL {
+
+//---------------------------------------------------------
+//   DspKernels
+//    Table of vectorized dsp routines of one instruction
+//     set, see the Dsp class for what they do.
+//
+//    Each table lives in its own source file compiled with
+//     the flags for its instruction set. Those files must not
+//     include any other headers with inline functions (Qt,
+//     dsp.h etc.), or the linker might pick the vectorized
+//     copy of such a function for everyone, crashing on cpus
+//     without that instruction set. That is why the Dsp class
+//     only calls them through this plain table.
+//---------------------------------------------------------
+
+struct DspKernels {
+      const char* name;
+      float (*peak)(const float* buf, unsigned n, float current);
+      void (*applyGainToBuffer)(float* buf, unsigned n, float gain);
+      void (*mixWithGain)(float* dst, const float* src, unsigned n, float gain);
+      void (*mix)(float* dst, const float* src, unsigned n);
+      void (*cpyWithBias)(float* dst, const float* src, unsigned n, float bias);
+      void (*cpyWithGain)(float* dst, const float* src, unsigned n, float gain);
+      void (*panMix)(float* dstL, float* dstR, const float* src, unsigned n, float gainL, float gainR);
+      void (*deinterleave2)(float* dstL, float* dstR, const float* src, unsigned n, bool add);
+      float (*peakRms)(const float* buf, unsigned n, float current, float* sumSquares);
+      void (*interleave2)(float* dst, const float* srcL, const float* srcR, unsigned n, float limit);
+      };
+
+// Only built if the compiler supports the instruction set (DSP_AVX2 etc. defined).
+// Whether the cpu supports it must be checked before use.
+extern const DspKernels* dspKernelsSSE2();
+extern const DspKernels* dspKernelsAVX2();
+extern const DspKernels* dspKernelsAVX512();
+extern const DspKernels* dspKernelsNEON();
+
+// Fills list with the tables this build has and the cpu supports, best first.
+// Returns how many. Used by initDsp(), and by muse_dsp_bench to compare them all.
+extern int dspKernelsAvailable(const DspKernels** list, int max);
+
+} // namespace AL
+
+#endif
@@ -0,0 +1,77 @@
+//=============================================================================
+//  AL
+//  Audio Utility Library
+//
+//  dspSSE2.cpp
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//=============================================================================
+
+// Compiled with -msse2, which x86_64 always has. Do not include anything else here, see dspSIMD.h.
+
+#include <emmintrin.h>
+#include "dspKernels.h"
+
+namespace AL {
+
+namespace {
+
+struct VecSSE2 {
+      typedef __m128 Reg;
+      enum { Width = 4 };
+
+      static inline Reg load(const float* p)       { return _mm_loadu_ps(p); }
+      static inline void store(float* p, Reg v)    { _mm_storeu_ps(p, v); }
+      static inline Reg set1(float f)              { return _mm_set1_ps(f); }
+      static inline Reg add(Reg a, Reg b)          { return _mm_add_ps(a, b); }
+      static inline Reg mul(Reg a, Reg b)          { return _mm_mul_ps(a, b); }
+      static inline Reg min(Reg a, Reg b)          { return _mm_min_ps(a, b); }
+      static inline Reg max(Reg a, Reg b)          { return _mm_max_ps(a, b); }
+      static inline Reg abs(Reg v)                 { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+
+      static inline float hmax(Reg v) {
+            v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+            v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+            return _mm_cvtss_f32(v);
+            }
+      static inline float hsum(Reg v) {
+            v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+            return _mm_cvtss_f32(v);
+            }
+
+      // L0 R0 .. L3 R3 -> L0 .. L3, R0 .. R3
+      static inline void deinterleave2(const float* p, Reg& l, Reg& r) {
+            const Reg a = _mm_loadu_ps(p);
+            const Reg b = _mm_loadu_ps(p + 4);
+            l = _mm_shuffle_ps(a, b, 0x88);
+            r = _mm_shuffle_ps(a, b, 0xdd);
+            }
+
+      // L0 .. L3, R0 .. R3 -> L0 R0 .. L3 R3
+      static inline void interleave2(float* p, Reg l, Reg r) {
+            _mm_storeu_ps(p,     _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(p + 4, _mm_unpackhi_ps(l, r));
+            }
+      };
+
+} // anonymous namespace
+
+const DspKernels* dspKernelsSSE2()
+      {
+      return kernelTable<VecSSE2>("SSE2");
+      }
+
+} // namespace AL
@@ -258,6 +258,10 @@ bool readPluginScanInfo(MusECore::Xml& xml, PluginScanInfoStruct* info, bool rea
                   case MusECore::Xml::TagStart:
                         if (tag == "uri")
                               info->_uri = PLUGIN_SET_QSTRING(xml.parse1());
+                        else if (tag == "fileTime")
+                              info->_fileTime = xml.parse1().toLongLong();
+                        else if (tag == "fileSize")
+                              info->_fileSize = xml.parse1().toLongLong();
                         else if (tag == "type")
                               info->_type = PluginScanInfoStruct::PluginType(xml.parseInt());
                         else if (tag == "class")
@@ -27,6 +27,10 @@
 #include <QFileInfo>
 #include <QFileInfoList>
 #include <QProcess>
+#include <QBuffer>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QThread>
 #include <QByteArray>
 #include <QByteArrayList>
 #include <QStringList>
@@ -36,6 +40,7 @@
 
 // For sorting port enum values.
 #include <map>
+#include <vector>
   
 #include <cstdio>
 #include <cstring>
@@ -119,6 +124,8 @@ static void setPluginScanFileInfo(const char* filename, PluginScanInfoStruct* in
   info->_completeSuffix   = PLUGIN_SET_QSTRING(fi.completeSuffix());
   info->_absolutePath     = PLUGIN_SET_QSTRING(fi.absolutePath());
   info->_path             = PLUGIN_SET_QSTRING(fi.path());
+  info->_fileTime         = fi.lastModified().toMSecsSinceEpoch();
+  info->_fileSize         = fi.size();
 }
 
 bool scanLadspaPorts(
@@ -1308,6 +1315,11 @@ void writePluginScanInfo(int level, MusECore::Xml& xml, const PluginScanInfoStru
       if(!PLUGIN_STRING_EMPTY(info._uri))
         xml.strTag(level, "uri", PLUGIN_GET_CSTRING(info._uri));
 
+      if(info._fileTime != 0)
+        xml.strTag(level, "fileTime", QString::number(info._fileTime));
+      if(info._fileSize != 0)
+        xml.strTag(level, "fileSize", QString::number(info._fileSize));
+
       xml.intTag(level, "type", info._type);
       xml.intTag(level, "class", info._class);
       if(info._uniqueID != 0)
@@ -1495,138 +1507,451 @@ void writePluginScanInfo(int level, MusECore::Xml& xml, const PluginScanInfoStru
       }
 
 //---------------------------------------------------------
-//   pluginScan
-//   If debugStdErr is true, any stderr content received
-//    from the scan program will be printed.
-//   Returns true on success
+//   PluginScanProcess
+//   A long-lived muse_plugin_scan process running in server
+//    mode, which scans one file after another sent over its
+//    stdin, and replies with the result code on its stdout.
+//   It is restarted at the next request if it crashed or
+//    hung on a file.
 //---------------------------------------------------------
 
-static bool pluginScan(
-  const QString& filename,
-  PluginScanInfoStruct::PluginType_t types,
-  PluginScanList* list,
-  bool scanPorts,
-  bool debugStdErr)
+class PluginScanProcess
 {
-  const QByteArray filename_ba = filename.toLocal8Bit();
-  QTemporaryFile tmpfile;
-  // Must open the temp file to get its name.
-  if(!tmpfile.open())
+    QProcess _process;
+    QTemporaryFile _tmpfile;
+    QByteArray _tmpfilename;
+    QByteArray _filename;
+    QByteArray _reply;
+    QElapsedTimer _timer;
+    bool _debugStdErr;
+    // Index of the file being scanned, or -1 if idle.
+    int _fileIdx;
+    // Whether the last file failed to scan, as opposed to having no plugins.
+    bool _failed;
+
+    bool start();
+    void kill();
+    void readStdErr();
+
+  public:
+    // Maximum time allowed for scanning one file, in milliseconds.
+    enum { ScanTimeout = 4000 };
+
+    PluginScanProcess(bool debugStdErr) : _debugStdErr(debugStdErr), _fileIdx(-1), _failed(false) { }
+    ~PluginScanProcess();
+
+    bool isIdle() const { return _fileIdx < 0; }
+    int fileIndex() const { return _fileIdx; }
+    // Sends a file to the scanner, (re)starting the scanner if required.
+    // Returns true on success.
+    bool request(int fileIdx, const QString& filename,
+                 PluginScanInfoStruct::PluginType_t types, bool scanPorts);
+    // Waits up to msecs for the current file to be finished.
+    // Returns true if the file is finished, successfully or not.
+    // On success, result receives the xml text of the scan, otherwise it is left empty.
+    bool poll(int msecs, QByteArray* result);
+    // Whether the last finished file failed to scan. Such files are not remembered as empty.
+    bool failed() const { return _failed; }
+};
+
+PluginScanProcess::~PluginScanProcess()
+{
+  if(_process.state() == QProcess::NotRunning)
+    return;
+  // The scanner quits when it sees the end of its input.
+  _process.closeWriteChannel();
+  if(!_process.waitForFinished(1000))
   {
-    std::fprintf(stderr, "\npluginScan FAILED: Could not create temporary output file for input file: %s\n\n", filename_ba.constData());
-    return false;
+    _process.kill();
+    _process.waitForFinished(1000);
   }
-  // Get the unique temp file name.
-  const QString tmpfilename = tmpfile.fileName();
-  const QByteArray tmpfilename_ba = tmpfilename.toLocal8Bit();
-  // Close the temp file. It exists until tmpfile goes out of scope.
-  tmpfile.close();
-  
-  if(debugStdErr)
-    std::fprintf(stderr, "\nChecking file: <%s>\n", filename_ba.constData());
+  readStdErr();
+}
 
-  QProcess process;
+//---------------------------------------------------------
+//   start
+//---------------------------------------------------------
+
+bool PluginScanProcess::start()
+{
+  if(_process.state() != QProcess::NotRunning)
+    return true;
 
   const QString prog = QString(BINDIR) + QString("/muse_plugin_scan");
+  _process.start(prog, QStringList() << QString("-s"));
+  if(!_process.waitForStarted(ScanTimeout))
+  {
+    std::fprintf(stderr, "\npluginScan FAILED: Could not start scan program: %s\n\n", prog.toLocal8Bit().constData());
+    return false;
+  }
+  return true;
+}
 
-  QStringList args;
-  args << QString("-t") + QString::number(types) << QString("-f") + filename << QString("-o") + tmpfilename;
-  if(scanPorts)
-    args << QString("-p");
+//---------------------------------------------------------
+//   kill
+//---------------------------------------------------------
 
-  process.start(prog, args);
+void PluginScanProcess::kill()
+{
+  if(_process.state() == QProcess::NotRunning)
+    return;
+  _process.kill();
+  _process.waitForFinished(1000);
+  readStdErr();
+}
 
-//   if(!process.waitForStarted(4000))
-//   {
-//     std::fprintf(stderr, "pluginScan: waitForStarted failed\n");
-//     return false;
-//   }
+//---------------------------------------------------------
+//   readStdErr
+//   Must be read regularly even if not printed, so the
+//    buffer does not keep growing.
+//---------------------------------------------------------
 
-//   if(!process.waitForReadyRead(4000))
-//   {
-//     std::fprintf(stderr, "pluginScan: waitForReadyRead failed\n");
-//     return false;
-//   }
+void PluginScanProcess::readStdErr()
+{
+  const QByteArray err_array = _process.readAllStandardError();
+  if(_debugStdErr && !err_array.isEmpty() && err_array.at(0) != 0)
+    std::fprintf(stderr, "\npluginScan: Standard error output from scan:\n%s\n", err_array.constData());
+}
+
+//---------------------------------------------------------
+//   request
+//---------------------------------------------------------
+
+bool PluginScanProcess::request(
+  int fileIdx, const QString& filename, PluginScanInfoStruct::PluginType_t types, bool scanPorts)
+{
+  _filename = filename.toLocal8Bit();
+
+  if(_tmpfilename.isEmpty())
+  {
+    // Must open the temp file to get its name.
+    if(!_tmpfile.open())
+    {
+      std::fprintf(stderr, "\npluginScan FAILED: Could not create temporary output file for input file: %s\n\n", _filename.constData());
+      return false;
+    }
+    // Get the unique temp file name.
+    _tmpfilename = _tmpfile.fileName().toLocal8Bit();
+    // Close the temp file. It exists until this object is destroyed. The scanner overwrites it for each file.
+    _tmpfile.close();
+  }
 
-  if(!process.waitForFinished(4000))
+  // One request per line: types, ports flag, output file, and the file to scan last since it may contain tabs.
+  QByteArray line = QByteArray::number(int(types));
+  line += '\t';
+  line += scanPorts ? '1' : '0';
+  line += '\t';
+  line += _tmpfilename;
+  line += '\t';
+  line += _filename;
+  line += '\n';
+
+  // A scanner which died between files may not be noticed until it is written to.
+  // Restart it once, rather than failing this and every following file.
+  bool sent = false;
+  for(int attempt = 0; attempt < 2 && !sent; ++attempt)
+  {
+    if(attempt > 0)
+      kill();
+    if(!start())
+      continue;
+    sent = _process.write(line) == line.size() && _process.waitForBytesWritten(ScanTimeout);
+  }
+  if(!sent)
   {
-    std::fprintf(stderr, "\npluginScan FAILED: waitForFinished: file: %s\n\n", filename_ba.constData());
+    std::fprintf(stderr, "\npluginScan FAILED: Could not send file to scan program: %s\n\n", _filename.constData());
+    kill();
     return false;
   }
 
-  if(debugStdErr)
+  _reply.clear();
+  _fileIdx = fileIdx;
+  _timer.start();
+  return true;
+}
+
+//---------------------------------------------------------
+//   poll
+//---------------------------------------------------------
+
+bool PluginScanProcess::poll(int msecs, QByteArray* result)
+{
+  if(_fileIdx < 0)
+    return false;
+
+  if(_process.state() == QProcess::Running && !_process.canReadLine())
+    _process.waitForReadyRead(msecs);
+  _reply += _process.readAllStandardOutput();
+  readStdErr();
+
+  const int nl = _reply.indexOf('\n');
+  if(nl < 0)
   {
-    QByteArray out_array = process.readAllStandardOutput();
-    if(!out_array.isEmpty() && out_array.at(0) != 0)
+    if(_process.state() != QProcess::Running)
     {
-      // Terminate just to be sure.
-      out_array.append(char(0));
-      std::fprintf(stderr, "\npluginScan: Standard output from scan:\n%s\n", out_array.constData());
+      std::fprintf(stderr, "\npluginScan FAILED: Scan not exited normally: file: %s\n\n", _filename.constData());
+      _process.waitForFinished(1000);
+      _fileIdx = -1;
+      _failed = true;
+      return true;
     }
-    QByteArray err_array = process.readAllStandardError();
-    if(!err_array.isEmpty() && err_array.at(0) != 0)
+    if(_timer.elapsed() > ScanTimeout)
     {
-      // Terminate just to be sure.
-      err_array.append(char(0));
-      std::fprintf(stderr, "\npluginScan: Standard error output from scan:\n%s\n", err_array.constData());
+      std::fprintf(stderr, "\npluginScan FAILED: Scan timed out: file: %s\n\n", _filename.constData());
+      kill();
+      _fileIdx = -1;
+      _failed = true;
+      return true;
     }
-  }
-
-  if(process.exitStatus() != QProcess::NormalExit)
-  {
-    std::fprintf(stderr, "\npluginScan FAILED: Scan not exited normally: file: %s\n\n", filename_ba.constData());
     return false;
   }
 
-  if(process.exitCode() != 0)
+  _fileIdx = -1;
+  _failed = true;
+
+  // -1 = error, 0 = OK, 1 = unknown library.
+  const int res = _reply.left(nl).trimmed().toInt();
+  if(res == 1)
   {
-    std::fprintf(stderr, "\npluginScan FAILED: Scan exit code not 0: file: %s\n\n", filename_ba.constData());
-    return false;
+    // Not a plugin library at all. Nothing to scan again until it changes.
+    _failed = false;
+    return true;
   }
-  
-  // Open the temp file again...
-  QFile infile(tmpfilename);
-  if(!infile.exists())
+  if(res != 0)
   {
-    std::fprintf(stderr, "\npluginScan FAILED: Temporary file does not exist: %s\n\n", tmpfilename_ba.constData());
-    return false;
+    std::fprintf(stderr, "\npluginScan FAILED: Scan result not 0: file: %s\n\n", _filename.constData());
+    return true;
   }
+
+  QFile infile(QString::fromLocal8Bit(_tmpfilename));
   if(!infile.open(QIODevice::ReadOnly /*| QIODevice::Text*/))
   {
     std::fprintf(stderr, "\npluginScan FAILED: Could not re-open temporary output file: %s\n\n",
-                 tmpfilename_ba.constData());
+                 _tmpfilename.constData());
+    return true;
+  }
+  *result = infile.readAll();
+  infile.close();
+  _failed = false;
+  return true;
+}
+
+//---------------------------------------------------------
+//   PluginScanCache::addPlugins
+//---------------------------------------------------------
+
+void PluginScanCache::addPlugins(const PluginScanList& list)
+{
+  for(ciPluginScanList ips = list.begin(); ips != list.end(); ++ips)
+    plugins[PLUGIN_GET_QSTRING((*ips)->info().filePath())].push_back(*ips);
+}
+
+//---------------------------------------------------------
+//   findCachedScan
+//   Looks in the cache for the plugins of the given file,
+//    if the file has not changed since it was cached.
+//   Returns true if the file need not be scanned, which
+//    includes files known to contain no plugins.
+//---------------------------------------------------------
+
+static bool findCachedScan(const QString& filename, const PluginScanCache& cache, PluginScanList* found)
+{
+  const QFileInfo fi(filename);
+  const long long file_time = fi.lastModified().toMSecsSinceEpoch();
+  const long long file_size = fi.size();
+  const QString file_path = fi.filePath();
+
+  QHash<QString, PluginScanCache::FileStamp>::const_iterator ief = cache.emptyFiles.constFind(file_path);
+  if(ief != cache.emptyFiles.constEnd())
+    return ief->time == file_time && ief->size == file_size;
+
+  QHash<QString, PluginScanList>::const_iterator ipl = cache.plugins.constFind(file_path);
+  if(ipl == cache.plugins.constEnd())
     return false;
+  bool res = false;
+  for(ciPluginScanList ips = ipl->begin(); ips != ipl->end(); ++ips)
+  {
+    const PluginScanInfoStruct& info = (*ips)->info();
+    // Caches written before times were recorded have zero time and size. Rescan those.
+    if(info._fileTime == 0 || info._fileTime != file_time || info._fileSize != file_size)
+      continue;
+    // The caches may hold the same plugin more than once, if the file was found in
+    //  more than one directory. Take it only once or the copies would multiply.
+    ciPluginScanList ifs = found->begin();
+    for( ; ifs != found->end(); ++ifs)
+    {
+      if((*ifs)->info()._type == info._type && (*ifs)->info()._label == info._label)
+        break;
+    }
+    if(ifs != found->end())
+      continue;
+    found->push_back(*ips);
+    res = true;
   }
-  
-  // Create an xml object based on the file.
-  MusECore::Xml xml(&infile);
-  
-  // Read the list of plugins found in the xml.
-  // For now we don't supply a separate scanEnums flag in pluginScan(), so just use scanPorts instead.
-  if(readPluginScan(xml, list, scanPorts, scanPorts))
+  return res;
+}
+
+//---------------------------------------------------------
+//   pluginScanFiles
+//   Scans the files with several scan processes at once,
+//    one per core. Files which have not changed since they
+//    were cached are taken from the cache if given, and
+//    files found to have no plugins are added to it.
+//   If debugStdErr is true, any stderr content received
+//    from the scan program will be printed.
+//---------------------------------------------------------
+
+static void pluginScanFiles(
+  const QStringList& files,
+  PluginScanInfoStruct::PluginType_t types,
+  PluginScanList* list,
+  bool scanPorts,
+  bool debugStdErr,
+  PluginScanCache* cache)
+{
+  const int max_processes = 16;
+  const int poll_msecs = 5;
+
+  const int nfiles = files.size();
+  if(nfiles == 0)
+    return;
+
+  // The results are merged in file order afterwards, so that which one of any
+  //  duplicate plugins is found first does not depend on which scan finished first.
+  std::vector<QByteArray> results(nfiles);
+  std::vector<PluginScanList> cached_results(nfiles);
+  std::vector<char> scanned(nfiles, false);
+  std::vector<char> failed(nfiles, false);
+  std::vector<int> to_scan;
+  for(int i = 0; i < nfiles; ++i)
+  {
+    if(cache && findCachedScan(files.at(i), *cache, &cached_results[i]))
+    {
+      if(debugStdErr)
+        std::fprintf(stderr, "\nUsing cached scan of unchanged file: <%s>\n", files.at(i).toLocal8Bit().constData());
+    }
+    else
+    {
+      to_scan.push_back(i);
+      scanned[i] = true;
+    }
+  }
+
+  int nprocs = QThread::idealThreadCount();
+  if(nprocs < 1)
+    nprocs = 1;
+  else if(nprocs > max_processes)
+    nprocs = max_processes;
+  if(nprocs > int(to_scan.size()))
+    nprocs = to_scan.size();
+
+  std::vector<PluginScanProcess*> procs;
+  for(int i = 0; i < nprocs; ++i)
+    procs.push_back(new PluginScanProcess(debugStdErr));
+
+  std::vector<int>::const_iterator next = to_scan.begin();
+  for(;;)
   {
-    std::fprintf(stderr, "\npluginScan FAILED: On readPluginScan(): file: %s\n\n", filename_ba.constData());
+    bool busy = false;
+    for(int i = 0; i < nprocs; ++i)
+    {
+      PluginScanProcess* proc = procs[i];
+      // A failed request means the scanner could not even be restarted.
+      while(proc->isIdle() && next != to_scan.end())
+      {
+        const int idx = *next++;
+        if(debugStdErr)
+          std::fprintf(stderr, "\nChecking file: <%s>\n", files.at(idx).toLocal8Bit().constData());
+        if(!proc->request(idx, files.at(idx), types, scanPorts))
+          failed[idx] = true;
+      }
+      if(!proc->isIdle())
+        busy = true;
+    }
+    if(!busy)
+      break;
+
+    for(int i = 0; i < nprocs; ++i)
+    {
+      PluginScanProcess* proc = procs[i];
+      const int idx = proc->fileIndex();
+      if(idx >= 0 && proc->poll(poll_msecs, &results[idx]) && proc->failed())
+        failed[idx] = true;
+    }
   }
 
-  // Close the temp file.
-  infile.close();
-  
-  // Now going out of scope destroys the temporary file...
-  
-  return true;
+  for(int i = 0; i < nprocs; ++i)
+    delete procs[i];
+
+  for(int i = 0; i < nfiles; ++i)
+  {
+    if(!cached_results[i].empty())
+    {
+      list->insert(list->end(), cached_results[i].begin(), cached_results[i].end());
+      continue;
+    }
+    if(!scanned[i] || failed[i])
+      continue;
+
+    PluginScanList found;
+    if(!results[i].isEmpty())
+    {
+      QBuffer buffer(&results[i]);
+      buffer.open(QIODevice::ReadOnly);
+      // Create an xml object based on the scan output.
+      MusECore::Xml xml(&buffer);
+      // Read the list of plugins found in the xml.
+      // For now we don't supply a separate scanEnums flag in pluginScan(), so just use scanPorts instead.
+      if(readPluginScan(xml, &found, scanPorts, scanPorts))
+      {
+        std::fprintf(stderr, "\npluginScan FAILED: On readPluginScan(): file: %s\n\n", files.at(i).toLocal8Bit().constData());
+        buffer.close();
+        continue;
+      }
+      buffer.close();
+    }
+
+    const QFileInfo fi(files.at(i));
+    if(found.empty())
+    {
+      // Remember it, so that it is not scanned again at every start until it changes.
+      if(cache)
+      {
+        PluginScanCache::FileStamp& stamp = cache->emptyFiles[fi.filePath()];
+        stamp.time = fi.lastModified().toMSecsSinceEpoch();
+        stamp.size = fi.size();
+      }
+      continue;
+    }
+    if(cache)
+      cache->emptyFiles.remove(fi.filePath());
+
+    for(ciPluginScanList ips = found.begin(); ips != found.end(); ++ips)
+    {
+      // Skip duplicates, as readPluginScan() would have done on the list itself.
+      const PluginScanInfoRef found_inforef = list->find((*ips)->info());
+      if(found_inforef)
+      {
+        std::fprintf(stderr, "Ignoring plugin label:%s\n  path:%s duplicate of\n  path:%s\n",
+                     PLUGIN_GET_CSTRING((*ips)->info()._label),
+                     PLUGIN_GET_CSTRING((*ips)->info().filePath()),
+                     PLUGIN_GET_CSTRING(found_inforef->info().filePath()));
+        continue;
+      }
+      list->push_back(*ips);
+    }
+  }
 }
 
 //---------------------------------------------------------
 //   scanPluginDir
+//   Collects the plugin files found in the directory.
 //   This might be called recursively!
 //---------------------------------------------------------
 
 static void scanPluginDir(
   const QString& dirname,
-  PluginScanInfoStruct::PluginType_t types,
-  PluginScanList* list,
-  bool scanPorts,
-  bool debugStdErr,
+  QStringList* files,
   // Only for recursions, original top caller should not touch!
   int recurseLevel = 0
 )
@@ -1656,35 +1981,53 @@ static void scanPluginDir(
       const QFileInfo& fi = *it;
       if(fi.isDir())
         // RECURSIVE!
-        scanPluginDir(fi.filePath(), types, list, scanPorts, debugStdErr, recurseLevel + 1);
+        scanPluginDir(fi.filePath(), files, recurseLevel + 1);
       else
-        pluginScan(fi.filePath(), types, list, scanPorts, debugStdErr);
+        files->append(fi.filePath());
       
       ++it;
     }
   }
 }
 
+//---------------------------------------------------------
+//   scanPluginDirs
+//---------------------------------------------------------
+
+static void scanPluginDirs(
+  const QStringList& dirs,
+  PluginScanInfoStruct::PluginType_t types,
+  PluginScanList* list,
+  bool scanPorts,
+  bool debugStdErr,
+  PluginScanCache* cache)
+{
+  QStringList files;
+  for(QStringList::const_iterator it = dirs.cbegin(); it != dirs.cend(); ++it)
+    scanPluginDir(*it, &files);
+  pluginScanFiles(files, types, list, scanPorts, debugStdErr, cache);
+}
+
 //---------------------------------------------------------
 //   scanLadspaPlugins
 //---------------------------------------------------------
 
-void scanLadspaPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr)
+void scanLadspaPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr,
+                       PluginScanCache* cache)
 {
-  QStringList sl = pluginGetLadspaDirectories(museGlobalLib);
-  for(QStringList::const_iterator it = sl.cbegin(); it != sl.cend(); ++it)
-    scanPluginDir(*it, PluginScanInfoStruct::PluginTypeAll, list, scanPorts, debugStdErr);
+  scanPluginDirs(pluginGetLadspaDirectories(museGlobalLib), PluginScanInfoStruct::PluginTypeAll,
+                 list, scanPorts, debugStdErr, cache);
 }
 
 //---------------------------------------------------------
 //   scanMessPlugins
 //---------------------------------------------------------
 
-void scanMessPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr)
+void scanMessPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr,
+                     PluginScanCache* cache)
 {
-  QStringList sl = pluginGetMessDirectories(museGlobalLib);
-  for(QStringList::const_iterator it = sl.cbegin(); it != sl.cend(); ++it)
-    scanPluginDir(*it, PluginScanInfoStruct::PluginTypeAll, list, scanPorts, debugStdErr);
+  scanPluginDirs(pluginGetMessDirectories(museGlobalLib), PluginScanInfoStruct::PluginTypeAll,
+                 list, scanPorts, debugStdErr, cache);
 }
 
 //---------------------------------------------------------
@@ -1692,14 +2035,13 @@ void scanMessPlugins(const QString& museGlobalLib, PluginScanList* list, bool sc
 //---------------------------------------------------------
 
 #ifdef DSSI_SUPPORT
-void scanDssiPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr)
+void scanDssiPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr, PluginScanCache* cache)
 {
-  QStringList sl = pluginGetDssiDirectories();
-  for(QStringList::const_iterator it = sl.cbegin(); it != sl.cend(); ++it)
-    scanPluginDir(*it, PluginScanInfoStruct::PluginTypeAll, list, scanPorts, debugStdErr);
+  scanPluginDirs(pluginGetDssiDirectories(), PluginScanInfoStruct::PluginTypeAll,
+                 list, scanPorts, debugStdErr, cache);
 }
 #else // No DSSI_SUPPORT
-void scanDssiPlugins(PluginScanList* /*list*/, bool /*scanPorts*/, bool /*debugStdErr*/)
+void scanDssiPlugins(PluginScanList* /*list*/, bool /*scanPorts*/, bool /*debugStdErr*/, PluginScanCache* /*cache*/)
 {
 }
 #endif // DSSI_SUPPORT
@@ -1708,7 +2050,7 @@ void scanDssiPlugins(PluginScanList* /*list*/, bool /*scanPorts*/, bool /*debugS
 //   scanLinuxVSTPlugins
 //---------------------------------------------------------
 
-void scanLinuxVSTPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr)
+void scanLinuxVSTPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr, PluginScanCache* cache)
 {
 #ifdef VST_NATIVE_SUPPORT
   #ifdef VST_VESTIGE_SUPPORT
@@ -1719,10 +2061,11 @@ void scanLinuxVSTPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr)
     
 //   sem_init(&_vstIdLock, 0, 1);
   
-  QStringList sl = pluginGetLinuxVstDirectories();
-  for(QStringList::const_iterator it = sl.cbegin(); it != sl.cend(); ++it)
-    scanPluginDir(*it, PluginScanInfoStruct::PluginTypeAll, list, scanPorts, debugStdErr);
-  #endif
+  scanPluginDirs(pluginGetLinuxVstDirectories(), PluginScanInfoStruct::PluginTypeAll,
+                 list, scanPorts, debugStdErr, cache);
+#else
+  (void)list; (void)scanPorts; (void)debugStdErr; (void)cache;
+#endif
 }
 
 #ifdef LV2_SUPPORT
@@ -2387,23 +2730,24 @@ void scanAllPlugins(
   PluginScanList* list,
   bool scanPorts,
   bool debugStdErr,
-  PluginScanInfoStruct::PluginType_t types)
+  PluginScanInfoStruct::PluginType_t types,
+  PluginScanCache* cache)
 {
   if(types & (PluginScanInfoStruct::PluginTypeDSSI | PluginScanInfoStruct::PluginTypeDSSIVST))
     // Take care of DSSI plugins first...
-    scanDssiPlugins(list, scanPorts, debugStdErr);
+    scanDssiPlugins(list, scanPorts, debugStdErr, cache);
 
   if(types & (PluginScanInfoStruct::PluginTypeLADSPA))
     // Now do LADSPA plugins...
-    scanLadspaPlugins(museGlobalLib, list, scanPorts, debugStdErr);
+    scanLadspaPlugins(museGlobalLib, list, scanPorts, debugStdErr, cache);
   
   if(types & (PluginScanInfoStruct::PluginTypeMESS))
     // Now do MESS plugins...
-    scanMessPlugins(museGlobalLib, list, scanPorts, debugStdErr);
+    scanMessPlugins(museGlobalLib, list, scanPorts, debugStdErr, cache);
   
   if(types & (PluginScanInfoStruct::PluginTypeLinuxVST))
     // Now do LinuxVST plugins...
-    scanLinuxVSTPlugins(list, scanPorts, debugStdErr);
+    scanLinuxVSTPlugins(list, scanPorts, debugStdErr, cache);
   
   if(types & (PluginScanInfoStruct::PluginTypeLV2))
     // Now do LV2 plugins...
@@ -2467,6 +2811,109 @@ bool writePluginCacheFile(
   return res;
 }
 
+//---------------------------------------------------------
+//   readPluginScanEmptyFiles
+//---------------------------------------------------------
+
+static const char* pluginScanEmptyFilesName = "empty_plugin_files.scan";
+
+bool readPluginScanEmptyFiles(const QString& path, PluginScanCache* cache)
+{
+  QFile qfile(path + "/" + QString(pluginScanEmptyFilesName));
+  if(!qfile.exists())
+    return false;
+  if(!qfile.open(QIODevice::ReadOnly | QIODevice::Text))
+  {
+    std::fprintf(stderr, "readPluginScanEmptyFiles: open() failed: path:%s\n", path.toLocal8Bit().constData());
+    return false;
+  }
+
+  MusECore::Xml xml(&qfile);
+  PluginScanCache::FileStamp stamp;
+  stamp.time = 0;
+  stamp.size = 0;
+  QString file;
+  bool res = false;
+  for(bool done = false; !done; )
+  {
+    const MusECore::Xml::Token token = xml.parse();
+    const QString& tag = xml.s1();
+    switch(token)
+    {
+      case MusECore::Xml::Error:
+      case MusECore::Xml::End:
+        done = true;
+        break;
+      case MusECore::Xml::TagStart:
+        if(tag == "emptyFile")
+        {
+          stamp.time = 0;
+          stamp.size = 0;
+          file.clear();
+        }
+        else if(tag != "muse")
+          xml.unknown("readPluginScanEmptyFiles");
+        break;
+      case MusECore::Xml::Attribut:
+        if(tag == "time")
+          stamp.time = xml.s2().toLongLong();
+        else if(tag == "size")
+          stamp.size = xml.s2().toLongLong();
+        break;
+      case MusECore::Xml::Text:
+        file = tag;
+        break;
+      case MusECore::Xml::TagEnd:
+        if(tag == "emptyFile")
+        {
+          if(!file.isEmpty() && stamp.time != 0)
+            cache->emptyFiles.insert(file, stamp);
+        }
+        else if(tag == "muse")
+        {
+          res = true;
+          done = true;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  qfile.close();
+  return res;
+}
+
+//---------------------------------------------------------
+//   writePluginScanEmptyFiles
+//---------------------------------------------------------
+
+bool writePluginScanEmptyFiles(const QString& path, const PluginScanCache& cache)
+{
+  QFile qfile(path + "/" + QString(pluginScanEmptyFilesName));
+  if(!qfile.open(QIODevice::WriteOnly | QIODevice::Text))
+  {
+    std::fprintf(stderr, "writePluginScanEmptyFiles: open() failed: path:%s\n", path.toLocal8Bit().constData());
+    return false;
+  }
+
+  MusECore::Xml xml(&qfile);
+  int level = 0;
+  xml.header();
+  level = xml.putFileVersion(level);
+  for(QHash<QString, PluginScanCache::FileStamp>::const_iterator i = cache.emptyFiles.constBegin();
+      i != cache.emptyFiles.constEnd(); ++i)
+  {
+    // Files which are gone are dropped.
+    if(!QFileInfo(i.key()).exists())
+      continue;
+    xml.put(level, "<emptyFile time=\"%lld\" size=\"%lld\">%s</emptyFile>",
+            i->time, i->size, MusECore::Xml::xmlString(i.key()).toUtf8().constData());
+  }
+  xml.tag(1, "/muse");
+  qfile.close();
+  return true;
+}
+
 //---------------------------------------------------------
 //   createPluginCacheFile
 //---------------------------------------------------------
@@ -2478,10 +2925,11 @@ bool createPluginCacheFile(
   bool writePorts,
   const QString& museGlobalLib,
   PluginScanInfoStruct::PluginType_t types,
-  bool debugStdErr)
+  bool debugStdErr,
+  PluginScanCache* cache)
 {
   // Scan all plugins into the list.
-  scanAllPlugins(museGlobalLib, list, writePorts, debugStdErr, type);
+  scanAllPlugins(museGlobalLib, list, writePorts, debugStdErr, type, cache);
   
   // Write the list's cache file.
   if(!writePluginCacheFile(path, QString(pluginCacheFilename(type)), *list, writePorts, types))
@@ -2503,31 +2951,32 @@ bool createPluginCacheFiles(
   bool writePorts,
   const QString& museGlobalLib,
   PluginScanInfoStruct::PluginType_t types,
-  bool debugStdErr)
+  bool debugStdErr,
+  PluginScanCache* cache)
 {
   if(types & (PluginScanInfoStruct::PluginTypeDSSI | PluginScanInfoStruct::PluginTypeDSSIVST))
     createPluginCacheFile(path, PluginScanInfoStruct::PluginTypeDSSI, list, writePorts,
-      museGlobalLib, PluginScanInfoStruct::PluginTypeDSSI | PluginScanInfoStruct::PluginTypeDSSIVST, debugStdErr);
+      museGlobalLib, PluginScanInfoStruct::PluginTypeDSSI | PluginScanInfoStruct::PluginTypeDSSIVST, debugStdErr, cache);
 
   if(types & PluginScanInfoStruct::PluginTypeLADSPA)
     createPluginCacheFile(path, PluginScanInfoStruct::PluginTypeLADSPA, list, writePorts,
-      museGlobalLib, PluginScanInfoStruct::PluginTypeLADSPA, debugStdErr);
+      museGlobalLib, PluginScanInfoStruct::PluginTypeLADSPA, debugStdErr, cache);
     
   if(types & PluginScanInfoStruct::PluginTypeLinuxVST)
     createPluginCacheFile(path, PluginScanInfoStruct::PluginTypeLinuxVST, list, writePorts,
-      museGlobalLib, PluginScanInfoStruct::PluginTypeLinuxVST, debugStdErr);
+      museGlobalLib, PluginScanInfoStruct::PluginTypeLinuxVST, debugStdErr, cache);
     
   if(types & PluginScanInfoStruct::PluginTypeMESS)
     createPluginCacheFile(path, PluginScanInfoStruct::PluginTypeMESS, list, writePorts,
-      museGlobalLib, PluginScanInfoStruct::PluginTypeMESS, debugStdErr);
+      museGlobalLib, PluginScanInfoStruct::PluginTypeMESS, debugStdErr, cache);
     
   if(types & PluginScanInfoStruct::PluginTypeLV2)
     createPluginCacheFile(path, PluginScanInfoStruct::PluginTypeLV2, list, writePorts,
-      museGlobalLib, PluginScanInfoStruct::PluginTypeLV2, debugStdErr);
+      museGlobalLib, PluginScanInfoStruct::PluginTypeLV2, debugStdErr, cache);
     
   if(types & PluginScanInfoStruct::PluginTypeVST)
     createPluginCacheFile(path, PluginScanInfoStruct::PluginTypeVST, list, writePorts,
-      museGlobalLib, PluginScanInfoStruct::PluginTypeVST, debugStdErr);
+      museGlobalLib, PluginScanInfoStruct::PluginTypeVST, debugStdErr, cache);
     
   return true;
 }
@@ -2563,11 +3012,25 @@ bool checkPluginCacheFiles(
     if(debugStdErr)
       std::fprintf(stderr, "Re-scanning and creating plugin cache files...\n");
 
-    if(!createPluginCacheFiles(path, list, writePorts, museGlobalLib, types, debugStdErr))
+    // Unless forced, files which have not changed since the existing caches
+    //  were written are not scanned again. Only the changed ones are.
+    // Neither are files which were found to contain no plugins.
+    PluginScanCache cache;
+    if(!alwaysRecreate)
+    {
+      PluginScanList cached;
+      readPluginCacheFiles(path, &cached, writePorts, writePorts, types);
+      cache.addPlugins(cached);
+      readPluginScanEmptyFiles(path, &cache);
+    }
+
+    if(!createPluginCacheFiles(path, list, writePorts, museGlobalLib, types, debugStdErr, &cache))
       std::fprintf(stderr, "checkPluginCacheFiles: createPluginCacheFiles() failed\n");
     else
       res = true;
 
+    writePluginScanEmptyFiles(path, cache);
+
     // The list has been filled now. No need to call readPluginCacheFiles() on the cache files - we're done.
   }
   else
@@ -26,6 +26,7 @@
 
 #include <QString>
 #include <QStringList>
+#include <QHash>
 
 #include "config.h"
 #include "globaldefs.h"
@@ -138,18 +139,45 @@ void scanLv2Ports(const LilvPlugin *plugin, PluginScanInfoStruct* info, bool deb
 
 void writePluginScanInfo(int level, MusECore::Xml& xml, const PluginScanInfoStruct& info, bool writePorts);
 
+// What is known about the plugin files from a previous scan.
+struct PluginScanCache
+{
+  // The file's modification time and size when it was scanned.
+  struct FileStamp { long long time; long long size; };
+
+  // Previously cached plugins, keyed by file path.
+  QHash<QString, PluginScanList> plugins;
+  // Files which were scanned successfully but contain no plugins, keyed by file path.
+  // Updated by the scan, so that it can be written back with writePluginScanEmptyFiles().
+  QHash<QString, FileStamp> emptyFiles;
+
+  // Adds a list of cached plugins.
+  void addPlugins(const PluginScanList& list);
+};
+
+// The empty files list lives next to the cache files. Return true on success.
+bool readPluginScanEmptyFiles(const QString& path, PluginScanCache* cache);
+bool writePluginScanEmptyFiles(const QString& path, const PluginScanCache& cache);
+
 // The museGlobalLib is where to find the application's installed libraries.
-void scanLadspaPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr);
-void scanMessPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr);
-void scanDssiPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr);
-void scanLinuxVSTPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr);
+// Plugin files are scanned by several muse_plugin_scan processes at once.
+// If cache is given, files which have not changed since they were cached
+//  are not scanned again, their plugins are taken from the cache instead.
+void scanLadspaPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr,
+                       PluginScanCache* cache = 0);
+void scanMessPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr,
+                     PluginScanCache* cache = 0);
+void scanDssiPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr, PluginScanCache* cache = 0);
+void scanLinuxVSTPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr, PluginScanCache* cache = 0);
 void scanLv2Plugins(PluginScanList* list, bool scanPorts, bool debugStdErr);
 
 void scanAllPlugins(const QString& museGlobalLib,
                     PluginScanList* list,
                     bool scanPorts,
                     bool debugStdErr,
-                    PluginScanInfoStruct::PluginType_t types = PluginScanInfoStruct::PluginTypeAll);
+                    PluginScanInfoStruct::PluginType_t types = PluginScanInfoStruct::PluginTypeAll,
+                    // Previous scan to take unchanged files from. LV2 is always scanned.
+                    PluginScanCache* cache = 0);
 
 //-----------------------------------------
 // Public cache writer functions
@@ -170,7 +198,9 @@ bool createPluginCacheFile(
   // The types of plugins to write into this one file.
   PluginScanInfoStruct::PluginType_t types = PluginScanInfoStruct::PluginTypeAll,
   // Print some stderr text
-  bool debugStdErr = false
+  bool debugStdErr = false,
+  // Previous scan to take unchanged files from, instead of scanning them.
+  PluginScanCache* cache = 0
 );
 
 bool createPluginCacheFiles(
@@ -185,7 +215,9 @@ bool createPluginCacheFiles(
   // The types of plugin cache files to create.
   PluginScanInfoStruct::PluginType_t types = PluginScanInfoStruct::PluginTypeAll,
   // Print some stderr text
-  bool debugStdErr = false
+  bool debugStdErr = false,
+  // Previous scan to take unchanged files from, instead of scanning them.
+  PluginScanCache* cache = 0
 );
 
 // Checks existence of given cache file types.
@@ -201,6 +201,10 @@ class PluginScanInfoStruct
     PluginInfoString_t _completeSuffix;
     PluginInfoString_t _absolutePath;
     PluginInfoString_t _path;
+    // Modification time (msecs since epoch) and size of the file when it was scanned.
+    // Used to rescan only the files which changed.
+    long long _fileTime;
+    long long _fileSize;
     
     // Like "http://zynaddsubfx.sourceforge.net/fx#Phaser".
     PluginInfoString_t _uri;
@@ -260,6 +264,8 @@ class PluginScanInfoStruct
 
   public:
     PluginScanInfoStruct() :
+      _fileTime(0),
+      _fileSize(0),
       _type(PluginTypeNone),
       _class(PluginClassNone),
       _uniqueID(0),
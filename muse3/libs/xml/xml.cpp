@@ -23,8 +23,13 @@
 //=========================================================
 
 #include <stdarg.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "xml.h"
+#include "xml_compress.h"
 
 namespace MusECore {
 
@@ -45,65 +50,58 @@ const int Xml::_latestMinorVersion = 1;   // Latest known songfile minor version
 
 Xml::Xml(FILE* _f)
       {
-      f          = _f;
-      _destStr   = 0;
-      _destIODev = 0;
-      _line      = 0;
-      _col       = 0;
-      level      = 0;
-      inTag      = false;
-      inComment  = false;
-      lbuffer[0] = 0;
-      bufptr     = lbuffer;
-      _minorVersion = -1;
-      _majorVersion = -1;
+      init();
+      f = _f;
       }
 
 Xml::Xml(const char* buf)
       {
-      f         = 0;
-      _destStr  = 0;
-      _destIODev = 0;
-      _line     = 0;
-      _col      = 0;
-      level     = 0;
-      inTag     = false;
-      inComment = false;
-      bufptr    = buf;
-      _minorVersion = -1;
-      _majorVersion = -1;
+      init();
+      bufptr = buf;
+      bufend = buf + strlen(buf);
+      _inputLoaded = true;
       }
 
 Xml::Xml(QString* s)
       {
-      f         = 0;
-      _destIODev = 0;
-      _line     = 0;
-      _col      = 0;
-      level     = 0;
-      inTag     = false;
-      inComment = false;
-      lbuffer[0] = 0;
-      bufptr     = lbuffer;
-      _destStr   = s;
-      _minorVersion = -1;
-      _majorVersion = -1;
+      init();
+      _destStr = s;
+      _inputLoaded = true;
       }
 
 Xml::Xml(QIODevice* d)
       {
-      f         = 0;
-      _destStr   = 0;
+      init();
       _destIODev = d;
-      _line     = 0;
-      _col      = 0;
-      level     = 0;
-      inTag     = false;
-      inComment = false;
+      }
+
+//---------------------------------------------------------
+//   init
+//---------------------------------------------------------
+
+void Xml::init()
+      {
+      f          = 0;
+      _destStr   = 0;
+      _destIODev = 0;
+      _line      = 0;
+      _col       = 0;
+      level      = 0;
+      inTag      = false;
+      inComment  = false;
       lbuffer[0] = 0;
       bufptr     = lbuffer;
+      bufend     = lbuffer;
+      _inputLoaded  = false;
       _minorVersion = -1;
       _majorVersion = -1;
+      clearToken(_t1);
+      clearToken(_t2);
+      _s1Valid      = true;
+      _s2Valid      = true;
+      _s1IsName     = false;
+      _tagPtr       = "";
+      _tagLen       = 0;
       }
 
 
@@ -111,26 +109,109 @@ Xml::Xml(QIODevice* d)
 //   BEGIN Read functions:
 //---------------------------------------------------------
 
-      
+//---------------------------------------------------------
+//   XmlInput
+//    The whole input of a FILE or QIODevice, so that the
+//     tokens can simply point into it.
+//---------------------------------------------------------
+
+struct XmlInput {
+      QByteArray data;
+      void* map;
+      size_t mapSize;
+
+      XmlInput() : map(0), mapSize(0) {}
+      ~XmlInput() {
+            if (map)
+                  munmap(map, mapSize);
+            }
+      };
+
+//---------------------------------------------------------
+//   loadInput
+//    Regular files are mapped, anything else (pipes,
+//     devices) is read in big blocks. gzip
+//     compressed input is decompressed here in one go.
+//    Returns false if there is nothing (more) to read.
+//---------------------------------------------------------
+
+bool Xml::loadInput()
+      {
+      if (_inputLoaded)
+            return false;
+      _inputLoaded = true;
+      if (!f && !_destIODev)
+            return false;
+
+      XmlInput* in = new XmlInput;
+      _input.reset(in);
+      bool mapped = false;
+      if (f) {
+            struct stat st;
+            const off_t pos = ftello(f);
+            if (pos >= 0 && fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > pos) {
+                  void* m = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+                  if (m != MAP_FAILED) {
+                        madvise(m, st.st_size, MADV_SEQUENTIAL);
+                        in->map     = m;
+                        in->mapSize = st.st_size;
+                        bufptr      = (const char*)m + pos;
+                        bufend      = (const char*)m + st.st_size;
+                        mapped      = true;
+                        }
+                  }
+            if (!mapped) {
+                  char block[65536];
+                  size_t n;
+                  while ((n = fread(block, 1, sizeof(block), f)) > 0) {
+                        if (size_t(in->data.size()) > xmlMaxDataSize - n) {
+                              fprintf(stderr, "Xml: input is larger than %zu bytes\n", xmlMaxDataSize);
+                              in->data.clear();
+                              bufptr = bufend = in->data.constData();
+                              return false;
+                              }
+                        in->data.append(block, n);
+                        }
+                  }
+            }
+      else
+            in->data = _destIODev->readAll();
+
+      if (!mapped) {
+            bufptr = in->data.constData();
+            bufend = bufptr + in->data.size();
+            }
+
+      if (xmlDetectCompression(bufptr, bufend - bufptr) != XmlNoCompression) {
+            QByteArray plain;
+            const bool ok = xmlDecompress(bufptr, bufend - bufptr, &plain);
+            if (in->map) {
+                  munmap(in->map, in->mapSize);
+                  in->map = 0;
+                  }
+            in->data = plain;
+            bufptr   = in->data.constData();
+            bufend   = bufptr + in->data.size();
+            if (!ok) {
+                  fprintf(stderr, "Xml: cannot decompress input, it is damaged, truncated or too large\n");
+                  bufend = bufptr;
+                  return false;
+                  }
+            }
+      return bufptr < bufend;
+      }
+
 //---------------------------------------------------------
 //   next
 //---------------------------------------------------------
 
 void Xml::next()
       {
-      if (*bufptr == 0) {
-        
-            if((!f && !_destIODev) ||
-               (f && fgets(lbuffer, 512, f) == 0) ||
-               (_destIODev && _destIODev->readLine(lbuffer, 512) <= 0))
-            {
-              c = EOF;
-              return;
-            }
-                  
-            bufptr = lbuffer;
+      if (bufptr >= bufend && !loadInput()) {
+            c = EOF;
+            return;
             }
-      c = *bufptr++;
+      c = (unsigned char)*bufptr++;
       if (c == '\n') {
             ++_line;
             _col = -1;
@@ -150,19 +231,63 @@ void Xml::nextc()
             next();
       }
 
+//---------------------------------------------------------
+//   clearToken
+//---------------------------------------------------------
+
+void Xml::clearToken(TokenText& t)
+      {
+      t.ptr    = "";
+      t.len    = 0;
+      t.copied = false;
+      t.copy.clear();
+      }
+
+//---------------------------------------------------------
+//   appendRaw
+//    append the current char, as it is in the input
+//---------------------------------------------------------
+
+void Xml::appendRaw(TokenText& t)
+      {
+      if (t.copied)
+            t.copy += char(c);
+      else if (t.len == 0) {
+            t.ptr = bufptr - 1;
+            t.len = 1;
+            }
+      else
+            ++t.len;
+      }
+
+//---------------------------------------------------------
+//   appendChar
+//    append an unescaped char, which is not in the input
+//---------------------------------------------------------
+
+void Xml::appendChar(TokenText& t, char ch)
+      {
+      if (!t.copied) {
+            t.copy.assign(t.ptr, t.len);
+            t.copied = true;
+            }
+      t.copy += ch;
+      }
+
 //---------------------------------------------------------
 //   token
-//    read token into _s2
+//    read token into _t2
 //---------------------------------------------------------
 
 void Xml::token(int cc)
       {
-      _s2.clear();  
+      clearToken(_t2);
+      _s2Valid = false;
       int i = 0;
       for (; i < 9999999;) {   // Stop at a reasonably large amount 10 million.
             if (c == ' ' || c == '\t' || c == cc || c == '\n' || c == EOF)
                   break;
-            _s2.append(c);
+            appendRaw(_t2);
             i++;
             next();
             }
@@ -170,20 +295,21 @@ void Xml::token(int cc)
 
 //---------------------------------------------------------
 //   stoken
-//    read string token into _s2
+//    read string token into _t2
 //---------------------------------------------------------
 
 void Xml::stoken()
       {
-      _s2.clear();  
+      clearToken(_t2);
+      _s2Valid = false;
       int i = 0;
-      _s2.append(c);
+      appendRaw(_t2);
       ++i;
       next();
 
       for (;i < 10000000*4-1;) {  // Stop at a reasonably large amount 10 million.
             if (c == '"') {
-                  _s2.append(c);
+                  appendRaw(_t2);
                   i++;
                   next();
                   break;
@@ -217,19 +343,19 @@ void Xml::stoken()
                   if (c == EOF || k == 6) {
                         // dump entity
                         int n = 0;
-                        _s2.append('&');
+                        appendChar(_t2, '&');
                         i++;
                         for (;(i < 511) && (n < k); ++i, ++n)
-                             _s2.append(entity[n]);
+                             appendChar(_t2, entity[n]);
                         }
                   else {
-                        _s2.append(c);
+                        appendChar(_t2, c);
                         i++;
                         }
                   }
             else if(c != EOF)
             {
-              _s2.append(c);
+              appendRaw(_t2);
               i++;
             }
             if (c == EOF)
@@ -243,12 +369,171 @@ void Xml::stoken()
 //    strip `"` from string
 //---------------------------------------------------------
 
-QString Xml::strip(const QString& s)
+void Xml::strip(TokenText& t)
       {
-      int l = s.length();
-      if (l >= 2 && s[0] == '"')
-            return s.mid(1, l-2);
-      return s;
+      const int l = t.size();
+      if (l >= 2 && t.data()[0] == '"') {
+            if (t.copied)
+                  t.copy = t.copy.substr(1, l - 2);
+            else {
+                  ++t.ptr;
+                  t.len = l - 2;
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   s1
+//    Names are looked up in the name cache first. They
+//     come from a small set, and are compared a lot.
+//---------------------------------------------------------
+
+const QString& Xml::s1()
+      {
+      if (!_s1Valid) {
+            const char* p = _t1.data();
+            const int n   = _t1.size();
+            if (_s1IsName && n <= 32) {
+                  unsigned h = 2166136261u;
+                  for (int i = 0; i < n; ++i)
+                        h = (h ^ (unsigned char)p[i]) * 16777619u;
+                  QString& name = _nameCache[h & (NameCacheSize - 1)];
+                  if (name != QLatin1String(p, n))
+                        name = QString::fromLatin1(p, n);
+                  _s1 = name;
+                  }
+            else
+                  _s1 = QString::fromLatin1(p, n);
+            _s1Valid = true;
+            }
+      return _s1;
+      }
+
+//---------------------------------------------------------
+//   s2
+//---------------------------------------------------------
+
+const QString& Xml::s2()
+      {
+      if (!_s2Valid) {
+            _s2 = QString::fromLatin1(_t2.data(), _t2.size());
+            _s2Valid = true;
+            }
+      return _s2;
+      }
+
+//---------------------------------------------------------
+//   trimmed
+//    strip white space like QString::simplified() does
+//---------------------------------------------------------
+
+static inline bool isSpace(char ch)
+      {
+      return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\v' || ch == '\f';
+      }
+
+static void trimmed(const char** p, int* n)
+      {
+      while (*n > 0 && isSpace(**p)) {
+            ++*p;
+            --*n;
+            }
+      while (*n > 0 && isSpace((*p)[*n - 1]))
+            --*n;
+      }
+
+//---------------------------------------------------------
+//   toLongLong
+//    Like QString::toLongLong(), with an optional "0x"
+//     prefix for hex as in parseInt().
+//---------------------------------------------------------
+
+static bool toLongLong(const char* p, int n, bool allowHex, long long* val)
+      {
+      trimmed(&p, &n);
+      int base = 10;
+      if (allowHex && n >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+            base = 16;
+            p += 2;
+            n -= 2;
+            }
+      bool neg = false;
+      if (n > 0 && (*p == '-' || *p == '+')) {
+            neg = *p == '-';
+            ++p;
+            --n;
+            }
+      if (n <= 0)
+            return false;
+      unsigned long long v = 0;
+      for (int i = 0; i < n; ++i) {
+            int d;
+            const char ch = p[i];
+            if (ch >= '0' && ch <= '9')
+                  d = ch - '0';
+            else if (base == 16 && ch >= 'a' && ch <= 'f')
+                  d = ch - 'a' + 10;
+            else if (base == 16 && ch >= 'A' && ch <= 'F')
+                  d = ch - 'A' + 10;
+            else
+                  return false;
+            if (v > (0xffffffffffffffffULL - d) / base)
+                  return false;
+            v = v * base + d;
+            }
+      if (neg) {
+            if (v > 0x8000000000000000ULL)
+                  return false;
+            *val = -(long long)v;
+            }
+      else {
+            if (v > 0x7fffffffffffffffULL)
+                  return false;
+            *val = v;
+            }
+      return true;
+      }
+
+static int toInt(const char* p, int n, bool allowHex, bool* ok)
+      {
+      long long v;
+      const bool r = toLongLong(p, n, allowHex, &v) && v >= INT_MIN && v <= INT_MAX;
+      if (ok)
+            *ok = r;
+      return r ? int(v) : 0;
+      }
+
+static unsigned int toUInt(const char* p, int n, bool allowHex, bool* ok)
+      {
+      long long v;
+      const bool r = toLongLong(p, n, allowHex, &v) && v >= 0 && v <= UINT_MAX;
+      if (ok)
+            *ok = r;
+      return r ? (unsigned int)v : 0;
+      }
+
+static double toDouble(const char* p, int n, bool* ok)
+      {
+      trimmed(&p, &n);
+      return QByteArray(p, n).toDouble(ok);
+      }
+
+//---------------------------------------------------------
+//   s2Int
+//---------------------------------------------------------
+
+int Xml::s2Int(bool* ok) const
+      {
+      return toInt(_t2.data(), _t2.size(), false, ok);
+      }
+
+//---------------------------------------------------------
+//   s2Double
+//---------------------------------------------------------
+
+double Xml::s2Double(bool* ok) const
+      {
+      return toDouble(_t2.data(), _t2.size(), ok);
       }
 
 //---------------------------------------------------------
@@ -257,18 +542,29 @@ QString Xml::strip(const QString& s)
 
 Xml::Token Xml::parse()
       {
+      return parseToken();
+      }
+
+//---------------------------------------------------------
+//   parseToken
+//---------------------------------------------------------
+
+Xml::Token Xml::parseToken()
+      {
  again:
       bool endFlag = false;
       nextc();
       if (c == EOF) {
             //if (level > 0 || MusEGlobal::debugMsg)
             if (level > 0)
-              fprintf(stderr, "WARNING: unexpected EOF reading xml file at level %d, line %d, <%s><%s><%s>\n",
-                level, _line, _tag.toLatin1().constData(), _s1.toLatin1().constData(), _s2.toLatin1().constData());
+              fprintf(stderr, "WARNING: unexpected EOF reading xml file at level %d, line %d, <%.*s><%.*s><%.*s>\n",
+                level, _line, _tagLen, _tagPtr, _t1.size(), _t1.data(), _t2.size(), _t2.data());
             return level == 0 ? End : Error;
             }
 
-      _s1.clear();
+      clearToken(_t1);
+      _s1Valid  = false;
+      _s1IsName = true;
       if (inTag) {
             //-------------------
             // parse Attributes
@@ -280,20 +576,20 @@ Xml::Token Xml::parse()
                         fprintf(stderr, "Xml: unexpected char '%c', expected '>'\n", c);
                         goto error;
                         }
-                  _s1   = _tag;
+                  _t1.ptr = _tagPtr;
+                  _t1.len = _tagLen;
                   inTag = false;
                   --level;
                   return TagEnd;
                   }
-            _s2.clear();
             token('=');
-            _s1 = _s2;
+            _t1 = _t2;
             nextc();      // skip space
             if (c == EOF) {
                   //if (level > 0 || MusEGlobal::debugMsg)
                   if (level > 0)
-                    fprintf(stderr, "WARNING: unexpected EOF reading xml file at level %d, line %d, <%s><%s><%s>\n",
-                      level, _line, _tag.toLatin1().constData(), _s1.toLatin1().constData(), _s2.toLatin1().constData());
+                    fprintf(stderr, "WARNING: unexpected EOF reading xml file at level %d, line %d, <%.*s><%.*s><%.*s>\n",
+                      level, _line, _tagLen, _tagPtr, _t1.size(), _t1.data(), _t2.size(), _t2.data());
                   return level == 0 ? End : Error;
                   }
             if (c == '"')
@@ -304,7 +600,7 @@ Xml::Token Xml::parse()
                   inTag = false;
             else
                   --bufptr;
-            _s2 = strip(_s2);
+            strip(_t2);
             return Attribut;
             }
       if (c == '<') {
@@ -317,12 +613,13 @@ Xml::Token Xml::parse()
                   next();
                   }
             if (c == '?') {
+                  _s1IsName = false;
                   next();
                   for (;;) {
                         if (c == '?' || c == EOF || c == '>')
                               break;
                         
-                        _s1.append(c);
+                        appendRaw(_t1);
                         
                         // TODO: check overflow
                         next();
@@ -360,7 +657,7 @@ Xml::Token Xml::parse()
                         break;
                   // TODO: check overflow
                   
-                  _s1.append(c);
+                  appendRaw(_t1);
                   
                   next();
                   }
@@ -393,7 +690,9 @@ Xml::Token Xml::parse()
                         }
                   }
             else {
-                  _tag = _s1;
+                  // Names are never unescaped, so this stays valid as long as the input.
+                  _tagPtr = _t1.data();
+                  _tagLen = _t1.size();
                   --bufptr;
                   inTag = true;
                   ++level;
@@ -412,44 +711,43 @@ Xml::Token Xml::parse()
                   fprintf(stderr, "XML: level = 0\n");
                   goto error;
                   }
+            _s1IsName = false;
             for (;;) {
                   if (c == EOF || c == '<')
                         break;
                   if (c == '&') {
                         next();
                         if (c == '<') {         // be tolerant with old muse files
-                              _s1.append('&');
+                              appendChar(_t1, '&');
                               continue;
                               }
                               
-                        QString name;
-                        int name_idx = 0;
-                        name.append(c);
-                        name_idx++;
+                        const char* name = bufptr - 1;
+                        int name_len = 1;
                         
-                        for (; name_idx < 9999999;) {   // Stop at a reasonably large amount 10 million.
+                        for (; name_len < 9999999;) {   // Stop at a reasonably large amount 10 million.
                               next();
-                              if (c == ';')
+                              if (c == ';' || c == EOF)
                                     break;
-                              name.append(c);
-                              name_idx++;
+                              name_len++;
                               }
                               
-                        if (name == "lt")
+                        if (name_len == 2 && strncmp(name, "lt", 2) == 0)
                               c = '<';
-                        else if (name == "gt")
+                        else if (name_len == 2 && strncmp(name, "gt", 2) == 0)
                               c = '>';
-                        else if (name == "apos")
+                        else if (name_len == 4 && strncmp(name, "apos", 4) == 0)
                               c = '\'';
-                        else if (name == "quot")
+                        else if (name_len == 4 && strncmp(name, "quot", 4) == 0)
                               c = '"';
-                        else if (name == "amp")
+                        else if (name_len == 3 && strncmp(name, "amp", 3) == 0)
                               c = '&';
                         else
                               c = '?';
+                        appendChar(_t1, c);
                         }
-
-                  _s1.append(c);
+                  else
+                        appendRaw(_t1);
                   
                   next();
                   }
@@ -481,10 +779,10 @@ QString Xml::parse(const QString& tag)
                   case Attribut:
                         break;
                   case Text:
-                        a = _s1;
+                        a = s1();
                         break;
                   case TagEnd:
-                        if (_s1 == tag)
+                        if (s1() == tag)
                               return a;
                         break;
                   }
@@ -498,7 +796,44 @@ QString Xml::parse(const QString& tag)
 
 QString Xml::parse1()
       {
-      return parse(_s1.simplified());
+      return parse(s1().simplified());
+      }
+
+//---------------------------------------------------------
+//   parseText
+//    Same as parse1(), but returns the text as a view,
+//     valid until the next parse. No QStrings are made.
+//---------------------------------------------------------
+
+bool Xml::parseText(const char** text, int* len)
+      {
+      // Names are views of the input, this stays valid.
+      const char* tag = _t1.data();
+      int tag_len     = _t1.size();
+      trimmed(&tag, &tag_len);
+      *text = "";
+      *len  = 0;
+
+      bool found = false;
+      for (;;) {
+            const Token token = parseToken();
+            if (token == Error || token == End)
+                  break;
+            if (token == Text) {
+                  if (_t1.copied) {
+                        _text = _t1.copy;
+                        *text = _text.data();
+                        }
+                  else
+                        *text = _t1.data();
+                  *len = _t1.size();
+                  }
+            else if (token == TagEnd && _t1.size() == tag_len && memcmp(_t1.data(), tag, tag_len) == 0) {
+                  found = true;
+                  break;
+                  }
+            }
+      return found;
       }
 
 //---------------------------------------------------------
@@ -507,15 +842,10 @@ QString Xml::parse1()
 
 int Xml::parseInt()
       {
-      QString s(parse1().simplified());
-      bool ok;
-      int base = 10;
-      if (s.startsWith("0x") || s.startsWith("0X")) {
-            base = 16;
-            s = s.mid(2);
-            }
-      int n = s.toInt(&ok, base);
-      return n;
+      const char* s;
+      int n;
+      parseText(&s, &n);
+      return toInt(s, n, true, 0);
       }
 
 //---------------------------------------------------------
@@ -524,15 +854,10 @@ int Xml::parseInt()
 
 unsigned int Xml::parseUInt()
       {
-      QString s(parse1().simplified());
-      bool ok;
-      int base = 10;
-      if (s.startsWith("0x") || s.startsWith("0X")) {
-            base = 16;
-            s = s.mid(2);
-            }
-      unsigned int n = s.toUInt(&ok, base);
-      return n;
+      const char* s;
+      int n;
+      parseText(&s, &n);
+      return toUInt(s, n, true, 0);
       }
 
 //---------------------------------------------------------
@@ -541,8 +866,11 @@ unsigned int Xml::parseUInt()
 
 float Xml::parseFloat()
       {
-      QString s(parse1().simplified());
-      return s.toFloat();
+      const char* s;
+      int n;
+      parseText(&s, &n);
+      trimmed(&s, &n);
+      return QByteArray(s, n).toFloat();
       }
 
 //---------------------------------------------------------
@@ -551,8 +879,10 @@ float Xml::parseFloat()
 
 double Xml::parseDouble()
       {
-      QString s(parse1().simplified());
-      return s.toDouble();
+      const char* s;
+      int n;
+      parseText(&s, &n);
+      return toDouble(s, n, 0);
       }
 
 //---------------------------------------------------------
@@ -562,8 +892,8 @@ double Xml::parseDouble()
 void Xml::skip(const QString& etag)
       {
       for (;;) {
+            // Only tag names are looked at, skipped text and attributes need no QString.
             Token token = parse();
-            const QString& tag = s1();
             switch (token) {
                   case Xml::Error:
                   case Xml::End:
@@ -571,11 +901,12 @@ void Xml::skip(const QString& etag)
                   case Xml::Text:
                         break;
                   case Xml::TagEnd:
-                        if (tag == etag)
+                        if (s1() == etag)
                               return;
                         break;
                   case Xml::TagStart:
-                        skip(tag);
+                        // A copy, s1() changes with the tokens of the inner tag.
+                        skip(QString(s1()));
                         break;
                   default:
                         break;
@@ -694,7 +1025,7 @@ QColor readColor(Xml& xml)
 void Xml::unknown(const char* s)
       {
       fprintf(stderr, "%s: unknown tag <%s> at line %d\n",
-         s, _s1.toLatin1().constData(), _line+1);
+         s, s1().toLatin1().constData(), _line+1);
       parse1();
       }
 
@@ -25,8 +25,11 @@
 #define __XML_H__
 
 #include <stdio.h>
+#include <string>
+#include <memory>
 
 #include <QString>
+#include <QByteArray>
 #include <QColor>
 #include <QRect>
 #include <QWidget>
@@ -34,6 +37,8 @@
 
 namespace MusECore {
 
+struct XmlInput;
+
 //---------------------------------------------------------
 //   Xml
 //    very simple XML-like parser
@@ -48,7 +53,28 @@ class Xml {
       QIODevice* _destIODev;
       int _line;
       int _col;
-      QString _s1, _s2, _tag;
+
+      // A token, as a view of the input. Only tokens which needed
+      //  unescaping are copied.
+      struct TokenText {
+            const char* ptr;
+            int len;
+            bool copied;
+            std::string copy;
+            const char* data() const { return copied ? copy.data() : ptr; }
+            int size() const         { return copied ? int(copy.size()) : len; }
+            };
+      TokenText _t1, _t2;
+      // _t1 and _t2 as QStrings, made on request.
+      QString _s1, _s2;
+      bool _s1Valid, _s2Valid;
+      bool _s1IsName;               // _t1 is a tag or attribute name
+      std::string _text;            // copy of an unescaped text, see parseText()
+      const char* _tagPtr;          // name of the current tag, a view of the input
+      int _tagLen;
+      // Recently seen names, so that each name needs allocating only once.
+      enum { NameCacheSize = 128 };
+      QString _nameCache[NameCacheSize];
       int level;
       bool inTag;
       bool inComment;
@@ -67,17 +93,32 @@ class Xml {
       char lbuffer[512];
       // When constructed with a const char* parameter, this will be valid.
       const char* bufptr;
-
+      // End of the input.
+      const char* bufend;
+      // Input of a FILE or QIODevice, mapped or read in one go at the
+      //  first read. Shared by copies.
+      std::shared_ptr<XmlInput> _input;
+      bool _inputLoaded;
+
+      void init();
+      bool loadInput();
       void next();
       void nextc();
       void token(int);
       void stoken();
-      QString strip(const QString& s);
+      void strip(TokenText&);
+      void clearToken(TokenText&);
+      void appendRaw(TokenText&);
+      void appendChar(TokenText&, char);
+      bool parseText(const char** text, int* len);
       void putLevel(int n);
 
    public:
       enum Token {Error, TagStart, TagEnd, Flag,
          Proc, Text, Attribut, End};
+   private:
+      Token parseToken();
+   public:
       int latestMajorVersion() const { return _latestMajorVersion; }
       int latestMinorVersion() const { return _latestMinorVersion; }
       int majorVersion() const { return _majorVersion; }
@@ -108,8 +149,13 @@ class Xml {
       void unknown(const char*);
       int line() const    { return _line; }    // current line
       int col()  const    { return _col; }     // current col
-      const QString& s1() { return _s1; }
-      const QString& s2() { return _s2; }
+      // The current token as a QString, made on the first call after parse().
+      // A reference taken before parse() keeps the old token until s1() is called again.
+      const QString& s1();
+      const QString& s2();
+      // Like s2().toInt() and s2().toDouble(), without making a QString.
+      int s2Int(bool* ok = 0) const;
+      double s2Double(bool* ok = 0) const;
       void dump(QString &dump);
 
       void header();
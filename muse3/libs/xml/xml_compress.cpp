@@ -0,0 +1,308 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  xml_compress.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <atomic>
+#include <vector>
+
+#include <zlib.h>
+
+#include "xml_compress.h"
+
+namespace MusECore {
+
+// Inputs above this size are compressed on several threads, in chunks of
+//  xmlChunkSize. Smaller songs are done before threads would pay off.
+static const size_t xmlParallelThreshold = 2 * 1024 * 1024;
+static const size_t xmlChunkSize         = 1024 * 1024;
+static const int    xmlMaxThreads        = 8;
+
+//---------------------------------------------------------
+//   compressionThreads
+//---------------------------------------------------------
+
+static int compressionThreads(size_t size)
+      {
+      if (size < xmlParallelThreshold)
+            return 1;
+      long n = sysconf(_SC_NPROCESSORS_ONLN);
+      if (n < 1)
+            n = 1;
+      if (n > xmlMaxThreads)
+            n = xmlMaxThreads;
+      const size_t chunks = (size + xmlChunkSize - 1) / xmlChunkSize;
+      if ((size_t)n > chunks)
+            n = chunks;
+      return n;
+      }
+
+//---------------------------------------------------------
+//   xmlCompressionFromName
+//---------------------------------------------------------
+
+XmlCompression xmlCompressionFromName(const QString& name)
+      {
+      if (name.endsWith(".gz"))
+            return XmlGzipCompression;
+      return XmlNoCompression;
+      }
+
+//---------------------------------------------------------
+//   xmlDetectCompression
+//---------------------------------------------------------
+
+XmlCompression xmlDetectCompression(const char* data, size_t size)
+      {
+      const unsigned char* p = (const unsigned char*)data;
+      if (size >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+            return XmlGzipCompression;
+      return XmlNoCompression;
+      }
+
+//---------------------------------------------------------
+//   GzipJob
+//    The input is cut into chunks which are compressed into
+//     independent gzip members. Concatenated they are a valid
+//     gzip file, which gzip -d and zlib both read back whole.
+//---------------------------------------------------------
+
+struct GzipJob {
+      const char* data;
+      size_t size;
+      int level;
+      std::vector<QByteArray> members;
+      std::atomic<size_t> next;
+      std::atomic<bool> failed;
+      };
+
+//---------------------------------------------------------
+//   gzipMember
+//---------------------------------------------------------
+
+static bool gzipMember(const char* data, size_t size, int level, QByteArray* out)
+      {
+      // Members are at most xmlChunkSize, zlib and the output count in int.
+      if (size > xmlChunkSize)
+            return false;
+      z_stream z;
+      memset(&z, 0, sizeof(z));
+      // 15 + 16: Maximum window, with a gzip header and trailer.
+      if (deflateInit2(&z, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+      out->resize(deflateBound(&z, size));
+      z.next_in   = (Bytef*)data;
+      z.avail_in  = size;
+      z.next_out  = (Bytef*)out->data();
+      z.avail_out = out->size();
+      const int rv = deflate(&z, Z_FINISH);
+      out->resize(z.total_out);
+      deflateEnd(&z);
+      return rv == Z_STREAM_END;
+      }
+
+//---------------------------------------------------------
+//   gzipWorker
+//---------------------------------------------------------
+
+static void* gzipWorker(void* arg)
+      {
+      GzipJob* job = (GzipJob*)arg;
+      for (;;) {
+            const size_t i = job->next++;
+            if (i >= job->members.size() || job->failed)
+                  break;
+            const size_t offset = i * xmlChunkSize;
+            size_t n = job->size - offset;
+            if (n > xmlChunkSize)
+                  n = xmlChunkSize;
+            if (!gzipMember(job->data + offset, n, job->level, &job->members[i]))
+                  job->failed = true;
+            }
+      return 0;
+      }
+
+//---------------------------------------------------------
+//   gzipCompress
+//---------------------------------------------------------
+
+static bool gzipCompress(const char* data, size_t size, int level, QByteArray* out)
+      {
+      if (level < 0)
+            level = Z_BEST_SPEED;
+      const int threads = compressionThreads(size);
+      if (size <= xmlChunkSize)
+            return gzipMember(data, size, level, out);
+
+      GzipJob job;
+      job.data   = data;
+      job.size   = size;
+      job.level  = level;
+      job.members.resize((size + xmlChunkSize - 1) / xmlChunkSize);
+      job.next   = 0;
+      job.failed = false;
+
+      // The calling thread is one of the workers.
+      std::vector<pthread_t> workers;
+      for (int i = 1; i < threads; ++i) {
+            pthread_t t;
+            if (pthread_create(&t, 0, gzipWorker, &job) == 0)
+                  workers.push_back(t);
+            }
+      gzipWorker(&job);
+      for (size_t i = 0; i < workers.size(); ++i)
+            pthread_join(workers[i], 0);
+      if (job.failed)
+            return false;
+
+      size_t total = 0;
+      for (size_t i = 0; i < job.members.size(); ++i)
+            total += job.members[i].size();
+      if (total > xmlMaxDataSize) {
+            fprintf(stderr, "Xml: compressed song is larger than %zu bytes\n", xmlMaxDataSize);
+            return false;
+            }
+      out->clear();
+      out->reserve(total);
+      for (size_t i = 0; i < job.members.size(); ++i)
+            out->append(job.members[i]);
+      return true;
+      }
+
+//---------------------------------------------------------
+//   feedInput
+//    zlib counts in unsigned int, the input is handed to
+//     it in pieces. They are contiguous, so what is left
+//     of the last piece stays in place.
+//---------------------------------------------------------
+
+static void feedInput(z_stream* z, size_t* left)
+      {
+      size_t n = UINT_MAX - z->avail_in;
+      if (n > *left)
+            n = *left;
+      z->avail_in += n;
+      *left -= n;
+      }
+
+//---------------------------------------------------------
+//   gzipDecompress
+//    The output starts at four times the input and is
+//     doubled while needed, up to xmlMaxDataSize.
+//---------------------------------------------------------
+
+static bool gzipDecompress(const char* data, size_t size, QByteArray* out)
+      {
+      z_stream z;
+      memset(&z, 0, sizeof(z));
+      // 15 + 32: Maximum window, detect the gzip or zlib header.
+      if (inflateInit2(&z, 15 + 32) != Z_OK)
+            return false;
+      size_t capacity = xmlMaxDataSize;
+      if (size < (xmlMaxDataSize - 65536) / 4)
+            capacity = size * 4 + 65536;
+      out->resize(int(capacity));
+      z.next_in  = (Bytef*)data;
+      z.avail_in = 0;
+      size_t left = size;
+      size_t written = 0;
+      bool ok = true;
+      for (;;) {
+            if (written == capacity) {
+                  if (capacity == xmlMaxDataSize) {
+                        fprintf(stderr, "Xml: decompressed input is larger than %zu bytes\n", xmlMaxDataSize);
+                        ok = false;
+                        break;
+                        }
+                  capacity = capacity <= xmlMaxDataSize / 2 ? capacity * 2 : xmlMaxDataSize;
+                  out->resize(int(capacity));
+                  }
+            feedInput(&z, &left);
+            size_t room = capacity - written;
+            if (room > UINT_MAX)
+                  room = UINT_MAX;
+            z.next_out  = (Bytef*)out->data() + written;
+            z.avail_out = room;
+            const int rv = inflate(&z, Z_NO_FLUSH);
+            written += room - z.avail_out;
+            if (rv == Z_STREAM_END) {
+                  // Further members follow, as written by gzipCompress().
+                  feedInput(&z, &left);
+                  if (z.avail_in >= 2 && z.next_in[0] == 0x1f && z.next_in[1] == 0x8b) {
+                        inflateReset(&z);
+                        continue;
+                        }
+                  break;
+                  }
+            if (rv != Z_OK && rv != Z_BUF_ERROR) {
+                  ok = false;
+                  break;
+                  }
+            // Truncated input.
+            if (z.avail_in == 0 && left == 0 && z.avail_out != 0) {
+                  ok = false;
+                  break;
+                  }
+            }
+      inflateEnd(&z);
+      out->resize(int(written));
+      return ok;
+      }
+
+//---------------------------------------------------------
+//   xmlCompress
+//---------------------------------------------------------
+
+bool xmlCompress(XmlCompression type, const char* data, size_t size, QByteArray* out, int level)
+      {
+      switch (type) {
+            case XmlGzipCompression:
+                  return gzipCompress(data, size, level, out);
+            case XmlNoCompression:
+                  break;
+            }
+      if (size > xmlMaxDataSize)
+            return false;
+      *out = QByteArray(data, size);
+      return true;
+      }
+
+//---------------------------------------------------------
+//   xmlDecompress
+//---------------------------------------------------------
+
+bool xmlDecompress(const char* data, size_t size, QByteArray* out)
+      {
+      switch (xmlDetectCompression(data, size)) {
+            case XmlGzipCompression:
+                  return gzipDecompress(data, size, out);
+            case XmlNoCompression:
+                  break;
+            }
+      *out = QByteArray(data, size);
+      return true;
+      }
+
+} // namespace MusECore
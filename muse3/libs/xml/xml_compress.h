@@ -0,0 +1,55 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  xml_compress.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __XML_COMPRESS_H__
+#define __XML_COMPRESS_H__
+
+#include <stddef.h>
+#include <limits.h>
+#include <QByteArray>
+#include <QString>
+
+namespace MusECore {
+
+// The largest data the functions handle. The size of a QByteArray is an int.
+const size_t xmlMaxDataSize = size_t(INT_MAX) - 4096;
+
+enum XmlCompression {
+      XmlNoCompression,
+      XmlGzipCompression    // *.gz
+      };
+
+// The in-process compression for a file name, by its suffix. Anything else
+//  (uncompressed or *.bz2) is XmlNoCompression.
+extern XmlCompression xmlCompressionFromName(const QString& name);
+// Compresses data into out. Large inputs are compressed on several threads.
+// level < 0 picks a fast level, saving should not keep the user waiting.
+extern bool xmlCompress(XmlCompression type, const char* data, size_t size, QByteArray* out, int level = -1);
+// The compression of data, detected by its magic number.
+extern XmlCompression xmlDetectCompression(const char* data, size_t size);
+// Decompresses gzip data, including files of several concatenated members.
+// Fails if the result would be larger than xmlMaxDataSize.
+extern bool xmlDecompress(const char* data, size_t size, QByteArray* out);
+
+} // namespace MusECore
+
+#endif
@@ -25,6 +25,9 @@
 #include <typeinfo>
 
 #include <QClipboard>
+#include <QElapsedTimer>
+#include <QStatusBar>
+#include <QFileDialog>
 #include <QMessageBox>
 #include <QShortcut>
 #include <QSignalMapper>
@@ -41,6 +44,8 @@
 #include <QToolButton>
 
 #include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
 #include <iostream>
 #include <algorithm>
 
@@ -54,6 +59,9 @@
 #include "audio.h"
 #include "audiodev.h"
 #include "audioprefetch.h"
+#include "audiograph.h"
+#include "autosave.h"
+#include "dsp_stats.h"
 #include "components/bigtime.h"
 #include "cliplist/cliplist.h"
 #include "conf.h"
@@ -81,6 +89,8 @@
 #include "mittranspose.h"
 #include "components/mixdowndialog.h"
 #include "mrconfig.h"
+#include "peakfile.h"
+#include "wavetiles.h"
 #include "pianoroll.h"
 #include "scoreedit.h"
 #include "remote/pyapi.h"
@@ -99,6 +109,7 @@
 #include "components/tools.h"
 #include "components/unusedwavefiles.h"
 #include "functions.h"
+#include "xml_compress.h"
 #include "components/songpos_toolbar.h"
 #include "components/sig_tempo_toolbar.h"
 #include "widgets/cpu_toolbar.h"
@@ -226,6 +237,11 @@ bool MusE::seqStart()
       else
         fprintf(stderr, "seqStart(): audioPrefetch is NULL\n");
 
+      // Parallel track processing workers run at the same priority as the driver's process thread.
+      if(MusEGlobal::audioGraph)
+        MusEGlobal::audioGraph->start(MusEGlobal::config.audioWorkerThreads,
+                                      MusEGlobal::realTimeScheduling ? MusEGlobal::realTimePriority : 0);
+
       if(MusEGlobal::midiSeq)
         MusEGlobal::midiSeq->start(0); // Prio unused, set in start.
 
@@ -247,6 +263,7 @@ void MusE::seqStop()
          MusEGlobal::midiSeq->stop(true);
       MusEGlobal::audio->stop(true);
       MusEGlobal::audioPrefetch->stop(true);
+      MusEGlobal::audioGraph->stop();
       if (MusEGlobal::realTimeScheduling && watchdogThread)
             pthread_cancel(watchdogThread);
       }
@@ -575,6 +592,8 @@ MusE::MusE() : QMainWindow()
       audioBounce2TrackAction = new QAction(QIcon(*MusEGui::audio_bounce_to_trackIcon), tr("Bounce to Track"), this);
       audioBounce2FileAction = new QAction(QIcon(*MusEGui::audio_bounce_to_fileIcon), tr("Bounce to File"), this);
       audioRestartAction = new QAction(QIcon(*MusEGui::audio_restartaudioIcon), tr("Restart Audio"), this);
+      audioDspStatsAction = new QAction(tr("Save DSP Time Statistics..."), this);
+      audioDspStatsResetAction = new QAction(tr("Reset DSP Time Statistics"), this);
 
       //-------- Automation Actions
       autoMixerAction = new QAction(QIcon(*MusEGui::automation_mixerIcon), tr("Mixer Automation"), this);
@@ -678,6 +697,8 @@ MusE::MusE() : QMainWindow()
       connect(audioBounce2TrackAction, SIGNAL(triggered()), SLOT(bounceToTrack()));
       connect(audioBounce2FileAction, SIGNAL(triggered()), SLOT(bounceToFile()));
       connect(audioRestartAction, SIGNAL(triggered()), SLOT(seqRestart()));
+      connect(audioDspStatsAction, SIGNAL(triggered()), SLOT(saveDspTimeStats()));
+      connect(audioDspStatsResetAction, SIGNAL(triggered()), SLOT(resetDspTimeStats()));
 
       //-------- Automation connections
       connect(autoMixerAction, SIGNAL(triggered()), SLOT(switchMixerAutomation()));
@@ -745,6 +766,8 @@ MusE::MusE() : QMainWindow()
 
       // Already has an object name.
       cpuLoadToolbar = new CpuToolbar(tr("Cpu load"), this);
+      _lastPeakFileProgress = 0;
+      _lastWaveTileProgress = 0;
       addToolBar(cpuLoadToolbar);
       connect(cpuLoadToolbar, SIGNAL(resetClicked()), SLOT(resetXrunsCounter()));
 
@@ -891,6 +914,8 @@ MusE::MusE() : QMainWindow()
       menu_audio->addAction(audioBounce2FileAction);
       menu_audio->addSeparator();
       menu_audio->addAction(audioRestartAction);
+      menu_audio->addAction(audioDspStatsAction);
+      menu_audio->addAction(audioDspStatsResetAction);
       menu_audio->addSeparator();
       menu_audio->addAction(autoMixerAction);
       //menu_audio->addSeparator();
@@ -1038,6 +1063,26 @@ void MusE::heartBeat()
   cpuLoadToolbar->setValues(MusEGlobal::song->cpuLoad(), 
                             MusEGlobal::song->dspLoad(), 
                             MusEGlobal::song->xRunsCount());
+
+  // Poll each track's prefetch fifo fill, as seen by the prefetch thread since the last beat.
+  QList<QPair<QString, int> > disk_fills;
+  MusECore::WaveTrackList* wtl = MusEGlobal::song->waves();
+  for(MusECore::iWaveTrack iwt = wtl->begin(); iwt != wtl->end(); ++iwt)
+    disk_fills.append(qMakePair((*iwt)->name(), (*iwt)->takePrefetchLowWater()));
+  cpuLoadToolbar->setDiskFill(disk_fills);
+
+  autoSaveFinished();
+
+  // Redraw the waves while their peak files are being built in the background,
+  //  and when the tiles they are drawn from have been rendered.
+  const unsigned peak_progress = MusECore::peakFileProgress();
+  const unsigned tile_progress = MusECore::waveTileProgress();
+  if(peak_progress != _lastPeakFileProgress || tile_progress != _lastWaveTileProgress)
+  {
+    _lastPeakFileProgress = peak_progress;
+    _lastWaveTileProgress = tile_progress;
+    MusEGlobal::song->update(SC_CLIP_MODIFIED);
+  }
 }
 
 void MusE::populateAddTrack()
@@ -1289,8 +1334,13 @@ void MusE::loadProjectFile1(const QString& name, bool songTemplate, bool doReadM
             //
             //  read *.med file
             //
-            bool popenFlag;
-            FILE* f = MusEGui::fileOpen(this, fi.filePath(), QString(".med"), "r", popenFlag, true);
+            bool popenFlag = false;
+            FILE* f;
+            // gzip projects are decompressed by the Xml reader itself.
+            if (MusECore::xmlCompressionFromName(fi.filePath()) != MusECore::XmlNoCompression)
+                  f = fopen(QFile::encodeName(fi.filePath()).constData(), "r");
+            else
+                  f = MusEGui::fileOpen(this, fi.filePath(), QString(".med"), "r", popenFlag, true);
             if (f == 0) {
                   if (errno != ENOENT) {
                         QMessageBox::critical(this, QString("MusE"),
@@ -1521,12 +1571,60 @@ bool MusE::save()
             return save(project.filePath(), false, writeTopwinState);
       }
 
+//---------------------------------------------------------
+//   writeCompressedProject
+//    Compresses a serialized project and writes it to a
+//     temporary file next to name, which then replaces name.
+//    If anything fails, name is left as it was.
+//---------------------------------------------------------
+
+static bool writeCompressedProject(const QString& name, MusECore::XmlCompression compression,
+   const char* data, size_t size, QString* error)
+      {
+      QElapsedTimer timer;
+      timer.start();
+      QByteArray packed;
+      if (!MusECore::xmlCompress(compression, data, size, &packed)) {
+            *error = QString("compression failed");
+            return false;
+            }
+      const QByteArray path = QFile::encodeName(name);
+      const QByteArray tmp  = path + ".tmp";
+      FILE* f = fopen(tmp.constData(), "w");
+      if (f == 0) {
+            *error = QString(strerror(errno));
+            return false;
+            }
+      bool ok = fwrite(packed.constData(), 1, packed.size(), f) == (size_t)packed.size() &&
+                fflush(f) == 0 && fsync(fileno(f)) == 0;
+      if (!ok)
+            *error = QString(strerror(errno));
+      if (fclose(f) != 0 && ok) {
+            ok = false;
+            *error = QString(strerror(errno));
+            }
+      if (ok && rename(tmp.constData(), path.constData()) != 0) {
+            ok = false;
+            *error = QString(strerror(errno));
+            }
+      if (!ok)
+            unlink(tmp.constData());
+      if (ok && MusEGlobal::debugMsg)
+            fprintf(stderr, "Saved %s: %zu bytes compressed to %d in %lld ms\n",
+               name.toLocal8Bit().constData(), size, packed.size(), (long long)timer.elapsed());
+      return ok;
+      }
+
 //---------------------------------------------------------
 //   save
 //---------------------------------------------------------
 
 bool MusE::save(const QString& name, bool overwriteWarn, bool writeTopwins)
       {
+      // Do not race a background autosave of the same file. Its result is taken
+      //  here, so that a failed one does not mark the song dirty after this save.
+      autoSaveFinished(true);
+
 //       QString backupCommand;
 
       QFile currentName(name);
@@ -1542,28 +1640,52 @@ bool MusE::save(const QString& name, bool overwriteWarn, bool writeTopwins)
 //      if (!backupCommand.isEmpty())
 //            system(backupCommand.toLatin1().constData());
 
-      bool popenFlag;
-      FILE* f = MusEGui::fileOpen(this, name, QString(".med"), "w", popenFlag, false, overwriteWarn);
+      // gzip projects are serialized into memory and compressed in-process.
+      const MusECore::XmlCompression compression = MusECore::xmlCompressionFromName(name);
+      bool popenFlag = false;
+      char* memData = 0;
+      size_t memSize = 0;
+      FILE* f;
+      if (compression != MusECore::XmlNoCompression) {
+            if (overwriteWarn && QFile::exists(name) &&
+                QMessageBox::warning(this, tr("MusE: write"), tr("File\n%1\nexists. Overwrite?").arg(name),
+                   QMessageBox::Save | QMessageBox::Cancel, QMessageBox::Save) != QMessageBox::Save)
+                  return false;
+            f = open_memstream(&memData, &memSize);
+            }
+      else
+            f = MusEGui::fileOpen(this, name, QString(".med"), "w", popenFlag, false, overwriteWarn);
       if (f == 0)
             return false;
       MusECore::Xml xml(f);
       write(xml, writeTopwins);
-      if (ferror(f)) {
-            QString s = "Write File\n" + name + "\nfailed: "
-               + QString(strerror(errno));
+      bool ok = !ferror(f);
+      QString error;
+      if (!ok)
+            error = QString(strerror(errno));
+      if (compression != MusECore::XmlNoCompression) {
+            // Closing the stream finalizes memData and memSize.
+            fclose(f);
+            if (ok)
+                  ok = writeCompressedProject(name, compression, memData, memSize, &error);
+            free(memData);
+            }
+      else
+            popenFlag? pclose(f) : fclose(f);
+      if (!ok) {
+            QString s = "Write File\n" + name + "\nfailed: " + error;
             QMessageBox::critical(this,
                tr("MusE: Write File failed"), s);
-            popenFlag? pclose(f) : fclose(f);
-            unlink(name.toLatin1().constData());
+            // fileOpen() truncated the file, do not leave a partial project behind.
+            // A compressed project was never touched, only its temporary file.
+            if (compression == MusECore::XmlNoCompression)
+                  unlink(name.toLatin1().constData());
             return false;
             }
-      else {
-            popenFlag? pclose(f) : fclose(f);
-            MusEGlobal::song->dirty = false;
-            setWindowTitle(projectTitle(project.absoluteFilePath()));
-            saveIncrement = 0;
-            return true;
-            }
+      MusEGlobal::song->dirty = false;
+      setWindowTitle(projectTitle(project.absoluteFilePath()));
+      saveIncrement = 0;
+      return true;
       }
 
 //---------------------------------------------------------
@@ -1589,6 +1711,8 @@ void MusE::closeEvent(QCloseEvent* event)
       while (MusEGlobal::audio->isPlaying()) {
             qApp->processEvents();
             }
+      // A failed autosave marks the song dirty again, so ask about it.
+      autoSaveFinished(true);
       if (MusEGlobal::song->dirty) {
             int n = 0;
             n = QMessageBox::warning(this, appName,
@@ -1660,6 +1784,18 @@ void MusE::closeEvent(QCloseEvent* event)
         fprintf(stderr, "Muse: Exiting ALSA midi\n");
       MusECore::exitMidiAlsa();
 
+      if(MusEGlobal::debugMsg)
+        fprintf(stderr, "Muse: Finishing autosave\n");
+      MusECore::exitAutoSaver();
+
+      if(MusEGlobal::debugMsg)
+        fprintf(stderr, "Muse: Exiting peak file builder\n");
+      MusECore::exitPeakFileBuilder();
+
+      if(MusEGlobal::debugMsg)
+        fprintf(stderr, "Muse: Exiting wave tile renderer\n");
+      MusECore::exitWaveTileRenderer();
+
       if(MusEGlobal::debugMsg)
         fprintf(stderr, "Muse: Cleaning up temporary wavefiles + peakfiles\n");
       // Cleanup temporary wavefiles + peakfiles used for undo
@@ -1668,7 +1804,7 @@ void MusE::closeEvent(QCloseEvent* event)
             QFileInfo f(filename);
             QDir d = f.dir();
             d.remove(filename);
-            d.remove(f.completeBaseName() + ".wca");
+            QFile::remove(MusECore::peakFilePath(filename));
             }
 
 #ifdef HAVE_LASH
@@ -1691,6 +1827,7 @@ void MusE::closeEvent(QCloseEvent* event)
       MusECore::exitOSC();
 
       delete MusEGlobal::audioPrefetch;
+      delete MusEGlobal::audioGraph;
       delete MusEGlobal::audio;
 
       // Destroy the sequencer object if it exists.
@@ -2825,6 +2962,35 @@ void MusE::bounceToTrack()
       MusEGlobal::song->setPlay(true);
       }
 
+//---------------------------------------------------------
+//   saveDspTimeStats
+//    Write the per track, plugin and synth dsp times of the
+//     last process cycles as CSV, for offline analysis.
+//---------------------------------------------------------
+
+void MusE::saveDspTimeStats()
+      {
+      QString fn = QFileDialog::getSaveFileName(this, tr("MusE: Save DSP Time Statistics"),
+         QString("dsptimes.csv"), tr("CSV Files (*.csv);;All Files (*)"));
+      if (fn.isEmpty())
+            return;
+      if (!MusECore::dumpDspTimeStats(fn))
+            QMessageBox::critical(this, tr("MusE: Save DSP Time Statistics"),
+               tr("Cannot write file:\n%1").arg(fn));
+      }
+
+//---------------------------------------------------------
+//   resetDspTimeStats
+//    Start the dsp time statistics over, say after changing
+//     plugin settings, so that the mixer strips and the saved
+//     statistics only show the cycles since then.
+//---------------------------------------------------------
+
+void MusE::resetDspTimeStats()
+      {
+      MusECore::clearDspTimeStats();
+      }
+
 //---------------------------------------------------------
 //   bounceToFile
 //---------------------------------------------------------
@@ -2985,6 +3151,8 @@ MusE::lash_idle_cb ()
 
 bool MusE::clearSong(bool clear_all)
       {
+      // A failed autosave marks the song dirty again, so ask about it.
+      autoSaveFinished(true);
       if (MusEGlobal::song->dirty) {
             int n = 0;
             n = QMessageBox::warning(this, appName,
@@ -4005,15 +4173,84 @@ void MusE::saveTimerSlot()
     saveIncrement++;
     if (saveIncrement > 4) {
         // printf("five minutes passed %d %d\n", MusEGlobal::config.autoSave, MusEGlobal::song->dirty);
-        // time to see if we are allowed to save, if so. Do
-        if (MusEGlobal::audio->isPlaying() == false) {
-            fprintf(stderr, "Performing autosave\n");
-            save(project.filePath(), false, writeTopwinState);
-        } else
-        {
-            //printf("isPlaying, can't save\n");
+        // Try again next time if the previous one is still being written.
+        if (MusECore::autoSaveBusy())
+            return;
+
+        // Take the snapshot here in the gui thread, which is the only one changing the song,
+        //  into memory. Writing it out is left to the background, so this works while playing.
+        // The midi events, the bulk of most songs, are only copied here. Their data is shared
+        //  and not changed in place, so the background thread serializes them into the snapshot.
+        // The rest of write() reads the song, the gui and the configuration, which may change
+        //  right after, so it still runs here. That time is reported as the snapshot time.
+        QElapsedTimer timer;
+        timer.start();
+        char* data = 0;
+        size_t size = 0;
+        FILE* f = open_memstream(&data, &size);
+        if (f == 0) {
+            fprintf(stderr, "MusE: autosave: cannot open memory stream: %s\n", strerror(errno));
+            return;
+        }
+        MusECore::Xml xml(f);
+        MusECore::beginAutoSaveSnapshot(f);
+        write(xml, writeTopwinState);
+        MusECore::AutoSaveEventList* events = MusECore::endAutoSaveSnapshot();
+        const bool err = ferror(f);
+        fclose(f);
+        if (err) {
+            fprintf(stderr, "MusE: autosave: cannot serialize song\n");
+            free(data);
+            delete events;
+            return;
+        }
+
+        QString name = project.filePath();
+        if (QFileInfo(name).completeSuffix().isEmpty())
+            name += QString(".med");
+        if (MusECore::autoSaveSnapshot(name, data, size, events,
+                                       MusEGlobal::config.autoSaveBackups, timer.elapsed())) {
+            // The snapshot has everything up to now, changes made while it is written set
+            //  the flag again. If writing fails, autoSaveFinished() sets it again, and it is
+            //  called with wait before anything asks whether to save the song.
+            MusEGlobal::song->dirty = false;
+            setWindowTitle(projectTitle(project.absoluteFilePath()));
+            saveIncrement = 0;
         }
     }
 }
 
+//---------------------------------------------------------
+//   autoSaveFinished
+//    Report a finished background autosave, in the status
+//     bar and on the console. A failed one marks the song
+//     dirty again.
+//    wait: Wait for a save in progress first. Call so before
+//     deciding whether the song needs saving.
+//---------------------------------------------------------
+
+void MusE::autoSaveFinished(bool wait)
+{
+    if (wait)
+        MusECore::waitAutoSave();
+    MusECore::AutoSaveResult r;
+    if (!MusECore::takeAutoSaveResult(&r))
+        return;
+    if (r.ok) {
+        fprintf(stderr, "MusE: Autosaved %s: %zu bytes, snapshot %lld ms, write %lld ms"
+            " (%zu midi events serialized in the background)\n",
+            r.path.toLocal8Bit().constData(), r.bytes, r.snapshotMs, r.writeMs, r.events);
+        statusBar()->showMessage(tr("Autosaved %1: %2 KiB, snapshot %3 ms, write %4 ms")
+            .arg(QFileInfo(r.path).fileName()).arg((r.bytes + 1023) / 1024)
+            .arg(r.snapshotMs).arg(r.writeMs), 10000);
+    }
+    else {
+        fprintf(stderr, "MusE: Autosave of %s failed: %s\n",
+            r.path.toLocal8Bit().constData(), r.error.toLocal8Bit().constData());
+        statusBar()->showMessage(tr("Autosave of %1 failed: %2")
+            .arg(QFileInfo(r.path).fileName()).arg(r.error));
+        setDirty();
+    }
+}
+
 } //namespace MusEGui
@@ -151,7 +151,7 @@ class MusE : public QMainWindow
 #endif
 
       // Audio Menu Actions
-      QAction *audioBounce2TrackAction, *audioBounce2FileAction, *audioRestartAction;
+      QAction *audioBounce2TrackAction, *audioBounce2FileAction, *audioRestartAction, *audioDspStatsAction, *audioDspStatsResetAction;
 
       // Automation Menu Actions
       QAction *autoMixerAction, *autoSnapshotAction, *autoClearAction;
@@ -175,6 +175,9 @@ class MusE : public QMainWindow
       QFileInfo project;
       QToolBar *tools;
       CpuToolbar* cpuLoadToolbar;
+      // Last seen progress of the background peak file builder and wave tile renderer.
+      unsigned _lastPeakFileProgress;
+      unsigned _lastWaveTileProgress;
 
       // when adding a toolbar to the main window, remember adding it to
       // either the requiredToolbars or optionalToolbars list!
@@ -255,6 +258,7 @@ class MusE : public QMainWindow
       QTimer *blinkTimer;
       QTimer *messagePollTimer;
       int saveIncrement;
+      void autoSaveFinished(bool wait = false);
 
    signals:
       void configChanged();
@@ -280,6 +284,8 @@ class MusE : public QMainWindow
       void importPart();
       void exportMidi();
       void findUnusedWaveFiles();
+      void saveDspTimeStats();
+      void resetDspTimeStats();
 
       void toggleTransport(bool);
       void toggleMarker(bool);
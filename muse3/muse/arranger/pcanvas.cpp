@@ -31,6 +31,9 @@
 #include <errno.h>
 #include <limits.h>
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
 #include <assert.h>
 
 #include <QClipboard>
@@ -55,6 +58,7 @@
 #include "icons.h"
 #include "event.h"
 #include "wave.h"
+#include "wavetiles.h"
 #include "audio.h"
 #include "shortcuts.h"
 #include "gconfig.h"
@@ -1028,6 +1032,7 @@ bool PartCanvas::mousePress(QMouseEvent* event)
                       NPart* np = (NPart*) item;
                       MusECore::Part*  p = np->part();
                       p->setMute(!p->mute());
+                      MusECore::MidiCtrlValList::invalidateAllChase();
                       redraw();
                       break;
                       }
@@ -2270,7 +2275,6 @@ void PartCanvas::drawMidiPart(QPainter& p, const QRect&, const MusECore::EventLi
 
 void PartCanvas::drawWaveSndFile(QPainter &p, MusECore::SndFileR &f, int samplePos, unsigned rootFrame, unsigned startFrame, unsigned lengthFrames, int startY, int startX, int endX, int rectHeight)
 {
-   int h = rectHeight >> 1;
    int x1 = startX;
    int x2 = endX;
    if (f.isNull())
@@ -2307,70 +2311,110 @@ void PartCanvas::drawWaveSndFile(QPainter &p, MusECore::SndFileR &f, int sampleP
    int ex = mapx(MusEGlobal::tempomap.frame2tick(rootFrame + startFrame + lengthFrames));
    if(ex > x2)
      ex = x2;
-   if (h < 20) {
-         //    combine multi channels into one waveform
-         int y = startY + h;
-         int cc = rectHeight % 2 ? 0 : 1;
-         for (; i < ex; i++) {
-               MusECore::SampleV sa[channels];
-               xScale = MusEGlobal::tempomap.deltaTick2frame(postick, postick + tickstep);
-               f.read(sa, xScale, pos, true, false);
-               postick += tickstep;
-               pos += xScale;
-               int peak = 0;
-               int rms  = 0;
-               for (unsigned k = 0; k < channels; ++k) {
-                     if (sa[k].peak > peak)
-                           peak = sa[k].peak;
-                     rms += sa[k].rms;
-                     }
-               rms /= channels;
-               peak = (peak * (rectHeight-2)) >> 9;
-               rms  = (rms  * (rectHeight-2)) >> 9;
-               int outer = peak;
-               int inner = peak -1; //-1 < 0 ? 0 : peak -1;
-               pen.setColor(MusEGlobal::config.partWaveColorPeak);
-               p.setPen(pen);
-               p.drawLine(i, y - outer - cc, i, y + outer);
-               pen.setColor(MusEGlobal::config.partWaveColorRms);
+
+   // Small heights combine multi channels into one waveform.
+   MusECore::WaveTileStyle style;
+   style.mode      = (rectHeight >> 1) < 20 ? MusECore::WaveTileStyle::Combined : MusECore::WaveTileStyle::Channels;
+   style.height    = rectHeight;
+   style.yScale    = 0;
+   style.peakColor = qPremultiply(MusEGlobal::config.partWaveColorPeak.rgba());
+   style.rmsColor  = qPremultiply(MusEGlobal::config.partWaveColorRms.rgba());
+   style.drawRms   = MusEGlobal::config.waveDrawing == MusEGlobal::WaveRmsPeak;
+
+   if (i < ex && drawWaveTiles(p, f, samplePos, rootFrame, startFrame, startY, i, ex, style))
+         return;
+
+   MusECore::SampleV sa[channels];
+   MusECore::WaveColumnLine lines[2 * channels];
+   for (; i < ex; i++) {
+         xScale = MusEGlobal::tempomap.deltaTick2frame(postick, postick + tickstep);
+         f.read(sa, xScale, pos, true, false);
+         postick += tickstep;
+         pos += xScale;
+         const int n = MusECore::waveColumnLines(sa, channels, style, lines);
+         for (int k = 0; k < n; ++k) {
+               pen.setColor(lines[k].inner ? MusEGlobal::config.partWaveColorRms : MusEGlobal::config.partWaveColorPeak);
                p.setPen(pen);
-               if (MusEGlobal::config.waveDrawing == MusEGlobal::WaveRmsPeak)
-                 p.drawLine(i, y - rms - cc, i, y + rms);
-               else // WaveOutLine
-                 p.drawLine(i, y - inner - cc, i, y + inner);
+               p.drawLine(i, startY + lines[k].y1, i, startY + lines[k].y2);
                }
          }
-   else {
-         //  multi channel display
-         int hm = rectHeight / (channels * 2);
-         int cc = rectHeight % (channels * 2) ? 0 : 1;
-         for (; i < ex; i++) {
-               int y  = startY + hm;
-               MusECore::SampleV sa[channels];
-               xScale = MusEGlobal::tempomap.deltaTick2frame(postick, postick + tickstep);
-               f.read(sa, xScale, pos, true, false);
-               postick += tickstep;
-               pos += xScale;
-               for (unsigned k = 0; k < channels; ++k) {
-                     int peak = (sa[k].peak * (hm - 1)) >> 8;
-                     int rms  = (sa[k].rms  * (hm - 1)) >> 8;
-                     int outer = peak;
-                     int inner = peak -1; //-1 < 0 ? 0 : peak -1;
-                     pen.setColor(MusEGlobal::config.partWaveColorPeak);
-                     p.setPen(pen);
-                     p.drawLine(i, y - outer - cc , i, y + outer);
-                     pen.setColor(MusEGlobal::config.partWaveColorRms);
-                     p.setPen(pen);
-                     if (MusEGlobal::config.waveDrawing == MusEGlobal::WaveRmsPeak)
-                       p.drawLine(i, y - rms - cc, i, y + rms);
-                     else // WaveOutLine
-                       p.drawLine(i, y - inner - cc, i, y + inner);
-
-                     y  += 2 * hm;
-                     }
-               }
+}
+
+//---------------------------------------------------------
+//   drawWaveTiles
+//    Draws the columns startX to endX of a wave event from
+//     pre-rendered tiles. Returns false if they are not all
+//     rendered yet, the missing ones are queued then.
+//    The tempo is constant between tempo changes, so each
+//     such segment is drawn from its own tiles, rendered
+//     at the segment's frames per pixel and placed by its
+//     linear frame to pixel mapping. A tile crossing a
+//     tempo change is clipped to the segment.
+//---------------------------------------------------------
+
+bool PartCanvas::drawWaveTiles(QPainter& p, MusECore::SndFileR& f, int samplePos, unsigned rootFrame, unsigned startFrame, int startY, int startX, int endX, const MusECore::WaveTileStyle& style)
+{
+   struct Segment {
+         int x1, x2;
+         int mag;
+         int64_t first, last;
+         double x0;                // pixel of sound file frame 0
+         double pixelsPerFrame;
+         std::vector<QImage> tiles;
+         };
+
+   const MusECore::TempoList& tl = MusEGlobal::tempomap;
+   // Absolute frame minus sound file frame.
+   const int64_t offset = int64_t(rootFrame) + startFrame - samplePos;
+   const int xm = getXScale();
+   const double pixelsPerTick = xm < 0 ? 1.0 / -xm : double(xm);
+   const double mapx0 = mapx(0);
+   const double framesPerTempo = double(MusEGlobal::sampleRate) /
+      (double(MusEGlobal::config.division) * tl.globalTempo() * 10000.0);
+
+   std::vector<Segment> segs;
+   for (int x = startX; x < endX; ) {
+         unsigned segTick, segEnd;
+         tl.tempoSegment(mapxDev(x), &segTick, &segEnd);
+         Segment s;
+         s.x1 = x;
+         s.x2 = segEnd > MAX_TICK ? endX : std::min(endX, mapx(segEnd));
+         if (s.x2 <= s.x1)
+               s.x2 = s.x1 + 1;
+         x = s.x2;
+
+         const double framesPerTick = tl.tempo(segTick) * framesPerTempo;
+         s.pixelsPerFrame = pixelsPerTick / framesPerTick;
+         s.mag = int(1.0 / s.pixelsPerFrame + 0.5);
+         if (!MusECore::waveTilesUsable(f, s.mag))
+               return false;
+         // Sound file frame f is at tick segTick + (f + offset - segFrame) / framesPerTick.
+         const double segFrame = tl.tick2frame(segTick);
+         s.x0 = mapx0 + (segTick + (offset - segFrame) / framesPerTick) * pixelsPerTick;
+
+         const int64_t tileFrames = int64_t(MusECore::waveTileWidth) * s.mag;
+         const int64_t frame1 = std::max(int64_t(0), int64_t((s.x1 - s.x0) / s.pixelsPerFrame));
+         const int64_t frame2 = std::max(frame1, int64_t((s.x2 - s.x0) / s.pixelsPerFrame));
+         s.first = frame1 / tileFrames;
+         s.last  = frame2 / tileFrames;
+         if (!MusECore::waveTiles(f.peakFile(), s.mag, s.first, s.last, style, s.tiles))
+               return false;
+         segs.push_back(s);
          }
 
+   for (std::vector<Segment>::const_iterator s = segs.begin(); s != segs.end(); ++s) {
+         const double tilePixels = MusECore::waveTileWidth * s->mag * s->pixelsPerFrame;
+         p.save();
+         p.setClipRect(QRect(s->x1, startY, s->x2 - s->x1, style.height), Qt::IntersectClip);
+         for (int64_t t = s->first; t <= s->last; ++t) {
+               const double x1 = s->x0 + t * tilePixels;
+               const int ix1 = int(floor(x1 + 0.5));
+               const int ix2 = int(floor(x1 + tilePixels + 0.5));
+               p.drawImage(QRect(ix1, startY, ix2 - ix1, style.height), s->tiles[t - s->first]);
+               }
+         p.restore();
+         }
+   return true;
 }
 
 //---------------------------------------------------------
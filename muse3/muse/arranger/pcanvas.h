@@ -43,6 +43,7 @@ class QMenu;
 
 namespace MusECore {
 struct CtrlVal;
+struct WaveTileStyle;
 class Xml;
 class Undo;
 class Part;
@@ -177,6 +178,8 @@ class PartCanvas : public Canvas {
                              std::set<MusECore::Track*>* affected_tracks = NULL);
       void drawWaveSndFile(QPainter &p, MusECore::SndFileR &f, int samplePos, unsigned rootFrame,
                            unsigned startFrame, unsigned lengthFrames, int startY, int startX, int endX, int rectHeight);
+      bool drawWaveTiles(QPainter &p, MusECore::SndFileR &f, int samplePos, unsigned rootFrame,
+                         unsigned startFrame, int startY, int startX, int endX, const MusECore::WaveTileStyle& style);
       void drawWavePart(QPainter&, const QRect&, MusECore::WavePart*, const QRect&);
       void drawMidiPart(QPainter&, const QRect& rect, const MusECore::EventList& events,
                         MusECore::MidiTrack* mt, MusECore::MidiPart* midipart,
@@ -72,6 +72,7 @@
 #include "ctrl.h"
 #include "plugin.h"
 #include "operations.h"
+#include "freeze.h"
 
 
 #ifdef DSSI_SUPPORT
@@ -1994,6 +1995,24 @@ void TList::mousePressEvent(QMouseEvent* ev)
                           // 1016 is occupied.
                           p->addSeparator();
                         }
+
+                        if (!t->isMidiTrack() && static_cast<MusECore::AudioTrack*>(t)->canFreeze())
+                        {
+                          MusECore::AudioTrack* at = static_cast<MusECore::AudioTrack*>(t);
+                          QAction* tmp;
+                          if (at->frozen())
+                          {
+                            tmp=p->addAction(tr("Unfreeze track"));
+                            tmp->setData(1018);
+                          }
+                          else
+                          {
+                            tmp=p->addAction(tr("Freeze track"));
+                            tmp->setData(1017);
+                            tmp->setEnabled(!at->off() && !MusEGlobal::audio->isPlaying());
+                          }
+                          p->addSeparator();
+                        }
                         addTrackMenu->setTitle(tr("Insert Track"));
                         addTrackMenu->setIcon(QIcon(*edit_track_addIcon));
                         p->addMenu(addTrackMenu);
@@ -2058,6 +2077,16 @@ void TList::mousePressEvent(QMouseEvent* ev)
                                     case 1014:
                                       copyTrackDrummap((MusECore::MidiTrack*)t, true);
                                       break;
+
+                                    case 1017:
+                                      if (MusECore::freezeTrack(static_cast<MusECore::AudioTrack*>(t)))
+                                        QMessageBox::warning(this, tr("Freeze track"),
+                                          tr("Could not freeze the track. See the console for details."));
+                                      break;
+
+                                    case 1018:
+                                      MusECore::unfreezeTrack(static_cast<MusECore::AudioTrack*>(t));
+                                      break;
                                     
                                     default:
                                           printf("action %d\n", n);
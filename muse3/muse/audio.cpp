@@ -36,6 +36,8 @@
 #include "alsamidi.h"
 #include "synth.h"
 #include "audioprefetch.h"
+#include "audiograph.h"
+#include "offlinerender.h"
 #include "plugin.h"
 #include "audio.h"
 #include "wave.h"
@@ -116,6 +118,8 @@ const char* seqMsgList[] = {
       "AUDIO_ADD_AC_EVENT",
       "AUDIO_CHANGE_AC_EVENT",
       "AUDIO_SET_SEND_METRONOME", 
+      "AUDIO_SET_FREEZE",
+      "AUDIO_SET_FREEZE_CAPTURE",
       "AUDIO_START_MIDI_LEARN",
       "MS_PROCESS", "MS_STOP", "MS_SET_RTC", "MS_UPDATE_POLL_FD",
       "SEQM_IDLE", "SEQM_SEEK",
@@ -132,8 +136,12 @@ const char* audioStates[] = {
 //---------------------------------------------------------
 
 const int Audio::_extClockHistoryCapacity = 8192;
+const unsigned Audio::asyncMsgCapacity = 1024;
+const unsigned Audio::asyncMsgsPerCycle = 64;
+const int Audio::asyncMsgDoneSerial = -2;
       
 Audio::Audio()
+   : _asyncMsgs(asyncMsgCapacity), _asyncMsgsDone(asyncMsgCapacity)
       {
       _running      = false;
       recording     = false;
@@ -174,6 +182,10 @@ Audio::Audio()
 
       state         = STOP;
       msg           = 0;
+      _asyncMsgsSignalled = false;
+      _asyncMsgsInFlight  = 0;
+      _msgBatchLevel      = 0;
+      _msgBatch           = 0;
 
       startRecordPos.setType(Pos::FRAMES);  // Tim
       endRecordPos.setType(Pos::FRAMES);
@@ -609,7 +621,9 @@ void Audio::process(unsigned frames)
       {
       _curCycleFrames = frames;
       if (!MusEGlobal::checkAudioDevice()) return;
-      if (msg) {
+      // The posted messages first, the gui posted them before any waiting one.
+      //  A waiting message has to wait for the cycle which finishes them.
+      if (processAsyncMsgs() && msg) {
             processMsg(msg);
             int sn = msg->serialNo;
             msg    = 0;    // don't process again
@@ -835,6 +849,9 @@ void Audio::process(unsigned frames)
       process1(samplePos, offset, frames);
       for (iAudioOutput i = ol->begin(); i != ol->end(); ++i)
             (*i)->processWrite();
+      // Command line render: write the stems.
+      if (_bounce && isPlaying() && MusEGlobal::offlineRender)
+            MusEGlobal::offlineRender->processWrite(frames);
       
 #ifdef _AUDIO_USE_TRUE_FRAME_
       _previousPos = _pos;
@@ -887,11 +904,27 @@ void Audio::process1(unsigned samplePos, unsigned offset, unsigned frames)
         //  audio processing, because THAT is done at the very end of this routine.
         // This will also reset the track's processed flag.         Tim.
         track->preProcessAlways();
+        track->invalidateLatency();
       }
       
       // Pre-process the metronome.
       ((AudioTrack*)metronome)->preProcessAlways();
       
+      // Update the accumulated route latencies, for plugin delay compensation.
+      // Cheap enough to do every cycle, so plugins being inserted, bypassed,
+      //  or changing their reported latency are picked up right away.
+      for(ciTrack it = tl->begin(); it != tl->end(); ++it)
+      {
+        if((*it)->isMidiTrack())
+          continue;
+        ((AudioTrack*)(*it))->updateLatency();
+      }
+      
+      // If enabled, process all tracks which do not depend on Aux tracks in parallel,
+      //  in dependency order. They cache their data, which the Aux and Output
+      //  join points below will simply pull as usual.
+      MusEGlobal::audioGraph->process(samplePos, frames);
+
       // Process Aux tracks first.
       for(ciTrack it = tl->begin(); it != tl->end(); ++it)
       {
@@ -998,6 +1031,14 @@ void Audio::processMsg(AudioMsg* msg)
             case AUDIO_SET_SEND_METRONOME:
                   msg->snode->setSendMetronome((bool)msg->ival);
                   break;
+            case AUDIO_SET_FREEZE:
+                  msg->snode->setFreezeFile(*(const SndFileR*)msg->p1);
+                  // Refill the fifo from the new source.
+                  MusEGlobal::audioPrefetch->msgSeek(_pos.frame(), true);
+                  break;
+            case AUDIO_SET_FREEZE_CAPTURE:
+                  msg->snode->setFreezeCapture(*(const SndFileR*)msg->p1);
+                  break;
             
             case AUDIO_START_MIDI_LEARN:
                   // Reset the values. The engine will fill these from driver events.
@@ -1068,6 +1109,62 @@ void Audio::processMsg(AudioMsg* msg)
                   MusEGlobal::song->processMsg(msg);
                   break;
             }
+
+      // Any of these may change tracks or routes. Stop using the graph until the gui thread
+      //  has rebuilt it. Leaving idle counts too, the song may be changed directly while idle.
+      switch(msg->id) {
+            case SEQM_REVERT_OPERATION_GROUP:
+            case SEQM_EXECUTE_OPERATION_GROUP:
+            case SEQM_EXECUTE_PENDING_OPERATIONS:
+            case SEQM_IDLE:
+            case AUDIO_ROUTEADD:
+            case AUDIO_ROUTEREMOVE:
+            case AUDIO_REMOVEROUTES:
+            case AUDIO_SET_CHANNELS:
+                  MusEGlobal::audioGraph->setDirty();
+                  break;
+            default:
+                  break;
+            }
+      }
+
+//---------------------------------------------------------
+//   processAsyncMsgs
+//    Executes the posted messages and hands them back to
+//     the gui thread, which frees them. Unless all is set,
+//     stops after asyncMsgsPerCycle messages, a batch is
+//     always finished. Returns whether none are left.
+//    Called from audio thread, or from the gui thread
+//     while audio is not running.
+//---------------------------------------------------------
+
+bool Audio::processAsyncMsgs(bool all)
+      {
+      bool any = false;
+      unsigned done = 0;
+      AsyncAudioMsg* am;
+      while ((all || done < asyncMsgsPerCycle) && _asyncMsgs.get(am)) {
+            if (!am->superseded.load()) {
+                  for (std::vector<AudioMsg>::iterator i = am->msgs.begin(); i != am->msgs.end(); ++i)
+                        processMsg(&*i);
+                  am->executed = true;
+                  done += am->msgs.size();
+                  }
+            // The gui may free it once it is handed back.
+            const bool wake = am->wakeSender;
+            // Cannot overflow, see postAsyncMsg().
+            _asyncMsgsDone.put(am);
+            any = true;
+            if (wake) {
+                  int rv = write(fromThreadFdw, &asyncMsgDoneSerial, sizeof(int));
+                  if (rv != sizeof(int))
+                        fprintf(stderr, "audio: write(%d) pipe failed: %s\n",
+                           fromThreadFdw, strerror(errno));
+                  }
+            }
+      if (any && _running && !_asyncMsgsSignalled.exchange(true))
+            write(sigFd, "A", 1);
+      return _asyncMsgs.isEmpty(false);
       }
 
 //---------------------------------------------------------
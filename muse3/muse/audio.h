@@ -26,6 +26,10 @@
 #define __AUDIO_H__
 
 #include <stdint.h>
+#include <atomic>
+#include <list>
+#include <map>
+#include <vector>
 
 #include "type_defs.h"
 #include "thread.h"
@@ -33,6 +37,8 @@
 #include "mpevent.h"
 #include "route.h"
 #include "event.h"
+#include "lock_free_buffer.h"
+#include "dsp_stats.h"
 
 // An experiment to use true frames for time-stamping all recorded input. 
 // (All recorded data actually arrived in the previous period.)
@@ -53,6 +59,7 @@ class MidiPort;
 class MidiTrack;
 class Part;
 class PluginI;
+class SndFileR;
 class SynthI;
 class Track;
 class Undo;
@@ -88,6 +95,8 @@ enum {
       AUDIO_ADD_AC_EVENT,
       AUDIO_CHANGE_AC_EVENT,
       AUDIO_SET_SEND_METRONOME,
+      AUDIO_SET_FREEZE,
+      AUDIO_SET_FREEZE_CAPTURE,
       AUDIO_START_MIDI_LEARN,
       MS_PROCESS, MS_STOP, MS_SET_RTC, MS_UPDATE_POLL_FD,
       SEQM_IDLE, SEQM_SEEK,
@@ -125,6 +134,53 @@ struct AudioMsg : public ThreadMsg {   // this should be an union
       PendingOperationList* pendingOps;
       };
 
+// Called in the gui thread when posted messages were processed. 'skipped' is
+//  true if a newer message setting the same value replaced them beforehand.
+typedef void (*AudioMsgDoneFunc)(void* arg, bool skipped);
+
+//---------------------------------------------------------
+//   AsyncAudioMsg
+//    One or more messages posted by the gui thread without
+//     waiting, all executed in the same audio cycle.
+//    Allocated and freed by the gui thread only.
+//---------------------------------------------------------
+
+struct AsyncAudioMsg {
+      std::vector<AudioMsg> msgs;
+      // What the SEQM_PLAY_MIDI_EVENT messages point to.
+      std::list<MidiPlayEvent> events;
+      std::vector<std::pair<AudioMsgDoneFunc, void*> > done;
+      // Set by the gui thread when a newer message replaces this one.
+      std::atomic<bool> superseded;
+      // Set by the audio thread.
+      bool executed;
+      // The sender waits for it, the audio thread writes to the
+      //  message pipe once it was processed.
+      bool wakeSender;
+
+      AsyncAudioMsg() : superseded(false), executed(false), wakeSender(false) { }
+      };
+
+//---------------------------------------------------------
+//   AudioMsgKey
+//    Messages with the same key set the same value,
+//     only the newest one counts.
+//---------------------------------------------------------
+
+struct AudioMsgKey {
+      int id;
+      const void* obj;
+      int idx;
+
+      bool operator<(const AudioMsgKey& k) const {
+            if (id != k.id)
+                  return id < k.id;
+            if (obj != k.obj)
+                  return obj < k.obj;
+            return idx < k.idx;
+            }
+      };
+
 //---------------------------------------------------------
 //   Audio
 //---------------------------------------------------------
@@ -189,6 +245,24 @@ class Audio {
       AudioMsg* msg;
       int fromThreadFdw, fromThreadFdr;  // message pipe
 
+      // Asynchronous messages, see postMsg(). Both rings hold as many
+      //  messages as may be in flight.
+      static const unsigned asyncMsgCapacity;
+      // Most posted messages the audio thread executes in one cycle.
+      static const unsigned asyncMsgsPerCycle;
+      // Written to the message pipe for a batch the sender waits for.
+      //  sendMsg() serial numbers are never negative.
+      static const int asyncMsgDoneSerial;
+      LockFreeMPSCRingBuffer<AsyncAudioMsg*> _asyncMsgs;       // gui -> audio
+      LockFreeMPSCRingBuffer<AsyncAudioMsg*> _asyncMsgsDone;   // audio -> gui
+      std::atomic<bool> _asyncMsgsSignalled;  // An 'A' is on its way to the gui.
+      // These are for the gui thread only.
+      unsigned _asyncMsgsInFlight;
+      int _msgBatchLevel;
+      AsyncAudioMsg* _msgBatch;
+      // Posted single messages which a newer one may still replace.
+      std::map<AudioMsgKey, AsyncAudioMsg*> _coalescable;
+
       int sigFd;              // pipe fd for messages to gui
       int sigFdr;
       
@@ -210,9 +284,17 @@ class Audio {
 
       void panic();
       void processMsg(AudioMsg* msg);
+      bool processAsyncMsgs(bool all = false);
+      void postAsyncMsg(AsyncAudioMsg*);
+      void flushMsgBatch();
       void process1(unsigned samplePos, unsigned offset, unsigned samples);
 
       void collectEvents(MidiTrack*, unsigned int startTick, unsigned int endTick, unsigned int frames);
+      // Schedules one part event for playback. EV is an Event or a PackedMidiEvent.
+      // ev_fr is the tempo map frame of the event, unused with external sync.
+      template <class EV> void collectEvent(MidiTrack*, const EV& ev, unsigned offset, unsigned stick,
+                                            int defaultPort, int& channel, MidiPort* mp, MidiDevice* md,
+                                            bool extsync, unsigned ev_fr, unsigned pos_fr, unsigned next_pos_fr);
       
       void seekMidi();
 
@@ -228,6 +310,8 @@ class Audio {
       // Process midi for a number of frames. Call from audio thread only.
       // Note that nextTickPos (and friends) will already be set before calling.
       void processMidi(unsigned int frames);
+      // Time spent in processMidi() each cycle.
+      DspTimeStats _midiDspStats;
       
    public:
       Audio();
@@ -257,6 +341,7 @@ class Audio {
       void setRunning(bool val) { _running = val; }
       bool isRunning() const    { return _running; }
       bool isIdle() const { return idle; }
+      DspTimeStats* midiDspStats() { return &_midiDspStats; }
 
       //-----------------------------------------
       //   message interface
@@ -281,6 +366,24 @@ class Audio {
       void msgPanic();
       void sendMsg(AudioMsg*);
       bool sendMessage(AudioMsg* m, bool doUndo);
+
+      // Asynchronous messages, gui thread only.
+      // Posts the message without waiting for the audio thread. Only for messages
+      //  which carry all they need, a pointed to MidiPlayEvent is copied.
+      void postMsg(const AudioMsg& m, AudioMsgDoneFunc done = 0, void* doneArg = 0);
+      // In between, postMsg() and the self contained messages like msgSetPrefader()
+      //  are collected and executed together, up to asyncMsgsPerCycle of them in one
+      //  audio cycle. Any other message, route, channel and automation list ones
+      //  included, is sent as usual, after the ones collected so far. Batches nest.
+      //  With wait, the outermost endMsgBatch() returns once the batch was processed.
+      //  An empty batch is not sent and not waited for.
+      void beginMsgBatch();
+      void endMsgBatch(bool wait = false, AudioMsgDoneFunc done = 0, void* doneArg = 0);
+      // Returns once all posted messages were processed and their callbacks called.
+      void waitAsyncMsgs();
+      // Calls the callbacks of the processed messages and frees them.
+      void processAsyncMsgsDone();
+
       void msgRemoveRoute(Route, Route);
       void msgRemoveRoute1(Route, Route); 
       void msgAddRoute(Route, Route);
@@ -304,6 +407,8 @@ class Audio {
       void msgSetHwCtrlStates(MidiPort*, int, int, int, int);
       void msgSetTrackAutomationType(Track*, int);
       void msgSetSendMetronome(AudioTrack*, bool);
+      void msgSetFreeze(AudioTrack*, const SndFileR&);
+      void msgSetFreezeCapture(AudioTrack*, const SndFileR&);
       void msgStartMidiLearn();
       void msgPlayMidiEvent(const MidiPlayEvent* event);
       void msgSetMidiDevice(MidiPort* port, MidiDevice* device);
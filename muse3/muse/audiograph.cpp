@@ -0,0 +1,516 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  audiograph.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <map>
+
+#include "audiograph.h"
+#include "globals.h"
+#include "song.h"
+#include "track.h"
+#include "route.h"
+
+// Turn on debugging messages
+//#define AUDIOGRAPH_DEBUG
+
+namespace MusEGlobal {
+MusECore::AudioGraph* audioGraph;
+}
+
+namespace MusECore {
+
+void initAudioGraph()
+{
+  MusEGlobal::audioGraph = new AudioGraph();
+}
+
+//---------------------------------------------------------
+//   AudioGraph
+//---------------------------------------------------------
+
+AudioGraph::AudioGraph()
+{
+  _current = 0;
+  _pending = 0;
+  _retired = 0;
+  _generation = 0;
+  _builtGeneration = 0;
+  _built = false;
+  _quit = false;
+  _running = false;
+  _next = 0;
+  _end = 0;
+  _levelNodes = 0;
+  _pos = 0;
+  _frames = 0;
+  _bufferFrames = 0;
+  for(int i = 0; i < MAX_CHANNELS; ++i)
+    _buffer[i] = 0;
+  sem_init(&_wakeSem, 0, 0);
+  sem_init(&_doneSem, 0, 0);
+}
+
+AudioGraph::~AudioGraph()
+{
+  stop();
+  sem_destroy(&_wakeSem);
+  sem_destroy(&_doneSem);
+  delete _current;
+  delete _pending.exchange(0);
+  delete _retired.exchange(0);
+}
+
+//---------------------------------------------------------
+//   automaticWorkerThreads
+//---------------------------------------------------------
+
+int AudioGraph::automaticWorkerThreads()
+{
+  long ncpus = 1;
+#ifdef __linux__
+  ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if(ncpus <= 1)
+    return 0;
+  return ncpus - 1 > 4 ? 4 : ncpus - 1;
+}
+
+//---------------------------------------------------------
+//   allocBuffer
+//    The dummy output buffers are allocated up front, the worker
+//     threads' stacks are too small for a whole segment.
+//---------------------------------------------------------
+
+void AudioGraph::allocBuffer(float** buffer) const
+{
+  for(int i = 0; i < MAX_CHANNELS; ++i)
+  {
+    buffer[i] = 0;
+    if(posix_memalign((void**)&buffer[i], 16, sizeof(float) * _bufferFrames) != 0)
+    {
+      fprintf(stderr, "ERROR: AudioGraph::allocBuffer: posix_memalign returned error. Aborting!\n");
+      abort();
+    }
+  }
+}
+
+//---------------------------------------------------------
+//   freeBuffer
+//---------------------------------------------------------
+
+void AudioGraph::freeBuffer(float** buffer)
+{
+  for(int i = 0; i < MAX_CHANNELS; ++i)
+  {
+    free(buffer[i]);
+    buffer[i] = 0;
+  }
+}
+
+//---------------------------------------------------------
+//   start
+//---------------------------------------------------------
+
+void AudioGraph::start(int threads, int priority)
+{
+  if(threads < 0)
+    threads = automaticWorkerThreads();
+  if(_running || threads <= 0)
+    return;
+
+  _quit = false;
+
+  // Tracks never process more than a segment at a time, see AudioTrack::copyData().
+  _bufferFrames = MusEGlobal::segmentSize;
+  allocBuffer(_buffer);
+
+#ifdef __linux__
+  const long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+  for(int i = 0; i < threads; ++i)
+  {
+    Worker* w = new Worker;
+    w->graph = this;
+    w->index = i;
+    allocBuffer(w->buffer);
+
+    pthread_attr_t* attributes = 0;
+    if(MusEGlobal::realTimeScheduling && priority > 0)
+    {
+      attributes = (pthread_attr_t*) malloc(sizeof(pthread_attr_t));
+      pthread_attr_init(attributes);
+      if(pthread_attr_setschedpolicy(attributes, SCHED_FIFO))
+        fprintf(stderr, "AudioGraph: cannot set FIFO scheduling class for worker thread\n");
+      if(pthread_attr_setscope(attributes, PTHREAD_SCOPE_SYSTEM))
+        fprintf(stderr, "AudioGraph: cannot set scheduling scope for worker thread\n");
+      if(pthread_attr_setinheritsched(attributes, PTHREAD_EXPLICIT_SCHED))
+        fprintf(stderr, "AudioGraph: cannot set setinheritsched for worker thread\n");
+      struct sched_param rt_param;
+      memset(&rt_param, 0, sizeof(rt_param));
+      rt_param.sched_priority = priority;
+      if(pthread_attr_setschedparam(attributes, &rt_param))
+        fprintf(stderr, "AudioGraph: cannot set scheduling priority %d for worker thread (%s)\n",
+                priority, strerror(errno));
+    }
+
+    int rv = pthread_create(&w->thread, attributes, workerLoop, w);
+    // Same as Thread::start(): Try again without attributes if RT failed.
+    if(rv && attributes)
+      rv = pthread_create(&w->thread, NULL, workerLoop, w);
+
+    if(attributes)
+    {
+      pthread_attr_destroy(attributes);
+      free(attributes);
+    }
+
+    if(rv)
+    {
+      fprintf(stderr, "AudioGraph: creating worker thread %d failed: %s\n", i, strerror(rv));
+      freeBuffer(w->buffer);
+      delete w;
+      break;
+    }
+
+#ifdef __linux__
+    // Pin each worker to its own core, leaving the first one to the driver's process thread.
+    // Workers beyond the number of cores are left to the scheduler rather than
+    //  doubled up on a core which another worker already owns.
+    if(i + 1 < ncpus)
+    {
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      CPU_SET(i + 1, &cpuset);
+      if(pthread_setaffinity_np(w->thread, sizeof(cpu_set_t), &cpuset))
+        fprintf(stderr, "AudioGraph: cannot set cpu affinity for worker thread %d\n", i);
+    }
+#endif
+
+    _workers.push_back(w);
+  }
+
+  if(_workers.empty())
+  {
+    freeBuffer(_buffer);
+    return;
+  }
+
+  if(MusEGlobal::debugMsg)
+    fprintf(stderr, "AudioGraph::start: %d worker threads priority:%d\n", int(_workers.size()), priority);
+
+  _running = true;
+  update();
+}
+
+//---------------------------------------------------------
+//   stop
+//---------------------------------------------------------
+
+void AudioGraph::stop()
+{
+  if(_workers.empty())
+    return;
+
+  _running = false;
+  _quit = true;
+  for(unsigned i = 0; i < _workers.size(); ++i)
+    sem_post(&_wakeSem);
+  for(unsigned i = 0; i < _workers.size(); ++i)
+  {
+    pthread_join(_workers[i]->thread, 0);
+    freeBuffer(_workers[i]->buffer);
+    delete _workers[i];
+  }
+  _workers.clear();
+  freeBuffer(_buffer);
+
+  // Eat any left over wake ups.
+  while(sem_trywait(&_wakeSem) == 0)
+    ;
+  while(sem_trywait(&_doneSem) == 0)
+    ;
+}
+
+//---------------------------------------------------------
+//   build
+//    Called from gui thread only.
+//---------------------------------------------------------
+
+AudioGraph::Schedule* AudioGraph::build(unsigned generation) const
+{
+  Schedule* s = new Schedule;
+  s->parallel = false;
+  s->generation = generation;
+
+  enum { LevelExcluded = -1, LevelVisiting = -2 };
+
+  struct Frame {
+        AudioTrack* track;
+        ciRoute ir;
+        int level;
+        };
+
+  TrackList* tl = MusEGlobal::song->tracks();
+  std::map<const Track*, int> levels;
+
+  // Iterative depth first search. Each track's level is one more than the highest level
+  //  of its inputs. Tracks which cannot be processed ahead of the Aux tracks are excluded,
+  //  and so is everything downstream of them. Circular routes are excluded as well.
+  std::vector<Frame> stack;
+  int max_level = -1;
+  for(ciTrack it = tl->begin(); it != tl->end(); ++it)
+  {
+    if((*it)->isMidiTrack() || levels.find(*it) != levels.end())
+      continue;
+
+    AudioTrack* next = (AudioTrack*)*it;
+    while(next || !stack.empty())
+    {
+      if(next)
+      {
+        Frame f;
+        f.track = next;
+        f.ir = next->inRoutes()->begin();
+        f.level = (next->type() == Track::AUDIO_AUX || next->type() == Track::AUDIO_OUTPUT ||
+                   next->auxRefCount()) ? LevelExcluded : 0;
+        levels[next] = LevelVisiting;
+        stack.push_back(f);
+        next = 0;
+      }
+
+      Frame& f = stack.back();
+      const RouteList* rl = f.track->inRoutes();
+      for( ; f.level != LevelExcluded && f.ir != rl->end(); ++f.ir)
+      {
+        if(f.ir->type != Route::TRACK_ROUTE || !f.ir->track || f.ir->track->isMidiTrack())
+          continue;
+        std::map<const Track*, int>::const_iterator il = levels.find(f.ir->track);
+        if(il == levels.end())
+        {
+          // Not visited yet. Descend, and come back to this same route afterwards.
+          next = (AudioTrack*)f.ir->track;
+          break;
+        }
+        // Still visiting means a circular route.
+        if(il->second == LevelVisiting || il->second == LevelExcluded)
+        {
+          f.level = LevelExcluded;
+          break;
+        }
+        if(il->second + 1 > f.level)
+          f.level = il->second + 1;
+      }
+      if(next)
+        continue;
+
+      levels[f.track] = f.level;
+      if(f.level > max_level)
+        max_level = f.level;
+      stack.pop_back();
+    }
+  }
+
+  if(max_level < 0)
+    return s;
+
+  // Bucket the tracks by level, in track list order within each level.
+  const int nlevels = max_level + 1;
+  std::vector<int>& levelStart = s->levelStart;
+  levelStart.assign(nlevels + 1, 0);
+  for(ciTrack it = tl->begin(); it != tl->end(); ++it)
+  {
+    if((*it)->isMidiTrack())
+      continue;
+    const int lvl = levels[*it];
+    if(lvl >= 0)
+      ++levelStart[lvl + 1];
+  }
+  for(int l = 0; l < nlevels; ++l)
+  {
+    if(levelStart[l + 1] > 1)
+      s->parallel = true;
+    levelStart[l + 1] += levelStart[l];
+  }
+
+  s->nodes.resize(levelStart[nlevels]);
+  std::vector<int> fill(levelStart.begin(), levelStart.end() - 1);
+  for(ciTrack it = tl->begin(); it != tl->end(); ++it)
+  {
+    if((*it)->isMidiTrack())
+      continue;
+    const int lvl = levels[*it];
+    if(lvl >= 0)
+      s->nodes[fill[lvl]++] = (AudioTrack*)*it;
+  }
+
+#ifdef AUDIOGRAPH_DEBUG
+  fprintf(stderr, "AudioGraph::build: tracks:%d levels:%d parallel:%d generation:%u\n",
+          int(s->nodes.size()), nlevels, s->parallel, generation);
+#endif
+  return s;
+}
+
+//---------------------------------------------------------
+//   update
+//    Called from gui thread only.
+//---------------------------------------------------------
+
+void AudioGraph::update()
+{
+  delete _retired.exchange(0);
+
+  if(!_running)
+    return;
+  const unsigned generation = _generation;
+  if(_built && generation == _builtGeneration)
+    return;
+  _built = true;
+  _builtGeneration = generation;
+
+  // If the audio thread has not picked up the previous one yet, it never will.
+  delete _pending.exchange(build(generation));
+}
+
+//---------------------------------------------------------
+//   runNode
+//---------------------------------------------------------
+
+void AudioGraph::runNode(AudioTrack* track, float** buffer)
+{
+  const int chans = track->channels();
+  // Just a dummy buffer. The track caches its output for the pulls which follow.
+  track->copyData(_pos, -1, chans, chans, -1, -1, _frames, buffer);
+}
+
+//---------------------------------------------------------
+//   runLevel
+//    Called by the audio thread and the woken workers together.
+//---------------------------------------------------------
+
+void AudioGraph::runLevel(float** buffer)
+{
+  int i;
+  while((i = _next++) < _end)
+    runNode((*_levelNodes)[i], buffer);
+}
+
+//---------------------------------------------------------
+//   workerLoop
+//---------------------------------------------------------
+
+void* AudioGraph::workerLoop(void* arg)
+{
+  Worker* w = (Worker*)arg;
+  AudioGraph* g = w->graph;
+  for(;;)
+  {
+    while(sem_wait(&g->_wakeSem) == -1 && errno == EINTR)
+      ;
+    if(g->_quit)
+    {
+      // Do not leave the audio thread waiting, should it still be in process().
+      sem_post(&g->_doneSem);
+      break;
+    }
+    g->runLevel(w->buffer);
+    sem_post(&g->_doneSem);
+  }
+  return 0;
+}
+
+//---------------------------------------------------------
+//   process
+//    Called from audio thread only.
+//---------------------------------------------------------
+
+void AudioGraph::process(unsigned pos, unsigned frames)
+{
+  if(!_running)
+    return;
+
+  // Pick up a new schedule. The old one can only be dropped once the gui
+  //  thread has freed the one before it, so nothing is ever freed here.
+  if(_pending.load() && !_retired.load())
+  {
+    Schedule* s = _pending.exchange(0);
+    if(s)
+    {
+      if(s->generation == _generation)
+      {
+        _retired = _current;
+        _current = s;
+      }
+      else
+        _retired = s;
+    }
+  }
+
+  // Changed since the schedule was built. The Aux and Output tracks pull
+  //  everything serially until the gui thread has built a new one.
+  Schedule* s = _current;
+  if(!s || s->generation != _generation || !s->parallel)
+    return;
+  // Larger than the dummy buffers. Leave it all to the serial pulls.
+  if(frames > _bufferFrames)
+    return;
+
+  _pos = pos;
+  _frames = frames;
+  _levelNodes = &s->nodes;
+
+  const int nworkers = _workers.size();
+  const int nlevels = int(s->levelStart.size()) - 1;
+  for(int l = 0; l < nlevels; ++l)
+  {
+    const int start = s->levelStart[l];
+    const int end = s->levelStart[l + 1];
+    // One track: Not worth waking anyone.
+    if(end - start == 1)
+    {
+      runNode(s->nodes[start], _buffer);
+      continue;
+    }
+
+    _end = end;
+    _next = start;
+    int helpers = end - start - 1;
+    if(helpers > nworkers)
+      helpers = nworkers;
+    for(int i = 0; i < helpers; ++i)
+      sem_post(&_wakeSem);
+
+    runLevel(_buffer);
+
+    // Join: The next level may depend on any track of this level.
+    for(int i = 0; i < helpers; ++i)
+      while(sem_wait(&_doneSem) == -1 && errno == EINTR)
+        ;
+  }
+}
+
+} // namespace MusECore
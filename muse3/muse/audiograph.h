@@ -0,0 +1,148 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  audiograph.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __AUDIOGRAPH_H__
+#define __AUDIOGRAPH_H__
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <vector>
+#include <atomic>
+
+#include "globaldefs.h"
+
+namespace MusECore {
+
+class AudioTrack;
+
+//---------------------------------------------------------
+//   AudioGraph
+//    Dependency ordered (topologically sorted) view of the
+//     audio track routes, used to process independent tracks
+//     on a pool of realtime worker threads.
+//
+//    Only tracks which can safely be processed before the
+//     Aux tracks are included: Aux and Output tracks, and
+//     anything downstream of an Aux, are join points which
+//     are still pulled serially by Audio::process1().
+//    Tracks of the same level have no routes between them.
+//     Levels are processed one after the other.
+//---------------------------------------------------------
+
+class AudioGraph {
+      struct Worker {
+            AudioGraph* graph;
+            int index;
+            pthread_t thread;
+            // Dummy output buffers for the tracks this worker runs.
+            float* buffer[MAX_CHANNELS];
+            };
+
+      // A level ordered schedule. Built by the gui thread, then handed to the audio thread.
+      struct Schedule {
+            // Tracks sorted by level.
+            std::vector<AudioTrack*> nodes;
+            // Index into nodes of the first track of each level, plus the end.
+            std::vector<int> levelStart;
+            // Whether any level has more than one track. If not, there is nothing to gain.
+            bool parallel;
+            // The value of _generation the schedule was built for.
+            unsigned generation;
+            };
+
+      // The schedule in use. Audio thread only.
+      Schedule* _current;
+      // A new schedule waiting to be picked up by the audio thread.
+      std::atomic<Schedule*> _pending;
+      // A schedule dropped by the audio thread, waiting to be deleted by the gui thread.
+      std::atomic<Schedule*> _retired;
+      // Bumped by the audio thread whenever tracks or routes may have changed.
+      // A schedule built for an older generation is never used, the tracks
+      //  it points to may already be gone.
+      std::atomic<unsigned> _generation;
+      // The generation of the last schedule built. Gui thread only.
+      unsigned _builtGeneration;
+      bool _built;
+
+      std::vector<Worker*> _workers;
+      // Posted once per worker that should help with the current level.
+      sem_t _wakeSem;
+      // Posted by each of those workers when the level has run out of tracks.
+      sem_t _doneSem;
+      std::atomic<bool> _quit;
+      std::atomic<bool> _running;
+
+      // The level being processed: Next track index to grab, and the end.
+      std::atomic<int> _next;
+      int _end;
+      std::vector<AudioTrack*>* _levelNodes;
+
+      unsigned _pos;
+      unsigned _frames;
+
+      // The audio thread's dummy output buffers.
+      float* _buffer[MAX_CHANNELS];
+      // Frames the dummy buffers hold, the segment size when start() was called.
+      unsigned _bufferFrames;
+
+      Schedule* build(unsigned generation) const;
+      void allocBuffer(float** buffer) const;
+      static void freeBuffer(float** buffer);
+      void runLevel(float** buffer);
+      void runNode(AudioTrack* track, float** buffer);
+      static void* workerLoop(void*);
+
+   public:
+      AudioGraph();
+      ~AudioGraph();
+
+      // Starts 'threads' worker threads with the given realtime priority.
+      // Zero threads means serial processing only, a negative number
+      //  means automaticWorkerThreads(). Called from the gui thread.
+      void start(int threads, int priority);
+      // One worker per core besides the one taken by the driver's process thread, at most four.
+      static int automaticWorkerThreads();
+      // Stops and joins all worker threads. Called from the gui thread.
+      void stop();
+      bool isRunning() const { return _running; }
+      int workerThreads() const { return _workers.size(); }
+
+      // Called from audio thread, whenever routes, tracks or track channels may have changed.
+      // Processing is serial from then on, until the gui thread has called update().
+      void setDirty() { ++_generation; }
+      // Called from gui thread only. Builds a new schedule if the graph was marked dirty,
+      //  and frees the one the audio thread dropped. Cheap if nothing changed.
+      void update();
+
+      // Called from audio thread only, after the tracks' processed flags were reset.
+      // Processes all independent tracks in dependency order, spread over the worker threads.
+      // Any tracks not processed here will be pulled as usual by the Aux and Output tracks.
+      void process(unsigned pos, unsigned frames);
+      };
+
+} // namespace MusECore
+
+namespace MusEGlobal {
+extern MusECore::AudioGraph* audioGraph;
+}
+
+#endif
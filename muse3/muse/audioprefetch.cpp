@@ -25,11 +25,16 @@
 #include <poll.h>
 #endif
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <limits.h>
+#include <algorithm>
 
 #include "audioprefetch.h"
 #include "globals.h"
+#include "gconfig.h"
 #include "track.h"
 #include "song.h"
 #include "audio.h"
@@ -48,7 +53,7 @@ void initAudioPrefetch()
 
 //#define AUDIOPREFETCH_DEBUG
 
-enum { PREFETCH_TICK, PREFETCH_SEEK
+enum { PREFETCH_TICK, PREFETCH_SEEK, PREFETCH_ACK
       };
 
 //---------------------------------------------------------
@@ -59,6 +64,7 @@ struct PrefetchMsg : public ThreadMsg {
       int pos;
       bool _isPlayTick;
       bool _isRecTick;
+      std::atomic<bool>* ack;
       };
 
 //---------------------------------------------------------
@@ -71,6 +77,14 @@ AudioPrefetch::AudioPrefetch(const char* name)
       seekPos  = ~0;
       writePos = ~0;
       seekCount = 0;
+      _nextJob = 0;
+      _jobsSeek = false;
+      _activeWorkers = 0;
+      _quit = false;
+      _scratch = 0;
+      _maxReadSegs = 1;
+      sem_init(&_wakeSem, 0, 0);
+      sem_init(&_doneSem, 0, 0);
       }
 
 //---------------------------------------------------------
@@ -91,15 +105,151 @@ void AudioPrefetch::start(int priority, void *)
       {
       clearPollFd();
       addPollFd(toThreadFdr, POLLIN, MusECore::readMsgP, this, 0);
+      startWorkers(MusEGlobal::config.prefetchWorkerThreads, priority);
       Thread::start(priority);
       }
 
+//---------------------------------------------------------
+//   threadStop
+//    Called from the loop before leaving, or by stop()
+//     after the thread was cancelled.
+//---------------------------------------------------------
+
+void AudioPrefetch::threadStop()
+      {
+      stopWorkers();
+      }
+
 //---------------------------------------------------------
 //   ~AudioPrefetch
 //---------------------------------------------------------
 
 AudioPrefetch::~AudioPrefetch()
       {
+      stopWorkers();
+      sem_destroy(&_wakeSem);
+      sem_destroy(&_doneSem);
+      if (_scratch)
+            delete[] _scratch;
+      }
+
+//---------------------------------------------------------
+//   startWorkers
+//---------------------------------------------------------
+
+void AudioPrefetch::startWorkers(int threads, int priority)
+      {
+      stopWorkers();
+
+      const int cap = MusEGlobal::fifoLength - 1;
+      // Large enough reads to keep the disk busy, but keep them a fraction of the fifo
+      //  so a slow track does not hold up the others for long.
+      _maxReadSegs = std::min(cap / 4, int(16384 / MusEGlobal::segmentSize));
+      if (_maxReadSegs < 1)
+            _maxReadSegs = 1;
+      const size_t scratch_size = size_t(_maxReadSegs) * MusEGlobal::segmentSize * MAX_CHANNELS;
+
+      // The prefetch thread itself may still be using its scratch buffer here
+      //  when it was cancelled, so it is only replaced when starting again.
+      if (_scratch)
+            delete[] _scratch;
+      _scratch = new float[scratch_size];
+      _quit = false;
+      _activeWorkers = 0;
+
+      for (int i = 0; i < threads; ++i) {
+            Worker* w = new Worker;
+            w->prefetch = this;
+            w->scratch = new float[scratch_size];
+
+            pthread_attr_t* attributes = 0;
+            if (MusEGlobal::realTimeScheduling && priority > 0) {
+                  attributes = (pthread_attr_t*) malloc(sizeof(pthread_attr_t));
+                  pthread_attr_init(attributes);
+                  if (pthread_attr_setschedpolicy(attributes, SCHED_FIFO))
+                        fprintf(stderr, "AudioPrefetch: cannot set FIFO scheduling class for worker thread\n");
+                  if (pthread_attr_setscope(attributes, PTHREAD_SCOPE_SYSTEM))
+                        fprintf(stderr, "AudioPrefetch: cannot set scheduling scope for worker thread\n");
+                  if (pthread_attr_setinheritsched(attributes, PTHREAD_EXPLICIT_SCHED))
+                        fprintf(stderr, "AudioPrefetch: cannot set setinheritsched for worker thread\n");
+                  struct sched_param rt_param;
+                  memset(&rt_param, 0, sizeof(rt_param));
+                  rt_param.sched_priority = priority;
+                  if (pthread_attr_setschedparam(attributes, &rt_param))
+                        fprintf(stderr, "AudioPrefetch: cannot set scheduling priority %d for worker thread (%s)\n",
+                                priority, strerror(errno));
+                  }
+
+            int rv = pthread_create(&w->thread, attributes, workerLoop, w);
+            // Same as Thread::start(): Try again without attributes if RT failed.
+            if (rv && attributes)
+                  rv = pthread_create(&w->thread, NULL, workerLoop, w);
+
+            if (attributes) {
+                  pthread_attr_destroy(attributes);
+                  free(attributes);
+                  }
+
+            if (rv) {
+                  fprintf(stderr, "AudioPrefetch: creating worker thread %d failed: %s\n", i, strerror(rv));
+                  delete[] w->scratch;
+                  delete w;
+                  break;
+                  }
+            _workers.push_back(w);
+            }
+
+      if (MusEGlobal::debugMsg)
+            fprintf(stderr, "AudioPrefetch::startWorkers: %d worker threads priority:%d max read:%d segments\n",
+                    int(_workers.size()), priority, _maxReadSegs);
+      }
+
+//---------------------------------------------------------
+//   stopWorkers
+//---------------------------------------------------------
+
+void AudioPrefetch::stopWorkers()
+      {
+      if (!_workers.empty()) {
+            _quit = true;
+            for (unsigned i = 0; i < _workers.size(); ++i)
+                  sem_post(&_wakeSem);
+            for (unsigned i = 0; i < _workers.size(); ++i) {
+                  pthread_join(_workers[i]->thread, 0);
+                  delete[] _workers[i]->scratch;
+                  delete _workers[i];
+                  }
+            _workers.clear();
+            }
+
+      // Eat any left over wake ups.
+      while (sem_trywait(&_wakeSem) == 0)
+            ;
+      while (sem_trywait(&_doneSem) == 0)
+            ;
+      }
+
+//---------------------------------------------------------
+//   workerLoop
+//---------------------------------------------------------
+
+void* AudioPrefetch::workerLoop(void* arg)
+      {
+      Worker* w = (Worker*)arg;
+      AudioPrefetch* p = w->prefetch;
+      for (;;) {
+            while (sem_wait(&p->_wakeSem) == -1 && errno == EINTR)
+                  ;
+            if (p->_quit)
+                  break;
+            const int njobs = p->_jobs.size();
+            int i;
+            while ((i = p->_nextJob++) < njobs)
+                  p->fetchTrack(p->_jobs[i], w->scratch);
+            if (--p->_activeWorkers == 0)
+                  sem_post(&p->_doneSem);
+            }
+      return 0;
       }
 
 //---------------------------------------------------------
@@ -125,7 +275,9 @@ void AudioPrefetch::processMsg1(const void* m)
                     #ifdef AUDIOPREFETCH_DEBUG
                     fprintf(stderr, "AudioPrefetch::processMsg1: PREFETCH_TICK: isPlayTick\n");
                     #endif
-                    prefetch(false);
+                    prefetch(false, false);
+                    if (writePos != ~0U)
+                          writePos = loopAdjust(writePos) + MusEGlobal::segmentSize;
                   }
                   
                   seekPos = ~0;     // invalidate cached last seek position
@@ -138,6 +290,11 @@ void AudioPrefetch::processMsg1(const void* m)
                   // process seek in background
                   seek(msg->pos);
                   break;
+            case PREFETCH_ACK:
+                  // All messages sent before this one are done, and with
+                  //  them every read the tracks made from their old sources.
+                  msg->ack->store(true);
+                  break;
             default:
                   fprintf(stderr, "AudioPrefetch::processMsg1: unknown message\n");
             }
@@ -154,6 +311,7 @@ void AudioPrefetch::msgTick(bool isRecTick, bool isPlayTick)
       msg.pos = 0; // seems to be unused, was uninitialized.
       msg._isRecTick = isRecTick;
       msg._isPlayTick = isPlayTick;
+      msg.ack = 0;
       while (sendMsg1(&msg, sizeof(msg))) {
             fprintf(stderr, "AudioPrefetch::msgTick(): send failed!\n");
             }
@@ -178,6 +336,7 @@ void AudioPrefetch::msgSeek(unsigned samplePos, bool force)
       PrefetchMsg msg;
       msg.id  = PREFETCH_SEEK;
       msg.pos = samplePos;
+      msg.ack = 0;
       while (sendMsg1(&msg, sizeof(msg))) {
             fprintf(stderr, "AudioPrefetch::msgSeek::sleep(1)\n");
             sleep(1);
@@ -185,43 +344,193 @@ void AudioPrefetch::msgSeek(unsigned samplePos, bool force)
       }
 
 //---------------------------------------------------------
-//   prefetch
+//   msgAcknowledge
+//    Sets 'ack' once the prefetch thread has processed all
+//     messages sent before this one. Sets it at once if the
+//     thread is not running, nothing reads then.
+//    called from gui context
 //---------------------------------------------------------
 
-void AudioPrefetch::prefetch(bool doSeek)
+void AudioPrefetch::msgAcknowledge(std::atomic<bool>* ack)
       {
-      if (writePos == ~0U) {
-            fprintf(stderr, "AudioPrefetch::prefetch: invalid write position\n");
+      if (!isRunning()) {
+            ack->store(true);
             return;
             }
+      PrefetchMsg msg;
+      msg.id  = PREFETCH_ACK;
+      msg.pos = 0;
+      msg._isRecTick = false;
+      msg._isPlayTick = false;
+      msg.ack = ack;
+      while (sendMsg1(&msg, sizeof(msg))) {
+            fprintf(stderr, "AudioPrefetch::msgAcknowledge(): send failed!\n");
+            sleep(1);
+            }
+      }
+
+//---------------------------------------------------------
+//   loopAdjust
+//    Returns the position to read the segment at 'pos' from.
+//---------------------------------------------------------
+
+unsigned AudioPrefetch::loopAdjust(unsigned pos) const
+      {
       if (MusEGlobal::song->loop() && !MusEGlobal::audio->bounce() && !MusEGlobal::extSyncFlag.value()) {
             const Pos& loop = MusEGlobal::song->rPos();
-            unsigned n = loop.frame() - writePos;
+            unsigned n = loop.frame() - pos;
             if (n < MusEGlobal::segmentSize) {
                   unsigned lpos = MusEGlobal::song->lPos().frame();
                   // adjust loop start so we get exact loop len
                   if (n > lpos)
                         n = 0;
-                  writePos = lpos - n;
+                  pos = lpos - n;
+                  }
+            }
+      return pos;
+      }
+
+//---------------------------------------------------------
+//   fetchTrack
+//    Called from the prefetch thread or one of its workers.
+//    Only one thread at a time fetches any given track.
+//---------------------------------------------------------
+
+void AudioPrefetch::fetchTrack(const Job& job, float* scratch)
+      {
+      AudioTrack* track = job.track;
+      Fifo* fifo = track->prefetchFifo();
+      const unsigned seg = MusEGlobal::segmentSize;
+      const int ch = track->channels();
+      if (ch > MAX_CHANNELS)
+            return;
+
+      unsigned pos = track->prefetchWritePos();
+      bool doSeek = _jobsSeek;
+      int done = 0;
+      while (done < job.segs) {
+            pos = loopAdjust(pos);
+            // Coalesce as many segments as possible into one read, up to the loop end.
+            int run = 1;
+            unsigned next = pos + seg;
+            while (done + run < job.segs && loopAdjust(next) == next) {
+                  ++run;
+                  next += seg;
+                  }
+
+            float* sp[ch];
+            for (int i = 0; i < ch; ++i)
+                  sp[i] = scratch + i * run * seg;
+            // True = do overwrite.
+            track->readData(pos, run * seg, sp, doSeek, true);
+            doSeek = false;
+
+            for (int k = 0; k < run; ++k) {
+                  float* bp[ch];
+                  if (fifo->getWriteBuffer(ch, seg, bp, pos)) {
+                        track->setPrefetchWritePos(pos);
+                        return;
+                        }
+                  for (int i = 0; i < ch; ++i)
+                        memcpy(bp[i], sp[i] + k * seg, seg * sizeof(float));
+                  fifo->add();
+                  pos += seg;
                   }
+            done += run;
             }
-      WaveTrackList* tl = MusEGlobal::song->waves();
-      for (iWaveTrack it = tl->begin(); it != tl->end(); ++it) {
-            WaveTrack* track = *it;
+      track->setPrefetchWritePos(pos);
+      }
+
+//---------------------------------------------------------
+//   runJobs
+//---------------------------------------------------------
+
+void AudioPrefetch::runJobs()
+      {
+      const int njobs = _jobs.size();
+      _nextJob = 0;
+      // The prefetch thread takes its share of the jobs.
+      const int wake = std::max(0, std::min(int(_workers.size()), njobs - 1));
+      _activeWorkers = wake;
+      for (int i = 0; i < wake; ++i)
+            sem_post(&_wakeSem);
+
+      int i;
+      while ((i = _nextJob++) < njobs)
+            fetchTrack(_jobs[i], _scratch);
+
+      if (wake > 0)
+            while (sem_wait(&_doneSem) == -1 && errno == EINTR)
+                  ;
+      }
+
+//---------------------------------------------------------
+//   prefetch
+//    Returns true if any track was fetched.
+//---------------------------------------------------------
+
+bool AudioPrefetch::prefetch(bool doSeek, bool isSeek)
+      {
+      if (writePos == ~0U) {
+            fprintf(stderr, "AudioPrefetch::prefetch: invalid write position\n");
+            return false;
+            }
+      if (!_scratch)
+            return false;
+
+      // Keep one buffer free, as always.
+      const int cap = MusEGlobal::fifoLength - 1;
+      _jobs.clear();
+      TrackList* tl = MusEGlobal::song->tracks();
+      for (iTrack it = tl->begin(); it != tl->end(); ++it) {
+            if ((*it)->isMidiTrack())
+                  continue;
+            AudioTrack* track = static_cast<AudioTrack*>(*it);
+            if (!track->usesPrefetch())
+                  continue;
             // Save time. Don't bother if track is off. Track On/Off not designed for rapid repeated response (but mute is). (p3.3.29)
-            if(track->off())
-              continue;
-            
-            int ch           = track->channels();
-            float* bp[ch];
-            if (track->prefetchFifo()->getWriteBuffer(ch, MusEGlobal::segmentSize, bp, writePos))
+            // Keep it in step though, for when it is switched on again.
+            if (track->off() || track->prefetchWritePos() == ~0U) {
+                  track->setPrefetchWritePos(writePos);
+                  if (track->off())
+                        continue;
+                  }
+
+            const int fill = track->prefetchFifo()->getCount();
+            const int need = cap - fill;
+            int segs = need;
+            if (!isSeek) {
+                  track->notePrefetchFill(cap > 0 ? fill * 100 / cap : 100);
+                  // Falling behind: Fetch larger chunks from now on.
+                  int ra = track->prefetchReadAhead();
+                  if (fill < cap / 2 && ra < _maxReadSegs) {
+                        ra = std::min(ra * 2, _maxReadSegs);
+                        track->setPrefetchReadAhead(ra);
+                        }
+                  // Wait until there is room for a whole chunk, unless running low.
+                  if (need < ra && fill >= cap / 2)
+                        continue;
+                  }
+            if (segs > _maxReadSegs)
+                  segs = _maxReadSegs;
+            if (segs <= 0)
                   continue;
 
-            // True = do overwrite.
-            track->fetchData(writePos, MusEGlobal::segmentSize, bp, doSeek, true);
-            
+            Job job;
+            job.track = track;
+            job.fill  = fill;
+            job.segs  = segs;
+            _jobs.push_back(job);
             }
-      writePos += MusEGlobal::segmentSize;
+
+      if (_jobs.empty())
+            return false;
+
+      // Most urgent first.
+      std::sort(_jobs.begin(), _jobs.end());
+      _jobsSeek = doSeek;
+      runJobs();
+      return true;
       }
 
 //---------------------------------------------------------
@@ -251,17 +560,23 @@ void AudioPrefetch::seek(unsigned seekTo)
       }
       
       writePos = seekTo;
-      WaveTrackList* tl = MusEGlobal::song->waves();
-      for (iWaveTrack it = tl->begin(); it != tl->end(); ++it) {
-            WaveTrack* track = *it;
+      TrackList* tl = MusEGlobal::song->tracks();
+      for (iTrack it = tl->begin(); it != tl->end(); ++it) {
+            if ((*it)->isMidiTrack())
+                  continue;
+            AudioTrack* track = static_cast<AudioTrack*>(*it);
             track->clearPrefetchFifo();
+            track->setPrefetchWritePos(seekTo);
+            track->setPrefetchReadAhead(std::max(1, _maxReadSegs / 4));
             }
       
       bool isFirstPrefetch = true;
-      for (unsigned int i = 0; i < (MusEGlobal::fifoLength)-1; ++i)//prevent compiler warning: comparison of signed/unsigned
+      // Each pass fetches up to _maxReadSegs segments per track, until all fifos are full.
+      for (;;)
       {      
             // Indicate do a seek command before read, but only on the first pass. 
-            prefetch(isFirstPrefetch);
+            if(!prefetch(isFirstPrefetch, true))
+              break;
             
             isFirstPrefetch = false;
             
@@ -272,6 +587,10 @@ void AudioPrefetch::seek(unsigned seekTo)
               return;
             }  
       }
+
+      // Where a track which is keeping up will fetch next.
+      for (unsigned int i = 0; i < (MusEGlobal::fifoLength)-1; ++i)//prevent compiler warning: comparison of signed/unsigned
+            writePos = loopAdjust(writePos) + MusEGlobal::segmentSize;
             
       seekPos  = seekTo;
       --seekCount;
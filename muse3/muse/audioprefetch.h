@@ -24,21 +24,67 @@
 #ifndef __AUDIOPREFETCH_H__
 #define __AUDIOPREFETCH_H__
 
+#include <pthread.h>
+#include <semaphore.h>
+#include <vector>
+#include <atomic>
+
 #include "thread.h"
 
 namespace MusECore {
 
+class AudioTrack;
+
 //---------------------------------------------------------
 //   AudioPrefetch
+//    Each track playing from disk (wave tracks and frozen
+//     tracks) has its own write position. On every
+//     pass the tracks needing data are sorted by how empty
+//     their fifo is, and fetched by the prefetch thread
+//     together with a pool of worker threads. Consecutive
+//     segments are read from disk with a single read.
 //---------------------------------------------------------
 
 class AudioPrefetch : public Thread {
-      unsigned writePos;
+      struct Worker {
+            AudioPrefetch* prefetch;
+            pthread_t thread;
+            float* scratch;
+            };
+      struct Job {
+            AudioTrack* track;
+            int fill;   // fifo fill when the pass started
+            int segs;   // number of segments to fetch
+            bool operator<(const Job& j) const { return fill < j.fill; }
+            };
+
+      unsigned writePos; // next segment to fetch for a track which is keeping up
       unsigned seekPos; // remember last seek to optimize seeks
 
+      // Jobs of the current pass, most urgent first.
+      std::vector<Job> _jobs;
+      std::atomic<int> _nextJob;
+      bool _jobsSeek;
+      std::vector<Worker*> _workers;
+      sem_t _wakeSem;
+      sem_t _doneSem;
+      std::atomic<int> _activeWorkers;
+      std::atomic<bool> _quit;
+      // Scratch buffer of the prefetch thread itself.
+      float* _scratch;
+      // Most segments fetched with one read.
+      int _maxReadSegs;
+
       virtual void processMsg1(const void*);
-      void prefetch(bool doSeek);
+      virtual void threadStop();
+      unsigned loopAdjust(unsigned pos) const;
+      bool prefetch(bool doSeek, bool isSeek);
       void seek(unsigned pos);
+      void runJobs();
+      void fetchTrack(const Job& job, float* scratch);
+      void startWorkers(int threads, int priority);
+      void stopWorkers();
+      static void* workerLoop(void*);
 
       volatile int seekCount;
       
@@ -50,6 +96,7 @@ class AudioPrefetch : public Thread {
 
       void msgTick(bool isRecTick, bool isPlayTick);
       void msgSeek(unsigned samplePos, bool force=false);
+      void msgAcknowledge(std::atomic<bool>* ack);
       
       bool seekDone() const { return seekCount == 0; }
       };
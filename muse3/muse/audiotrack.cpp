@@ -25,9 +25,14 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <map>
+#include <algorithm>
 
 #include <QMessageBox>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 
 #include "globaldefs.h"
 #include "track.h"
@@ -45,6 +50,7 @@
 #include "controlfifo.h"
 #include "fastlog.h"
 #include "gconfig.h"
+#include "al/dsp.h"
 
 namespace MusECore {
 
@@ -288,10 +294,23 @@ AudioTrack::AudioTrack(TrackType t)
       {
       _processed = false;
       _haveData = false;
+      _auxSendsPending = false;
+      _latencyIn = 0.0;
+      _latencyOut = 0.0;
+      _latencyUpdated = false;
+      _latencyVisiting = false;
+      _inRouteLatencyComps = 0;
+      _latencyCompTooLong = 0;
       _sendMetronome = false;
       _prefader = false;
       _efxPipe  = new Pipeline();
       recFileNumber = 1;
+      _prefetchWritePos = ~0U;
+      _prefetchReadAhead = 1;
+      _prefetchLowWater = 100;
+      _frozen = false;
+      _freezeStale = false;
+      _freezeCaptured = 0;
       _channels = 0;
       _automationType = AUTO_OFF;
       setChannels(2);
@@ -328,8 +347,22 @@ AudioTrack::AudioTrack(const AudioTrack& t, int flags)
       {
       _processed      = false;
       _haveData       = false;
+      _auxSendsPending = false;
+      _latencyIn      = 0.0;
+      _latencyOut     = 0.0;
+      _latencyUpdated = false;
+      _latencyVisiting = false;
+      _inRouteLatencyComps = 0;
+      _latencyCompTooLong = 0;
       _efxPipe        = new Pipeline();                 // Start off with a new pipeline.
       recFileNumber = 1;
+      _prefetchWritePos = ~0U;
+      _prefetchReadAhead = 1;
+      _prefetchLowWater = 100;
+      // The freeze file belongs to the original track.
+      _frozen = false;
+      _freezeStale = false;
+      _freezeCaptured = 0;
 
       addController(new CtrlList(AC_VOLUME,"Volume",0.001,3.163 /* roughly 10 db */, VAL_LOG));
       addController(new CtrlList(AC_PAN, "Pan", -1.0, 1.0, VAL_LINEAR));
@@ -637,6 +670,14 @@ AudioTrack::~AudioTrack()
       if(_controls)
         delete[] _controls;
 
+      InRouteLatencyCompList* lcl = _inRouteLatencyComps;
+      if(lcl)
+      {
+        for(InRouteLatencyCompList::iterator i = lcl->begin(); i != lcl->end(); ++i)
+          delete i->compensator;
+        delete lcl;
+      }
+
       _controller.clearDelete();
 }
 
@@ -676,6 +717,8 @@ Part* AudioTrack::newPart(Part*, bool /*clone*/)
 
 void AudioTrack::addPlugin(PluginI* plugin, int idx)
 {
+  // The rack changed, the freeze file does not match it anymore.
+  invalidateFreeze();
   if (plugin == 0)
   {
     PluginI* oldPlugin = (*_efxPipe)[idx];
@@ -785,6 +828,8 @@ void AudioTrack::swapControllerIDX(int idx1, int idx2)
   if(idx1 == idx2 || idx1 < 0 || idx2 < 0 || idx1 >= MusECore::PipelineDepth || idx2 >= MusECore::PipelineDepth)
     return;
 
+  invalidateFreeze();
+
   CtrlList *cl;
   CtrlList *newcl;
   int id1 = (idx1 + 1) * AC_PLUGIN_CTL_BASE;
@@ -854,6 +899,8 @@ void AudioTrack::swapControllerIDX(int idx1, int idx2)
       continue;
     imacm->second.setAudioCtrlId(actrl);
   }
+
+  _controller.updateFlat();
 }
 
 //---------------------------------------------------------
@@ -1016,6 +1063,11 @@ void AudioTrack::setControllerMode(int ctlID, CtrlList::Mode m)
 
 //---------------------------------------------------------
 //   clearControllerEvents
+//   This and the AC event routines below are called by the
+//    audio thread's message handling. Their edits leave the
+//    flat copy of the list invalid, so lookups use the map
+//    until the next operation on the list rebuilds it. The
+//    gui edits automation through PendingOperationList.
 //---------------------------------------------------------
 
 void AudioTrack::clearControllerEvents(int id)
@@ -1096,7 +1148,9 @@ void AudioTrack::eraseACEvent(int id, int frame)
 
     iCtrl s = cl->find(frame);
     if(s != cl->end())
+    {
       cl->erase(s);
+    }
     return;
 }
 
@@ -1521,6 +1575,9 @@ void AudioTrack::writeProperties(int level, Xml& xml) const
                   (*ip)->writeConfiguration(level, xml);
             }
       _controller.write(level, xml);
+      // Last, so that reading the plugins above does not invalidate it.
+      if (_frozen)
+            xml.strTag(level, "freeze", QDir(MusEGlobal::museProject).relativeFilePath(_freezeFile.path()));
       }
 
 //---------------------------------------------------------
@@ -1648,9 +1705,24 @@ bool AudioTrack::readProperties(Xml& xml, const QString& tag)
                   l->setValueType(p->ctrlValueType(m));
                   l->setMode(p->ctrlMode(m));
                 }
+              // The track is not in the song yet.
+              l->updateFlat();
             }
       else if (tag == "midiMapper")
             _controller.midiControls()->read(xml);
+      else if (tag == "freeze") {
+            QString path = xml.parse1();
+            if (QFileInfo(path).isRelative())
+                  path = MusEGlobal::museProject + "/" + path;
+            // A missing freeze file just means the track runs normally again.
+            if (QFile::exists(path)) {
+                  SndFileR sf(new SndFile(path));
+                  if (sf.openRead(false))
+                        fprintf(stderr, "AudioTrack::readProperties: cannot open freeze file <%s>\n", path.toLocal8Bit().constData());
+                  else
+                        setFreezeFile(sf);
+                  }
+            }
       else
             return Track::readProperties(xml, tag);
       return false;
@@ -2338,6 +2410,18 @@ bool AudioAux::getData(unsigned pos, int ch, unsigned samples, float** data)
         }
       }
 
+      // Join point: Mix the aux sends in track list order. The order must not depend on
+      //  which tracks were processed first (or on which thread), so that serial and
+      //  parallel processing give identical results.
+      for(ciTrack it = tl->begin(); it != tl->end(); ++it)
+      {
+        if((*it)->isMidiTrack())
+          continue;
+        track = (AudioTrack*)(*it);
+        if(track->processed() && track->auxSendsPending())
+          track->mixAuxSends(samples);
+      }
+
       for (int i = 0; i < ch; ++i)
             data[i] = buffer[i % channels()];
       return true;
@@ -2481,6 +2565,121 @@ bool AudioTrack::prepareRecording()
             }
       return true;
 }
+//---------------------------------------------------------
+//   notePrefetchFill
+//---------------------------------------------------------
+
+void AudioTrack::notePrefetchFill(int percent)
+      {
+      int cur = _prefetchLowWater;
+      while (percent < cur && !_prefetchLowWater.compare_exchange_weak(cur, percent))
+            ;
+      }
+
+//---------------------------------------------------------
+//   readData
+//    called from prefetch thread or its workers
+//---------------------------------------------------------
+
+void AudioTrack::readData(unsigned pos, unsigned samples, float** bp, bool /*doSeek*/, bool overwrite)
+      {
+      if(overwrite)
+        for (int i = 0; i < channels(); ++i)
+            memset(bp[i], 0, samples * sizeof(float));
+
+      // The file ends where the song ended when it was frozen. Silence after that.
+      const unsigned len = _freezeFile.samples();
+      if(!off() && pos < len)
+      {
+        const unsigned n = std::min(samples, len - pos);
+        // Reads are not always consecutive (seeks, loops), always position the file.
+        _freezeFile.seek(pos, SEEK_SET);
+        _freezeFile.read(channels(), bp, n, overwrite);
+      }
+
+      if(overwrite && MusEGlobal::config.useDenormalBias) {
+            for (int i = 0; i < channels(); ++i)
+                  for (unsigned int j = 0; j < samples; ++j)
+                      bp[i][j] += MusEGlobal::denormalBias;
+            }
+      }
+
+//---------------------------------------------------------
+//   getFrozenData
+//    called from audio thread instead of getData() and
+//    the rack while frozen
+//---------------------------------------------------------
+
+bool AudioTrack::getFrozenData(unsigned framePos, int dstChannels, unsigned nframe, float** bp)
+{
+  if(!MusEGlobal::audio->isPlaying())
+    return false;
+
+  // When freewheeling, read data direct from file.
+  if(MusEGlobal::audio->freewheel())
+  {
+    readData(framePos, nframe, bp, false, true);
+    return true;
+  }
+
+  float* pf_buf[dstChannels];
+  unsigned pos;
+  if(_prefetchFifo.get(dstChannels, nframe, pf_buf, &pos))
+  {
+    fprintf(stderr, "AudioTrack::getFrozenData(%s) (A) fifo underrun\n", name().toLocal8Bit().constData());
+    return false;
+  }
+  while(pos < framePos)
+  {
+    if(_prefetchFifo.get(dstChannels, nframe, pf_buf, &pos))
+    {
+      fprintf(stderr, "AudioTrack::getFrozenData(%s) (B) fifo underrun\n", name().toLocal8Bit().constData());
+      return false;
+    }
+  }
+
+  for(int i = 0; i < dstChannels; ++i)
+    AL::dsp->cpy(bp[i], pf_buf[i], nframe, MusEGlobal::config.useDenormalBias);
+  return true;
+}
+
+//---------------------------------------------------------
+//   captureFreeze
+//    called from audio thread only
+//    Frame n of the file holds song frame n. Cycles before
+//     the transport has reached frame 0 are left out. After
+//     a jump back the file is written again from there. After
+//     a jump forward, or frames lost in an xrun, nothing more
+//     is written: _freezeCaptured stays short of the end and
+//     the render is discarded.
+//---------------------------------------------------------
+
+void AudioTrack::captureFreeze(unsigned framePos, int dstChannels, unsigned nframe, float** bp)
+{
+  if(!MusEGlobal::audio->bounce() || !MusEGlobal::audio->isPlaying())
+    return;
+  const unsigned captured = _freezeCaptured;
+  if(framePos > captured)
+    return;
+  if(framePos < captured)
+    _freezeCapture.seek(framePos, SEEK_SET);
+  _freezeCaptured = framePos + _freezeCapture.write(dstChannels, bp, nframe);
+}
+
+//---------------------------------------------------------
+//   setFreezeFile
+//    called from audio thread only
+//    The caller keeps a reference to the old file, so that
+//     it is not closed and deleted here.
+//---------------------------------------------------------
+
+void AudioTrack::setFreezeFile(SndFileR sf)
+      {
+      _freezeFile = sf;
+      _frozen = !sf.isNull();
+      _freezeStale = false;
+      }
+
 double AudioTrack::auxSend(int idx) const
       {
       if (unsigned(idx) >= _auxSend.size()) {
@@ -0,0 +1,482 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  autosave.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <mutex>
+#include <condition_variable>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include "autosave.h"
+#include "xml_compress.h"
+#include "xml.h"
+#include "pos.h"
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   AutoSaver
+//    Background thread writing the song snapshots taken
+//     by the gui, one at a time.
+//---------------------------------------------------------
+
+class AutoSaver {
+      std::mutex _mutex;
+      std::condition_variable _cond;
+      pthread_t _thread;
+      bool _running;
+      bool _quit;
+      // A job is queued or being written.
+      bool _busy;
+      bool _haveJob;
+      QString _path;
+      char* _data;
+      size_t _size;
+      AutoSaveEventList* _events;
+      // Events of the last finished job, freed by the gui thread.
+      AutoSaveEventList* _doneEvents;
+      int _backups;
+      long long _snapshotMs;
+      bool _haveResult;
+      AutoSaveResult _result;
+
+      static void* loop(void*);
+
+   public:
+      AutoSaver() : _running(false), _quit(false), _busy(false), _haveJob(false),
+                    _data(0), _size(0), _events(0), _doneEvents(0), _backups(0), _snapshotMs(0),
+                    _haveResult(false) {}
+      bool add(const QString& path, char* data, size_t size, AutoSaveEventList* events,
+               int backups, long long snapshotMs);
+      bool busy();
+      void wait();
+      bool takeResult(AutoSaveResult* r);
+      void stop();
+      };
+
+static AutoSaver autoSaver;
+
+// The snapshot being taken by the gui thread.
+static FILE* snapshotFile = 0;
+static AutoSaveEventList* snapshotEvents = 0;
+
+//---------------------------------------------------------
+//   insertEvents
+//    Returns in out (malloc'ed) the snapshot data with the
+//     deferred events written in at their offsets.
+//---------------------------------------------------------
+
+static bool insertEvents(const char* data, size_t size, const AutoSaveEventList* events,
+                         char** out, size_t* outSize, size_t* count)
+      {
+      *out = 0;
+      *outSize = 0;
+      *count = 0;
+      FILE* f = open_memstream(out, outSize);
+      if (f == 0)
+            return false;
+      Xml xml(f);
+      size_t pos = 0;
+      bool ok = true;
+      for (AutoSaveEventList::const_iterator i = events->begin(); i != events->end(); ++i) {
+            // The offsets grow, in the order the parts were written.
+            if (i->offset < pos || i->offset > size) {
+                  ok = false;
+                  break;
+                  }
+            fwrite(data + pos, 1, i->offset - pos, f);
+            pos = i->offset;
+            const Pos offset(i->tickOffset, true);
+            for (std::vector<Event>::const_iterator e = i->events.begin(); e != i->events.end(); ++e)
+                  e->write(i->level, xml, offset);
+            *count += i->events.size();
+            }
+      fwrite(data + pos, 1, size - pos, f);
+      ok = ok && !ferror(f);
+      fclose(f);
+      if (!ok) {
+            free(*out);
+            *out = 0;
+            }
+      return ok;
+      }
+
+//---------------------------------------------------------
+//   syncFile
+//---------------------------------------------------------
+
+static bool syncFile(const char* path, int flags)
+      {
+      const int fd = open(path, O_RDONLY | flags);
+      if (fd < 0)
+            return false;
+      const bool ok = fsync(fd) == 0;
+      close(fd);
+      return ok;
+      }
+
+//---------------------------------------------------------
+//   writeSnapshot
+//    Write data to a temporary file next to path, then
+//     rotate the backups and rename it over path.
+//---------------------------------------------------------
+
+static bool writeSnapshot(const QString& path, const char* data, size_t size, int backups, QString* error)
+      {
+      const QByteArray p   = path.toLocal8Bit();
+      const QByteArray tmp = p + ".tmp";
+      const QFileInfo info(path);
+
+      // gzip is compressed in-process, like MusE::save() does.
+      // bzip2 projects still go through the same tool as MusEGui::fileOpen().
+      QByteArray packed;
+      const XmlCompression compression = xmlCompressionFromName(path);
+      if (compression != XmlNoCompression) {
+            if (!xmlCompress(compression, data, size, &packed)) {
+                  *error = QString("compression failed");
+                  return false;
+                  }
+            data = packed.constData();
+            size = packed.size();
+            }
+      const bool bzip2 = info.suffix() == "bz2";
+
+      FILE* f;
+      if (bzip2)
+            f = popen((QString("bzip2 > \"") + path + QString(".tmp\"")).toLocal8Bit().constData(), "w");
+      else
+            f = fopen(tmp.constData(), "w");
+      if (!f) {
+            *error = QString(strerror(errno));
+            return false;
+            }
+
+      bool ok = fwrite(data, 1, size, f) == size && fflush(f) == 0;
+      if (!ok)
+            *error = QString(strerror(errno));
+      if (bzip2) {
+            if (pclose(f) != 0 && ok) {
+                  ok = false;
+                  *error = QString("bzip2 failed");
+                  }
+            }
+      else if (fclose(f) != 0 && ok) {
+            ok = false;
+            *error = QString(strerror(errno));
+            }
+      // Make sure the contents are on disk before the rename makes them the project.
+      if (ok && !syncFile(tmp.constData(), 0)) {
+            ok = false;
+            *error = QString(strerror(errno));
+            }
+      if (!ok) {
+            unlink(tmp.constData());
+            return false;
+            }
+
+      // Rotate the backups, the oldest one drops out.
+      if (backups > 0 && access(p.constData(), F_OK) == 0) {
+            for (int i = backups - 1; i >= 1; --i) {
+                  const QByteArray from = p + ".autosave." + QByteArray::number(i);
+                  const QByteArray to   = p + ".autosave." + QByteArray::number(i + 1);
+                  rename(from.constData(), to.constData());
+                  }
+            const QByteArray b1 = p + ".autosave.1";
+            unlink(b1.constData());
+            // Keep the project in place until the new one atomically replaces it.
+            // Without hard link support fall back to moving it.
+            if (link(p.constData(), b1.constData()) != 0)
+                  rename(p.constData(), b1.constData());
+            }
+
+      if (rename(tmp.constData(), p.constData()) != 0) {
+            *error = QString(strerror(errno));
+            unlink(tmp.constData());
+            return false;
+            }
+      syncFile(QFile::encodeName(info.absolutePath()).constData(), O_DIRECTORY);
+      return true;
+      }
+
+//---------------------------------------------------------
+//   loop
+//---------------------------------------------------------
+
+void* AutoSaver::loop(void* arg)
+      {
+      AutoSaver* s = (AutoSaver*)arg;
+      for (;;) {
+            QString path;
+            char* data;
+            size_t size;
+            AutoSaveEventList* events;
+            int backups;
+            long long snapshotMs;
+            {
+            std::unique_lock<std::mutex> lock(s->_mutex);
+            while (!s->_quit && !s->_haveJob)
+                  s->_cond.wait(lock);
+            // At quit, a queued job is still written.
+            if (!s->_haveJob)
+                  break;
+            path       = s->_path;
+            data       = s->_data;
+            size       = s->_size;
+            events     = s->_events;
+            backups    = s->_backups;
+            snapshotMs = s->_snapshotMs;
+            s->_haveJob = false;
+            s->_data    = 0;
+            s->_events  = 0;
+            }
+
+            AutoSaveResult r;
+            QElapsedTimer timer;
+            timer.start();
+            r.events = 0;
+            if (events && !events->empty()) {
+                  char* full;
+                  size_t fullSize;
+                  if (insertEvents(data, size, events, &full, &fullSize, &r.events)) {
+                        free(data);
+                        data = full;
+                        size = fullSize;
+                        r.ok = true;
+                        }
+                  else {
+                        r.ok    = false;
+                        r.error = QString("cannot serialize the events");
+                        }
+                  }
+            else
+                  r.ok = true;
+            if (r.ok)
+                  r.ok = writeSnapshot(path, data, size, backups, &r.error);
+            r.writeMs    = timer.elapsed();
+            r.path       = path;
+            r.bytes      = size;
+            r.snapshotMs = snapshotMs;
+            free(data);
+
+            std::lock_guard<std::mutex> guard(s->_mutex);
+            s->_doneEvents = events;
+            s->_result     = r;
+            s->_haveResult = true;
+            s->_busy       = false;
+            s->_cond.notify_all();
+            }
+      return 0;
+      }
+
+//---------------------------------------------------------
+//   add
+//---------------------------------------------------------
+
+bool AutoSaver::add(const QString& path, char* data, size_t size, AutoSaveEventList* events,
+                    int backups, long long snapshotMs)
+      {
+      std::lock_guard<std::mutex> guard(_mutex);
+      delete _doneEvents;
+      _doneEvents = 0;
+      if (_quit || _busy) {
+            free(data);
+            delete events;
+            return false;
+            }
+      if (!_running) {
+            if (pthread_create(&_thread, 0, loop, this)) {
+                  fprintf(stderr, "AutoSaver: cannot create thread: %s\n", strerror(errno));
+                  free(data);
+                  delete events;
+                  return false;
+                  }
+            _running = true;
+            }
+      _path       = path;
+      _data       = data;
+      _size       = size;
+      _events     = events;
+      _backups    = backups;
+      _snapshotMs = snapshotMs;
+      _haveJob    = true;
+      _busy       = true;
+      _cond.notify_all();
+      return true;
+      }
+
+//---------------------------------------------------------
+//   busy
+//---------------------------------------------------------
+
+bool AutoSaver::busy()
+      {
+      std::lock_guard<std::mutex> guard(_mutex);
+      return _busy;
+      }
+
+//---------------------------------------------------------
+//   wait
+//---------------------------------------------------------
+
+void AutoSaver::wait()
+      {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (_busy && _running)
+            _cond.wait(lock);
+      }
+
+//---------------------------------------------------------
+//   takeResult
+//---------------------------------------------------------
+
+bool AutoSaver::takeResult(AutoSaveResult* r)
+      {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if (!_haveResult)
+            return false;
+      *r = _result;
+      _haveResult = false;
+      delete _doneEvents;
+      _doneEvents = 0;
+      return true;
+      }
+
+//---------------------------------------------------------
+//   stop
+//---------------------------------------------------------
+
+void AutoSaver::stop()
+      {
+      {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _quit = true;
+      _cond.notify_all();
+      if (!_running)
+            return;
+      }
+      pthread_join(_thread, 0);
+      _running = false;
+      delete _doneEvents;
+      _doneEvents = 0;
+      }
+
+//---------------------------------------------------------
+//   beginAutoSaveSnapshot
+//---------------------------------------------------------
+
+void beginAutoSaveSnapshot(FILE* f)
+      {
+      snapshotFile   = f;
+      snapshotEvents = new AutoSaveEventList;
+      }
+
+//---------------------------------------------------------
+//   endAutoSaveSnapshot
+//---------------------------------------------------------
+
+AutoSaveEventList* endAutoSaveSnapshot()
+      {
+      AutoSaveEventList* events = snapshotEvents;
+      snapshotFile   = 0;
+      snapshotEvents = 0;
+      return events;
+      }
+
+//---------------------------------------------------------
+//   deferAutoSaveEvents
+//---------------------------------------------------------
+
+bool deferAutoSaveEvents(int level, const EventList& el, const Pos& offset)
+      {
+      if (!snapshotEvents || el.empty())
+            return false;
+      // The memory stream's size, where the events would go.
+      const long pos = ftell(snapshotFile);
+      if (pos < 0)
+            return false;
+      snapshotEvents->push_back(AutoSaveEvents());
+      AutoSaveEvents& ae = snapshotEvents->back();
+      ae.offset     = size_t(pos);
+      ae.level      = level;
+      ae.tickOffset = offset.tick();
+      ae.events.reserve(el.size());
+      for (ciEvent e = el.begin(); e != el.end(); ++e)
+            ae.events.push_back(e->second);
+      return true;
+      }
+
+//---------------------------------------------------------
+//   autoSaveSnapshot
+//---------------------------------------------------------
+
+bool autoSaveSnapshot(const QString& path, char* data, size_t size, AutoSaveEventList* events,
+                      int backups, long long snapshotMs)
+      {
+      return autoSaver.add(path, data, size, events, backups, snapshotMs);
+      }
+
+//---------------------------------------------------------
+//   autoSaveBusy
+//---------------------------------------------------------
+
+bool autoSaveBusy()
+      {
+      return autoSaver.busy();
+      }
+
+//---------------------------------------------------------
+//   waitAutoSave
+//---------------------------------------------------------
+
+void waitAutoSave()
+      {
+      autoSaver.wait();
+      }
+
+//---------------------------------------------------------
+//   takeAutoSaveResult
+//---------------------------------------------------------
+
+bool takeAutoSaveResult(AutoSaveResult* r)
+      {
+      return autoSaver.takeResult(r);
+      }
+
+//---------------------------------------------------------
+//   exitAutoSaver
+//---------------------------------------------------------
+
+void exitAutoSaver()
+      {
+      autoSaver.stop();
+      }
+
+} // namespace MusECore
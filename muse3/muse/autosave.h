@@ -0,0 +1,97 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  autosave.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __AUTOSAVE_H__
+#define __AUTOSAVE_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+#include <QString>
+
+#include "event.h"
+
+namespace MusECore {
+
+class Pos;
+
+//---------------------------------------------------------
+//   AutoSaveEvents
+//    The events of a midi part, copied by the gui thread
+//     while taking a snapshot. The background thread
+//     writes them into the snapshot at offset.
+//    The copies share the events' data, which is not
+//     changed in place once the events are in a part.
+//     They are only destroyed in the gui thread.
+//---------------------------------------------------------
+
+struct AutoSaveEvents {
+      size_t offset;
+      int level;
+      unsigned tickOffset;
+      std::vector<Event> events;
+      };
+
+typedef std::vector<AutoSaveEvents> AutoSaveEventList;
+
+//---------------------------------------------------------
+//   AutoSaveResult
+//    Report of a finished background save.
+//---------------------------------------------------------
+
+struct AutoSaveResult {
+      bool ok;
+      QString path;
+      QString error;
+      size_t bytes;         // Size of the serialized song.
+      size_t events;        // Midi events serialized in the background.
+      long long snapshotMs; // Serializing in the gui thread.
+      long long writeMs;    // Serializing the events, writing, syncing and renaming
+                            //  in the background.
+      };
+
+// Gui thread. Between these, Part::write() calls deferAutoSaveEvents() for midi parts,
+//  which remembers the events and where they go in f instead of writing them.
+extern void beginAutoSaveSnapshot(FILE* f);
+extern AutoSaveEventList* endAutoSaveSnapshot();
+// Returns false if no snapshot is being taken, the events must be written then.
+extern bool deferAutoSaveEvents(int level, const EventList& el, const Pos& offset);
+// Takes ownership of data (malloc'ed, as from open_memstream()) holding a serialized
+//  song, and of the events taken out of it by the snapshot. Inserts the events and
+//  writes it to path on the background thread: Into a temporary file first,
+//  which then atomically replaces path. The replaced file is kept as the newest of
+//  'backups' rotating copies path.autosave.1 ... path.autosave.<backups>.
+// Returns false if a save is still in progress, data and events are freed then.
+extern bool autoSaveSnapshot(const QString& path, char* data, size_t size, AutoSaveEventList* events,
+                             int backups, long long snapshotMs);
+// Whether a background save is queued or running.
+extern bool autoSaveBusy();
+// Waits until any background save has finished. Call before writing the project otherwise.
+extern void waitAutoSave();
+// Gui thread. Takes the report of the last finished save. Returns false if there is none.
+extern bool takeAutoSaveResult(AutoSaveResult* r);
+// Finishes any pending save and stops the background thread, at exit.
+extern void exitAutoSaver();
+
+} // namespace MusECore
+
+#endif
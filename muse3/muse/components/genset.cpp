@@ -204,6 +204,8 @@ void GlobalSettingsConfig::updateSettings()
       denormalCheckBox->setChecked(MusEGlobal::config.useDenormalBias);
       outputLimiterCheckBox->setChecked(MusEGlobal::config.useOutputLimiter);
       vstInPlaceCheckBox->setChecked(MusEGlobal::config.vstInPlace);
+      latencyCompensationCheckBox->setChecked(MusEGlobal::config.latencyCompensation);
+      audioWorkerThreadsSpinBox->setValue(MusEGlobal::config.audioWorkerThreads < 0 ? -1 : MusEGlobal::config.audioWorkerThreads);
 
       deviceAudioBackendComboBox->setCurrentIndex(MusEGlobal::config.deviceAudioBackend);
 
@@ -358,6 +360,8 @@ void GlobalSettingsConfig::apply()
 
       int mcp = minControlProcessPeriodComboBox->currentIndex();
       MusEGlobal::config.minControlProcessPeriod = minControlProcessPeriods[mcp];
+      MusEGlobal::config.audioWorkerThreads = audioWorkerThreadsSpinBox->value();
+      MusEGlobal::config.latencyCompensation = latencyCompensationCheckBox->isChecked();
 
       int div            = midiDivisionSelect->currentIndex();
       MusEGlobal::config.division    = divisions[div];
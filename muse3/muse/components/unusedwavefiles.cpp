@@ -30,6 +30,7 @@
 #include "ui_unusedwavefiles.h"
 #include "globals.h"
 #include "app.h"
+#include "peakfile.h"
 
 namespace MusEGui {
 
@@ -112,13 +113,16 @@ void UnusedWaveFiles::accept()
 
         foreach(QString file, allWaveFiles) {
             QFile::rename(MusEGlobal::museProject+ "/"+file, MusEGlobal::museProject + "/unused/" +file);
-            // move the wca file if it exists
+            // move the peak files if they exist, also the old format wca written by older versions
             QFileInfo wf(MusEGlobal::museProject + "/" + file);
             if (QFile::exists(MusEGlobal::museProject + "/" + wf.baseName()+".wca")) {
                 QFile::rename(MusEGlobal::museProject + "/" + wf.baseName()+".wca",
                               MusEGlobal::museProject + "/unused/" +wf.baseName()+".wca");
 
             }
+            QFileInfo pf(MusECore::peakFilePath(wf.filePath()));
+            if (pf.exists())
+                QFile::rename(pf.filePath(), MusEGlobal::museProject + "/unused/" + pf.fileName());
         }
     }
     QDialog::accept();
@@ -1105,6 +1105,18 @@ void readConfiguration(Xml& xml, bool doReadMidiPortConfig, bool doReadGlobalCon
 
                         else if (tag == "minControlProcessPeriod")
                               MusEGlobal::config.minControlProcessPeriod = xml.parseUInt();
+                        else if (tag == "audioWorkerThreads")
+                              MusEGlobal::config.audioWorkerThreads = xml.parseInt();
+                        else if (tag == "latencyCompensation")
+                              MusEGlobal::config.latencyCompensation = xml.parseInt();
+                        else if (tag == "prefetchWorkerThreads")
+                              MusEGlobal::config.prefetchWorkerThreads = xml.parseInt();
+                        else if (tag == "diskReadAheadHints")
+                              MusEGlobal::config.diskReadAheadHints = xml.parseInt();
+                        else if (tag == "waveTileCacheSize")
+                              MusEGlobal::config.waveTileCacheSize = xml.parseInt();
+                        else if (tag == "autoSaveBackups")
+                              MusEGlobal::config.autoSaveBackups = xml.parseInt();
                         else if (tag == "guiRefresh")
                               MusEGlobal::config.guiRefresh = xml.parseInt();
                         else if (tag == "userInstrumentsDir")                        // Obsolete
@@ -1660,6 +1672,12 @@ void MusE::writeGlobalConfiguration(int level, MusECore::Xml& xml) const
 
 
       xml.uintTag(level, "minControlProcessPeriod", MusEGlobal::config.minControlProcessPeriod);
+      xml.intTag(level, "audioWorkerThreads", MusEGlobal::config.audioWorkerThreads);
+      xml.intTag(level, "latencyCompensation", MusEGlobal::config.latencyCompensation);
+      xml.intTag(level, "prefetchWorkerThreads", MusEGlobal::config.prefetchWorkerThreads);
+      xml.intTag(level, "diskReadAheadHints", MusEGlobal::config.diskReadAheadHints);
+      xml.intTag(level, "waveTileCacheSize", MusEGlobal::config.waveTileCacheSize);
+      xml.intTag(level, "autoSaveBackups", MusEGlobal::config.autoSaveBackups);
       xml.intTag(level, "guiRefresh", MusEGlobal::config.guiRefresh);
       
       xml.intTag(level, "extendedMidi", MusEGlobal::config.extendedMidi);
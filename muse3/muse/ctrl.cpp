@@ -36,6 +36,7 @@
 #include "fastlog.h"
 #include "globals.h"
 #include "ctrl.h"
+#include "plugin_runs.h"
 #include "midictrl.h"
 #include "xml.h"
 
@@ -52,6 +53,108 @@ void CtrlList::initColor(int i)
   _visible = false;
 }
 
+void CtrlList::initFlat()
+{
+  _flatValid = true;
+}
+
+//---------------------------------------------------------
+//   flatFrameLess
+//---------------------------------------------------------
+
+static bool flatFrameLess(unsigned int frame, const CtrlVal& v)
+{
+  return frame < v.frame;
+}
+
+//---------------------------------------------------------
+//   findFrame
+//   Sets next to the first item after frame, like upper_bound(), and prev
+//    to the one before it. Either is null if there is none.
+//   Uses the flat copy if valid. Since playback moves forward, the item
+//    found last time by the caller (cursor) and the few after it are tried
+//    before searching. The cursor is only a hint, any value is safe.
+//---------------------------------------------------------
+
+void CtrlList::findFrame(unsigned int frame, const CtrlVal** prev, const CtrlVal** next, unsigned int* cursor) const
+{
+  if(!_flatValid)
+  {
+    ciCtrl i = upper_bound(frame);
+    *next = (i == end()) ? 0 : &i->second;
+    *prev = (i == begin()) ? 0 : &(--i)->second;
+    return;
+  }
+
+  const unsigned int sz = _flat.size();
+  const CtrlVal* f = _flat.empty() ? 0 : &_flat[0];
+  unsigned int c = cursor ? *cursor : 0;
+  bool found = false;
+  if(cursor && c <= sz && (c == 0 || f[c - 1].frame <= frame))
+  {
+    for(int k = 0; k < 4; ++k, ++c)
+    {
+      if(c == sz || f[c].frame > frame)
+      {
+        found = true;
+        break;
+      }
+    }
+  }
+  if(!found)
+    c = std::upper_bound(_flat.begin(), _flat.end(), frame, flatFrameLess) - _flat.begin();
+  if(cursor)
+    *cursor = c;
+  *next = (c == sz) ? 0 : &f[c];
+  *prev = (c == 0) ? 0 : &f[c - 1];
+}
+
+//---------------------------------------------------------
+//   updateFlat
+//---------------------------------------------------------
+
+void CtrlList::updateFlat()
+{
+  _flatSpare.clear();
+  _flatSpare.reserve(size());
+  for(ciCtrl i = begin(); i != end(); ++i)
+    _flatSpare.push_back(CtrlVal(i->first, i->second.val));
+  _flat.swap(_flatSpare);
+  _flatValid = true;
+}
+
+//---------------------------------------------------------
+//   reserveFlat
+//---------------------------------------------------------
+
+void CtrlList::reserveFlat(size_type adds)
+{
+  const size_type sz = size() + adds;
+  if(_flatSpare.capacity() < sz)
+    _flatSpare.reserve(sz + sz / 2);
+}
+
+//---------------------------------------------------------
+//   releaseFlatSpare
+//---------------------------------------------------------
+
+void CtrlList::releaseFlatSpare()
+{
+  std::vector<CtrlVal>().swap(_flatSpare);
+}
+
+//---------------------------------------------------------
+//   memoryUsage
+//---------------------------------------------------------
+
+size_t CtrlList::memoryUsage(size_t* flatBytes) const
+{
+  if(flatBytes)
+    *flatBytes = (_flat.capacity() + _flatSpare.capacity()) * sizeof(CtrlVal);
+  // A map node holds the item, three links and the colour.
+  return size() * (sizeof(value_type) + 4 * sizeof(void*));
+}
+
 //---------------------------------------------------------
 //   midi2AudioCtrlValue
 //   Apply mapper if it is non-null
@@ -328,6 +431,7 @@ CtrlList::CtrlList(bool dontShow)
       _visible = false;
       _guiUpdatePending = false;
       initColor(0);
+      initFlat();
       }
 
 CtrlList::CtrlList(int id, bool dontShow)
@@ -340,6 +444,7 @@ CtrlList::CtrlList(int id, bool dontShow)
       _visible = false;
       _guiUpdatePending = false;
       initColor(id);
+      initFlat();
       }
 
 CtrlList::CtrlList(int id, QString name, double min, double max, CtrlValueType v, bool dontShow)
@@ -356,13 +461,18 @@ CtrlList::CtrlList(int id, QString name, double min, double max, CtrlValueType v
       _visible = false;
       _guiUpdatePending = false;
       initColor(id);
+      initFlat();
 }
 
 CtrlList::CtrlList(const CtrlList& l, int flags)
 {
   _id        = l._id;
   _valueType = l._valueType;
+  initFlat();
   assign(l, flags | ASSIGN_PROPERTIES);
+  // Not published yet.
+  if(flags & ASSIGN_VALUES)
+    updateFlat();
 }
 
 //---------------------------------------------------------
@@ -387,6 +497,7 @@ void CtrlList::assign(const CtrlList& l, int flags)
   if(flags & ASSIGN_VALUES)
   {
     CtrlList_t::operator=(l); // Let map copy the items.
+    _flatValid = false;
     _guiUpdatePending = true;
   }
 }
@@ -412,59 +523,58 @@ void CtrlList::getInterpolation(unsigned int frame, bool cur_val_only, CtrlInter
     interp->doInterp = false;
     return;
   }
-  ciCtrl i = upper_bound(frame); // get the index after current frame
-  if (i == end())   // if we are past all items just return the last value
+  const CtrlVal* prev;
+  const CtrlVal* next;
+  findFrame(frame, &prev, &next, &interp->flatCursor);
+  if (!next)   // if we are past all items just return the last value
   { 
-        --i;
         interp->sFrame = 0;
         interp->eFrame = 0;
         interp->eFrameValid = false;
-        interp->sVal = i->second.val;
-        interp->eVal = i->second.val;
+        interp->sVal = prev->val;
+        interp->eVal = prev->val;
         interp->doInterp = false;
         return;
   }
   else if(_mode == DISCRETE)
   {
-    if(i == begin())
+    if(!prev)
     {
       interp->sFrame = 0;
-      interp->eFrame = i->second.frame;
+      interp->eFrame = next->frame;
       interp->eFrameValid = true;
-      interp->sVal = i->second.val;
-      interp->eVal = i->second.val;
+      interp->sVal = next->val;
+      interp->eVal = next->val;
       interp->doInterp = false;
     }
     else
     {
-      interp->eFrame = i->second.frame;
+      interp->eFrame = next->frame;
       interp->eFrameValid = true;
-      interp->eVal = i->second.val;
-      --i;
-      interp->sFrame = i->second.frame;
-      interp->sVal = i->second.val;
+      interp->eVal = next->val;
+      interp->sFrame = prev->frame;
+      interp->sVal = prev->val;
       interp->doInterp = false;
     }
   }
   else   // INTERPOLATE
   {                  
-    if(i == begin())
+    if(!prev)
     {
       interp->sFrame = 0;
-      interp->eFrame = i->second.frame;
+      interp->eFrame = next->frame;
       interp->eFrameValid = true;
-      interp->sVal = i->second.val;
-      interp->eVal = i->second.val;
+      interp->sVal = next->val;
+      interp->eVal = next->val;
       interp->doInterp = false;
     }
     else
     {
-      interp->eFrame = i->second.frame;
+      interp->eFrame = next->frame;
       interp->eFrameValid = true;
-      interp->eVal = i->second.val;
-      --i;
-      interp->sFrame = i->second.frame;
-      interp->sVal = i->second.val;
+      interp->eVal = next->val;
+      interp->sFrame = prev->frame;
+      interp->sVal = prev->val;
       interp->doInterp = (interp->eVal != interp->sVal && interp->eFrame > interp->sFrame);
     }
   }
@@ -520,6 +630,91 @@ double CtrlList::interpolate(unsigned int frame, const CtrlInterpolate& interp)
   return val1;
 }
 
+//---------------------------------------------------------
+//   interpolateBuffer
+//   Fills buf with the interpolated values of n frames starting at frame,
+//    from a CtrlInterpolate struct. Frames past its end get the end value,
+//    the caller is responsible for moving on to the next segment there.
+//---------------------------------------------------------
+
+void CtrlList::interpolateBuffer(unsigned int frame, unsigned int n, const CtrlInterpolate& interp, float* buf)
+{
+  unsigned int i = 0;
+  if(interp.doInterp && interp.eFrameValid && frame >= interp.sFrame && frame < interp.eFrame)
+  {
+    unsigned int ramp = interp.eFrame - frame;
+    if(ramp > n)
+      ramp = n;
+    const double frames = double(interp.eFrame - interp.sFrame);
+    double v = interpolate(frame, interp);
+    if(_valueType == VAL_LOG)
+    {
+      // Linear in dB means a constant factor per frame.
+      double val1 = 20.0*fast_log10(interp.sVal);
+      if (val1 < MusEGlobal::config.minSlider)
+        val1=MusEGlobal::config.minSlider;
+      double val2 = 20.0*fast_log10(interp.eVal);
+      if (val2 < MusEGlobal::config.minSlider)
+        val2=MusEGlobal::config.minSlider;
+      const double factor = exp10((val2 - val1) / (20.0 * frames));
+      for( ; i < ramp; ++i)
+      {
+        buf[i] = v;
+        v *= factor;
+      }
+    }
+    else
+    {
+      const double step = (interp.eVal - interp.sVal) / frames;
+      for( ; i < ramp; ++i)
+      {
+        buf[i] = v;
+        v += step;
+      }
+    }
+  }
+  if(i < n)
+  {
+    const float v = interp.doInterp ? interpolate(frame + i, interp) : interp.sVal;
+    for( ; i < n; ++i)
+      buf[i] = v;
+  }
+}
+
+//---------------------------------------------------------
+//   rampFrames
+//   Returns how many frames after frame the interpolated value has moved
+//    by 1/steps of the controller's range (in dB for VAL_LOG), at most
+//    up to the end of the segment. Zero if the segment is endless.
+//   Plugins without per sample control ports need not run more often
+//    than that during a ramp.
+//---------------------------------------------------------
+
+unsigned int CtrlList::rampFrames(unsigned int frame, const CtrlInterpolate& interp, double steps) const
+{
+  if(!interp.eFrameValid)
+    return 0;
+  if(frame >= interp.eFrame)
+    return 0;
+  if(!interp.doInterp)
+    return interp.eFrame - frame;
+
+  double val1 = interp.sVal;
+  double val2 = interp.eVal;
+  double range = _max - _min;
+  if(_valueType == VAL_LOG)
+  {
+    val1 = 20.0*fast_log10(val1);
+    if (val1 < MusEGlobal::config.minSlider)
+      val1=MusEGlobal::config.minSlider;
+    val2 = 20.0*fast_log10(val2);
+    if (val2 < MusEGlobal::config.minSlider)
+      val2=MusEGlobal::config.minSlider;
+    range = 20.0*fast_log10(_max) - MusEGlobal::config.minSlider;
+  }
+  return rampStepFrames(frame, interp.sFrame, interp.eFrame, val1, val2, range, steps);
+}
+
 //---------------------------------------------------------
 //   value
 //   Returns value at frame.
@@ -542,40 +737,39 @@ double CtrlList::value(unsigned int frame, bool cur_val_only, unsigned int* next
       double rv;
       unsigned int nframe;
 
-      ciCtrl i = upper_bound(frame); // get the index after current frame
-      if (i == end()) { // if we are past all items just return the last value
-            --i;
+      const CtrlVal* prev;
+      const CtrlVal* next;
+      findFrame(frame, &prev, &next);
+      if (!next) { // if we are past all items just return the last value
             if(nextFrameValid)
               *nextFrameValid = false;
             if(nextFrame)
               *nextFrame = 0;
-            return i->second.val;
+            return prev->val;
             }
       else if(_mode == DISCRETE)
       {
-        if(i == begin())
+        if(!prev)
         {
-            nframe = i->second.frame;
-            rv = i->second.val;
+            nframe = next->frame;
+            rv = next->val;
         }  
         else
         {  
-          nframe = i->second.frame;
-          --i;
-          rv = i->second.val;
+          nframe = next->frame;
+          rv = prev->val;
         }  
       }
       else {                  // INTERPOLATE
-        if (i == begin()) {
-            nframe = i->second.frame;
-            rv = i->second.val;
+        if (!prev) {
+            nframe = next->frame;
+            rv = next->val;
         }
         else {
-            const unsigned int frame2 = i->second.frame;
-            double val2 = i->second.val;
-            --i;
-            const unsigned int frame1 = i->second.frame;
-            double val1   = i->second.val;
+            const unsigned int frame2 = next->frame;
+            double val2 = next->val;
+            const unsigned int frame1 = prev->frame;
+            double val1   = prev->val;
 
             
             if(val2 != val1)
@@ -663,6 +857,7 @@ CtrlList& CtrlList::operator=(const CtrlList& cl)
   
   // Let map copy the items.
   CtrlList_t::operator=(cl);
+  _flatValid = false;
   _guiUpdatePending = true;
   return *this;
 }
@@ -673,6 +868,8 @@ void CtrlList::swap(CtrlList& cl)
   printf("CtrlList::swap id:%d\n", cl.id());  
 #endif
   CtrlList_t::swap(cl);
+  cl.invalidateFlat();
+  _flatValid = false;
   cl.setGuiUpdatePending(true);
   _guiUpdatePending = true;
 }
@@ -683,6 +880,7 @@ std::pair<iCtrl, bool> CtrlList::insert(const CtrlListInsertPair_t& p)
   printf("CtrlList::insert frame:%u val:%f\n", p.first, p.second.val);  
 #endif
   std::pair<iCtrl, bool> res = CtrlList_t::insert(p);
+  _flatValid = false;
   _guiUpdatePending = true;
   return res;
 }
@@ -693,6 +891,7 @@ iCtrl CtrlList::insert(iCtrl ic, const CtrlListInsertPair_t& p)
   printf("CtrlList::insert2 frame:%u val:%f\n", p.first, p.second.val); 
 #endif
   iCtrl res = CtrlList_t::insert(ic, p);
+  _flatValid = false;
   _guiUpdatePending = true;
   return res;
 }
@@ -703,6 +902,7 @@ void CtrlList::insert(iCtrl first, iCtrl last)
   printf("CtrlList::insert3 first frame:%u last frame:%d\n", first->first, last->first); 
 #endif
   CtrlList_t::insert(first, last);
+  _flatValid = false;
   _guiUpdatePending = true;
 }
 
@@ -712,6 +912,7 @@ void CtrlList::erase(iCtrl ictl)
   printf("CtrlList::erase iCtrl frame:%u val:%f\n", ictl->second.frame, ictl->second.val);  
 #endif
   CtrlList_t::erase(ictl);
+  _flatValid = false;
   _guiUpdatePending = true;
 }
 
@@ -721,6 +922,7 @@ CtrlList_t::size_type CtrlList::erase(unsigned int frame)
   printf("CtrlList::erase frame:%u\n", frame);  
 #endif
   size_type res = CtrlList_t::erase(frame);
+  _flatValid = false;
   _guiUpdatePending = true;
   return res;
 }
@@ -733,6 +935,7 @@ void CtrlList::erase(iCtrl first, iCtrl last)
          last->second.frame, last->second.val);  
 #endif
   CtrlList_t::erase(first, last);
+  _flatValid = false;
   _guiUpdatePending = true;
 }
 
@@ -742,6 +945,7 @@ void CtrlList::clear()
   printf("CtrlList::clear\n");  
 #endif
   CtrlList_t::clear();
+  _flatValid = false;
   _guiUpdatePending = true;
 }
 
@@ -757,6 +961,7 @@ void CtrlList::add(unsigned int frame, double val)
       {
             bool upd = (val != e->second.val);
             e->second.val = val;
+            _flatValid = false;
 #ifdef _CTRL_DEBUG_
             printf("CtrlList::add frame:%u val:%f\n", frame, val);  
 #endif
@@ -960,6 +1165,42 @@ void CtrlListList::updateCurValues(unsigned int frame)
     cl->second->updateCurValue(frame);
 }
 
+//---------------------------------------------------------
+//   updateFlat
+//---------------------------------------------------------
+
+void CtrlListList::updateFlat()
+{
+  for(iCtrlList cl = begin(); cl != end(); ++cl)
+  {
+    if(!cl->second->flatValid())
+      cl->second->updateFlat();
+  }
+}
+
+//---------------------------------------------------------
+//   memoryUsage
+//---------------------------------------------------------
+
+size_t CtrlListList::memoryUsage(size_t* flatBytes, size_t* items) const
+{
+  size_t bytes = 0;
+  if(flatBytes)
+    *flatBytes = 0;
+  if(items)
+    *items = 0;
+  for(ciCtrlList cl = begin(); cl != end(); ++cl)
+  {
+    size_t fb;
+    bytes += cl->second->memoryUsage(&fb);
+    if(flatBytes)
+      *flatBytes += fb;
+    if(items)
+      *items += cl->second->size();
+  }
+  return bytes;
+}
+
 //---------------------------------------------------------
 //   value
 //---------------------------------------------------------
@@ -72,6 +72,8 @@ struct CtrlInterpolate {
                          //  set this true and replace eFrame and eVal. Upon the next run slice, if eStop is set, eval
                          //  should be copied to sVal, eFrame to sFrame, doInterp cleared, and eFrame set to some frame or eFrameValid false.
       bool   doInterp;   // Whether to actually interpolate whenever this struct is passed to CtrlList::interpolate().
+      unsigned int flatCursor; // Just a hint for CtrlList::getInterpolation(): Index in the flat copy found last time.
+                               // Each caller keeps its own, so threads never share one.
       CtrlInterpolate(unsigned int sframe = 0, unsigned int eframe = 0, bool eframevalid = false, double sval = 0.0, double eval = 0.0,
                       bool end_stop = false, bool do_interpolate = false) {
             sFrame = sframe;
@@ -81,6 +83,7 @@ struct CtrlInterpolate {
             eVal   = eval;
             eStop = end_stop;
             doInterp = do_interpolate;
+            flatCursor = 0;
             }
       };
 
@@ -188,7 +191,17 @@ class CtrlList : public CtrlList_t {
       bool _visible;
       bool _dontShow; // when this is true the control exists but is not compatible with viewing in the arranger
       volatile bool _guiUpdatePending; // Gui heartbeat routines read this. Checked and cleared in Song::beat().
+      // Sorted copy of the items in one contiguous array, for fast lookups during playback.
+      // Only used while _flatValid is set, see updateFlat().
+      // Costs 16 bytes per item, up to 24 after reserveFlat() made room for additions,
+      //  next to the roughly 56 bytes of a map node. Printed by Song::read() with -D.
+      std::vector<CtrlVal> _flat;
+      std::vector<CtrlVal> _flatSpare;   // Next _flat, allocated ahead of time. Only kept during operations.
+      volatile bool _flatValid;
       void initColor(int i);
+      void initFlat();
+      // cursor: The caller's hint, see CtrlInterpolate::flatCursor. Null to always search.
+      void findFrame(unsigned int frame, const CtrlVal** prev, const CtrlVal** next, unsigned int* cursor = NULL) const;
 
    public:
       CtrlList(bool dontShow=false);
@@ -231,6 +244,8 @@ class CtrlList : public CtrlList_t {
       void setValueType(CtrlValueType t) { _valueType = t; }
       void getInterpolation(unsigned int frame, bool cur_val_only, CtrlInterpolate* interp);
       double interpolate(unsigned int frame, const CtrlInterpolate& interp);
+      void interpolateBuffer(unsigned int frame, unsigned int n, const CtrlInterpolate& interp, float* buf);
+      unsigned int rampFrames(unsigned int frame, const CtrlInterpolate& interp, double steps) const;
       
       double value(unsigned int frame, bool cur_val_only = false,
                    unsigned int* nextFrame = NULL, bool* nextFrameValid = NULL) const;  
@@ -238,6 +253,20 @@ class CtrlList : public CtrlList_t {
       void del(unsigned int frame);
       void read(Xml& xml);
 
+      // Any change to the items invalidates the flat copy, lookups then fall back to the map.
+      // updateFlat() rebuilds it. It must only be called while no other thread can read
+      //  this list: In the realtime stage of operations, or before the list is published.
+      void updateFlat();
+      // Makes sure the next updateFlat() need not allocate, with up to 'adds' more items. Non realtime.
+      void reserveFlat(size_type adds);
+      // Frees the room made by reserveFlat() once it is no longer needed. Non realtime,
+      //  only while no updateFlat() can run.
+      void releaseFlatSpare();
+      void invalidateFlat() { _flatValid = false; }
+      bool flatValid() const { return _flatValid; }
+      // Estimated bytes used by the items, and by the flat copy if flatBytes is given.
+      size_t memoryUsage(size_t* flatBytes = NULL) const;
+
       void setColor( QColor c ) { _displayColor = c;}
       QColor color() const { return _displayColor; }
       void setVisible(bool v) { _visible = v; }
@@ -283,6 +312,9 @@ class CtrlListList : public std::map<int, CtrlList*, std::less<int> > {
       double value(int ctrlId, unsigned int frame, bool cur_val_only = false,
                    unsigned int* nextFrame = NULL, bool* nextFrameValid = NULL) const;   
       void updateCurValues(unsigned int frame);
+      // Rebuilds the invalid flat copies, see CtrlList::updateFlat().
+      void updateFlat();
+      size_t memoryUsage(size_t* flatBytes = NULL, size_t* items = NULL) const;
       void clearAllAutomation() {
             for(iCtrlList i = begin(); i != end(); ++i)
               i->second->clear();
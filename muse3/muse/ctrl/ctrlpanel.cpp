@@ -29,6 +29,7 @@
 
 #include <QAction>
 #include <QPushButton>
+#include <QLabel>
 #include <QSizePolicy>
 #include <QHBoxLayout>
 #include <QTimer>
@@ -96,6 +97,12 @@ CtrlPanel::CtrlPanel(QWidget* parent, MidiEditor* e, CtrlCanvas* c, const char*
       vbox->addStretch();
       kbox = new QHBoxLayout;
       vbox->addLayout(kbox);
+      _chaseLabel = new QLabel(this);
+      _chaseLabel->setFont(MusEGlobal::config.fonts[3]);
+      _chaseLabel->setAlignment(Qt::AlignCenter);
+      _chaseLabel->setToolTip(tr("Value sent when the song is located to the cursor"));
+      _chaseLabel->hide();
+      vbox->addWidget(_chaseLabel);
       vbox->addStretch();
       vbox->setContentsMargins(0, 0, 0, 0);
       bbox->setContentsMargins(0, 0, 0, 0);
@@ -278,6 +285,7 @@ void CtrlPanel::heartBeat()
   
   inHeartBeat = true;
   
+  QString chase_text;
   if(_track && _ctrl && _dnum != -1)
   {
     if(_dnum != MusECore::CTRL_VELOCITY)
@@ -366,6 +374,12 @@ void CtrlPanel::heartBeat()
           const double dmin = (double)min;
           const double dmax = (double)max;
 
+          const int chased = mp->getChasedCtrl(chan, MusEGlobal::song->cpos(), _dnum);
+          if(chased == MusECore::CTRL_VAL_UNKNOWN)
+            chase_text = tr("chase: ---");
+          else
+            chase_text = tr("chase: %1").arg(chased - bias);
+
           if(_knob)
           {
             const double c_dmin = _knob->minValue();
@@ -487,6 +501,11 @@ void CtrlPanel::heartBeat()
     }
   }
 
+  if(_chaseLabel->text() != chase_text)
+    _chaseLabel->setText(chase_text);
+  if(_chaseLabel->isHidden() != chase_text.isEmpty())
+    _chaseLabel->setHidden(chase_text.isEmpty());
+
   inHeartBeat = false;
 }
 
@@ -29,6 +29,7 @@
 #include "type_defs.h"
 
 class QPushButton;
+class QLabel;
 class QAction;
 class QHBoxLayout;
 
@@ -66,6 +67,8 @@ class CtrlPanel: public QWidget {
       CompactKnob* _knob;
       CompactSlider* _slider;
       LCDPatchEdit* _patchEdit;
+      // Shows the value chased when the song is located to the cursor.
+      QLabel* _chaseLabel;
       // Current local state of knobs versus sliders preference global setting.
       bool _preferKnobs;
       // Current local state of show values preference global setting.
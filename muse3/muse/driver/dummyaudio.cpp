@@ -64,6 +64,8 @@ class DummyAudioDevice : public AudioDevice {
       uint64_t _timeUSAtCycleStart[2];
       unsigned _frameCounter[2];
       unsigned _criticalVariablesIdx;
+      // Run the cycles back to back instead of in real time.
+      volatile bool _freewheel;
       
    public:
       // Time in microseconds at which the driver was created.
@@ -178,7 +180,11 @@ class DummyAudioDevice : public AudioDevice {
       //virtual int realtimePriority() const { return 40; }
       virtual int realtimePriority() const { return _realTimePriority; }
 
-      virtual void setFreewheel(bool) {}
+      virtual void setFreewheel(bool f) {
+            _freewheel = f;
+            MusEGlobal::audio->setFreewheel(f);
+            }
+      bool freewheel() const { return _freewheel; }
       virtual int setMaster(bool) { return 1; }
       };
 
@@ -214,6 +220,7 @@ DummyAudioDevice::DummyAudioDevice() : AudioDevice()
         memset(buffer, 0, sizeof(float) * MusEGlobal::segmentSize);
 
       dummyThread = 0;
+      _freewheel = false;
       _start_timeUS = systemTimeUS();
       _criticalVariablesIdx = 0;
       for(unsigned x = 0; x < 2; ++x)
@@ -299,7 +306,9 @@ static void* dummyLoop(void* ptr)
           drvPtr->processTransport(MusEGlobal::segmentSize);
         }
 
-        usleep(MusEGlobal::segmentSize*1000000/MusEGlobal::sampleRate);
+        // When freewheeling nothing waits for us, go as fast as possible.
+        if(!drvPtr->freewheel())
+          usleep(MusEGlobal::segmentSize*1000000/MusEGlobal::sampleRate);
       }
       pthread_exit(0);
       }
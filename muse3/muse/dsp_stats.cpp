@@ -0,0 +1,186 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  dsp_stats.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <algorithm>
+
+#include <QString>
+
+#include "dsp_stats.h"
+#include "globals.h"
+#include "audio.h"
+#include "song.h"
+#include "track.h"
+#include "synth.h"
+#include "plugin.h"
+
+namespace MusECore {
+
+thread_local DspTimer* DspTimer::_current = 0;
+
+//---------------------------------------------------------
+//   DspTimeStats
+//---------------------------------------------------------
+
+DspTimeStats::DspTimeStats()
+{
+  for(int i = 0; i < DSP_TIME_HISTORY; ++i)
+    _ns[i].store(0, std::memory_order_relaxed);
+  _writeIdx.store(0, std::memory_order_relaxed);
+  _clearIdx = 0;
+}
+
+//---------------------------------------------------------
+//   summary
+//---------------------------------------------------------
+
+bool DspTimeStats::summary(DspTimeSummary* s) const
+{
+  const unsigned w = _writeIdx.load(std::memory_order_acquire);
+  unsigned n = w - _clearIdx;
+  if(n > DSP_TIME_HISTORY)
+    n = DSP_TIME_HISTORY;
+
+  s->count = n;
+  s->min = s->avg = s->max = s->p50 = s->p95 = s->p99 = 0.0;
+  if(n == 0)
+    return false;
+
+  // The writer may overwrite the oldest slots while we copy. That only
+  //  mixes in a few newer cycles, which does not matter for statistics.
+  unsigned v[DSP_TIME_HISTORY];
+  uint64_t sum = 0;
+  for(unsigned i = 0; i < n; ++i)
+  {
+    v[i] = _ns[(w - n + i) & (DSP_TIME_HISTORY - 1)].load(std::memory_order_relaxed);
+    sum += v[i];
+  }
+
+  const unsigned i50 = (n - 1) * 50 / 100;
+  const unsigned i95 = (n - 1) * 95 / 100;
+  const unsigned i99 = (n - 1) * 99 / 100;
+  std::nth_element(v, v + i50, v + n);
+  std::nth_element(v + i50, v + i95, v + n);
+  std::nth_element(v + i95, v + i99, v + n);
+
+  s->min = *std::min_element(v, v + i50 + 1) / 1000.0;
+  s->max = *std::max_element(v + i99, v + n) / 1000.0;
+  s->avg = double(sum) / double(n) / 1000.0;
+  s->p50 = v[i50] / 1000.0;
+  s->p95 = v[i95] / 1000.0;
+  s->p99 = v[i99] / 1000.0;
+  return true;
+}
+
+//---------------------------------------------------------
+//   writeDspStatsLine
+//---------------------------------------------------------
+
+static void writeDspStatsLine(FILE* f, const QString& node, const char* type, const DspTimeStats* stats)
+{
+  DspTimeSummary s;
+  if(!stats->summary(&s))
+    return;
+  // Double any quotes in the name, as CSV wants.
+  QString n = node;
+  n.replace(QChar('"'), QString("\"\""));
+  fprintf(f, "\"%s\",%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+          n.toUtf8().constData(), type, s.count, s.min, s.avg, s.max, s.p50, s.p95, s.p99);
+}
+
+//---------------------------------------------------------
+//   dumpDspTimeStats
+//---------------------------------------------------------
+
+bool dumpDspTimeStats(const QString& path)
+{
+  FILE* f = fopen(path.toLocal8Bit().constData(), "w");
+  if(!f)
+  {
+    fprintf(stderr, "MusE: dumpDspTimeStats: cannot open %s\n", path.toLocal8Bit().constData());
+    return false;
+  }
+
+  fprintf(f, "# MusE DSP time statistics. Times in microseconds. Cycle: %u frames at %d Hz = %.2f us\n",
+          MusEGlobal::segmentSize, MusEGlobal::sampleRate,
+          double(MusEGlobal::segmentSize) * 1000000.0 / double(MusEGlobal::sampleRate));
+  fprintf(f, "node,type,cycles,min,avg,max,p50,p95,p99\n");
+
+  writeDspStatsLine(f, QString("Midi"), "midi", MusEGlobal::audio->midiDspStats());
+
+  TrackList* tl = MusEGlobal::song->tracks();
+  for(ciTrack it = tl->begin(); it != tl->end(); ++it)
+  {
+    if((*it)->isMidiTrack())
+      continue;
+    AudioTrack* at = static_cast<AudioTrack*>(*it);
+    writeDspStatsLine(f, at->name(), "track", at->dspStats());
+    if(at->type() == Track::AUDIO_SOFTSYNTH)
+      writeDspStatsLine(f, at->name(), "synth", static_cast<SynthI*>(at)->synthDspStats());
+    Pipeline* pl = at->efxPipe();
+    if(!pl)
+      continue;
+    for(ciPluginI ip = pl->begin(); ip != pl->end(); ++ip)
+    {
+      if(*ip)
+        writeDspStatsLine(f, at->name() + QString(": ") + (*ip)->name(), "plugin", (*ip)->dspStats());
+    }
+  }
+
+  const bool ok = ferror(f) == 0;
+  if(fclose(f) != 0 || !ok)
+  {
+    fprintf(stderr, "MusE: dumpDspTimeStats: error writing %s\n", path.toLocal8Bit().constData());
+    return false;
+  }
+  return true;
+}
+
+//---------------------------------------------------------
+//   clearDspTimeStats
+//---------------------------------------------------------
+
+void clearDspTimeStats()
+{
+  MusEGlobal::audio->midiDspStats()->clear();
+
+  TrackList* tl = MusEGlobal::song->tracks();
+  for(ciTrack it = tl->begin(); it != tl->end(); ++it)
+  {
+    if((*it)->isMidiTrack())
+      continue;
+    AudioTrack* at = static_cast<AudioTrack*>(*it);
+    at->dspStats()->clear();
+    if(at->type() == Track::AUDIO_SOFTSYNTH)
+      static_cast<SynthI*>(at)->synthDspStats()->clear();
+    Pipeline* pl = at->efxPipe();
+    if(!pl)
+      continue;
+    for(ciPluginI ip = pl->begin(); ip != pl->end(); ++ip)
+    {
+      if(*ip)
+        (*ip)->dspStats()->clear();
+    }
+  }
+}
+
+} // namespace MusECore
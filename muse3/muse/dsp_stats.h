@@ -0,0 +1,147 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  dsp_stats.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __DSP_STATS_H__
+#define __DSP_STATS_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+
+class QString;
+
+namespace MusECore {
+
+// Number of process cycles kept per node. Must be a power of two.
+#define DSP_TIME_HISTORY 1024
+
+//---------------------------------------------------------
+//   dspTimeNow
+//    Monotonic nanoseconds. Served by the vDSO, no system call.
+//---------------------------------------------------------
+
+inline uint64_t dspTimeNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+}
+
+//---------------------------------------------------------
+//   DspTimeSummary
+//    All times in microseconds.
+//---------------------------------------------------------
+
+struct DspTimeSummary {
+      int count;
+      double min;
+      double avg;
+      double max;
+      double p50;
+      double p95;
+      double p99;
+      };
+
+//---------------------------------------------------------
+//   DspTimeStats
+//    Per-cycle processing times of one node (track, plugin etc.)
+//    Single writer (the thread processing the node, audio thread
+//     or a graph worker), single reader (gui). Lock free.
+//---------------------------------------------------------
+
+class DspTimeStats {
+      std::atomic<unsigned> _ns[DSP_TIME_HISTORY];
+      std::atomic<unsigned> _writeIdx;
+      // Gui side only. Cycles before this index are ignored.
+      unsigned _clearIdx;
+
+   public:
+      DspTimeStats();
+
+      // Audio side. Records one cycle.
+      void add(uint64_t ns)
+      {
+        const unsigned idx = _writeIdx.load(std::memory_order_relaxed);
+        _ns[idx & (DSP_TIME_HISTORY - 1)].store(ns > 0xffffffffULL ? 0xffffffffU : unsigned(ns), std::memory_order_relaxed);
+        _writeIdx.store(idx + 1, std::memory_order_release);
+      }
+
+      // Gui side. Fills in the summary of the recorded cycles.
+      // Returns false if nothing was recorded since the last clear().
+      bool summary(DspTimeSummary* s) const;
+      // Gui side. Forget the recorded cycles.
+      void clear() { _clearIdx = _writeIdx.load(std::memory_order_acquire); }
+      };
+
+//---------------------------------------------------------
+//   DspTimer
+//    Times a scope into a DspTimeStats.
+//    Nested timers record self time: The time spent in any nested
+//     timer of the same thread (say an upstream track pulled on demand)
+//     is subtracted from the enclosing one.
+//    Plain timers are not part of the nesting. Their time counts
+//     towards the enclosing nested timer.
+//---------------------------------------------------------
+
+class DspTimer {
+      DspTimeStats* _stats;
+      DspTimer* _parent;
+      uint64_t _start;
+      uint64_t _childNs;
+      bool _nested;
+
+      static thread_local DspTimer* _current;
+
+   public:
+      DspTimer(DspTimeStats* stats, bool nested = false)
+        : _stats(stats), _parent(0), _childNs(0), _nested(nested)
+      {
+        if(_nested)
+        {
+          _parent = _current;
+          _current = this;
+        }
+        _start = dspTimeNow();
+      }
+
+      ~DspTimer()
+      {
+        const uint64_t elapsed = dspTimeNow() - _start;
+        if(_nested)
+        {
+          _current = _parent;
+          if(_parent)
+            _parent->_childNs += elapsed;
+        }
+        _stats->add(elapsed > _childNs ? elapsed - _childNs : 0);
+      }
+      };
+
+// Writes a per-node summary of all tracks, plugins and midi processing as CSV.
+// Returns false if the file could not be written.
+extern bool dumpDspTimeStats(const QString& path);
+// Forgets the recorded cycles of all tracks, plugins and midi processing. Gui thread only.
+extern void clearDspTimeStats();
+
+} // namespace MusECore
+
+#endif
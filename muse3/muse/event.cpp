@@ -32,7 +32,7 @@
 
 namespace MusECore {
 
-EventID_t EventBase::idGen=0;
+std::atomic<EventID_t> EventBase::idGen(0);
 
 //---------------------------------------------------------
 //   Event
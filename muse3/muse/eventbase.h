@@ -25,6 +25,7 @@
 #define __EVENTBASE_H__
 
 #include <sys/types.h>
+#include <atomic>
 
 #include "type_defs.h"
 #include "pos.h"
@@ -39,7 +40,8 @@ class WavePart;
 
 class EventBase : public PosLen {
       EventType _type;
-      static EventID_t idGen;
+      // Atomic, instrument definitions are read on a thread at startup.
+      static std::atomic<EventID_t> idGen;
       // An always unique id.
       EventID_t _uniqueId; 
       // Can be either _uniqueId or the same _uniqueId as other clone 'group' events. De-cloning restores it to _uniqueId.
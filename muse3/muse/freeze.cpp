@@ -0,0 +1,462 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  freeze.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <list>
+#include <atomic>
+#include <sndfile.h>
+
+#include <QDir>
+#include <QFile>
+#include <QRegExp>
+#include <QTimer>
+
+#include "freeze.h"
+#include "app.h"
+#include "audio.h"
+#include "audioprefetch.h"
+#include "audiodev.h"
+#include "ctrl.h"
+#include "gconfig.h"
+#include "globals.h"
+#include "midiport.h"
+#include "mpevent.h"
+#include "part.h"
+#include "song.h"
+#include "synth.h"
+#include "track.h"
+#include "undo.h"
+
+namespace MusECore {
+
+// Rendered past the end of the song, for reverb and release tails.
+static const unsigned freezeTailSeconds = 2;
+
+//---------------------------------------------------------
+//   RetiredFile
+//    Freeze files which the tracks do not use anymore.
+//    The prefetch thread may still be reading from them,
+//     so they are only released once it has acknowledged
+//     the switch, see AudioPrefetch::msgAcknowledge().
+//---------------------------------------------------------
+
+struct RetiredFile {
+      SndFileR file;
+      bool remove;
+      std::atomic<bool> released;
+      };
+
+static std::list<RetiredFile> retiredFiles;
+
+// There is only one render at a time, see freezeTrack().
+static FreezeRender* currentRender = 0;
+
+//---------------------------------------------------------
+//   retireFile
+//    Called after msgSetFreeze() has switched the track to
+//     its new source, which also queued a seek to the
+//     prefetch thread. The acknowledge is queued behind it.
+//---------------------------------------------------------
+
+static void retireFile(const SndFileR& sf, bool remove)
+      {
+      if (sf.isNull())
+            return;
+      retiredFiles.emplace_back();
+      RetiredFile& rf = retiredFiles.back();
+      rf.file     = sf;
+      rf.remove   = remove;
+      rf.released = false;
+      MusEGlobal::audioPrefetch->msgAcknowledge(&rf.released);
+      }
+
+//---------------------------------------------------------
+//   stopFreewheel
+//    A render stopped before the end does not get the 'F'
+//     which ends freewheeling.
+//---------------------------------------------------------
+
+static void stopFreewheel()
+      {
+      if (MusEGlobal::config.freewheelMode)
+            MusEGlobal::audioDevice->setFreewheel(false);
+      }
+
+//---------------------------------------------------------
+//   FreezeRender
+//---------------------------------------------------------
+
+FreezeRender::FreezeRender(AudioTrack* track, QObject* parent)
+   : QObject(parent)
+      {
+      _track  = track;
+      _frames = 0;
+      _started = false;
+      _timer  = new QTimer(this);
+      connect(_timer, SIGNAL(timeout()), SLOT(poll()));
+      connect(MusEGlobal::song, SIGNAL(songChanged(MusECore::SongChangedStruct_t)),
+         SLOT(songChanged(MusECore::SongChangedStruct_t)));
+      }
+
+//---------------------------------------------------------
+//   start
+//---------------------------------------------------------
+
+bool FreezeRender::start()
+      {
+      Song* song = MusEGlobal::song;
+      _frames = Pos(song->len(), true).frame() + freezeTailSeconds * MusEGlobal::sampleRate;
+
+      QString dir = MusEGlobal::museProject + "/freeze";
+      if (!QDir().mkpath(dir)) {
+            fprintf(stderr, "freeze: cannot create directory <%s>\n", dir.toLocal8Bit().constData());
+            return true;
+            }
+      QString base = dir + "/" + _track->name().simplified().replace(QRegExp("[^A-Za-z0-9_.-]"), "_");
+      QString path;
+      for (int n = 1; ; ++n) {
+            path = QString("%1_%2.wav").arg(base).arg(n);
+            if (!QFile::exists(path))
+                  break;
+            }
+
+      _file = new SndFile(path);
+      _file.setFormat(SF_FORMAT_WAV | SF_FORMAT_FLOAT, _track->channels(), MusEGlobal::sampleRate);
+      if (_file.openWrite()) {
+            fprintf(stderr, "freeze: cannot create <%s>: %s\n",
+               path.toLocal8Bit().constData(), _file.strerror().toLocal8Bit().constData());
+            _file = NULL;
+            return true;
+            }
+
+      _lPos = song->lPos();
+      _rPos = song->rPos();
+      song->setPos(Song::LPOS, Pos(0, false), false, false);
+      song->setPos(Song::RPOS, Pos(_frames, false), false, false);
+
+      MusEGlobal::audio->msgSetFreezeCapture(_track, _file);
+      currentRender = this;
+      // Freewheels as configured once the transport starts, like any bounce.
+      MusEGlobal::audio->msgBounce();
+      song->setPlay(true);
+      _timer->start(50);
+      return false;
+      }
+
+//---------------------------------------------------------
+//   poll
+//---------------------------------------------------------
+
+void FreezeRender::poll()
+      {
+      if (MusEGlobal::audio->isPlaying()) {
+            _started = true;
+            return;
+            }
+      // Short songs may render between two polls.
+      if (_track && _track->freezeCaptured() != 0)
+            _started = true;
+      // The audio thread ends the bounce at the end, a stop
+      //  by the user leaves it set.
+      if (MusEGlobal::audio->bounce() && !_started && _track)
+            return;
+      // Stopped by the user before the end, or the transport skipped frames?
+      if (_track && _track->freezeCaptured() < _frames) {
+            fprintf(stderr, "freeze: only frames 0 to %u of %u captured, discarding\n",
+               _track->freezeCaptured(), _frames);
+            finish(false);
+            return;
+            }
+      finish(_track != 0);
+      }
+
+//---------------------------------------------------------
+//   songChanged
+//    The track may be deleted during the render. It is then
+//     out of the song but still alive in the undo list, and
+//     the audio thread does not run it anymore.
+//---------------------------------------------------------
+
+void FreezeRender::songChanged(MusECore::SongChangedStruct_t flags)
+      {
+      if (!_track || !(flags._flags & SC_TRACK_REMOVED))
+            return;
+      if (MusEGlobal::song->tracks()->contains(_track))
+            return;
+      fprintf(stderr, "freeze: track removed, discarding\n");
+      MusEGlobal::audio->msgSetFreezeCapture(_track, SndFileR());
+      _track = 0;
+      MusEGlobal::song->setStop(true);
+      }
+
+//---------------------------------------------------------
+//   discard
+//    The song is cleared, which deletes the track. The
+//     transport is stopped by then.
+//---------------------------------------------------------
+
+void FreezeRender::discard()
+      {
+      _timer->stop();
+      stopFreewheel();
+      if (_track)
+            MusEGlobal::audio->msgSetFreezeCapture(_track, SndFileR());
+      _track = 0;
+      _file.close();
+      _file.remove();
+      _file = NULL;
+      currentRender = 0;
+      deleteLater();
+      }
+
+//---------------------------------------------------------
+//   finish
+//---------------------------------------------------------
+
+void FreezeRender::finish(bool ok)
+      {
+      _timer->stop();
+      currentRender = 0;
+      stopFreewheel();
+      if (_track)
+            MusEGlobal::audio->msgSetFreezeCapture(_track, SndFileR());
+
+      Song* song = MusEGlobal::song;
+      song->setPos(Song::LPOS, _lPos, false, false);
+      song->setPos(Song::RPOS, _rPos, false, false);
+      song->setPos(Song::CPOS, _lPos, true, true);
+
+      _file.close();
+      if (ok && _file.openRead(false)) {
+            fprintf(stderr, "freeze: cannot read back <%s>\n", _file.path().toLocal8Bit().constData());
+            ok = false;
+            }
+      if (ok) {
+            SndFileR old = _track->freezeFile();
+            MusEGlobal::audio->msgSetFreeze(_track, _file);
+            retireFile(old, true);
+            }
+      else
+            _file.remove();
+      _file = NULL;
+      song->update(SC_TRACK_MODIFIED);
+      deleteLater();
+      }
+
+//---------------------------------------------------------
+//   discardFreezeRender
+//---------------------------------------------------------
+
+void discardFreezeRender()
+      {
+      if (currentRender)
+            currentRender->discard();
+      }
+
+//---------------------------------------------------------
+//   freezeTrack
+//---------------------------------------------------------
+
+bool freezeTrack(AudioTrack* track)
+      {
+      if (!track->canFreeze() || track->frozen() || track->off())
+            return true;
+      if (MusEGlobal::audio->isPlaying() || MusEGlobal::audio->bounce())
+            return true;
+      FreezeRender* fr = new FreezeRender(track, MusEGlobal::muse);
+      if (fr->start()) {
+            delete fr;
+            return true;
+            }
+      return false;
+      }
+
+//---------------------------------------------------------
+//   unfreezeTrack
+//---------------------------------------------------------
+
+void unfreezeTrack(AudioTrack* track)
+      {
+      if (!track->frozen())
+            return;
+      SndFileR old = track->freezeFile();
+      MusEGlobal::audio->msgSetFreeze(track, SndFileR());
+      retireFile(old, true);
+      MusEGlobal::song->update(SC_TRACK_MODIFIED);
+      }
+
+//---------------------------------------------------------
+//   invalidateMidiTrackFreeze
+//    A midi track's events are part of its synth's freeze.
+//---------------------------------------------------------
+
+static void invalidateMidiTrackFreeze(const Track* t)
+      {
+      const int port = static_cast<const MidiTrack*>(t)->outPort();
+      if (port < 0 || port >= MIDI_PORTS)
+            return;
+      MidiDevice* md = MusEGlobal::midiPorts[port].device();
+      if (md && md->isSynti())
+            static_cast<SynthI*>(md)->invalidateFreeze();
+      }
+
+static void invalidateTrackFreeze(const Track* t)
+      {
+      if (!t)
+            return;
+      if (t->isMidiTrack())
+            invalidateMidiTrackFreeze(t);
+      else
+            const_cast<AudioTrack*>(static_cast<const AudioTrack*>(t))->invalidateFreeze();
+      }
+
+//---------------------------------------------------------
+//   invalidateSynthFreeze
+//---------------------------------------------------------
+
+void invalidateSynthFreeze(const MidiPlayEvent& ev)
+      {
+      // Notes are played live, only the synth's state counts.
+      if (ev.translateCtrlNum() < 0)
+            return;
+      const int port = ev.port();
+      if (port < 0 || port >= MIDI_PORTS)
+            return;
+      MidiDevice* md = MusEGlobal::midiPorts[port].device();
+      if (md && md->isSynti())
+            static_cast<SynthI*>(md)->invalidateFreeze();
+      }
+
+//---------------------------------------------------------
+//   invalidateAllFreezes
+//---------------------------------------------------------
+
+static void invalidateAllFreezes(bool wavesOnly)
+      {
+      TrackList* tl = MusEGlobal::song->tracks();
+      for (iTrack it = tl->begin(); it != tl->end(); ++it) {
+            if ((*it)->isMidiTrack() || (wavesOnly && (*it)->type() != Track::WAVE))
+                  continue;
+            static_cast<AudioTrack*>(*it)->invalidateFreeze();
+            }
+      }
+
+//---------------------------------------------------------
+//   invalidateFreezes
+//    Called after the operations are executed or reverted.
+//    Only what the freeze file contains counts: Volume,
+//     pan, routing and mute are applied after it.
+//---------------------------------------------------------
+
+void invalidateFreezes(const Undo& operations)
+      {
+      for (ciUndoOp i = operations.begin(); i != operations.end(); ++i) {
+            switch (i->type) {
+                  case UndoOp::AddPart:
+                  case UndoOp::DeletePart:
+                  case UndoOp::MovePart:
+                  case UndoOp::ModifyPartLength:
+                  case UndoOp::AddEvent:
+                  case UndoOp::DeleteEvent:
+                  case UndoOp::ModifyEvent:
+                        if (i->part)
+                              invalidateTrackFreeze(i->part->track());
+                        break;
+
+                  case UndoOp::AddAudioCtrlVal:
+                  case UndoOp::DeleteAudioCtrlVal:
+                  case UndoOp::ModifyAudioCtrlVal:
+                        if (i->_audioCtrlID >= AC_PLUGIN_CTL_BASE)
+                              invalidateTrackFreeze(i->track);
+                        break;
+
+                  case UndoOp::ModifyAudioCtrlValList:
+                  {
+                        const CtrlList* cl = i->_addCtrlList ? i->_addCtrlList : i->_eraseCtrlList;
+                        if (!cl || cl->id() < AC_PLUGIN_CTL_BASE)
+                              break;
+                        TrackList* tl = MusEGlobal::song->tracks();
+                        for (iTrack it = tl->begin(); it != tl->end(); ++it) {
+                              if ((*it)->isMidiTrack())
+                                    continue;
+                              AudioTrack* at = static_cast<AudioTrack*>(*it);
+                              if (at->controller() == i->_ctrlListList)
+                                    at->invalidateFreeze();
+                              }
+                  }
+                        break;
+
+                  // Moves all events in time.
+                  case UndoOp::AddTempo:
+                  case UndoOp::DeleteTempo:
+                  case UndoOp::ModifyTempo:
+                  case UndoOp::SetTempo:
+                  case UndoOp::SetStaticTempo:
+                  case UndoOp::SetGlobalTempo:
+                  case UndoOp::AddSig:
+                  case UndoOp::DeleteSig:
+                  case UndoOp::ModifySig:
+                        invalidateAllFreezes(false);
+                        break;
+
+                  // Any wave event may use the clip.
+                  case UndoOp::ModifyClip:
+                        invalidateAllFreezes(true);
+                        break;
+
+                  default:
+                        break;
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   checkStaleFreezes
+//---------------------------------------------------------
+
+void checkStaleFreezes()
+      {
+      // A stopped prefetch thread reads nothing, and may never get to the acknowledge.
+      const bool prefetching = MusEGlobal::audioPrefetch->isRunning();
+      for (std::list<RetiredFile>::iterator i = retiredFiles.begin(); i != retiredFiles.end(); ) {
+            if (prefetching && !i->released) {
+                  ++i;
+                  continue;
+                  }
+            if (i->remove)
+                  i->file.remove();
+            i = retiredFiles.erase(i);
+            }
+
+      TrackList* tl = MusEGlobal::song->tracks();
+      for (iTrack it = tl->begin(); it != tl->end(); ++it) {
+            if ((*it)->isMidiTrack())
+                  continue;
+            AudioTrack* at = static_cast<AudioTrack*>(*it);
+            if (at->freezeStale()) {
+                  fprintf(stderr, "freeze: track <%s> changed, unfreezing\n", at->name().toLocal8Bit().constData());
+                  unfreezeTrack(at);
+                  }
+            }
+      }
+
+} // namespace MusECore
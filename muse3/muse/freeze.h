@@ -0,0 +1,93 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  freeze.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __FREEZE_H__
+#define __FREEZE_H__
+
+#include <QObject>
+
+#include "pos.h"
+#include "type_defs.h"
+#include "wave.h"
+
+class QTimer;
+
+namespace MusECore {
+
+class AudioTrack;
+class MidiPlayEvent;
+class Undo;
+
+//---------------------------------------------------------
+//   FreezeRender
+//    Plays the song once from start to end in freewheel
+//     mode, capturing the output of a track's instrument
+//     and effect rack into a float file in the project's
+//     freeze directory. The track then plays that file
+//     instead of running the instrument and plugins.
+//    Deletes itself when done.
+//---------------------------------------------------------
+
+class FreezeRender : public QObject {
+      Q_OBJECT
+
+      // Zero once the track was removed from the song.
+      AudioTrack* _track;
+      SndFileR _file;
+      Pos _lPos, _rPos;
+      // Where the render ends, the file is only used if it got that far.
+      unsigned _frames;
+      // The transport was seen playing, or the capture has begun.
+      bool _started;
+      QTimer* _timer;
+
+      void finish(bool ok);
+
+   private slots:
+      void poll();
+      void songChanged(MusECore::SongChangedStruct_t);
+
+   public:
+      FreezeRender(AudioTrack* track, QObject* parent = 0);
+      // Returns true on error.
+      bool start();
+      // Drops the render at once, without touching the song.
+      void discard();
+      };
+
+// Starts rendering the track's freeze file in the background. Returns true on error.
+extern bool freezeTrack(AudioTrack* track);
+// Called before the song is cleared. Drops a running render, whose track is about to be deleted.
+extern void discardFreezeRender();
+// Runs the track's instrument and plugins again and deletes the freeze file.
+extern void unfreezeTrack(AudioTrack* track);
+// Marks the freeze files of all tracks affected by the operations as outdated.
+extern void invalidateFreezes(const Undo& operations);
+// Marks the freeze file of the synth the event is sent to as outdated if it is a
+//  program or controller change. For changes made live from the gui.
+extern void invalidateSynthFreeze(const MidiPlayEvent& ev);
+// Called at the gui heartbeat. Unfreezes tracks whose freeze file is outdated.
+extern void checkStaleFreezes();
+
+} // namespace MusECore
+
+#endif
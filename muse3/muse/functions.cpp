@@ -41,8 +41,11 @@
 #include "function_dialogs/deloverlaps.h"
 #include "function_dialogs/legato.h"
 #include "components/pasteeventsdialog.h"
+#include "sorted_notes.h"
 
 #include <limits.h>
+#include <algorithm>
+#include <vector>
 #include <iostream>
 #include <errno.h>
 #include <sys/stat.h>
@@ -687,61 +690,71 @@ bool move_notes(const set<const Part*>& parts, int range, signed int ticks)
 		return false;
 }
 
-bool delete_overlaps(const set<const Part*>& parts, int range)
+typedef SortedNoteT<Event, Part> SortedNote;
+typedef vector<SortedNote> SortedNoteList;
+
+//---------------------------------------------------------
+//   get_notes
+//    collects the relevant notes of parts in the order in
+//    which get_events() returns them, grouped by clone chain.
+//    Returns true if any relevant event was found.
+//---------------------------------------------------------
+
+static bool get_notes(const set<const Part*>& parts, int range, SortedNoteList& notes)
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
-	Undo operations;
-	
-	set<const Event*> deleted_events;
+	bool found = false;
 	
-	if (!events.empty())
+	for (set<const Part*>::const_iterator ip=parts.begin(); ip!=parts.end(); ip++)
 	{
-		for (map<const Event*, const Part*>::iterator it1=events.begin(); it1!=events.end(); it1++)
+		const Part* part=*ip;
+		for (ciEvent ie=part->events().begin(); ie!=part->events().end(); ie++)
 		{
-			const Event& event1=*(it1->first);
+			if (!is_relevant(ie->second, part, range, NotesRelevant))
+				continue;
+			found = true;
 			// This operation can only apply to notes.
-			if(event1.type() != Note)
-			  continue;
-			const Part* part1=it1->second;
-			
-			// we may NOT optimize by letting it2 start at (it1 +1); this optimisation
-			// is only allowed when events was sorted by time. it is, however, sorted
-			// randomly by pointer.
-			for (map<const Event*, const Part*>::iterator it2=events.begin(); it2!=events.end(); it2++)
-			{
-				const Event& event2=*(it2->first);
-				// This operation can only apply to notes.
-				if(event2.type() != Note)
-				  continue;
-				const Part* part2=it2->second;
-				
-				if ( (part1->isCloneOf(part2)) &&          // part1 and part2 are the same or are duplicates
-				     (&event1 != &event2) &&               // and event1 and event2 aren't the same
-				     (deleted_events.find(&event2) == deleted_events.end()) ) //and event2 hasn't been deleted before
-				{
-					if ( (event1.pitch() == event2.pitch()) &&
-					     (event1.tick() <= event2.tick()) &&
-						   (event1.endTick() > event2.tick()) ) //they overlap
-					{
-						int new_len = event2.tick() - event1.tick();
+			if (ie->second.type() == Note)
+				notes.push_back(SortedNote(&ie->second, part, part->clonemaster_sn()));
+		}
+	}
+	
+	sortNotesByAddress(notes);
+	return found;
+}
 
-						if (new_len==0)
-						{
-							operations.push_back(UndoOp(UndoOp::DeleteEvent, event2, part2, false, false));
-							deleted_events.insert(&event2);
-						}
-						else
-						{
-							Event new_event1 = event1.clone();
-							new_event1.setLenTick(new_len);
-							
-							operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event1, event1, part1, false, false));
-						}
-					}
-				}
-			}
+//---------------------------------------------------------
+//   schedule_note_changes
+//---------------------------------------------------------
+
+static void schedule_note_changes(const SortedNoteList& notes, const vector<NoteChange>& changes, Undo& operations)
+{
+	for (vector<NoteChange>::const_iterator it=changes.begin(); it!=changes.end(); it++)
+	{
+		const Event& event=*notes[it->note].event;
+		const Part* part=notes[it->note].part;
+		if (it->newLen==0)
+		{
+			operations.push_back(UndoOp(UndoOp::DeleteEvent, event, part, false, false));
+			continue;
 		}
 		
+		Event new_event = event.clone();
+		new_event.setLenTick(it->newLen);
+		operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event, event, part, false, false));
+	}
+}
+
+bool delete_overlaps(const set<const Part*>& parts, int range)
+{
+	SortedNoteList notes;
+	Undo operations;
+	
+	if (get_notes(parts, range, notes))
+	{
+		vector<NoteChange> changes;
+		findNoteOverlaps(notes, changes);
+		schedule_note_changes(notes, changes, operations);
+		
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -750,53 +763,16 @@ bool delete_overlaps(const set<const Part*>& parts, int range)
 
 bool legato(const set<const Part*>& parts, int range, int min_len, bool dont_shorten)
 {
-	map<const Event*, const Part*> events = get_events(parts, range);
+	SortedNoteList notes;
 	Undo operations;
 	
 	if (min_len<=0) min_len=1;
 	
-	if (!events.empty())
+	if (get_notes(parts, range, notes))
 	{
-		for (map<const Event*, const Part*>::iterator it1=events.begin(); it1!=events.end(); it1++)
-		{
-			const Event& event1=*(it1->first);
-			// This operation can only apply to notes.
-			if(event1.type() != Note)
-			  continue;
-			const Part* part1=it1->second;
-			
-			unsigned len=INT_MAX;
-			// we may NOT optimize by letting it2 start at (it1 +1); this optimisation
-			// is only allowed when events was sorted by time. it is, however, sorted
-			// randomly by pointer.
-			for (map<const Event*, const Part*>::iterator it2=events.begin(); it2!=events.end(); it2++)
-			{
-				const Event& event2=*(it2->first);
-				// This operation can only apply to notes.
-				if(event2.type() != Note)
-				  continue;
-				const Part* part2=it2->second;
-				
-				bool relevant = (event2.tick() >= event1.tick() + min_len);
-				if (dont_shorten)
-					relevant = relevant && (event2.tick() >= event1.endTick());
-				
-				if ( (part1->isCloneOf(part2)) &&           // part1 and part2 are the same or are duplicates
-				      relevant &&                           // they're not too near (respect min_len and dont_shorten)
-				     (event2.tick()-event1.tick() < len ) ) // that's the nearest relevant following note
-					len=event2.tick()-event1.tick();
-			}
-			
-			if (len==INT_MAX) len=event1.lenTick(); // if no following note was found, keep the length
-			
-			if (event1.lenTick() != len)
-			{
-				Event new_event1 = event1.clone();
-				new_event1.setLenTick(len);
-				
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event1, event1, part1, false, false));
-			}
-		}
+		vector<NoteChange> changes;
+		findLegatoLens(notes, min_len, dont_shorten, changes);
+		schedule_note_changes(notes, changes, operations);
 		
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
@@ -1909,66 +1885,27 @@ bool delete_overlaps_items(TagEventList* tag_list)
 {
   Undo operations;
   
-  set<const Event*> deleted_events;
-  int new_len;
-  Event new_event1;
+  SortedNoteList notes;
+  vector<NoteChange> changes;
   const Part* part;
     
   for(ciTagEventList itl = tag_list->begin(); itl != tag_list->end(); ++itl)
   {
     part = itl->first;
     const EventList& el = itl->second.evlist();
+    
+    // The tagged event list is sorted by time already.
+    notes.clear();
     for(ciEvent ie = el.begin(); ie != el.end(); ie++)
     {
-      const Event& e = ie->second;
-
       // This operation can only apply to notes.
-      if(e.type() != Note)
-        continue;
-      
-      // Has this event already been scheduled for deletion? Ignore it.
-      if(deleted_events.find(&e) != deleted_events.end())
-        continue;
-            
-      ciEvent ie2 = ie;
-      ++ie2;
-      for( ; ie2 != el.end(); ++ie2)
-      {
-        const Event& e2 = ie2->second;
-        // This operation can only apply to notes.
-        if(e2.type() != Note)
-          continue;
-        
-        // Do e2 and e point to the same event? Or has e2 already been scheduled for deletion? Ignore it.
-        if(e == e2 || deleted_events.find(&e2) != deleted_events.end())
-          continue;
-        
-        if ( (e.pitch() == e2.pitch()) &&
-            (e.tick() <= e2.tick()) &&
-            (e.endTick() > e2.tick()) ) //they overlap
-        {
-          new_len = e2.tick() - e.tick();
-
-          if(new_len==0)
-          {
-            operations.push_back(UndoOp(UndoOp::DeleteEvent, e2, part, false, false));
-            deleted_events.insert(&e2);
-          }
-          else
-          {
-            new_event1 = e.clone();
-            new_event1.setLenTick(new_len);
-            
-            operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event1, e, part, false, false));
-            
-            // After resizing the event, it should not be necessary to continue with any further
-            //  events in this loop since any more sorted events will come at or AFTER e2's position
-            //  which we have just resized the end of e to.
-            break;
-          }
-        }
-      }
+      if(ie->second.type() == Note)
+        notes.push_back(SortedNote(&ie->second, part));
     }
+    
+    changes.clear();
+    findSortedNoteOverlaps(notes, changes);
+    schedule_note_changes(notes, changes, operations);
   }
   
   return MusEGlobal::song->applyOperationGroup(operations);
@@ -2030,51 +1967,29 @@ bool legato_items(TagEventList* tag_list, int min_len, bool dont_shorten)
   
   if (min_len<=0) min_len=1;
   
+  // Not reset for each note or part, see findSortedLegatoLens().
   unsigned len = INT_MAX;
-  bool relevant;
-  Event new_event1;
+  SortedNoteList notes;
+  vector<NoteChange> changes;
   const Part* part;
     
   for(ciTagEventList itl = tag_list->begin(); itl != tag_list->end(); ++itl)
   {
     part = itl->first;
     const EventList& el = itl->second.evlist();
+    
+    // The tagged event list is sorted by time already.
+    notes.clear();
     for(ciEvent ie = el.begin(); ie != el.end(); ie++)
     {
-      const Event& e = ie->second;
-
       // This operation can only apply to notes.
-      if(e.type() != Note)
-        continue;
-      
-      ciEvent ie2 = ie;
-      ++ie2;
-      for( ; ie2 != el.end(); ++ie2)
-      {
-        const Event& e2 = ie2->second;
-        // This operation can only apply to notes.
-        if(e2.type() != Note)
-          continue;
-
-        relevant = (e2.tick() >= e.tick() + min_len);
-        if (dont_shorten)
-          relevant = relevant && (e2.tick() >= e.endTick());
-        
-        if ( relevant &&                      // they're not too near (respect min_len and dont_shorten)
-              (e2.tick() - e.tick() < len ) )  // that's the nearest relevant following note
-          len = e2.tick() - e.tick();
-      }            
-      
-      if (len==INT_MAX) len = e.lenTick(); // if no following note was found, keep the length
-      
-      if (e.lenTick() != len)
-      {
-        new_event1 = e.clone();
-        new_event1.setLenTick(len);
-        
-        operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event1, e, part, false, false));
-      }
+      if(ie->second.type() == Note)
+        notes.push_back(SortedNote(&ie->second, part));
     }
+    
+    changes.clear();
+    findSortedLegatoLens(notes, min_len, dont_shorten, len, changes);
+    schedule_note_changes(notes, changes, operations);
   }
   
   return MusEGlobal::song->applyOperationGroup(operations);
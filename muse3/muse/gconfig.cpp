@@ -281,6 +281,12 @@ GlobalConfigValues config = {
       true,                         // projectStoreInFolder
       true,                         // useProjectSaveDialog
       256,                          // minControlProcessPeriod
+      0,                            // audioWorkerThreads
+      true,                         // latencyCompensation
+      2,                            // prefetchWorkerThreads
+      true,                         // diskReadAheadHints
+      64,                           // waveTileCacheSize
+      3,                            // autoSaveBackups
       false,                        // popupsDefaultStayOpen
       false,                        // leftMouseButtonCanDecrease
       false,                        // rangeMarkerWithoutMMB
@@ -284,6 +284,12 @@ struct GlobalConfigValues {
       bool projectStoreInFolder;
       bool useProjectSaveDialog;
       unsigned long minControlProcessPeriod;
+      int audioWorkerThreads;  // Number of extra realtime threads for parallel track processing. 0 = off, -1 = automatic.
+      bool latencyCompensation; // Automatic plugin delay compensation at summing points.
+      int prefetchWorkerThreads; // Number of extra disk prefetch threads. 0 = prefetch thread only.
+      bool diskReadAheadHints;  // Give the kernel read-ahead hints for the sound files being streamed.
+      int waveTileCacheSize;    // Memory budget of the pre-rendered waveform tiles, in megabytes. 0 = off.
+      int autoSaveBackups;      // Number of rotating copies kept of the project replaced by autosave.
       bool popupsDefaultStayOpen;
       bool leftMouseButtonCanDecrease;
       bool rangeMarkerWithoutMMB;
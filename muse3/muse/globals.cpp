@@ -118,6 +118,7 @@ bool debugMode = false;
 bool unityWorkaround = false;
 bool debugMsg = false;
 bool heavyDebugMsg = false;
+bool startupProfile = false;
 bool midiInputTrace = false;
 bool midiOutputTrace = false;
 bool realTimeScheduling = false;
@@ -99,6 +99,7 @@ extern bool midiOutputTrace;
 extern bool unityWorkaround;
 extern bool debugMsg;
 extern bool heavyDebugMsg;
+extern bool startupProfile;
 extern bool debugSync;
 extern bool loadPlugins;
 extern bool loadMESS;
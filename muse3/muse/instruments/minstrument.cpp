@@ -24,6 +24,8 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <assert.h>
+#include <atomic>
 
 #include <QAction>
 #include <QDir>
@@ -60,6 +62,9 @@ namespace MusECore {
 MidiInstrumentList midiInstruments;
 MidiInstrument* genericMidiInstrument;
 
+// Set once initMidiInstruments() is done. main() may run that on a thread.
+static std::atomic<bool> instrumentsLoaded(false);
+
 //---------------------------------------------------------
 //   string2sysex
 //   Return -1 if cannot be converted.
@@ -318,6 +323,19 @@ void initMidiInstruments()
       else
         printf("Instrument directory not found: %s\n", MusEGlobal::museInstruments.toLatin1().constData());
 
+      instrumentsLoaded.store(true, std::memory_order_release);
+      }
+
+//---------------------------------------------------------
+//   checkMidiInstrumentsLoaded
+//   main() reads the instrument definitions on a thread and
+//    joins it before initMidiPorts(). Nothing may use
+//    midiInstruments or genericMidiInstrument before that.
+//---------------------------------------------------------
+
+void checkMidiInstrumentsLoaded()
+      {
+      assert(instrumentsLoaded.load(std::memory_order_acquire));
       }
 
 //---------------------------------------------------------
@@ -326,6 +344,7 @@ void initMidiInstruments()
 
 MidiInstrument* registerMidiInstrument(const QString& name)
       {
+      checkMidiInstrumentsLoaded();
       for (iMidiInstrument i = midiInstruments.begin();
          i != midiInstruments.end(); ++i) {
             if ((*i)->iname() == name)
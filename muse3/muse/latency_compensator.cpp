@@ -36,7 +36,7 @@ LatencyCompensator::LatencyCompensator(unsigned long channels, unsigned long buf
   _delays = new unsigned long[channels];
   _writePointers = new unsigned long[channels];
 
-  for(int i = 0; i < _channels; ++i)
+  for(unsigned long i = 0; i < _channels; ++i)
   {
     _buffer[i] = new float[_bufferSize];
     memset(_buffer[i],  0, sizeof(float) * _bufferSize);
@@ -47,7 +47,7 @@ LatencyCompensator::LatencyCompensator(unsigned long channels, unsigned long buf
 
 LatencyCompensator::~LatencyCompensator()
 {
-  for(int i = 0; i < _channels; ++i)
+  for(unsigned long i = 0; i < _channels; ++i)
     delete [] _buffer[i];
   delete [] _buffer;
   delete [] _delays;
@@ -56,34 +56,36 @@ LatencyCompensator::~LatencyCompensator()
 
 void LatencyCompensator::clear()
 {
-  for(int i = 0; i < _channels; ++i)
+  for(unsigned long i = 0; i < _channels; ++i)
     memset(_buffer[i],  0, sizeof(float) * _bufferSize);
 }
 
 void LatencyCompensator::setBufferSize(unsigned long size)
 {
   _bufferSize = size;
-  for(int i = 0; i < _channels; ++i)
+  for(unsigned long i = 0; i < _channels; ++i)
   {
     delete [] _buffer[i];
     _buffer[i] = new float[_bufferSize];
     memset(_buffer[i],  0, sizeof(float) * _bufferSize);
+    _writePointers[i] = 0;
   }
 }
 
 void LatencyCompensator::setChannels(unsigned long channels)
 {
-  for(int i = 0; i < _channels; ++i)
+  for(unsigned long i = 0; i < _channels; ++i)
     delete [] _buffer[i];
   delete [] _buffer;
   delete [] _delays;
   delete [] _writePointers;
 
-  _buffer = new float*[channels];
-  _delays = new unsigned long[channels];
-  _writePointers = new unsigned long[channels];
+  _channels = channels;
+  _buffer = new float*[_channels];
+  _delays = new unsigned long[_channels];
+  _writePointers = new unsigned long[_channels];
 
-  for(int i = 0; i < _channels; ++i)
+  for(unsigned long i = 0; i < _channels; ++i)
   {
     _buffer[i] = new float[_bufferSize];
     memset(_buffer[i],  0, sizeof(float) * _bufferSize);
@@ -92,6 +94,27 @@ void LatencyCompensator::setChannels(unsigned long channels)
   }
 }
 
+unsigned long LatencyCompensator::bufferSizeFor(unsigned long delay)
+{
+  unsigned long size = DELAY_BUFFER_SIZE;
+  while(size <= delay && size < maxBufferSize)
+    size <<= 1;
+  return size;
+}
+
+bool LatencyCompensator::setDelay(unsigned long delay)
+{
+  bool fits = true;
+  if(delay >= _bufferSize)
+  {
+    delay = _bufferSize - 1;
+    fits = false;
+  }
+  for(unsigned long i = 0; i < _channels; ++i)
+    _delays[i] = delay;
+  return fits;
+}
+
 void LatencyCompensator::run(unsigned long SampleCount, float** data)
 {
   float inputSample;
@@ -106,7 +129,7 @@ void LatencyCompensator::run(unsigned long SampleCount, float** data)
   float* output;
   float* buf;
   
-  for(int ch = 0; ch < _channels; ++ch)
+  for(unsigned long ch = 0; ch < _channels; ++ch)
   {
     input = data[ch];
     output = data[ch];
@@ -38,12 +38,23 @@ class LatencyCompensator
     float** _buffer;
 
   public:
+    // The largest buffer size used for delay compensation, about 21 seconds at 48 kHz.
+    static const unsigned long maxBufferSize = 1048576;
+    // The smallest power of two buffer size which can hold the given delay, at most maxBufferSize.
+    static unsigned long bufferSizeFor(unsigned long delay);
+
     LatencyCompensator(unsigned long channels = 1, unsigned long bufferSize = 16384);
     virtual ~LatencyCompensator();
     
     void clear();
+    unsigned long channels() const { return _channels; }
+    unsigned long bufferSize() const { return _bufferSize; }
     void setBufferSize(unsigned long size);
     void setChannels(unsigned long channels);
+    // Sets the delay of all channels, in samples. Must be less than the buffer size.
+    // A longer delay is clamped to the buffer size - 1. Returns false if it was clamped.
+    bool setDelay(unsigned long delay);
+    unsigned long delay(unsigned long channel) const { return _delays[channel]; }
     void run(unsigned long SampleCount, float** data);
 };
 
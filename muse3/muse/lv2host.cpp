@@ -35,6 +35,7 @@
 #include <sys/stat.h>
 #include <iostream>
 #include <time.h>
+#include <pthread.h>
 #include <dlfcn.h>
 #include <QMessageBox>
 #include <QDirIterator>
@@ -69,6 +70,7 @@
 #include "components/popupmenu.h"
 #include "widgets/menutitleitem.h"
 #include "icons.h"
+#include "startup_profile.h"
 #include <ladspa.h>
 
 #include "muse_math.h"
@@ -230,29 +232,53 @@ LV2_Feature lv2Features [] =
 
 std::vector<LV2Synth *> synthsToFree;
 
+// Runs the worker requests of all instances. Created by initLV2().
+static LV2WorkerPool *lv2WorkerPool = NULL;
+
+// The uris this host maps itself. Every LV2UridBiMap starts out with them,
+//  so that they are looked up without locking from the start.
+static const char *lv2HostUris [] =
+{
+   LV2_MIDI__MidiEvent,
+   LV2_TIME__Position,
+   LV2_TIME__frame,
+   LV2_TIME__speed,
+   LV2_TIME__beatsPerMinute,
+   LV2_TIME__barBeat,
+   LV2_ATOM__eventTransfer,
+   LV2_ATOM__Chunk,
+   LV2_ATOM__Sequence,
+   LV2_ATOM__Object,
+   LV2_ATOM__Float,
+   LV2_ATOM__Double,
+   LV2_ATOM__Int,
+   LV2_ATOM__Long,
+   LV2_ATOM__Bool,
+   LV2_ATOM__String,
+   LV2_ATOM__Path,
+   LV2_ATOM__URID,
+   LV2_F_STATE_CHANGED,
+   LV2_P_SAMPLE_RATE,
+   LV2_P_MIN_BLKLEN,
+   LV2_P_MAX_BLKLEN,
+   LV2_P_SEQ_SIZE,
+   LV2_CORE__sampleRate
+};
+
 #define SIZEOF_ARRAY(x) sizeof(x)/sizeof(x[0])
 
-void initLV2()
-{
-#ifdef HAVE_GTK2
-  //----------------- 
-  // Initialize Gtk
-  //----------------- 
-  MusEGui::lv2Gtk2Helper_init();
-#endif
-    
-  std::set<std::string> supportedFeatures;
-  uint32_t i = 0;
+//---------------------------------------------------------
+//   loadLV2World
+//    Creating the world and loading all bundles is most of
+//     initLV2(), and needs nothing else of MusE.
+//---------------------------------------------------------
 
-  if(MusEGlobal::debugMsg)
-    std::cerr << "LV2: MusE supports these features:" << std::endl;
-    
-  for(i = 0; i < SIZEOF_ARRAY(lv2Features); i++)
-  {
-    supportedFeatures.insert(lv2Features [i].URI);
-    if(MusEGlobal::debugMsg)
-      std::cerr << "\t" << lv2Features [i].URI << std::endl;
-  }
+static pthread_t lv2WorldThread;
+static bool lv2WorldThreadStarted = false;
+
+static void* loadLV2World(void*)
+{
+  const long long start = startupProfileNow();
 
   lilvWorld = lilv_world_new();
 
@@ -283,6 +309,49 @@ void initLV2()
   lv2CacheNodes.end                    = NULL;
 
   lilv_world_load_all(lilvWorld);
+
+  startupProfileBackground("LV2 world", start, startupProfileNow());
+  return NULL;
+}
+
+void startLV2WorldLoad()
+{
+  if(!lv2WorldThreadStarted && pthread_create(&lv2WorldThread, NULL, loadLV2World, NULL) == 0)
+    lv2WorldThreadStarted = true;
+}
+
+void initLV2()
+{
+  // A few threads are enough for the worker requests of any number of instances.
+  lv2WorkerPool = new LV2WorkerPool(std::max(1, std::min(QThread::idealThreadCount(), 4)));
+
+#ifdef HAVE_GTK2
+  //----------------- 
+  // Initialize Gtk
+  //----------------- 
+  MusEGui::lv2Gtk2Helper_init();
+#endif
+    
+  std::set<std::string> supportedFeatures;
+  uint32_t i = 0;
+
+  if(MusEGlobal::debugMsg)
+    std::cerr << "LV2: MusE supports these features:" << std::endl;
+    
+  for(i = 0; i < SIZEOF_ARRAY(lv2Features); i++)
+  {
+    supportedFeatures.insert(lv2Features [i].URI);
+    if(MusEGlobal::debugMsg)
+      std::cerr << "\t" << lv2Features [i].URI << std::endl;
+  }
+
+  if(lv2WorldThreadStarted)
+  {
+    pthread_join(lv2WorldThread, NULL);
+    lv2WorldThreadStarted = false;
+  }
+  else
+    loadLV2World(NULL);
   
   // "Return a list of all found plugins.
   // The returned list contains just enough references to query
@@ -445,6 +514,9 @@ void deinitLV2()
    }
    synthsToFree.clear();
 
+   delete lv2WorkerPool;
+   lv2WorkerPool = NULL;
+
    for(LilvNode **n = (LilvNode **)&lv2CacheNodes; *n; ++n)
    {
       lilv_node_free(*n);
@@ -587,7 +659,8 @@ void LV2Synth::lv2state_FillFeatures(LV2PluginWrapper_State *state)
    state->wrkSched.handle = (LV2_Worker_Schedule_Handle)state;
    state->wrkSched.schedule_work = LV2Synth::lv2wrk_scheduleWork;
    state->wrkIface = NULL;
-   state->wrkThread = new LV2PluginWrapper_Worker(state);
+   state->wrkDataBuffer = new char [LV2_WRK_FIFO_ITEM_SIZE];
+   state->wrkRespBuffer = new char [LV2_WRK_FIFO_ITEM_SIZE];
 
    state->extHost.plugin_human_id = state->human_id = NULL;
    state->extHost.ui_closed = LV2Synth::lv2ui_ExtUi_Closed;
@@ -808,8 +881,6 @@ void LV2Synth::lv2state_PostInstantiate(LV2PluginWrapper_State *state)
 
    LV2Synth::lv2prg_updatePrograms(state);
 
-   state->wrkThread->start(QThread::LowPriority);
-
 }
 
 void LV2Synth::lv2ui_FreeDescriptors(LV2PluginWrapper_State *state)
@@ -838,9 +909,12 @@ void LV2Synth::lv2state_FreeState(LV2PluginWrapper_State *state)
 {
    assert(state != NULL);
 
-   state->wrkThread->setClosing();
-   state->wrkThread->wait();
-   delete state->wrkThread;
+   if(lv2WorkerPool != NULL)
+      lv2WorkerPool->waitIdle(state);
+   delete [] state->wrkDataBuffer;
+   state->wrkDataBuffer = NULL;
+   delete [] state->wrkRespBuffer;
+   state->wrkRespBuffer = NULL;
 
    if(state->human_id != NULL)
       free(state->human_id);
@@ -1562,31 +1636,43 @@ LV2_Worker_Status LV2Synth::lv2wrk_scheduleWork(LV2_Worker_Schedule_Handle handl
 #endif
    LV2PluginWrapper_State *state = (LV2PluginWrapper_State *)handle;
 
-   //assert(state->wrkEndWork != true);
-   if(state->wrkEndWork != false)
+   if(state->wrkIface == NULL || state->wrkIface->work == NULL)
       return LV2_WORKER_ERR_UNKNOWN;
 
-   state->wrkDataSize = size;
-   state->wrkDataBuffer = data;
-   if(MusEGlobal::audio->freewheel()) //don't wait for a thread. Do it now
-      state->wrkThread->makeWork();
-   else
-      return state->wrkThread->scheduleWork();
+   //don't wait for a thread. Do it now, unless earlier requests are still queued
+   if(MusEGlobal::audio->freewheel() && state->wrkPending.load() == 0)
+      return state->wrkIface->work(lilv_instance_get_handle(state->handle),
+                                   LV2Synth::lv2wrk_respond, state, size, data);
 
-   return LV2_WORKER_SUCCESS;
+   if(lv2WorkerPool == NULL)
+      return LV2_WORKER_ERR_UNKNOWN;
+   return lv2WorkerPool->schedule(state, size, data);
 }
 
+// The fifos can't hold empty items. The real size travels as the item's port index.
+static const char lv2WrkEmptyData = 0;
+
 LV2_Worker_Status LV2Synth::lv2wrk_respond(LV2_Worker_Respond_Handle handle, uint32_t size, const void *data)
 {
    LV2PluginWrapper_State *state = (LV2PluginWrapper_State *)handle;
 
-   state->wrkDataSize = size;
-   state->wrkDataBuffer = data;
-   state->wrkEndWork = true;
+   if(!state->wrkResponses.put(size, size != 0 ? size : 1, size != 0 ? data : &lv2WrkEmptyData))
+      return LV2_WORKER_ERR_NO_SPACE;
 
    return LV2_WORKER_SUCCESS;
 }
 
+void LV2Synth::lv2wrk_processResponses(LV2PluginWrapper_State *state)
+{
+   uint32_t size;
+   size_t itemSize;
+   while(state->wrkResponses.get(&size, &itemSize, state->wrkRespBuffer))
+   {
+      if(state->wrkIface && state->wrkIface->work_response)
+         state->wrkIface->work_response(lilv_instance_get_handle(state->handle), size, state->wrkRespBuffer);
+   }
+}
+
 void LV2Synth::lv2conf_write(LV2PluginWrapper_State *state, int level, Xml &xml)
 {
    state->iStateValues.clear();
@@ -1837,6 +1923,9 @@ void LV2Synth::lv2state_populatePresetsMenu(LV2PluginWrapper_State *state, MusEG
    //this is good by slow down menu population.
    //So it's called only on changes (preset save/manual update)
    //LV2Synth::lv2state_UnloadLoadPresets(synth, true);
+   // Load them the first time though, they are not looked up at startup.
+   if(!synth->_presetsLoaded)
+      LV2Synth::lv2state_UnloadLoadPresets(synth, true);
    MusEGui::MenuTitleItem *actPresetActionsHeader = new MusEGui::MenuTitleItem(QObject::tr("Preset actions"), menu);
    menu->addAction(actPresetActionsHeader);
    QAction *actSave = menu->addAction(QObject::tr("Save preset..."));
@@ -2115,6 +2204,7 @@ void LV2Synth::lv2state_UnloadLoadPresets(LV2Synth *synth, bool load, bool updat
       lilv_node_free(it->second);      
    }
    synth->_presets.clear();
+   synth->_presetsLoaded = load;
 
 
 
@@ -2220,7 +2310,8 @@ LV2Synth::LV2Synth(const QFileInfo &fi, QString label, QString name, QString aut
      _isConstructed(false),
      _pluginControlsDefault(NULL),
      _pluginControlsMin(NULL),
-     _pluginControlsMax(NULL)
+     _pluginControlsMax(NULL),
+     _presetsLoaded(false)
 {
 
    //fake id for LV2PluginWrapper functionality
@@ -2577,8 +2668,6 @@ LV2Synth::LV2Synth(const QFileInfo &fi, QString label, QString name, QString aut
 
    _presets.clear();
 
-   LV2Synth::lv2state_UnloadLoadPresets(this, true);
-
    _isConstructed = true;
 }
 
@@ -4136,13 +4225,8 @@ bool LV2SynthIF::getData(MidiPort *, unsigned int pos, int ports, unsigned int n
             if(_state->wrkIface && _state->wrkIface->end_run)
                _state->wrkIface->end_run(lilv_instance_get_handle(_handle));
             //notify worker about processed data (if any)
-            if(_state->wrkIface && _state->wrkIface->work_response && _state->wrkEndWork)
-            {
-               _state->wrkIface->work_response(lilv_instance_get_handle(_handle), _state->wrkDataSize, _state->wrkDataBuffer);
-               _state->wrkDataSize = 0;
-               _state->wrkDataBuffer = NULL;
-               _state->wrkEndWork = false;
-            }
+            if(_state->wrkIface && _state->wrkIface->work_response)
+               LV2Synth::lv2wrk_processResponses(_state);
 
             LV2Synth::lv2audio_postProcessMidiPorts(_state, nsamp);
 
@@ -5039,6 +5123,9 @@ void LV2PluginWrapper::apply(LADSPA_Handle handle, unsigned long n)
    for(size_t j = 0; j < state->plugInst->controlPorts; ++j)
    {
       uint32_t idx = state->synth->_controlInPorts [j].index;
+      // Already filled with one value per sample and connected by the PluginI.
+      if(state->plugInst->_audioRateCtrls && state->plugInst->_audioRateCtrls [j])
+         continue;
       if(state->pluginCVPorts [idx] != NULL)
       {
          float cvVal = state->plugInst->controls [j].val;
@@ -5070,16 +5157,20 @@ void LV2PluginWrapper::apply(LADSPA_Handle handle, unsigned long n)
    if(state->wrkIface && state->wrkIface->end_run)
       state->wrkIface->end_run(lilv_instance_get_handle(state->handle));
    //notify worker about processes data (if any)
-   if(state->wrkIface && state->wrkIface->work_response && state->wrkEndWork)
-   {
-      state->wrkEndWork = false;
-      state->wrkIface->work_response(lilv_instance_get_handle(state->handle), state->wrkDataSize, state->wrkDataBuffer);
-      state->wrkDataSize = 0;
-      state->wrkDataBuffer = NULL;
-   }
+   if(state->wrkIface && state->wrkIface->work_response)
+      LV2Synth::lv2wrk_processResponses(state);
 
    LV2Synth::lv2audio_postProcessMidiPorts(state, n);
 }
+bool LV2PluginWrapper::isAudioRateCtrl(unsigned long port) const
+{
+   for(size_t j = 0; j < _synth->_controlInPorts.size(); ++j)
+   {
+      if(_synth->_controlInPorts [j].index == port)
+         return _synth->_controlInPorts [j].isCVPort;
+   }
+   return false;
+}
 LADSPA_PortDescriptor LV2PluginWrapper::portd(unsigned long k) const
 {
    return _fakeLd.PortDescriptors[k];
@@ -5240,51 +5331,106 @@ void LV2PluginWrapper::applyPreset(PluginI *p, void *preset)
 
 }
 
-void LV2PluginWrapper_Worker::run()
+LV2WorkerPool::LV2WorkerPool(int numThreads) :
+   _ready(4096),
+   _sem(0),
+   _closing(false)
 {
-   while(true)
+   for(int i = 0; i < numThreads; ++i)
    {
-      _mSem.acquire(1);
-      if(_closing)
-         break;
-      makeWork();
-
+      WorkerThread *t = new WorkerThread(this);
+      _threads.push_back(t);
+      t->start(QThread::LowPriority);
    }
+}
 
+LV2WorkerPool::~LV2WorkerPool()
+{
+   _closing.store(true);
+   _sem.release((int)_threads.size());
+   for(size_t i = 0; i < _threads.size(); ++i)
+   {
+      _threads [i]->wait();
+      delete _threads [i];
+   }
+   _threads.clear();
 }
 
-LV2_Worker_Status LV2PluginWrapper_Worker::scheduleWork()
+LV2_Worker_Status LV2WorkerPool::schedule(LV2PluginWrapper_State *state, uint32_t size, const void *data)
 {
-   if(_mSem.available() != 0)
+   if(!state->wrkRequests.put(size, size != 0 ? size : 1, size != 0 ? data : &lv2WrkEmptyData))
       return LV2_WORKER_ERR_NO_SPACE;
-   _mSem.release(1);
+
+   // Only the first pending request hands the instance to the pool.
+   //  The thread which picks it up runs the later ones, too.
+   if(state->wrkPending.fetch_add(1) == 0)
+   {
+      if(!_ready.put(state))
+      {
+         fprintf(stderr, "LV2WorkerPool::schedule: ready ring is full\n");
+         // Take the request back, so that a retry does not run it twice.
+         //  With nothing pending no thread reads the fifo, and it holds
+         //  just this request.
+         state->wrkRequests.discard();
+         state->wrkPending.fetch_sub(1);
+         return LV2_WORKER_ERR_NO_SPACE;
+      }
+      _sem.release(1);
+   }
    return LV2_WORKER_SUCCESS;
+}
 
+void LV2WorkerPool::waitIdle(LV2PluginWrapper_State *state)
+{
+   _idleLock.lock();
+   // The timeout covers a failed schedule() taking its request back,
+   //  the audio thread cannot wake anyone.
+   while(state->wrkPending.load() != 0)
+      _idle.wait(&_idleLock, 100);
+   _idleLock.unlock();
 }
 
-void LV2PluginWrapper_Worker::makeWork()
+void LV2WorkerPool::threadLoop()
 {
-#ifdef DEBUG_LV2
-   std::cerr << "LV2PluginWrapper_Worker::makeWork" << std::endl;
-#endif
-   if(_state->wrkIface && _state->wrkIface->work)
+   while(true)
    {
-      const void *dataBuffer = _state->wrkDataBuffer;
-      uint32_t dataSize = _state->wrkDataSize;
-      _state->wrkDataBuffer = NULL;
-      _state->wrkDataSize = 0;
-      if(_state->wrkIface->work(lilv_instance_get_handle(_state->handle),
-                                LV2Synth::lv2wrk_respond,
-                                _state,
-                                dataSize,
-                                dataBuffer) != LV2_WORKER_SUCCESS)
-      {
-         _state->wrkEndWork = false;
-         _state->wrkDataBuffer = NULL;
-         _state->wrkDataSize = 0;
-      }
+      _sem.acquire(1);
+      if(_closing.load())
+         break;
+
+      LV2PluginWrapper_State *state;
+      _readLock.lock();
+      const bool found = _ready.get(state);
+      _readLock.unlock();
+      if(!found)
+         continue;
+
+      do
+         runWork(state);
+      while(state->wrkPending.fetch_sub(1) > 1);
+
+      // Not touching the state any more, it may be freed now.
+      _idleLock.lock();
+      _idle.wakeAll();
+      _idleLock.unlock();
    }
+}
 
+void LV2WorkerPool::runWork(LV2PluginWrapper_State *state)
+{
+#ifdef DEBUG_LV2
+   std::cerr << "LV2WorkerPool::runWork" << std::endl;
+#endif
+   uint32_t size;
+   size_t itemSize;
+   if(!state->wrkRequests.get(&size, &itemSize, state->wrkDataBuffer))
+      return;
+   if(state->wrkIface && state->wrkIface->work)
+      state->wrkIface->work(lilv_instance_get_handle(state->handle),
+                            LV2Synth::lv2wrk_respond,
+                            state,
+                            size,
+                            state->wrkDataBuffer);
 }
 
 LV2EvBuf::LV2EvBuf(bool isInput, bool oldApi, LV2_URID atomTypeSequence, LV2_URID atomTypeChunk)
@@ -5501,9 +5647,9 @@ void LV2EvBuf::dump()
    }
 }
 
-LV2SimpleRTFifo::LV2SimpleRTFifo(size_t size):
+LV2SimpleRTFifo::LV2SimpleRTFifo(size_t size, size_t item_size):
    fifoSize(size),
-   itemSize(LV2_RT_FIFO_ITEM_SIZE)
+   itemSize(item_size)
 {
    eventsBuffer.resize(fifoSize);
    assert(eventsBuffer.size() == fifoSize);
@@ -5595,33 +5741,102 @@ bool LV2SimpleRTFifo::get(uint32_t *port_index, size_t *szOut, char *data_out)
    return true;
 }
 
-LV2UridBiMap::LV2UridBiMap() : nextId ( 1 ) {_map.clear(); _rmap.clear();}
+bool LV2SimpleRTFifo::discard()
+{
+   size_t i = readIndex;
+   if(eventsBuffer.at(i).buffer_size == 0)
+      return false;
+   __sync_fetch_and_and(&eventsBuffer.at(i).buffer_size, 0);
+   readIndex = (i + 1) % fifoSize;
+   return true;
+}
+
+LV2UridBiMap::LV2UridBiMap() : nextId ( 1 )
+{
+   for(uint32_t i = 0; i < numBuckets; ++i)
+      _buckets [i].store(NULL);
+   for(uint32_t i = 0; i < maxIdChunks; ++i)
+      _idChunks [i] = NULL;
+
+   for(size_t i = 0; i < SIZEOF_ARRAY(lv2HostUris); ++i)
+      map(lv2HostUris [i]);
+}
 
 LV2UridBiMap::~LV2UridBiMap()
 {
-   LV2_SYNTH_URID_MAP::iterator it = _map.begin();
-   for(;it != _map.end(); ++it)
+   for(uint32_t i = 0; i < numBuckets; ++i)
+   {
+      UridNode *n = _buckets [i].load();
+      while(n != NULL)
+      {
+         UridNode *next = n->next;
+         free((void*)n->uri);
+         delete n;
+         n = next;
+      }
+   }
+   for(uint32_t i = 0; i < maxIdChunks; ++i)
+      delete [] _idChunks [i];
+}
+
+uint32_t LV2UridBiMap::hash(const char *uri)
+{
+   // FNV-1a
+   uint32_t h = 2166136261u;
+   for(; *uri; ++uri)
    {
-      free((void*)(*it).first);
+      h ^= (unsigned char)*uri;
+      h *= 16777619u;
    }
+   return h;
+}
+
+const LV2UridBiMap::UridNode *LV2UridBiMap::find(const char *uri, uint32_t bucket) const
+{
+   for(const UridNode *n = _buckets [bucket].load(std::memory_order_acquire); n != NULL; n = n->next)
+   {
+      if(strcmp(n->uri, uri) == 0)
+         return n;
+   }
+   return NULL;
 }
 
 LV2_URID LV2UridBiMap::map(const char *uri)
 {
-   std::pair<LV2_SYNTH_URID_MAP::iterator, bool> p;
-   uint32_t id;
+   const uint32_t bucket = hash(uri) % numBuckets;
+   const UridNode *n = find(uri, bucket);
+   if(n != NULL)
+      return n->id;
+
    idLock.lock();
-   LV2_SYNTH_URID_MAP::iterator it = _map.find(uri);
-   if(it == _map.end())
+   // Someone else may have added it meanwhile.
+   n = find(uri, bucket);
+   if(n != NULL)
    {
-      const char *mUri = strdup(uri);
-      p = _map.insert ( std::make_pair ( mUri, nextId ) );
-      _rmap.insert ( std::make_pair ( nextId, mUri ) );
-      nextId++;
-      id = p.first->second;
+      idLock.unlock();
+      return n->id;
    }
-   else
-      id = it->second;
+
+   const uint32_t id = nextId.load(std::memory_order_relaxed);
+   const uint32_t chunk = (id - 1) / idChunkSize;
+   if(chunk >= maxIdChunks)
+   {
+      idLock.unlock();
+      fprintf(stderr, "LV2UridBiMap::map: too many uris, can't map %s\n", uri);
+      return 0;
+   }
+   if(_idChunks [chunk] == NULL)
+      _idChunks [chunk] = new const char * [idChunkSize];
+
+   UridNode *newNode = new UridNode;
+   newNode->uri = strdup(uri);
+   newNode->id = id;
+   newNode->next = _buckets [bucket].load(std::memory_order_relaxed);
+   _idChunks [chunk] [(id - 1) % idChunkSize] = newNode->uri;
+
+   // Publish the uri to the lock-free readers of map() and unmap().
+   nextId.store(id + 1, std::memory_order_release);
+   _buckets [bucket].store(newNode, std::memory_order_release);
    idLock.unlock();
    return id;
 
@@ -5629,12 +5844,10 @@ LV2_URID LV2UridBiMap::map(const char *uri)
 
 const char *LV2UridBiMap::unmap(uint32_t id)
 {
-   LV2_SYNTH_URID_RMAP::iterator it = _rmap.find ( id );
-   if ( it != _rmap.end() ) {
-      return it->second;
-   }
+   if(id == 0 || id >= nextId.load(std::memory_order_acquire))
+      return NULL;
 
-   return NULL;
+   return _idChunks [(id - 1) / idChunkSize] [(id - 1) % idChunkSize];
 }
 
 }
@@ -5643,6 +5856,7 @@ const char *LV2UridBiMap::unmap(uint32_t id)
 namespace MusECore
 {
 void initLV2() {}
+void startLV2WorldLoad() {}
 }
 #endif
 
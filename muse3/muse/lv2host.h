@@ -72,6 +72,7 @@
 #include "lv2extui.h"
 #include "lv2extprg.h"
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 #include <vector>
@@ -83,6 +84,7 @@
 #include <QSemaphore>
 #include <QThread>
 #include <QTimer>
+#include <QWaitCondition>
 #include <QWindow>
 
 #include <assert.h>
@@ -95,6 +97,7 @@
 
 #include "plugin.h"
 #include "plugin_list.h"
+#include "lock_free_buffer.h"
 
 #endif
 
@@ -111,6 +114,9 @@ class LV2Synth;
 #define LV2_RT_FIFO_SIZE 128
 #define LV2_RT_FIFO_ITEM_SIZE (std::max(size_t(4096 * 16), size_t(MusEGlobal::segmentSize * 16)))
 #define LV2_EVBUF_SIZE (2*LV2_RT_FIFO_ITEM_SIZE)
+// Worker requests and responses are copied into fifos of their own, one pair per instance.
+#define LV2_WRK_FIFO_SIZE 16
+#define LV2_WRK_FIFO_ITEM_SIZE 8192
 
 struct LV2MidiEvent
 {
@@ -162,11 +168,13 @@ private:
    size_t fifoSize;
    size_t itemSize;
 public:
-   LV2SimpleRTFifo(size_t size);
+   LV2SimpleRTFifo(size_t size, size_t item_size = LV2_RT_FIFO_ITEM_SIZE);
    ~LV2SimpleRTFifo();
    inline size_t getItemSize(){return itemSize; }
    bool put(uint32_t port_index, uint32_t size, const void *data);
    bool get(uint32_t *port_index, size_t *szOut, char *data_out);
+   // Drops the oldest item.
+   bool discard();
 };
 
 
@@ -248,16 +256,34 @@ struct cmp_str
 typedef std::vector<LV2MidiPort> LV2_MIDI_PORTS;
 typedef std::vector<LV2ControlPort> LV2_CONTROL_PORTS;
 typedef std::vector<LV2AudioPort> LV2_AUDIO_PORTS;
-typedef std::map<const char *, uint32_t, cmp_str> LV2_SYNTH_URID_MAP;
-typedef std::map<uint32_t, const char *> LV2_SYNTH_URID_RMAP;
+
+//---------------------------------------------------------
+//   LV2UridBiMap
+//    map() and unmap() of already mapped uris do not lock,
+//    plugins call them from the audio thread. New uris are
+//    added under idLock and stay until the map is destroyed.
+//---------------------------------------------------------
 
 class LV2UridBiMap
 {
 private:
-    LV2_SYNTH_URID_MAP _map;
-    LV2_SYNTH_URID_RMAP _rmap;
-    uint32_t nextId;
+    struct UridNode
+    {
+       const char *uri;
+       LV2_URID id;
+       UridNode *next;
+    };
+    static const uint32_t numBuckets = 1024;
+    static const uint32_t idChunkSize = 1024;
+    static const uint32_t maxIdChunks = 1024;
+    // Hashed uris. A bucket's list only ever grows at its head.
+    std::atomic<UridNode *> _buckets [numBuckets];
+    // Uris by id, in chunks which are never moved.
+    const char **_idChunks [maxIdChunks];
+    std::atomic<uint32_t> nextId;
     QMutex idLock;
+    static uint32_t hash(const char *uri);
+    const UridNode *find(const char *uri, uint32_t bucket) const;
 public:
     LV2UridBiMap();
     ~LV2UridBiMap();
@@ -331,6 +357,8 @@ private:
     float *_pluginControlsMin;
     float *_pluginControlsMax;
     std::map<QString, LilvNode *> _presets;
+    // Presets are looked up when the presets menu is first shown.
+    bool _presetsLoaded;
 public:
     virtual Type synthType() const {
         return _isSynth ? LV2_SYNTH : LV2_EFFECT;
@@ -373,7 +401,8 @@ public:
     static const void *lv2state_stateRetreive ( LV2_State_Handle handle, uint32_t key, size_t *size, uint32_t *type, uint32_t *flags );
     static LV2_State_Status lv2state_stateStore ( LV2_State_Handle handle, uint32_t key, const void *value, size_t size, uint32_t type, uint32_t flags );
     static LV2_Worker_Status lv2wrk_scheduleWork(LV2_Worker_Schedule_Handle handle, uint32_t size, const void *data);
-    static LV2_Worker_Status lv2wrk_respond(LV2_Worker_Respond_Handle handle, uint32_t size, const void* data);    
+    static LV2_Worker_Status lv2wrk_respond(LV2_Worker_Respond_Handle handle, uint32_t size, const void* data);
+    static void lv2wrk_processResponses(LV2PluginWrapper_State *state);    
     static void lv2conf_write(LV2PluginWrapper_State *state, int level, Xml &xml);
     static void lv2conf_set(LV2PluginWrapper_State *state, const std::vector<QString> & customParams);
     static unsigned lv2ui_IsSupported (const char *, const char *ui_type_uri);
@@ -496,7 +525,6 @@ public:
 
 
 class LV2PluginWrapper;
-class LV2PluginWrapper_Worker;
 class LV2PluginWrapper_Window;
 
 typedef struct _lv2ExtProgram
@@ -549,10 +577,11 @@ struct LV2PluginWrapper_State {
       iState(NULL),
       tmpValues(NULL),
       numStateValues(0),
-      wrkDataSize(0),
-      wrkDataBuffer(0),
-      wrkThread(NULL),
-      wrkEndWork(false),
+      wrkRequests(LV2_WRK_FIFO_SIZE, LV2_WRK_FIFO_ITEM_SIZE),
+      wrkResponses(LV2_WRK_FIFO_SIZE, LV2_WRK_FIFO_ITEM_SIZE),
+      wrkDataBuffer(NULL),
+      wrkRespBuffer(NULL),
+      wrkPending(0),
       controlTimers(NULL),
       deleteLater(false),
       hasGui(false),
@@ -621,11 +650,12 @@ struct LV2PluginWrapper_State {
     QMap<QString, QPair<QString, QVariant> > iStateValues;
     char **tmpValues;
     size_t numStateValues;
-    uint32_t wrkDataSize;
-    const void *wrkDataBuffer;
-    LV2PluginWrapper_Worker *wrkThread;
+    LV2SimpleRTFifo wrkRequests;   // audio thread -> worker pool
+    LV2SimpleRTFifo wrkResponses;  // worker pool -> audio thread
+    char *wrkDataBuffer;           // used by the worker pool
+    char *wrkRespBuffer;           // used by the audio thread
+    std::atomic<int> wrkPending;   // requests scheduled but not yet run
     LV2_Worker_Interface *wrkIface;
-    bool wrkEndWork;
     int *controlTimers;
     bool deleteLater;
     LV2_Atom_Forge atomForge;
@@ -668,24 +698,46 @@ struct LV2PluginWrapper_State {
 };
 
 
-class LV2PluginWrapper_Worker :public QThread
+//---------------------------------------------------------
+//   LV2WorkerPool
+//    A few low priority threads running the worker requests
+//    of all LV2 instances. The requests of one instance are
+//    run in the order they were scheduled and never on two
+//    threads at once.
+//---------------------------------------------------------
+
+class LV2WorkerPool
 {
 private:
-    LV2PluginWrapper_State *_state;
-    QSemaphore _mSem;
-    bool _closing;
-public:
-    explicit LV2PluginWrapper_Worker ( LV2PluginWrapper_State *s ) : QThread(),
-       _state ( s ),
-       _mSem(0),
-       _closing(false)
-    {}
-
-    void run();
-    LV2_Worker_Status scheduleWork();
-    void makeWork();
-    void setClosing() {_closing = true; _mSem.release();}
+    class WorkerThread : public QThread
+    {
+       LV2WorkerPool *_pool;
+    public:
+       explicit WorkerThread(LV2WorkerPool *pool) : QThread(), _pool(pool) {}
+       void run() { _pool->threadLoop(); }
+    };
+
+    std::vector<WorkerThread *> _threads;
+    // Instances with pending requests which no thread is working on.
+    LockFreeMPSCRingBuffer<LV2PluginWrapper_State *> _ready;
+    // The ring has a single reader: taken by the pool threads only.
+    QMutex _readLock;
+    QSemaphore _sem;
+    std::atomic<bool> _closing;
+    // Woken whenever a thread has run all requests of an instance.
+    QMutex _idleLock;
+    QWaitCondition _idle;
+
+    void threadLoop();
+    static void runWork(LV2PluginWrapper_State *state);
 
+public:
+    explicit LV2WorkerPool(int numThreads);
+    ~LV2WorkerPool();
+    // Copies the request and queues it. Called from the audio thread.
+    LV2_Worker_Status schedule(LV2PluginWrapper_State *state, uint32_t size, const void *data);
+    // Waits until all requests of the instance have been run.
+    void waitIdle(LV2PluginWrapper_State *state);
 };
 
 
@@ -752,6 +804,7 @@ public:
     virtual const char *portName ( unsigned long i );
     virtual CtrlValueType ctrlValueType ( unsigned long ) const;
     virtual CtrlList::Mode ctrlMode ( unsigned long ) const;
+    virtual bool isAudioRateCtrl ( unsigned long port ) const;
     virtual bool hasNativeGui() const;
     virtual void showNativeGui ( PluginI *p, bool bShow );
     virtual bool nativeGuiVisible (const PluginI *p ) const;
@@ -766,6 +819,8 @@ public:
 #endif // LV2_SUPPORT
 
 extern void initLV2();
+// Starts creating the lilv world and loading all bundles on a thread. initLV2() waits for it.
+extern void startLV2WorldLoad();
 
 } // namespace MusECore
 
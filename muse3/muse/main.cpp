@@ -41,6 +41,7 @@
 
 #include <unistd.h>
 #include <time.h>
+#include <pthread.h>
 #ifndef _WIN32
 #include <sys/mman.h>
 #endif
@@ -70,6 +71,8 @@
 #include "wavepreview.h"
 #include "plugin_cache_writer.h"
 #include "pluglist.h"
+#include "offlinerender.h"
+#include "startup_profile.h"
 
 #ifdef HAVE_LASH
 #include <lash/lash.h>
@@ -90,6 +93,7 @@ extern void initPlugins();
 extern void initDSSI();
 #ifdef LV2_SUPPORT
 extern void initLV2();
+extern void startLV2WorldLoad();
 extern void deinitLV2();
 #endif
 extern void readConfiguration();
@@ -98,6 +102,7 @@ extern void initMidiSequencer();
 extern void exitMidiSequencer();
 extern void initAudio();
 extern void initAudioPrefetch();   
+extern void initAudioGraph();
 extern void initMidiSynth();
 
 #ifdef ALSA_SUPPORT
@@ -258,6 +263,10 @@ static void usage(const char* prog, const char* txt)
       fprintf(stderr, "   -P  n    Set audio driver real time priority to n\n");
       fprintf(stderr, "                        (Dummy only, default 40. Else fixed by Jack.)\n");
       fprintf(stderr, "   -Y  n    Force midi real time priority to n (default: audio driver prio -1)\n");
+      fprintf(stderr, "   -r  dir  Render the song to dir without gui, as fast as possible, then quit:\n");
+      fprintf(stderr, "            master.wav plus one stem per track (uses the dummy audio driver)\n");
+      fprintf(stderr, "   -f  fmt  Format of the rendered files (default wav24):\n");
+      fprintf(stderr, "            %s\n", MusECore::OfflineRender::formatNames());
       fprintf(stderr, "\n");
       fprintf(stderr, "   -R       Force plugin cache re-scan. (Automatic if any plugin path directories changed.)\n");
       fprintf(stderr, "   -p       Don't load LADSPA plugins\n");
@@ -293,6 +302,7 @@ static void usage(const char* prog, const char* txt)
       fprintf(stderr, "   -m       Debug mode: trace midi Input\n");
       fprintf(stderr, "   -M       Debug mode: trace midi Output\n");
       fprintf(stderr, "   -s       Debug mode: trace sync\n");
+      fprintf(stderr, "   --startup-profile  Print the time taken by each startup stage\n");
       fprintf(stderr, "\n");
 #ifdef HAVE_LASH
       fprintf(stderr, "LASH and ");
@@ -332,6 +342,21 @@ static void usage(const char* prog, const char* txt)
       }
 
 
+//---------------------------------------------------------
+//   loadMidiInstruments
+//    Reading the instrument definitions needs nothing of the
+//     startup before initMidiPorts(), so it runs on a thread
+//     meanwhile.
+//---------------------------------------------------------
+
+static void* loadMidiInstruments(void*)
+      {
+      const long long start = MusECore::startupProfileNow();
+      MusECore::initMidiInstruments();
+      MusECore::startupProfileBackground("midi instruments", start, MusECore::startupProfileNow());
+      return 0;
+      }
+
 void fallbackDummy() {
 
   fprintf(stderr, "Falling back to dummy audio driver\n");
@@ -347,6 +372,7 @@ void fallbackDummy() {
 
 int main(int argc, char* argv[])
       {
+      MusECore::startupProfileStart();
       MusEGlobal::museUser = QString(getenv("HOME"));
       MusEGlobal::museGlobalLib   = QString(LIBDIR);
       MusEGlobal::museGlobalShare = QString(SHAREDIR);
@@ -383,6 +409,7 @@ int main(int argc, char* argv[])
 
       MusEGui::initShortCuts();
       MusECore::readConfiguration();
+      MusECore::startupProfileStage("configuration");
       
       // Need to put a sane defaults here because we can't use '~' in the file name strings.
       if(!cConfExists)
@@ -577,9 +604,13 @@ int main(int argc, char* argv[])
       bool plugin_rescan_already_done = false;
       int rv = 0;
       bool is_restarting = true; // First-time init true.
+      bool is_first_start = true;
       while(is_restarting)
       {
         is_restarting = false;
+        if(!is_first_start)
+          MusECore::startupProfileStart();
+        is_first_start = false;
 
         // Make working copies of the arguments.
         const int argument_count = argc;
@@ -608,6 +639,33 @@ int main(int argc, char* argv[])
         lash_args = lash_extract_args (&argc_copy, &argv_copy);
   #endif
 
+        // A long option, which neither getopt() nor Qt knows. Take it out before they see it.
+        MusEGlobal::startupProfile = false;
+        for(int i = 1; i < argc_copy; ++i)
+        {
+          if(argv_copy[i] && strcmp(argv_copy[i], "--startup-profile") == 0)
+          {
+            MusEGlobal::startupProfile = true;
+            free(argv_copy[i]);
+            for(int k = i; k < argc_copy - 1; ++k)
+              argv_copy[k] = argv_copy[k + 1];
+            argv_copy[--argc_copy] = 0;
+            break;
+          }
+        }
+
+        // Render mode has no windows, and must not need a display.
+        // Needs to be known before the application is created.
+        for(int i = 1; i < argc_copy; ++i)
+        {
+          if(argv_copy[i] && strcmp(argv_copy[i], "-r") == 0)
+          {
+            if(!getenv("QT_QPA_PLATFORM"))
+              setenv("QT_QPA_PLATFORM", "offscreen", true);
+            break;
+          }
+        }
+
         // Now create the application, and let Qt remove recognized arguments.
 #if QT_VERSION >= 0x050600
         QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
@@ -624,8 +682,9 @@ int main(int argc, char* argv[])
         //  but currently with Breeze or Oxygen, MDI sub windows  may be frozen!
         // Working with Breeze maintainer to fix problem... 2017/06/06 Tim.
         MusEGui::updateThemeAndStyle();
+        MusECore::startupProfileStage("application");
 
-        QString optstr("aJjFAhvdDumMsP:Y:l:pRSy");
+        QString optstr("aJjFAhvdDumMsP:Y:l:pRSyr:f:");
   #ifdef VST_SUPPORT
         optstr += QString("V");
   #endif
@@ -647,6 +706,8 @@ int main(int argc, char* argv[])
 
         AudioDriverSelect audioType = DriverConfigSetting;
         bool force_plugin_rescan = false;
+        QString render_dir;
+        int render_format = SF_FORMAT_WAV | SF_FORMAT_PCM_24;
         int i;
 
         // Now read the remaining arguments as our own...
@@ -702,6 +763,17 @@ int main(int argc, char* argv[])
                     case '2': MusEGlobal::loadLV2 = false; break;
                     case 'y': MusEGlobal::usePythonBridge = true; break;
                     case 'l': locale_override = QString(optarg); break;
+                    case 'r': render_dir = QString(optarg); break;
+                    case 'f': render_format = MusECore::OfflineRender::parseFormat(QString(optarg));
+                          if(render_format == 0)
+                          {
+                            usage(argv_copy[0], "unknown render format");
+  #ifdef HAVE_LASH
+                            if(lash_args) lash_args_destroy(lash_args);
+  #endif
+                            return -1;
+                          }
+                          break;
                     case 'h': usage(argv_copy[0], argv_copy[1]);
   #ifdef HAVE_LASH
                           if(lash_args) lash_args_destroy(lash_args);
@@ -726,6 +798,20 @@ int main(int argc, char* argv[])
         argc_copy -= optind;
         ++argc_copy;
 
+        if(!render_dir.isEmpty())
+        {
+          if(argc_copy < 2)
+          {
+            usage(argv_copy[0], "render needs a song file");
+  #ifdef HAVE_LASH
+            if(lash_args) lash_args_destroy(lash_args);
+  #endif
+            return -1;
+          }
+          // Only the dummy driver can run faster than real time.
+          audioType = DummyAudioOverride;
+        }
+
         srand(time(0));   // initialize random number generator
         //signal(SIGCHLD, catchSignal);  // interferes with initVST(). see also app.cpp, function catchSignal()
 
@@ -829,7 +915,7 @@ int main(int argc, char* argv[])
 
         QString splash_prefix;
         QSplashScreen* muse_splash = NULL;
-        if (MusEGlobal::config.showSplashScreen) {
+        if (MusEGlobal::config.showSplashScreen && render_dir.isEmpty()) {
             QPixmap splsh(MusEGlobal::museGlobalShare + "/splash.png");
 
             if (!splsh.isNull()) {
@@ -846,6 +932,18 @@ int main(int argc, char* argv[])
         //    END SHOW MUSE SPLASH SCREEN
         //-------------------------------------------------------
 
+        MusECore::startupProfileStage("splash screen");
+
+        // Read the instrument definitions while the plugins and audio are set up.
+        // Until the pthread_join() before initMidiPorts() below, nothing may read
+        //  midiInstruments or genericMidiInstrument. What runs meanwhile does not:
+        //  initMidiSynth() only lists the synths, the Song created by MusE() is
+        //  cleared without touching the midi ports, and initMidiDevices() only
+        //  creates devices. registerMidiInstrument() complains if this breaks.
+        pthread_t instruments_thread;
+        const bool instruments_threaded = !MusEGlobal::debugMode &&
+          pthread_create(&instruments_thread, 0, loadMidiInstruments, 0) == 0;
+
         //-------------------------------------------------------
         //    BEGIN Plugin scanning
         //-------------------------------------------------------
@@ -913,6 +1011,14 @@ int main(int argc, char* argv[])
         //   END Plugin scanning
         //-------------------------------------------------------
 
+        MusECore::startupProfileStage("plugin cache");
+
+  #ifdef LV2_SUPPORT
+        // The bulk of initLV2() only depends on the plugin cache being written. Get it going.
+        if(MusEGlobal::loadLV2 && !MusEGlobal::debugMode)
+              MusECore::startLV2WorldLoad();
+  #endif
+
 
         AL::initDsp();
         
@@ -923,17 +1029,23 @@ int main(int argc, char* argv[])
         }
         
         MusECore::initAudio();
+        MusECore::startupProfileStage("audio system");
 
         MusEGui::initIcons(MusEGlobal::config.useThemeIconsIfPossible);
+        MusECore::startupProfileStage("icons");
 
         if (MusEGlobal::loadMESS)
+        {
           MusECore::initMidiSynth(); // Need to do this now so that Add Track -> Synth menu is populated when MusE is created.
+          MusECore::startupProfileStage("MESS synths");
+        }
 
         MusEGlobal::muse = new MusEGui::MusE();
         app.setMuse(MusEGlobal::muse);
         
         MusEGui::init_function_dialogs();
         MusEGui::retranslate_function_dialogs();
+        MusECore::startupProfileStage("main window");
 
         if(muse_splash)
         {
@@ -976,7 +1088,8 @@ int main(int argc, char* argv[])
         }
         else if (audioType == DummyAudioOverride) {
             fprintf(stderr, "Force Dummy Audio driver\n");
-            MusEGlobal::realTimeScheduling = true;
+            // A realtime thread which never sleeps while rendering could starve everyone else.
+            MusEGlobal::realTimeScheduling = render_dir.isEmpty();
             MusECore::initDummyAudio();
         }
 #ifdef HAVE_RTAUDIO
@@ -1076,6 +1189,8 @@ int main(int argc, char* argv[])
         // setup the prefetch fifo length now that the segmentSize is known
         MusEGlobal::fifoLength = 131072 / MusEGlobal::segmentSize;
         MusECore::initAudioPrefetch();
+        MusECore::initAudioGraph();
+        MusECore::startupProfileStage("audio driver");
 
         if(muse_splash)
         {
@@ -1098,10 +1213,16 @@ int main(int argc, char* argv[])
 //           usleep(10000);
         // Now it is safe to call registerClient.
         MusEGlobal::audioDevice->registerClient();
+        MusECore::startupProfileStage("midi devices");
 
         MusECore::initMidiController();
-        MusECore::initMidiInstruments();
+        if(instruments_threaded)
+          pthread_join(instruments_thread, 0);
+        else
+          MusECore::initMidiInstruments();
+        MusECore::startupProfileStage("midi instruments");
         MusECore::initMidiPorts();
+        MusECore::startupProfileStage("midi ports");
 
         if(muse_splash)
         {
@@ -1110,19 +1231,34 @@ int main(int argc, char* argv[])
         }
 
         if (MusEGlobal::loadPlugins)
+        {
               MusECore::initPlugins();
+              MusECore::startupProfileStage("LADSPA plugins");
+        }
 
         if (MusEGlobal::loadVST)
+        {
               MusECore::initVST();
+              MusECore::startupProfileStage("VST plugins");
+        }
 
         if (MusEGlobal::loadNativeVST)
+        {
               MusECore::initVST_Native();
+              MusECore::startupProfileStage("native VST plugins");
+        }
 
         if(MusEGlobal::loadDSSI)
+        {
               MusECore::initDSSI();
+              MusECore::startupProfileStage("DSSI plugins");
+        }
   #ifdef LV2_SUPPORT
         if(MusEGlobal::loadLV2)
+        {
               MusECore::initLV2();
+              MusECore::startupProfileStage("LV2 plugins");
+        }
   #endif
 
         MusECore::initOSC();
@@ -1132,6 +1268,7 @@ int main(int argc, char* argv[])
         MusECore::initWavePreview(MusEGlobal::segmentSize);
 
         MusECore::enumerateJackMidiDevices();
+        MusECore::startupProfileStage("metronome, OSC, jack midi");
 
   #ifdef HAVE_LASH
         {
@@ -1176,8 +1313,11 @@ int main(int argc, char* argv[])
         }
 
         MusEGlobal::muse->populateAddTrack(); // could possibly be done in a thread.
+        MusECore::startupProfileStage("track types");
 
-        MusEGlobal::muse->show();
+        if(render_dir.isEmpty())
+          MusEGlobal::muse->show();
+        MusECore::startupProfileStage("show main window");
 
         // Let the configuration settings take effect. Do not save.
         MusEGlobal::muse->changeConfig(false);
@@ -1208,6 +1348,7 @@ int main(int argc, char* argv[])
           (MusEGlobal::config.startMode == 1 || MusEGlobal::config.startMode == 2) &&
           !MusEGlobal::config.startSongLoadConfig)
           MusECore::populateMidiPorts();
+        MusECore::startupProfileStage("sequencer start");
 
         if(muse_splash)
         {
@@ -1224,8 +1365,18 @@ int main(int argc, char* argv[])
         // Load the default song.
         //--------------------------------------------------
         MusEGlobal::muse->loadDefaultSong(argc_copy, &argv_copy[optind]);
+        MusECore::startupProfileStage("default song");
+        MusECore::startupProfileReport();
 
-        QTimer::singleShot(100, MusEGlobal::muse, SLOT(showDidYouKnowDialog()));
+        if(render_dir.isEmpty())
+          QTimer::singleShot(100, MusEGlobal::muse, SLOT(showDidYouKnowDialog()));
+        else
+        {
+          // Owned by muse. Starts once the event loop runs.
+          MusECore::OfflineRender* render =
+            new MusECore::OfflineRender(render_dir, render_format, MusEGlobal::muse);
+          QTimer::singleShot(0, render, SLOT(start()));
+        }
 
         //--------------------------------------------------
         // Start the application...
@@ -48,6 +48,7 @@
 #include "gconfig.h"
 #include "ticksynth.h"
 #include "mpevent.h"
+#include "packed_events.h"
 
 // REMOVE Tim. Persistent routes. Added. Make this permanent later if it works OK and makes good sense.
 #define _USE_MIDI_ROUTE_PER_CHANNEL_
@@ -1014,55 +1015,10 @@ void Audio::seekMidi()
         continue;
       int ctlnum = vl->num();
 
-      // Find the first non-muted value at the given tick...
-      bool values_found = false;
-      bool found_value = false;
-      
-      iMidiCtrlVal imcv = vl->lower_bound(pos);
-      if(imcv != vl->end() && imcv->first == pos)
-      {
-        for( ; imcv != vl->end() && imcv->first == pos; ++imcv)
-        {
-          const Part* p = imcv->second.part;
-          if(!p)
-            continue;
-          // Ignore values that are outside of the part.
-          if(pos < p->tick() || pos >= (p->tick() + p->lenTick()))
-            continue;
-          values_found = true;
-          // Ignore if part or track is muted or off.
-          if(p->mute())
-            continue;
-          const Track* track = p->track();
-          if(track && (track->isMute() || track->off()))
-            continue;
-          found_value = true;
-          break;
-        }
-      }
-      else
-      {
-        while(imcv != vl->begin())
-        {
-          --imcv;
-          const Part* p = imcv->second.part;
-          if(!p)
-            continue;
-          // Ignore values that are outside of the part.
-          unsigned t = imcv->first;
-          if(t < p->tick() || t >= (p->tick() + p->lenTick()))
-            continue;
-          values_found = true;
-          // Ignore if part or track is muted or off.
-          if(p->mute())
-            continue;
-          const Track* track = p->track();
-          if(track && (track->isMute() || track->off()))
-            continue;
-          found_value = true;
-          break;
-        }
-      }
+      // Find the first non-muted value at the given tick, starting from the nearest checkpoint...
+      MidiCtrlChasePoint cp;
+      const bool found_value = vl->chase(pos, &cp);
+      const bool values_found = cp.valuesFound;
 
       if(found_value)
       {
@@ -1073,7 +1029,7 @@ void Audio::seekMidi()
         // Is it a drum controller event, according to the track port's instrument?
         if(mp->drumController(ctlnum))
         {
-          if(const Part* p = imcv->second.part)
+          if(const Part* p = cp.part)
           {
             if(Track* t = p->track())
             {
@@ -1096,7 +1052,7 @@ void Audio::seekMidi()
           }
         }
 
-        const MidiPlayEvent ev(0, fin_port, fin_chan, ME_CONTROLLER, fin_ctlnum, imcv->second.val);
+        const MidiPlayEvent ev(0, fin_port, fin_chan, ME_CONTROLLER, fin_ctlnum, cp.val);
         // This is the audio thread. Just set directly.
         fin_mp->setHwCtrlState(ev);
         // Don't bother sending any sustain values to the device, because we already
@@ -1261,6 +1217,255 @@ unsigned int Audio::extClockHistoryFrame2Tick(unsigned int frame) const
   return curTickPos;
 }
 
+//---------------------------------------------------------
+//   collectEvent
+//    Schedule one part event for playback.
+//    EV is an Event, or a PackedMidiEvent for notes and controllers.
+//---------------------------------------------------------
+
+template <class EV> void Audio::collectEvent(MidiTrack* track, const EV& ev, unsigned offset, unsigned stick,
+                                             int defaultPort, int& channel, MidiPort* mp, MidiDevice* md,
+                                             bool extsync, unsigned ev_fr, unsigned pos_fr, unsigned next_pos_fr)
+      {
+      int port = defaultPort;
+      //
+      //  don't play any meta events
+      //
+      if (ev.type() == Meta)
+            return;
+      if (track->type() == Track::DRUM) {
+            int instr = ev.pitch();
+            // ignore muted drums
+            if (ev.isNote() && MusEGlobal::drumMap[instr].mute)
+                  return;
+            }
+      else if (track->type() == Track::NEW_DRUM) {
+            int instr = ev.pitch();
+            // ignore muted drums
+            if (ev.isNote() && track->drummap()[instr].mute)
+                  return;
+            }
+      unsigned tick  = ev.tick() + offset;
+      
+      DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: event tick:%u\n", tick);
+
+      //-----------------------------------------------------------------
+      // Determining the playback scheduling frame from the event's tick:
+      //-----------------------------------------------------------------
+      unsigned frame;
+      if(extsync)
+        // If external sync is on, look up the scheduling frame from the tick,
+        //  in the external clock history list (which is cleared, re-composed, and processed each cycle).
+        // The function takes a tick relative to zero (ie. relative to the first event in this batch).
+        // The returned clock frame occurred during the previous audio cycle(s), so shift the frame 
+        //  forward by one audio segment size.
+        frame = extClockHistoryTick2Frame(tick - stick) + MusEGlobal::segmentSize;
+      else
+      {
+        // If external sync is off, the scheduling frame was looked up from our
+        //  tempo list by the caller ie. normal playback.
+        const unsigned int fr = ev_fr;
+        
+        DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: event: frame:%u\n", fr);
+          
+        // Take advantage of frame-accurate comparison ability here.
+        // At some point, the event's frame time and the 'swept' current range of pos frame will intersect,
+        //  so all events should be accounted for.
+        if(fr < pos_fr || fr >= next_pos_fr)
+        {
+          DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: Ignoring event\n");
+          return;
+        }
+        
+        frame = fr - pos_fr;
+        frame += syncFrame;
+      }
+      
+      DEBUG_MIDI(stderr, "Audio::collectEvents: event: tick:%u final frame:%u\n", tick, frame);
+        
+      switch (ev.type()) {
+            case Note:
+                  {
+                  int len   = ev.lenTick();
+                  int pitch = ev.pitch();
+                  int velo  = ev.velo();
+                  int veloOff = ev.veloOff();
+                  if (track->type() == Track::DRUM)  {
+                        // Map drum-notes to the drum-map values
+                       int instr = ev.pitch();
+                       pitch     = MusEGlobal::drumMap[instr].anote;
+                       // Default to track port if -1 and track channel if -1.
+                       port      = MusEGlobal::drumMap[instr].port; //This changes to non-default port
+                       if(port == -1)
+                         port = track->outPort();
+                       channel   = MusEGlobal::drumMap[instr].channel;
+                       if(channel == -1)
+                         channel = track->outChannel();
+                       velo      = int(double(velo) * (double(MusEGlobal::drumMap[instr].vol) / 100.0)) ;
+                       veloOff   = int(double(veloOff) * (double(MusEGlobal::drumMap[instr].vol) / 100.0)) ;
+                       }
+                  else if (track->type() == Track::NEW_DRUM)  {
+                        // Map drum-notes to the drum-map values
+                       int instr = ev.pitch();
+                       pitch     = track->drummap()[instr].anote;
+                       // Default to track port if -1 and track channel if -1.
+                       port      = track->drummap()[instr].port; //This changes to non-default port
+                       if(port == -1)
+                         port = track->outPort();
+                       channel   = track->drummap()[instr].channel;
+                       if(channel == -1)
+                         channel = track->outChannel();
+                       velo      = int(double(velo) * (double(track->drummap()[instr].vol) / 100.0)) ;
+                       veloOff   = int(double(veloOff) * (double(track->drummap()[instr].vol) / 100.0)) ;
+                       }
+                  else if (track->type() == Track::MIDI) {
+                        // transpose non drum notes
+                        pitch += (track->transposition + MusEGlobal::song->globalPitchShift());
+                        }
+
+                  if (pitch > 127)
+                        pitch = 127;
+                  if (pitch < 0)
+                        pitch = 0;
+
+                  // Apply track velocity and compression to both note-on and note-off velocity...
+                  velo += track->velocity;
+                  velo = (velo * track->compression) / 100;
+                  if (velo > 127)
+                        velo = 127;
+                  if (velo < 1)           // no off event
+                        // Zero means zero. Should mean no note at all?
+                        //velo = 1;
+                        return;
+                  veloOff += track->velocity;
+                  veloOff = (veloOff * track->compression) / 100;
+                  if (veloOff > 127)
+                        veloOff = 127;
+                  if (veloOff < 1)
+                        veloOff = 0;
+
+                  len = (len *  track->len) / 100;
+                  if (len <= 0)     // don't allow zero length
+                        len = 1;
+
+                  if (port == defaultPort) {
+                        if (md) {
+                              md->putEvent(
+                                MusECore::MidiPlayEvent(frame, port, channel, MusECore::ME_NOTEON, pitch, velo), 
+                                  MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
+                            track->addStuckNote(MusECore::MidiPlayEvent(tick + len, port, channel,
+                              MusECore::ME_NOTEOFF, pitch, veloOff));
+                          }
+                        }
+                  else { //Handle events to different port than standard.
+                        MidiDevice* mdAlt = MusEGlobal::midiPorts[port].device();
+                        if (mdAlt) {
+                              mdAlt->putEvent(
+                                MusECore::MidiPlayEvent(frame, port, channel, MusECore::ME_NOTEON, pitch, velo), 
+                                  MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
+                            track->addStuckNote(MusECore::MidiPlayEvent(tick + len, port, channel,
+                              MusECore::ME_NOTEOFF, pitch, veloOff));
+                          }
+                        }
+
+                  if(velo > track->activity())
+                    track->setActivity(velo);
+                  }
+                  break;
+
+            case Controller:
+                  {
+                    if (track->type() == Track::DRUM)
+                    {
+                      int ctl   = ev.dataA();
+                      // Is it a drum controller event, according to the track port's instrument?
+                      MusECore::MidiController *mc = MusEGlobal::midiPorts[defaultPort].drumController(ctl);
+                      if(mc)
+                      {
+                        int instr = ctl & 0x7f;
+                        ctl &=  ~0xff;
+                        int pitch = MusEGlobal::drumMap[instr].anote & 0x7f;
+                        // Default to track port if -1 and track channel if -1.
+                        port      = MusEGlobal::drumMap[instr].port; //This changes to non-default port
+                        if(port == -1)
+                          port = track->outPort();
+                        channel   = MusEGlobal::drumMap[instr].channel;
+                        if(channel == -1)
+                          channel = track->outChannel();
+
+                        MusECore::MidiPlayEvent mpeAlt(frame, port, channel, 
+                                                       MusECore::ME_CONTROLLER, 
+                                                       ctl | pitch,
+                                                       ev.dataB());
+                        
+                        MidiPort* mpAlt = &MusEGlobal::midiPorts[port];
+                        // TODO Maybe grab the flag from the 'Optimize Controllers' Global Setting,
+                        //       which so far was meant for (N)RPN stuff. For now, just force it.
+                        // This is the audio thread. Just set directly.
+                        mpAlt->setHwCtrlState(mpeAlt);
+                        if(MidiDevice* mdAlt = mpAlt->device())
+                          mdAlt->putEvent(mpeAlt, MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
+                        
+                        break;  // Break out.
+                      }
+                    }
+                    else if (track->type() == Track::NEW_DRUM)
+                    {
+                      int ctl   = ev.dataA();
+                      // Is it a drum controller event, according to the track port's instrument?
+                      MusECore::MidiController *mc = MusEGlobal::midiPorts[defaultPort].drumController(ctl);
+                      if(mc)
+                      {
+                        int instr = ctl & 0x7f;
+                        ctl &=  ~0xff;
+                        int pitch = track->drummap()[instr].anote & 0x7f;
+                        // Default to track port if -1 and track channel if -1.
+                        port      = track->drummap()[instr].port; //This changes to non-default port
+                        if(port == -1)
+                          port = track->outPort();
+                        channel   = track->drummap()[instr].channel;
+                        if(channel == -1)
+                          channel = track->outChannel();
+                        
+                        MusECore::MidiPlayEvent mpeAlt(frame, port, channel,
+                                                       MusECore::ME_CONTROLLER,
+                                                       ctl | pitch,
+                                                       ev.dataB());
+                        
+                        MidiPort* mpAlt = &MusEGlobal::midiPorts[port];
+                        // TODO Maybe grab the flag from the 'Optimize Controllers' Global Setting,
+                        //       which so far was meant for (N)RPN stuff. For now, just force it.
+                        // This is the audio thread. Just set directly.
+                        mpAlt->setHwCtrlState(mpeAlt);
+                        if(MidiDevice* mdAlt = mpAlt->device())
+                          mdAlt->putEvent(mpeAlt, MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
+                        
+                        break;  // Break out.
+                      }
+                    }
+                    
+                    MusECore::MidiPlayEvent mpe = ev.asMidiPlayEvent(frame, port, channel);
+                    // TODO Maybe grab the flag from the 'Optimize Controllers' Global Setting,
+                    //       which so far was meant for (N)RPN stuff. For now, just force it.
+                    // This is the audio thread. Just set directly.
+                    mp->setHwCtrlState(mpe);
+                    if(md)
+                      md->putEvent(mpe, MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
+                  }
+                  break;
+
+            default:
+              
+                  if(md)
+                  {
+                     md->putEvent(ev.asMidiPlayEvent(frame, port, channel), 
+                                      MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
+                  }
+                  break;
+            }
+
+      }
+
 //---------------------------------------------------------
 //   collectEvents
 //    collect events for next audio segment
@@ -1278,15 +1483,14 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts, unsigned
          (!extsync && cts > nts))
         return;
         
-      int port    = track->outPort();
       int channel = track->outChannel();
-      int defaultPort = port;
+      const int defaultPort = track->outPort();
       const unsigned int pos_fr = _pos.frame();
       const unsigned int next_pos_fr = pos_fr + frames;
 
       DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: pos_fr:%u next_pos_fr:%u\n", pos_fr, next_pos_fr);
       
-      MidiPort* mp = &MusEGlobal::midiPorts[port];
+      MidiPort* mp = &MusEGlobal::midiPorts[defaultPort];
       MidiDevice* md = mp->device();
 
       PartList* pl = track->parts();
@@ -1316,250 +1520,50 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts, unsigned
             //  no user changes in-between cycles. We don't have that capability currently anyway -
             //  to break the process up into chunks (like our controllers) depending on tempo frames, 
             //  our tempo map is not frame-accurate, only tick-accurate.
-            ciEvent ie   = events.lower_bound(stick);
-            ciEvent iend = events.upper_bound(etick);
-
             DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: part events stick:%u etick:%u\n", stick, etick);
             
-            for (; ie != iend; ++ie) {
-                  Event ev = ie->second;
-                  port = defaultPort; //Reset each loop
-                  //
-                  //  don't play any meta events
-                  //
-                  if (ev.type() == Meta)
-                        continue;
-                  if (track->type() == Track::DRUM) {
-                        int instr = ev.pitch();
-                        // ignore muted drums
-                        if (ev.isNote() && MusEGlobal::drumMap[instr].mute)
-                              continue;
-                        }
-                  else if (track->type() == Track::NEW_DRUM) {
-                        int instr = ev.pitch();
-                        // ignore muted drums
-                        if (ev.isNote() && track->drummap()[instr].mute)
-                              continue;
-                        }
-                  unsigned tick  = ev.tick() + offset;
-                  
-                  DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: event tick:%u\n", tick);
-      
-                  //-----------------------------------------------------------------
-                  // Determining the playback scheduling frame from the event's tick:
-                  //-----------------------------------------------------------------
-                  unsigned frame;
-                  if(extsync)
-                    // If external sync is on, look up the scheduling frame from the tick,
-                    //  in the external clock history list (which is cleared, re-composed, and processed each cycle).
-                    // The function takes a tick relative to zero (ie. relative to the first event in this batch).
-                    // The returned clock frame occurred during the previous audio cycle(s), so shift the frame 
-                    //  forward by one audio segment size.
-                    frame = extClockHistoryTick2Frame(tick - stick) + MusEGlobal::segmentSize;
+            // Play from the packed copy if it is up to date, it is much more cache friendly
+            //  and avoids the event reference counting. The size check guards against any
+            //  edit which did not drop the copy.
+            const PackedMidiEvents* packed = part->packedEvents();
+            if(packed && packed->sourceSize() == events.size())
+            {
+              const PackedMidiEvent* ie   = packed->lowerBound(stick);
+              const PackedMidiEvent* iend = packed->upperBound(etick);
+              // The events are sorted by tick, so look up their frames a batch at a time.
+              // Consecutive events mostly fall into the same tempo range.
+              const int batch_size = 64;
+              unsigned ticks[batch_size];
+              unsigned frs[batch_size];
+              while (ie != iend)
+              {
+                const int n = (iend - ie) < batch_size ? (iend - ie) : batch_size;
+                if(!extsync)
+                {
+                  for (int k = 0; k < n; ++k)
+                    ticks[k] = ie[k].tick() + offset;
+                  MusEGlobal::tempomap.tick2frame(ticks, frs, n);
+                }
+                for (int k = 0; k < n; ++k, ++ie)
+                {
+                  const unsigned fr = extsync ? 0 : frs[k];
+                  if(ie->type() == Sysex)
+                    collectEvent(track, packed->sysex(*ie), offset, stick, defaultPort, channel, mp, md, extsync, fr, pos_fr, next_pos_fr);
                   else
-                  {
-                    // If external sync is off, look up the scheduling frame from our tempo list
-                    //  ie. normal playback.
-                    const unsigned int fr = MusEGlobal::tempomap.tick2frame(tick);
-                    
-                    DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: event: frame:%u\n", fr);
-                      
-                    // Take advantage of frame-accurate comparison ability here.
-                    // At some point, the event's frame time and the 'swept' current range of pos frame will intersect,
-                    //  so all events should be accounted for.
-                    if(fr < pos_fr || fr >= next_pos_fr)
-                    {
-                      DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: Ignoring event\n");
-                      continue;
-                    }
-                    
-                    frame = fr - pos_fr;
-                    frame += syncFrame;
-                  }
-                  
-                  DEBUG_MIDI(stderr, "Audio::collectEvents: event: tick:%u final frame:%u\n", tick, frame);
-                    
-                  switch (ev.type()) {
-                        case Note:
-                              {
-                              int len   = ev.lenTick();
-                              int pitch = ev.pitch();
-                              int velo  = ev.velo();
-                              int veloOff = ev.veloOff();
-                              if (track->type() == Track::DRUM)  {
-                                    // Map drum-notes to the drum-map values
-                                   int instr = ev.pitch();
-                                   pitch     = MusEGlobal::drumMap[instr].anote;
-                                   // Default to track port if -1 and track channel if -1.
-                                   port      = MusEGlobal::drumMap[instr].port; //This changes to non-default port
-                                   if(port == -1)
-                                     port = track->outPort();
-                                   channel   = MusEGlobal::drumMap[instr].channel;
-                                   if(channel == -1)
-                                     channel = track->outChannel();
-                                   velo      = int(double(velo) * (double(MusEGlobal::drumMap[instr].vol) / 100.0)) ;
-                                   veloOff   = int(double(veloOff) * (double(MusEGlobal::drumMap[instr].vol) / 100.0)) ;
-                                   }
-                              else if (track->type() == Track::NEW_DRUM)  {
-                                    // Map drum-notes to the drum-map values
-                                   int instr = ev.pitch();
-                                   pitch     = track->drummap()[instr].anote;
-                                   // Default to track port if -1 and track channel if -1.
-                                   port      = track->drummap()[instr].port; //This changes to non-default port
-                                   if(port == -1)
-                                     port = track->outPort();
-                                   channel   = track->drummap()[instr].channel;
-                                   if(channel == -1)
-                                     channel = track->outChannel();
-                                   velo      = int(double(velo) * (double(track->drummap()[instr].vol) / 100.0)) ;
-                                   veloOff   = int(double(veloOff) * (double(track->drummap()[instr].vol) / 100.0)) ;
-                                   }
-                              else if (track->type() == Track::MIDI) {
-                                    // transpose non drum notes
-                                    pitch += (track->transposition + MusEGlobal::song->globalPitchShift());
-                                    }
-
-                              if (pitch > 127)
-                                    pitch = 127;
-                              if (pitch < 0)
-                                    pitch = 0;
-
-                              // Apply track velocity and compression to both note-on and note-off velocity...
-                              velo += track->velocity;
-                              velo = (velo * track->compression) / 100;
-                              if (velo > 127)
-                                    velo = 127;
-                              if (velo < 1)           // no off event
-                                    // Zero means zero. Should mean no note at all?
-                                    //velo = 1;
-                                    continue;
-                              veloOff += track->velocity;
-                              veloOff = (veloOff * track->compression) / 100;
-                              if (veloOff > 127)
-                                    veloOff = 127;
-                              if (veloOff < 1)
-                                    veloOff = 0;
-
-                              len = (len *  track->len) / 100;
-                              if (len <= 0)     // don't allow zero length
-                                    len = 1;
-
-                              if (port == defaultPort) {
-                                    if (md) {
-                                          md->putEvent(
-                                            MusECore::MidiPlayEvent(frame, port, channel, MusECore::ME_NOTEON, pitch, velo), 
-                                              MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
-                                        track->addStuckNote(MusECore::MidiPlayEvent(tick + len, port, channel,
-                                          MusECore::ME_NOTEOFF, pitch, veloOff));
-                                      }
-                                    }
-                              else { //Handle events to different port than standard.
-                                    MidiDevice* mdAlt = MusEGlobal::midiPorts[port].device();
-                                    if (mdAlt) {
-                                          mdAlt->putEvent(
-                                            MusECore::MidiPlayEvent(frame, port, channel, MusECore::ME_NOTEON, pitch, velo), 
-                                              MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
-                                        track->addStuckNote(MusECore::MidiPlayEvent(tick + len, port, channel,
-                                          MusECore::ME_NOTEOFF, pitch, veloOff));
-                                      }
-                                    }
-
-                              if(velo > track->activity())
-                                track->setActivity(velo);
-                              }
-                              break;
-
-                        case Controller:
-                              {
-                                if (track->type() == Track::DRUM)
-                                {
-                                  int ctl   = ev.dataA();
-                                  // Is it a drum controller event, according to the track port's instrument?
-                                  MusECore::MidiController *mc = MusEGlobal::midiPorts[defaultPort].drumController(ctl);
-                                  if(mc)
-                                  {
-                                    int instr = ctl & 0x7f;
-                                    ctl &=  ~0xff;
-                                    int pitch = MusEGlobal::drumMap[instr].anote & 0x7f;
-                                    // Default to track port if -1 and track channel if -1.
-                                    port      = MusEGlobal::drumMap[instr].port; //This changes to non-default port
-                                    if(port == -1)
-                                      port = track->outPort();
-                                    channel   = MusEGlobal::drumMap[instr].channel;
-                                    if(channel == -1)
-                                      channel = track->outChannel();
-
-                                    MusECore::MidiPlayEvent mpeAlt(frame, port, channel, 
-                                                                   MusECore::ME_CONTROLLER, 
-                                                                   ctl | pitch,
-                                                                   ev.dataB());
-                                    
-                                    MidiPort* mpAlt = &MusEGlobal::midiPorts[port];
-                                    // TODO Maybe grab the flag from the 'Optimize Controllers' Global Setting,
-                                    //       which so far was meant for (N)RPN stuff. For now, just force it.
-                                    // This is the audio thread. Just set directly.
-                                    mpAlt->setHwCtrlState(mpeAlt);
-                                    if(MidiDevice* mdAlt = mpAlt->device())
-                                      mdAlt->putEvent(mpeAlt, MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
-                                    
-                                    break;  // Break out.
-                                  }
-                                }
-                                else if (track->type() == Track::NEW_DRUM)
-                                {
-                                  int ctl   = ev.dataA();
-                                  // Is it a drum controller event, according to the track port's instrument?
-                                  MusECore::MidiController *mc = MusEGlobal::midiPorts[defaultPort].drumController(ctl);
-                                  if(mc)
-                                  {
-                                    int instr = ctl & 0x7f;
-                                    ctl &=  ~0xff;
-                                    int pitch = track->drummap()[instr].anote & 0x7f;
-                                    // Default to track port if -1 and track channel if -1.
-                                    port      = track->drummap()[instr].port; //This changes to non-default port
-                                    if(port == -1)
-                                      port = track->outPort();
-                                    channel   = track->drummap()[instr].channel;
-                                    if(channel == -1)
-                                      channel = track->outChannel();
-                                    
-                                    MusECore::MidiPlayEvent mpeAlt(frame, port, channel,
-                                                                   MusECore::ME_CONTROLLER,
-                                                                   ctl | pitch,
-                                                                   ev.dataB());
-                                    
-                                    MidiPort* mpAlt = &MusEGlobal::midiPorts[port];
-                                    // TODO Maybe grab the flag from the 'Optimize Controllers' Global Setting,
-                                    //       which so far was meant for (N)RPN stuff. For now, just force it.
-                                    // This is the audio thread. Just set directly.
-                                    mpAlt->setHwCtrlState(mpeAlt);
-                                    if(MidiDevice* mdAlt = mpAlt->device())
-                                      mdAlt->putEvent(mpeAlt, MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
-                                    
-                                    break;  // Break out.
-                                  }
-                                }
-                                
-                                MusECore::MidiPlayEvent mpe = ev.asMidiPlayEvent(frame, port, channel);
-                                // TODO Maybe grab the flag from the 'Optimize Controllers' Global Setting,
-                                //       which so far was meant for (N)RPN stuff. For now, just force it.
-                                // This is the audio thread. Just set directly.
-                                mp->setHwCtrlState(mpe);
-                                if(md)
-                                  md->putEvent(mpe, MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
-                              }
-                              break;
-
-                        default:
-                          
-                              if(md)
-                              {
-                                 md->putEvent(ev.asMidiPlayEvent(frame, port, channel), 
-                                                  MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
-                              }
-                              break;
-                        }
-                  }
+                    collectEvent(track, *ie, offset, stick, defaultPort, channel, mp, md, extsync, fr, pos_fr, next_pos_fr);
+                }
+              }
+            }
+            else
+            {
+              ciEvent ie   = events.lower_bound(stick);
+              ciEvent iend = events.upper_bound(etick);
+              for (; ie != iend; ++ie)
+              {
+                const unsigned fr = extsync ? 0 : MusEGlobal::tempomap.tick2frame(ie->second.tick() + offset);
+                collectEvent(track, ie->second, offset, stick, defaultPort, channel, mp, md, extsync, fr, pos_fr, next_pos_fr);
+              }
+            }
             }
       }
 
@@ -1574,6 +1578,7 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts, unsigned
 
 void Audio::processMidi(unsigned int frames)
       {
+      DspTimer dsp_timer(&_midiDspStats);
       const bool extsync = MusEGlobal::extSyncFlag.value();
       const bool playing = isPlaying();
 
@@ -23,6 +23,7 @@
 //=========================================================
 
 #include <stdio.h>
+#include <limits.h>
 #include "muse_math.h"
 
 #include "globaldefs.h"
@@ -38,6 +39,7 @@
 #include "muse_math.h"
 
 #include "track.h"
+#include "gconfig.h"
 
 namespace MusECore {
 
@@ -711,10 +713,24 @@ int MidiController::genNum(MidiController::ControllerType t, int h, int l)
 //   MidiCtrlValList
 //---------------------------------------------------------
 
+std::atomic<unsigned int> MidiCtrlValList::_chaseSerial(0);
+
 MidiCtrlValList::MidiCtrlValList(int c)
       {
       ctrlNum = c;
       _hwVal = _lastValidHWVal = _lastValidByte2 = _lastValidByte1 = _lastValidByte0 = CTRL_VAL_UNKNOWN;
+      _chaseCurrent = 0;
+      _chasePending = 0;
+      _chaseRetired = 0;
+      _chaseDirty = UINT_MAX;
+      _chaseEdits = 0;
+      }
+
+MidiCtrlValList::~MidiCtrlValList()
+      {
+      delete _chaseCurrent;
+      delete _chasePending.exchange(0);
+      delete _chaseRetired.exchange(0);
       }
 
 //---------------------------------------------------------
@@ -810,6 +826,7 @@ void MidiCtrlValListList::clr()
 
 void MidiCtrlValListList::clearDelete(bool deleteLists)
 {
+  MidiCtrlValList::invalidateAllChase();
   for(iMidiCtrlValList imcvl = begin(); imcvl != end(); ++imcvl)
   {
     if(imcvl->second)
@@ -841,6 +858,19 @@ bool MidiCtrlValListList::resetAllHwVals(bool doLastHwValue)
   return changed;
 }
 
+//---------------------------------------------------------
+// updateChase
+//---------------------------------------------------------
+
+void MidiCtrlValListList::updateChase()
+{
+  for(iMidiCtrlValList imcvl = begin(); imcvl != end(); ++imcvl)
+  {
+    if(imcvl->second)
+      imcvl->second->updateChase();
+  }
+}
+
 //---------------------------------------------------------
 // searchControllers
 //---------------------------------------------------------
@@ -1295,6 +1325,7 @@ int MidiCtrlValList::visibleValue(unsigned int tick, Part* part, bool inclMutedP
 bool MidiCtrlValList::addMCtlVal(unsigned int tick, int val, Part* part)
       {
       insert(MidiCtrlValListInsertPair_t(tick, MidiCtrlVal(part, val)));
+      chaseChanged(tick);
       return true;
       }
 
@@ -1311,6 +1342,7 @@ void MidiCtrlValList::delMCtlVal(unsigned int tick, Part* part, int val)
             return;
             }
       erase(e);
+      chaseChanged(tick);
 }
 
 //---------------------------------------------------------
@@ -1328,6 +1360,210 @@ iMidiCtrlVal MidiCtrlValList::findMCtlVal(unsigned int tick, Part* part, int val
   return end();
 }
       
+//---------------------------------------------------------
+//   chaseInterval
+//    Sixteen quarter notes, whatever the time signature. The
+//    checkpoints only bound how many values a chase walks back
+//    over, they need not fall on bars. A changed division
+//    makes the tables rebuild, see chaseTableValid().
+//---------------------------------------------------------
+
+unsigned int MidiCtrlValList::chaseInterval()
+{
+  return MusEGlobal::config.division * 16;
+}
+
+//---------------------------------------------------------
+//   chaseChanged
+//---------------------------------------------------------
+
+void MidiCtrlValList::chaseChanged(unsigned int tick)
+{
+  // Lower the dirty tick first, so that updateChase() never sees the new
+  //  edit count without it.
+  unsigned int dirty = _chaseDirty;
+  while(tick < dirty && !_chaseDirty.compare_exchange_weak(dirty, tick))
+    ;
+  ++_chaseEdits;
+}
+
+//---------------------------------------------------------
+//   chaseBack
+//---------------------------------------------------------
+
+bool MidiCtrlValList::chaseBack(const_iterator i, unsigned int from, MidiCtrlChasePoint* cp) const
+{
+  while(i != begin())
+  {
+    --i;
+    const unsigned int t = i->first;
+    if(t < from)
+      break;
+    Part* p = i->second.part;
+    if(!p)
+      continue;
+    // Ignore values that are outside of the part.
+    if(t < p->tick() || t >= (p->tick() + p->lenTick()))
+      continue;
+    cp->valuesFound = true;
+    // Ignore if part or track is muted or off.
+    if(p->mute())
+      continue;
+    const Track* track = p->track();
+    if(track && (track->isMute() || track->off()))
+      continue;
+    cp->found = true;
+    cp->tick = t;
+    cp->part = p;
+    cp->val = i->second.val;
+    return true;
+  }
+  return false;
+}
+
+//---------------------------------------------------------
+//   chaseTableValid
+//---------------------------------------------------------
+
+bool MidiCtrlValList::chaseTableValid(const MidiCtrlChaseTable* table) const
+{
+  return table && !table->points.empty() &&
+         table->interval == chaseInterval() &&
+         table->serial == _chaseSerial &&
+         table->edits == _chaseEdits;
+}
+
+//---------------------------------------------------------
+//   updateChase
+//---------------------------------------------------------
+
+void MidiCtrlValList::updateChase()
+{
+  delete _chaseRetired.exchange(0);
+
+  // Read the edit count before taking the dirty tick, see chaseChanged().
+  const unsigned int edits = _chaseEdits;
+  const unsigned int dirty = _chaseDirty.exchange(UINT_MAX);
+  const unsigned int interval = chaseInterval();
+  const unsigned int serial = _chaseSerial;
+  // One point past the last value, so that all values are covered.
+  const size_t want = empty() ? 0 : rbegin()->first / interval + 2;
+
+  MidiCtrlChaseTable& t = _chaseBuilt;
+  if(t.interval == interval && t.serial == serial && t.edits == edits && t.points.size() == want)
+    return;
+
+  size_t valid = t.points.size();
+  if(t.interval != interval || t.serial != serial)
+    valid = 0;
+  // Point n covers the values before tick n * interval.
+  else if(dirty != UINT_MAX && valid > dirty / interval + 1)
+    valid = dirty / interval + 1;
+  if(valid > want)
+    valid = want;
+
+  t.interval = interval;
+  t.serial = serial;
+  t.edits = edits;
+  t.points.resize(want);
+  // Nothing comes before tick zero.
+  if(valid == 0 && want != 0)
+  {
+    t.points[0] = MidiCtrlChasePoint();
+    valid = 1;
+  }
+  // Rebuild each point from the one before it, walking only the values in between.
+  for( ; valid < want; ++valid)
+  {
+    MidiCtrlChasePoint& pt = t.points[valid];
+    pt = MidiCtrlChasePoint();
+    if(!chaseBack(lower_bound(valid * interval), (valid - 1) * interval, &pt))
+    {
+      const bool values_found = pt.valuesFound;
+      pt = t.points[valid - 1];
+      pt.valuesFound |= values_found;
+    }
+  }
+
+  // The audio thread never saw a table it did not pick up yet, so it can be freed here.
+  delete _chasePending.exchange(new MidiCtrlChaseTable(t));
+}
+
+//---------------------------------------------------------
+//   chase
+//---------------------------------------------------------
+
+bool MidiCtrlValList::chase(unsigned int tick, MidiCtrlChasePoint* cp)
+{
+  // Pick up a new table. The old one can only be dropped once the gui
+  //  thread has freed the one before it, so nothing is ever freed here.
+  if(_chasePending.load() && !_chaseRetired.load())
+  {
+    MidiCtrlChaseTable* t = _chasePending.exchange(0);
+    if(t)
+    {
+      _chaseRetired = _chaseCurrent;
+      _chaseCurrent = t;
+    }
+  }
+  return chase(tick, cp, _chaseCurrent);
+}
+
+bool MidiCtrlValList::guiChase(unsigned int tick, MidiCtrlChasePoint* cp) const
+{
+  return chase(tick, cp, &_chaseBuilt);
+}
+
+bool MidiCtrlValList::chase(unsigned int tick, MidiCtrlChasePoint* cp, const MidiCtrlChaseTable* table) const
+{
+  *cp = MidiCtrlChasePoint();
+
+  // Values exactly at tick take precedence over anything before it.
+  ciMidiCtrlVal i = lower_bound(tick);
+  if(i != end() && i->first == tick)
+  {
+    for( ; i != end() && i->first == tick; ++i)
+    {
+      Part* p = i->second.part;
+      if(!p)
+        continue;
+      // Ignore values that are outside of the part.
+      if(tick < p->tick() || tick >= (p->tick() + p->lenTick()))
+        continue;
+      cp->valuesFound = true;
+      // Ignore if part or track is muted or off.
+      if(p->mute())
+        continue;
+      const Track* track = p->track();
+      if(track && (track->isMute() || track->off()))
+        continue;
+      cp->found = true;
+      cp->tick = tick;
+      cp->part = p;
+      cp->val = i->second.val;
+      break;
+    }
+    return cp->found;
+  }
+
+  // The values changed since the table was built. Walk all the way.
+  if(!chaseTableValid(table))
+    return chaseBack(i, 0, cp);
+
+  // Walk back to the nearest checkpoint. The last one covers all values...
+  unsigned int n = tick / table->interval;
+  if(n >= table->points.size())
+    n = table->points.size() - 1;
+  if(chaseBack(i, n * table->interval, cp))
+    return true;
+
+  // ... and take the state from there.
+  const bool values_found = cp->valuesFound;
+  *cp = table->points[n];
+  cp->valuesFound |= values_found;
+  return cp->found;
+}
+
 //---------------------------------------------------------
 //   MidiControllerList
 //---------------------------------------------------------
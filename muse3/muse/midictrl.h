@@ -27,6 +27,8 @@
 
 #include <list>
 #include <map>
+#include <vector>
+#include <atomic>
 
 #include <QString>
 
@@ -135,6 +137,40 @@ struct MidiCtrlVal
   bool operator==(const MidiCtrlVal& mcv) { return part == mcv.part && val == mcv.val; }
 };
 
+//---------------------------------------------------------
+//   MidiCtrlChasePoint
+//    The chased state of a controller: the value it has
+//     when the song is located to some position.
+//---------------------------------------------------------
+
+struct MidiCtrlChasePoint
+{
+  // Whether a value was found.
+  bool found;
+  // Whether any value inside of its part was passed, even a muted one.
+  bool valuesFound;
+  // Tick, part and value of the found value.
+  unsigned int tick;
+  Part* part;
+  int val;
+  MidiCtrlChasePoint() : found(false), valuesFound(false), tick(0), part(0), val(CTRL_VAL_UNKNOWN) { }
+};
+
+//---------------------------------------------------------
+//   MidiCtrlChaseTable
+//    Chase checkpoints of a controller, and what they
+//     were built from.
+//---------------------------------------------------------
+
+struct MidiCtrlChaseTable
+{
+  unsigned int interval;
+  unsigned int serial;
+  unsigned int edits;
+  std::vector<MidiCtrlChasePoint> points;
+  MidiCtrlChaseTable() : interval(0), serial(0), edits(0) { }
+};
+
 //---------------------------------------------------------
 //   MidiCtrlValList
 //    arrange controller events of a specific type in a
@@ -160,12 +196,39 @@ class MidiCtrlValList : public MidiCtrlValList_t {
       int _lastValidByte1;
       int _lastValidByte0;
 
+      // Chase checkpoints, one every table interval. Point n holds the state chased
+      //  from the values before tick n * interval. The gui thread keeps _chaseBuilt up
+      //  to date in updateChase() and publishes a copy of it in _chasePending. The audio
+      //  thread swaps that into _chaseCurrent and only ever reads it. The table it
+      //  replaces goes to _chaseRetired for the gui thread to free.
+      MidiCtrlChaseTable _chaseBuilt;
+      MidiCtrlChaseTable* _chaseCurrent;
+      std::atomic<MidiCtrlChaseTable*> _chasePending;
+      std::atomic<MidiCtrlChaseTable*> _chaseRetired;
+      // Lowest tick at which values changed since the last updateChase(), or UINT_MAX.
+      std::atomic<unsigned int> _chaseDirty;
+      // Bumped on every change of the values. A table is only used if it was built
+      //  after the last change.
+      std::atomic<unsigned int> _chaseEdits;
+      // Bumped to invalidate the checkpoints of all lists.
+      static std::atomic<unsigned int> _chaseSerial;
+
+      // Chases backwards from i (exclusive) down to values at tick 'from'.
+      // Returns true if a value was found.
+      bool chaseBack(const_iterator i, unsigned int from, MidiCtrlChasePoint* cp) const;
+      // Chases the state at tick, starting from the checkpoints in table if it is
+      //  up to date, else walking all values before tick.
+      bool chase(unsigned int tick, MidiCtrlChasePoint* cp, const MidiCtrlChaseTable* table) const;
+      // Whether table was built from the current values and settings.
+      bool chaseTableValid(const MidiCtrlChaseTable* table) const;
+
       // Hide built-in finds.
       iterator find(const unsigned int&) { return end(); };
       const_iterator find(const unsigned int&) const { return end(); };
 
    public:
       MidiCtrlValList(int num);
+      ~MidiCtrlValList();
       
       Part* partAtTick(unsigned int tick) const;
       
@@ -193,6 +256,26 @@ class MidiCtrlValList : public MidiCtrlValList_t {
       // If val is not -1 it will search for that value.
       iterator findMCtlVal(unsigned int tick, Part* part, int val/* = -1*/);
 
+      // Chase the controller state at tick, like locating the song there does: The value at tick,
+      //  or else the last one before it, ignoring values that are OUTSIDE of their parts, or
+      //  muted or off parts or tracks. Starts from the nearest checkpoint so only the values since
+      //  then need to be walked. Called from the audio thread only. Never allocates or waits.
+      //  Returns true if a value was found.
+      bool chase(unsigned int tick, MidiCtrlChasePoint* cp);
+      // Same as chase(), for the gui thread. Uses the checkpoints as built by updateChase().
+      bool guiChase(unsigned int tick, MidiCtrlChasePoint* cp) const;
+      // Rebuilds the checkpoints past the lowest changed tick and publishes them to the
+      //  audio thread. Frees the table the audio thread let go of. Called from the gui thread only.
+      void updateChase();
+      // Distance in ticks between chase checkpoints.
+      static unsigned int chaseInterval();
+      // Values at or after tick were added, removed or changed by bypassing addMCtlVal
+      //  and delMCtlVal. Invalidates the checkpoints past tick.
+      void chaseChanged(unsigned int tick);
+      // Invalidates the checkpoints of all lists. Call when part or track muting,
+      //  soloing, or part positions or lengths change.
+      static void invalidateAllChase() { ++_chaseSerial; }
+
       // Current set value in midi hardware. Can be CTRL_VAL_UNKNOWN.
       inline int hwVal() const { return MidiController::dValToInt(_hwVal); }
 
@@ -285,6 +368,8 @@ class MidiCtrlValListList : public MidiCtrlValListList_t {
       // Equivalent to calling resetAllHwVal() on each MidiCtrlValList.
       // Returns true if either value was changed in any controller.
       bool resetAllHwVals(bool doLastHwValue);
+      // Convenience method: Calls updateChase() on each MidiCtrlValList. Called from the gui thread only.
+      void updateChase();
       
 #ifdef _MIDI_CTRL_METHODS_DEBUG_      
       // Need to catch all insert, erase, clear etc...
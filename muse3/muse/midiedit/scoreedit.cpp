@@ -45,6 +45,7 @@
 #include <QImage>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QElapsedTimer>
 
 #include <stdio.h>
 #include "muse_math.h"
@@ -1567,6 +1568,9 @@ ScoreCanvas::ScoreCanvas(ScoreEdit* pr, QWidget* parent_widget) : View(parent_wi
     x_pos=0;
     x_left=0;
     y_pos=0;
+    layout_count=0;
+    layout_nsecs=0;
+    last_layout_nsecs=0;
     have_lasso=false;
     inserting=false;
     dragging=false;
@@ -1812,6 +1816,7 @@ set<const MusECore::Part*> ScoreCanvas::get_all_parts()
 
 void ScoreCanvas::fully_recalculate()
 {
+    calc_pos_add_list();
     song_changed(SC_EVENT_MODIFIED);
 }
 
@@ -1844,14 +1849,66 @@ void ScoreCanvas::song_changed(MusECore::SongChangedStruct_t flags)
                  SC_EVENT_INSERTED | SC_EVENT_MODIFIED | SC_EVENT_REMOVED |
                  SC_SIG  | SC_KEY) )
     {
-        calc_pos_add_list();
-
+        QElapsedTimer layout_timer;
+        layout_timer.start();
+
+        // time signatures and key changes move everything behind them.
+        // otherwise only the measures around the changed events are
+        // laid out again, if it's known where they are.
+        bool everything = (flags._flags & (SC_PART_MODIFIED | SC_SIG | SC_KEY)) || !flags.eventRangeKnown();
+        if (flags._flags & (SC_SIG | SC_KEY))
+            calc_pos_add_list();
+
+        unsigned from=UINT_MAX, to=0;
+        bool height_changed=false;
         for (list<staff_t>::iterator it=staves.begin(); it!=staves.end(); it++)
-            it->recalculate();
+        {
+            // new staves may not have their position yet
+            if (everything || !it->laid_out)
+            {
+                it->recalculate();
+                height_changed=true;
+                continue;
+            }
 
-        recalc_staff_pos();
+            // nothing changed
+            if (flags._eventTickFrom > flags._eventTickTo)
+                continue;
+
+            int old_min_y=it->min_y_coord;
+            int old_max_y=it->max_y_coord;
+            unsigned staff_from=flags._eventTickFrom, staff_to=flags._eventTickTo;
+            it->recalculate_range(staff_from, staff_to);
+            if (staff_from<from) from=staff_from;
+            if (staff_to>to) to=staff_to;
+            if ((it->min_y_coord!=old_min_y) || (it->max_y_coord!=old_max_y))
+                height_changed=true;
+        }
+
+        if (height_changed)
+        {
+            from=0;
+            to=UINT_MAX;
+            recalc_staff_pos();
+            redraw();
+        }
+        else if (from<=to)
+        {
+            // a bit more to the left and right, for ties and shifted notes
+            int margin=pixels_per_whole()/4;
+            int x1=tick_to_x(from) -x_pos+x_left -margin;
+            int x2= (to==UINT_MAX) ? width() : tick_to_x(to) -x_pos+x_left +margin;
+            if (x1<0) x1=0;
+            if (x2>x1)
+                redraw(QRect(x1,0,x2-x1,height()));
+        }
+
+        last_layout_nsecs=layout_timer.nsecsElapsed();
+        layout_nsecs+=last_layout_nsecs;
+        layout_count++;
+        if (debugMsg) cout << "score layout: ticks "<<from<<" to "<<to<<" in "<<last_layout_nsecs/1000<<" us; "
+                           <<layout_count<<" layouts took "<<layout_nsecs/1000<<" us in total" << endl;
 
-        redraw();
         emit canvas_width_changed(canvas_width());
     }
 
@@ -2060,6 +2117,7 @@ void staff_t::create_appropriate_eventlist()
     using MusECore::iSigEvent;
 
     eventlist.clear();
+    max_note_len=0;
 
     // phase one: fill the list -----------------------------------------
 
@@ -2069,30 +2127,7 @@ void staff_t::create_appropriate_eventlist()
         const MusECore::Part* part=*part_it;
 
         for (MusECore::ciEvent it=part->events().begin(); it!=part->events().end(); it++)
-        {
-            const MusECore::Event& event=it->second;
-
-            if ( ( event.isNote() && !event.isNoteOff() &&
-                   // (event.endTick() <= part->lenTick()) ) &&
-                   (event.tick() <= part->lenTick()) ) && // changed to accord to prcanvas.cpp and others (flo93)
-                 ( ((type==GRAND_TOP) && (event.pitch() >= SPLIT_NOTE)) ||
-                   ((type==GRAND_BOTTOM) && (event.pitch() < SPLIT_NOTE)) ||
-                   (type==NORMAL) )                          )
-            {
-                unsigned begin, end;
-                begin=flo_quantize(event.tick()+part->tick(), parent->quant_ticks());
-                end=flo_quantize(event.endTick()+part->tick(), parent->quant_ticks());
-                if (end==begin)
-                {
-                    if (heavyDebugMsg) cout << "note len would be quantized to zero. using minimal possible length" << endl;
-                    end=begin+parent->quant_ticks();
-                }
-
-                if (heavyDebugMsg) cout << "inserting note on at "<<begin<<" with pitch="<<event.pitch()<<" and len="<<end-begin<<endl;
-                eventlist.insert(pair<unsigned, FloEvent>(begin, FloEvent(begin,event.pitch(), event.velo(),end-begin,FloEvent::NOTE_ON,part,&it->second)));
-            }
-            //else ignore it
-        }
+            add_note(part, it->second);
     }
 
     //insert bars and time signatures
@@ -2116,11 +2151,51 @@ void staff_t::create_appropriate_eventlist()
         eventlist.insert(pair<unsigned, FloEvent>(it->second.tick,  FloEvent(it->second.tick,FloEvent::KEY_CHANGE, it->second.key ) ) );
 
 
-    // phase two: deal with overlapping notes ---------------------------
+    // phase two and three: deal with overlapping notes ----------------
+    cut_overlaps(0, UINT_MAX);
+}
+
+/* inserts a note on event into the eventlist, if the event is a note
+ * which belongs into this staff.
+ */
+void staff_t::add_note(const MusECore::Part* part, const MusECore::Event& event)
+{
+    if ( ( event.isNote() && !event.isNoteOff() &&
+           // (event.endTick() <= part->lenTick()) ) &&
+           (event.tick() <= part->lenTick()) ) && // changed to accord to prcanvas.cpp and others (flo93)
+         ( ((type==GRAND_TOP) && (event.pitch() >= SPLIT_NOTE)) ||
+           ((type==GRAND_BOTTOM) && (event.pitch() < SPLIT_NOTE)) ||
+           (type==NORMAL) )                          )
+    {
+        unsigned begin, end;
+        begin=flo_quantize(event.tick()+part->tick(), parent->quant_ticks());
+        end=flo_quantize(event.endTick()+part->tick(), parent->quant_ticks());
+        if (end==begin)
+        {
+            if (heavyDebugMsg) cout << "note len would be quantized to zero. using minimal possible length" << endl;
+            end=begin+parent->quant_ticks();
+        }
+
+        if (end-begin > max_note_len)
+            max_note_len=end-begin;
+
+        if (heavyDebugMsg) cout << "inserting note on at "<<begin<<" with pitch="<<event.pitch()<<" and len="<<end-begin<<endl;
+        eventlist.insert(pair<unsigned, FloEvent>(begin, FloEvent(begin,event.pitch(), event.velo(),end-begin,FloEvent::NOTE_ON,part,&event)));
+    }
+    //else ignore it
+}
+
+/* shortens the notes starting from "from" up to (not including) "to"
+ * where a later note at the same pitch begins, and removes those which
+ * got zero length.
+ */
+void staff_t::cut_overlaps(unsigned from, unsigned to)
+{
     ScoreEventList::iterator it, it2;
+    ScoreEventList::iterator begin=eventlist.lower_bound(pair<unsigned, FloEvent>(from, FloEvent(from,-1,0,0,FloEvent::NOTE_OFF)));
 
     //iterate through all note_on - events
-    for (it=eventlist.begin(); it!=eventlist.end(); it++) {
+    for (it=begin; it!=eventlist.end() && it->first<to; it++) {
         if (it->second.type==FloEvent::NOTE_ON)
         {
             unsigned end_tick=it->first + it->second.len;
@@ -2134,8 +2209,8 @@ void staff_t::create_appropriate_eventlist()
     }
 
 
-        // phase three: eliminate zero-length-notes -------------------------
-        for (it=eventlist.begin(); it!=eventlist.end();) {
+        // eliminate zero-length-notes -------------------------
+        for (it=begin; it!=eventlist.end() && it->first<to;) {
             if ((it->second.type==FloEvent::NOTE_ON) && (it->second.len<=0))
                 eventlist.erase(it++);
             else
@@ -2143,6 +2218,198 @@ void staff_t::create_appropriate_eventlist()
         }
 }
 
+void staff_t::recalculate()
+{
+    create_appropriate_eventlist();
+    create_itemlist();
+    process_itemlist();
+    calc_item_pos();
+    laid_out=true;
+}
+
+/* returns the begin of the measure containing tick. */
+unsigned staff_t::measure_begin(unsigned tick)
+{
+    ScoreEventList::iterator it=eventlist.upper_bound(pair<unsigned, FloEvent>(tick, FloEvent(tick,INT_MAX,0,0,FloEvent::BAR)));
+    while (it!=eventlist.begin())
+    {
+        it--;
+        if (it->second.type==FloEvent::BAR)
+            return it->first;
+    }
+    return 0;
+}
+
+/* returns the begin of the measure after the one containing tick,
+ * or UINT_MAX if that's the last one.
+ */
+unsigned staff_t::measure_end(unsigned tick)
+{
+    if (tick==UINT_MAX)
+        return UINT_MAX;
+
+    ScoreEventList::iterator it=eventlist.lower_bound(pair<unsigned, FloEvent>(tick+1, FloEvent(tick+1,-1,0,0,FloEvent::NOTE_OFF)));
+    for (; it!=eventlist.end(); it++)
+        if (it->second.type==FloEvent::BAR)
+            return it->first;
+    return UINT_MAX;
+}
+
+void staff_t::recalculate_range(unsigned& from, unsigned& to)
+{
+    if (!laid_out)
+    {
+        recalculate();
+        from=0;
+        to=UINT_MAX;
+        return;
+    }
+
+    // quantisation may move the notes a bit
+    unsigned quant=parent->quant_ticks();
+    from = (from>quant) ? from-quant : 0;
+    to = (to<UINT_MAX-quant) ? to+quant : UINT_MAX;
+
+    // an earlier note reaching into the range may now be cut by
+    // another note at its pitch, or not anymore. its source event
+    // isn't in the range, so it still exists.
+    ScoreEventList::iterator it=eventlist.lower_bound(pair<unsigned, FloEvent>(
+        (from>max_note_len) ? from-max_note_len : 0, FloEvent(0,-1,0,0,FloEvent::NOTE_OFF)));
+    for (; it!=eventlist.end() && it->first<from; it++)
+        if (it->second.type==FloEvent::NOTE_ON)
+        {
+            const MusECore::Event* ev=it->second.source_event;
+            unsigned end=flo_quantize(ev->endTick()+it->second.source_part->tick(), quant);
+            if (end<=it->first)
+                end=it->first+quant;
+            if (end>from)
+            {
+                from=it->first;
+                break;
+            }
+        }
+
+    // the notes of the affected measures are taken from the parts again
+    unsigned lo=measure_begin(from);
+    unsigned hi=measure_end(to);
+    unsigned layout_to=hi; // also covers the old and new ends of these notes
+
+    it=eventlist.lower_bound(pair<unsigned, FloEvent>(lo, FloEvent(lo,-1,0,0,FloEvent::NOTE_OFF)));
+    while (it!=eventlist.end() && it->first<hi)
+    {
+        if (it->second.type==FloEvent::NOTE_ON)
+        {
+            if (it->first+it->second.len > layout_to)
+                layout_to=it->first+it->second.len;
+            eventlist.erase(it++);
+        }
+        else
+            it++;
+    }
+
+    for (set<const MusECore::Part*>::const_iterator part_it=parts.begin(); part_it!=parts.end(); part_it++)
+    {
+        const MusECore::Part* part=*part_it;
+        unsigned part_tick=part->tick();
+        if ((hi!=UINT_MAX) && (part_tick>=hi+quant))
+            continue;
+
+        MusECore::ciEvent ev=part->events().lower_bound((lo>part_tick+quant) ? lo-part_tick-quant : 0);
+        for (; ev!=part->events().end(); ev++)
+        {
+            if ((hi!=UINT_MAX) && (ev->second.tick()+part_tick >= hi+quant))
+                break;
+
+            unsigned begin=flo_quantize(ev->second.tick()+part_tick, quant);
+            if ((begin>=lo) && (begin<hi))
+                add_note(part, ev->second);
+        }
+    }
+
+    cut_overlaps(lo, hi);
+
+    it=eventlist.lower_bound(pair<unsigned, FloEvent>(lo, FloEvent(lo,-1,0,0,FloEvent::NOTE_OFF)));
+    for (; it!=eventlist.end() && it->first<hi; it++)
+        if ((it->second.type==FloEvent::NOTE_ON) && (it->first+it->second.len > layout_to))
+            layout_to=it->first+it->second.len;
+
+    if (layout_to>hi)
+        layout_to=measure_end(layout_to-1);
+
+    if (heavyDebugMsg) cout << "re-layouting measures from t="<<lo<<" to t="<<layout_to<<endl;
+    relayout_measures(lo, layout_to);
+
+    // the measure before has the ties into ours
+    calc_item_pos((lo>0) ? measure_begin(lo-1) : 0, layout_to);
+
+    from=lo;
+    to=layout_to;
+}
+
+/* replaces the items of the measures from "from" up to "to"
+ * by a new layout. the measures before and after keep theirs.
+ */
+void staff_t::relayout_measures(unsigned from, unsigned to)
+{
+    // key and time signature in effect before the first measure. the
+    // ones at its begin are among the events.
+    MusECore::key_enum key=MusECore::KEY_C;
+    int num=4, denom=4;
+    if (from>0)
+    {
+        key=MusEGlobal::keymap.keyAtTick(from-1);
+        MusEGlobal::sigmap.timesig(from-1, num, denom);
+    }
+
+    // throw away the old items. the note and rest ends at "from" belong
+    // to the measure before, those at "to" belong to our last measure.
+    for (ScoreItemList::iterator it=itemlist.lower_bound(from); it!=itemlist.end() && it->first<=to;)
+    {
+        set<FloItem, floComp>& items=it->second;
+
+        if ((it->first==from) || (it->first==to))
+        {
+            for (set<FloItem, floComp>::iterator item=items.begin(); item!=items.end();)
+            {
+                bool is_end=(item->type==FloItem::NOTE_END) || (item->type==FloItem::REST_END);
+                if (is_end == (it->first==to))
+                    items.erase(item++);
+                else
+                    item++;
+            }
+        }
+        else
+            items.clear();
+
+        if (items.empty())
+            itemlist.erase(it++);
+        else
+            it++;
+    }
+
+    // the notes tied over into the first measure like create_itemlist()
+    // would have split them, our events, and the bar which closes the
+    // last measure.
+    ScoreEventList events;
+    ScoreEventList::iterator it=eventlist.lower_bound(pair<unsigned, FloEvent>(
+        (from>max_note_len) ? from-max_note_len : 0, FloEvent(0,-1,0,0,FloEvent::NOTE_OFF)));
+    for (; it!=eventlist.end() && it->first<from; it++)
+        if ((it->second.type==FloEvent::NOTE_ON) && (it->first+it->second.len > from))
+        {
+            FloEvent tied=it->second;
+            tied.len=it->first+it->second.len - from;
+            events.insert(pair<unsigned, FloEvent>(from, FloEvent(tied.tick,tied.pitch,tied.vel,0,FloEvent::NOTE_OFF, tied.source_part, tied.source_event)));
+            events.insert(pair<unsigned, FloEvent>(from, tied));
+        }
+
+    for (; it!=eventlist.end() && it->first<=to; it++)
+        if ((it->first<to) || (it->second.type==FloEvent::BAR))
+            events.insert(*it);
+
+    create_itemlist(events, to, key, num, denom);
+    process_itemlist(from, to, num, denom);
+}
+
 
 bool is_sharp_key(MusECore::key_enum t)
 {
@@ -2545,15 +2812,26 @@ void ScoreCanvas::draw_accidentials(QPainter& p, int x, int y_offset, const list
 
 void staff_t::create_itemlist()
 {
-    MusECore::key_enum tmp_key=MusECore::KEY_C;
+    // the note-offs and the remainders of split notes go into a copy,
+    // so the eventlist can be updated in place later
+    ScoreEventList events(eventlist);
+    itemlist.clear();
+    create_itemlist(events, UINT_MAX, MusECore::KEY_C, 4, 4); //4/4 is actually unnecessary, for safety
+}
+
+/* adds the items for the events to the itemlist. key and time signature
+ * are the ones in effect before the first event. a bar at "to" only
+ * closes the measure before; the items after it are left alone.
+ */
+void staff_t::create_itemlist(ScoreEventList& events, unsigned to, MusECore::key_enum key, int num, int denom)
+{
+    MusECore::key_enum tmp_key=key;
     int lastevent=0;
     int next_measure=-1;
     int last_measure=-1;
-    vector<int> emphasize_list=create_emphasize_list(4,4); //actually unnecessary, for safety
-
-    itemlist.clear();
+    vector<int> emphasize_list=create_emphasize_list(num,denom);
 
-    for (ScoreEventList::iterator it=eventlist.begin(); it!=eventlist.end(); it++)
+    for (ScoreEventList::iterator it=events.begin(); it!=events.end(); it++)
     {
         int t, pitch, len, velo, actual_tick;
         FloEvent::typeEnum type;
@@ -2605,6 +2883,9 @@ void staff_t::create_itemlist()
                 }
             }
 
+            if (unsigned(t) >= to)
+                break;
+
             lastevent=t;
             last_measure=t;
             next_measure=t+len;
@@ -2647,8 +2928,8 @@ void staff_t::create_itemlist()
                 //append the "remainder" of the note to our EventList, so that
                 //it gets processed again when entering the new measure
                 int newlen=len-tmplen;
-                eventlist.insert(pair<unsigned, FloEvent>(next_measure, FloEvent(actual_tick,pitch, velo,0,FloEvent::NOTE_OFF, it->second.source_part, it->second.source_event)));
-                eventlist.insert(pair<unsigned, FloEvent>(next_measure, FloEvent(actual_tick,pitch, velo,newlen,FloEvent::NOTE_ON, it->second.source_part, it->second.source_event)));
+                events.insert(pair<unsigned, FloEvent>(next_measure, FloEvent(actual_tick,pitch, velo,0,FloEvent::NOTE_OFF, it->second.source_part, it->second.source_event)));
+                events.insert(pair<unsigned, FloEvent>(next_measure, FloEvent(actual_tick,pitch, velo,newlen,FloEvent::NOTE_ON, it->second.source_part, it->second.source_event)));
 
                 if (heavyDebugMsg) cout << "\t\tnote was split to length "<<tmplen<<" + " << newlen<<endl;
             }
@@ -2658,7 +2939,7 @@ void staff_t::create_itemlist()
                 tied_note=false;
 
                 if (heavyDebugMsg) cout << "\t\tinserting NOTE OFF at "<<t+len<<endl;
-                eventlist.insert(pair<unsigned, FloEvent>(t+len,   FloEvent(t+len,pitch, velo,0,FloEvent::NOTE_OFF,it->second.source_part, it->second.source_event)));
+                events.insert(pair<unsigned, FloEvent>(t+len,   FloEvent(t+len,pitch, velo,0,FloEvent::NOTE_OFF,it->second.source_part, it->second.source_event)));
             }
 
             list<note_len_t> lens=parse_note_len(tmplen,t-last_measure,emphasize_list,true,true);
@@ -2703,13 +2984,30 @@ void staff_t::create_itemlist()
 }
 
 void staff_t::process_itemlist()
+{
+    process_itemlist(0, UINT_MAX, 4, 4); //4/4 is unnecessary, only for safety
+}
+
+/* processes the items from "from" up to (not including) "to", which
+ * must be bars. num and denom are the time signature at "from".
+ */
+void staff_t::process_itemlist(unsigned from, unsigned to, int num, int denom)
 {
     map<int,int> occupied;
-    int last_measure=0;
-    vector<int> emphasize_list=create_emphasize_list(4,4); //unnecessary, only for safety
+    int last_measure=from;
+    vector<int> emphasize_list=create_emphasize_list(num,denom);
+
+    ScoreItemList::iterator it2=itemlist.lower_bound(from);
+
+    //the notes and rests ending at "from" began in the measure before.
+    //count them as if we had come along there
+    if (it2!=itemlist.end() && it2->first==from)
+        for (set<FloItem, floComp>::iterator it=it2->second.begin(); it!=it2->second.end(); it++)
+            if ((it->type==FloItem::NOTE_END) || (it->type==FloItem::REST_END))
+                occupied[it->pos.height]++;
 
     //iterate through all times with items
-    for (ScoreItemList::iterator it2=itemlist.begin(); it2!=itemlist.end(); it2++)
+    for (; it2!=itemlist.end() && it2->first<to; it2++)
     {
         set<FloItem, floComp>& curr_items=it2->second;
 
@@ -3178,18 +3476,30 @@ void ScoreCanvas::draw_note_lines(QPainter& p, int y, bool reserve_akkolade_spac
 
 
 void staff_t::calc_item_pos()
+{
+    max_y_coord=0;
+    min_y_coord=0;
+    calc_item_pos(0, UINT_MAX);
+}
+
+/* calculates the positions of the items from "from" up to "to",
+ * which must be bars. the staff's height only grows here.
+ */
+void staff_t::calc_item_pos(unsigned from, unsigned to)
 {
     //this has to be KEY_C or KEY_C_B and nothing else,
     //because only with these two keys the next (initial)
     //key signature is properly drawn.
     MusECore::key_enum curr_key=MusECore::KEY_C;
+    if (from>0)
+        curr_key=MusEGlobal::keymap.keyAtTick(from-1);
 
-    int pos_add=0;
+    int pos_add=parent->calc_posadd(from);
 
-    max_y_coord=0;
-    min_y_coord=0;
+    int max_y=0;
+    int min_y=0;
 
-    for (ScoreItemList::iterator it2=itemlist.begin(); it2!=itemlist.end(); it2++)
+    for (ScoreItemList::iterator it2=itemlist.lower_bound(from); it2!=itemlist.end() && it2->first<=to; it2++)
     {
         for (set<FloItem, floComp>::iterator it=it2->second.begin(); it!=it2->second.end();it++)
         {
@@ -3199,8 +3509,8 @@ void staff_t::calc_item_pos()
 
             if (it->type==FloItem::NOTE)
             {
-                if (it->y > max_y_coord) max_y_coord=it->y;
-                if (it->y < min_y_coord) min_y_coord=it->y;
+                if (it->y > max_y) max_y=it->y;
+                if (it->y < min_y) min_y=it->y;
 
                 it->x+=parent->note_x_indent() + it->shift*NOTE_SHIFT;
 
@@ -3276,8 +3586,11 @@ void staff_t::calc_item_pos()
         }
     }
 
-    max_y_coord+= (pix_quarter->height()/2 +NOTE_YDIST/2);
-    min_y_coord-= (pix_quarter->height()/2 +NOTE_YDIST/2);
+    max_y+= (pix_quarter->height()/2 +NOTE_YDIST/2);
+    min_y-= (pix_quarter->height()/2 +NOTE_YDIST/2);
+
+    if (max_y > max_y_coord) max_y_coord=max_y;
+    if (min_y < min_y_coord) min_y_coord=min_y;
 }
 
 void ScoreCanvas::calc_pos_add_list()
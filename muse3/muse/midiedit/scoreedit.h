@@ -565,31 +565,44 @@ struct staff_t
 	int min_y_coord;
 	int max_y_coord;
 	
+	// the longest note in the eventlist, before overlapping notes
+	// were cut. notes starting this far before a change may be affected
+	unsigned max_note_len;
+	bool laid_out;
+	
 	staff_type_t type;
 	clef_t clef;
 	
 	ScoreCanvas* parent;
 	
 	void create_appropriate_eventlist();
+	void add_note(const MusECore::Part* part, const MusECore::Event& event);
+	void cut_overlaps(unsigned from, unsigned to);
 	void create_itemlist();
+	void create_itemlist(ScoreEventList& events, unsigned to, MusECore::key_enum key, int num, int denom);
 	void process_itemlist();
+	void process_itemlist(unsigned from, unsigned to, int num, int denom);
 	void calc_item_pos();
+	void calc_item_pos(unsigned from, unsigned to);
+	void relayout_measures(unsigned from, unsigned to);
+	unsigned measure_begin(unsigned tick);
+	unsigned measure_end(unsigned tick);
 	
 	void apply_lasso(QRect rect, set<const MusECore::Event*>& already_processed);
 	
-	void recalculate()
-	{
-		create_appropriate_eventlist();
-		create_itemlist();
-		process_itemlist();
-		calc_item_pos();
-	}
+	void recalculate();
+	// only re-layouts the measures affected by events changed between
+	// the ticks from and to. returns the measures' tick range there.
+	void recalculate_range(unsigned& from, unsigned& to);
 	
 	staff_t(ScoreCanvas* parent_)
 	{
 		type=NORMAL;
 		clef=VIOLIN;
 		parent=parent_;
+		min_y_coord=max_y_coord=0;
+		max_note_len=0;
+		laid_out=false;
 	}
 	
 	staff_t (ScoreCanvas* parent_, staff_type_t type_, clef_t clef_, set<const MusECore::Part*> parts_)
@@ -598,6 +611,9 @@ struct staff_t
 		clef=clef_;
 		parts=parts_;
 		parent=parent_;
+		min_y_coord=max_y_coord=0;
+		max_note_len=0;
+		laid_out=false;
 		update_part_indices();
 	}
 	
@@ -703,6 +719,11 @@ class ScoreCanvas : public MusEGui::View
 		
 		list<staff_t> staves;
 		
+		// layout cost, summed up over all layouts. see song_changed()
+		unsigned layout_count;
+		qint64 layout_nsecs;
+		qint64 last_layout_nsecs;
+		
 		MusECore::StepRec* steprec;
 		
 		// the drawing area is split into a "preamble" containing clef,
@@ -853,6 +874,10 @@ class ScoreCanvas : public MusEGui::View
 		int viewport_width();
 		int viewport_height();
 		
+		// how much time the layouts took in total, and how many there were
+		qint64 layout_time_nsecs() const { return layout_nsecs; }
+		unsigned layout_runs() const { return layout_count; }
+		
 		int quant_power2() { return _quant_power2; }
 		int quant_len() { return (1<<_quant_power2); }
 		int quant_ticks() { return TICKS_PER_WHOLE / (1<<_quant_power2); }
@@ -217,20 +217,20 @@ void MidiEventBase::read(Xml& xml)
                         break;
                   case Xml::Attribut:
                         if (tag == "tick")
-                              setTick(xml.s2().toInt());
+                              setTick(xml.s2Int());
                         else if (tag == "type")
                               //setType(EventType(xml.s2().toInt()));
-                              ev_type = xml.s2().toInt();
+                              ev_type = xml.s2Int();
                         else if (tag == "len")
-                              setLenTick(xml.s2().toInt());
+                              setLenTick(xml.s2Int());
                         else if (tag == "a")
-                              a = xml.s2().toInt();
+                              a = xml.s2Int();
                         else if (tag == "b")
-                              b = xml.s2().toInt();
+                              b = xml.s2Int();
                         else if (tag == "c")
-                              c = xml.s2().toInt();
+                              c = xml.s2Int();
                         else if (tag == "datalen")
-                              dataLen = xml.s2().toInt();
+                              dataLen = xml.s2Int();
                         break;
                   case Xml::TagEnd:
                         if (tag == "event") {
@@ -44,6 +44,7 @@
 #include "icons.h"
 #include "track.h"
 #include "drummap.h"
+#include "freeze.h"
 #include "audio.h"
 #include "muse_math.h"
 #include "sysex_helper.h"
@@ -974,6 +975,7 @@ bool MidiPort::putHwCtrlEvent(const MidiPlayEvent& ev)
     return true;
   }
   
+  invalidateSynthFreeze(ev);
   return false;
 }
 
@@ -1772,6 +1774,18 @@ int MidiPort::getVisibleCtrl(int ch, unsigned int tick, int ctrl, Part* part, bo
       return cl->second->visibleValue(tick, part, inclMutedParts, inclMutedTracks, inclOffTracks);
       }
 
+int MidiPort::getChasedCtrl(int ch, unsigned int tick, int ctrl) const
+      {
+      iMidiCtrlValList cl = _controller->find(ch, ctrl);
+      if (cl == _controller->end())
+            return CTRL_VAL_UNKNOWN;
+
+      MidiCtrlChasePoint cp;
+      if (!cl->second->guiChase(tick, &cp))
+            return CTRL_VAL_UNKNOWN;
+      return cp.val;
+      }
+
 //---------------------------------------------------------
 //   deleteController
 //---------------------------------------------------------
@@ -117,6 +117,9 @@ class MidiPort {
       // Determine controller value at tick on channel, using values stored by the SPECIFIC part,
       //  ignoring values that are OUTSIDE of the part, or muted or off part or track.
       int getVisibleCtrl(int ch, unsigned int tick, int ctrl, Part* part, bool inclMutedParts, bool inclMutedTracks, bool inclOffTracks) const;
+      // Determine controller value at tick on channel as chased when the song is located there.
+      // Uses the chase checkpoints, so it is cheap to call repeatedly, for example when scrubbing.
+      int getChasedCtrl(int ch, unsigned int tick, int ctrl) const;
       bool setControllerVal(int ch, unsigned int tick, int ctrl, int val, Part* part);
       // Can be CTRL_VAL_UNKNOWN until a valid state is set
       int lastValidHWCtrlState(int ch, int ctrl) const;
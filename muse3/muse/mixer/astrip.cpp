@@ -41,6 +41,7 @@
 #include <QVariant>
 #include <QAction>
 #include <QGridLayout>
+#include <QLabel>
 
 #include "app.h"
 #include "globals.h"
@@ -58,6 +59,7 @@
 #include "doublelabel.h"
 #include "rack.h"
 #include "node.h"
+#include "plugin.h"
 #include "amixer.h"
 #include "icons.h"
 #include "gconfig.h"
@@ -800,12 +802,74 @@ void AudioStrip::heartBeat()
    _infoRack->updateComponents();
    _lowerRack->updateComponents();
 
+   // About once a second is plenty for the statistics.
+   if(--_dspStatsBeat <= 0)
+   {
+     _dspStatsBeat = MusEGlobal::config.guiRefresh;
+     updateDspStats();
+   }
+
 //    if(_recMonitor && _recMonitor->isChecked() && MusEGlobal::blinkTimerPhase != _recMonitor->blinkPhase())
 //      _recMonitor->setBlinkPhase(MusEGlobal::blinkTimerPhase);
 
    Strip::heartBeat();
 }
 
+//---------------------------------------------------------
+//   dspStatsLine
+//---------------------------------------------------------
+
+static QString dspStatsLine(const QString& node, const MusECore::DspTimeStats* stats, double cycle_us)
+{
+  MusECore::DspTimeSummary s;
+  if(!stats->summary(&s))
+    return QString();
+  return QString("\n%1: %2 / %3 / %4 us (%5%)")
+    .arg(node)
+    .arg(s.avg, 0, 'f', 1)
+    .arg(s.p99, 0, 'f', 1)
+    .arg(s.max, 0, 'f', 1)
+    .arg(cycle_us > 0.0 ? s.avg * 100.0 / cycle_us : 0.0, 0, 'f', 1);
+}
+
+//---------------------------------------------------------
+//   updateDspStats
+//    Shows the track's dsp time in the readout above the meters,
+//     and the break down by synth and plugin on the name label.
+//---------------------------------------------------------
+
+void AudioStrip::updateDspStats()
+{
+  MusECore::AudioTrack* t = static_cast<MusECore::AudioTrack*>(track);
+  const double cycle_us = MusEGlobal::sampleRate > 0 ?
+    double(MusEGlobal::segmentSize) * 1000000.0 / double(MusEGlobal::sampleRate) : 0.0;
+
+  MusECore::DspTimeSummary s;
+  QString readout("---");
+  if(t->dspStats()->summary(&s) && cycle_us > 0.0)
+    readout = QString("%1/%2%").arg(s.avg * 100.0 / cycle_us, 0, 'f', 1).arg(s.p99 * 100.0 / cycle_us, 0, 'f', 1);
+  if(_dspStatsLabel->text() != readout)
+    _dspStatsLabel->setText(readout);
+
+  QString txt = dspStatsLine(tr("Track"), t->dspStats(), cycle_us);
+  if(t->type() == MusECore::Track::AUDIO_SOFTSYNTH)
+    txt += dspStatsLine(tr("Synth"), static_cast<MusECore::SynthI*>(t)->synthDspStats(), cycle_us);
+  MusECore::Pipeline* pl = t->efxPipe();
+  if(pl)
+  {
+    for(MusECore::ciPluginI ip = pl->begin(); ip != pl->end(); ++ip)
+    {
+      if(*ip)
+        txt += dspStatsLine((*ip)->name(), (*ip)->dspStats(), cycle_us);
+    }
+  }
+
+  if(txt.isEmpty())
+    label->setToolTip(label->text());
+  else
+    label->setToolTip(label->text() + QString("\n") + tr("DSP time avg / p99 / max (% of cycle):") + txt);
+}
+
 void AudioStrip::updateRackSizes(bool upper, bool lower)
 {
 //   const QFontMetrics fm = fontMetrics();
@@ -1345,6 +1409,7 @@ AudioStrip::AudioStrip(QWidget* parent, MusECore::AudioTrack* at, bool hasHandle
 
       volume        = -1.0;
       _volPressed   = false;
+      _dspStatsBeat = 0;
       
       slider        = 0;
       sl            = 0;
@@ -1502,7 +1567,14 @@ AudioStrip::AudioStrip(QWidget* parent, MusECore::AudioTrack* at, bool hasHandle
       for(int ch = 0; ch < channel; ++ch)
         _clipperLayout->addWidget(_clipperLabel[ch]);
       sliderGrid->addLayout(_clipperLayout, 0, 0, 1, -1, Qt::AlignCenter);
-      sliderGrid->addItem(new QSpacerItem(0, 1), 1, 0, 1, -1);
+
+      /*-------------- dsp time readout ----------------*/
+      _dspStatsLabel = new QLabel(QString("---"));
+      _dspStatsLabel->setContentsMargins(0, 1, 0, 0);
+      _dspStatsLabel->setAlignment(Qt::AlignCenter);
+      _dspStatsLabel->setToolTip(tr("DSP time of this track per process cycle, average / 99th percentile,\n"
+                                    "in % of the cycle. Audio > Reset DSP Time Statistics starts over."));
+      sliderGrid->addWidget(_dspStatsLabel, 1, 0, 1, -1, Qt::AlignCenter);
       
       slider = new Slider(this, "vol", Qt::Vertical, MusEGui::Slider::InsideVertical, 14, 
                           MusEGlobal::config.audioVolumeSliderColor, 
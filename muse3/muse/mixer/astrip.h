@@ -31,6 +31,7 @@
 
 class QButton;
 class QHBoxLayout;
+class QLabel;
 class QVBoxLayout;
 class QColor;
 class QWidget;
@@ -174,6 +175,11 @@ class AudioStrip : public Strip {
       QHBoxLayout* _clipperLayout;
 
       void setClipperTooltip(int ch);
+      // Shows the track's dsp time per cycle, average and p99 in % of the cycle.
+      QLabel* _dspStatsLabel;
+      // Heartbeats until the dsp time readout and tooltip are refreshed.
+      int _dspStatsBeat;
+      void updateDspStats();
       
       void updateOffState();
       void updateVolume();
@@ -4803,6 +4803,11 @@ void RouteDialog::connectClicked()
   const int dstSelSz = dstList.size();
   bool upd_trk_props = false;
   MusECore::MidiTrack::ChangedType_t changed = MusECore::MidiTrack::NothingChanged;
+#ifdef _USE_MIDI_TRACK_SINGLE_OUT_PORT_CHAN_
+  // Midi track output port and channel changes. Applied together below,
+  //  so that idling the audio costs two cycles instead of two per route.
+  std::vector<std::pair<MusECore::MidiTrack*, MusECore::Route> > midiOutChanges;
+#endif
 
   for(int srcIdx = 0; srcIdx < srcSelSz; ++srcIdx)
   {
@@ -4829,9 +4834,9 @@ void RouteDialog::connectClicked()
                 // Only remove it if it's a different port or channel. 
                 if(src.channel >= 0 && src.channel < MusECore::MUSE_MIDI_CHANNELS && (mt->outPort() != dst.midiPort || mt->outChannel() != src.channel))
                 {
-                  MusEGlobal::audio->msgIdle(true);
-                  changed |= mt->setOutPortAndChannelAndUpdate(dst.midiPort, src.channel, false);
-                  MusEGlobal::audio->msgIdle(false);
+                  MusECore::Route r = dst;
+                  r.channel = src.channel;
+                  midiOutChanges.push_back(std::make_pair(mt, r));
                   //MusEGlobal::audio->msgUpdateSoloStates();
                   //MusEGlobal::song->update(SC_MIDI_TRACK_PROP);
                   upd_trk_props = true;
@@ -4855,6 +4860,16 @@ void RouteDialog::connectClicked()
     }
   }
 
+#ifdef _USE_MIDI_TRACK_SINGLE_OUT_PORT_CHAN_
+  if(!midiOutChanges.empty())
+  {
+    MusEGlobal::audio->msgIdle(true);
+    for(std::vector<std::pair<MusECore::MidiTrack*, MusECore::Route> >::const_iterator i = midiOutChanges.begin(); i != midiOutChanges.end(); ++i)
+      changed |= i->first->setOutPortAndChannelAndUpdate(i->second.midiPort, i->second.channel, false);
+    MusEGlobal::audio->msgIdle(false);
+  }
+#endif
+
   if(!operations.empty())
   {
     operations.add(MusECore::PendingOperationItem((MusECore::TrackList*)NULL, MusECore::PendingOperationItem::UpdateSoloStates));
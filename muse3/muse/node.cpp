@@ -43,6 +43,7 @@
 #include "ticksynth.h"  // metronome
 #include "wavepreview.h"
 #include "al/dsp.h"
+#include "latency_compensator.h"
 
 // REMOVE Tim. Persistent routes. Added. Make this permanent later if it works OK and makes good sense.
 #define _USE_SIMPLIFIED_SOLO_CHAIN_
@@ -334,6 +335,46 @@ void AudioTrack::updateSoloStates(bool noDec)
   _nodeTraversed = false; // Reset.
 }
 
+//---------------------------------------------------------
+//   volumeRampLength
+//   The volume smoothing multiplies the current volume by
+//    up_fact or down_fact for each sample until it reaches the
+//    target volume, or -30dB going down.
+//   Returns for how many samples it is still ramping, at most n,
+//    so that the ramp can be applied in one go. Also returns the
+//    factor to use. The current volume must have been kick-started
+//    if it was zero.
+//   The gain is stepped exactly as Dsp::cpyWithRamp() will, a
+//    closed form with log() is off by one sample now and then.
+//---------------------------------------------------------
+
+static unsigned long volumeRampLength(double cur, double target, double up_fact, double down_fact,
+                                      unsigned long n, double* factor)
+{
+  unsigned long k = 0;
+  if(target > cur)
+  {
+    *factor = up_fact;
+    for( ; k < n; ++k)
+    {
+      cur *= up_fact;
+      if(cur >= target)
+        break;
+    }
+  }
+  else if(target < cur)
+  {
+    *factor = down_fact;
+    for( ; k < n; ++k)
+    {
+      cur *= down_fact;
+      if(cur <= target || cur <= 0.001)  // Or if less than -30dB.
+        break;
+    }
+  }
+  return k;
+}
+
 //---------------------------------------------------------
 //   processTrackCtrls
 //   If trackChans is 0, just process controllers only, not audio (do not 'run').
@@ -572,47 +613,22 @@ void AudioTrack::processTrackCtrls(unsigned pos, int trackChans, unsigned nframe
               _volume = vol_interp.sVal;
             _controls[AC_VOLUME].dval = _volume;    // Update the port.
             v = _volume * _gain;
-            if(v > _curVolume)
+            if(v > _curVolume && _curVolume == 0.0)
+              _curVolume = 0.001;  // Kick-start it from zero at -30dB.
+            double fact;
+            k = volumeRampLength(_curVolume, v, up_fact, down_fact, nsamp, &fact);
+            if(k != 0)
             {
-              //fprintf(stderr, "A %f %f\n", v, _curVolume);
-              if(_curVolume == 0.0)
-                _curVolume = 0.001;  // Kick-start it from zero at -30dB.
-              for( ; k < nsamp; ++k)
-              {
-                _curVolume *= up_fact;
-                if(_curVolume >= v)
-                {
-                  _curVolume = v;
-                  break;
-                }
-                const unsigned long smp = sample + k;
-                for(int ch = start_ch; ch < trackChans; ++ch)
-                  *(outBuffers[ch] + smp) = *(buffer[ch] + smp) * _curVolume;
-              }
-            }
-            else
-            if(v < _curVolume)
-            {
-              //fprintf(stderr, "B %f %f\n", v, _curVolume);
-              for( ; k < nsamp; ++k)
-              {
-                _curVolume *= down_fact;
-                if(_curVolume <= v || _curVolume <= 0.001)  // Or if less than -30dB.
-                {
-                  _curVolume = v;
-                  break;
-                }
-                const unsigned long smp = sample + k;
-                for(int ch = start_ch; ch < trackChans; ++ch)
-                  *(outBuffers[ch] + smp) = *(buffer[ch] + smp) * _curVolume;
-              }
+              double vol = _curVolume;
+              for(int ch = start_ch; ch < trackChans; ++ch)
+                vol = AL::dsp->cpyWithRamp(outBuffers[ch] + sample, buffer[ch] + sample, k, _curVolume, fact);
+              _curVolume = vol;
             }
-
-            const unsigned long next_smp = sample + nsamp;
-            for(unsigned long smp = sample + k; smp < next_smp; ++smp)
+            if(k < nsamp)
             {
+              _curVolume = v;
               for(int ch = start_ch; ch < trackChans; ++ch)
-                *(outBuffers[ch] + smp) = *(buffer[ch] + smp) * _curVolume;
+                AL::dsp->cpyWithGain(outBuffers[ch] + sample + k, buffer[ch] + sample + k, nsamp - k, _curVolume);
             }
           }
         }
@@ -683,74 +699,29 @@ void AudioTrack::processTrackCtrls(unsigned pos, int trackChans, unsigned nframe
           v = _volume * _gain;
           v1  = v * (1.0 - _pan);
           v2  = v * (1.0 + _pan);
-          if(v1 > _curVol1)
-          {
-            //fprintf(stderr, "C %f %f \n", v1, _curVol1);
-            if(_curVol1 == 0.0)
-              _curVol1 = 0.001;  // Kick-start it from zero at -30dB.
-            for( ; k < nsamp; ++k)
-            {
-              _curVol1 *= up_fact;
-              if(_curVol1 >= v1)
-              {
-                _curVol1 = v1;
-                break;
-              }
-              *dp1++ = *sp1++ * _curVol1;
-            }
-          }
+          if(v1 > _curVol1 && _curVol1 == 0.0)
+            _curVol1 = 0.001;  // Kick-start it from zero at -30dB.
+          if(v2 > _curVol2 && _curVol2 == 0.0)
+            _curVol2 = 0.001;  // Kick-start it from zero at -30dB.
+          double fact1, fact2;
+          const unsigned long k1 = volumeRampLength(_curVol1, v1, up_fact, down_fact, nsamp, &fact1);
+          const unsigned long k2 = volumeRampLength(_curVol2, v2, up_fact, down_fact, nsamp, &fact2);
+          if(k1 != 0)
+            _curVol1 = AL::dsp->cpyWithRamp(dp1, sp1, k1, _curVol1, fact1);
+          if(k1 < nsamp)
+            _curVol1 = v1;
+          if(k2 != 0)
+            _curVol2 = AL::dsp->cpyWithRamp(dp2, sp2, k2, _curVol2, fact2);
+          if(k2 < nsamp)
+            _curVol2 = v2;
+          // The rest is at constant volume. A mono source is panned to both sides in one pass.
+          if(sp1 == sp2 && k1 == k2)
+            AL::dsp->panMix(dp1 + k1, dp2 + k1, sp1 + k1, nsamp - k1, _curVol1, _curVol2);
           else
-          if(v1 < _curVol1)
           {
-            //fprintf(stderr, "D %f %f \n", v1, _curVol1);
-            for( ; k < nsamp; ++k)
-            {
-              _curVol1 *= down_fact;
-              if(_curVol1 <= v1 || _curVol1 <= 0.001)  // Or if less than -30dB.
-              {
-                _curVol1 = v1;
-                break;
-              }
-              *dp1++ = *sp1++ * _curVol1;
-            }
+            AL::dsp->cpyWithGain(dp1 + k1, sp1 + k1, nsamp - k1, _curVol1);
+            AL::dsp->cpyWithGain(dp2 + k2, sp2 + k2, nsamp - k2, _curVol2);
           }
-          for( ; k < nsamp; ++k)
-            *dp1++ = *sp1++ * _curVol1;
-
-          k = 0;
-          if(v2 > _curVol2)
-          {
-            //fprintf(stderr, "E %f %f \n", v2, _curVol2);
-            if(_curVol2 == 0.0)
-              _curVol2 = 0.001;  // Kick-start it from zero at -30dB.
-            for( ; k < nsamp; ++k)
-            {
-              _curVol2 *= up_fact;
-              if(_curVol2 >= v2)
-              {
-                _curVol2 = v2;
-                break;
-              }
-              *dp2++ = *sp2++ * _curVol2;
-            }
-          }
-          else
-          if(v2 < _curVol2)
-          {
-            //fprintf(stderr, "F %f %f \n", v2, _curVol2);
-            for( ; k < nsamp; ++k)
-            {
-              _curVol2 *= down_fact;
-              if(_curVol2 <= v2 || _curVol2 <= 0.001)   // Or if less than -30dB.
-              {
-                _curVol2 = v2;
-                break;
-              }
-              *dp2++ = *sp2++ * _curVol2;
-            }
-          }
-          for( ; k < nsamp; ++k)
-            *dp2++ = *sp2++ * _curVol2;
         }
       }
 
@@ -855,10 +826,7 @@ void AudioTrack::copyData(unsigned pos,
               sp = outBuffers[srcStartChan]; // In all other cases use the main buffers.
             float* dp = dstBuffer[c + dstStartChan];
             if(addArray ? addArray[c + dstStartChan] : add)
-            {
-              for(unsigned k = 0; k < nframes; ++k)
-                *dp++ += *sp++;
-            }
+              AL::dsp->mix(dp, sp, nframes);
             else
               AL::dsp->cpy(dp, sp, nframes);
           }
@@ -887,10 +855,7 @@ void AudioTrack::copyData(unsigned pos,
             float* sp = outBuffers[srcStartChan + sch];
             float* dp = dstBuffer[dstStartChan];
             if((addArray ? addArray[dstStartChan] : add) || sch != 0)
-            {
-              for(unsigned k = 0; k < nframes; ++k)
-                *dp++ += *sp++;
-            }
+              AL::dsp->mix(dp, sp, nframes);
             else
               AL::dsp->cpy(dp, sp, nframes);
           }
@@ -915,10 +880,7 @@ void AudioTrack::copyData(unsigned pos,
           float* sp = outBuffers[c + srcStartChan];
           float* dp = dstBuffer[c + dstStartChan];
           if(addArray ? addArray[c + dstStartChan] : add)
-          {
-            for(unsigned k = 0; k < nframes; ++k)
-              *dp++ += *sp++;
-          }
+            AL::dsp->mix(dp, sp, nframes);
           else
             AL::dsp->cpy(dp, sp, nframes);
         }
@@ -961,12 +923,19 @@ void AudioTrack::copyData(unsigned pos,
   {
     // First time here during this process cycle.
 
+    // Times the rest of this cycle's processing of the track, minus any upstream tracks pulled below.
+    DspTimer dsp_timer(&_dspStats, true);
+
     _haveData = false;  // Reset.
+    _auxSendsPending = false;  // Reset.
     _processed = true;  // Set this now.
 
     // Start by clearing the meters. There may be multiple contributions to them below.
     for(i = 0; i < trackChans; ++i)
+    {
       _meter[i] = 0.0;
+      _meterRms[i] = 0.0;
+    }
 
     if(off())
     {
@@ -1001,13 +970,33 @@ void AudioTrack::copyData(unsigned pos,
     for(i = 0; i < srcTotalOutChans; ++i)
         buffer[i] = _dataBuffers[i];
 
+    if(_frozen)
+    {
+      // Frozen. Play the rendered output of the instrument and rack instead of running them.
+      // Any further synth outputs are silent.
+      const bool have_data = getFrozenData(pos, trackChans, nframes, buffer);
+      for(i = have_data ? trackChans : 0; i < srcTotalOutChans; ++i)
+      {
+        if(MusEGlobal::config.useDenormalBias)
+        {
+          for(unsigned int q = 0; q < nframes; ++q)
+            buffer[i][q] = MusEGlobal::denormalBias;
+        }
+        else
+          memset(buffer[i], 0, sizeof(float) * nframes);
+      }
+      _efxPipe->apply(pos, 0, nframes, 0);  // Just process controls only, not audio (do not 'run').
+      // The instrument is not run, so nobody takes the events meant for it.
+      if(type() == AUDIO_SOFTSYNTH)
+        static_cast<SynthI*>(this)->discardEvents();
+    }
     // getData can use the supplied buffers, or change buffer to point to its own local buffers or Jack buffers etc.
     // For ex. if this is an audio input, Jack will set the pointers for us in AudioInput::getData!
     // Don't do any processing at all if off. Whereas, mute needs to be ready for action at all times,
     //  so still call getData before it. Off is NOT meant to be toggled rapidly, but mute is !
     // Since the meters are cleared above, getData can contribute (add) to them directly and return HaveMeterDataOnly
     //  if it does not want to pass the audio for listening.
-    if(!getData(pos, srcTotalOutChans, nframes, buffer))
+    else if(!getData(pos, srcTotalOutChans, nframes, buffer))
     {
       #ifdef NODE_DEBUG_PROCESS
       fprintf(stderr, "MusE: AudioTrack::copyData name:%s srcTotalOutChans:%d zeroing buffers\n", name().toLatin1().constData(), srcTotalOutChans);
@@ -1031,8 +1020,15 @@ void AudioTrack::copyData(unsigned pos,
     // apply plugin chain
     //---------------------------------------------------
 
-    // Allow it to process even if muted so that when mute is turned off, left-over buffers (reverb tails etc) can die away.
-    _efxPipe->apply(pos, trackChans, nframes, buffer);
+    if(!_frozen)
+    {
+      // Allow it to process even if muted so that when mute is turned off, left-over buffers (reverb tails etc) can die away.
+      _efxPipe->apply(pos, trackChans, nframes, buffer);
+
+      // Rendering the freeze file? Take the output of the rack, before volume and pan.
+      if(!_freezeCapture.isNull())
+        captureFreeze(pos, trackChans, nframes, buffer);
+    }
 
     //---------------------------------------------------
     // apply volume, pan
@@ -1049,14 +1045,13 @@ void AudioTrack::copyData(unsigned pos,
     // FIXME TODO Need multichannel changes here?
     for(int c = 0; c < trackChans; ++c)
     {
-      meter[c] = 0.0;
       float* sp = (c >= valid_out_bufs) ? buffer[c] : outBuffers[c]; // Optimize: Don't all valid outBuffers just for meters
-      for(unsigned k = 0; k < nframes; ++k)
-      {
-        const double f = fabs(*sp++); // If the track is mono pan has no effect on meters.
-        if(f > meter[c])
-          meter[c] = f;
-      }
+      // If the track is mono pan has no effect on meters.
+      // Peak and rms in one pass over the buffer.
+      float sum_squares = 0.0f;
+      meter[c] = AL::dsp->peakRms(sp, nframes, 0.0f, &sum_squares);
+      if(nframes)
+        _meterRms[c] = sqrt(sum_squares / nframes);
       if(meter[c] > _meter[c])
         _meter[c] = meter[c];
       if(_meter[c] > _peak[c])
@@ -1098,41 +1093,10 @@ void AudioTrack::copyData(unsigned pos,
     // aux sends
     //---------------------------------------------------
 
-    // FIXME TODO Need multichannel changes here? Yes
-    if(hasAuxSend())
-    {
-      AuxList* al = MusEGlobal::song->auxs();
-      unsigned naux = al->size();
-      for(unsigned k = 0; k < naux; ++k)
-      {
-        double m = _auxSend[k];
-        if(m <= 0.0001)           // optimize
-          continue;
-        AudioAux* a = (AudioAux*)((*al)[k]);
-        float** dst = a->sendBuffer();
-        int auxChannels = a->channels();
-        if((availableSrcChans ==1 && auxChannels==1) || availableSrcChans == 2)
-        {
-          for(int ch = 0; ch < availableSrcChans; ++ch)
-          {
-            float* db = dst[ch % a->channels()]; // no matter whether there's one or two dst buffers
-            float* sb = outBuffers[ch];
-            for(unsigned f = 0; f < nframes; ++f)
-              *db++ += (*sb++ * m);   // add to mix
-          }
-        }
-        else if(availableSrcChans==1 && auxChannels==2)  // copy mono to both channels
-        {
-          for(int ch = 0; ch < auxChannels; ++ch)
-          {
-            float* db = dst[ch % a->channels()];
-            float* sb = outBuffers[0];
-            for(unsigned f = 0; f < nframes; ++f)
-              *db++ += (*sb++ * m);   // add to mix
-          }
-        }
-      }
-    }
+    // Aux sends are not mixed here. Several tracks may be processed concurrently by
+    //  the audio graph workers, so the aux tracks gather them later in track list order.
+    //  See AudioAux::getData().
+    _auxSendsPending = hasAuxSend();
 
     //---------------------------------------------------
     //    copy to destination buffers
@@ -1172,10 +1136,7 @@ void AudioTrack::copyData(unsigned pos,
             sp = outBuffers[srcStartChan]; // In all other cases use the main buffers.
           float* dp = dstBuffer[c + dstStartChan];
           if(addArray ? addArray[c + dstStartChan] : add)
-          {
-            for(unsigned k = 0; k < nframes; ++k)
-              *dp++ += *sp++;
-          }
+            AL::dsp->mix(dp, sp, nframes);
           else
             AL::dsp->cpy(dp, sp, nframes);
         }
@@ -1204,10 +1165,7 @@ void AudioTrack::copyData(unsigned pos,
           float* sp = outBuffers[srcStartChan + sch];
           float* dp = dstBuffer[dstStartChan];
           if((addArray ? addArray[dstStartChan] : add) || sch != 0)
-          {
-            for(unsigned k = 0; k < nframes; ++k)
-              *dp++ += *sp++;
-          }
+            AL::dsp->mix(dp, sp, nframes);
           else
             AL::dsp->cpy(dp, sp, nframes);
         }
@@ -1232,10 +1190,7 @@ void AudioTrack::copyData(unsigned pos,
         float* sp = outBuffers[c + srcStartChan];
         float* dp = dstBuffer[c + dstStartChan];
         if(addArray ? addArray[c + dstStartChan] : add)
-        {
-          for(unsigned k = 0; k < nframes; ++k)
-            *dp++ += *sp++;
-        }
+          AL::dsp->mix(dp, sp, nframes);
         else
           AL::dsp->cpy(dp, sp, nframes);
       }
@@ -1256,6 +1211,209 @@ void AudioTrack::copyData(unsigned pos,
   }
 }
 
+//---------------------------------------------------------
+//   mixAuxSends
+//    Mixes the cached output of this cycle into the aux send buffers.
+//---------------------------------------------------------
+
+void AudioTrack::mixAuxSends(unsigned nframes)
+{
+  _auxSendsPending = false;
+
+  // FIXME TODO Need multichannel changes here? Yes
+  const int srcChans = totalProcessBuffers();
+  AuxList* al = MusEGlobal::song->auxs();
+  unsigned naux = al->size();
+  for(unsigned k = 0; k < naux; ++k)
+  {
+    double m = _auxSend[k];
+    if(m <= 0.0001)           // optimize
+      continue;
+    AudioAux* a = (AudioAux*)((*al)[k]);
+    float** dst = a->sendBuffer();
+    int auxChannels = a->channels();
+    if((srcChans ==1 && auxChannels==1) || srcChans == 2)
+    {
+      for(int ch = 0; ch < srcChans; ++ch)
+      {
+        float* db = dst[ch % a->channels()]; // no matter whether there's one or two dst buffers
+        float* sb = outBuffers[ch];
+        AL::dsp->mixWithGain(db, sb, nframes, m);   // add to mix
+      }
+    }
+    else if(srcChans==1 && auxChannels==2)  // copy mono to both channels
+    {
+      for(int ch = 0; ch < auxChannels; ++ch)
+      {
+        float* db = dst[ch % a->channels()];
+        float* sb = outBuffers[0];
+        AL::dsp->mixWithGain(db, sb, nframes, m);   // add to mix
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------
+//   updateLatency
+//    Plugin delay compensation. Our output latency is the
+//     highest output latency of our input routes, to which
+//     all input routes are aligned in getData(), plus our
+//     own processing latency.
+//---------------------------------------------------------
+
+void AudioTrack::updateLatency()
+{
+  if(_latencyUpdated)
+    return;
+  if(_latencyVisiting)         // Anti circular mechanism.
+    return;
+  _latencyVisiting = true;
+
+  float in_lat = 0.0;
+  // An off track does not gather its inputs at all.
+  if(!off())
+  {
+    const RouteList* rl = inRoutes();
+    for(ciRoute ir = rl->begin(); ir != rl->end(); ++ir)
+    {
+      if(ir->type != Route::TRACK_ROUTE || !ir->track || ir->track->isMidiTrack())
+        continue;
+      AudioTrack* atrack = static_cast<AudioTrack*>(ir->track);
+      atrack->updateLatency();
+      if(atrack->outputLatency() > in_lat)
+        in_lat = atrack->outputLatency();
+    }
+  }
+  _latencyIn = in_lat;
+
+  // Only count our own processing latency. AudioInput::latency() also includes the capture port latency.
+  if(off())
+    _latencyOut = 0.0;
+  else
+    _latencyOut = in_lat + (type() == AUDIO_INPUT ? AudioTrack::latency(0) : latency(0));
+
+  _latencyVisiting = false;
+  _latencyUpdated = true;
+}
+
+//---------------------------------------------------------
+//   latencyCompDstChannels
+//    The number of our channels an input route feeds,
+//     as gathered by getData(). Zero if none.
+//---------------------------------------------------------
+
+static int latencyCompDstChannels(const Route& r, int channels)
+{
+  const int dst_ch = r.channel <= -1 ? 0 : r.channel;
+  if(dst_ch >= channels)
+    return 0;
+  const int dst_chs = r.channels <= -1 ? channels : r.channels;
+  if(dst_ch + dst_chs > channels)
+    return channels - dst_ch;
+  return dst_chs;
+}
+
+//---------------------------------------------------------
+//   findLatencyCompensator
+//    Called from audio thread only.
+//---------------------------------------------------------
+
+LatencyCompensator* AudioTrack::findLatencyCompensator(const Route& r) const
+{
+  const InRouteLatencyCompList* lcl = _inRouteLatencyComps;
+  if(!lcl)
+    return 0;
+  for(InRouteLatencyCompList::const_iterator i = lcl->begin(); i != lcl->end(); ++i)
+  {
+    if(i->track == r.track && i->channel == r.channel &&
+       i->channels == r.channels && i->remoteChannel == r.remoteChannel)
+      return i->compensator;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------
+//   latencyCompFrames
+//    The delay needed by an input route to line up with
+//     our slowest input route, in frames.
+//---------------------------------------------------------
+
+unsigned long AudioTrack::latencyCompFrames(const Route& r) const
+{
+  const float diff = _latencyIn - static_cast<const AudioTrack*>(r.track)->outputLatency();
+  return diff >= 0.5 ? diff + 0.5 : 0;
+}
+
+//---------------------------------------------------------
+//   updateLatencyCompensators
+//    Called from gui thread only.
+//---------------------------------------------------------
+
+AudioTrack::InRouteLatencyCompList* AudioTrack::updateLatencyCompensators()
+{
+  InRouteLatencyCompList* old_list = _inRouteLatencyComps;
+  const RouteList* rl = inRoutes();
+
+  // Anything to do? Each audio input route needs a delay line of the right width,
+  //  long enough for the difference between its latency and our slowest input route's.
+  bool changed = false;
+  int n = 0;
+  unsigned long too_long = 0;
+  for(ciRoute ir = rl->begin(); ir != rl->end(); ++ir)
+  {
+    if(ir->type != Route::TRACK_ROUTE || !ir->track || ir->track->isMidiTrack())
+      continue;
+    const int chs = latencyCompDstChannels(*ir, channels());
+    if(chs <= 0)
+      continue;
+    ++n;
+    const unsigned long frames = latencyCompFrames(*ir);
+    const LatencyCompensator* lc = findLatencyCompensator(*ir);
+    if(!lc || lc->channels() != (unsigned long)chs ||
+       lc->bufferSize() < LatencyCompensator::bufferSizeFor(frames))
+      changed = true;
+    if(frames >= LatencyCompensator::maxBufferSize && frames > too_long)
+      too_long = frames;
+  }
+
+  // Report each new longest delay which cannot be compensated, once.
+  if(too_long > _latencyCompTooLong)
+    fprintf(stderr, "Warning: Track %s: an input route needs a delay of %lu frames to be compensated,"
+                    " more than the largest delay line of %lu frames. It is only partly compensated.\n",
+            name().toLocal8Bit().constData(), too_long, LatencyCompensator::maxBufferSize - 1);
+  _latencyCompTooLong = too_long;
+
+  if(!changed && (old_list ? (int)old_list->size() : 0) == n)
+    return 0;
+
+  InRouteLatencyCompList* new_list = new InRouteLatencyCompList;
+  new_list->reserve(n);
+  for(ciRoute ir = rl->begin(); ir != rl->end(); ++ir)
+  {
+    if(ir->type != Route::TRACK_ROUTE || !ir->track || ir->track->isMidiTrack())
+      continue;
+    const int chs = latencyCompDstChannels(*ir, channels());
+    if(chs <= 0)
+      continue;
+    InRouteLatencyComp c;
+    c.track = ir->track;
+    c.channel = ir->channel;
+    c.channels = ir->channels;
+    c.remoteChannel = ir->remoteChannel;
+    // Keep an existing delay line with its contents, if it still fits.
+    // It is shared by the old and new lists until the caller frees the old one.
+    const unsigned long size = LatencyCompensator::bufferSizeFor(latencyCompFrames(*ir));
+    c.compensator = findLatencyCompensator(*ir);
+    if(!c.compensator || c.compensator->channels() != (unsigned long)chs || c.compensator->bufferSize() < size)
+      c.compensator = new LatencyCompensator(chs, size);
+    new_list->push_back(c);
+  }
+
+  _inRouteLatencyComps = new_list;
+  // Return an empty list rather than null, so the caller knows something changed.
+  return old_list ? old_list : new InRouteLatencyCompList;
+}
+
 //---------------------------------------------------------
 //   readVolume
 //---------------------------------------------------------
@@ -1300,6 +1458,7 @@ void Track::setChannels(int n)
         _channels = n;
       for (int i = 0; i < _channels; ++i) {
             _meter[i] = 0.0;
+            _meterRms[i] = 0.0;
             _peak[i]  = 0.0;
             }
       }
@@ -1375,11 +1534,67 @@ bool AudioTrack::getData(unsigned pos, int channels, unsigned nframes, float** b
                     src_ch, src_chs);
             #endif
 
-            static_cast<AudioTrack*>(ir->track)->copyData(pos,
-                                                          dst_ch, dst_chs, fin_dst_chs,
-                                                          src_ch, src_chs,
-                                                          nframes, buffer,
-                                                          false, used_in_chan_array);
+            AudioTrack* atrack = static_cast<AudioTrack*>(ir->track);
+
+            // Plugin delay compensation: If this route arrives earlier than our
+            //  slowest input route, delay it by the difference.
+            // The delay lines are created by the gui thread. Until this route has one
+            //  of the right width (the next gui heartbeat), it is passed through as is.
+            unsigned long comp_frames = 0;
+            LatencyCompensator* lc = 0;
+            if(MusEGlobal::config.latencyCompensation)
+            {
+              lc = findLatencyCompensator(*ir);
+              if(lc && lc->channels() != (unsigned long)fin_dst_chs)
+                lc = 0;
+              const float diff = _latencyIn - atrack->outputLatency();
+              if(lc && diff >= 0.5)
+                comp_frames = diff + 0.5;
+              // The gui thread grows the delay line at the next heartbeat, and reports
+              //  delays longer than the largest one. Until then the delay is clamped.
+              if(lc && comp_frames >= lc->bufferSize())
+                comp_frames = lc->bufferSize() - 1;
+            }
+
+            if(comp_frames == 0)
+            {
+              // Reset so that any later delay starts with a clean buffer.
+              if(lc && lc->delay(0) != 0)
+                lc->setDelay(0);
+
+              atrack->copyData(pos,
+                               dst_ch, dst_chs, fin_dst_chs,
+                               src_ch, src_chs,
+                               nframes, buffer,
+                               false, used_in_chan_array);
+            }
+            else
+            {
+              if(lc->delay(0) != comp_frames)
+              {
+                lc->clear();
+                lc->setDelay(comp_frames);
+              }
+
+              // Gather the route's data into temporary buffers, delay it, then mix it in.
+              float* tmp[channels];
+              float tmp_data[nframes * fin_dst_chs];
+              for(int i = 0; i < channels; ++i)
+                tmp[i] = (i >= dst_ch && i < dst_ch + fin_dst_chs) ? tmp_data + (i - dst_ch) * nframes : 0;
+              atrack->copyData(pos,
+                               dst_ch, dst_chs, fin_dst_chs,
+                               src_ch, src_chs,
+                               nframes, tmp);
+              lc->run(nframes, tmp + dst_ch);
+              for(int i = dst_ch; i < dst_ch + fin_dst_chs; ++i)
+              {
+                if(used_in_chan_array[i])
+                  AL::dsp->mix(buffer[i], tmp[i], nframes);
+                else
+                  AL::dsp->cpy(buffer[i], tmp[i], nframes);
+              }
+            }
+
             const int next_chan = dst_ch + fin_dst_chs;
             for(int i = dst_ch; i < next_chan; ++i)
               used_in_chan_array[i] = true;
@@ -1480,8 +1695,10 @@ void AudioInput::setName(const QString& s)
 
 void Track::resetMeter()
       {
-      for (int i = 0; i < _channels; ++i)
+      for (int i = 0; i < _channels; ++i) {
             _meter[i] = 0.0;
+            _meterRms[i] = 0.0;
+            }
       }
 
 //---------------------------------------------------------
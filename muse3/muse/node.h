@@ -64,6 +64,7 @@ class Fifo {
       void remove();
       int getCount();
       bool isEmpty();
+      int capacity() const { return nbuffer; }
       };
 
 } // namespace MusECore
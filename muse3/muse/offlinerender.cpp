@@ -0,0 +1,289 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  offlinerender.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <sndfile.h>
+
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QRegExp>
+#include <QTimer>
+
+#include "offlinerender.h"
+#include "app.h"
+#include "audio.h"
+#include "audiodev.h"
+#include "globals.h"
+#include "song.h"
+#include "track.h"
+#include "pos.h"
+
+namespace MusEGlobal {
+MusECore::OfflineRender* offlineRender = 0;
+}
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   renderFormats
+//    Only formats which libsndfile can open read/write,
+//     as SndFile::openWrite() needs.
+//---------------------------------------------------------
+
+static const struct {
+      const char* name;
+      const char* suffix;
+      int format;
+      } renderFormats[] = {
+      { "wav16",   "wav",  SF_FORMAT_WAV  | SF_FORMAT_PCM_16 },
+      { "wav24",   "wav",  SF_FORMAT_WAV  | SF_FORMAT_PCM_24 },
+      { "wav32f",  "wav",  SF_FORMAT_WAV  | SF_FORMAT_FLOAT  },
+      { "aiff16",  "aiff", SF_FORMAT_AIFF | SF_FORMAT_PCM_16 },
+      { "aiff24",  "aiff", SF_FORMAT_AIFF | SF_FORMAT_PCM_24 },
+      { "aiff32f", "aiff", SF_FORMAT_AIFF | SF_FORMAT_FLOAT  },
+      { "caf16",   "caf",  SF_FORMAT_CAF  | SF_FORMAT_PCM_16 },
+      { "caf24",   "caf",  SF_FORMAT_CAF  | SF_FORMAT_PCM_24 },
+      { "caf32f",  "caf",  SF_FORMAT_CAF  | SF_FORMAT_FLOAT  },
+      };
+static const int nRenderFormats = sizeof(renderFormats) / sizeof(*renderFormats);
+
+int OfflineRender::parseFormat(const QString& s)
+      {
+      for (int i = 0; i < nRenderFormats; ++i) {
+            if (s == renderFormats[i].name)
+                  return renderFormats[i].format;
+            }
+      return 0;
+      }
+
+const char* OfflineRender::formatNames()
+      {
+      return "wav16 wav24 wav32f aiff16 aiff24 aiff32f caf16 caf24 caf32f";
+      }
+
+//---------------------------------------------------------
+//   OfflineRender
+//---------------------------------------------------------
+
+OfflineRender::OfflineRender(const QString& dir, int format, QObject* parent)
+   : QObject(parent)
+      {
+      _dir    = dir;
+      _format = format;
+      _frames = 0;
+      _written = 0;
+      for (int i = 0; i < 2; ++i) {
+            _silence[i] = new float[MusEGlobal::segmentSize];
+            memset(_silence[i], 0, sizeof(float) * MusEGlobal::segmentSize);
+            }
+      _timer = new QTimer(this);
+      connect(_timer, SIGNAL(timeout()), SLOT(poll()));
+      }
+
+OfflineRender::~OfflineRender()
+      {
+      if (MusEGlobal::offlineRender == this)
+            MusEGlobal::offlineRender = 0;
+      for (int i = 0; i < 2; ++i)
+            delete[] _silence[i];
+      }
+
+//---------------------------------------------------------
+//   createFile
+//    Returns a null file on error.
+//---------------------------------------------------------
+
+SndFileR OfflineRender::createFile(const QString& name, int channels)
+      {
+      const char* suffix = "wav";
+      for (int i = 0; i < nRenderFormats; ++i) {
+            if (renderFormats[i].format == _format) {
+                  suffix = renderFormats[i].suffix;
+                  break;
+                  }
+            }
+      QString path = _dir + "/" + name + "." + suffix;
+      // openWrite() opens read/write, it would keep the old contents.
+      QFile::remove(path);
+
+      SndFileR sf(new SndFile(path));
+      sf.setFormat(_format, channels, MusEGlobal::sampleRate);
+      if (sf.openWrite()) {
+            fprintf(stderr, "render: cannot create <%s>: %s\n",
+               path.toLocal8Bit().constData(), sf.strerror().toLocal8Bit().constData());
+            return SndFileR();
+            }
+      return sf;
+      }
+
+//---------------------------------------------------------
+//   start
+//    Called once the song is loaded.
+//---------------------------------------------------------
+
+void OfflineRender::start()
+      {
+      Song* song = MusEGlobal::song;
+      if (MusEGlobal::audioDevice->deviceType() != AudioDevice::DUMMY_AUDIO) {
+            fprintf(stderr, "render: needs the dummy audio driver\n");
+            finish(1);
+            return;
+            }
+      OutputList* ol = song->outputs();
+      if (ol->empty()) {
+            fprintf(stderr, "render: no audio output track found\n");
+            finish(1);
+            return;
+            }
+      // As with bounce to file, the first output is the master.
+      AudioOutput* ao = ol->front();
+
+      _frames = Pos(song->len(), true).frame();
+      if (_frames == 0) {
+            fprintf(stderr, "render: song is empty\n");
+            finish(1);
+            return;
+            }
+      if (!QDir().mkpath(_dir)) {
+            fprintf(stderr, "render: cannot create directory <%s>\n", _dir.toLocal8Bit().constData());
+            finish(1);
+            return;
+            }
+
+      _master = createFile("master", ao->channels());
+      if (_master.isNull()) {
+            finish(1);
+            return;
+            }
+
+      // One stem per track which produces audio itself or sums other tracks.
+      // Inputs and outputs are just the ends of the chain.
+      int n = 0;
+      TrackList* tl = song->tracks();
+      for (iTrack it = tl->begin(); it != tl->end(); ++it) {
+            Track* t = *it;
+            if (t->isMidiTrack() || t->type() == Track::AUDIO_OUTPUT || t->type() == Track::AUDIO_INPUT)
+                  continue;
+            QString name = QString("%1_%2").arg(++n, 2, 10, QChar('0'))
+               .arg(t->name().simplified().replace(QRegExp("[^A-Za-z0-9_.-]"), "_"));
+            Stem stem;
+            stem.track = static_cast<AudioTrack*>(t);
+            stem.file  = createFile(name, t->channels());
+            if (stem.file.isNull()) {
+                  finish(1);
+                  return;
+                  }
+            _stems.push_back(stem);
+            }
+
+      fprintf(stderr, "render: %u frames, master and %zu stems into <%s>\n",
+         _frames, _stems.size(), _dir.toLocal8Bit().constData());
+
+      song->setPos(Song::LPOS, Pos(0, false), false, false);
+      song->setPos(Song::RPOS, Pos(_frames, false), false, false);
+      song->setPos(Song::CPOS, Pos(0, false), true, true);
+
+      song->bounceOutput = ao;
+      ao->setRecFile(_master);
+      song->setRecord(true, false);
+      song->setRecordFlag(ao, true);
+
+      MusEGlobal::offlineRender = this;
+      // Regardless of config.freewheelMode: This is what lets the dummy
+      //  driver run its cycles back to back.
+      MusEGlobal::audioDevice->setFreewheel(true);
+      _elapsed.start();
+      MusEGlobal::audio->msgBounce();
+      song->setPlay(true);
+      _timer->start(50);
+      }
+
+//---------------------------------------------------------
+//   processWrite
+//    called from audio thread context, only while bouncing
+//---------------------------------------------------------
+
+void OfflineRender::processWrite(unsigned frames)
+      {
+      _written += frames;
+      for (std::vector<Stem>::iterator i = _stems.begin(); i != _stems.end(); ++i) {
+            AudioTrack* t = i->track;
+            if (t->processed())
+                  i->file.write(t->channels(), t->outputBuffers(), frames);
+            else
+                  i->file.write(t->channels(), _silence, frames);
+            }
+      }
+
+//---------------------------------------------------------
+//   poll
+//---------------------------------------------------------
+
+void OfflineRender::poll()
+      {
+      // The bounce flag is cleared by the audio thread at the right marker,
+      //  which then stops the transport.
+      if (MusEGlobal::audio->bounce() || MusEGlobal::audio->isPlaying())
+            return;
+      // Or it was stopped early, for example by a driver failure.
+      if (_written < _frames) {
+            fprintf(stderr, "render: stopped after %u of %u frames\n", (unsigned)_written, _frames);
+            finish(1);
+            return;
+            }
+      finish(0);
+      }
+
+//---------------------------------------------------------
+//   finish
+//    Closes the files, reports and quits.
+//---------------------------------------------------------
+
+void OfflineRender::finish(int rv)
+      {
+      _timer->stop();
+      MusEGlobal::audioDevice->setFreewheel(false);
+      MusEGlobal::offlineRender = 0;
+
+      const double secs = _elapsed.isValid() ? _elapsed.elapsed() / 1000.0 : 0.0;
+      if (!_master.isNull())
+            _master.close();
+      for (std::vector<Stem>::iterator i = _stems.begin(); i != _stems.end(); ++i)
+            i->file.close();
+      _stems.clear();
+      _master = NULL;
+
+      if (rv == 0) {
+            const double audioSecs = double(_frames) / double(MusEGlobal::sampleRate);
+            fprintf(stderr, "render: %.2f s of audio in %.2f s, %.1fx realtime\n",
+               audioSecs, secs, secs > 0.0 ? audioSecs / secs : 0.0);
+            }
+
+      // Nothing to save, do not ask.
+      MusEGlobal::song->dirty = false;
+      MusEGlobal::muse->close();
+      qApp->exit(rv);
+      }
+
+} // namespace MusECore
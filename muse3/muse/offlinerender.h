@@ -0,0 +1,100 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  offlinerender.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __OFFLINERENDER_H__
+#define __OFFLINERENDER_H__
+
+#include <vector>
+#include <atomic>
+
+#include <QObject>
+#include <QString>
+#include <QElapsedTimer>
+
+#include "wave.h"
+
+class QTimer;
+
+namespace MusECore {
+
+class AudioTrack;
+
+//---------------------------------------------------------
+//   OfflineRender
+//    Renders the loaded song from start to end into
+//     a directory, without a gui, as fast as possible:
+//     The master bus via the bounce mechanism, plus one
+//     stem file per track. Needs the dummy audio driver,
+//     which runs its cycles back to back when freewheeling.
+//    Quits the application when done.
+//---------------------------------------------------------
+
+class OfflineRender : public QObject {
+      Q_OBJECT
+
+      struct Stem {
+            AudioTrack* track;
+            SndFileR file;
+            };
+
+      QString _dir;
+      int _format;
+      // Only touched by the audio thread while rendering.
+      std::vector<Stem> _stems;
+      SndFileR _master;
+      float* _silence[2];
+      QTimer* _timer;
+      QElapsedTimer _elapsed;
+      unsigned _frames;
+      // Frames rendered so far, counted by the audio thread.
+      std::atomic<unsigned> _written;
+
+      SndFileR createFile(const QString& name, int channels);
+      void finish(int rv);
+
+   private slots:
+      void poll();
+
+   public slots:
+      void start();
+
+   public:
+      OfflineRender(const QString& dir, int format, QObject* parent = 0);
+      virtual ~OfflineRender();
+
+      // Called by the audio thread after each cycle, writes the stems.
+      void processWrite(unsigned frames);
+
+      // Parses a format name like "wav24" or "aiff32f" into a sndfile format.
+      // Returns 0 if unknown.
+      static int parseFormat(const QString& s);
+      static const char* formatNames();
+      };
+
+} // namespace MusECore
+
+namespace MusEGlobal {
+// Only set in command line render mode, for the audio thread to find us.
+extern MusECore::OfflineRender* offlineRender;
+}
+
+#endif
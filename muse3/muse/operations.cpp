@@ -1067,6 +1067,7 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
       _ev.dump();
 #endif      
       _part->nonconst_events().erase(_iev);
+      _part->eventsChanged();
 #ifdef _PENDING_OPS_DEBUG_
       fprintf(stderr, "PendingOperationItem::executeRTStage DeleteEvent post:   ");
       _ev.dump();
@@ -1102,7 +1103,10 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
          !_part->mute() && 
          (!_part->track() || (!_part->track()->isMute() && !_part->track()->off())))
          // FIXME FINDMICHJETZT XTicks!!
+      {
         _mcvl->insert(MidiCtrlValListInsertPair_t(_posLenVal, MidiCtrlVal(_part, _intB)));
+        _mcvl->chaseChanged(_posLenVal);
+      }
       // No song changed flags are required to be set here.
     break;
     case DeleteMidiCtrlVal:
@@ -1110,6 +1114,7 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
       fprintf(stderr, "PendingOperationItem::executeRTStage DeleteMidiCtrlVal: mcvl:%p tick:%u part:%p val:%d\n", 
                        _mcvl, _imcv->first, _imcv->second.part, _imcv->second.val);
 #endif      
+      _mcvl->chaseChanged(_imcv->first);
       _mcvl->erase(_imcv);
       // No song changed flags are required to be set here.
     break;
@@ -1119,6 +1124,7 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
                        _imcv->second.part, _imcv->second.val, _intA);
 #endif      
       _imcv->second.val = _intA;
+      _mcvl->chaseChanged(_imcv->first);
     break;
     
     
@@ -1159,6 +1165,7 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
       if(_iCtrl->second.frame == _posLenVal)
       {
         _iCtrl->second.val = _ctl_dbl_val;
+        _aud_ctrl_list->invalidateFlat();
       }
       // Otherwise erase + add is required.
       else
@@ -1349,6 +1356,11 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
       fprintf(stderr, "PendingOperationItem::executeRTStage unknown type %d\n", _type);
     break;
   }
+  
+  // Muting, soloing and part changes decide which controller values are chased on seek.
+  if(flags._flags & (SC_MUTE | SC_SOLO | SC_PART_INSERTED | SC_PART_REMOVED | SC_PART_MODIFIED))
+    MidiCtrlValList::invalidateAllChase();
+  
   return flags;
 }
 
@@ -1458,6 +1470,23 @@ SongChangedStruct_t PendingOperationList::executeRTStage()
   for(iPendingOperation ip = begin(); ip != end(); ++ip)
     _sc_flags |= ip->executeRTStage();
   
+  // Rebuild the flat copies of the controller lists changed above, all at once,
+  //  while nothing else can read them. Room was made for them in add().
+  for(iPendingOperation ip = begin(); ip != end(); ++ip)
+  {
+    switch(ip->_type)
+    {
+      case PendingOperationItem::AddAudioCtrlVal:
+      case PendingOperationItem::DeleteAudioCtrlVal:
+      case PendingOperationItem::ModifyAudioCtrlVal:
+        if(!ip->_aud_ctrl_list->flatValid())
+          ip->_aud_ctrl_list->updateFlat();
+      break;
+      default:
+      break;
+    }
+  }
+  
   // To avoid doing this item by item, do it here.
   if(_sc_flags._flags & (SC_TRACK_INSERTED | SC_TRACK_REMOVED | SC_ROUTE))
   {
@@ -1473,6 +1502,10 @@ SongChangedStruct_t PendingOperationList::executeNonRTStage()
 #ifdef _PENDING_OPS_DEBUG_
   fprintf(stderr, "PendingOperationList::executeNonRTStage executing...\n");
 #endif      
+  // The flat copies were rebuilt, free the room made for them.
+  // Before the items' stage, which may delete removed tracks and their lists.
+  for(std::map<CtrlList*, unsigned int>::iterator i = _ctrlListAdds.begin(); i != _ctrlListAdds.end(); ++i)
+    i->first->releaseFlatSpare();
   for(iPendingOperation ip = begin(); ip != end(); ++ip)
     _sc_flags |= ip->executeNonRTStage();
   return _sc_flags;
@@ -1482,6 +1515,7 @@ void PendingOperationList::clear()
 {
   _sc_flags = 0;
   _map.clear();
+  _ctrlListAdds.clear();
   std::list<PendingOperationItem>::clear();  
 #ifdef _PENDING_OPS_DEBUG_
   fprintf(stderr, "PendingOperationList::clear * post map size:%d list size:%d\n", _map.size(), size());
@@ -1492,6 +1526,29 @@ bool PendingOperationList::add(PendingOperationItem op)
 {
   unsigned int t = op.getIndex();
 
+  // The audio thread looks automation up in flat copies of the controller lists.
+  // Build them for lists which are not published yet, and make room for the others.
+  switch(op._type)
+  {
+    case PendingOperationItem::AddTrack:
+      if(!op._track->isMidiTrack())
+        static_cast<AudioTrack*>(op._track)->controller()->updateFlat();
+    break;
+    case PendingOperationItem::ModifyAudioCtrlValList:
+      if(!op._aud_ctrl_list->flatValid())
+        op._aud_ctrl_list->updateFlat();
+    break;
+    case PendingOperationItem::AddAudioCtrlVal:
+    case PendingOperationItem::ModifyAudioCtrlVal:
+      op._aud_ctrl_list->reserveFlat(++_ctrlListAdds[op._aud_ctrl_list]);
+    break;
+    case PendingOperationItem::DeleteAudioCtrlVal:
+      op._aud_ctrl_list->reserveFlat(_ctrlListAdds[op._aud_ctrl_list]);
+    break;
+    default:
+    break;
+  }
+
   switch(op._type)
   {
     // For these special allocation ops, searching has already been done before hand. Just add them.
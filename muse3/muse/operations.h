@@ -524,6 +524,10 @@ class PendingOperationList : public std::list<PendingOperationItem>
     std::multimap<unsigned int, iterator, std::less<unsigned int> > _map; 
     // Accumulated song changed flags.
     SongChangedStruct_t _sc_flags;
+    // Number of points each controller list may gain from the operations, so that
+    //  the rebuild of its flat copy in executeRTStage() need not allocate.
+    // Also lists which only lose points. The room is freed again in executeNonRTStage().
+    std::map<CtrlList*, unsigned int> _ctrlListAdds;
     
   public: 
     PendingOperationList() : _sc_flags(0) { }
@@ -0,0 +1,143 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  packed_events.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <string.h>
+#include <algorithm>
+
+#include "packed_events.h"
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   packEvent
+//    Returns false if the event is not played.
+//---------------------------------------------------------
+
+static bool packEvent(const Event& e, PackedMidiEvent* pe, int sysexIdx)
+{
+  pe->_tick = e.tick();
+  pe->_lenTick = 0;
+  pe->_a = 0;
+  pe->_b = 0;
+  pe->_c = 0;
+  pe->_type = e.type();
+  switch(e.type())
+  {
+    case Note:
+      pe->_lenTick = e.lenTick();
+      pe->_a = e.dataA();
+      pe->_b = e.dataB();
+      pe->_c = e.dataC();
+    break;
+    case Controller:
+      pe->_a = e.dataA();
+      pe->_b = e.dataB();
+    break;
+    case Sysex:
+      pe->_a = sysexIdx;
+    break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+//---------------------------------------------------------
+//   PackedMidiEvents
+//---------------------------------------------------------
+
+PackedMidiEvents::PackedMidiEvents(const EventList& el)
+  : _refs(1), _sourceSize(el.size())
+{
+  _events.reserve(el.size());
+  PackedMidiEvent pe;
+  for(ciEvent ie = el.begin(); ie != el.end(); ++ie)
+  {
+    const Event& e = ie->second;
+    if(!packEvent(e, &pe, _sysex.size()))
+      continue;
+    if(pe._type == Sysex)
+      _sysex.push_back(e);
+    _events.push_back(pe);
+  }
+}
+
+//---------------------------------------------------------
+//   matches
+//---------------------------------------------------------
+
+bool PackedMidiEvents::matches(const EventList& el) const
+{
+  if(el.size() != _sourceSize)
+    return false;
+  std::vector<PackedMidiEvent>::const_iterator ip = _events.begin();
+  PackedMidiEvent pe;
+  for(ciEvent ie = el.begin(); ie != el.end(); ++ie)
+  {
+    const Event& e = ie->second;
+    if(!packEvent(e, &pe, ip == _events.end() ? 0 : ip->_a))
+      continue;
+    if(ip == _events.end() ||
+       pe._tick != ip->_tick || pe._lenTick != ip->_lenTick || pe._type != ip->_type ||
+       pe._a != ip->_a || pe._b != ip->_b || pe._c != ip->_c)
+      return false;
+    if(pe._type == Sysex)
+    {
+      const Event& s = _sysex[pe._a];
+      if(s.dataLen() != e.dataLen() || (e.dataLen() > 0 && memcmp(s.data(), e.data(), e.dataLen()) != 0))
+        return false;
+    }
+    ++ip;
+  }
+  return ip == _events.end();
+}
+
+//---------------------------------------------------------
+//   memoryUsage
+//---------------------------------------------------------
+
+size_t PackedMidiEvents::memoryUsage() const
+{
+  return sizeof(PackedMidiEvents) +
+         _events.capacity() * sizeof(PackedMidiEvent) +
+         _sysex.capacity() * sizeof(Event);
+}
+
+//---------------------------------------------------------
+//   lowerBound
+//   upperBound
+//---------------------------------------------------------
+
+static bool packedTickLess(const PackedMidiEvent& e, unsigned tick) { return e._tick < tick; }
+static bool packedTickGreater(unsigned tick, const PackedMidiEvent& e) { return tick < e._tick; }
+
+const PackedMidiEvent* PackedMidiEvents::lowerBound(unsigned tick) const
+{
+  return std::lower_bound(begin(), end(), tick, packedTickLess);
+}
+
+const PackedMidiEvent* PackedMidiEvents::upperBound(unsigned tick) const
+{
+  return std::upper_bound(begin(), end(), tick, packedTickGreater);
+}
+
+} // namespace MusECore
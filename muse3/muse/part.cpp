@@ -37,6 +37,7 @@
 #include "drummap.h"
 #include "midictrl.h"
 #include "operations.h"
+#include "packed_events.h"
 
 namespace MusECore {
 
@@ -552,7 +553,9 @@ void modifyPortCtrlEvents(const Event& old_event, const Event& event, Part* part
 
 iEvent Part::addEvent(Event& p)
       {
-      return _events.add(p);
+      iEvent i = _events.add(p);
+      eventsChanged();
+      return i;
       }
 
 //---------------------------------------------------------
@@ -635,6 +638,78 @@ WavePart* WavePart::createNewClone() const
 	return (WavePart*)Part::createNewClone();
 }
 
+//---------------------------------------------------------
+//   MidiPart
+//---------------------------------------------------------
+
+MidiPart::MidiPart(MidiTrack* t)
+   : Part((Track*)t)
+      {
+      _packed.store(0, std::memory_order_relaxed);
+      _packedGarbage.store(0, std::memory_order_relaxed);
+      }
+
+MidiPart::~MidiPart()
+      {
+      PackedMidiEvents* p = _packed.exchange(0);
+      if(p)
+        p->release();
+      p = _packedGarbage.exchange(0);
+      if(p)
+        p->release();
+      }
+
+//---------------------------------------------------------
+//   eventsChanged
+//---------------------------------------------------------
+
+void MidiPart::eventsChanged()
+      {
+      PackedMidiEvents* p = _packed.exchange(0);
+      if(!p)
+        return;
+      // Garbage is always empty while a packed copy exists, see updatePackedEvents().
+      p = _packedGarbage.exchange(p);
+      if(p)
+        fprintf(stderr, "MusE: MidiPart::eventsChanged: packed events garbage not empty\n");
+      }
+
+//---------------------------------------------------------
+//   updatePackedEvents
+//---------------------------------------------------------
+
+void MidiPart::updatePackedEvents()
+      {
+      // Release any dropped copy before publishing a new one, so that
+      //  eventsChanged() always finds the garbage slot empty.
+      PackedMidiEvents* g = _packedGarbage.exchange(0);
+      if(g)
+        g->release();
+
+      if(_packed.load(std::memory_order_acquire))
+        return;
+
+      // Share the copy of a clone if it has the very same events. Clones are
+      //  normally edited together, but check since they are separate lists.
+      PackedMidiEvents* p = 0;
+      for(Part* c = nextClone(); c != this; c = c->nextClone())
+      {
+        PackedMidiEvents* cp = static_cast<MidiPart*>(c)->_packed.load(std::memory_order_acquire);
+        if(cp && cp->matches(_events))
+        {
+          cp->ref();
+          p = cp;
+          break;
+        }
+      }
+      if(!p)
+        p = new PackedMidiEvents(_events);
+
+      PackedMidiEvents* expected = 0;
+      if(!_packed.compare_exchange_strong(expected, p))
+        p->release();
+      }
+
 MidiPart* MidiPart::duplicateEmpty() const
 {
 	MidiPart* part = new MidiPart((MidiTrack*)this->_track);
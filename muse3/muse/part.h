@@ -26,6 +26,7 @@
 #define __PART_H__
 
 #include <map> 
+#include <atomic>
 
 #include <QUuid>
 
@@ -37,6 +38,7 @@ class QString;
 namespace MusECore {
 
 class MidiTrack;
+class PackedMidiEvents;
 class Track;
 class Xml;
 class Part;
@@ -131,6 +133,8 @@ class Part : public PosLen {
       virtual int hasHiddenEvents() const { return _hiddenEvents; }
       
       iEvent addEvent(Event& p); // this does not care about clones! If the part is a clone, be sure to execute this on all clones (with duplicated Events, that is!)
+      // Must be called after events were added to or removed from the list.
+      virtual void eventsChanged() { }
       // Returns true if any event was opened. Does not operate on the part's clones, if any.
       virtual bool openAllEvents() { return false; };
       // Returns true if any event was closed. Does not operate on the part's clones, if any.
@@ -148,9 +152,14 @@ class Part : public PosLen {
 
 class MidiPart : public Part {
 
+      // Packed playback copy of the events. Null while out of date.
+      std::atomic<PackedMidiEvents*> _packed;
+      // Copy dropped by eventsChanged(), released by the gui in updatePackedEvents().
+      std::atomic<PackedMidiEvents*> _packedGarbage;
+
    public:
-      MidiPart(MidiTrack* t) : Part((Track*)t) {}
-      virtual ~MidiPart() {}
+      MidiPart(MidiTrack* t);
+      virtual ~MidiPart();
       
       virtual PartType partType() const { return MidiPartType; }
       
@@ -162,6 +171,13 @@ class MidiPart : public Part {
       MidiTrack* track() const   { return (MidiTrack*)Part::track(); }
       // Returns combination of HiddenEventsType enum.
       int hasHiddenEvents() const;
+
+      // Packed copy of the events, for playback. Null if out of date, use events() then.
+      const PackedMidiEvents* packedEvents() const { return _packed.load(std::memory_order_acquire); }
+      // Gui thread. Builds the packed copy if out of date, or shares a clone's copy if it matches.
+      void updatePackedEvents();
+      // Drops the packed copy. Realtime safe, called from the operations' realtime stage.
+      void eventsChanged();
       
       virtual void dump(int n = 0) const;
       };
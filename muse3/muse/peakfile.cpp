@@ -0,0 +1,552 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  peakfile.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+#include "peakfile.h"
+#include "wave.h"
+#include "wavetiles.h"
+
+// Turn on debugging messages
+//#define PEAKFILE_DEBUG
+
+namespace MusECore {
+
+static const char peakFileMagic[8] = { 'M', 'u', 's', 'E', 'P', 'e', 'a', 'k' };
+static const uint32_t peakFileVersion = 1;
+// Frames read from the sound file at a time while building.
+static const int peakFileReadBlock = 32 * peakFileBaseMag;
+
+//---------------------------------------------------------
+//   levelMag
+//    frames per entry of the given level
+//---------------------------------------------------------
+
+static inline sf_count_t levelMag(int level)
+      {
+      sf_count_t mag = peakFileBaseMag;
+      for (int i = 0; i < level; ++i)
+            mag *= peakFileLevelFactor;
+      return mag;
+      }
+
+//---------------------------------------------------------
+//   peakFileLayout
+//    Fills in the levels, offsets and sizes of the header.
+//    Returns the size of the whole file.
+//---------------------------------------------------------
+
+static size_t peakFileLayout(PeakFileHeader* h)
+      {
+      // Keep adding coarser levels as long as they save more than one step.
+      int levels = 0;
+      int64_t offset = (sizeof(PeakFileHeader) + 63) & ~63;
+      for (int l = 0; l < peakFileMaxLevels; ++l) {
+            const sf_count_t mag = levelMag(l);
+            const int64_t size = (h->frames + mag - 1) / mag;
+            if (l > 0 && h->levelSize[l - 1] <= peakFileLevelFactor)
+                  break;
+            h->levelOffset[l] = offset;
+            h->levelSize[l]   = size;
+            offset += size * h->channels * sizeof(PeakFileEntry);
+            ++levels;
+            }
+      for (int l = levels; l < peakFileMaxLevels; ++l) {
+            h->levelOffset[l] = 0;
+            h->levelSize[l]   = 0;
+            }
+      h->levels = levels;
+      return offset;
+      }
+
+//---------------------------------------------------------
+//   PeakFile
+//---------------------------------------------------------
+
+PeakFile::PeakFile(const QString& path, const QString& soundPath)
+   : _path(path), _soundPath(soundPath)
+      {
+      _fd      = -1;
+      _map     = 0;
+      _mapSize = 0;
+      _header  = 0;
+      _cancel  = false;
+      }
+
+PeakFile::~PeakFile()
+      {
+      // Any tiles drawn from us are stale, or about to be.
+      invalidateWaveTiles(this);
+      unmap();
+      }
+
+//---------------------------------------------------------
+//   unmap
+//---------------------------------------------------------
+
+void PeakFile::unmap()
+      {
+      if (_map)
+            munmap(_map, _mapSize);
+      if (_fd != -1)
+            ::close(_fd);
+      _fd      = -1;
+      _map     = 0;
+      _mapSize = 0;
+      _header  = 0;
+      }
+
+//---------------------------------------------------------
+//   open
+//---------------------------------------------------------
+
+bool PeakFile::open(unsigned channels, sf_count_t frames)
+      {
+      unmap();
+      if (channels == 0 || frames <= 0)
+            return true;
+
+      QFileInfo fi(_soundPath);
+      const int64_t sourceTime = fi.lastModified().toMSecsSinceEpoch();
+      const int64_t sourceSize = fi.size();
+
+      const QByteArray p = _path.toLocal8Bit();
+      bool writable = true;
+      _fd = ::open(p.constData(), O_RDWR);
+      if (_fd == -1) {
+            // Maybe in a read only directory: Still fine if it is complete.
+            writable = false;
+            _fd = ::open(p.constData(), O_RDONLY);
+            }
+      if (_fd != -1) {
+            struct stat st;
+            if (fstat(_fd, &st) == 0 && st.st_size >= (off_t)sizeof(PeakFileHeader)) {
+                  _mapSize = st.st_size;
+                  void* m = mmap(0, _mapSize, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, _fd, 0);
+                  if (m != MAP_FAILED) {
+                        _map = (char*)m;
+                        PeakFileHeader* h = (PeakFileHeader*)_map;
+                        PeakFileHeader expect;
+                        memset(&expect, 0, sizeof(expect));
+                        expect.channels = channels;
+                        expect.frames   = frames;
+                        const size_t size = peakFileLayout(&expect);
+                        if (memcmp(h->magic, peakFileMagic, sizeof(peakFileMagic)) == 0
+                           && h->version == peakFileVersion
+                           && h->channels == channels
+                           && h->frames == frames
+                           && h->sourceTime == sourceTime
+                           && h->sourceSize == sourceSize
+                           && h->baseMag == (uint32_t)peakFileBaseMag
+                           && h->levelFactor == (uint32_t)peakFileLevelFactor
+                           && h->levels == expect.levels
+                           && _mapSize >= size
+                           && (writable || h->framesDone >= frames)) {
+                              _header = h;
+#ifdef PEAKFILE_DEBUG
+                              fprintf(stderr, "PeakFile::open: %s done:%lld of %lld\n", p.constData(),
+                                 (long long)h->framesDone, (long long)frames);
+#endif
+                              return false;
+                              }
+                        }
+                  }
+            unmap();
+            }
+      // Out of date, or of another version.
+      return create(channels, frames, sourceTime, sourceSize);
+      }
+
+//---------------------------------------------------------
+//   create
+//---------------------------------------------------------
+
+bool PeakFile::create(unsigned channels, sf_count_t frames, int64_t sourceTime, int64_t sourceSize)
+      {
+      const QByteArray p = _path.toLocal8Bit();
+      // Unlink rather than truncate: Someone else might still have the old file mapped,
+      //  and would crash accessing its truncated pages.
+      ::unlink(p.constData());
+      _fd = ::open(p.constData(), O_RDWR | O_CREAT | O_EXCL, 0644);
+      if (_fd == -1) {
+            fprintf(stderr, "PeakFile: cannot create %s: %s\n", p.constData(), strerror(errno));
+            return true;
+            }
+
+      PeakFileHeader h;
+      memset(&h, 0, sizeof(h));
+      memcpy(h.magic, peakFileMagic, sizeof(peakFileMagic));
+      h.version     = peakFileVersion;
+      h.channels    = channels;
+      h.frames      = frames;
+      h.sourceTime  = sourceTime;
+      h.sourceSize  = sourceSize;
+      h.baseMag     = peakFileBaseMag;
+      h.levelFactor = peakFileLevelFactor;
+      _mapSize = peakFileLayout(&h);
+
+      if (ftruncate(_fd, _mapSize) == -1) {
+            fprintf(stderr, "PeakFile: cannot resize %s: %s\n", p.constData(), strerror(errno));
+            unmap();
+            return true;
+            }
+      void* m = mmap(0, _mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+      if (m == MAP_FAILED) {
+            fprintf(stderr, "PeakFile: cannot map %s: %s\n", p.constData(), strerror(errno));
+            _mapSize = 0;
+            unmap();
+            return true;
+            }
+      _map = (char*)m;
+      _header = (PeakFileHeader*)_map;
+      memcpy(_header, &h, sizeof(h));
+      return false;
+      }
+
+//---------------------------------------------------------
+//   buildChunk
+//    Each chunk covers whole steps of the coarsest level,
+//     so that all levels are complete up to framesDone.
+//---------------------------------------------------------
+
+bool PeakFile::buildChunk(SNDFILE* sf)
+      {
+      if (!_header)
+            return false;
+      const sf_count_t done   = _header->framesDone;
+      const sf_count_t frames = _header->frames;
+      if (done >= frames)
+            return false;
+      const int levels       = _header->levels;
+      const unsigned chans   = _header->channels;
+      const sf_count_t end   = std::min(done + levelMag(levels - 1), frames);
+
+      if (sf_seek(sf, done, SEEK_SET) == -1)
+            return false;
+
+      std::vector<float> buffer(peakFileReadBlock * chans);
+      PeakFileEntry* e0 = entries(0);
+      for (sf_count_t pos = done; pos < end; ) {
+            const sf_count_t n = std::min((sf_count_t)peakFileReadBlock, end - pos);
+            sf_count_t rn = sf_readf_float(sf, &buffer[0], n);
+            if (rn < 0)
+                  rn = 0;
+            // The file may be shorter than it claimed: Treat the rest as silence.
+            if (rn < n)
+                  memset(&buffer[rn * chans], 0, (n - rn) * chans * sizeof(float));
+
+            for (sf_count_t k = 0; k < n; k += peakFileBaseMag) {
+                  const int fs = std::min((sf_count_t)peakFileBaseMag, n - k);
+                  PeakFileEntry* e = e0 + ((pos + k) / peakFileBaseMag) * chans;
+                  for (unsigned ch = 0; ch < chans; ++ch) {
+                        const float* src = &buffer[k * chans + ch];
+                        float mn = 0.0f, mx = 0.0f, sq = 0.0f;
+                        for (int i = 0; i < fs; ++i) {
+                              const float f = src[i * chans];
+                              if (f < mn)
+                                    mn = f;
+                              if (f > mx)
+                                    mx = f;
+                              sq += f * f;
+                              }
+                        const int imin = std::max(int(mn * 127.0f), -127);
+                        const int imax = std::min(int(mx * 127.0f), 127);
+                        e[ch].min  = imin;
+                        e[ch].max  = imax;
+                        e[ch].peak = std::min(int(std::max(-mn, mx) * 255.0f), 255);
+                        e[ch].rms  = std::min(int(sqrtf(sq / fs) * 255.0f), 255);
+                        }
+                  }
+            pos += n;
+            }
+
+      // The coarser levels, from the level below.
+      for (int l = 1; l < levels; ++l) {
+            const PeakFileEntry* child = entries(l - 1);
+            PeakFileEntry* parent      = entries(l);
+            const sf_count_t mag       = levelMag(l);
+            const int64_t childSize    = _header->levelSize[l - 1];
+            const int64_t pend         = (end + mag - 1) / mag;
+            for (int64_t p = done / mag; p < pend; ++p) {
+                  const int64_t c0 = p * peakFileLevelFactor;
+                  const int64_t c1 = std::min(c0 + peakFileLevelFactor, childSize);
+                  for (unsigned ch = 0; ch < chans; ++ch) {
+                        int mn = 0, mx = 0, pk = 0, sq = 0;
+                        for (int64_t c = c0; c < c1; ++c) {
+                              const PeakFileEntry& ce = child[c * chans + ch];
+                              mn = std::min(mn, int(ce.min));
+                              mx = std::max(mx, int(ce.max));
+                              pk = std::max(pk, int(ce.peak));
+                              sq += int(ce.rms) * int(ce.rms);
+                              }
+                        PeakFileEntry& pe = parent[p * chans + ch];
+                        pe.min  = mn;
+                        pe.max  = mx;
+                        pe.peak = pk;
+                        pe.rms  = c1 > c0 ? std::min(int(sqrtf(float(sq) / (c1 - c0))), 255) : 0;
+                        }
+                  }
+            }
+
+      // Publish the chunk.
+      __atomic_store_n(&_header->framesDone, (int64_t)end, __ATOMIC_RELEASE);
+      return end < frames;
+      }
+
+//---------------------------------------------------------
+//   read
+//---------------------------------------------------------
+
+void PeakFile::read(SampleV* s, int mag, sf_count_t pos, bool overwrite) const
+      {
+      const unsigned chans = _header->channels;
+      int level = 0;
+      sf_count_t step = peakFileBaseMag;
+      while (level + 1 < (int)_header->levels && step * peakFileLevelFactor <= mag) {
+            ++level;
+            step *= peakFileLevelFactor;
+            }
+      sf_count_t n = mag / step;
+      if (n < 1)
+            n = 1;
+
+      // Only what is already built. The rest reads as silence until then.
+      const sf_count_t avail = (framesDone() + step - 1) / step;
+      const sf_count_t first = pos / step;
+      const sf_count_t end   = std::min(first + n, avail);
+      const PeakFileEntry* e = entries(level);
+
+      for (unsigned ch = 0; ch < chans; ++ch) {
+            int rms = 0;
+            for (sf_count_t i = first; i < end; ++i) {
+                  const PeakFileEntry& pe = e[i * chans + ch];
+                  rms += pe.rms;
+                  if (s[ch].peak < pe.peak)
+                        s[ch].peak = pe.peak;
+                  }
+            if (overwrite)
+                  s[ch].rms = rms / n;
+            else
+                  s[ch].rms += rms / n;
+            }
+      }
+
+//---------------------------------------------------------
+//   readBase
+//---------------------------------------------------------
+
+void PeakFile::readBase(SampleV* s, unsigned channel, sf_count_t step, sf_count_t n) const
+      {
+      const unsigned chans = _header->channels;
+      const PeakFileEntry* e = entries(0) + step * chans + channel;
+      for (sf_count_t i = 0; i < n; ++i, e += chans) {
+            s[i].peak = e->peak;
+            s[i].rms  = e->rms;
+            }
+      }
+
+//---------------------------------------------------------
+//   PeakFileBuilder
+//    Background thread building the peak files, one after
+//     the other in the order they were opened.
+//---------------------------------------------------------
+
+class PeakFileBuilder {
+      std::mutex _mutex;
+      std::condition_variable _cond;
+      std::list<std::shared_ptr<PeakFile> > _jobs;
+      pthread_t _thread;
+      bool _running;
+      bool _quit;
+      std::atomic<unsigned> _progress;
+
+      void build(const std::shared_ptr<PeakFile>& pf, QElapsedTimer* lastProgress);
+      static void* loop(void*);
+
+   public:
+      PeakFileBuilder() : _running(false), _quit(false), _progress(0) {}
+      void add(const std::shared_ptr<PeakFile>& pf);
+      void stop();
+      unsigned progress() const { return _progress; }
+      };
+
+static PeakFileBuilder peakFileBuilder;
+
+//---------------------------------------------------------
+//   add
+//---------------------------------------------------------
+
+void PeakFileBuilder::add(const std::shared_ptr<PeakFile>& pf)
+      {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if (_quit)
+            return;
+      if (!_running) {
+            if (pthread_create(&_thread, 0, loop, this)) {
+                  fprintf(stderr, "PeakFileBuilder: cannot create thread: %s\n", strerror(errno));
+                  return;
+                  }
+            _running = true;
+            }
+      _jobs.push_back(pf);
+      _cond.notify_one();
+      }
+
+//---------------------------------------------------------
+//   stop
+//---------------------------------------------------------
+
+void PeakFileBuilder::stop()
+      {
+      {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _quit = true;
+      _jobs.clear();
+      _cond.notify_one();
+      if (!_running)
+            return;
+      }
+      pthread_join(_thread, 0);
+      _running = false;
+      }
+
+//---------------------------------------------------------
+//   build
+//---------------------------------------------------------
+
+void PeakFileBuilder::build(const std::shared_ptr<PeakFile>& pf, QElapsedTimer* lastProgress)
+      {
+      SF_INFO info;
+      memset(&info, 0, sizeof(info));
+      SNDFILE* sf = sf_open(pf->soundPath().toLocal8Bit().constData(), SFM_READ, &info);
+      if (!sf) {
+            fprintf(stderr, "PeakFileBuilder: cannot open %s: %s\n",
+               pf->soundPath().toLocal8Bit().constData(), sf_strerror(0));
+            return;
+            }
+#ifdef PEAKFILE_DEBUG
+      QElapsedTimer timer;
+      timer.start();
+#endif
+      // Stop when nobody but us is interested anymore.
+      while (!pf->isCancelled() && pf.use_count() > 1 && pf->buildChunk(sf)) {
+            {
+            std::lock_guard<std::mutex> guard(_mutex);
+            if (_quit)
+                  break;
+            }
+            // Let the gui redraw the growing waves now and then.
+            if (lastProgress->elapsed() >= 250) {
+                  ++_progress;
+                  lastProgress->restart();
+                  }
+            }
+      sf_close(sf);
+      ++_progress;
+      lastProgress->restart();
+#ifdef PEAKFILE_DEBUG
+      fprintf(stderr, "PeakFileBuilder: %s done in %lld ms\n",
+         pf->soundPath().toLocal8Bit().constData(), (long long)timer.elapsed());
+#endif
+      }
+
+//---------------------------------------------------------
+//   loop
+//---------------------------------------------------------
+
+void* PeakFileBuilder::loop(void* arg)
+      {
+      PeakFileBuilder* b = (PeakFileBuilder*)arg;
+      QElapsedTimer lastProgress;
+      lastProgress.start();
+      for (;;) {
+            std::shared_ptr<PeakFile> pf;
+            {
+            std::unique_lock<std::mutex> lock(b->_mutex);
+            while (!b->_quit && b->_jobs.empty())
+                  b->_cond.wait(lock);
+            if (b->_quit)
+                  break;
+            pf = b->_jobs.front();
+            b->_jobs.pop_front();
+            }
+            if (!pf->isCancelled() && pf.use_count() > 1 && !pf->isComplete())
+                  b->build(pf, &lastProgress);
+            }
+      return 0;
+      }
+
+//---------------------------------------------------------
+//   peakFilePath
+//---------------------------------------------------------
+
+QString peakFilePath(const QString& soundPath)
+      {
+      QFileInfo fi(soundPath);
+      return fi.absolutePath() + QString("/") + fi.completeBaseName() + QString(peakFileSuffix);
+      }
+
+//---------------------------------------------------------
+//   buildPeakFile
+//---------------------------------------------------------
+
+void buildPeakFile(const std::shared_ptr<PeakFile>& pf)
+      {
+      peakFileBuilder.add(pf);
+      }
+
+//---------------------------------------------------------
+//   exitPeakFileBuilder
+//---------------------------------------------------------
+
+void exitPeakFileBuilder()
+      {
+      peakFileBuilder.stop();
+      }
+
+//---------------------------------------------------------
+//   peakFileProgress
+//---------------------------------------------------------
+
+unsigned peakFileProgress()
+      {
+      return peakFileBuilder.progress();
+      }
+
+} // namespace MusECore
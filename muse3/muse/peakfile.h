@@ -0,0 +1,148 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  peakfile.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PEAKFILE_H__
+#define __PEAKFILE_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <sndfile.h>
+
+#include <QString>
+
+namespace MusECore {
+
+struct SampleV;
+
+// Peak files are named like the sound file, with this suffix. Not the old
+//  .wca, which older MusE versions would read as their flat format.
+const char* const peakFileSuffix = ".wcp";
+// Frames per entry of the finest level. Same as the old .wca files.
+const int peakFileBaseMag = 128;
+// Each level has this many times fewer entries than the one below.
+const int peakFileLevelFactor = 8;
+const int peakFileMaxLevels = 5;
+
+//---------------------------------------------------------
+//   PeakFileEntry
+//    Range and rms of the samples of one channel,
+//     over the frames covered by one entry.
+//---------------------------------------------------------
+
+struct PeakFileEntry {
+      int8_t min;             // -127..127
+      int8_t max;             // -127..127
+      uint8_t peak;           // 0..255, the larger of -min and max
+      uint8_t rms;            // 0..255
+      };
+
+//---------------------------------------------------------
+//   PeakFileHeader
+//    The entries of each level follow the header, one
+//     entry per channel for each step, channels interleaved.
+//---------------------------------------------------------
+
+struct PeakFileHeader {
+      char magic[8];          // "MusEPeak"
+      uint32_t version;
+      uint32_t channels;
+      int64_t frames;         // frames of the sound file
+      int64_t sourceTime;     // modification time of the sound file, msecs since epoch
+      int64_t sourceSize;     // size of the sound file in bytes
+      uint32_t baseMag;
+      uint32_t levelFactor;
+      uint32_t levels;
+      uint32_t reserved;
+      // Frames analysed so far, always a multiple of the largest level's
+      //  entry size unless equal to frames. Written with release semantics
+      //  after all entries below it are written.
+      int64_t framesDone;
+      int64_t levelOffset[peakFileMaxLevels]; // byte offset of each level's entries
+      int64_t levelSize[peakFileMaxLevels];   // number of steps of each level
+      };
+
+//---------------------------------------------------------
+//   PeakFile
+//    Memory mapped, multi resolution peak file (.wcp) of
+//     a sound file. Built in chunks by a background thread,
+//     and usable while being built: Anything beyond
+//     framesDone() reads as silence.
+//---------------------------------------------------------
+
+class PeakFile {
+      QString _path;
+      QString _soundPath;
+      int _fd;
+      char* _map;
+      size_t _mapSize;
+      PeakFileHeader* _header;
+      std::atomic<bool> _cancel;
+
+      void unmap();
+      bool create(unsigned channels, sf_count_t frames, int64_t sourceTime, int64_t sourceSize);
+      PeakFileEntry* entries(int level) const {
+            return (PeakFileEntry*)(_map + _header->levelOffset[level]);
+            }
+
+   public:
+      PeakFile(const QString& path, const QString& soundPath);
+      ~PeakFile();
+
+      // Maps the peak file, creating it if it does not exist or does not
+      //  match the sound file anymore. An incomplete file is kept, building
+      //  continues where it left off. Returns true on error.
+      bool open(unsigned channels, sf_count_t frames);
+      bool isOpen() const              { return _header != 0; }
+      const QString& soundPath() const { return _soundPath; }
+
+      unsigned channels() const        { return _header->channels; }
+      sf_count_t frames() const        { return _header->frames; }
+      sf_count_t framesDone() const    { return __atomic_load_n(&_header->framesDone, __ATOMIC_ACQUIRE); }
+      bool isComplete() const          { return framesDone() >= frames(); }
+
+      // Analyses the next chunk of the sound file, sf must be open on it.
+      // Returns false when the file is complete, or on error.
+      bool buildChunk(SNDFILE* sf);
+      // Stops building in the background, for example because the sound file was closed.
+      void cancel()                    { _cancel = true; }
+      bool isCancelled() const         { return _cancel; }
+
+      // Peak and rms of 'mag' frames starting at 'pos', like SndFile::read().
+      // Uses the coarsest level which is still fine enough.
+      void read(SampleV* s, int mag, sf_count_t pos, bool overwrite) const;
+      // The finest level only, for the writable files which keep their peaks in memory.
+      void readBase(SampleV* s, unsigned channel, sf_count_t step, sf_count_t n) const;
+      };
+
+// The peak file of the sound file at soundPath.
+extern QString peakFilePath(const QString& soundPath);
+// Queues the peak file to be built by the background thread.
+extern void buildPeakFile(const std::shared_ptr<PeakFile>& pf);
+// Stops the background thread, at exit.
+extern void exitPeakFileBuilder();
+// Changes whenever the background thread has made visible progress, so that the gui can redraw the waves.
+extern unsigned peakFileProgress();
+
+} // namespace MusECore
+
+#endif
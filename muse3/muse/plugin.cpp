@@ -49,6 +49,7 @@
 #include "slider.h"
 #include "midictrl_consts.h"
 #include "plugin.h"
+#include "plugin_runs.h"
 #include "controlfifo.h"
 #include "xml.h"
 #include "icons.h"
@@ -1203,7 +1204,8 @@ float Pipeline::latency()
   for(int i = 0; i < MusECore::PipelineDepth; ++i)
   {
     p = (*this)[i];
-    if(p)
+    // Bypassed plugins are not run, so they add no latency.
+    if(p && p->on())
       l+= p->latency();
   }
   return l;
@@ -1339,6 +1341,8 @@ void Pipeline::setOn(int idx, bool flag)
       PluginI* p = (*this)[idx];
       if (p) {
             p->setOn(flag);
+            if (p->track())
+                  p->track()->invalidateFreeze();
             if (p->gui())
                   p->gui()->setOn(flag);
             }
@@ -1609,6 +1613,7 @@ void Pipeline::apply(unsigned pos, unsigned long ports, unsigned long nframes, f
 
             if(p)
             {
+              DspTimer dsp_timer(p->dspStats());
               if (p->on())
               {
                 if (!(p->requiredFeatures() & PluginNoInPlaceProcessing))
@@ -1856,6 +1861,14 @@ bool PluginIBase::addScheduledControlEvent(unsigned long i, double val, unsigned
     fprintf(stderr, "PluginIBase::addScheduledControlEvent: fifo overflow: in control number:%lu\n", i);
     return true;
   }
+
+  // A frozen track does not run its plugins, the freeze file has the old value.
+  if(val != param(i))
+  {
+    AudioTrack* t = track();
+    if(t)
+      t->invalidateFreeze();
+  }
   return false;
 }
 
@@ -1940,6 +1953,7 @@ void PluginI::init()
       controlOutPorts   = 0;
       _audioInSilenceBuf = 0;
       _audioOutDummyBuf  = 0;
+      _audioRateCtrls    = 0;
       _hasLatencyOutPort = false;
       _latencyOutPort = 0;
       _on               = true;
@@ -1974,6 +1988,13 @@ PluginI::~PluginI()
         free(_audioInSilenceBuf);
       if(_audioOutDummyBuf)
         free(_audioOutDummyBuf);
+      if(_audioRateCtrls)
+      {
+        for(unsigned long k = 0; k < controlPorts; ++k)
+          if(_audioRateCtrls[k])
+            free(_audioRateCtrls[k]);
+        delete[] _audioRateCtrls;
+      }
 
       if (controlsOutDummy)
             delete[] controlsOutDummy;
@@ -2361,6 +2382,36 @@ bool PluginI::initPluginInstance(Plugin* plug, int c)
           abort();
       }
 #endif
+
+      for(unsigned long k = 0; k < controlPorts; ++k)
+      {
+        if(!_plugin->isAudioRateCtrl(controls[k].idx))
+          continue;
+        if(!_audioRateCtrls)
+        {
+          _audioRateCtrls = new float*[controlPorts];
+          for(unsigned long j = 0; j < controlPorts; ++j)
+            _audioRateCtrls[j] = 0;
+        }
+#ifdef _WIN32
+        _audioRateCtrls[k] = (float *) _aligned_malloc(16, sizeof(float) * MusEGlobal::segmentSize);
+        if(_audioRateCtrls[k] == NULL)
+        {
+           fprintf(stderr, "ERROR: PluginI::initPluginInstance: _audioRateCtrls _aligned_malloc returned error: NULL. Aborting!\n");
+           abort();
+        }
+#else
+        rv = posix_memalign((void **)&_audioRateCtrls[k], 16, sizeof(float) * MusEGlobal::segmentSize);
+        if(rv != 0)
+        {
+            fprintf(stderr, "ERROR: PluginI::initPluginInstance: _audioRateCtrls posix_memalign returned error:%d. Aborting!\n", rv);
+            abort();
+        }
+#endif
+        for(unsigned q = 0; q < MusEGlobal::segmentSize; ++q)
+          _audioRateCtrls[k][q] = controls[k].val;
+      }
+
       activate();
       return false;
       }
@@ -2397,6 +2448,14 @@ void PluginI::connect(unsigned long ports, unsigned long offset, float** src, fl
                         }
                   }
             }
+      if (_audioRateCtrls) {
+            for (unsigned long k = 0; k < controlPorts; ++k) {
+                  if (_audioRateCtrls[k]) {
+                        for (int i = 0; i < instances; ++i)
+                              _plugin->connectPort(handle[i], controls[k].idx, _audioRateCtrls[k] + offset);
+                        }
+                  }
+            }
       }
 
 //---------------------------------------------------------
@@ -2855,6 +2914,44 @@ QString PluginI::titlePrefix() const
   else return ":";
 }
 
+//---------------------------------------------------------
+//   fillAudioRateCtrl
+//   Fills the per sample buffer of audio rate control port k with
+//    n frames of automation starting at sample, following the
+//    controller cl from one segment to the next.
+//---------------------------------------------------------
+
+void PluginI::fillAudioRateCtrl(unsigned long k, CtrlList* cl, unsigned pos, unsigned long sample, unsigned long n, bool no_auto)
+{
+  float* buf = _audioRateCtrls[k] + sample;
+  CtrlInterpolate& ci = controls[k].interp;
+
+  if(!cl || !MusEGlobal::audio->isPlaying())
+  {
+    const float val = (ci.doInterp && cl) ? cl->interpolate(pos, ci) : ci.sVal;
+    for(unsigned long i = 0; i < n; ++i)
+      buf[i] = val;
+    controls[k].val = val;
+    return;
+  }
+
+  unsigned long i = 0;
+  while(true)
+  {
+    const unsigned long frame = pos + sample + i;
+    unsigned long len = n - i;
+    if(ci.eFrameValid && (unsigned long)ci.eFrame > frame && (unsigned long)ci.eFrame - frame < len)
+      len = (unsigned long)ci.eFrame - frame;
+    cl->interpolateBuffer(frame, len, ci, buf + i);
+    i += len;
+    // Values set from outside (eStop) are taken care of by the next run.
+    if(i >= n || ci.eStop)
+      break;
+    cl->getInterpolation(pos + sample + i, no_auto || !controls[k].enCtrl, &ci);
+  }
+  controls[k].val = buf[n - 1];
+}
+
 //---------------------------------------------------------
 //   apply
 //   If ports is 0, just process controllers only, not audio (do not 'run').
@@ -2873,7 +2970,6 @@ void PluginI::apply(unsigned pos, unsigned long n, unsigned long ports, float**
   // TODO: We could later add slower processing over several cycles -
   //  so that users can select a small audio period but a larger control period.
   const unsigned long min_per = (usefixedrate || MusEGlobal::config.minControlProcessPeriod > n) ? n : MusEGlobal::config.minControlProcessPeriod;
-  const unsigned long min_per_mask = min_per-1;   // min_per must be power of 2
 
   AutomationType at = AUTO_OFF;
   CtrlListList* cll = NULL;
@@ -2896,6 +2992,8 @@ void PluginI::apply(unsigned pos, unsigned long n, unsigned long ports, float**
   while(sample < n)
   {
     unsigned long nsamp = n - sample;
+    // How far boundRunFrames() may lengthen this run.
+    unsigned long longest = n - sample;
     const unsigned long slice_frame = pos + sample;
 
     // Process automation control values, while also determining the maximum acceptable
@@ -2909,13 +3007,19 @@ void PluginI::apply(unsigned pos, unsigned long n, unsigned long ports, float**
       for(unsigned long k = 0; k < controlPorts; ++k)
       {
         CtrlList* cl = (cll && _id != -1 && icl != cll->end()) ? icl->second : NULL;
+        // The controller of this port, if any.
+        CtrlList* kcl = (cl && (unsigned long)cl->id() == genACnum(_id, k)) ? cl : NULL;
         CtrlInterpolate& ci = controls[k].interp;
+        // Audio rate ports get the whole rest of the cycle filled at once, so they only
+        //  need refilling when their values were changed from outside.
+        const bool audio_rate = _audioRateCtrls && _audioRateCtrls[k];
+        bool refill = false;
         // Always refresh the interpolate struct at first, since things may have changed.
         // Or if the frame is outside of the interpolate range - and eStop is not true.  // FIXME TODO: Be sure these comparisons are correct.
-        if(cur_slice == 0 || (!ci.eStop && MusEGlobal::audio->isPlaying() &&
+        if(cur_slice == 0 || (!audio_rate && !ci.eStop && MusEGlobal::audio->isPlaying() &&
             (slice_frame < (unsigned long)ci.sFrame || (ci.eFrameValid && slice_frame >= (unsigned long)ci.eFrame)) ) )
         {
-          if(cl && _id != -1 && (unsigned long)cl->id() == genACnum(_id, k))
+          if(kcl)
           {
             cl->getInterpolation(slice_frame, no_auto || !controls[k].enCtrl, &ci);
             if(icl != cll->end())
@@ -2934,6 +3038,7 @@ void PluginI::apply(unsigned pos, unsigned long n, unsigned long ports, float**
             ci.doInterp = false;
             ci.eStop    = false;
           }
+          refill = true;
         }
         else
         {
@@ -2946,36 +3051,47 @@ void PluginI::apply(unsigned pos, unsigned long n, unsigned long ports, float**
             ci.sVal     = ci.eVal;
             ci.doInterp = false;
             ci.eStop    = false;
+            refill = true;
           }
           if(cl && cll && icl != cll->end())
             ++icl;
         }
 
-        if(!usefixedrate && MusEGlobal::audio->isPlaying())
+        if(audio_rate)
         {
-          unsigned long samps = nsamp;
-          if(ci.eFrameValid)
-            samps = (unsigned long)ci.eFrame - slice_frame;
-
-          if(!ci.doInterp && samps > min_per)
+          // Does not limit the size of the run.
+          if(refill)
+            fillAudioRateCtrl(k, kcl, pos, sample, n - sample, no_auto);
+        }
+        else
+        {
+          if(!usefixedrate && MusEGlobal::audio->isPlaying())
           {
-            samps &= ~min_per_mask;
-            if((samps & min_per_mask) != 0)
-              samps += min_per;
+            const bool ramp = ci.doInterp && kcl;
+            const unsigned long to_end = (unsigned long)ci.eFrame - slice_frame;
+            // With the next point less than two min_per away, the run is min_per long anyway.
+            const unsigned long ramp_frames = (ramp && !(ci.eFrameValid && to_end < 2 * min_per)) ?
+                  kcl->rampFrames(slice_frame, ci, pluginCtrlRampSteps) : 0;
+            const unsigned long samps = ctrlRunFrames(nsamp, ramp, ramp_frames, ci.eFrameValid, to_end, min_per);
+
+            if(samps < nsamp)
+              nsamp = samps;
+
+            // Dense automation keeps the runs on the min_per grid, see boundRunFrames().
+            if(longest > min_per)
+            {
+              const unsigned long most = longestRunFrames(n - sample, ramp, ramp_frames, ci.eFrameValid, to_end, min_per);
+              if(most < longest)
+                longest = most;
+            }
           }
-          else
-            samps = min_per;
-
-          if(samps < nsamp)
-            nsamp = samps;
 
+          if(ci.doInterp && cl)
+            controls[k].val = cl->interpolate(MusEGlobal::audio->isPlaying() ? slice_frame : pos, ci);
+          else
+            controls[k].val = ci.sVal;
         }
 
-        if(ci.doInterp && cl)
-          controls[k].val = cl->interpolate(MusEGlobal::audio->isPlaying() ? slice_frame : pos, ci);
-        else
-          controls[k].val = ci.sVal;
-
 #ifdef LV2_SUPPORT
         if(_plugin->isLV2Plugin())
         {
@@ -2992,6 +3108,10 @@ void PluginI::apply(unsigned pos, unsigned long n, unsigned long ports, float**
         printf("PluginI::apply k:%lu sample:%lu frame:%lu nextFrame:%d nsamp:%lu \n", k, sample, frame, ci.eFrame, nsamp);
 #endif
       }
+
+      // Dense automation on many ports could still make lots of tiny runs.
+      if(!usefixedrate && MusEGlobal::audio->isPlaying())
+        nsamp = boundRunFrames(nsamp, longest, n - sample, cur_slice, min_per);
     }
 
 #ifdef PLUGIN_DEBUGIN_PROCESS
@@ -4134,6 +4254,8 @@ void PluginGui::bypassToggled(bool val)
       {
       setWindowTitle(plugin->titlePrefix() + plugin->name());
       plugin->setOn(val);
+      if (plugin->track())
+            plugin->track()->invalidateFreeze();
       MusEGlobal::song->update(SC_ROUTE);
       }
 
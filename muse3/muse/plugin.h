@@ -45,6 +45,7 @@
 #include "ctrl.h"
 #include "controlfifo.h"
 #include "plugin_list.h"
+#include "dsp_stats.h"
 
 #include "config.h"
 
@@ -203,6 +204,9 @@ class Plugin {
       virtual void range(unsigned long i, float*, float*) const;
       virtual CtrlValueType ctrlValueType(unsigned long i) const;
       virtual CtrlList::Mode ctrlMode(unsigned long i) const;
+      // Whether the control input port takes a buffer of one value per sample (LV2 CV ports),
+      //  so that automation can be passed sample accurately without splitting the run.
+      virtual bool isAudioRateCtrl(unsigned long /*port*/) const { return false; }
 
       virtual const char* portName(unsigned long i) {
             return plugin ? plugin->PortNames[i] : 0;
@@ -410,6 +414,7 @@ class PluginI : public PluginIBase {
 
       float *_audioInSilenceBuf; // Just all zeros all the time, so we don't have to clear for silence.
       float *_audioOutDummyBuf;  // A place to connect unused outputs.
+      float **_audioRateCtrls;   // Per control port: one value per sample for audio rate ports, else null. Null if there are none.
       
       bool _on;
       bool initControlValues;
@@ -420,8 +425,11 @@ class PluginI : public PluginIBase {
       OscEffectIF _oscif;
       #endif
       bool _showNativeGuiPending;
+      // Time spent in apply() each cycle.
+      DspTimeStats _dspStats;
 
       void init();
+      void fillAudioRateCtrl(unsigned long k, CtrlList* cl, unsigned pos, unsigned long sample, unsigned long n, bool no_auto);
 
    public:
       PluginI();
@@ -440,6 +448,7 @@ class PluginI : public PluginIBase {
       void setID(int i);
       int id()                      { return _id; }
       void updateControllers();
+      DspTimeStats* dspStats()      { return &_dspStats; }
 
       bool initPluginInstance(Plugin*, int channels);
       void setChannels(int);
@@ -0,0 +1,160 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  plugin_runs.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PLUGIN_RUNS_H__
+#define __PLUGIN_RUNS_H__
+
+#include <math.h>
+
+// How PluginI::apply() splits a process cycle into plugin runs when control
+//  ports are automated. Kept free of the rest of MusE so that
+//  sandbox/muse_automation_bench can measure the very same planning.
+
+namespace MusECore {
+
+// During an automation ramp, a plugin without per sample control ports is run
+//  again once the value has moved by 1/pluginCtrlRampSteps of the controller's range.
+const double pluginCtrlRampSteps = 1024.0;
+// Runs of a plugin per cycle that automation may cause before runs are lengthened.
+const int pluginCtrlMaxSlices = 16;
+// A run lengthened to stay within pluginCtrlMaxSlices may not let a ramping value
+//  move by more than 1/pluginCtrlLongestRunSteps of the controller's range, nor skip
+//  an automation point. Dense automation makes more runs rather than inaccurate ones.
+const double pluginCtrlLongestRunSteps = 256.0;
+
+//---------------------------------------------------------
+//   rampStepFrames
+//   Returns how many frames after frame a ramp from sVal at sFrame
+//    to eVal at eFrame has moved by range/steps, at most up to eFrame.
+//---------------------------------------------------------
+
+inline unsigned long rampStepFrames(unsigned long frame, unsigned long sFrame, unsigned long eFrame,
+                                    double sVal, double eVal, double range, double steps)
+{
+  if(frame >= eFrame)
+    return 0;
+  const unsigned long left = eFrame - frame;
+  if(eFrame <= sFrame)
+    return left;
+  const double change = fabs(eVal - sVal);
+  if(change == 0.0 || range <= 0.0)
+    return left;
+  const double frames = (range / steps) * double(eFrame - sFrame) / change;
+  if(frames >= double(left))
+    return left;
+  return (unsigned long)frames;
+}
+
+//---------------------------------------------------------
+//   ctrlRunFrames
+//   How long a run starting now may be, as far as one control
+//    port without per sample input is concerned.
+//   nsamp: Frames left in the cycle.
+//   ramp: The port is on an automation ramp, ramp_frames is
+//    its rampStepFrames().
+//   end_valid, to_end: Frames to the next automation point.
+//   min_per: The minimum control period, a power of two.
+//---------------------------------------------------------
+
+inline unsigned long ctrlRunFrames(unsigned long nsamp, bool ramp, unsigned long ramp_frames,
+                                   bool end_valid, unsigned long to_end, unsigned long min_per)
+{
+  const unsigned long min_per_mask = min_per-1;
+  unsigned long samps = end_valid ? to_end : nsamp;
+  if(ramp)
+  {
+    // Run again once the value has moved noticeably, rather than every min_per.
+    samps = ramp_frames & ~min_per_mask;
+    if(samps < min_per)
+      samps = min_per;
+  }
+  else if(samps > min_per)
+  {
+    samps &= ~min_per_mask;
+    if((samps & min_per_mask) != 0)
+      samps += min_per;
+  }
+  else
+    samps = min_per;
+  return samps;
+}
+
+//---------------------------------------------------------
+//   longestRunFrames
+//   How long a run starting now may be lengthened to, as far as
+//    one control port without per sample input is concerned.
+//    Takes the same arguments as ctrlRunFrames(), ramp_frames
+//    being the rampStepFrames() for pluginCtrlRampSteps, and
+//    scales those to pluginCtrlLongestRunSteps.
+//   left: Frames left in the cycle.
+//---------------------------------------------------------
+
+inline unsigned long longestRunFrames(unsigned long left, bool ramp, unsigned long ramp_frames,
+                                      bool end_valid, unsigned long to_end, unsigned long min_per)
+{
+  if(ramp && end_valid)
+  {
+    const double frames = double(ramp_frames) * (pluginCtrlRampSteps / pluginCtrlLongestRunSteps);
+    ramp_frames = frames >= double(to_end) ? to_end : (unsigned long)frames;
+  }
+  return ctrlRunFrames(left, ramp, ramp_frames, end_valid, to_end, min_per);
+}
+
+//---------------------------------------------------------
+//   boundRunFrames
+//   Dense automation on many ports could still make lots of tiny
+//    runs. Bounds the number of runs per cycle by spreading what is
+//    left of the cycle evenly over the remaining runs, on the min_per
+//    grid, once the budget of pluginCtrlMaxSlices gets tight.
+//   A run is never lengthened beyond longest, so the budget is
+//    exceeded rather than the control values getting inaccurate.
+//   nsamp: The run length the ports asked for.
+//   longest: The run length the ports allow, the smallest of their
+//    longestRunFrames(). Nothing is lengthened once that is down to
+//    min_per: the runs then stay on the min_per grid, as they always
+//    did, and the callers need not work out longest any further.
+//   left: Frames left in the cycle.
+//   cur_slice: Number of runs done so far in this cycle.
+//---------------------------------------------------------
+
+inline unsigned long boundRunFrames(unsigned long nsamp, unsigned long longest, unsigned long left,
+                                    int cur_slice, unsigned long min_per)
+{
+  unsigned long least = left;
+  if(cur_slice < pluginCtrlMaxSlices - 1)
+  {
+    const unsigned long min_per_mask = min_per-1;
+    const unsigned long slices_left = pluginCtrlMaxSlices - cur_slice;
+    least = ((left + slices_left - 1) / slices_left + min_per_mask) & ~min_per_mask;
+  }
+  if(least > longest)
+    least = longest;
+  if(nsamp < least)
+    nsamp = least;
+  if(nsamp > left)
+    nsamp = left;
+  return nsamp;
+}
+
+} // namespace MusECore
+
+#endif
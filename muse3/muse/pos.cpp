@@ -454,15 +454,15 @@ void Pos::read(Xml& xml, const char* name)
 
                   case Xml::Attribut:
                         if (tag == "tick") {
-                              _tick = xml.s2().toInt();
+                              _tick = xml.s2Int();
                               _type = TICKS;
                               }
                         else if (tag == "frame") {
-                              _frame = xml.s2().toInt();
+                              _frame = xml.s2Int();
                               _type = FRAMES;
                               }
                         else if (tag == "sample") {   // obsolete
-                              _frame = xml.s2().toInt();
+                              _frame = xml.s2Int();
                               _type = FRAMES;
                               }
                         else
@@ -576,14 +576,14 @@ void PosLen::read(Xml& xml, const char* name)
                   case Xml::Attribut:
                         if (tag == "tick") {
                               setType(TICKS);
-                              setTick(xml.s2().toInt());
+                              setTick(xml.s2Int());
                               }
                         else if (tag == "sample") {
                               setType(FRAMES);
-                              setFrame(xml.s2().toInt());
+                              setFrame(xml.s2Int());
                               }
                         else if (tag == "len") {
-                              int n = xml.s2().toInt();
+                              int n = xml.s2Int();
                               switch(type()) {
                                     case TICKS:
                                           setLenTick(n);
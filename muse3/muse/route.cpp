@@ -1625,8 +1625,8 @@ void Route::read(Xml& xml)
       
       for (;;) 
       {
-            const QString& tag = xml.s1();
             Xml::Token token = xml.parse();
+            const QString& tag = xml.s1();
             switch (token) 
             {
                   case Xml::Error:
@@ -1757,8 +1757,8 @@ void Song::readRoute(Xml& xml)
       
       for (;;) 
       {
-            const QString& tag = xml.s1();
             Xml::Token token = xml.parse();
+            const QString& tag = xml.s1();
             switch (token) 
             {
                   case Xml::Error:
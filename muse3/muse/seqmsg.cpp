@@ -35,6 +35,7 @@
 #include "audio.h"
 #include "mididev.h"
 #include "audiodev.h"
+#include "audiograph.h"
 #include "alsamidi.h"
 #include "audio.h"
 #include "arranger.h"
@@ -44,9 +45,259 @@
 #include "gconfig.h"
 #include "operations.h"
 #include "ctrl.h"
+#include "freeze.h"
 
 namespace MusECore {
 
+//---------------------------------------------------------
+//   isSelfContained
+//    Whether the message carries all it needs and only
+//     touches state the audio thread owns, or changes anyway
+//     while the gui reads it, like the aux levels and the
+//     hardware controller states. The sender does not wait
+//     for these. Not the ones whose msg function does more
+//     work once they were processed, like msgAddRoute()
+//     connecting the Jack ports, and not the automation list
+//     edits, solo and automation type updates, which change
+//     lists and counts the gui reads without a lock.
+//---------------------------------------------------------
+
+static bool isSelfContained(int id)
+      {
+      switch (id) {
+            case AUDIO_SET_PREFADER:
+            case AUDIO_SET_SEND_METRONOME:
+            case SEQM_SET_AUX:
+            case SEQM_SET_HW_CTRL_STATE:
+            case SEQM_SET_HW_CTRL_STATES:
+            case SEQM_PLAY_MIDI_EVENT:      // The event is copied.
+            case SEQM_MIDI_LOCAL_OFF:
+            case SEQM_PANIC:
+            case SEQM_RESET_DEVICES:
+            case SEQM_INIT_DEVICES:
+                  return true;
+            default:
+                  return false;
+            }
+      }
+
+//---------------------------------------------------------
+//   coalesceKey
+//    Returns false if the message does not just set a
+//     value which a newer message can replace.
+//---------------------------------------------------------
+
+static bool coalesceKey(const AudioMsg& m, AudioMsgKey& key)
+      {
+      key.id  = m.id;
+      key.obj = 0;
+      key.idx = 0;
+      switch (m.id) {
+            case SEQM_SET_AUX:
+                  key.obj = m.snode;
+                  key.idx = m.ival;
+                  return true;
+            case AUDIO_SET_PREFADER:
+            case AUDIO_SET_SEND_METRONOME:
+                  key.obj = m.snode;
+                  return true;
+            default:
+                  return false;
+            }
+      }
+
+//---------------------------------------------------------
+//   appendMsg
+//    Within one batch an older message with the same key
+//     is dropped, the new one goes to the end.
+//---------------------------------------------------------
+
+static void appendMsg(AsyncAudioMsg* am, const AudioMsg& m)
+      {
+      AudioMsgKey key;
+      if (coalesceKey(m, key)) {
+            for (std::vector<AudioMsg>::iterator i = am->msgs.begin(); i != am->msgs.end(); ++i) {
+                  AudioMsgKey k;
+                  if (coalesceKey(*i, k) && !(k < key) && !(key < k)) {
+                        am->msgs.erase(i);
+                        break;
+                        }
+                  }
+            }
+      am->msgs.push_back(m);
+      if (m.id == SEQM_PLAY_MIDI_EVENT) {
+            am->events.push_back(*(const MidiPlayEvent*)m.p1);
+            am->msgs.back().p1 = &am->events.back();
+            }
+      }
+
+//---------------------------------------------------------
+//   postMsg
+//---------------------------------------------------------
+
+void Audio::postMsg(const AudioMsg& m, AudioMsgDoneFunc done, void* doneArg)
+      {
+      if (!isSelfContained(m.id)) {
+            fprintf(stderr, "Audio::postMsg: message %d must be sent\n", m.id);
+            AudioMsg sm = m;
+            sendMsg(&sm);
+            if (done)
+                  (*done)(doneArg, false);
+            return;
+            }
+      if (_msgBatchLevel > 0) {
+            if (!_msgBatch)
+                  _msgBatch = new AsyncAudioMsg;
+            appendMsg(_msgBatch, m);
+            if (done)
+                  _msgBatch->done.push_back(std::make_pair(done, doneArg));
+            // A batch runs in one cycle, a full one goes now.
+            if (_msgBatch->msgs.size() >= asyncMsgsPerCycle)
+                  flushMsgBatch();
+            return;
+            }
+      AsyncAudioMsg* am = new AsyncAudioMsg;
+      appendMsg(am, m);
+      if (done)
+            am->done.push_back(std::make_pair(done, doneArg));
+      postAsyncMsg(am);
+      }
+
+//---------------------------------------------------------
+//   postAsyncMsg
+//---------------------------------------------------------
+
+void Audio::postAsyncMsg(AsyncAudioMsg* am)
+      {
+      // Reclaim what the audio thread is done with, and
+      //  wait for it to catch up if the rings are full.
+      processAsyncMsgsDone();
+      if (_asyncMsgsInFlight >= asyncMsgCapacity)
+            waitAsyncMsgs();
+
+      AudioMsgKey key;
+      if (am->msgs.size() == 1 && coalesceKey(am->msgs.front(), key)) {
+            std::map<AudioMsgKey, AsyncAudioMsg*>::iterator i = _coalescable.find(key);
+            if (i != _coalescable.end())
+                  i->second->superseded.store(true);
+            _coalescable[key] = am;
+            }
+
+      ++_asyncMsgsInFlight;
+      _asyncMsgs.put(am);
+
+      // If audio is not running (during initialization)
+      //  process it immediately, as sendMsg() does.
+      if (!_running)
+            waitAsyncMsgs();
+      }
+
+//---------------------------------------------------------
+//   beginMsgBatch
+//---------------------------------------------------------
+
+void Audio::beginMsgBatch()
+      {
+      ++_msgBatchLevel;
+      }
+
+//---------------------------------------------------------
+//   endMsgBatch
+//---------------------------------------------------------
+
+void Audio::endMsgBatch(bool wait, AudioMsgDoneFunc done, void* doneArg)
+      {
+      if (_msgBatchLevel <= 0) {
+            fprintf(stderr, "Audio::endMsgBatch: no batch open\n");
+            return;
+            }
+      if (done) {
+            if (!_msgBatch)
+                  _msgBatch = new AsyncAudioMsg;
+            _msgBatch->done.push_back(std::make_pair(done, doneArg));
+            }
+      if (--_msgBatchLevel > 0)
+            return;
+
+      AsyncAudioMsg* am = _msgBatch;
+      _msgBatch = 0;
+      if (!am)
+            return;
+      if (am->msgs.empty()) {
+            // Nothing for the audio thread to do.
+            for (std::vector<std::pair<AudioMsgDoneFunc, void*> >::iterator i = am->done.begin(); i != am->done.end(); ++i)
+                  (*i->first)(i->second, false);
+            delete am;
+            return;
+            }
+      // Without audio running, postAsyncMsg() processes it.
+      const bool waitPipe = wait && _running;
+      am->wakeSender = waitPipe;
+      postAsyncMsg(am);
+      if (!waitPipe)
+            return;
+
+      // Wait for this batch only, not for a cycle of its own.
+      int no = 0;
+      int rv = read(fromThreadFdr, &no, sizeof(int));
+      if (rv != sizeof(int))
+            perror("Audio: read pipe failed");
+      else if (no != asyncMsgDoneSerial)
+            fprintf(stderr, "audio: bad serial number, read %d expected batch\n", no);
+      processAsyncMsgsDone();
+      }
+
+//---------------------------------------------------------
+//   flushMsgBatch
+//    Posts the messages collected so far.
+//---------------------------------------------------------
+
+void Audio::flushMsgBatch()
+      {
+      AsyncAudioMsg* am = _msgBatch;
+      _msgBatch = 0;
+      if (am)
+            postAsyncMsg(am);
+      }
+
+//---------------------------------------------------------
+//   waitAsyncMsgs
+//---------------------------------------------------------
+
+void Audio::waitAsyncMsgs()
+      {
+      if (_running)
+            // The audio thread processes the posted ones before it.
+            msgAudioWait();
+      else
+            processAsyncMsgs(true);
+      processAsyncMsgsDone();
+      }
+
+//---------------------------------------------------------
+//   processAsyncMsgsDone
+//    Called on the 'A' from the audio thread, and before
+//     posting new messages.
+//---------------------------------------------------------
+
+void Audio::processAsyncMsgsDone()
+      {
+      _asyncMsgsSignalled.store(false);
+      AsyncAudioMsg* am;
+      while (_asyncMsgsDone.get(am)) {
+            --_asyncMsgsInFlight;
+            AudioMsgKey key;
+            if (am->msgs.size() == 1 && coalesceKey(am->msgs.front(), key)) {
+                  std::map<AudioMsgKey, AsyncAudioMsg*>::iterator i = _coalescable.find(key);
+                  if (i != _coalescable.end() && i->second == am)
+                        _coalescable.erase(i);
+                  }
+            for (std::vector<std::pair<AudioMsgDoneFunc, void*> >::iterator i = am->done.begin(); i != am->done.end(); ++i)
+                  (*i->first)(i->second, !am->executed);
+            delete am;
+            }
+      }
+
 //---------------------------------------------------------
 //   sendMsg
 //---------------------------------------------------------
@@ -56,6 +307,19 @@ void Audio::sendMsg(AudioMsg* m)
       {
       static int sno = 0;
 
+      if (_msgBatchLevel > 0) {
+            if (isSelfContained(m->id)) {
+                  if (!_msgBatch)
+                        _msgBatch = new AsyncAudioMsg;
+                  appendMsg(_msgBatch, *m);
+                  if (_msgBatch->msgs.size() >= asyncMsgsPerCycle)
+                        flushMsgBatch();
+                  return;
+                  }
+            // Keep the order, the batch goes first.
+            flushMsgBatch();
+            }
+
       if (_running) {
             m->serialNo = sno++;
             //DEBUG:
@@ -75,6 +339,9 @@ void Audio::sendMsg(AudioMsg* m)
             // process commands immediately
             processMsg(m);
             }
+      // The message may have changed tracks or routes.
+      if (MusEGlobal::audioGraph)
+            MusEGlobal::audioGraph->update();
       }
 
 //---------------------------------------------------------
@@ -425,15 +692,20 @@ void Audio::msgEraseRangeACEvents(AudioTrack* node, int acid, unsigned int frame
 
 void Audio::msgChangeACEvent(AudioTrack* node, int acid, int frame, int newFrame, double val)
 {
-      AudioMsg msg;
-      
-      msg.id     = AUDIO_CHANGE_AC_EVENT;
-      msg.snode  = node;
-      msg.ival   = acid;
-      msg.a      = frame; 
-      msg.b      = newFrame; 
-      msg.dval   = val;
-      sendMsg(&msg);
+  ciCtrlList icl = node->controller()->find(acid);
+  if(icl == node->controller()->end())
+    return;
+  CtrlList* cl = icl->second;
+
+  // As an operation rather than an AUDIO_CHANGE_AC_EVENT message, so that
+  //  the flat copy of the list is rebuilt without allocating in the audio thread.
+  PendingOperationList operations;
+  iCtrl ic = cl->find(frame);
+  if(ic != cl->end())
+    operations.add(PendingOperationItem(cl, ic, newFrame, val, PendingOperationItem::ModifyAudioCtrlVal));
+  else
+    operations.add(PendingOperationItem(cl, newFrame, val, PendingOperationItem::AddAudioCtrlVal));
+  msgExecutePendingOperations(operations, true);
 }
 
 //---------------------------------------------------------
@@ -729,7 +1001,8 @@ void Audio::msgSetAux(AudioTrack* track, int idx, double val)
       msg.snode = track;
       msg.ival  = idx;
       msg.dval  = val;
-      sendMessage(&msg, false);
+      // Knob drags send lots of these, do not wait for each.
+      postMsg(msg);
       }
 
 //---------------------------------------------------------
@@ -741,7 +1014,9 @@ void Audio::msgPlayMidiEvent(const MidiPlayEvent* event)
       AudioMsg msg;
       msg.id = SEQM_PLAY_MIDI_EVENT;
       msg.p1 = event;
-      sendMessage(&msg, false);
+      invalidateSynthFreeze(*event);
+      // The event is copied, the caller need not wait.
+      postMsg(msg);
       }
 
 //---------------------------------------------------------
@@ -801,6 +1076,39 @@ void Audio::msgSetSendMetronome(AudioTrack* track, bool b)
       sendMessage(&msg, false);
 }
 
+//---------------------------------------------------------
+//   msgSetFreeze
+//    Plays the track from the given freeze file, or runs
+//     it normally again if null. The caller keeps its own
+//     reference to the old file, so that it is not deleted
+//     in the audio thread.
+//---------------------------------------------------------
+
+void Audio::msgSetFreeze(AudioTrack* track, const SndFileR& sf)
+{
+      AudioMsg msg;
+      msg.id    = AUDIO_SET_FREEZE;
+      msg.snode = track;
+      msg.p1    = &sf;
+      sendMessage(&msg, false);
+}
+
+//---------------------------------------------------------
+//   msgSetFreezeCapture
+//    Starts writing the track's output to the file while
+//     bouncing, or stops it if null. As with msgSetFreeze()
+//     the caller keeps its own reference to the file.
+//---------------------------------------------------------
+
+void Audio::msgSetFreezeCapture(AudioTrack* track, const SndFileR& sf)
+{
+      AudioMsg msg;
+      msg.id    = AUDIO_SET_FREEZE_CAPTURE;
+      msg.snode = track;
+      msg.p1    = &sf;
+      sendMessage(&msg, false);
+}
+
 //---------------------------------------------------------
 //   msgStartMidiLearn
 //    Start learning midi 
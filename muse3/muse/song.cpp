@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <iostream>
+#include <set>
 
 #include <QAction>
 #include <QDir>
@@ -56,6 +57,9 @@
 #include "amixer.h"
 #include "midiseq.h"
 #include "audiodev.h"
+#include "audiograph.h"
+#include "packed_events.h"
+#include "latency_compensator.h"
 #include "gconfig.h"
 #include "sync.h"
 #include "midictrl.h"
@@ -70,6 +74,7 @@
 #endif
 #include "tempo.h"
 #include "route.h"
+#include "freeze.h"
 #include "strntcpy.h"
 
 // Undefine if and when multiple output routes are added to midi tracks.
@@ -1709,6 +1714,94 @@ void Song::normalizeWaveParts(Part *partCursor)
    }
 }
 
+//---------------------------------------------------------
+//   updatePackedEvents
+//---------------------------------------------------------
+
+void Song::updatePackedEvents()
+      {
+      for(ciMidiTrack it = _midis.begin(); it != _midis.end(); ++it)
+      {
+        PartList* pl = (*it)->parts();
+        for(ciPart ip = pl->begin(); ip != pl->end(); ++ip)
+          static_cast<MidiPart*>(ip->second)->updatePackedEvents();
+      }
+
+      if(!MusEGlobal::debugMsg)
+        return;
+      // Memory used by the packed copies, on top of the event lists. Copies shared
+      //  by clones are counted once. Reported when it changes.
+      static size_t lastBytes = 0;
+      std::set<const PackedMidiEvents*> copies;
+      size_t events = 0, bytes = 0;
+      for(ciMidiTrack it = _midis.begin(); it != _midis.end(); ++it)
+      {
+        PartList* pl = (*it)->parts();
+        for(ciPart ip = pl->begin(); ip != pl->end(); ++ip)
+        {
+          const PackedMidiEvents* packed = static_cast<MidiPart*>(ip->second)->packedEvents();
+          if(packed && copies.insert(packed).second)
+          {
+            events += packed->sourceSize();
+            bytes += packed->memoryUsage();
+          }
+        }
+      }
+      if(bytes != lastBytes)
+      {
+        lastBytes = bytes;
+        fprintf(stderr, "Song::updatePackedEvents: %zu packed copies of %zu events, about %zu KiB\n",
+                copies.size(), events, bytes / 1024);
+      }
+      }
+
+//---------------------------------------------------------
+//   updateLatencyCompensators
+//    Called from gui thread only, from the heartbeat.
+//---------------------------------------------------------
+
+void Song::updateLatencyCompensators()
+      {
+      if (!MusEGlobal::config.latencyCompensation)
+            return;
+
+      std::vector<MusECore::AudioTrack::InRouteLatencyCompList*> old_lists;
+      for (MusECore::ciTrack it = _tracks.begin(); it != _tracks.end(); ++it) {
+            if ((*it)->isMidiTrack())
+                  continue;
+            MusECore::AudioTrack* track = static_cast<MusECore::AudioTrack*>(*it);
+            MusECore::AudioTrack::InRouteLatencyCompList* old_list = track->updateLatencyCompensators();
+            if (!old_list)
+                  continue;
+            // Only the delay lines which were not carried over belong to the old list.
+            const MusECore::AudioTrack::InRouteLatencyCompList* new_list = track->latencyCompensators();
+            for (MusECore::AudioTrack::InRouteLatencyCompList::iterator i = old_list->begin(); i != old_list->end(); ) {
+                  bool kept = false;
+                  for (MusECore::AudioTrack::InRouteLatencyCompList::const_iterator k = new_list->begin(); k != new_list->end(); ++k) {
+                        if (k->compensator == i->compensator) {
+                              kept = true;
+                              break;
+                              }
+                        }
+                  if (kept)
+                        i = old_list->erase(i);
+                  else
+                        ++i;
+                  }
+            old_lists.push_back(old_list);
+            }
+      if (old_lists.empty())
+            return;
+
+      // The audio thread may still be using the old lists during the current cycle.
+      MusEGlobal::audio->msgAudioWait();
+      for (std::vector<MusECore::AudioTrack::InRouteLatencyCompList*>::iterator il = old_lists.begin(); il != old_lists.end(); ++il) {
+            for (MusECore::AudioTrack::InRouteLatencyCompList::iterator i = (*il)->begin(); i != (*il)->end(); ++i)
+                  delete i->compensator;
+            delete *il;
+            }
+      }
+
 //---------------------------------------------------------
 //   beat
 //---------------------------------------------------------
@@ -1740,10 +1833,19 @@ void Song::beat()
         _fDspLoad = MusEGlobal::audioDevice->getDSP_Load();
       _xRunsCount = MusEGlobal::audio->getXruns();
 
+      // Rebuild the parallel processing schedule after changes made by posted messages.
+      if (MusEGlobal::audioGraph)
+            MusEGlobal::audioGraph->update();
+      updateLatencyCompensators();
+
       // Keep the sync detectors running... 
       for(int port = 0; port < MusECore::MIDI_PORTS; ++port)
           MusEGlobal::midiPorts[port].syncInfo().setTime();
       
+      // Rebuild the controller chase checkpoints after edits and mute changes.
+      for(int port = 0; port < MusECore::MIDI_PORTS; ++port)
+          MusEGlobal::midiPorts[port].controller()->updateChase();
+      
       
       if (MusEGlobal::audio->isPlaying())
         setPos(0, MusEGlobal::audio->tickPos(), true, false, true);
@@ -1771,6 +1873,11 @@ void Song::beat()
       // Update synth native guis at the heartbeat rate.
       for(ciSynthI is = _synthIs.begin(); is != _synthIs.end(); ++is)
         (*is)->guiHeartBeat();
+
+      // Unfreeze tracks whose freeze files went out of date.
+      checkStaleFreezes();
+      // Catch parts whose events changed outside of the operations.
+      updatePackedEvents();
       
       while (noteFifoSize) {
             int pv = recNoteFifo[noteFifoRindex];
@@ -1924,6 +2031,7 @@ void Song::undo()
       }
 
       updateFlags = SongChangedStruct_t();
+      updateFlags.clearEventRange();
       
       Undo& opGroup = undoList->back();
       
@@ -1956,6 +2064,7 @@ void Song::redo()
       }
 
       updateFlags = SongChangedStruct_t();
+      updateFlags.clearEventRange();
 
       Undo& opGroup = redoList->back();
       
@@ -2025,6 +2134,8 @@ void Song::clear(bool signal, bool clear_all)
       if(MusEGlobal::debugMsg)
         fprintf(stderr, "Song::clear\n");
       
+      // Its track is deleted below.
+      discardFreezeRender();
       bounceTrack    = 0;
       
       _tracks.clear();
@@ -2368,6 +2479,10 @@ void Song::seqSignal(int fd)
                             MusEGlobal::audioDevice->connectionsChanged();
                         break;
 
+                  case 'A': // Posted messages processed
+                        MusEGlobal::audio->processAsyncMsgsDone();
+                        break;
+
 //                   case 'U': // Send song changed signal
 //                         {
 //                           int d_len = sizeof(SongChangedStruct_t);
@@ -413,6 +413,8 @@ public:
       void revertOperationGroup1(Undo& operations);
       void revertOperationGroup2(Undo& operations);
       void revertOperationGroup3(Undo& operations);
+      // Rebuilds the packed playback copies of midi parts whose events changed.
+      void updatePackedEvents();
 
       void addUndo(UndoOp i);
       void setUndoRedoText();
@@ -445,6 +447,8 @@ public:
       void update(SongChangedStruct_t flags = SongChangedStruct_t(SC_EVERYTHING),
                   bool allowRecursion=false); 
       void beat();
+      // Creates and frees the plugin delay compensation delay lines after route changes.
+      void updateLatencyCompensators();
 
       void undo();
       void redo();
@@ -50,6 +50,7 @@
 #include "conf.h"
 #include "driver/jackmidi.h"
 #include "keyevent.h"
+#include "autosave.h"
 
 namespace MusEGlobal {
 MusECore::CloneList cloneList;
@@ -435,7 +436,9 @@ void Part::write(int level, Xml& xml, bool isCopy, bool forceWavePaths) const
       xml.intTag(level, "color", _colorIndex);
       if (_mute)
             xml.intTag(level, "mute", _mute);
-      if (dumpEvents) {
+      // During an autosave snapshot the midi events are only copied here,
+      //  the background thread writes them.
+      if (dumpEvents && (wave || !deferAutoSaveEvents(level, events(), *this))) {
             for (ciEvent e = events().begin(); e != events().end(); ++e)
                   e->second.write(level, xml, *this, forceWavePaths);
             }
@@ -677,6 +680,20 @@ void Song::read(Xml& xml, bool isTemplate)
                         break;
                   case Xml::TagEnd:
                         if (tag == "song") {
+                              if (MusEGlobal::debugMsg) {
+                                    // Memory used by automation.
+                                    size_t items = 0, bytes = 0, flatBytes = 0;
+                                    for (ciTrack it = _tracks.begin(); it != _tracks.end(); ++it) {
+                                          if ((*it)->isMidiTrack())
+                                                continue;
+                                          size_t i, fb;
+                                          bytes += static_cast<AudioTrack*>(*it)->controller()->memoryUsage(&fb, &i);
+                                          flatBytes += fb;
+                                          items += i;
+                                          }
+                                    fprintf(stderr, "Song::read: automation: %zu points, about %zu KiB in lists, %zu KiB in flat copies\n",
+                                       items, bytes / 1024, flatBytes / 1024);
+                                    }
                               return;
                               }
                   default:
@@ -0,0 +1,261 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  sorted_notes.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __SORTED_NOTES_H__
+#define __SORTED_NOTES_H__
+
+#include <stddef.h>
+#include <limits.h>
+#include <vector>
+#include <set>
+#include <map>
+#include <utility>
+#include <functional>
+#include <algorithm>
+
+// The sorted note views which delete_overlaps(), legato() and their
+//  editor variants in functions.cpp work on. Kept free of the rest of
+//  MusE so that sandbox/muse_functions_bench can run them on synthetic
+//  parts. They give the very same results, in the same order, as the
+//  old loops which compared every note with every other one.
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   SortedNoteT
+//   A note as seen by the sorted views. EventT needs tick(),
+//    lenTick(), endTick() and pitch(). Notes are only compared
+//    with notes of the same group, the clone chain of their part.
+//---------------------------------------------------------
+
+template <class EventT, class PartT> struct SortedNoteT
+{
+  unsigned tick;
+  int group;
+  const EventT* event;
+  const PartT* part;
+
+  SortedNoteT(const EventT* e, const PartT* p, int g = 0) : tick(e->tick()), group(g), event(e), part(p) {}
+};
+
+//---------------------------------------------------------
+//   sortNotesByAddress
+//   The order in which the old pointer keyed maps of
+//    get_events() visited the notes.
+//---------------------------------------------------------
+
+template <class NoteT> bool noteAddressLess(const NoteT& a, const NoteT& b)
+{
+  return std::less<const void*>()(a.event, b.event);
+}
+
+template <class NoteT> void sortNotesByAddress(std::vector<NoteT>& notes)
+{
+  std::sort(notes.begin(), notes.end(), noteAddressLess<NoteT>);
+}
+
+//---------------------------------------------------------
+//   NoteChange
+//   What the functions below do with a note.
+//---------------------------------------------------------
+
+struct NoteChange
+{
+  size_t note;     // Index into the notes.
+  unsigned newLen; // Zero: Delete the note. Else set its length to this.
+
+  NoteChange(size_t n, unsigned len) : note(n), newLen(len) {}
+};
+
+//---------------------------------------------------------
+//   findNoteOverlaps
+//   notes must be sorted by address. A note deletes the notes
+//    of the same group and pitch which start together with it,
+//    and is cut off where any later one reaching into it
+//    starts, once for each such note. The notes deleted so far
+//    are kept in a time sorted set per group and pitch.
+//---------------------------------------------------------
+
+template <class NoteT> void findNoteOverlaps(const std::vector<NoteT>& notes, std::vector<NoteChange>& changes)
+{
+  // By group and pitch: the start and index of the notes not deleted yet.
+  typedef std::set<std::pair<unsigned, size_t> > Starts;
+  typedef std::map<std::pair<int, int>, Starts> StartsMap;
+  StartsMap starts;
+  for(size_t i = 0; i < notes.size(); ++i)
+    starts[std::make_pair(notes[i].group, notes[i].event->pitch())].insert(std::make_pair(notes[i].tick, i));
+
+  std::vector<size_t> hits;
+  for(size_t i = 0; i < notes.size(); ++i)
+  {
+    const NoteT& note1 = notes[i];
+    const unsigned end = note1.event->endTick();
+    Starts& s = starts[std::make_pair(note1.group, note1.event->pitch())];
+
+    hits.clear();
+    for(typename Starts::const_iterator it = s.lower_bound(std::make_pair(note1.tick, size_t(0)));
+        it != s.end() && it->first < end; ++it)
+      if(it->second != i)
+        hits.push_back(it->second);
+    // The indices are in address order.
+    std::sort(hits.begin(), hits.end());
+
+    for(std::vector<size_t>::const_iterator ih = hits.begin(); ih != hits.end(); ++ih)
+    {
+      const unsigned new_len = notes[*ih].tick - note1.tick;
+      if(new_len == 0)
+      {
+        changes.push_back(NoteChange(*ih, 0));
+        s.erase(std::make_pair(notes[*ih].tick, *ih));
+      }
+      else
+        changes.push_back(NoteChange(i, new_len));
+    }
+  }
+}
+
+//---------------------------------------------------------
+//   findSortedNoteOverlaps
+//   notes must be sorted by time. A note deletes the
+//    following notes of the same pitch which start together
+//    with it, then is cut off where the next one reaching
+//    into it starts.
+//---------------------------------------------------------
+
+template <class NoteT> void findSortedNoteOverlaps(const std::vector<NoteT>& notes, std::vector<NoteChange>& changes)
+{
+  // The next note of the same pitch.
+  std::vector<size_t> next(notes.size(), notes.size());
+  std::map<int, size_t> following;
+  for(size_t i = notes.size(); i-- > 0; )
+  {
+    std::map<int, size_t>::iterator f = following.insert(std::make_pair(notes[i].event->pitch(), notes.size())).first;
+    next[i] = f->second;
+    f->second = i;
+  }
+
+  std::vector<bool> deleted(notes.size(), false);
+  for(size_t i = 0; i < notes.size(); ++i)
+  {
+    if(deleted[i])
+      continue;
+    const unsigned end = notes[i].event->endTick();
+    for(size_t j = next[i]; j < notes.size(); j = next[j])
+    {
+      if(deleted[j])
+        continue;
+      if(notes[j].tick >= end)
+        break;
+      const unsigned new_len = notes[j].tick - notes[i].tick;
+      if(new_len == 0)
+      {
+        changes.push_back(NoteChange(j, 0));
+        deleted[j] = true;
+        continue;
+      }
+      changes.push_back(NoteChange(i, new_len));
+      break;
+    }
+  }
+}
+
+//---------------------------------------------------------
+//   legatoDistance
+//   The distance from tick to the nearest start in starts,
+//    which must be sorted, at least min_len after tick and,
+//    with dont_shorten, not before tick + len. INT_MAX if
+//    there is none.
+//---------------------------------------------------------
+
+inline unsigned legatoDistance(const std::vector<unsigned>& starts, unsigned tick, unsigned len,
+                               int min_len, bool dont_shorten)
+{
+  unsigned from = tick + min_len;
+  if(dont_shorten && tick + len > from)
+    from = tick + len;
+
+  std::vector<unsigned>::const_iterator next = std::lower_bound(starts.begin(), starts.end(), from);
+  if(next == starts.end() || *next - tick >= unsigned(INT_MAX))
+    return INT_MAX;
+  return *next - tick;
+}
+
+//---------------------------------------------------------
+//   findLegatoLens
+//   notes must be sorted by address. Each note is extended
+//    or shortened to reach the next relevant note of its
+//    group, whatever its pitch.
+//---------------------------------------------------------
+
+template <class NoteT> void findLegatoLens(const std::vector<NoteT>& notes, int min_len, bool dont_shorten,
+                                           std::vector<NoteChange>& changes)
+{
+  std::map<int, std::vector<unsigned> > starts;
+  for(size_t i = 0; i < notes.size(); ++i)
+    starts[notes[i].group].push_back(notes[i].tick);
+  for(std::map<int, std::vector<unsigned> >::iterator it = starts.begin(); it != starts.end(); ++it)
+    std::sort(it->second.begin(), it->second.end());
+
+  for(size_t i = 0; i < notes.size(); ++i)
+  {
+    const unsigned old_len = notes[i].event->lenTick();
+    unsigned len = legatoDistance(starts[notes[i].group], notes[i].tick, old_len, min_len, dont_shorten);
+    if(len == unsigned(INT_MAX))
+      len = old_len;
+    if(len != old_len)
+      changes.push_back(NoteChange(i, len));
+  }
+}
+
+//---------------------------------------------------------
+//   findSortedLegatoLens
+//   notes must be sorted by time. Like findLegatoLens(), but
+//    as in the editors' legato, len is not reset from one note
+//    to the next, nor from one call to the next: a note takes
+//    the distance to its next note only if that is shorter
+//    than len, else the last length set. Start with INT_MAX.
+//---------------------------------------------------------
+
+template <class NoteT> void findSortedLegatoLens(const std::vector<NoteT>& notes, int min_len, bool dont_shorten,
+                                                 unsigned& len, std::vector<NoteChange>& changes)
+{
+  std::vector<unsigned> starts;
+  starts.reserve(notes.size());
+  for(size_t i = 0; i < notes.size(); ++i)
+    starts.push_back(notes[i].tick);
+
+  for(size_t i = 0; i < notes.size(); ++i)
+  {
+    const unsigned old_len = notes[i].event->lenTick();
+    const unsigned distance = legatoDistance(starts, notes[i].tick, old_len, min_len, dont_shorten);
+    if(distance < len)
+      len = distance;
+    if(len == unsigned(INT_MAX))
+      len = old_len;
+    if(len != old_len)
+      changes.push_back(NoteChange(i, len));
+  }
+}
+
+} // namespace MusECore
+
+#endif
@@ -0,0 +1,117 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  startup_profile.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include <QElapsedTimer>
+
+#include "startup_profile.h"
+#include "globals.h"
+
+namespace MusECore {
+
+struct StartupStage {
+      const char* name;
+      long long start;
+      long long end;
+      bool background;
+
+      bool operator<(const StartupStage& s) const { return start < s.start; }
+      };
+
+static std::mutex stageMutex;
+static std::vector<StartupStage> stages;
+static QElapsedTimer startupClock;
+static long long stageStart = 0;
+
+//---------------------------------------------------------
+//   startupProfileStart
+//---------------------------------------------------------
+
+void startupProfileStart()
+      {
+      std::lock_guard<std::mutex> lock(stageMutex);
+      stages.clear();
+      startupClock.start();
+      stageStart = 0;
+      }
+
+//---------------------------------------------------------
+//   startupProfileNow
+//---------------------------------------------------------
+
+long long startupProfileNow()
+      {
+      return startupClock.elapsed();
+      }
+
+//---------------------------------------------------------
+//   startupProfileStage
+//---------------------------------------------------------
+
+void startupProfileStage(const char* name)
+      {
+      const long long now = startupProfileNow();
+      StartupStage s = { name, stageStart, now, false };
+      stageStart = now;
+      std::lock_guard<std::mutex> lock(stageMutex);
+      stages.push_back(s);
+      }
+
+//---------------------------------------------------------
+//   startupProfileBackground
+//---------------------------------------------------------
+
+void startupProfileBackground(const char* name, long long startMs, long long endMs)
+      {
+      StartupStage s = { name, startMs, endMs, true };
+      std::lock_guard<std::mutex> lock(stageMutex);
+      stages.push_back(s);
+      }
+
+//---------------------------------------------------------
+//   startupProfileReport
+//---------------------------------------------------------
+
+void startupProfileReport()
+      {
+      if (!MusEGlobal::startupProfile)
+            return;
+      std::vector<StartupStage> s;
+      {
+      std::lock_guard<std::mutex> lock(stageMutex);
+      s = stages;
+      }
+      std::stable_sort(s.begin(), s.end());
+
+      fprintf(stderr, "Startup profile:\n");
+      fprintf(stderr, "   start ms   time ms  stage\n");
+      for (std::vector<StartupStage>::const_iterator i = s.begin(); i != s.end(); ++i)
+            fprintf(stderr, "   %8lld  %8lld  %s%s\n", i->start, i->end - i->start,
+               i->name, i->background ? " (background)" : "");
+      fprintf(stderr, "   total %lld ms\n", stageStart);
+      }
+
+} // namespace MusECore
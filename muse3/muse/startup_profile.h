@@ -0,0 +1,47 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  startup_profile.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __STARTUP_PROFILE_H__
+#define __STARTUP_PROFILE_H__
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   Startup profile
+//    Wall clock times of the startup stages, printed with
+//     --startup-profile. Milliseconds since startupProfileStart().
+//---------------------------------------------------------
+
+// Starts timing a (re)start of the application, forgetting earlier stages.
+extern void startupProfileStart();
+extern long long startupProfileNow();
+// Gui thread. Ends a stage of the startup sequence, which began where the previous one ended.
+// name must be a string literal.
+extern void startupProfileStage(const char* name);
+// Any thread. Records a stage which ran concurrently with the startup sequence.
+extern void startupProfileBackground(const char* name, long long startMs, long long endMs);
+// Prints the stages if MusEGlobal::startupProfile is set.
+extern void startupProfileReport();
+
+} // namespace MusECore
+
+#endif
@@ -1243,11 +1243,32 @@ bool SynthI::getData(unsigned pos, int ports, unsigned n, float** buffer)
       int p = midiPort();
       MidiPort* mp = (p != -1) ? &MusEGlobal::midiPorts[p] : 0;
 
+      DspTimer dsp_timer(&_synthDspStats);
       _sif->getData(mp, pos, ports, n, buffer);
 
       return true;
       }
 
+//---------------------------------------------------------
+//   discardEvents
+//    A frozen synth is not run. Throw away what is sent to it,
+//     so the buffers do not overflow, and the notes are not
+//     played late once the track is unfrozen.
+//---------------------------------------------------------
+
+void SynthI::discardEvents()
+      {
+      LockFreeMPSCRingBuffer<MidiPlayEvent>* usr_buf = eventBuffers(MidiDevice::UserBuffer);
+      for (unsigned int i = usr_buf->getSize(false); i > 0; --i)
+            usr_buf->remove();
+      LockFreeMPSCRingBuffer<MidiPlayEvent>* pb_buf = eventBuffers(MidiDevice::PlaybackBuffer);
+      for (unsigned int i = pb_buf->getSize(false); i > 0; --i)
+            pb_buf->remove();
+      _outUserEvents.clear();
+      _outPlaybackEvents.clear();
+      setStopFlag(false);
+      }
+
 bool MessSynthIF::getData(MidiPort* /*mp*/, unsigned pos, int /*ports*/, unsigned n, float** buffer)
 {
       const unsigned int syncFrame = MusEGlobal::audio->curSyncFrame();
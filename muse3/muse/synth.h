@@ -216,6 +216,8 @@ class SynthI : public AudioTrack, public MidiDevice,
       {
       static bool _isVisible;
       SynthIF* _sif;
+      // Time spent in the synth's own getData() each cycle.
+      DspTimeStats _synthDspStats;
 
    protected:
       Synth* synthesizer;
@@ -262,7 +264,10 @@ class SynthI : public AudioTrack, public MidiDevice,
       virtual inline NoteOffMode noteOffMode() const { return NoteOffAll; }
 
       SynthIF* sif() const { return _sif; }
+      DspTimeStats* synthDspStats() { return &_synthDspStats; }
       bool initInstance(Synth* s, const QString& instanceName);
+      // Called from audio thread only, while the track is frozen.
+      void discardEvents();
       virtual float latency(int channel) { return _sif->latency() + AudioTrack::latency(channel); }
 
       void read(Xml&);
@@ -331,6 +336,7 @@ class SynthI : public AudioTrack, public MidiDevice,
       void deactivate3();
       bool isActivated() const         { return synthesizer && _sif; }
       virtual bool hasAuxSend() const  { return true; }
+      virtual bool canFreeze() const   { return true; }
       static void setVisible(bool t) { _isVisible = t; }
       virtual int height() const;
       static bool visible() { return _isVisible; }
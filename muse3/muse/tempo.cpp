@@ -31,6 +31,7 @@
 #include "xml.h"
 
 #include <stdint.h>
+#include <algorithm>
 #include "large_int.h"
 
 namespace MusEGlobal {
@@ -51,6 +52,7 @@ TempoList::TempoList()
       _tempoSN     = 1;
       _globalTempo = 100;
       useList      = true;
+      rebuildFrameIndex();
       }
 
 TempoList::~TempoList()
@@ -76,6 +78,7 @@ void TempoList::add(unsigned tick, int tempo, bool do_normalize)
             TEvent* ev = new TEvent(ne->tempo, ne->tick);
             ne->tempo  = tempo;
             ne->tick   = tick;
+            _frameIndexValid = false;
             insert(std::pair<const unsigned, TEvent*> (tick, ev));
             }
       if(do_normalize)      
@@ -86,6 +89,7 @@ void TempoList::add(unsigned tick, int tempo, bool do_normalize)
 void TempoList::add(unsigned tick, TEvent* e, bool do_normalize)
 {
   int tempo = e->tempo;
+  _frameIndexValid = false;
   std::pair<iTEvent, bool> res = insert(std::pair<const unsigned, TEvent*> (tick, e));
   if(!res.second)
   {
@@ -128,6 +132,52 @@ void TempoList::normalize()
               e->first - e->second->tick,
               denom, LargeIntRoundUp);
             }
+      rebuildFrameIndex();
+      }
+
+//---------------------------------------------------------
+//   TempoList::rebuildFrameIndex
+//---------------------------------------------------------
+
+void TempoList::rebuildFrameIndex()
+      {
+      _frameIndex.clear();
+      _frameIndex.reserve(size());
+      for (ciTEvent e = begin(); e != end(); ++e)
+            _frameIndex.push_back(e->second);
+      _frameIndexValid = true;
+      }
+
+static bool frameLess(unsigned frame, const TEvent* e)
+      {
+      return frame < e->frame;
+      }
+
+//---------------------------------------------------------
+//   TempoList::frameEvent
+//---------------------------------------------------------
+
+const TEvent* TempoList::frameEvent(unsigned frame) const
+      {
+      if (_frameIndexValid && !_frameIndex.empty()) {
+            std::vector<const TEvent*>::const_iterator i =
+              std::upper_bound(_frameIndex.begin(), _frameIndex.end(), frame, frameLess);
+            if (i != _frameIndex.begin())
+                  --i;
+            return *i;
+            }
+
+      ciTEvent e;
+      for (e = begin(); e != end();) {
+            ciTEvent ee = e;
+            ++ee;
+            if (ee == end())
+                  break;
+            if (frame < ee->second->frame)
+                  break;
+            e = ee;
+            }
+      return e->second;
       }
 
 //---------------------------------------------------------
@@ -154,6 +204,7 @@ void TempoList::clear()
             delete i->second;
       TEMPOLIST::clear();
       insert(std::pair<const unsigned, TEvent*> (MAX_TICK+1, new TEvent(500000, 0)));
+      rebuildFrameIndex();
       ++_tempoSN;
       }
 
@@ -168,19 +219,25 @@ void TempoList::eraseRange(unsigned stick, unsigned etick)
     if(etick > MAX_TICK)
       etick = MAX_TICK;
     
-    iTEvent se = MusEGlobal::tempomap.upper_bound(stick);
+    iTEvent se = upper_bound(stick);
     if(se == end() || (se->first == MAX_TICK+1))
       return;
 
-    iTEvent ee = MusEGlobal::tempomap.upper_bound(etick);
+    iTEvent ee = upper_bound(etick);
 
     ee->second->tempo = se->second->tempo;
     ee->second->tick = se->second->tick;
 
+    // Take the events out of the list first, then rebuild the frame index
+    //  from what is left, and only then free them. The index never points
+    //  to freed events, nor misses events still in the list.
+    std::vector<TEvent*> erased;
     for(iTEvent ite = se; ite != ee; ++ite)
-      delete ite->second;
+      erased.push_back(ite->second);
     erase(se, ee); // Erase range does NOT include the last element.
     normalize();
+    for(std::vector<TEvent*>::iterator ite = erased.begin(); ite != erased.end(); ++ite)
+      delete *ite;
     ++_tempoSN;
 }
       
@@ -202,6 +259,24 @@ int TempoList::tempo(unsigned tick) const
             return _tempo;
       }
 
+//---------------------------------------------------------
+//   tempoSegment
+//---------------------------------------------------------
+
+void TempoList::tempoSegment(unsigned tick, unsigned* startTick, unsigned* endTick) const
+      {
+      if (useList) {
+            ciTEvent i = upper_bound(tick);
+            if (i != end()) {
+                  *startTick = i->second->tick;
+                  *endTick   = i->first;
+                  return;
+                  }
+            }
+      *startTick = 0;
+      *endTick   = MAX_TICK + 1;
+      }
+
 //---------------------------------------------------------
 //   tempo
 //   Bypass the useList flag and read from the list
@@ -242,6 +317,7 @@ void TempoList::del(iTEvent e, bool do_normalize)
             }
       ne->second->tempo = e->second->tempo;
       ne->second->tick  = e->second->tick;
+      _frameIndexValid = false;
       erase(e);
       if(do_normalize)
         normalize();
@@ -402,19 +478,10 @@ unsigned TempoList::frame2tick(unsigned frame, int* sn, LargeIntRoundMode round_
       const uint64_t numer = (uint64_t)MusEGlobal::config.division * (uint64_t)_globalTempo * 10000UL;
       const uint64_t denom = (uint64_t)MusEGlobal::sampleRate;
       if (useList) {
-            ciTEvent e;
-            for (e = begin(); e != end();) {
-                  ciTEvent ee = e;
-                  ++ee;
-                  if (ee == end())
-                        break;
-                  if (frame < ee->second->frame)
-                        break;
-                  e = ee;
-                  }
+            const TEvent* e = frameEvent(frame);
             // Normally do not round up here since (audio) frame resolution is higher than tick resolution.
-            tick = e->second->tick + muse_multiply_64_div_64_to_64(
-              numer, frame - e->second->frame, denom * (uint64_t)e->second->tempo, round_mode);
+            tick = e->tick + muse_multiply_64_div_64_to_64(
+              numer, frame - e->frame, denom * (uint64_t)e->tempo, round_mode);
             }
       else
             // Normally do not round up here since (audio) frame resolution is higher than tick resolution.
@@ -424,6 +491,88 @@ unsigned TempoList::frame2tick(unsigned frame, int* sn, LargeIntRoundMode round_
       return tick;
       }
 
+//---------------------------------------------------------
+//   tick2frame
+//    batch version
+//---------------------------------------------------------
+
+void TempoList::tick2frame(const unsigned* ticks, unsigned* frames, int n, int* sn) const
+      {
+      const uint64_t numer = (uint64_t)MusEGlobal::sampleRate;
+      const uint64_t denom = (uint64_t)MusEGlobal::config.division * (uint64_t)_globalTempo * 10000UL;
+      if (useList) {
+            ciTEvent i = end();
+            for (int k = 0; k < n; ++k) {
+                  const unsigned tick = ticks[k];
+                  // Still in the same tempo range as the previous value?
+                  if (i == end() || tick < i->second->tick || tick >= i->first) {
+                        i = upper_bound(tick);
+                        if (i == end()) {
+                              printf("tick2frame(%d,0x%x): not found\n", tick, tick);
+                              frames[k] = 0;
+                              continue;
+                              }
+                        }
+                  // Tick resolution is less than frame resolution. 
+                  // Round up so that the reciprocal function (frame to tick) matches value for value.
+                  frames[k] = i->second->frame + muse_multiply_64_div_64_to_64(
+                    numer * (uint64_t)i->second->tempo, tick - i->second->tick, denom, LargeIntRoundUp);
+                  }
+            }
+      else {
+            for (int k = 0; k < n; ++k)
+                  frames[k] = muse_multiply_64_div_64_to_64(numer * (uint64_t)_tempo, ticks[k], denom, LargeIntRoundUp);
+            }
+      if (sn)
+            *sn = _tempoSN;
+      }
+
+//---------------------------------------------------------
+//   frame2tick
+//    batch version
+//---------------------------------------------------------
+
+void TempoList::frame2tick(const unsigned* frames, unsigned* ticks, int n, int* sn, LargeIntRoundMode round_mode) const
+      {
+      const uint64_t numer = (uint64_t)MusEGlobal::config.division * (uint64_t)_globalTempo * 10000UL;
+      const uint64_t denom = (uint64_t)MusEGlobal::sampleRate;
+      if (useList) {
+            const TEvent* e = 0;
+            unsigned e_end = 0;   // first frame after the range of e
+            for (int k = 0; k < n; ++k) {
+                  const unsigned frame = frames[k];
+                  // Still in the same tempo range as the previous value?
+                  if (!e || frame < e->frame || frame >= e_end) {
+                        e_end = ~0U;
+                        if (_frameIndexValid && !_frameIndex.empty()) {
+                              std::vector<const TEvent*>::const_iterator i =
+                                std::upper_bound(_frameIndex.begin(), _frameIndex.end(), frame, frameLess);
+                              if (i != _frameIndex.end())
+                                    e_end = (*i)->frame;
+                              if (i != _frameIndex.begin())
+                                    --i;
+                              e = *i;
+                              }
+                        else {
+                              // No index. Look up every value, and don't remember the range.
+                              e = frameEvent(frame);
+                              e_end = frame + 1;
+                              }
+                        }
+                  // Normally do not round up here since (audio) frame resolution is higher than tick resolution.
+                  ticks[k] = e->tick + muse_multiply_64_div_64_to_64(
+                    numer, frame - e->frame, denom * (uint64_t)e->tempo, round_mode);
+                  }
+            }
+      else {
+            for (int k = 0; k < n; ++k)
+                  // Normally do not round up here since (audio) frame resolution is higher than tick resolution.
+                  ticks[k] = muse_multiply_64_div_64_to_64(numer, frames[k], denom * (uint64_t)_tempo, round_mode);
+            }
+      if (sn)
+            *sn = _tempoSN;
+      }
+
 //---------------------------------------------------------
 //   deltaTick2frame
 //---------------------------------------------------------
@@ -480,32 +629,15 @@ unsigned TempoList::deltaFrame2tick(unsigned frame1, unsigned frame2, int* sn, L
       const uint64_t numer = (uint64_t)MusEGlobal::config.division * (uint64_t)_globalTempo * 10000UL;
       const uint64_t denom = (uint64_t)MusEGlobal::sampleRate;
       if (useList) {
-            ciTEvent e;
-            for (e = begin(); e != end();) {
-                  ciTEvent ee = e;
-                  ++ee;
-                  if (ee == end())
-                        break;
-                  if (frame1 < ee->second->frame)
-                        break;
-                  e = ee;
-                  }
+            const TEvent* e = frameEvent(frame1);
             // Normally do not round up here since (audio) frame resolution is higher than tick resolution.
-            tick1 = e->second->tick + muse_multiply_64_div_64_to_64(
-              numer, frame1 - e->second->frame, denom * (uint64_t)e->second->tempo, round_mode);
+            tick1 = e->tick + muse_multiply_64_div_64_to_64(
+              numer, frame1 - e->frame, denom * (uint64_t)e->tempo, round_mode);
             
-            for (e = begin(); e != end();) {
-                  ciTEvent ee = e;
-                  ++ee;
-                  if (ee == end())
-                        break;
-                  if (frame2 < ee->second->frame)
-                        break;
-                  e = ee;
-                  }
+            e = frameEvent(frame2);
             // Normally do not round up here since (audio) frame resolution is higher than tick resolution.
-            tick2 = e->second->tick + muse_multiply_64_div_64_to_64(
-              numer, frame2 - e->second->frame, denom * (uint64_t)e->second->tempo, round_mode);
+            tick2 = e->tick + muse_multiply_64_div_64_to_64(
+              numer, frame2 - e->frame, denom * (uint64_t)e->tempo, round_mode);
             }
       else
       {
@@ -552,6 +684,7 @@ void TempoList::read(Xml& xml)
                               TEvent* t = new TEvent();
                               unsigned tick = t->read(xml);
                               iTEvent pos = find(tick);
+                              _frameIndexValid = false;
                               if (pos != end())
                                     erase(pos);
                               insert(std::pair<const int, TEvent*> (tick, t));
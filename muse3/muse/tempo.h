@@ -80,6 +80,16 @@ class TempoList : public TEMPOLIST {
       int _tempo;             // tempo if not using tempo list
       int _globalTempo;       // %percent 50-200%
 
+      // Events sorted by frame, for binary search in the frame to tick methods.
+      // Rebuilt by normalize(). Until then, after the list was changed,
+      //  the frame to tick methods fall back to a linear search.
+      std::vector<const TEvent*> _frameIndex;
+      bool _frameIndexValid;
+
+      void rebuildFrameIndex();
+      // Returns the event whose frame range contains the given frame.
+      const TEvent* frameEvent(unsigned frame) const;
+
       void add(unsigned tick, int tempo, bool do_normalize = true);
       void add(unsigned tick, TEvent* e, bool do_normalize = true);
       void del(iTEvent, bool do_normalize = true);
@@ -100,6 +110,9 @@ class TempoList : public TEMPOLIST {
       int tempo(unsigned tick) const;
       // Returns a tempo value from the list if master is on, or else the static tempo value.
       int tempoAt(unsigned tick) const;
+      // Returns the ticks [startTick, endTick) around tick over which the tempo is constant.
+      // endTick is MAX_TICK + 1 for the last tempo, and the whole range if master is off.
+      void tempoSegment(unsigned tick, unsigned* startTick, unsigned* endTick) const;
       
       
       //-------------------------------------------------------------------------------------------------------
@@ -129,6 +142,12 @@ class TempoList : public TEMPOLIST {
       unsigned frame2tick(unsigned frame, int* sn = 0, LargeIntRoundMode round_mode = LargeIntRoundDown) const;
       unsigned frame2tick(unsigned frame, unsigned tick, int* sn, LargeIntRoundMode round_mode = LargeIntRoundDown) const;
       unsigned deltaFrame2tick(unsigned frame1, unsigned frame2, int* sn = 0, LargeIntRoundMode round_mode = LargeIntRoundDown) const;
+
+      // Batch conversions of n values. Same results as calling tick2frame() or frame2tick()
+      //  for each value, but much cheaper when the values are sorted, such as the events of a part:
+      //  Consecutive values falling into the same tempo range reuse the range found for the previous one.
+      void tick2frame(const unsigned* ticks, unsigned* frames, int n, int* sn = 0) const;
+      void frame2tick(const unsigned* frames, unsigned* ticks, int n, int* sn = 0, LargeIntRoundMode round_mode = LargeIntRoundDown) const;
       
       int tempoSN() const { return _tempoSN; }
       // Sets the tempo value in the list if master is on, or else the static tempo value.
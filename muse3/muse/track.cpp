@@ -258,6 +258,7 @@ void Track::init()
       _recMonitor    = false;
       for (int i = 0; i < MusECore::MAX_CHANNELS; ++i) {
             _meter[i] = 0.0;
+            _meterRms[i] = 0.0;
             _peak[i]  = 0.0;
             _isClipped[i] = false;
             }
@@ -278,6 +279,7 @@ Track::Track(const Track& t, int flags)
   internal_assign(t, flags | ASSIGN_PROPERTIES);
   for (int i = 0; i < MusECore::MAX_CHANNELS; ++i) {
         _meter[i] = 0.0;
+        _meterRms[i] = 0.0;
         _peak[i]  = 0.0;
         _isClipped[i] = false;
         }
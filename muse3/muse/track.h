@@ -29,6 +29,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <atomic>
 
 #include "wave.h" // for SndFileR
 #include "part.h"
@@ -40,6 +41,7 @@
 #include "globaldefs.h"
 #include "cleftypes.h"
 #include "controlfifo.h"
+#include "dsp_stats.h"
 
 class QPixmap;
 class QColor;
@@ -48,6 +50,7 @@ namespace MusECore {
 class Pipeline;
 class PluginI;
 class SynthI;
+class LatencyCompensator;
 class Xml;
 struct DrumMap;
 struct ControlEvent;
@@ -118,6 +121,8 @@ class Track {
       int _activity;
       int _lastActivity;
       double _meter[MusECore::MAX_CHANNELS];
+      // Rms of the last cycle's post fader output, beside the peak in _meter.
+      double _meterRms[MusECore::MAX_CHANNELS];
       double _peak[MusECore::MAX_CHANNELS];
       bool _isClipped[MusECore::MAX_CHANNELS]; //used in audio mixer strip. Persistent.
 
@@ -277,6 +282,7 @@ class Track {
       void resetPeaks();
       static void resetAllMeter();
       double meter(int ch) const  { return _meter[ch]; }
+      double meterRms(int ch) const { return _meterRms[ch]; }
       double peak(int ch) const   { return _peak[ch]; }
       void resetMeter();
 
@@ -474,6 +480,31 @@ class MidiTrack : public Track {
 
 class AudioTrack : public Track {
       bool _haveData; // Whether we have data from a previous process call during current cycle.
+      bool _auxSendsPending; // Whether our aux sends still need to be mixed into the aux tracks during current cycle.
+
+      // Plugin delay compensation:
+      float _latencyIn;         // Highest accumulated latency of our input routes, in frames.
+      float _latencyOut;        // Accumulated latency at our output: _latencyIn plus our own, in frames.
+      bool _latencyUpdated;     // Whether the latencies were updated during current cycle.
+      bool _latencyVisiting;    // Anti circular mechanism.
+   public:
+      // A delay line for one input route, for routes arriving earlier than _latencyIn.
+      struct InRouteLatencyComp {
+            const Track* track;
+            int channel;
+            int channels;
+            int remoteChannel;
+            LatencyCompensator* compensator;
+            };
+      typedef std::vector<InRouteLatencyComp> InRouteLatencyCompList;
+
+   private:
+      // Keyed by route. Built by the gui thread, only looked up by getData().
+      std::atomic<InRouteLatencyCompList*> _inRouteLatencyComps;
+      // The longest delay already reported as too long to be compensated. Gui thread only.
+      unsigned long _latencyCompTooLong;
+      LatencyCompensator* findLatencyCompensator(const Route& r) const;
+      unsigned long latencyCompFrames(const Route& r) const;
       
       CtrlListList _controller;   // Holds all controllers including internal, plugin and synth.
       ControlFifo _controlFifo;   // For internal controllers like volume and pan. Plugins/synths have their own.
@@ -520,12 +551,38 @@ class AudioTrack : public Track {
       int _totalInChannels;
       
       Pipeline* _efxPipe;
+      // Self time of the first copyData() of each cycle, see DspTimer.
+      DspTimeStats _dspStats;
 
       virtual bool getData(unsigned, int, unsigned, float**);
 
       SndFileR _recFile;
       Fifo fifo;                    // fifo -> _recFile
       bool _processed;
+
+      // Prefetch state of tracks which play from disk, see usesPrefetch().
+      // Only touched by the prefetch thread and its workers.
+      Fifo _prefetchFifo;
+      unsigned _prefetchWritePos;
+      int _prefetchReadAhead;  // segments per read, adapted to how the fifo keeps up
+      // Lowest prefetch fifo fill in percent since the gui last asked.
+      std::atomic<int> _prefetchLowWater;
+
+      // Track freeze, see freeze.cpp. While frozen, the track plays _freezeFile,
+      //  which holds the output of its instrument and rack, and runs neither.
+      SndFileR _freezeFile;
+      volatile bool _frozen;
+      // Only set while the freeze file is being rendered. Audio thread only.
+      SndFileR _freezeCapture;
+      // Frames of _freezeCapture written without a gap, from frame 0 on.
+      std::atomic<unsigned> _freezeCaptured;
+      // Set by anything which makes the freeze file outdated.
+      std::atomic<bool> _freezeStale;
+
+      // Plays the freeze file from the prefetch fifo, or directly when freewheeling.
+      bool getFrozenData(unsigned pos, int channels, unsigned frames, float** bp);
+      // Writes the output of the rack to the freeze file being rendered.
+      void captureFreeze(unsigned pos, int channels, unsigned frames, float** bp);
       
    public:
       AudioTrack(TrackType t);
@@ -549,6 +606,26 @@ class AudioTrack : public Track {
       virtual bool setRecordFlag2AndCheckMonitor(bool);
 
       bool processed() { return _processed; }
+      // Our cached output of the current cycle, see outBuffers. Only valid if processed().
+      float** outputBuffers() const { return outBuffers; }
+      // Whether this track has processed data this cycle which still needs to be mixed into the aux tracks.
+      bool auxSendsPending() const { return _auxSendsPending; }
+      // Mixes our cached output into the aux send buffers. Called once per cycle by the aux join point.
+      void mixAuxSends(unsigned nframes);
+
+      // Called once per cycle from the audio thread, before updateLatency().
+      void invalidateLatency() { _latencyUpdated = false; }
+      // Recursively updates the accumulated latencies of our input routes and ourselves.
+      // Called once per cycle from the audio thread, before any processing.
+      void updateLatency();
+      float inputLatency() const { return _latencyIn; }
+      float outputLatency() const { return _latencyOut; }
+      // Called from gui thread only. Makes sure there is a delay line for each audio input route,
+      //  reusing the existing ones. Returns the replaced list, or null if nothing changed.
+      // The caller must wait for an audio cycle to pass before deleting the replaced list,
+      //  and the delay lines in it which are not in the new one.
+      InRouteLatencyCompList* updateLatencyCompensators();
+      const InRouteLatencyCompList* latencyCompensators() const { return _inRouteLatencyComps; }
 
       void addController(CtrlList*);
       void removeController(int id);
@@ -563,6 +640,36 @@ class AudioTrack : public Track {
       SndFileR recFile() const           { return _recFile; }
       void setRecFile(SndFileR sf)       { _recFile = sf; }
 
+      // Whether the prefetch thread fetches data for us: Wave tracks and frozen tracks.
+      bool usesPrefetch() const          { return type() == WAVE || _frozen; }
+      void clearPrefetchFifo()           { _prefetchFifo.clear(); }
+      Fifo* prefetchFifo()               { return &_prefetchFifo; }
+      unsigned prefetchWritePos() const      { return _prefetchWritePos; }
+      void setPrefetchWritePos(unsigned pos) { _prefetchWritePos = pos; }
+      int prefetchReadAhead() const          { return _prefetchReadAhead; }
+      void setPrefetchReadAhead(int segs)    { _prefetchReadAhead = segs; }
+      // Called by the prefetch thread with the current fill in percent.
+      void notePrefetchFill(int percent);
+      // Called by the gui. Returns the lowest fill in percent since the last call.
+      int takePrefetchLowWater()             { return _prefetchLowWater.exchange(100); }
+      // Reads what the prefetch thread puts into the fifo. Here: The freeze file.
+      // Called from prefetch thread or its workers. If overwrite is true, copies the data. If false, adds the data.
+      virtual void readData(unsigned pos, unsigned frames, float** bp, bool doSeek, bool overwrite);
+
+      // Track freeze. Only tracks with an instrument or a recording to render can be frozen.
+      virtual bool canFreeze() const     { return false; }
+      bool frozen() const                { return _frozen; }
+      SndFileR freezeFile() const        { return _freezeFile; }
+      // Called from audio thread only. A null file unfreezes.
+      void setFreezeFile(SndFileR sf);
+      // Called from audio thread only, see Audio::msgSetFreezeCapture().
+      void setFreezeCapture(SndFileR sf) { _freezeCapture = sf; _freezeCaptured = 0; }
+      unsigned freezeCaptured() const    { return _freezeCaptured; }
+      // Marks the freeze file as outdated. The gui unfreezes the track at the next heartbeat.
+      // Can be called from any thread.
+      void invalidateFreeze()            { if(_frozen) _freezeStale = true; }
+      bool freezeStale() const           { return _freezeStale; }
+
       CtrlListList* controller()         { return &_controller; }
       // For setting/getting the _controls 'port' values.
       unsigned long parameters() const { return _controlPorts; }
@@ -612,6 +719,7 @@ class AudioTrack : public Track {
 
       void setPrefader(bool val);
       Pipeline* efxPipe()                { return _efxPipe;  }
+      DspTimeStats* dspStats()           { return &_dspStats; }
       void deleteAllEfxGuis();
       void clearEfxList();
       // Removes any existing plugin and inserts plugin into effects rack, and calls setupPlugin.
@@ -804,7 +912,6 @@ class AudioAux : public AudioTrack {
 //---------------------------------------------------------
 
 class WaveTrack : public AudioTrack {
-      Fifo _prefetchFifo;  // prefetch Fifo
       static bool _isVisible;
 
       void internal_assign(const Track&, int flags);
@@ -829,11 +936,12 @@ class WaveTrack : public AudioTrack {
 
       // If overwrite is true, copies the data. If false, adds the data.
       virtual void fetchData(unsigned pos, unsigned frames, float** bp, bool doSeek, bool overwrite);
+      // Same as fetchData but does not touch the prefetch fifo. Reads the freeze file if frozen.
+      virtual void readData(unsigned pos, unsigned frames, float** bp, bool doSeek, bool overwrite);
       
       virtual bool getData(unsigned, int ch, unsigned, float** bp);
 
-      void clearPrefetchFifo()      { _prefetchFifo.clear(); }
-      Fifo* prefetchFifo()          { return &_prefetchFifo; }
+      virtual bool canFreeze() const { return true; }
       virtual void setChannels(int n);
       virtual bool hasAuxSend() const { return true; }
       bool canEnableRecord() const;
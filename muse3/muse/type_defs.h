@@ -25,6 +25,7 @@
 #define __TYPE_DEFS_H__
 
 #include "stdint.h"
+#include <limits.h>
 
 namespace MusECore {
 
@@ -93,15 +94,46 @@ struct SongChangedStruct_t
   //  mechanism available for objects needing to do so. There's really
   //  no other easy way to ignore such signals.
   void* _sender;
+  // The range of ticks in which events were inserted, removed or modified.
+  // Only the operations of an undo group narrow it down. Whoever else sets
+  //  the SC_EVENT_XX flags leaves it at 0 to UINT_MAX, meaning anywhere.
+  // Editors may use it to only update what changed.
+  unsigned int _eventTickFrom;
+  unsigned int _eventTickTo;
   
   SongChangedStruct_t(SongChangedFlags_t flags = 0, SongChangedSubFlags_t subFlags = 0, void* sender = 0) :
-    _flags(flags), _subFlags(subFlags), _sender(sender) { };
+    _flags(flags), _subFlags(subFlags), _sender(sender), _eventTickFrom(0), _eventTickTo(UINT_MAX) { };
+    
+  // Nothing changed yet. Called when a new undo group starts.
+  void clearEventRange() { _eventTickFrom = UINT_MAX; _eventTickTo = 0; }
+  // Whether the event changes are known to lie within _eventTickFrom and _eventTickTo.
+  bool eventRangeKnown() const { return _eventTickFrom != 0 || _eventTickTo != UINT_MAX; }
+  // Adds event changes from tick 'from' up to and including tick 'to'.
+  void addEventChange(SongChangedFlags_t flags, unsigned int from, unsigned int to)
+  { 
+    _flags |= flags;
+    if(from < _eventTickFrom)
+      _eventTickFrom = from;
+    if(to > _eventTickTo)
+      _eventTickTo = to;
+  }
     
   SongChangedStruct_t& operator|=(const SongChangedStruct_t& f)
-  { _flags |= f._flags; _subFlags |= f._subFlags; return *this; }
+  { 
+    _flags |= f._flags; _subFlags |= f._subFlags;
+    if(f._flags & (SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED))
+      addEventChange(0, f._eventTickFrom, f._eventTickTo);
+    return *this;
+  }
     
   SongChangedStruct_t& operator|=(SongChangedFlags_t flags)
-  { _flags |= flags; return *this; }
+  { 
+    _flags |= flags;
+    // No idea where.
+    if(flags & (SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED))
+      addEventChange(0, 0, UINT_MAX);
+    return *this;
+  }
     
   SongChangedStruct_t& operator&=(const SongChangedStruct_t& f)
   { _flags &= f._flags; _subFlags &= f._subFlags; return *this; }
@@ -35,6 +35,7 @@
 #include "part.h"
 #include "audiodev.h"
 #include "track.h"
+#include "freeze.h"
 
 #include <string.h>
 #include <QAction>
@@ -52,6 +53,26 @@ static bool undoMode = false;  // for debugging
 
 std::list<QString> temporaryWavFiles;
 
+//---------------------------------------------------------
+//   addEventChange
+//    Tells where an event was changed, in the part and in
+//     the clones which get the same change.
+//---------------------------------------------------------
+
+static void addEventChange(SongChangedStruct_t& flags, SongChangedFlags_t type,
+   const Event& ev, const Part* part, bool doClones)
+      {
+      const Part* p = part;
+      do {
+            // Wave events are in frames. Just take the whole part.
+            if (ev.empty() || !p->track() || !p->track()->isMidiTrack())
+                  flags.addEventChange(type, p->tick(), p->endTick());
+            else
+                  flags.addEventChange(type, p->tick() + ev.tick(), p->tick() + ev.endTick());
+            p = p->nextClone();
+            } while (doClones && p != part);
+      }
+
 //---------------------------------------------------------
 //   typeName
 //---------------------------------------------------------
@@ -240,6 +261,7 @@ void Song::startUndo(void* sender)
       
       undoList->push_back(Undo());
       updateFlags = SongChangedStruct_t(0, 0, sender);
+      updateFlags.clearEventRange();
       undoMode = true;
       }
 
@@ -1401,6 +1423,7 @@ bool Song::applyOperationGroup(Undo& group, OperationType type, void* sender)
       case OperationUndoableUpdate:
         // Clear the updateFlags and set sender.
         updateFlags = SongChangedStruct_t(0, 0, sender);
+        updateFlags.clearEventRange();
         undoMode = false;
       break;
         
@@ -2305,7 +2328,7 @@ void Song::revertOperationGroup1(Undo& operations)
                         fprintf(stderr, "Song::revertOperationGroup1:AddEvent ** calling deleteEvent\n");
 #endif                        
                         deleteEventOperation(i->nEvent, editable_part, i->doCtrls, i->doClones);
-                        updateFlags |= SC_EVENT_REMOVED;
+                        addEventChange(updateFlags, SC_EVENT_REMOVED, i->nEvent, editable_part, i->doClones);
                         break;
 
                   case UndoOp::DeleteEvent:
@@ -2324,7 +2347,7 @@ void Song::revertOperationGroup1(Undo& operations)
                           }
                           
                           addEventOperation(i->nEvent, editable_part, i->doCtrls, i->doClones);
-                          updateFlags |= SC_EVENT_INSERTED;
+                          addEventChange(updateFlags, SC_EVENT_INSERTED, i->nEvent, editable_part, i->doClones);
                         }
                         break;
                         
@@ -2333,7 +2356,8 @@ void Song::revertOperationGroup1(Undo& operations)
                         fprintf(stderr, "Song::revertOperationGroup1:ModifyEvent ** calling changeEvent\n");
 #endif                        
                         changeEventOperation(i->nEvent, i->oEvent, editable_part, i->doCtrls, i->doClones);
-                        updateFlags |= SC_EVENT_MODIFIED;
+                        addEventChange(updateFlags, SC_EVENT_MODIFIED, i->oEvent, editable_part, i->doClones);
+                        addEventChange(updateFlags, SC_EVENT_MODIFIED, i->nEvent, editable_part, i->doClones);
                         break;
 
                         
@@ -2583,6 +2607,9 @@ void Song::revertOperationGroup3(Undo& operations)
       fprintf(stderr, "Song::revertOperationGroup3 *** Calling pendingOperations.clear()\n");
 #endif      
       pendingOperations.clear();
+      // Edits which change what a frozen track would render.
+      invalidateFreezes(operations);
+      updatePackedEvents();
       for (riUndoOp i = operations.rbegin(); i != operations.rend(); ++i) {
             Track* editable_track = const_cast<Track*>(i->track);
 // uncomment if needed            Track* editable_property_track = const_cast<Track*>(i->_propertyTrack);
@@ -3098,7 +3125,7 @@ void Song::executeOperationGroup1(Undo& operations)
                         }
                         
                         addEventOperation(i->nEvent, editable_part, i->doCtrls, i->doClones);
-                        updateFlags |= SC_EVENT_INSERTED;
+                        addEventChange(updateFlags, SC_EVENT_INSERTED, i->nEvent, editable_part, i->doClones);
                         }
                         break;
                         
@@ -3111,7 +3138,7 @@ void Song::executeOperationGroup1(Undo& operations)
                         //  and as long as the ID AND position values match it will find and use the ORIGINAL event.
                         // (It's safe, the = operator quickly returns if the two events have the same base pointer.)
                         i->nEvent = deleteEventOperation(i->nEvent, editable_part, i->doCtrls, i->doClones);
-                        updateFlags |= SC_EVENT_REMOVED;
+                        addEventChange(updateFlags, SC_EVENT_REMOVED, i->nEvent, editable_part, i->doClones);
                         }
                         break;
                         
@@ -3120,7 +3147,8 @@ void Song::executeOperationGroup1(Undo& operations)
                         fprintf(stderr, "Song::executeOperationGroup1:ModifyEvent ** calling changeEvent\n");
 #endif                        
                         changeEventOperation(i->oEvent, i->nEvent, editable_part, i->doCtrls, i->doClones);
-                        updateFlags |= SC_EVENT_MODIFIED;
+                        addEventChange(updateFlags, SC_EVENT_MODIFIED, i->oEvent, editable_part, i->doClones);
+                        addEventChange(updateFlags, SC_EVENT_MODIFIED, i->nEvent, editable_part, i->doClones);
                         break;
 
                         
@@ -3386,6 +3414,9 @@ void Song::executeOperationGroup3(Undo& operations)
       fprintf(stderr, "Song::executeOperationGroup3 *** Calling pendingOperations.clear()\n");
 #endif                        
       pendingOperations.clear();
+      // Edits which change what a frozen track would render.
+      invalidateFreezes(operations);
+      updatePackedEvents();
       //bool song_has_changed = !operations.empty();
       for (iUndoOp i = operations.begin(); i != operations.end(); ) {
             Track* editable_track = const_cast<Track*>(i->track);
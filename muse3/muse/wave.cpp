@@ -22,8 +22,10 @@
 //=========================================================
 
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
+#include <string.h>
 #include "muse_math.h"
 #include <samplerate.h>
 
@@ -35,6 +37,7 @@
 #include "xml.h"
 #include "song.h"
 #include "wave.h"
+#include "peakfile.h"
 #include "app.h"
 #include "filedialog.h"
 #include "arranger/arranger.h"
@@ -47,6 +50,7 @@
 #include "wavepreview.h"
 #include "gconfig.h"
 #include "type_defs.h"
+#include "al/dsp.h"
 
 //#define WAVE_DEBUG
 //#define WAVE_DEBUG_PRC
@@ -74,6 +78,9 @@ SndFile::SndFile(const QString& name)
       refCount=0;
       writeBuffer = 0;
       writeSegSize = std::max((size_t)MusEGlobal::segmentSize, (size_t)cacheMag);// cache minimum segment size for write operations
+      sfFd = -1;
+      adviseFd = -1;
+      adviseBytes = 0;
       }
 
 SndFile::~SndFile()
@@ -88,6 +95,8 @@ SndFile::~SndFile()
                   }
             }
       delete finfo;
+      if (peaks)
+            peaks->cancel();
       if (cache) {
             delete[] cache;
             cache = 0;
@@ -112,25 +121,45 @@ bool SndFile::openRead(bool createCache, bool showProgress)
       QString p = path();
       sfinfo.format = 0;
       sfUI = 0;
-      sf = sf_open(p.toLocal8Bit().constData(), SFM_READ, &sfinfo);
-      if (sf == 0)
+      // Open the descriptor ourselves, so the read-ahead hints below apply to the
+      //  open file which libsndfile streams from.
+      const int fd = ::open(p.toLocal8Bit().constData(), O_RDONLY);
+      if (fd == -1)
             return true;
+      sf = sf_open_fd(fd, SFM_READ, &sfinfo, SF_FALSE);
+      if (sf == 0) {
+            ::close(fd);
+            return true;
+            }
+      sfFd = fd;
       if(createCache){
          sfinfo.format = 0;
          sfUI = sf_open(p.toLocal8Bit().constData(), SFM_READ, &sfinfo);
          if (sfUI == 0){
             sf_close(sf);
             sf = 0;
+            ::close(sfFd);
+            sfFd = -1;
             return true;
          }
       }
 
       writeFlag = false;
       openFlag  = true;
-      if (createCache) {
-        QString cacheName = finfo->absolutePath() + QString("/") + finfo->completeBaseName() + QString(".wca");
-        readCache(cacheName, showProgress);
-      }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+      if (MusEGlobal::config.diskReadAheadHints) {
+            struct stat st;
+            if (fstat(fd, &st) == 0) {
+                  adviseFd = fd;
+                  adviseBytes = st.st_size;
+                  posix_fadvise(adviseFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+                  }
+            }
+#endif
+
+      if (createCache)
+        openPeaks(peakFilePath(p), showProgress);
       return false;
       }
 
@@ -143,23 +172,21 @@ void SndFile::update(bool showProgress)
       {
       close();
 
-      // force recreation of wca data
-      QString cacheName = finfo->absolutePath() +
-         QString("/") + finfo->completeBaseName() + QString(".wca");
-      ::remove(cacheName.toLocal8Bit().constData());
+      // force recreation of the peak file
+      ::remove(peakFilePath(path()).toLocal8Bit().constData());
       if (openRead(true, showProgress)) {
             printf("SndFile::update openRead(%s) failed: %s\n", path().toLocal8Bit().constData(), strerror().toLocal8Bit().constData());
             }
       }
 
-//---------------------------------------------------
-//  create cache
-//---------------------------------------------------
+//---------------------------------------------------------
+//   createCache
+//    Calculates the peaks in memory, for when the peak
+//     file cannot be written.
+//---------------------------------------------------------
 
-void SndFile::createCache(const QString& path, bool showProgress, bool bWrite, sf_count_t cstart)
+void SndFile::createCache(bool showProgress)
 {
-   if(cstart >= csize)
-      return;
    QProgressDialog* progress = 0;
    if (showProgress) {
       QString label(QWidget::tr("create peakfile for "));
@@ -173,27 +200,28 @@ void SndFile::createCache(const QString& path, bool showProgress, bool bWrite, s
    float* fp[channels()];
    for (unsigned k = 0; k < channels(); ++k)
       fp[k] = &data[k][0];
-   int interval = (csize - cstart) / 10;
+   int interval = csize / 10;
 
    if(!interval)
       interval = 1;
-   for (int i = cstart; i < csize; i++) {
+   for (int i = 0; i < csize; i++) {
       if (showProgress && ((i % interval) == 0))
          progress->setValue(i);
       seek(i * cacheMag, 0);
       read(channels(), fp, cacheMag);
       for (unsigned ch = 0; ch < channels(); ++ch) {
          float rms = 0.0;
-         cache[ch][i].peak = 0;
+         int peak = 0;
          for (int n = 0; n < cacheMag; n++) {
             float fd = data[ch][n];
             rms += fd * fd;
             int idata = int(fd * 255.0);
             if (idata < 0)
                idata = -idata;
-            if (cache[ch][i].peak < idata)
-               cache[ch][i].peak = idata;
+            if (peak < idata)
+               peak = idata;
          }
+         cache[ch][i].peak = peak > 255 ? 255 : peak;
          // amplify rms value +12dB
          int rmsValue = int((sqrt(rms/cacheMag) * 255.0));
          if (rmsValue > 255)
@@ -201,59 +229,99 @@ void SndFile::createCache(const QString& path, bool showProgress, bool bWrite, s
          cache[ch][i].rms = rmsValue;
       }
    }
-   if (showProgress)
-      progress->setValue(csize);
-   if(bWrite)
-      writeCache(path);
    if (showProgress)
       delete progress;
+}
 
+//---------------------------------------------------------
+//   openPeaks
+//    For files opened read only: Maps the peak file, and has
+//     it built in the background if it is not complete yet.
+//     The waves fill in as it is built.
+//---------------------------------------------------------
+
+void SndFile::openPeaks(const QString& path, bool showProgress)
+{
+   if (peaks) {
+      peaks->cancel();
+      peaks.reset();
+   }
+   if (cache) {
+      delete[] cache;
+      cache = 0;
+   }
+   csize = 0;
+   if (samples() == 0)
+      return;
+
+   std::shared_ptr<PeakFile> pf(new PeakFile(path, this->path()));
+   if (pf->open(channels(), samples())) {
+      readCache(path, showProgress);
+      return;
+   }
+   peaks = pf;
+   if (!pf->isComplete())
+      buildPeakFile(pf);
 }
 
 //---------------------------------------------------------
 //   readCache
+//    For writable files, which keep the finest level of the
+//     peak file in memory so that it can grow while recording.
+//    An incomplete peak file is built in the background and
+//     used like for read only files, until the file is
+//     written to.
 //---------------------------------------------------------
 
 void SndFile::readCache(const QString& path, bool showProgress)
 {
+   if (peaks) {
+      peaks->cancel();
+      peaks.reset();
+   }
    if (cache) {
       delete[] cache;
+      cache = 0;
    }
+   csize = 0;
    if (samples() == 0)
       return;
 
-   csize = (samples() + cacheMag - 1)/cacheMag;
-   cache = new SampleVtype[channels()];
-   for (unsigned ch = 0; ch < channels(); ++ch)
-   {
-      cache [ch].resize(csize);
-   }
-
-   FILE* cfile = fopen(path.toLocal8Bit().constData(), "r");
-   if (cfile) {
+   std::shared_ptr<PeakFile> pf(new PeakFile(path, this->path()));
+   if (pf->open(channels(), samples())) {
+      csize = (samples() + cacheMag - 1)/cacheMag;
+      cache = new SampleVtype[channels()];
       for (unsigned ch = 0; ch < channels(); ++ch)
-         fread(&cache[ch] [0], csize * sizeof(SampleV), 1, cfile);
-      fclose(cfile);
+         cache [ch].resize(csize);
+      createCache(showProgress);
       return;
    }
-
-
-   createCache(path, showProgress, true);
+   if (!pf->isComplete()) {
+      peaks = pf;
+      buildPeakFile(pf);
+      return;
+   }
+   cacheFromPeaks(*pf);
 }
 
 //---------------------------------------------------------
-//   writeCache
+//   cacheFromPeaks
+//    Loads the finest level of the peak file into memory.
+//    Whatever is not built yet reads as silence.
 //---------------------------------------------------------
 
-void SndFile::writeCache(const QString& path)
-      {
-      FILE* cfile = fopen(path.toLocal8Bit().constData(), "w");
-      if (cfile == 0)
-            return;
-      for (unsigned ch = 0; ch < channels(); ++ch)
-            fwrite(&cache[ch] [0], csize * sizeof(SampleV), 1, cfile);
-      fclose(cfile);
-      }
+void SndFile::cacheFromPeaks(const PeakFile& pf)
+{
+   if (cache)
+      delete[] cache;
+   csize = (samples() + cacheMag - 1)/cacheMag;
+   cache = new SampleVtype[channels()];
+   for (unsigned ch = 0; ch < channels(); ++ch)
+   {
+      cache [ch].resize(csize);
+      pf.readBase(&cache[ch][0], ch, 0, csize);
+   }
+}
 
 //---------------------------------------------------------
 //   read
@@ -342,6 +410,8 @@ void SndFile::read(SampleV* s, int mag, unsigned pos, bool overwrite, bool allow
                     s[ch].rms = 0;    // TODO rms / mag;
                   }
             }
+      else if (peaks)
+            peaks->read(s, mag, pos, overwrite);
       else {
             mag /= cacheMag;
             int rest = csize - (pos/cacheMag);
@@ -387,9 +457,7 @@ bool SndFile::openWrite()
             writeBuffer = new float [writeSegSize * std::max(2, sfinfo.channels)];
             openFlag  = true;
             writeFlag = true;
-            QString cacheName = finfo->absolutePath() +
-               QString("/") + finfo->completeBaseName() + QString(".wca");
-            readCache(cacheName, true);
+            readCache(peakFilePath(p), true);
             }
       return sf == 0;
       }
@@ -415,9 +483,31 @@ void SndFile::close()
             else
               sfUI = 0;
       }
+      if (sfFd != -1) {
+            ::close(sfFd);
+            sfFd = -1;
+            }
+      adviseFd = -1;
       openFlag = false;
       }
 
+//---------------------------------------------------------
+//   adviseWillNeed
+//    The byte range is estimated from the file size, which
+//     is close enough for a hint even with compressed formats.
+//---------------------------------------------------------
+
+void SndFile::adviseWillNeed(sf_count_t frame, sf_count_t frames)
+      {
+#ifdef POSIX_FADV_WILLNEED
+      const sf_count_t total = sfinfo.frames;
+      if (adviseFd == -1 || total <= 0 || frame >= total || frames <= 0)
+            return;
+      const double bpf = double(adviseBytes) / double(total);
+      posix_fadvise(adviseFd, off_t(double(frame) * bpf), off_t(double(frames) * bpf) + 1, POSIX_FADV_WILLNEED);
+#endif
+      }
+
 //---------------------------------------------------------
 //   remove
 //---------------------------------------------------------
@@ -533,16 +623,7 @@ size_t SndFile::readInternal(int srcChannels, float** dst, size_t n, bool overwr
       float* src      = buffer;
       int dstChannels = sfinfo.channels;
       if (srcChannels == dstChannels) {
-            if(overwrite)
-              for (size_t i = 0; i < rn; ++i) {
-                  for (int ch = 0; ch < srcChannels; ++ch)
-                        *(dst[ch]+i) = *src++;
-                  }
-              else
-              for (size_t i = 0; i < rn; ++i) {
-                  for (int ch = 0; ch < srcChannels; ++ch)
-                        *(dst[ch]+i) += *src++;
-                  }
+            AL::dsp->deinterleave(dst, src, srcChannels, rn, !overwrite);
             }
       else if ((srcChannels == 1) && (dstChannels == 2)) {
             // stereo to mono
@@ -621,13 +702,10 @@ size_t SndFile::realWrite(int srcChannels, float** src, size_t n, size_t offs)
 
 
    if (srcChannels == dstChannels) {
-      for (size_t i = iStart; i < iEnd; ++i) {
-         for (int ch = 0; ch < dstChannels; ++ch)
-            if (*(src[ch]+i) > 0)
-               *dst++ = *(src[ch]+i) < limitValue ? *(src[ch]+i) : limitValue;
-            else
-               *dst++ = *(src[ch]+i) > -limitValue ? *(src[ch]+i) : -limitValue;
-      }
+      const float* sp[dstChannels];
+      for (int ch = 0; ch < dstChannels; ++ch)
+         sp[ch] = src[ch] + iStart;
+      AL::dsp->interleave(dst, sp, dstChannels, n, limitValue);
    }
    else if ((srcChannels == 1) && (dstChannels == 2)) {
       // mono to stereo
@@ -661,6 +739,13 @@ size_t SndFile::realWrite(int srcChannels, float** src, size_t n, size_t offs)
 
    if(MusEGlobal::config.liveWaveUpdate)
    { //update cache
+      if(peaks)
+      {
+         // The peak file was still being built: Continue in memory from what it has.
+         cacheFromPeaks(*peaks);
+         peaks->cancel();
+         peaks.reset();
+      }
       if(!cache)
       {
          cache = new SampleVtype[sfinfo.channels];
@@ -776,16 +861,8 @@ SndFileR getWave(const QString& inName, bool readOnlyFlag, bool openFlag, bool s
               if (readOnlyFlag)
                     error = f->openRead();
               else {
+                    // The peak file is rebuilt if it does not match the wave file anymore.
                     error = f->openWrite();
-                    // if peak cache is older than wave file we reaquire the cache
-                    QFileInfo wavinfo(name);
-                    QString cacheName = wavinfo.absolutePath() + QString("/") + wavinfo.completeBaseName() + QString(".wca");
-                    QFileInfo wcainfo(cacheName);
-                    if (!wcainfo.exists() || wcainfo.lastModified() < wavinfo.lastModified()) {
-                          QFile(cacheName).remove();
-                          f->readCache(cacheName,true);
-                          }
-
               }
               if (error) {
                     fprintf(stderr, "open wave file(%s) for %s failed: %s\n",
@@ -866,7 +943,7 @@ void SndFile::applyUndoFile(const Event& original, const QString* tmpfile, unsig
                   }
             }
 
-      SndFile tmp  = SndFile(*tmpfile);
+      SndFile tmp(*tmpfile);
       if (!tmp.isOpen()) {
             if (tmp.openRead()) {
                   printf("Could not open temporary file %s for writing - cannot undo! Aborting\n", tmpfile->toLocal8Bit().constData());
@@ -26,6 +26,9 @@
 
 #include <list>
 #include <vector>
+#include <mutex>
+#include <memory>
+#include <sys/types.h>
 #include <sndfile.h>
 
 #include <QString>
@@ -51,6 +54,7 @@ struct SampleV {
 typedef std::vector<SampleV> SampleVtype;
 
 class SndFileList;
+class PeakFile;
 
 //---------------------------------------------------------
 //   SndFile
@@ -63,14 +67,29 @@ class SndFile {
       SF_INFO sfinfo;
       SampleVtype* cache;
       sf_count_t csize;                    //!< frames in cache
+      // Read only files, and writable ones until their peak file is built,
+      //  use the memory mapped peak file instead of 'cache'.
+      std::shared_ptr<PeakFile> peaks;
 
       float *writeBuffer;
       size_t writeSegSize;
 
-      void writeCache(const QString& path);
+      void createCache(bool showProgress);
+      void openPeaks(const QString& path, bool showProgress);
+      void cacheFromPeaks(const PeakFile& pf);
 
       bool openFlag;
       bool writeFlag;
+
+      // The descriptor 'sf' reads from, when opened by openRead(). Closed by close().
+      int sfFd;
+      // The same descriptor for kernel read-ahead hints, -1 if hints are off.
+      int adviseFd;
+      off_t adviseBytes;
+      // Tracks sharing this file may be fetched by different prefetch
+      //  workers at the same time. Serializes seek + read on 'sf'.
+      std::mutex _readMutex;
+
       size_t readInternal(int srcChannels, float** dst, size_t n, bool overwrite, float *buffer);
       size_t realWrite(int channel, float**, size_t n, size_t offs = 0);
       
@@ -85,7 +104,6 @@ class SndFile {
       static SndFileList sndFiles;
       static void applyUndoFile(const Event& original, const QString* tmpfile, unsigned sx, unsigned ex);
 
-      void createCache(const QString& path, bool showProgress, bool bWrite, sf_count_t cstart = 0);
       void readCache(const QString& path, bool progress);
 
       bool openRead(bool createCache=true, bool showProgress=true);        //!< returns true on error
@@ -122,6 +140,13 @@ class SndFile {
       void read(SampleV* s, int mag, unsigned pos, bool overwrite = true, bool allowSeek = true);
       QString strerror() const;
 
+      std::mutex& readLock() { return _readMutex; }
+      // The memory mapped peak file of a read only file, null otherwise.
+      // Safe to keep and read from other threads, also after the file is closed.
+      std::shared_ptr<PeakFile> peakFile() const { return peaks; }
+      // Tell the kernel the given range of frames will be read soon.
+      void adviseWillNeed(sf_count_t frame, sf_count_t frames);
+
       static SndFile* search(const QString& name);
 
       friend class SndFileR;
@@ -167,6 +192,7 @@ class SndFileR {
       QString canonicalPath() const  { return sf ? sf->canonicalPath() : QString(); }
       QString name() const     { return sf ? sf->name() : QString(); }
 
+      std::shared_ptr<PeakFile> peakFile() const { return sf ? sf->peakFile() : std::shared_ptr<PeakFile>(); }
       unsigned samples() const    { return sf ? sf->samples() : 0; }
       unsigned channels() const   { return sf ? sf->channels() : 0; }
       unsigned samplerate() const { return sf ? sf->samplerate() : 0; }
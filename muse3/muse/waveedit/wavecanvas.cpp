@@ -45,6 +45,9 @@
 #include <QProcess>
 
 #include <set>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
 
 #include <limits.h>
 #include <stdio.h>
@@ -65,6 +68,8 @@
 #include "shortcuts.h"
 #include "editgain.h"
 #include "wave.h"
+#include "peakfile.h"
+#include "wavetiles.h"
 #include "waveedit.h"
 #include "fastlog.h"
 #include "utils.h"
@@ -965,59 +970,60 @@ void WaveCanvas::drawItem(QPainter& p, const CItem* item, const QRect& mr, const
 
         unsigned peoffset = px + event.frame() - event.spos();
 
+        MusECore::WaveTileStyle style;
+        style.mode      = MusECore::WaveTileStyle::Editor;
+        style.height    = hh;
+        style.yScale    = yScale;
+        style.peakColor = qPremultiply(MusEGlobal::config.wavePeakColor.rgba());
+        style.rmsColor  = qPremultiply(MusEGlobal::config.waveRmsColor.rgba());
+        style.drawRms   = true;
+
+        // All but the selection from the pre-rendered tiles, if they are there yet.
+        const bool tiled = sx < ex && drawWaveTiles(p, f, pos, xScale, sx, ex, mbrwp, style);
+
+        MusECore::SampleV sa[ev_channels];
+        MusECore::WaveColumnLine lines[2 * ev_channels];
         for (int i = sx; i < ex; i++) {
-              int y = h;
-              MusECore::SampleV sa[f.channels()];
-              f.read(sa, xScale, pos);
+              const int readPos = pos;
               pos += xScale;
               if (pos < event.spos())
                     continue;
 
               int selectionStartPos = selectionStart - peoffset; // Offset transformed to event coords
               int selectionStopPos  = selectionStop  - peoffset;
+              const bool selected = pos > selectionStartPos && pos <= selectionStopPos;
+              if (tiled && !selected)
+                    continue;
 
-              for (int k = 0; k < ev_channels; ++k) {
-                    int kk = k % f.channels();
-                    int peak = (sa[kk].peak * (h - 1)) / yScale;
-                    int rms  = (sa[kk].rms  * (h - 1)) / yScale;
-                    if (peak > h)
-                          peak = h;
-                    if (rms > h)
-                          rms = h;
-                    QColor peak_color = MusEGlobal::config.wavePeakColor;
-                    QColor rms_color  = MusEGlobal::config.waveRmsColor;
-
-                    if (pos > selectionStartPos && pos <= selectionStopPos) {
-                          peak_color = MusEGlobal::config.wavePeakColorSelected;
-                          rms_color  = MusEGlobal::config.waveRmsColorSelected;
+              f.read(sa, xScale, readPos);
+
+              if (selected) {
+                    // Draw inverted
+                    int y = h;
+                    for (int k = 0; k < ev_channels; ++k) {
                           QLine l_inv = clipQLine(i, y - h + cc, i, y + h - cc, mbrwp);
                           if(!l_inv.isNull())
                           {
-                            // Draw inverted
                             pen.setColor(QColor(Qt::black));
                             p.setPen(pen);
                             p.drawLine(l_inv);
                           }
-                        }
-
-                    QLine l_peak = clipQLine(i, y - peak - cc, i, y + peak, mbrwp);
-                    if(!l_peak.isNull())
-                    {
-                      pen.setColor(peak_color);
-                      p.setPen(pen);
-                      p.drawLine(l_peak);
+                          y += 2 * h;
+                          }
                     }
 
-                    QLine l_rms = clipQLine(i, y - rms - cc, i, y + rms, mbrwp);
-                    if(!l_rms.isNull())
-                    {
-                      pen.setColor(rms_color);
-                      p.setPen(pen);
-                      p.drawLine(l_rms);
+              const int n = MusECore::waveColumnLines(sa, ev_channels, style, lines);
+              for (int k = 0; k < n; ++k) {
+                    QLine l = clipQLine(i, lines[k].y1, i, lines[k].y2, mbrwp);
+                    if(l.isNull())
+                      continue;
+                    if (selected)
+                      pen.setColor(lines[k].inner ? MusEGlobal::config.waveRmsColorSelected : MusEGlobal::config.wavePeakColorSelected);
+                    else
+                      pen.setColor(lines[k].inner ? MusEGlobal::config.waveRmsColor : MusEGlobal::config.wavePeakColor);
+                    p.setPen(pen);
+                    p.drawLine(l);
                     }
-
-                    y += 2 * h;
-                  }
               }
             
         int hn = hh / ev_channels;
@@ -1097,6 +1103,44 @@ void WaveCanvas::drawItem(QPainter& p, const CItem* item, const QRect& mr, const
       p.setWorldMatrixEnabled(wmtxen);
 }
 
+//---------------------------------------------------------
+//   drawWaveTiles
+//    Draws the columns sx to ex of a wave event from
+//     pre-rendered tiles, pos is the sound file frame at sx.
+//    Returns false if they are not all rendered yet, the
+//     missing ones are queued then.
+//---------------------------------------------------------
+
+bool WaveCanvas::drawWaveTiles(QPainter& p, MusECore::SndFileR& f, int pos, int xScale, int sx, int ex, const QRect& clip,
+   const MusECore::WaveTileStyle& style)
+{
+      if (!MusECore::waveTilesUsable(f, xScale))
+            return false;
+
+      const int hh = style.height;
+
+      const int64_t tileFrames = int64_t(MusECore::waveTileWidth) * xScale;
+      const int64_t frame1 = std::max(int64_t(0), int64_t(pos));
+      const int64_t frame2 = std::max(frame1, int64_t(pos) + int64_t(ex - sx) * xScale);
+      const int64_t first = frame1 / tileFrames;
+      const int64_t last  = frame2 / tileFrames;
+
+      std::vector<QImage> tiles;
+      if (!MusECore::waveTiles(f.peakFile(), xScale, first, last, style, tiles))
+            return false;
+
+      p.save();
+      p.setClipRect(clip & QRect(sx, 0, ex - sx, hh), Qt::IntersectClip);
+      for (int64_t t = first; t <= last; ++t) {
+            // Round down, also left of pos.
+            int64_t d = t * tileFrames - pos;
+            d = d >= 0 ? d / xScale : -((-d + xScale - 1) / xScale);
+            p.drawImage(QPoint(sx + int(d), 0), tiles[t - first]);
+            }
+      p.restore();
+      return true;
+}
+
 //---------------------------------------------------------
 //   drawTopItem
 //---------------------------------------------------------
@@ -2382,7 +2426,7 @@ void WaveCanvas::editExternal(unsigned file_format, unsigned file_samplerate, un
           }
       QDir dir = exttmpFile.dirPath();
       dir.remove(exttmpFileName);
-      dir.remove(exttmpFile.basename() + ".wca");
+      QFile::remove(MusECore::peakFilePath(exttmpFileName));
       }
 
       
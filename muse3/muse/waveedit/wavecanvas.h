@@ -44,6 +44,7 @@ namespace MusECore {
 class SndFileR;
 class WavePart;
 class WaveTrack;
+struct WaveTileStyle;
 
 struct WaveEventSelection {
       Event event;         
@@ -110,6 +111,8 @@ class WaveCanvas : public EventCanvas {
       virtual void mouseMove(QMouseEvent* event);
       virtual void mouseRelease(const QPoint&);
       virtual void drawItem(QPainter&, const CItem*, const QRect&, const QRegion& = QRegion());
+      bool drawWaveTiles(QPainter&, MusECore::SndFileR&, int pos, int xScale, int sx, int ex, const QRect& clip,
+                         const MusECore::WaveTileStyle& style);
       void drawMarkers(QPainter& p, const QRect& mr, const QRegion& mrg = QRegion());
       
       void drawTopItem(QPainter& p, const QRect& rect, const QRegion& = QRegion());
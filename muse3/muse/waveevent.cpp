@@ -23,6 +23,7 @@
 
 #include "audioconvert.h"
 #include "globals.h"
+#include "gconfig.h"
 #include "event.h"
 #include "waveevent.h"
 #include "xml.h"
@@ -479,9 +480,16 @@ void WaveEventBase::readAudio(WavePart* /*part*/, unsigned offset, float** buffe
   off_t e_off = offset + _spos;
   if(e_off < 0)
     e_off = 0;
-  f.seek(e_off, 0);
-  f.read(channel, buffer, n, overwrite);
-      
+  {
+    std::lock_guard<std::mutex> guard(f->readLock());
+    f.seek(e_off, 0);
+    f.read(channel, buffer, n, overwrite);
+  }
+
+  // Ask the kernel to start reading the next chunk while this one is being played.
+  if(MusEGlobal::config.diskReadAheadHints)
+    f->adviseWillNeed(e_off + n, n);
+
   return;
   #endif
   
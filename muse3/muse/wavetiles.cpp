@@ -0,0 +1,462 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  wavetiles.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <list>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <tuple>
+#include <algorithm>
+
+#include "wavetiles.h"
+#include "peakfile.h"
+#include "wave.h"
+#include "gconfig.h"
+
+namespace MusECore {
+
+// Oldest requests beyond this are dropped, they have most likely scrolled out of view.
+static const size_t maxPendingTiles = 512;
+
+//---------------------------------------------------------
+//   WaveTileStyle
+//---------------------------------------------------------
+
+bool WaveTileStyle::operator<(const WaveTileStyle& s) const
+      {
+      return std::tie(mode, height, yScale, peakColor, rmsColor, drawRms)
+         < std::tie(s.mode, s.height, s.yScale, s.peakColor, s.rmsColor, s.drawRms);
+      }
+
+//---------------------------------------------------------
+//   WaveTileKey
+//---------------------------------------------------------
+
+struct WaveTileKey {
+      const PeakFile* pf;
+      int mag;
+      sf_count_t index;
+      WaveTileStyle style;
+
+      bool operator<(const WaveTileKey& k) const {
+            if (pf != k.pf)
+                  return pf < k.pf;
+            if (mag != k.mag)
+                  return mag < k.mag;
+            if (index != k.index)
+                  return index < k.index;
+            return style < k.style;
+            }
+      };
+
+//---------------------------------------------------------
+//   WaveTile
+//---------------------------------------------------------
+
+struct WaveTile {
+      QImage image;
+      std::list<WaveTileKey>::iterator lru;
+      };
+
+//---------------------------------------------------------
+//   WaveTileJob
+//---------------------------------------------------------
+
+struct WaveTileJob {
+      WaveTileKey key;
+      // Keeps the mapping alive while rendering.
+      std::shared_ptr<PeakFile> pf;
+      };
+
+//---------------------------------------------------------
+//   WaveTileRenderer
+//    Background thread rendering the requested tiles,
+//     most recent request first, into a cache bounded by
+//     config.waveTileCacheSize. Least recently drawn tiles
+//     are dropped first.
+//---------------------------------------------------------
+
+class WaveTileRenderer {
+      std::mutex _mutex;
+      std::condition_variable _cond;
+      std::list<WaveTileJob> _jobs;
+      std::set<WaveTileKey> _pending;
+      std::map<WaveTileKey, WaveTile> _tiles;
+      std::list<WaveTileKey> _lru;      // most recently used first
+      size_t _bytes;
+      pthread_t _thread;
+      bool _running;
+      bool _quit;
+      std::atomic<unsigned> _progress;
+
+      void insert(const WaveTileKey& key, const QImage& image);
+      static void* loop(void*);
+
+   public:
+      WaveTileRenderer() : _bytes(0), _running(false), _quit(false), _progress(0) {}
+      bool get(const std::shared_ptr<PeakFile>& pf, const WaveTileKey& key, QImage* image);
+      void invalidate(const PeakFile* pf);
+      void stop();
+      unsigned progress() const { return _progress; }
+      };
+
+static WaveTileRenderer waveTileRenderer;
+
+//---------------------------------------------------------
+//   vline
+//    Vertical line from y1 to y2 inclusive, like
+//     QPainter::drawLine() with a cosmetic pen.
+//---------------------------------------------------------
+
+static inline void vline(QImage* img, int x, int y1, int y2, QRgb c)
+      {
+      if (y1 > y2)
+            std::swap(y1, y2);
+      if (y1 < 0)
+            y1 = 0;
+      if (y2 >= img->height())
+            y2 = img->height() - 1;
+      for (int y = y1; y <= y2; ++y)
+            ((QRgb*)img->scanLine(y))[x] = c;
+      }
+
+//---------------------------------------------------------
+//   waveColumnLines
+//---------------------------------------------------------
+
+int waveColumnLines(const SampleV* sa, unsigned channels, const WaveTileStyle& st, WaveColumnLine* lines)
+      {
+      const int rectHeight = st.height;
+      int n = 0;
+      switch (st.mode) {
+            case WaveTileStyle::Combined: {
+                  const int y  = rectHeight >> 1;
+                  const int cc = rectHeight % 2 ? 0 : 1;
+                  int peak = 0;
+                  int rms  = 0;
+                  for (unsigned k = 0; k < channels; ++k) {
+                        if (sa[k].peak > peak)
+                              peak = sa[k].peak;
+                        rms += sa[k].rms;
+                        }
+                  rms /= channels;
+                  peak = (peak * (rectHeight-2)) >> 9;
+                  rms  = (rms  * (rectHeight-2)) >> 9;
+                  const int inner = st.drawRms ? rms : peak - 1;
+                  lines[n].y1 = y - peak - cc;
+                  lines[n].y2 = y + peak;
+                  lines[n++].inner = false;
+                  lines[n].y1 = y - inner - cc;
+                  lines[n].y2 = y + inner;
+                  lines[n++].inner = true;
+                  }
+                  break;
+
+            case WaveTileStyle::Channels: {
+                  const int hm = rectHeight / (channels * 2);
+                  const int cc = rectHeight % (channels * 2) ? 0 : 1;
+                  int y = hm;
+                  for (unsigned k = 0; k < channels; ++k) {
+                        const int peak = (sa[k].peak * (hm - 1)) >> 8;
+                        const int rms  = (sa[k].rms  * (hm - 1)) >> 8;
+                        const int inner = st.drawRms ? rms : peak - 1;
+                        lines[n].y1 = y - peak - cc;
+                        lines[n].y2 = y + peak;
+                        lines[n++].inner = false;
+                        lines[n].y1 = y - inner - cc;
+                        lines[n].y2 = y + inner;
+                        lines[n++].inner = true;
+                        y += 2 * hm;
+                        }
+                  }
+                  break;
+
+            case WaveTileStyle::Editor: {
+                  const int h  = rectHeight / (channels * 2);
+                  const int cc = rectHeight % (channels * 2) ? 0 : 1;
+                  int y = h;
+                  for (unsigned k = 0; k < channels; ++k) {
+                        int peak = (sa[k].peak * (h - 1)) / st.yScale;
+                        int rms  = (sa[k].rms  * (h - 1)) / st.yScale;
+                        if (peak > h)
+                              peak = h;
+                        if (rms > h)
+                              rms = h;
+                        lines[n].y1 = y - peak - cc;
+                        lines[n].y2 = y + peak;
+                        lines[n++].inner = false;
+                        lines[n].y1 = y - rms - cc;
+                        lines[n].y2 = y + rms;
+                        lines[n++].inner = true;
+                        y += 2 * h;
+                        }
+                  }
+                  break;
+            }
+      return n;
+      }
+
+//---------------------------------------------------------
+//   renderTile
+//---------------------------------------------------------
+
+static QImage renderTile(const PeakFile* pf, int mag, sf_count_t index, const WaveTileStyle& st)
+      {
+      QImage img(waveTileWidth, st.height, QImage::Format_ARGB32_Premultiplied);
+      img.fill(0);
+      const unsigned channels = pf->channels();
+      const sf_count_t frames = pf->frames();
+      SampleV sa[channels];
+      WaveColumnLine lines[2 * channels];
+      sf_count_t pos = index * waveTileWidth * mag;
+
+      for (int x = 0; x < waveTileWidth && pos < frames; ++x, pos += mag) {
+            for (unsigned k = 0; k < channels; ++k) {
+                  sa[k].peak = 0;
+                  sa[k].rms  = 0;
+                  }
+            pf->read(sa, mag, pos, true);
+            const int n = waveColumnLines(sa, channels, st, lines);
+            for (int i = 0; i < n; ++i)
+                  vline(&img, x, lines[i].y1, lines[i].y2, lines[i].inner ? st.rmsColor : st.peakColor);
+            }
+      return img;
+      }
+
+//---------------------------------------------------------
+//   get
+//    Returns true if the tile is there, else queues it.
+//---------------------------------------------------------
+
+bool WaveTileRenderer::get(const std::shared_ptr<PeakFile>& pf, const WaveTileKey& key, QImage* image)
+      {
+      // Released after the lock, a peak file's destructor invalidates.
+      std::list<WaveTileJob> dropped;
+      std::lock_guard<std::mutex> guard(_mutex);
+      std::map<WaveTileKey, WaveTile>::iterator it = _tiles.find(key);
+      if (it != _tiles.end()) {
+            _lru.splice(_lru.begin(), _lru, it->second.lru);
+            *image = it->second.image;
+            return true;
+            }
+      if (_quit || _pending.find(key) != _pending.end())
+            return false;
+      if (!_running) {
+            if (pthread_create(&_thread, 0, loop, this)) {
+                  fprintf(stderr, "WaveTileRenderer: cannot create thread: %s\n", strerror(errno));
+                  return false;
+                  }
+            _running = true;
+            }
+      WaveTileJob job;
+      job.key = key;
+      job.pf  = pf;
+      _jobs.push_front(job);
+      _pending.insert(key);
+      if (_jobs.size() > maxPendingTiles) {
+            _pending.erase(_jobs.back().key);
+            dropped.splice(dropped.begin(), _jobs, --_jobs.end());
+            }
+      _cond.notify_one();
+      return false;
+      }
+
+//---------------------------------------------------------
+//   insert
+//    called with the mutex locked
+//---------------------------------------------------------
+
+void WaveTileRenderer::insert(const WaveTileKey& key, const QImage& image)
+      {
+      const size_t budget = size_t(MusEGlobal::config.waveTileCacheSize) * 1024 * 1024;
+      std::pair<std::map<WaveTileKey, WaveTile>::iterator, bool> res =
+         _tiles.insert(std::make_pair(key, WaveTile()));
+      if (!res.second)
+            return;
+      _lru.push_front(key);
+      res.first->second.image = image;
+      res.first->second.lru = _lru.begin();
+      _bytes += image.byteCount();
+
+      while (_bytes > budget && _lru.size() > 1) {
+            std::map<WaveTileKey, WaveTile>::iterator it = _tiles.find(_lru.back());
+            _bytes -= it->second.image.byteCount();
+            _tiles.erase(it);
+            _lru.pop_back();
+            }
+      }
+
+//---------------------------------------------------------
+//   invalidate
+//---------------------------------------------------------
+
+void WaveTileRenderer::invalidate(const PeakFile* pf)
+      {
+      std::lock_guard<std::mutex> guard(_mutex);
+      std::map<WaveTileKey, WaveTile>::iterator it = _tiles.begin();
+      while (it != _tiles.end()) {
+            if (it->first.pf == pf) {
+                  _bytes -= it->second.image.byteCount();
+                  _lru.erase(it->second.lru);
+                  _tiles.erase(it++);
+                  }
+            else
+                  ++it;
+            }
+      }
+
+//---------------------------------------------------------
+//   stop
+//---------------------------------------------------------
+
+void WaveTileRenderer::stop()
+      {
+      std::list<WaveTileJob> dropped;
+      {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _quit = true;
+      dropped.swap(_jobs);
+      _pending.clear();
+      _tiles.clear();
+      _lru.clear();
+      _bytes = 0;
+      _cond.notify_one();
+      if (!_running)
+            return;
+      }
+      pthread_join(_thread, 0);
+      _running = false;
+      }
+
+//---------------------------------------------------------
+//   loop
+//---------------------------------------------------------
+
+void* WaveTileRenderer::loop(void* arg)
+      {
+      WaveTileRenderer* r = (WaveTileRenderer*)arg;
+      for (;;) {
+            WaveTileJob job;
+            {
+            std::unique_lock<std::mutex> lock(r->_mutex);
+            while (!r->_quit && r->_jobs.empty())
+                  r->_cond.wait(lock);
+            if (r->_quit)
+                  break;
+            job = r->_jobs.front();
+            r->_jobs.pop_front();
+            }
+
+            QImage image;
+            // Nobody but us is interested anymore?
+            if (job.pf.use_count() > 1)
+                  image = renderTile(job.pf.get(), job.key.mag, job.key.index, job.key.style);
+
+            {
+            std::lock_guard<std::mutex> guard(r->_mutex);
+            r->_pending.erase(job.key);
+            if (!image.isNull() && !r->_quit)
+                  r->insert(job.key, image);
+            }
+            ++r->_progress;
+            // Release the peak file outside of the lock, its destructor invalidates.
+            job.pf.reset();
+            }
+      return 0;
+      }
+
+//---------------------------------------------------------
+//   waveTilesUsable
+//---------------------------------------------------------
+
+bool waveTilesUsable(const SndFileR& f, int mag)
+      {
+      if (MusEGlobal::config.waveTileCacheSize <= 0 || mag < peakFileBaseMag)
+            return false;
+      return f.peakFile().get() != 0;
+      }
+
+//---------------------------------------------------------
+//   waveTiles
+//---------------------------------------------------------
+
+bool waveTiles(const std::shared_ptr<PeakFile>& pf, int mag, sf_count_t first, sf_count_t last,
+   const WaveTileStyle& style, std::vector<QImage>& tiles)
+      {
+      tiles.clear();
+      if (!pf || first > last)
+            return false;
+      // Anything not built yet would be cached as silence.
+      const sf_count_t done = pf->isComplete() ? pf->frames() : pf->framesDone();
+      const sf_count_t tileFrames = sf_count_t(waveTileWidth) * mag;
+      const sf_count_t lastFrame = std::min((last + 1) * tileFrames, pf->frames());
+      if (done < lastFrame)
+            return false;
+
+      WaveTileKey key;
+      key.pf    = pf.get();
+      key.mag   = mag;
+      key.style = style;
+      bool all = true;
+      tiles.resize(last - first + 1);
+      for (sf_count_t i = first; i <= last; ++i) {
+            key.index = i;
+            if (!waveTileRenderer.get(pf, key, &tiles[i - first]))
+                  all = false;
+            }
+      return all;
+      }
+
+//---------------------------------------------------------
+//   invalidateWaveTiles
+//---------------------------------------------------------
+
+void invalidateWaveTiles(const PeakFile* pf)
+      {
+      waveTileRenderer.invalidate(pf);
+      }
+
+//---------------------------------------------------------
+//   waveTileProgress
+//---------------------------------------------------------
+
+unsigned waveTileProgress()
+      {
+      return waveTileRenderer.progress();
+      }
+
+//---------------------------------------------------------
+//   exitWaveTileRenderer
+//---------------------------------------------------------
+
+void exitWaveTileRenderer()
+      {
+      waveTileRenderer.stop();
+      }
+
+} // namespace MusECore
@@ -0,0 +1,96 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  wavetiles.h
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __WAVETILES_H__
+#define __WAVETILES_H__
+
+#include <memory>
+#include <vector>
+#include <sndfile.h>
+
+#include <QImage>
+#include <QRgb>
+
+namespace MusECore {
+
+class PeakFile;
+class SndFileR;
+struct SampleV;
+
+// Pixel columns per tile.
+const int waveTileWidth = 256;
+
+//---------------------------------------------------------
+//   WaveTileStyle
+//    How the columns of a tile are drawn. Part of the
+//     cache key, tiles of an old style just age out.
+//---------------------------------------------------------
+
+struct WaveTileStyle {
+      enum Mode {
+            Combined,         // arranger, all channels in one wave
+            Channels,         // arranger, one wave per channel
+            Editor            // wave editor, one wave per channel, vertical zoom
+            };
+      int mode;
+      int height;
+      int yScale;             // Editor only
+      QRgb peakColor;
+      QRgb rmsColor;
+      bool drawRms;           // Else draws the outline. The editor always draws rms.
+
+      bool operator<(const WaveTileStyle& s) const;
+      };
+
+//---------------------------------------------------------
+//   WaveColumnLine
+//    One vertical line of a pixel column, y1 to y2
+//     inclusive from the top of the wave's rectangle.
+//---------------------------------------------------------
+
+struct WaveColumnLine {
+      int y1;
+      int y2;
+      bool inner;             // Rms or outline, drawn over the peak line.
+      };
+
+// The lines of one pixel column, from the channels' peak and rms. Shared by the tiles
+//  and the direct drawing. 'lines' needs room for 2 * channels, returns the number of lines.
+extern int waveColumnLines(const SampleV* sa, unsigned channels, const WaveTileStyle& style, WaveColumnLine* lines);
+// Whether the file can be drawn from tiles at the given frames per pixel.
+// Only read only files with a peak file, and not finer than the peak file.
+extern bool waveTilesUsable(const SndFileR& f, int mag);
+// Fills 'tiles' with the tiles first to last of the peak file, and returns true
+//  if they are all rendered. Missing ones are queued for the background thread,
+//  which bumps waveTileProgress() when they are ready.
+extern bool waveTiles(const std::shared_ptr<PeakFile>& pf, int mag, sf_count_t first, sf_count_t last,
+   const WaveTileStyle& style, std::vector<QImage>& tiles);
+// Drops all tiles of the peak file. Called when the peak file goes away.
+extern void invalidateWaveTiles(const PeakFile* pf);
+// Changes whenever tiles were rendered, so that the gui can redraw the waves.
+extern unsigned waveTileProgress();
+// Stops the background thread, at exit.
+extern void exitWaveTileRenderer();
+
+} // namespace MusECore
+
+#endif
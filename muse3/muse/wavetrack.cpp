@@ -99,6 +99,23 @@ void WaveTrack::fetchData(unsigned pos, unsigned samples, float** bp, bool doSee
       fprintf(stderr, "WaveTrack::fetchData %s samples:%u pos:%u overwrite:%d\n", name().toLatin1().constData(), samples, pos, overwrite);
       #endif
 
+      readData(pos, samples, bp, doSeek, overwrite);
+      _prefetchFifo.add();
+      }
+
+//---------------------------------------------------------
+//   readData
+//    called from prefetch thread or its workers
+//---------------------------------------------------------
+
+void WaveTrack::readData(unsigned pos, unsigned samples, float** bp, bool doSeek, bool overwrite)
+      {
+      if(frozen())
+      {
+        AudioTrack::readData(pos, samples, bp, doSeek, overwrite);
+        return;
+      }
+
       // reset buffer to zero
       if(overwrite)
         for (int i = 0; i < channels(); ++i)
@@ -165,8 +182,6 @@ void WaveTrack::fetchData(unsigned pos, unsigned samples, float** bp, bool doSee
                   for (unsigned int j = 0; j < samples; ++j)
                       bp[i][j] +=MusEGlobal::denormalBias;
             }
-
-      _prefetchFifo.add();
       }
 
 //---------------------------------------------------------
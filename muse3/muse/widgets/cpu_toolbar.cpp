@@ -24,6 +24,9 @@
 #include <QString>
 #include <QToolButton>
 #include <QLatin1Char>
+#include <QStringList>
+
+#include <algorithm>
 
 #include "cpu_toolbar.h"
 #include "icons.h"
@@ -141,13 +144,17 @@ void CpuToolbar::init()
   _dspLabel->setPrecision(1);
   _xrunsLabel = new PaddedValueLabel(false, this, 0, "XRUNS:");
   _xrunsLabel->setFieldWidth(3);
+  _diskLabel = new PaddedValueLabel(false, this, 0, "DISK:", "%");
+  _diskLabel->setFieldWidth(3);
 
   setValues(0.0f, 0.0f, 0);
+  setDiskFill(QList<QPair<QString, int> >());
   
   addWidget(_resetButton);
   addWidget(_cpuLabel);
   addWidget(_dspLabel);
   addWidget(_xrunsLabel);
+  addWidget(_diskLabel);
 
   connect(_resetButton, SIGNAL(clicked(bool)), SIGNAL(resetClicked()));
 }
@@ -159,5 +166,27 @@ void CpuToolbar::setValues(float cpuLoad, float dspLoad, long xRunsCount)
   _xrunsLabel->setIntValue(xRunsCount);
 }
 
+static bool lessFill(const QPair<QString, int>& a, const QPair<QString, int>& b)
+{
+  return a.second < b.second;
+}
+
+void CpuToolbar::setDiskFill(const QList<QPair<QString, int> >& trackFills)
+{
+  QList<QPair<QString, int> > fills(trackFills);
+  std::stable_sort(fills.begin(), fills.end(), lessFill);
+  _diskLabel->setIntValue(fills.isEmpty() ? 100 : fills.first().second);
+
+  QStringList lines;
+  lines << tr("Lowest disk prefetch buffer fill of each wave track during the last gui-update period");
+  // The emptiest ones first. Large songs would make the tooltip taller than the screen.
+  const int maxLines = 24;
+  for(int i = 0; i < fills.size() && i < maxLines; ++i)
+    lines << QString("%1: %2%").arg(fills.at(i).first).arg(fills.at(i).second);
+  if(fills.size() > maxLines)
+    lines << tr("%n more", "", fills.size() - maxLines);
+  _diskLabel->setToolTip(lines.join(QLatin1Char('\n')));
+}
+
 
 }  // namespace MusEGui
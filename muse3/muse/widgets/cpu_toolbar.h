@@ -25,6 +25,8 @@
 
 #include <QLabel>
 #include <QToolBar>
+#include <QList>
+#include <QPair>
 
 class QWidget;
 class QString;
@@ -80,6 +82,7 @@ namespace MusEGui
       PaddedValueLabel* _cpuLabel;
       PaddedValueLabel* _dspLabel;
       PaddedValueLabel* _xrunsLabel;
+      PaddedValueLabel* _diskLabel;
 
       void init();
       
@@ -91,6 +94,9 @@ namespace MusEGui
       void setDspLabelText(const QString&);
       void setXrunsLabelText(const QString&);
       void setValues(float cpuLoad, float dspLoad, long xRunsCount);
+      // Lowest disk prefetch buffer fill in percent of each wave track, by track name.
+      // Shows the lowest one, the tooltip lists them all.
+      void setDiskFill(const QList<QPair<QString, int> >& trackFills);
       
     signals:
       void resetClicked();
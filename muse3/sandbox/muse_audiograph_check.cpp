@@ -0,0 +1,243 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  muse_audiograph_check.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//   Checks that the AudioGraph workers produce the same
+//    output as the serial pulls of the Output tracks.
+//   A tree of Group tracks is fed by tone tracks: eight
+//    tones, mixed in pairs by four groups, then by two,
+//    then by one. The top group is pulled once per cycle
+//    the way an Output track pulls its input routes.
+//   The song is rendered once without workers, then again
+//    with AudioGraph::process() running the tracks on the
+//    workers first. The buffers and the track meters must
+//    be bit for bit the same.
+//   Returns 0 if the renders match.
+//---------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <unistd.h>
+
+#include <QCoreApplication>
+#include <QString>
+
+#include "audio.h"
+#include "audiograph.h"
+#include "gconfig.h"
+#include "globals.h"
+#include "route.h"
+#include "song.h"
+#include "track.h"
+
+namespace MusECore {
+extern void initAudio();
+}
+
+namespace MusEAudioGraphCheck {
+
+static const int sampleRate = 48000;
+static const unsigned segment = 256;
+static const unsigned cycles = 400;
+
+//---------------------------------------------------------
+//   ToneTrack
+//    A Group track with a fixed tone instead of inputs.
+//---------------------------------------------------------
+
+class ToneTrack : public MusECore::AudioGroup {
+      double _freq;
+
+   public:
+      ToneTrack(double freq) : MusECore::AudioGroup(), _freq(freq) { }
+      virtual bool getData(unsigned pos, int channels, unsigned nframes, float** buffer)
+            {
+            for (int c = 0; c < channels; ++c)
+                  for (unsigned i = 0; i < nframes; ++i)
+                        buffer[c][i] = 0.1 * std::sin(2.0 * M_PI * _freq * (c + 1) * (pos + i) / sampleRate);
+            return true;
+            }
+      };
+
+//---------------------------------------------------------
+//   connect
+//---------------------------------------------------------
+
+static void connect(MusECore::AudioTrack* src, MusECore::AudioTrack* dst)
+      {
+      src->outRoutes()->push_back(MusECore::Route(dst));
+      dst->inRoutes()->push_back(MusECore::Route(src));
+      }
+
+//---------------------------------------------------------
+//   buildSong
+//    Returns the top group.
+//---------------------------------------------------------
+
+static MusECore::AudioTrack* buildSong()
+      {
+      MusECore::TrackList* tl = MusEGlobal::song->tracks();
+      std::vector<MusECore::AudioTrack*> level;
+      for (int i = 0; i < 8; ++i) {
+            MusECore::AudioTrack* t = new ToneTrack(110.0 * (i + 1) + 7.0 * i);
+            t->setName(QString("tone %1").arg(i));
+            // Different volumes and pans, so swapped inputs would show.
+            t->setVolume(0.3 + 0.1 * i);
+            t->setPan(-0.8 + 0.2 * i);
+            tl->push_back(t);
+            level.push_back(t);
+            }
+      int n = 0;
+      while (level.size() > 1) {
+            std::vector<MusECore::AudioTrack*> next;
+            for (unsigned i = 0; i < level.size(); i += 2) {
+                  MusECore::AudioTrack* g = new MusECore::AudioGroup();
+                  g->setName(QString("group %1").arg(n++));
+                  connect(level[i], g);
+                  connect(level[i + 1], g);
+                  tl->push_back(g);
+                  next.push_back(g);
+                  }
+            level = next;
+            }
+      return level[0];
+      }
+
+//---------------------------------------------------------
+//   render
+//    Follows Audio::process1(): reset the processed flags,
+//     let the graph run, then pull like an Output track.
+//---------------------------------------------------------
+
+static void render(MusECore::AudioGraph* graph, MusECore::AudioTrack* top,
+   std::vector<float>& left, std::vector<float>& right, std::vector<double>& meters)
+      {
+      MusECore::TrackList* tl = MusEGlobal::song->tracks();
+      left.assign(segment * cycles, 0.0f);
+      right.assign(segment * cycles, 0.0f);
+      meters.clear();
+      for (unsigned cycle = 0; cycle < cycles; ++cycle) {
+            const unsigned pos = cycle * segment;
+            for (MusECore::ciTrack it = tl->begin(); it != tl->end(); ++it)
+                  (*it)->preProcessAlways();
+            if (graph)
+                  graph->process(pos, segment);
+            float* buffer[2] = { left.data() + pos, right.data() + pos };
+            top->copyData(pos, -1, 2, 2, -1, -1, segment, buffer);
+            for (MusECore::ciTrack it = tl->begin(); it != tl->end(); ++it) {
+                  MusECore::AudioTrack* t = (MusECore::AudioTrack*)*it;
+                  for (int c = 0; c < t->channels(); ++c)
+                        meters.push_back(t->meter(c));
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   compare
+//---------------------------------------------------------
+
+static unsigned compare(const std::vector<float>& a, const std::vector<float>& b)
+      {
+      for (unsigned i = 0; i < a.size(); ++i)
+            if (a[i] != b[i])
+                  return i;
+      return a.size();
+      }
+
+} // namespace MusEAudioGraphCheck
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      using namespace MusEAudioGraphCheck;
+
+      QCoreApplication app(argc, argv);
+
+      int threads = 3;
+      int c;
+      while ((c = getopt(argc, argv, "j:")) != EOF) {
+            switch (c) {
+                  case 'j': threads = atoi(optarg); break;
+                  default:  std::fprintf(stderr, "%s: -j <worker threads>\n", argv[0]);
+                            return -1;
+                  }
+            }
+      if (threads < 1)
+            threads = 1;
+
+      MusEGlobal::sampleRate = sampleRate;
+      MusEGlobal::segmentSize = segment;
+      MusEGlobal::config.latencyCompensation = false;
+      MusEGlobal::config.useDenormalBias = false;
+      MusECore::initAudio();
+      MusEGlobal::song = new MusECore::Song("song");
+      MusECore::AudioTrack* top = buildSong();
+
+      // The reference: everything pulled serially by the top group.
+      std::vector<float> refLeft, refRight;
+      std::vector<double> refMeters;
+      render(0, top, refLeft, refRight, refMeters);
+
+      MusECore::AudioGraph* graph = new MusECore::AudioGraph();
+      graph->start(threads, 0);
+      if (!graph->isRunning()) {
+            std::fprintf(stderr, "cannot start the worker threads\n");
+            return 1;
+            }
+      std::vector<float> left, right;
+      std::vector<double> meters;
+      render(graph, top, left, right, meters);
+      std::printf("%u tracks, %u cycles of %u frames, %d workers\n",
+         unsigned(MusEGlobal::song->tracks()->size()), cycles, segment, graph->workerThreads());
+      delete graph;
+
+      bool ok = true;
+      double level = 0.0;
+      for (unsigned i = 0; i < refLeft.size(); ++i)
+            level += std::fabs(refLeft[i]) + std::fabs(refRight[i]);
+      if (level == 0.0) {
+            std::printf("  the reference render is silent\n");
+            ok = false;
+            }
+
+      const unsigned l = compare(refLeft, left);
+      const unsigned r = compare(refRight, right);
+      if (l != refLeft.size() || r != refRight.size()) {
+            std::printf("  output differs from frame %u  FAILED\n", l < r ? l : r);
+            ok = false;
+            }
+      else
+            std::printf("  output ok\n");
+
+      bool metersMatch = refMeters.size() == meters.size();
+      for (unsigned i = 0; metersMatch && i < meters.size(); ++i)
+            metersMatch = refMeters[i] == meters[i];
+      std::printf("  meters %s\n", metersMatch ? "ok" : "FAILED");
+      ok = ok && metersMatch;
+
+      return ok ? 0 : 1;
+      }
@@ -0,0 +1,429 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  muse_automation_bench.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//   CPU use of an automated plugin against automation density.
+//
+//   A synthetic stereo plugin (one lowpass biquad per control
+//    port, its coefficients computed from the control value at
+//    the start of each run) is played through random automation
+//    on all of its ports, with the run planning of PluginI::apply():
+//
+//    old:   As before plugin_runs.h. Every min_per during ramps,
+//           at every automation point, no limit per cycle.
+//    new:   ctrlRunFrames(), longestRunFrames() and boundRunFrames()
+//           from plugin_runs.h, as PluginI::apply() calls them.
+//    audio: Audio rate control ports: One run per cycle, the
+//           automation filled into per sample buffers, the
+//           plugin computing its coefficients every sample.
+//
+//   Prints runs per cycle, time per cycle and the largest error
+//    of the control values the plugin saw, in fractions of the
+//    controller's range.
+//   Checks that bounding the runs per cycle never makes the new
+//    planning less accurate than the old one by more than
+//    1 / pluginCtrlLongestRunSteps of the range.
+//   Returns 0 if the check passes, 1 otherwise.
+//   A real plugin's cost per run (host side: interpolating and
+//    connecting ports, plugin side: its setup per run) decides how
+//    much fewer runs save. Only the planning and the biquad setup
+//    are measured here.
+//---------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <time.h>
+
+#include "plugin_runs.h"
+
+namespace MusEAutomationBench {
+
+enum Planner { OldPlanner, NewPlanner, AudioRate };
+static const char* plannerNames[] = { "old", "new", "audio" };
+
+struct Point {
+      unsigned long frame;
+      double value;
+      };
+
+//---------------------------------------------------------
+//   Port
+//    Automation of one control port, with a cursor to the
+//     segment being played.
+//---------------------------------------------------------
+
+struct Biquad {
+      float b0, b1, b2, a1, a2;
+      };
+
+struct Port {
+      std::vector<Point> points;
+      size_t cur;
+      float z[2][2];    // filter state, per channel
+      Biquad coef;
+
+      void rewind() { cur = 0; z[0][0] = z[0][1] = z[1][0] = z[1][1] = 0.0f; coef = Biquad(); }
+      // Moves the cursor to the segment containing frame, and returns
+      //  whether there is a next point.
+      bool seek(unsigned long frame) {
+            while (cur + 1 < points.size() && points[cur + 1].frame <= frame)
+                  ++cur;
+            return cur + 1 < points.size();
+            }
+      double value(unsigned long frame, bool ramps) const {
+            const Point& s = points[cur];
+            if (!ramps || cur + 1 >= points.size() || frame <= s.frame)
+                  return s.value;
+            const Point& e = points[cur + 1];
+            return s.value + (e.value - s.value) * double(frame - s.frame) / double(e.frame - s.frame);
+            }
+      };
+
+struct Config {
+      unsigned long sampleRate;
+      unsigned long period;
+      unsigned long minPer;
+      int ports;
+      double seconds;
+      bool ramps;
+      int repeats;
+      };
+
+//---------------------------------------------------------
+//   nowNs
+//---------------------------------------------------------
+
+static double nowNs()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return double(ts.tv_sec) * 1e9 + double(ts.tv_nsec);
+      }
+
+//---------------------------------------------------------
+//   makeAutomation
+//    density points per second, at random positions
+//     around an even spacing, with random values.
+//---------------------------------------------------------
+
+static void makeAutomation(std::vector<Port>& ports, const Config& cfg, double density, unsigned seed)
+      {
+      srand(seed);
+      const unsigned long total = (unsigned long)(cfg.seconds * cfg.sampleRate);
+      for (size_t k = 0; k < ports.size(); ++k) {
+            std::vector<Point>& pts = ports[k].points;
+            pts.clear();
+            Point p;
+            p.frame = 0;
+            p.value = double(rand()) / RAND_MAX;
+            pts.push_back(p);
+            if (density > 0.0) {
+                  const double spacing = double(cfg.sampleRate) / density;
+                  for (double f = spacing; f < total; f += spacing) {
+                        p.frame = (unsigned long)(f + spacing * 0.5 * (double(rand()) / RAND_MAX - 0.5));
+                        if (p.frame <= pts.back().frame)
+                              continue;
+                        p.value = double(rand()) / RAND_MAX;
+                        pts.push_back(p);
+                        }
+                  }
+            ports[k].rewind();
+            }
+      }
+
+//---------------------------------------------------------
+//   lowpass
+//    Biquad lowpass, the cutoff (20 Hz .. 20 kHz) taken
+//     from the control value.
+//---------------------------------------------------------
+
+static inline Biquad lowpass(double value, unsigned long sampleRate)
+      {
+      const double fc = 20.0 * pow(1000.0, value);
+      const double w = 2.0 * M_PI * std::min(fc, 0.45 * sampleRate) / double(sampleRate);
+      const double alpha = sin(w) / (2.0 * M_SQRT1_2);
+      const double cw = cos(w);
+      const double a0 = 1.0 + alpha;
+      Biquad q;
+      q.b0 = float((1.0 - cw) * 0.5 / a0);
+      q.b1 = float((1.0 - cw) / a0);
+      q.b2 = q.b0;
+      q.a1 = float(-2.0 * cw / a0);
+      q.a2 = float((1.0 - alpha) / a0);
+      return q;
+      }
+
+// One sample through the filter, transposed direct form II.
+static inline float biquad(const Biquad& q, float* z, float x)
+      {
+      const float y = q.b0 * x + z[0];
+      z[0] = q.b1 * x - q.a1 * y + z[1];
+      z[1] = q.b2 * x - q.a2 * y;
+      return y;
+      }
+
+//---------------------------------------------------------
+//   runPlugin
+//---------------------------------------------------------
+
+static void runPlugin(std::vector<Port>& ports, float** buf, unsigned long offset, unsigned long n)
+      {
+      float* l = buf[0] + offset;
+      float* r = buf[1] + offset;
+      for (size_t k = 0; k < ports.size(); ++k) {
+            Port& p = ports[k];
+            for (unsigned long i = 0; i < n; ++i) {
+                  l[i] = biquad(p.coef, p.z[0], l[i]);
+                  r[i] = biquad(p.coef, p.z[1], r[i]);
+                  }
+            }
+      }
+
+static void runPluginAudioRate(std::vector<Port>& ports, float** buf, float** ctrl, unsigned long n, unsigned long sampleRate)
+      {
+      float* l = buf[0];
+      float* r = buf[1];
+      for (size_t k = 0; k < ports.size(); ++k) {
+            Port& p = ports[k];
+            const float* cv = ctrl[k];
+            for (unsigned long i = 0; i < n; ++i) {
+                  const Biquad q = lowpass(cv[i], sampleRate);
+                  l[i] = biquad(q, p.z[0], l[i]);
+                  r[i] = biquad(q, p.z[1], r[i]);
+                  }
+            }
+      }
+
+struct Result {
+      double runsAvg;
+      unsigned long runsMax;
+      double nsPerCycle;
+      double maxError;
+      };
+
+//---------------------------------------------------------
+//   play
+//    Plays all of the automation through the plugin, one
+//     cycle of cfg.period frames at a time.
+//---------------------------------------------------------
+
+static Result play(std::vector<Port>& ports, const Config& cfg, Planner planner, bool measureError)
+      {
+      const unsigned long n = cfg.period;
+      const unsigned long min_per = cfg.minPer > n ? n : cfg.minPer;
+      const unsigned long min_per_mask = min_per - 1;
+      const unsigned long total = (unsigned long)(cfg.seconds * cfg.sampleRate);
+      const unsigned long cycles = total / n;
+
+      std::vector<float> left(n), right(n);
+      float* buf[2] = { &left[0], &right[0] };
+      std::vector<std::vector<float> > ctrlBufs(ports.size(), std::vector<float>(n));
+      std::vector<float*> ctrl(ports.size());
+      for (size_t k = 0; k < ports.size(); ++k) {
+            ctrl[k] = &ctrlBufs[k][0];
+            ports[k].rewind();
+            }
+      float noise = 0.0f;
+      // Keeps the compiler from dropping the plugin's work.
+      volatile float sink = 0.0f;
+
+      Result r;
+      r.runsAvg = 0.0;
+      r.runsMax = 0;
+      r.maxError = 0.0;
+      unsigned long runs = 0;
+
+      const double t0 = nowNs();
+      for (unsigned long c = 0; c < cycles; ++c) {
+            const unsigned long pos = c * n;
+            // Some cheap input.
+            for (unsigned long i = 0; i < n; ++i) {
+                  noise = noise * 0.5f + float(i & 7) * 0.01f;
+                  left[i] = right[i] = noise;
+                  }
+
+            unsigned long cycleRuns = 0;
+            if (planner == AudioRate) {
+                  for (size_t k = 0; k < ports.size(); ++k) {
+                        Port& p = ports[k];
+                        for (unsigned long i = 0; i < n; ++i) {
+                              p.seek(pos + i);
+                              ctrl[k][i] = p.value(pos + i, cfg.ramps);
+                              }
+                        }
+                  runPluginAudioRate(ports, buf, &ctrl[0], n, cfg.sampleRate);
+                  cycleRuns = 1;
+                  }
+            else {
+                  unsigned long sample = 0;
+                  int cur_slice = 0;
+                  while (sample < n) {
+                        unsigned long nsamp = n - sample;
+                        unsigned long longest = n - sample;
+                        const unsigned long frame = pos + sample;
+                        for (size_t k = 0; k < ports.size(); ++k) {
+                              Port& p = ports[k];
+                              const bool end_valid = p.seek(frame);
+                              const unsigned long to_end = end_valid ? p.points[p.cur + 1].frame - frame : 0;
+                              const bool ramp = cfg.ramps && end_valid;
+                              unsigned long samps;
+                              if (planner == OldPlanner) {
+                                    samps = end_valid ? to_end : nsamp;
+                                    if (!ramp && samps > min_per)
+                                          samps &= ~min_per_mask;
+                                    else
+                                          samps = min_per;
+                                    }
+                              else {
+                                    const unsigned long ramp_frames = (ramp && to_end >= 2 * min_per) ? MusECore::rampStepFrames(frame,
+                                       p.points[p.cur].frame, p.points[p.cur + 1].frame,
+                                       p.points[p.cur].value, p.points[p.cur + 1].value,
+                                       1.0, MusECore::pluginCtrlRampSteps) : 0;
+                                    samps = MusECore::ctrlRunFrames(nsamp, ramp, ramp_frames, end_valid, to_end, min_per);
+                                    if (longest > min_per) {
+                                          const unsigned long most = MusECore::longestRunFrames(n - sample, ramp,
+                                             ramp_frames, end_valid, to_end, min_per);
+                                          if (most < longest)
+                                                longest = most;
+                                          }
+                                    }
+                              if (samps < nsamp)
+                                    nsamp = samps;
+                              p.coef = lowpass(p.value(frame, cfg.ramps), cfg.sampleRate);
+                              }
+                        if (planner == NewPlanner)
+                              nsamp = MusECore::boundRunFrames(nsamp, longest, n - sample, cur_slice, min_per);
+
+                        if (measureError) {
+                              for (size_t k = 0; k < ports.size(); ++k) {
+                                    Port& p = ports[k];
+                                    const size_t cur = p.cur;
+                                    const double held = p.value(frame, cfg.ramps);
+                                    for (unsigned long i = 0; i < nsamp; ++i) {
+                                          p.seek(frame + i);
+                                          const double e = fabs(p.value(frame + i, cfg.ramps) - held);
+                                          if (e > r.maxError)
+                                                r.maxError = e;
+                                          }
+                                    p.cur = cur;
+                                    }
+                              }
+
+                        runPlugin(ports, buf, sample, nsamp);
+                        sample += nsamp;
+                        ++cur_slice;
+                        ++cycleRuns;
+                        }
+                  }
+            sink = sink + left[n - 1];
+            runs += cycleRuns;
+            if (cycleRuns > r.runsMax)
+                  r.runsMax = cycleRuns;
+            }
+      const double t = nowNs() - t0;
+      r.runsAvg = cycles ? double(runs) / cycles : 0.0;
+      r.nsPerCycle = cycles ? t / cycles : 0.0;
+      (void)sink;
+      return r;
+      }
+
+} // namespace MusEAutomationBench
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      using namespace MusEAutomationBench;
+
+      Config cfg;
+      cfg.sampleRate = 48000;
+      cfg.period     = 1024;
+      cfg.minPer     = 32;
+      cfg.ports      = 4;
+      cfg.seconds    = 20.0;
+      cfg.ramps      = true;
+      cfg.repeats    = 5;
+
+      int c;
+      while ((c = getopt(argc, argv, "n:m:p:s:r:t")) != EOF) {
+            switch (c) {
+                  case 'n': cfg.period = atoi(optarg); break;
+                  case 'm': cfg.minPer = atoi(optarg); break;
+                  case 'p': cfg.ports = atoi(optarg); break;
+                  case 's': cfg.seconds = atof(optarg); break;
+                  case 'r': cfg.repeats = atoi(optarg); break;
+                  case 't': cfg.ramps = false; break;
+                  default:  std::fprintf(stderr, "%s: -n <period> -m <minimum control period, power of 2>"
+                              " -p <automated ports> -s <seconds> -r <timed plays, the fastest counts>"
+                              " -t (steps instead of ramps)\n", argv[0]);
+                            return -1;
+                  }
+            }
+      if (cfg.period < 1 || cfg.minPer < 1 || (cfg.minPer & (cfg.minPer - 1)) || cfg.ports < 1 || cfg.seconds <= 0.0
+         || cfg.repeats < 1) {
+            std::fprintf(stderr, "%s: invalid arguments\n", argv[0]);
+            return -1;
+            }
+
+      std::printf("%d automated ports, %s, period %lu, minimum control period %lu, %g s at %lu Hz\n\n",
+         cfg.ports, cfg.ramps ? "ramps" : "steps", cfg.period, cfg.minPer, cfg.seconds, cfg.sampleRate);
+      std::printf("%8s %8s %13s %12s %10s\n", "points/s", "planner", "runs/cycle", "us/cycle", "max error");
+
+      static const double densities[] = { 0, 1, 4, 16, 64, 256, 1024, 4096 };
+      // Allowed on top of the old planning's error, plus rounding.
+      const double allowed = 1.0 / MusECore::pluginCtrlLongestRunSteps + 1e-9;
+      unsigned failed = 0;
+      std::vector<Port> ports(cfg.ports);
+      for (unsigned d = 0; d < sizeof(densities) / sizeof(densities[0]); ++d) {
+            makeAutomation(ports, cfg, densities[d], 1 + d);
+            double errors[AudioRate + 1];
+            for (int p = OldPlanner; p <= AudioRate; ++p) {
+                  Result e = play(ports, cfg, Planner(p), true);
+                  // The fastest of a few plays, the others met interruptions.
+                  Result r = play(ports, cfg, Planner(p), false);
+                  for (int i = 1; i < cfg.repeats; ++i) {
+                        const Result t = play(ports, cfg, Planner(p), false);
+                        if (t.nsPerCycle < r.nsPerCycle)
+                              r.nsPerCycle = t.nsPerCycle;
+                        }
+                  errors[p] = e.maxError;
+                  char runs[32];
+                  snprintf(runs, sizeof(runs), "%.2f (%lu)", r.runsAvg, r.runsMax);
+                  std::printf("%8g %8s %13s %12.2f %10.4f\n", densities[d], plannerNames[p], runs,
+                     r.nsPerCycle / 1000.0, e.maxError);
+                  }
+            if (errors[NewPlanner] > std::max(errors[OldPlanner], allowed)) {
+                  std::printf("%8g  FAILED: new planning error %.4f, old %.4f, allowed %.4f\n", densities[d],
+                     errors[NewPlanner], errors[OldPlanner], allowed);
+                  ++failed;
+                  }
+            }
+      std::printf("\nNew planning error within the old one or %.4f of the range: %s\n",
+         allowed, failed ? "NO" : "yes");
+      return failed ? 1 : 0;
+      }
@@ -0,0 +1,258 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  muse_deicsonze_render_check.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//   Checks that DeicsOnze renders the same whatever the
+//    size of the blocks the host asks for.
+//   A fixed patch and fixed notes are rendered once with
+//    one frame per process() call, where every render block
+//    holds one sample and the channel, voice and operator
+//    nest runs sample by sample as it did before the voices
+//    were rendered block by block. They are then rendered
+//    again with host sized blocks, and the buffers must not
+//    differ by more than the tolerance.
+//   The patch uses an FM chain with feedback, the sample
+//    and hold lfo, pitch bend, the modulation wheel and a
+//    mono channel with portamento. The effects are off.
+//   Returns 0 if all renders match.
+//---------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <unistd.h>
+
+#include <QApplication>
+
+#include "libsynti/mess.h"
+#include "muse/midi_consts.h"
+#include "synti/deicsonze/deicsonzepreset.h"
+
+namespace MusEDeicsOnzeRenderCheck {
+
+static const int sampleRate = 48000;
+static const unsigned frames = 3 * sampleRate;
+
+//---------------------------------------------------------
+//   Event
+//---------------------------------------------------------
+
+struct Event {
+      unsigned frame;
+      int channel;
+      int type;
+      int a;
+      int b;
+      };
+
+#define OP(ctrl, op) ((ctrl) + DECAPAR1 * (op))
+
+static const Event events[] = {
+      // Channel 0: poly, four operators chained with feedback,
+      //  sample and hold lfo on pitch and amplitude.
+      { 0,      0, MusECore::ME_CONTROLLER, CTRL_ALG, FIRST },
+      { 0,      0, MusECore::ME_CONTROLLER, CTRL_FEEDBACK, 5 },
+      { 0,      0, MusECore::ME_CONTROLLER, OP(CTRL_OUT, 1), 70 },
+      { 0,      0, MusECore::ME_CONTROLLER, OP(CTRL_OUT, 2), 55 },
+      { 0,      0, MusECore::ME_CONTROLLER, OP(CTRL_OUT, 3), 40 },
+      { 0,      0, MusECore::ME_CONTROLLER, OP(CTRL_RATIO, 1), 2 },
+      { 0,      0, MusECore::ME_CONTROLLER, OP(CTRL_RR, 0), 6 },
+      { 0,      0, MusECore::ME_CONTROLLER, CTRL_WAVE, SHOLD },
+      { 0,      0, MusECore::ME_CONTROLLER, CTRL_SPEED, 70 },
+      { 0,      0, MusECore::ME_CONTROLLER, CTRL_PMODDEPTH, 40 },
+      { 0,      0, MusECore::ME_CONTROLLER, CTRL_AMODDEPTH, 30 },
+      { 0,      0, MusECore::ME_CONTROLLER, CTRL_PMODSENS, 5 },
+      { 0,      0, MusECore::ME_CONTROLLER, CTRL_AMS, 2 },
+      // Channel 1: mono with full time portamento.
+      { 0,      1, MusECore::ME_CONTROLLER, CTRL_CHANNELENABLE, 1 },
+      { 0,      1, MusECore::ME_CONTROLLER, CTRL_POLYMODE, MONO },
+      { 0,      1, MusECore::ME_CONTROLLER, CTRL_PORTAMODE, FULL },
+      { 0,      1, MusECore::ME_CONTROLLER, CTRL_PORTATIME, 60 },
+      { 0,      1, MusECore::ME_CONTROLLER, CTRL_ALG, FIFTH },
+      { 0,      1, MusECore::ME_CONTROLLER, OP(CTRL_OUT, 1), 60 },
+      { 0,      1, MusECore::ME_CONTROLLER, OP(CTRL_OUT, 2), 90 },
+      { 0,      1, MusECore::ME_CONTROLLER, OP(CTRL_OUT, 3), 50 },
+
+      { 0,      0, MusECore::ME_NOTEON, 60, 100 },
+      { 0,      0, MusECore::ME_NOTEON, 64, 90 },
+      { 1000,   0, MusECore::ME_NOTEON, 67, 80 },
+      { 4799,   1, MusECore::ME_NOTEON, 48, 110 },
+      { 12000,  1, MusECore::ME_NOTEON, 55, 110 },
+      { 20000,  0, MusECore::ME_CONTROLLER, MusECore::CTRL_MODULATION, 100 },
+      { 30001,  0, MusECore::ME_PITCHBEND, 3000, 0 },
+      { 36000,  1, MusECore::ME_NOTEON, 43, 100 },
+      { 36000,  1, MusECore::ME_NOTEOFF, 55, 0 },
+      { 48000,  0, MusECore::ME_NOTEOFF, 64, 0 },
+      { 50000,  0, MusECore::ME_PITCHBEND, -2000, 0 },
+      { 60000,  0, MusECore::ME_NOTEON, 72, 127 },
+      { 72000,  0, MusECore::ME_NOTEOFF, 60, 0 },
+      { 72000,  0, MusECore::ME_NOTEOFF, 67, 0 },
+      { 90000,  1, MusECore::ME_NOTEOFF, 48, 0 },
+      { 90000,  1, MusECore::ME_NOTEOFF, 43, 0 },
+      { 100000, 0, MusECore::ME_NOTEOFF, 72, 0 },
+      };
+static const unsigned nbrEvents = sizeof(events) / sizeof(events[0]);
+
+//---------------------------------------------------------
+//   createSynth
+//---------------------------------------------------------
+
+static Mess* createSynth(const char* configPath)
+      {
+      MessConfig config;
+      config._segmentSize = 1024;
+      config._sampleRate = sampleRate;
+      // An empty directory: no saved configuration and no
+      //  preset bank, every instance starts from the same patch.
+      config._configPath = configPath;
+      config._globalLibPath = configPath;
+      config._globalSharePath = configPath;
+      config._userPath = configPath;
+      config._projectPath = configPath;
+      return mess_descriptor()->instantiate(0, "DeicsOnze", &config);
+      }
+
+//---------------------------------------------------------
+//   render
+//    Process calls end at each event, like the host's.
+//---------------------------------------------------------
+
+static void render(Mess* synth, unsigned hostBlock, std::vector<float>& left, std::vector<float>& right)
+      {
+      left.assign(frames, 0.0f);
+      right.assign(frames, 0.0f);
+      float* buffer[2] = { left.data(), right.data() };
+      // The sample and hold lfo draws from rand().
+      srand(1);
+      unsigned e = 0;
+      for (unsigned f = 0; f < frames; ) {
+            for (; e < nbrEvents && events[e].frame <= f; ++e)
+                  synth->processEvent(MusECore::MidiPlayEvent(events[e].frame, 0,
+                        events[e].channel, events[e].type, events[e].a, events[e].b));
+            unsigned n = frames - f;
+            if (n > hostBlock)
+                  n = hostBlock;
+            if (e < nbrEvents && events[e].frame - f < n)
+                  n = events[e].frame - f;
+            synth->process(f, buffer, f, n);
+            f += n;
+            }
+      }
+
+//---------------------------------------------------------
+//   compare
+//---------------------------------------------------------
+
+static double compare(const std::vector<float>& a, const std::vector<float>& b, unsigned* firstFrame, double tolerance)
+      {
+      double maxDiff = 0.0;
+      *firstFrame = frames;
+      for (unsigned i = 0; i < frames; ++i) {
+            const double d = std::fabs(double(a[i]) - double(b[i]));
+            if (d > tolerance && *firstFrame == frames)
+                  *firstFrame = i;
+            if (d > maxDiff)
+                  maxDiff = d;
+            }
+      return maxDiff;
+      }
+
+//---------------------------------------------------------
+//   rms
+//---------------------------------------------------------
+
+static double rms(const std::vector<float>& a)
+      {
+      double sum = 0.0;
+      for (unsigned i = 0; i < frames; ++i)
+            sum += double(a[i]) * double(a[i]);
+      return std::sqrt(sum / frames);
+      }
+
+} // namespace MusEDeicsOnzeRenderCheck
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      using namespace MusEDeicsOnzeRenderCheck;
+
+      // The synth creates its (hidden) gui.
+      if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+      QApplication app(argc, argv);
+
+      // About -100 dB, room for the compiler contracting
+      //  operations differently in the two loop nests.
+      double tolerance = 1e-5;
+      int c;
+      while ((c = getopt(argc, argv, "t:")) != EOF) {
+            switch (c) {
+                  case 't': tolerance = atof(optarg); break;
+                  default:  std::fprintf(stderr, "%s: -t <tolerance>\n", argv[0]);
+                            return -1;
+                  }
+            }
+
+      char configPath[] = "/tmp/muse_deicsonze_check_XXXXXX";
+      if (!mkdtemp(configPath)) {
+            std::perror("mkdtemp");
+            return 1;
+            }
+
+      // The reference, one sample per render block.
+      std::vector<float> refLeft, refRight;
+      Mess* synth = createSynth(configPath);
+      render(synth, 1, refLeft, refRight);
+      delete synth;
+
+      const double level = rms(refLeft) + rms(refRight);
+      std::printf("reference: %u frames, rms left %g right %g\n", frames, rms(refLeft), rms(refRight));
+      bool ok = level > 1e-4;
+      if (!ok)
+            std::printf("  the reference render is silent\n");
+
+      // Block sizes below, at and above RENDERBLOCK, and odd ones.
+      static const unsigned hostBlocks[] = { 63, 64, 65, 128, 1000, 1024, 4096 };
+      std::vector<float> left, right;
+      for (unsigned i = 0; i < sizeof(hostBlocks) / sizeof(hostBlocks[0]); ++i) {
+            synth = createSynth(configPath);
+            render(synth, hostBlocks[i], left, right);
+            delete synth;
+            unsigned firstLeft, firstRight;
+            const double dl = compare(refLeft, left, &firstLeft, tolerance);
+            const double dr = compare(refRight, right, &firstRight, tolerance);
+            const bool match = firstLeft == frames && firstRight == frames;
+            std::printf("  blocks of %4u: max difference left %g right %g  %s",
+                  hostBlocks[i], dl, dr, match ? "ok" : "FAILED");
+            if (!match)
+                  std::printf(" from frame %u", firstLeft < firstRight ? firstLeft : firstRight);
+            std::printf("\n");
+            ok = ok && match;
+            }
+
+      rmdir(configPath);
+      return ok ? 0 : 1;
+      }
@@ -0,0 +1,325 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  muse_dsp_bench.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//   Checks every vectorized AL::Dsp backend the cpu supports
+//    against the scalar AL::Dsp routines, then times them.
+//   Results must be identical, except for the peak (Dsp::peak
+//    uses f_max(), which may be off in the last bit) and the
+//    rms sum of squares (summed in a different order).
+//   Returns 0 if all checks pass, 1 otherwise.
+//---------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <unistd.h>
+#include <time.h>
+
+#include "al/al.h"
+#include "al/dsp.h"
+#include "al/dspSIMD.h"
+
+namespace MusEDspBench {
+
+static const int maxBackends = 8;
+static int failures = 0;
+
+//---------------------------------------------------------
+//   nowNs
+//---------------------------------------------------------
+
+static double nowNs()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return double(ts.tv_sec) * 1e9 + double(ts.tv_nsec);
+      }
+
+//---------------------------------------------------------
+//   fill
+//    Random samples in -1.5 .. 1.5, so that some get clipped.
+//---------------------------------------------------------
+
+static void fill(std::vector<float>& v, unsigned seed)
+      {
+      srand(seed);
+      for (size_t i = 0; i < v.size(); ++i)
+            v[i] = (float(rand()) / float(RAND_MAX) - 0.5f) * 3.0f;
+      }
+
+//---------------------------------------------------------
+//   same
+//---------------------------------------------------------
+
+static bool same(const std::vector<float>& a, const std::vector<float>& b)
+      {
+      return a.size() == b.size() && memcmp(&a[0], &b[0], a.size() * sizeof(float)) == 0;
+      }
+
+static void check(bool ok, const char* backend, const char* kernel, unsigned n)
+      {
+      if (ok)
+            return;
+      ++failures;
+      std::fprintf(stderr, "FAILED: %s %s differs from the scalar routine, n:%u\n", backend, kernel, n);
+      }
+
+//---------------------------------------------------------
+//   checkKernels
+//    n is chosen by the caller to cover both the vector
+//     loops and the scalar tails.
+//---------------------------------------------------------
+
+static void checkKernels(AL::Dsp& ref, const AL::DspKernels* k, unsigned n)
+      {
+      std::vector<float> src(2 * n), src2(n), a(2 * n), b(2 * n), c(2 * n), d(2 * n);
+      fill(src, n);
+      fill(src2, n + 1);
+
+      // Make sure the clipping and NaN handling of interleave are covered.
+      if (n > 3) {
+            src[0] = NAN;
+            src[1] = -0.0f;
+            src[2] = 0.9999f;
+            src[3] = -7.0f;
+            }
+
+      // peak: Against the true maximum, and within one ulp of Dsp::peak.
+      {
+      std::vector<float> s(src.begin(), src.begin() + n);
+      s[0] = 0.0f;
+      float exact = 0.25f;
+      for (unsigned i = 0; i < n; ++i)
+            exact = std::max(exact, fabsf(s[i]));
+      const float r = ref.peak(&s[0], n, 0.25f);
+      const float v = k->peak(&s[0], n, 0.25f);
+      check(v == exact && fabsf(v - r) <= exact * 1e-6f, k->name, "peak", n);
+
+      float ref_sq = 1.0f, sq = 1.0f;
+      const float rp = ref.peakRms(&s[0], n, 0.25f, &ref_sq);
+      const float vp = k->peakRms(&s[0], n, 0.25f, &sq);
+      check(vp == v && fabsf(rp - r) == 0.0f, k->name, "peakRms peak", n);
+      check(fabsf(sq - ref_sq) <= ref_sq * 1e-5f, k->name, "peakRms sum of squares", n);
+      }
+
+      // applyGainToBuffer
+      a.assign(src.begin(), src.begin() + n);
+      b = a;
+      ref.applyGainToBuffer(&a[0], n, 0.7f);
+      k->applyGainToBuffer(&b[0], n, 0.7f);
+      check(same(a, b), k->name, "applyGainToBuffer", n);
+
+      // mixWithGain, mix
+      a.assign(src.begin(), src.begin() + n);
+      b = a;
+      ref.mixWithGain(&a[0], &src2[0], n, 0.3f);
+      k->mixWithGain(&b[0], &src2[0], n, 0.3f);
+      check(same(a, b), k->name, "mixWithGain", n);
+      ref.mix(&a[0], &src2[0], n);
+      k->mix(&b[0], &src2[0], n);
+      check(same(a, b), k->name, "mix", n);
+
+      // Denormal biased copy
+      a.assign(n, 0.0f);
+      b.assign(n, 0.0f);
+      ref.cpy(&a[0], &src2[0], n, true);
+      k->cpyWithBias(&b[0], &src2[0], n, AL::denormalBias);
+      check(same(a, b), k->name, "cpy with denormal bias", n);
+
+      // cpyWithGain
+      ref.cpyWithGain(&a[0], &src2[0], n, 1.3f);
+      k->cpyWithGain(&b[0], &src2[0], n, 1.3f);
+      check(same(a, b), k->name, "cpyWithGain", n);
+
+      // panMix
+      a.assign(n, 0.0f); b.assign(n, 0.0f); c.assign(n, 0.0f); d.assign(n, 0.0f);
+      ref.panMix(&a[0], &b[0], &src2[0], n, 0.4f, 0.9f);
+      k->panMix(&c[0], &d[0], &src2[0], n, 0.4f, 0.9f);
+      check(same(a, c) && same(b, d), k->name, "panMix", n);
+
+      // deinterleave, replacing and adding
+      for (int add = 0; add < 2; ++add) {
+            a.assign(src2.begin(), src2.end()); b.assign(src2.begin(), src2.end());
+            c = a; d = b;
+            float* rd[2] = { &a[0], &b[0] };
+            ref.deinterleave(rd, &src[0], 2, n, add);
+            k->deinterleave2(&c[0], &d[0], &src[0], n, add);
+            check(same(a, c) && same(b, d), k->name, add ? "deinterleave add" : "deinterleave", n);
+            }
+
+      // interleave with clipping
+      a.assign(2 * n, 0.0f);
+      b.assign(2 * n, 0.0f);
+      const float* rs[2] = { &src[0], &src[n] };
+      ref.interleave(&a[0], rs, 2, n, 0.9999f);
+      k->interleave2(&b[0], &src[0], &src[n], n, 0.9999f);
+      check(same(a, b), k->name, "interleave", n);
+      }
+
+//---------------------------------------------------------
+//   Timing
+//---------------------------------------------------------
+
+struct Bench {
+      unsigned n;
+      int iterations;
+      std::vector<float> src, src2, dst, dstR, il;
+      float* ch[2];
+      const float* cch[2];
+
+      Bench(unsigned frames, int iters) : n(frames), iterations(iters),
+            src(frames), src2(frames), dst(frames), dstR(frames), il(2 * frames) {
+            fill(src, 1);
+            fill(src2, 2);
+            ch[0] = &dst[0];
+            ch[1] = &dstR[0];
+            cch[0] = &src[0];
+            cch[1] = &src2[0];
+            }
+      };
+
+// Nanoseconds per sample of the routine number 'which', scalar if k is null.
+static double timeKernel(AL::Dsp& ref, const AL::DspKernels* k, Bench& b, int which)
+      {
+      const unsigned n = b.n;
+      volatile float sink = 0.0f;
+      double ramp = 1.0;
+      const double t0 = nowNs();
+      for (int it = 0; it < b.iterations; ++it) {
+            float sq = 0.0f;
+            switch (which) {
+                  case 0: sink = k ? k->peak(&b.src[0], n, 0.0f) : ref.peak(&b.src[0], n, 0.0f); break;
+                  case 1: sink = k ? k->peakRms(&b.src[0], n, 0.0f, &sq) : ref.peakRms(&b.src[0], n, 0.0f, &sq); break;
+                  case 2:
+                        if (k) k->mixWithGain(&b.dst[0], &b.src[0], n, 0.5f);
+                        else   ref.mixWithGain(&b.dst[0], &b.src[0], n, 0.5f);
+                        break;
+                  case 3:
+                        if (k) k->cpyWithGain(&b.dst[0], &b.src[0], n, 0.5f);
+                        else   ref.cpyWithGain(&b.dst[0], &b.src[0], n, 0.5f);
+                        break;
+                  case 4:
+                        if (k) k->panMix(&b.dst[0], &b.dstR[0], &b.src[0], n, 0.5f, 0.7f);
+                        else   ref.panMix(&b.dst[0], &b.dstR[0], &b.src[0], n, 0.5f, 0.7f);
+                        break;
+                  case 5:
+                        if (k) k->deinterleave2(&b.dst[0], &b.dstR[0], &b.il[0], n, false);
+                        else   ref.deinterleave(b.ch, &b.il[0], 2, n, false);
+                        break;
+                  case 6:
+                        if (k) k->interleave2(&b.il[0], &b.src[0], &b.src2[0], n, 0.9999f);
+                        else   ref.interleave(&b.il[0], b.cch, 2, n, 0.9999f);
+                        break;
+                  // The ramps are always scalar.
+                  case 7: ramp = ref.cpyWithRamp(&b.dst[0], &b.src[0], n, ramp > 2.0 ? 0.001 : ramp, 1.0001); break;
+                  case 8: ramp = ref.mixWithRamp(&b.dst[0], &b.src[0], n, ramp > 2.0 ? 0.001 : ramp, 1.0001); break;
+                  }
+            sink = sink + sq;
+            }
+      const double t = nowNs() - t0;
+      (void)sink;
+      return t / (double(b.iterations) * n);
+      }
+
+static const char* kernelNames[] = {
+      "peak", "peakRms", "mixWithGain", "cpyWithGain", "panMix",
+      "deinterleave", "interleave", "cpyWithRamp", "mixWithRamp"
+      };
+static const int nKernels = sizeof(kernelNames) / sizeof(kernelNames[0]);
+// Those which only have a scalar version.
+static const int firstScalarOnly = 7;
+
+} // namespace MusEDspBench
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      using namespace MusEDspBench;
+
+      bool check_only = false;
+      unsigned frames = 1024;
+      int iterations = 20000;
+      int c;
+      while ((c = getopt(argc, argv, "cn:i:")) != EOF) {
+            switch (c) {
+                  case 'c': check_only = true; break;
+                  case 'n': frames = atoi(optarg); break;
+                  case 'i': iterations = atoi(optarg); break;
+                  default:  std::fprintf(stderr, "%s: -c (check only, no timing) -n <frames per call> -i <iterations>\n",
+                              argv[0]);  return -1;
+                  }
+            }
+      if (frames < 1)
+            frames = 1;
+      if (iterations < 1)
+            iterations = 1;
+
+      AL::Dsp ref;
+      const AL::DspKernels* backends[maxBackends];
+      const int nbackends = AL::dspKernelsAvailable(backends, maxBackends);
+      if (nbackends == 0)
+            std::printf("No vectorized dsp routines for this cpu, or none built. Only the scalar ones are timed.\n");
+
+      // Sizes around the vector widths, to cover the tails too.
+      static const unsigned sizes[] = { 1, 3, 4, 7, 8, 15, 16, 17, 31, 33, 64, 127, 1000, 1024, 4099 };
+      for (int i = 0; i < nbackends; ++i) {
+            for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+                  checkKernels(ref, backends[i], sizes[s]);
+            std::printf("%-8s %s\n", backends[i]->name, failures ? "checked, FAILED" : "checked, same as scalar");
+            }
+
+      if (!check_only) {
+            Bench b(frames, iterations);
+            std::printf("\nns per sample, %u frames per call, %d calls:\n", frames, iterations);
+            std::printf("%-14s %10s", "", "scalar");
+            for (int i = 0; i < nbackends; ++i)
+                  std::printf(" %14s", backends[i]->name);
+            std::printf("\n");
+            for (int w = 0; w < nKernels; ++w) {
+                  const double ts = timeKernel(ref, 0, b, w);
+                  std::printf("%-14s %10.3f", kernelNames[w], ts);
+                  for (int i = 0; i < nbackends; ++i) {
+                        if (w >= firstScalarOnly) {
+                              std::printf(" %14s", "-");
+                              continue;
+                              }
+                        const double tv = timeKernel(ref, backends[i], b, w);
+                        char cell[32];
+                        snprintf(cell, sizeof(cell), "%.3f x%.1f", tv, tv > 0.0 ? ts / tv : 0.0);
+                        std::printf(" %14s", cell);
+                        }
+                  std::printf("\n");
+                  }
+            }
+
+      if (failures) {
+            std::fprintf(stderr, "%d checks FAILED\n", failures);
+            return 1;
+            }
+      return 0;
+      }
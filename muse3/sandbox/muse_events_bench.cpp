@@ -0,0 +1,272 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  muse_events_bench.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//   Memory use and playback iteration of a midi part's
+//    EventList versus its PackedMidiEvents copy, both the
+//    real classes from the core library.
+//
+//   A part holds notes and controllers, four events every 24
+//    ticks. Their EventBase objects are allocated in random
+//    order, as recording and editing leave them.
+//
+//   Memory is the heap in use as reported by mallinfo, mmapped
+//    blocks included, so it includes the allocator's overhead.
+//    The packed copy is kept beside the EventList, its memory adds
+//    to the list's: It makes playback cache friendly, it does not
+//    save memory. Clones with the same events share one copy.
+//
+//   Playback walks the part like Audio::collectEvents() does,
+//    16 ticks per cycle (1024 frames at 48 kHz, 120 bpm, 384
+//    ticks per quarter): the first and last event of the cycle,
+//    then reads each event.
+//
+//    list:    Copies each Event out of the EventList, as the
+//             playback loop did before the packed copy.
+//    packed:  Reads the PackedMidiEvents in place.
+//
+//   Check: Both walks see the same events with the same values.
+//---------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <malloc.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "event.h"
+#include "midievent.h"
+#include "packed_events.h"
+
+namespace MusEEventsBench {
+
+using MusECore::Event;
+using MusECore::EventList;
+using MusECore::ciEvent;
+using MusECore::PackedMidiEvent;
+using MusECore::PackedMidiEvents;
+
+const unsigned ticksPerEvent = 6;
+const unsigned ticksPerCycle = 16;
+
+//---------------------------------------------------------
+//   nowNs
+//---------------------------------------------------------
+
+static double nowNs()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return double(ts.tv_sec) * 1e9 + double(ts.tv_nsec);
+      }
+
+//---------------------------------------------------------
+//   heapInUse
+//---------------------------------------------------------
+
+static size_t heapInUse()
+      {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+      const struct mallinfo2 mi = mallinfo2();
+      return mi.uordblks + mi.hblkhd;
+#else
+      const struct mallinfo mi = mallinfo();
+      return (unsigned)mi.uordblks + (unsigned)mi.hblkhd;
+#endif
+      }
+
+//---------------------------------------------------------
+//   makeList
+//    Every fourth event is a controller, the rest are notes.
+//---------------------------------------------------------
+
+static void makeList(EventList& el, unsigned events, unsigned seed)
+      {
+      std::vector<unsigned> order(events);
+      for (unsigned i = 0; i < events; ++i)
+            order[i] = i;
+      srand(seed);
+      std::random_shuffle(order.begin(), order.end());
+
+      for (unsigned k = 0; k < events; ++k) {
+            const unsigned i = order[k];
+            Event e((i & 3) == 3 ? MusECore::Controller : MusECore::Note);
+            e.setTick(i * ticksPerEvent);
+            if (e.type() == MusECore::Note) {
+                  e.setLenTick(12 + rand() % 48);
+                  e.setPitch(36 + rand() % 24);
+                  e.setVelo(1 + rand() % 127);
+                  e.setVeloOff(rand() % 128);
+                  }
+            else {
+                  e.setA(1 + rand() % 16);
+                  e.setB(rand() % 128);
+                  }
+            el.add(e);
+            }
+      }
+
+//---------------------------------------------------------
+//   Checksum
+//    What the playback loop reads of each event.
+//---------------------------------------------------------
+
+struct Checksum {
+      uint64_t events;
+      uint64_t sum;
+      Checksum() : events(0), sum(0) { }
+      void add(unsigned tick, int type, int a, int b, unsigned len)
+      {
+        ++events;
+        sum = sum * 31 + tick;
+        sum = sum * 31 + unsigned(type);
+        sum = sum * 31 + unsigned(a);
+        sum = sum * 31 + unsigned(b);
+        sum = sum * 31 + len;
+      }
+      bool operator==(const Checksum& o) const { return events == o.events && sum == o.sum; }
+      };
+
+//---------------------------------------------------------
+//   playList
+//---------------------------------------------------------
+
+static void playList(const EventList& el, unsigned len, Checksum& cs)
+      {
+      for (unsigned stick = 0; stick < len; stick += ticksPerCycle) {
+            ciEvent ie   = el.lower_bound(stick);
+            ciEvent iend = el.upper_bound(stick + ticksPerCycle);
+            for (; ie != iend; ++ie) {
+                  Event ev = ie->second;
+                  if (ev.type() == MusECore::Meta)
+                        continue;
+                  // Only count each event in the cycle it starts in, as the frame check does.
+                  if (ev.tick() >= stick + ticksPerCycle)
+                        continue;
+                  if (ev.type() == MusECore::Note)
+                        cs.add(ev.tick(), MusECore::Note, ev.pitch(), ev.velo(), ev.lenTick());
+                  else
+                        cs.add(ev.tick(), ev.type(), ev.dataA(), ev.dataB(), 0);
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   playPacked
+//---------------------------------------------------------
+
+static void playPacked(const PackedMidiEvents& packed, unsigned len, Checksum& cs)
+      {
+      for (unsigned stick = 0; stick < len; stick += ticksPerCycle) {
+            const PackedMidiEvent* ie   = packed.lowerBound(stick);
+            const PackedMidiEvent* iend = packed.upperBound(stick + ticksPerCycle);
+            for (; ie != iend; ++ie) {
+                  if (ie->tick() >= stick + ticksPerCycle)
+                        continue;
+                  if (ie->isNote())
+                        cs.add(ie->tick(), MusECore::Note, ie->pitch(), ie->velo(), ie->lenTick());
+                  else
+                        cs.add(ie->tick(), ie->type(), ie->dataA(), ie->dataB(), 0);
+                  }
+            }
+      }
+
+} // namespace MusEEventsBench
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      using namespace MusEEventsBench;
+
+      int repeat = 5;
+      std::vector<unsigned> sizes;
+      int c;
+      while ((c = getopt(argc, argv, "n:r:")) != EOF) {
+            switch (c) {
+                  case 'n': sizes.push_back(atoi(optarg)); break;
+                  case 'r': repeat = atoi(optarg); break;
+                  default:  std::fprintf(stderr, "%s: -n <events> (repeatable) -r <repeats>\n", argv[0]);
+                            return -1;
+                  }
+            }
+      if (sizes.empty()) {
+            static const unsigned defaultSizes[] = { 10000, 100000, 1000000 };
+            sizes.assign(defaultSizes, defaultSizes + sizeof(defaultSizes) / sizeof(defaultSizes[0]));
+            }
+      if (repeat < 1)
+            repeat = 1;
+
+      std::printf("sizeof: midi event base %zu, event %zu, packed event %zu bytes\n\n",
+         sizeof(MusECore::MidiEventBase), sizeof(Event), sizeof(PackedMidiEvent));
+      std::printf("%8s %12s %12s %12s %12s %12s %8s\n",
+         "events", "list B/ev", "packed B/ev", "list ms", "packed ms", "speedup", "same");
+
+      unsigned failed = 0;
+      for (size_t s = 0; s < sizes.size(); ++s) {
+            const unsigned n = sizes[s];
+            const unsigned len = n * ticksPerEvent;
+
+            const size_t heap0 = heapInUse();
+            EventList* el = new EventList;
+            makeList(*el, n, 1 + s);
+            const size_t heap1 = heapInUse();
+            PackedMidiEvents* packed = new PackedMidiEvents(*el);
+            const size_t heap2 = heapInUse();
+
+            Checksum listCs, packedCs;
+            playList(*el, len, listCs);
+            playPacked(*packed, len, packedCs);
+            const bool same = listCs == packedCs && listCs.events == n && packed->matches(*el);
+            if (!same)
+                  failed = 1;
+
+            // Best of the repeats, to keep out the noise of other processes.
+            double listNs = 0.0, packedNs = 0.0;
+            for (int r = 0; r < repeat; ++r) {
+                  Checksum cs;
+                  double t = nowNs();
+                  playList(*el, len, cs);
+                  t = nowNs() - t;
+                  if (r == 0 || t < listNs)
+                        listNs = t;
+                  t = nowNs();
+                  playPacked(*packed, len, cs);
+                  t = nowNs() - t;
+                  if (r == 0 || t < packedNs)
+                        packedNs = t;
+                  }
+
+            std::printf("%8u %12.1f %12.1f %12.2f %12.2f %11.1fx %8s\n", n,
+               double(heap1 - heap0) / n, double(heap2 - heap1) / n,
+               listNs / 1e6, packedNs / 1e6, packedNs > 0.0 ? listNs / packedNs : 0.0, same ? "yes" : "NO");
+
+            packed->release();
+            delete el;
+            }
+      return failed;
+      }
@@ -0,0 +1,543 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  muse_functions_bench.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+
+//---------------------------------------------------------
+//   Delete overlaps and legato of functions.cpp, and their
+//    editor variants, on synthetic large parts.
+//
+//   A song holds three parts of random notes: a part, a clone
+//    of it and another part. The notes of a part are allocated
+//    in random order like the Events of a real EventList, so
+//    that a map keyed by pointer is not sorted by time. Every
+//    note is selected.
+//
+//    old:   The loops functions.cpp had before sorted_notes.h,
+//           every note compared with every other one, in the
+//           order of a map keyed by pointer, or of the tagged
+//           event lists for the editor variants.
+//    new:   The functions of sorted_notes.h, called the way
+//           functions.cpp calls them.
+//
+//   Checks that both give the same operations, in the same
+//    order, on random notes and on notes which each reach into
+//    at most the next one of their pitch, then times both.
+//   Returns 0 if all results match.
+//---------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <unistd.h>
+#include <time.h>
+
+#include "sorted_notes.h"
+
+namespace MusEFunctionsBench {
+
+//---------------------------------------------------------
+//   Note
+//    What sorted_notes.h needs of an Event.
+//---------------------------------------------------------
+
+struct Note {
+      unsigned _tick;
+      unsigned _len;
+      int _pitch;
+
+      unsigned tick() const    { return _tick; }
+      unsigned lenTick() const { return _len; }
+      unsigned endTick() const { return _tick + _len; }
+      int pitch() const        { return _pitch; }
+      };
+
+//---------------------------------------------------------
+//   Part
+//    The notes sorted by time, as an EventList is.
+//---------------------------------------------------------
+
+struct Part {
+      int group;                       // The clone chain.
+      std::vector<Note> pool;          // In random order.
+      std::vector<const Note*> notes;  // Sorted by time.
+      };
+
+typedef std::vector<Part*> Song;
+
+typedef MusECore::SortedNoteT<Note, Part> SortedNote;
+typedef std::vector<SortedNote> SortedNoteList;
+
+//---------------------------------------------------------
+//   Op
+//    An Undo operation: the new length of a note, zero for
+//     deleting it.
+//---------------------------------------------------------
+
+struct Op {
+      const Note* note;
+      unsigned len;
+
+      Op(const Note* n, unsigned l) : note(n), len(l) { }
+      bool operator==(const Op& o) const { return note == o.note && len == o.len; }
+      };
+
+typedef std::vector<Op> Ops;
+
+//---------------------------------------------------------
+//   nowMs
+//---------------------------------------------------------
+
+static double nowMs()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return double(ts.tv_sec) * 1e3 + double(ts.tv_nsec) / 1e6;
+      }
+
+//---------------------------------------------------------
+//   sortPart
+//---------------------------------------------------------
+
+static bool noteTickLess(const Note* a, const Note* b)
+      {
+      return a->tick() < b->tick();
+      }
+
+static void sortPart(Part& part)
+      {
+      std::random_shuffle(part.pool.begin(), part.pool.end());
+      part.notes.clear();
+      for (size_t i = 0; i < part.pool.size(); ++i)
+            part.notes.push_back(&part.pool[i]);
+      std::stable_sort(part.notes.begin(), part.notes.end(), noteTickLess);
+      }
+
+//---------------------------------------------------------
+//   makeRandomPart
+//    n notes of 21..108 on about ten notes per beat, on a
+//     raster so that some start together.
+//---------------------------------------------------------
+
+static void makeRandomPart(Part& part, unsigned n)
+      {
+      part.pool.resize(n);
+      const unsigned ticks = n * 48;
+      for (unsigned i = 0; i < n; ++i) {
+            Note& e = part.pool[i];
+            e._tick  = rand() % ticks / 6 * 6;
+            e._len   = 1 + rand() % 960;
+            e._pitch = 21 + rand() % 88;
+            }
+      sortPart(part);
+      }
+
+//---------------------------------------------------------
+//   makeChainPart
+//    Each note reaches into at most the next one of its pitch.
+//---------------------------------------------------------
+
+static void makeChainPart(Part& part, unsigned n)
+      {
+      part.pool.resize(n);
+      unsigned next[128], gap[128];
+      for (int p = 0; p < 128; ++p) {
+            next[p] = rand() % 480;
+            gap[p]  = 1 + rand() % 480;
+            }
+      for (unsigned i = 0; i < n; ++i) {
+            Note& e = part.pool[i];
+            e._pitch = 21 + rand() % 88;
+            e._tick  = next[e._pitch];
+            // Up to the start of the note after the next one.
+            const unsigned gap2 = 1 + rand() % 480;
+            e._len = 1 + rand() % (gap[e._pitch] + gap2);
+            next[e._pitch] += gap[e._pitch];
+            gap[e._pitch] = gap2;
+            }
+      sortPart(part);
+      }
+
+//---------------------------------------------------------
+//   makeSong
+//    A part, its clone and another part. The clone holds
+//     copies of the part's notes, as clone parts do.
+//---------------------------------------------------------
+
+static void freeSong(Song& song)
+      {
+      for (size_t i = 0; i < song.size(); ++i)
+            delete song[i];
+      song.clear();
+      }
+
+static void makeSong(Song& song, unsigned n, bool chains, unsigned seed)
+      {
+      freeSong(song);
+      srand(seed);
+      Part* part = new Part;
+      part->group = 0;
+      Part* clone = new Part;
+      clone->group = 0;
+      Part* other = new Part;
+      other->group = 1;
+      if (chains) {
+            makeChainPart(*part, n);
+            makeChainPart(*other, n);
+            }
+      else {
+            makeRandomPart(*part, n);
+            makeRandomPart(*other, n);
+            }
+      clone->pool = part->pool;
+      sortPart(*clone);
+      song.push_back(part);
+      song.push_back(clone);
+      song.push_back(other);
+      }
+
+//---------------------------------------------------------
+//   get_events
+//    The pointer keyed map of functions.cpp.
+//---------------------------------------------------------
+
+typedef std::map<const Note*, const Part*> EventMap;
+
+static void get_events(const Song& song, EventMap& events)
+      {
+      for (size_t p = 0; p < song.size(); ++p)
+            for (size_t i = 0; i < song[p]->notes.size(); ++i)
+                  events.insert(std::make_pair(song[p]->notes[i], song[p]));
+      }
+
+//---------------------------------------------------------
+//   oldDeleteOverlaps
+//---------------------------------------------------------
+
+static void oldDeleteOverlaps(const Song& song, Ops& ops)
+      {
+      EventMap events;
+      get_events(song, events);
+      std::set<const Note*> deleted_events;
+      for (EventMap::const_iterator it1 = events.begin(); it1 != events.end(); ++it1) {
+            const Note& event1 = *it1->first;
+            const Part* part1 = it1->second;
+            for (EventMap::const_iterator it2 = events.begin(); it2 != events.end(); ++it2) {
+                  const Note& event2 = *it2->first;
+                  const Part* part2 = it2->second;
+                  if (part1->group == part2->group && &event1 != &event2
+                     && deleted_events.find(&event2) == deleted_events.end()) {
+                        if (event1.pitch() == event2.pitch() && event1.tick() <= event2.tick()
+                           && event1.endTick() > event2.tick()) {
+                              const int new_len = event2.tick() - event1.tick();
+                              if (new_len == 0) {
+                                    ops.push_back(Op(&event2, 0));
+                                    deleted_events.insert(&event2);
+                                    }
+                              else
+                                    ops.push_back(Op(&event1, new_len));
+                              }
+                        }
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   oldLegato
+//---------------------------------------------------------
+
+static void oldLegato(const Song& song, int min_len, bool dont_shorten, Ops& ops)
+      {
+      EventMap events;
+      get_events(song, events);
+      for (EventMap::const_iterator it1 = events.begin(); it1 != events.end(); ++it1) {
+            const Note& event1 = *it1->first;
+            const Part* part1 = it1->second;
+            unsigned len = INT_MAX;
+            for (EventMap::const_iterator it2 = events.begin(); it2 != events.end(); ++it2) {
+                  const Note& event2 = *it2->first;
+                  const Part* part2 = it2->second;
+                  bool relevant = (event2.tick() >= event1.tick() + min_len);
+                  if (dont_shorten)
+                        relevant = relevant && (event2.tick() >= event1.endTick());
+                  if (part1->group == part2->group && relevant && (event2.tick() - event1.tick() < len))
+                        len = event2.tick() - event1.tick();
+                  }
+            if (len == INT_MAX)
+                  len = event1.lenTick();
+            if (event1.lenTick() != len)
+                  ops.push_back(Op(&event1, len));
+            }
+      }
+
+//---------------------------------------------------------
+//   oldDeleteOverlapsItems
+//---------------------------------------------------------
+
+static void oldDeleteOverlapsItems(const Song& song, Ops& ops)
+      {
+      std::set<const Note*> deleted_events;
+      for (size_t p = 0; p < song.size(); ++p) {
+            const std::vector<const Note*>& el = song[p]->notes;
+            for (size_t ie = 0; ie < el.size(); ++ie) {
+                  const Note& e = *el[ie];
+                  if (deleted_events.find(&e) != deleted_events.end())
+                        continue;
+                  for (size_t ie2 = ie + 1; ie2 < el.size(); ++ie2) {
+                        const Note& e2 = *el[ie2];
+                        if (deleted_events.find(&e2) != deleted_events.end())
+                              continue;
+                        if (e.pitch() == e2.pitch() && e.tick() <= e2.tick() && e.endTick() > e2.tick()) {
+                              const int new_len = e2.tick() - e.tick();
+                              if (new_len == 0) {
+                                    ops.push_back(Op(&e2, 0));
+                                    deleted_events.insert(&e2);
+                                    }
+                              else {
+                                    ops.push_back(Op(&e, new_len));
+                                    break;
+                                    }
+                              }
+                        }
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   oldLegatoItems
+//---------------------------------------------------------
+
+static void oldLegatoItems(const Song& song, int min_len, bool dont_shorten, Ops& ops)
+      {
+      unsigned len = INT_MAX;
+      for (size_t p = 0; p < song.size(); ++p) {
+            const std::vector<const Note*>& el = song[p]->notes;
+            for (size_t ie = 0; ie < el.size(); ++ie) {
+                  const Note& e = *el[ie];
+                  for (size_t ie2 = ie + 1; ie2 < el.size(); ++ie2) {
+                        const Note& e2 = *el[ie2];
+                        bool relevant = (e2.tick() >= e.tick() + min_len);
+                        if (dont_shorten)
+                              relevant = relevant && (e2.tick() >= e.endTick());
+                        if (relevant && (e2.tick() - e.tick() < len))
+                              len = e2.tick() - e.tick();
+                        }
+                  if (len == INT_MAX)
+                        len = e.lenTick();
+                  if (e.lenTick() != len)
+                        ops.push_back(Op(&e, len));
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   get_notes
+//    As functions.cpp collects them.
+//---------------------------------------------------------
+
+static void get_notes(const Song& song, SortedNoteList& notes)
+      {
+      for (size_t p = 0; p < song.size(); ++p)
+            for (size_t i = 0; i < song[p]->notes.size(); ++i)
+                  notes.push_back(SortedNote(song[p]->notes[i], song[p], song[p]->group));
+      MusECore::sortNotesByAddress(notes);
+      }
+
+static void toOps(const SortedNoteList& notes, const std::vector<MusECore::NoteChange>& changes, Ops& ops)
+      {
+      for (size_t i = 0; i < changes.size(); ++i)
+            ops.push_back(Op(notes[changes[i].note].event, changes[i].newLen));
+      }
+
+//---------------------------------------------------------
+//   newDeleteOverlaps
+//---------------------------------------------------------
+
+static void newDeleteOverlaps(const Song& song, Ops& ops)
+      {
+      SortedNoteList notes;
+      get_notes(song, notes);
+      std::vector<MusECore::NoteChange> changes;
+      MusECore::findNoteOverlaps(notes, changes);
+      toOps(notes, changes, ops);
+      }
+
+//---------------------------------------------------------
+//   newLegato
+//---------------------------------------------------------
+
+static void newLegato(const Song& song, int min_len, bool dont_shorten, Ops& ops)
+      {
+      SortedNoteList notes;
+      get_notes(song, notes);
+      std::vector<MusECore::NoteChange> changes;
+      MusECore::findLegatoLens(notes, min_len, dont_shorten, changes);
+      toOps(notes, changes, ops);
+      }
+
+//---------------------------------------------------------
+//   newDeleteOverlapsItems
+//---------------------------------------------------------
+
+static void newDeleteOverlapsItems(const Song& song, Ops& ops)
+      {
+      SortedNoteList notes;
+      std::vector<MusECore::NoteChange> changes;
+      for (size_t p = 0; p < song.size(); ++p) {
+            notes.clear();
+            for (size_t i = 0; i < song[p]->notes.size(); ++i)
+                  notes.push_back(SortedNote(song[p]->notes[i], song[p]));
+            changes.clear();
+            MusECore::findSortedNoteOverlaps(notes, changes);
+            toOps(notes, changes, ops);
+            }
+      }
+
+//---------------------------------------------------------
+//   newLegatoItems
+//---------------------------------------------------------
+
+static void newLegatoItems(const Song& song, int min_len, bool dont_shorten, Ops& ops)
+      {
+      unsigned len = INT_MAX;
+      SortedNoteList notes;
+      std::vector<MusECore::NoteChange> changes;
+      for (size_t p = 0; p < song.size(); ++p) {
+            notes.clear();
+            for (size_t i = 0; i < song[p]->notes.size(); ++i)
+                  notes.push_back(SortedNote(song[p]->notes[i], song[p]));
+            changes.clear();
+            MusECore::findSortedLegatoLens(notes, min_len, dont_shorten, len, changes);
+            toOps(notes, changes, ops);
+            }
+      }
+
+//---------------------------------------------------------
+//   run
+//---------------------------------------------------------
+
+enum Function { DeleteOverlaps, Legato, LegatoShorten, DeleteOverlapsItems, LegatoItems };
+static const char* functionNames[] = { "delete overlaps", "legato", "legato, shorten", "del. ovl. items", "legato items" };
+
+static double run(Function f, bool old, const Song& song, Ops& ops)
+      {
+      ops.clear();
+      const double t0 = nowMs();
+      switch (f) {
+            case DeleteOverlaps:
+                  if (old)
+                        oldDeleteOverlaps(song, ops);
+                  else
+                        newDeleteOverlaps(song, ops);
+                  break;
+            case Legato:
+                  if (old)
+                        oldLegato(song, 48, true, ops);
+                  else
+                        newLegato(song, 48, true, ops);
+                  break;
+            case LegatoShorten:
+                  if (old)
+                        oldLegato(song, 48, false, ops);
+                  else
+                        newLegato(song, 48, false, ops);
+                  break;
+            case DeleteOverlapsItems:
+                  if (old)
+                        oldDeleteOverlapsItems(song, ops);
+                  else
+                        newDeleteOverlapsItems(song, ops);
+                  break;
+            case LegatoItems:
+                  if (old)
+                        oldLegatoItems(song, 48, true, ops);
+                  else
+                        newLegatoItems(song, 48, true, ops);
+                  break;
+            }
+      return nowMs() - t0;
+      }
+
+} // namespace MusEFunctionsBench
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      using namespace MusEFunctionsBench;
+
+      unsigned checkNotes = 3000;
+      unsigned maxOld = 5000;
+      std::vector<unsigned> sizes;
+      int c;
+      while ((c = getopt(argc, argv, "c:n:o:")) != EOF) {
+            switch (c) {
+                  case 'c': checkNotes = atoi(optarg); break;
+                  case 'n': sizes.push_back(atoi(optarg)); break;
+                  case 'o': maxOld = atoi(optarg); break;
+                  default:  std::fprintf(stderr, "%s: -c <notes per part for the checks>"
+                              " -n <notes per part> (repeatable)"
+                              " -o <most notes per part to run the old functions on>\n", argv[0]);
+                            return -1;
+                  }
+            }
+      if (sizes.empty()) {
+            static const unsigned defaultSizes[] = { 1000, 5000, 20000, 50000 };
+            sizes.assign(defaultSizes, defaultSizes + sizeof(defaultSizes) / sizeof(defaultSizes[0]));
+            }
+
+      bool ok = true;
+      Song song;
+      Ops oldOps, newOps;
+
+      std::printf("Checks on 3 parts of %u notes:\n", checkNotes);
+      for (int chains = 0; chains <= 1; ++chains) {
+            makeSong(song, checkNotes, chains, 1 + chains);
+            for (int f = DeleteOverlaps; f <= LegatoItems; ++f) {
+                  run(Function(f), true, song, oldOps);
+                  run(Function(f), false, song, newOps);
+                  const bool same = oldOps == newOps;
+                  std::printf("  %-16s on %s notes: %6zu operations, %s\n", functionNames[f],
+                        chains ? "chained" : "random", newOps.size(), same ? "same as old" : "DIFFERENT");
+                  ok = ok && same;
+                  }
+            }
+
+      std::printf("\n%8s %16s %12s %12s %10s\n", "notes", "function", "old ms", "new ms", "operations");
+      for (size_t s = 0; s < sizes.size(); ++s) {
+            makeSong(song, sizes[s], false, 3 + s);
+            for (int f = DeleteOverlaps; f <= LegatoItems; ++f) {
+                  char oldMs[32] = "-";
+                  if (sizes[s] <= maxOld)
+                        snprintf(oldMs, sizeof(oldMs), "%.2f", run(Function(f), true, song, oldOps));
+                  const double newMs = run(Function(f), false, song, newOps);
+                  std::printf("%8u %16s %12s %12.2f %10zu\n", 3 * sizes[s], functionNames[f], oldMs, newMs, newOps.size());
+                  }
+            }
+      freeSong(song);
+      return ok ? 0 : 1;
+      }
@@ -24,6 +24,8 @@
 #include <QFile>
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <unistd.h>
 
 #include <dlfcn.h>
@@ -267,6 +269,76 @@ static int loadPluginLib(MusEPlugin::PluginScanInfoStruct::PluginType_t types,
       return ret;
 }
 
+//---------------------------------------------------------
+//   scanServer
+//    Server mode, for scanning many files with one process.
+//    Reads one request per line from stdin:
+//     <types flags> TAB <scan ports 0|1> TAB <output filename> TAB <filename>
+//    and replies with one line holding the loadPluginLib()
+//     result on stdout. Quits at the end of input.
+//    Returns the process exit code.
+//---------------------------------------------------------
+
+static int scanServer()
+{
+      // Plugins may print to stdout while loading. Keep the real stdout for the
+      //  replies only, and send anything else printed there to stderr instead.
+      std::fflush(stdout);
+      const int reply_fd = dup(STDOUT_FILENO);
+      if(reply_fd == -1 || dup2(STDERR_FILENO, STDOUT_FILENO) == -1)
+      {
+        std::fprintf(stderr, "muse_plugin_scan: Cannot redirect standard output\n");
+        return 1;
+      }
+      FILE* replies = fdopen(reply_fd, "w");
+      if(!replies)
+      {
+        std::fprintf(stderr, "muse_plugin_scan: Cannot open reply stream\n");
+        return 1;
+      }
+
+      char* line = 0;
+      size_t line_sz = 0;
+      ssize_t len;
+      while((len = getline(&line, &line_sz, stdin)) > 0)
+      {
+        if(line[len - 1] == '\n')
+          line[len - 1] = 0;
+
+        // The filename comes last, it may contain tabs.
+        char* fields[4];
+        fields[0] = line;
+        int nfields = 1;
+        for( ; nfields < 4; ++nfields)
+        {
+          char* tab = std::strchr(fields[nfields - 1], '\t');
+          if(!tab)
+            break;
+          *tab = 0;
+          fields[nfields] = tab + 1;
+        }
+
+        int res = -1;
+        if(nfields < 4 || fields[2][0] == 0 || fields[3][0] == 0)
+          std::fprintf(stderr, "muse_plugin_scan: Bad request\n");
+        else
+          res = loadPluginLib(MusEPlugin::PluginScanInfoStruct::PluginType_t(atoi(fields[0])),
+                              fields[3], fields[2], fields[1][0] == '1');
+
+        if(res == -1)
+          std::fprintf(stderr, "Error loading plugin: <%s>\n", nfields < 4 ? "" : fields[3]);
+
+        std::fflush(stdout);
+        std::fflush(stderr);
+        std::fprintf(replies, "%d\n", res);
+        std::fflush(replies);
+      }
+
+      std::free(line);
+      std::fclose(replies);
+      return 0;
+}
+
 } // namespace MusEPluginScan
 
 
@@ -277,21 +349,27 @@ static int loadPluginLib(MusEPlugin::PluginScanInfoStruct::PluginType_t types,
 int main(int argc, char* argv[])
       {
       bool do_ports = false;
+      bool server = false;
       const char* filename = 0;
       const char* outfilename = 0;
       MusEPlugin::PluginScanInfoStruct::PluginType_t types = MusEPlugin::PluginScanInfoStruct::PluginTypeAll;
       int c;
-      while ((c = getopt(argc, argv, "f:t:o:p")) != EOF) {
+      while ((c = getopt(argc, argv, "f:t:o:ps")) != EOF) {
             switch (c) {
                   case 'f': filename = optarg; break;
                   case 'o': outfilename = optarg; break;
                   case 't': types = MusEPlugin::PluginScanInfoStruct::PluginType_t(atoi(optarg)); break;
                   case 'p': do_ports = true; break;
-                  default:  std::fprintf(stderr, "%s: -t <types flags> -f <filename> -o <output filename> -p (scan plugin ports)\n",
-                              argv[0]);  return -1;
+                  case 's': server = true; break;
+                  default:  std::fprintf(stderr, "%s: -t <types flags> -f <filename> -o <output filename> -p (scan plugin ports)\n"
+                                                 "%s: -s (server mode: read requests from standard input)\n",
+                              argv[0], argv[0]);  return -1;
                   }
             }
 
+      if(server)
+        return MusEPluginScan::scanServer();
+
       if(!filename || filename[0] == 0)
       {
         std::fprintf(stderr, "Error: No filename given\n");
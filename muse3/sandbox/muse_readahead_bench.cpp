@@ -0,0 +1,249 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  muse_readahead_bench.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//   Measures the effect of the kernel read-ahead hints which
+//    SndFile gives for streamed sound files (config setting
+//    diskReadAheadHints).
+//   Writes one wave file per track into a directory, then
+//    reads them through SndFile::openRead() and
+//    Event::readAudio(), the calls the prefetch thread makes:
+//    one chunk of each track in turn, from the start to the
+//    end. With the hints on, openRead() gives
+//    POSIX_FADV_SEQUENTIAL and readAudio() announces the next
+//    chunk with POSIX_FADV_WILLNEED.
+//   The files are dropped from the page cache before each
+//    run. The time of the slowest chunk matters more for
+//    dropouts than the total.
+//---------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sndfile.h>
+
+#include <QString>
+
+#include "event.h"
+#include "gconfig.h"
+#include "wave.h"
+
+namespace MusEReadAheadBench {
+
+static const int channels = 2;
+
+//---------------------------------------------------------
+//   nowUs
+//---------------------------------------------------------
+
+static double nowUs()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return double(ts.tv_sec) * 1e6 + double(ts.tv_nsec) / 1e3;
+      }
+
+//---------------------------------------------------------
+//   writeFiles
+//    16 bit stereo noise. Returns true on error.
+//---------------------------------------------------------
+
+static bool writeFiles(const std::vector<QString>& paths, sf_count_t frames)
+      {
+      std::vector<short> block(65536 * channels);
+      for (size_t i = 0; i < block.size(); ++i)
+            block[i] = short(rand());
+      for (size_t f = 0; f < paths.size(); ++f) {
+            SF_INFO info;
+            info.samplerate = 48000;
+            info.channels   = channels;
+            info.format     = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+            SNDFILE* sf = sf_open(paths[f].toLocal8Bit().constData(), SFM_WRITE, &info);
+            if (!sf) {
+                  std::fprintf(stderr, "%s: %s\n", paths[f].toLocal8Bit().constData(), sf_strerror(0));
+                  return true;
+                  }
+            for (sf_count_t done = 0; done < frames; ) {
+                  const sf_count_t n = std::min(sf_count_t(block.size() / channels), frames - done);
+                  if (sf_writef_short(sf, block.data(), n) != n) {
+                        sf_close(sf);
+                        return true;
+                        }
+                  done += n;
+                  }
+            sf_write_sync(sf);
+            if (sf_close(sf))
+                  return true;
+            }
+      return false;
+      }
+
+//---------------------------------------------------------
+//   dropCache
+//    Asks the kernel to drop the files' clean pages, which
+//     needs no privileges, unlike /proc/sys/vm/drop_caches.
+//---------------------------------------------------------
+
+static void dropCache(const std::vector<QString>& paths)
+      {
+      for (size_t f = 0; f < paths.size(); ++f) {
+            const int fd = ::open(paths[f].toLocal8Bit().constData(), O_RDONLY);
+            if (fd == -1)
+                  continue;
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+            }
+      }
+
+//---------------------------------------------------------
+//   Result
+//---------------------------------------------------------
+
+struct Result {
+      double totalUs;
+      double maxChunkUs;
+      double p99ChunkUs;
+      };
+
+//---------------------------------------------------------
+//   run
+//    Returns true on error.
+//---------------------------------------------------------
+
+static bool run(bool hints, const std::vector<QString>& paths, sf_count_t frames, unsigned chunk, Result& result)
+      {
+      // Read by openRead() and readAudio().
+      MusEGlobal::config.diskReadAheadHints = hints;
+      dropCache(paths);
+
+      std::vector<MusECore::Event> events;
+      for (size_t f = 0; f < paths.size(); ++f) {
+            MusECore::SndFileR sf(new MusECore::SndFile(paths[f]));
+            // No peak file, only the playback handle.
+            if (sf->openRead(false, false)) {
+                  std::fprintf(stderr, "%s: cannot open\n", paths[f].toLocal8Bit().constData());
+                  return true;
+                  }
+            MusECore::Event e(MusECore::Wave);
+            e.setSndFile(sf);
+            e.setSpos(0);
+            e.setFrame(0);
+            e.setLenFrame(frames);
+            events.push_back(e);
+            }
+
+      std::vector<float> data(chunk * channels);
+      float* buffer[channels];
+      for (int c = 0; c < channels; ++c)
+            buffer[c] = data.data() + c * chunk;
+      std::vector<double> times;
+      times.reserve((frames / chunk + 1) * events.size());
+      const double start = nowUs();
+      for (sf_count_t off = 0; off < frames; off += chunk) {
+            const int n = std::min(sf_count_t(chunk), frames - off);
+            for (size_t f = 0; f < events.size(); ++f) {
+                  const double t = nowUs();
+                  events[f].readAudio(0, off, buffer, channels, n, true, true);
+                  times.push_back(nowUs() - t);
+                  }
+            }
+      result.totalUs = nowUs() - start;
+
+      // The last references close the files.
+      events.clear();
+
+      std::sort(times.begin(), times.end());
+      result.maxChunkUs = times.empty() ? 0.0 : times.back();
+      result.p99ChunkUs = times.empty() ? 0.0 : times[times.size() * 99 / 100];
+      return false;
+      }
+
+} // namespace MusEReadAheadBench
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      using namespace MusEReadAheadBench;
+
+      QString dir = "/tmp";
+      int tracks = 16;
+      int megabytes = 32;
+      // A typical prefetch segment.
+      unsigned chunk = 512;
+      int repeats = 3;
+      int c;
+      while ((c = getopt(argc, argv, "d:t:m:c:r:")) != EOF) {
+            switch (c) {
+                  case 'd': dir = optarg; break;
+                  case 't': tracks = atoi(optarg); break;
+                  case 'm': megabytes = atoi(optarg); break;
+                  case 'c': chunk = atoi(optarg); break;
+                  case 'r': repeats = atoi(optarg); break;
+                  default:  std::fprintf(stderr, "%s: -d <directory> -t <tracks> -m <megabytes per track>"
+                              " -c <chunk frames> -r <repeats>\n", argv[0]);
+                            return -1;
+                  }
+            }
+      if (tracks <= 0 || megabytes <= 0 || chunk == 0 || repeats <= 0) {
+            std::fprintf(stderr, "%s: invalid arguments\n", argv[0]);
+            return -1;
+            }
+
+      const sf_count_t frames = (sf_count_t(megabytes) << 20) / (channels * sizeof(short));
+      std::vector<QString> paths;
+      for (int i = 0; i < tracks; ++i)
+            paths.push_back(QString("%1/muse_readahead_bench_%2.wav").arg(dir).arg(i));
+      if (writeFiles(paths, frames))
+            return 1;
+
+      std::printf("%d tracks of %d MB (16 bit stereo), %u frame chunks, best of %d runs from a dropped cache:\n",
+            tracks, megabytes, chunk, repeats);
+      bool ok = true;
+      for (int h = 0; h < 2 && ok; ++h) {
+            Result best = { 0.0, 0.0, 0.0 };
+            for (int r = 0; r < repeats; ++r) {
+                  Result res;
+                  if (run(h, paths, frames, chunk, res)) {
+                        ok = false;
+                        break;
+                        }
+                  if (r == 0 || res.totalUs < best.totalUs)
+                        best = res;
+                  }
+            if (ok)
+                  std::printf("  %-10s total %8.1f ms  %7.1f MB/s  p99 chunk %7.1f us  max chunk %8.1f us\n",
+                        h ? "hints" : "no hints", best.totalUs / 1e3,
+                        double(megabytes) * tracks * 1.048576 / (best.totalUs / 1e6),
+                        best.p99ChunkUs, best.maxChunkUs);
+            }
+
+      for (size_t i = 0; i < paths.size(); ++i)
+            ::unlink(paths[i].toLocal8Bit().constData());
+      return ok ? 0 : 1;
+      }
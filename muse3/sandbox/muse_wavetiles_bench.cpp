@@ -0,0 +1,287 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  muse_wavetiles_bench.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//   Times one repaint of a full screen of stereo wave
+//    tracks, with the real peak file and tile cache:
+//   direct: Each pixel column read from the PeakFile and
+//    drawn with QPainter lines from waveColumnLines(), as
+//    PartCanvas::drawWave() does without tiles.
+//   tiles:  waveTiles() lookups and one QPainter::drawImage()
+//    per tile, as PartCanvas::drawWaveTiles() does. The
+//    tiles are rendered by the background thread first.
+//   The sound file is written to a temporary directory,
+//    its peak file is built there with PeakFile::buildChunk().
+//   Fails if the tiles take longer than the gui budget.
+//---------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unistd.h>
+#include <time.h>
+#include <sndfile.h>
+
+#include <QGuiApplication>
+#include <QImage>
+#include <QPainter>
+#include <QPen>
+#include <QFile>
+
+#include "wave.h"
+#include "peakfile.h"
+#include "wavetiles.h"
+
+namespace MusEWaveTilesBench {
+
+// Time for drawing the visible waves on one repaint, a quarter of a 60 Hz frame.
+static const double guiBudgetMs = 4.0;
+static const unsigned channels = 2;
+
+//---------------------------------------------------------
+//   nowUs
+//---------------------------------------------------------
+
+static double nowUs()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return double(ts.tv_sec) * 1e6 + double(ts.tv_nsec) / 1e3;
+      }
+
+//---------------------------------------------------------
+//   writeSoundFile
+//    Noise with a slowly changing level. Returns true on error.
+//---------------------------------------------------------
+
+static bool writeSoundFile(const QString& path, sf_count_t frames)
+      {
+      SF_INFO info;
+      info.samplerate = 48000;
+      info.channels   = channels;
+      info.format     = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+      SNDFILE* sf = sf_open(path.toLocal8Bit().constData(), SFM_WRITE, &info);
+      if (!sf)
+            return true;
+      std::vector<float> buf(4096 * channels);
+      srand(1);
+      for (sf_count_t pos = 0; pos < frames; ) {
+            const sf_count_t n = std::min(sf_count_t(4096), frames - pos);
+            for (sf_count_t i = 0; i < n * channels; ++i) {
+                  const float level = 0.5f + 0.5f * float(((pos + i / channels) >> 16) & 0xff) / 255.0f;
+                  buf[i] = level * (float(rand()) / RAND_MAX * 2.0f - 1.0f);
+                  }
+            if (sf_writef_float(sf, buf.data(), n) != n) {
+                  sf_close(sf);
+                  return true;
+                  }
+            pos += n;
+            }
+      return sf_close(sf) != 0;
+      }
+
+//---------------------------------------------------------
+//   buildPeaks
+//    Returns 0 on error.
+//---------------------------------------------------------
+
+static std::shared_ptr<MusECore::PeakFile> buildPeaks(const QString& soundPath, sf_count_t frames)
+      {
+      std::shared_ptr<MusECore::PeakFile> pf(new MusECore::PeakFile(MusECore::peakFilePath(soundPath), soundPath));
+      if (pf->open(channels, frames))
+            return std::shared_ptr<MusECore::PeakFile>();
+      SF_INFO info;
+      info.format = 0;
+      SNDFILE* sf = sf_open(soundPath.toLocal8Bit().constData(), SFM_READ, &info);
+      if (!sf)
+            return std::shared_ptr<MusECore::PeakFile>();
+      while (pf->buildChunk(sf))
+            ;
+      sf_close(sf);
+      if (!pf->isComplete())
+            return std::shared_ptr<MusECore::PeakFile>();
+      return pf;
+      }
+
+//---------------------------------------------------------
+//   drawDirect
+//---------------------------------------------------------
+
+static void drawDirect(QPainter& p, const MusECore::PeakFile& pf, const MusECore::WaveTileStyle& style,
+   int startY, int width, int mag, sf_count_t pos)
+      {
+      QPen pen;
+      pen.setCosmetic(true);
+      const QColor peakColor = QColor::fromRgba(style.peakColor);
+      const QColor rmsColor  = QColor::fromRgba(style.rmsColor);
+      MusECore::SampleV sa[channels];
+      MusECore::WaveColumnLine lines[2 * channels];
+      for (int x = 0; x < width; ++x, pos += mag) {
+            for (unsigned k = 0; k < channels; ++k) {
+                  sa[k].peak = 0;
+                  sa[k].rms  = 0;
+                  }
+            pf.read(sa, mag, pos, true);
+            const int n = MusECore::waveColumnLines(sa, channels, style, lines);
+            for (int k = 0; k < n; ++k) {
+                  pen.setColor(lines[k].inner ? rmsColor : peakColor);
+                  p.setPen(pen);
+                  p.drawLine(x, startY + lines[k].y1, x, startY + lines[k].y2);
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   drawTiles
+//    Returns false if not all tiles are rendered yet.
+//---------------------------------------------------------
+
+static bool drawTiles(QPainter& p, const std::shared_ptr<MusECore::PeakFile>& pf, const MusECore::WaveTileStyle& style,
+   int startY, int width, int mag, int scroll)
+      {
+      const sf_count_t first = scroll / MusECore::waveTileWidth;
+      const sf_count_t last  = (scroll + width - 1) / MusECore::waveTileWidth;
+      std::vector<QImage> tiles;
+      if (!MusECore::waveTiles(pf, mag, first, last, style, tiles))
+            return false;
+      for (sf_count_t t = first; t <= last; ++t)
+            p.drawImage(int(t * MusECore::waveTileWidth) - scroll, startY, tiles[t - first]);
+      return true;
+      }
+
+} // namespace MusEWaveTilesBench
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      using namespace MusEWaveTilesBench;
+
+      if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+      QGuiApplication app(argc, argv);
+
+      int width = 1920;
+      int tracks = 16;
+      int trackHeight = 64;
+      int mag = 1024;
+      int repeats = 20;
+      int c;
+      while ((c = getopt(argc, argv, "w:t:h:m:r:")) != EOF) {
+            switch (c) {
+                  case 'w': width = atoi(optarg); break;
+                  case 't': tracks = atoi(optarg); break;
+                  case 'h': trackHeight = atoi(optarg); break;
+                  case 'm': mag = atoi(optarg); break;
+                  case 'r': repeats = atoi(optarg); break;
+                  default:  std::fprintf(stderr, "%s: -w <screen width> -t <tracks> -h <track height>"
+                              " -m <frames per pixel> -r <repeats>\n", argv[0]);
+                            return -1;
+                  }
+            }
+      if (width <= 0 || tracks <= 0 || trackHeight < 8 || mag < MusECore::peakFileBaseMag || repeats <= 0) {
+            std::fprintf(stderr, "%s: invalid arguments\n", argv[0]);
+            return -1;
+            }
+
+      char dir[] = "/tmp/muse_wavetiles_bench_XXXXXX";
+      if (!mkdtemp(dir)) {
+            std::perror("mkdtemp");
+            return 1;
+            }
+      const QString soundPath = QString(dir) + "/wave.wav";
+      // Room for scrolling by up to a tile.
+      const sf_count_t frames = sf_count_t(width + MusECore::waveTileWidth) * mag;
+      bool ok = true;
+      double direct = 1e30, tiled = 1e30;
+      {
+      std::shared_ptr<MusECore::PeakFile> pf;
+      if (writeSoundFile(soundPath, frames) || !(pf = buildPeaks(soundPath, frames))) {
+            std::fprintf(stderr, "cannot write the sound file or its peak file in %s\n", dir);
+            ok = false;
+            }
+      else {
+            MusECore::WaveTileStyle style;
+            style.mode      = MusECore::WaveTileStyle::Channels;
+            style.height    = trackHeight;
+            style.yScale    = 0;
+            style.peakColor = qPremultiply(qRgb(0x20, 0x40, 0xc0));
+            style.rmsColor  = qPremultiply(qRgb(0x80, 0xa0, 0xff));
+            style.drawRms   = true;
+
+            QImage screen(width, tracks * trackHeight, QImage::Format_ARGB32_Premultiplied);
+
+            // Let the background thread render all tiles of any scroll position.
+            bool rendered = false;
+            for (int i = 0; i < 10000 && !rendered; ++i) {
+                  QPainter p(&screen);
+                  rendered = drawTiles(p, pf, style, 0, width + MusECore::waveTileWidth, mag, 0);
+                  if (!rendered)
+                        usleep(1000);
+                  }
+            if (!rendered) {
+                  std::fprintf(stderr, "the tiles were not rendered\n");
+                  ok = false;
+                  }
+
+            for (int r = 0; ok && r < repeats; ++r) {
+                  // Scrolled by a different amount each time, as while playing.
+                  const int scroll = (r * 37) % MusECore::waveTileWidth;
+
+                  screen.fill(0);
+                  double t0 = nowUs();
+                  {
+                  QPainter p(&screen);
+                  for (int tr = 0; tr < tracks; ++tr)
+                        drawDirect(p, *pf, style, tr * trackHeight, width, mag, sf_count_t(scroll) * mag);
+                  }
+                  direct = std::min(direct, nowUs() - t0);
+
+                  screen.fill(0);
+                  t0 = nowUs();
+                  {
+                  QPainter p(&screen);
+                  for (int tr = 0; tr < tracks; ++tr)
+                        if (!drawTiles(p, pf, style, tr * trackHeight, width, mag, scroll))
+                              ok = false;
+                  }
+                  tiled = std::min(tiled, nowUs() - t0);
+                  }
+            }
+      MusECore::exitWaveTileRenderer();
+      }
+      QFile::remove(MusECore::peakFilePath(soundPath));
+      QFile::remove(soundPath);
+      rmdir(dir);
+      if (!ok)
+            return 1;
+
+      std::printf("repaint of %d stereo tracks, %dx%d px, %d frames per pixel, best of %d:\n",
+            tracks, width, trackHeight, mag, repeats);
+      std::printf("  direct %8.3f ms\n  tiles  %8.3f ms  (budget %.1f ms)\n",
+            direct / 1e3, tiled / 1e3, guiBudgetMs);
+      return tiled / 1e3 > guiBudgetMs ? 1 : 0;
+      }
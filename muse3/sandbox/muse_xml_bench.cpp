@@ -0,0 +1,242 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  muse_xml_bench.cpp
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//   Times the Xml reader on a song sized document.
+//   A synthetic song is made in memory: tracks with a few
+//    settings and parts full of midi events, laid out the
+//    way Song::write() lays them out. It is read three ways:
+//      tokens    parse() only, no QStrings at all
+//      s1        parse() then s1() for every token, which
+//                 is what parse() used to do by itself
+//      reader    the usual reading loop: s1() after every
+//                 parse(), s2Int() for event attributes,
+//                 parseInt() and parse1() for values, and
+//                 skip() for one unknown tag per track
+//   A song file given with -f is read instead, from a FILE,
+//    the way MusE loads it.
+//---------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <time.h>
+
+#include <QString>
+
+#include "xml.h"
+
+namespace MusEXmlBench {
+
+//---------------------------------------------------------
+//   nowUs
+//---------------------------------------------------------
+
+static double nowUs()
+      {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return double(ts.tv_sec) * 1e6 + double(ts.tv_nsec) / 1e3;
+      }
+
+//---------------------------------------------------------
+//   makeSong
+//---------------------------------------------------------
+
+static std::string makeSong(int tracks, int parts, int events)
+      {
+      std::string s = "<?xml version=\"1.0\"?>\n<muse version=\"3.1\">\n  <song>\n";
+      char line[256];
+      srand(1);
+      for (int t = 0; t < tracks; ++t) {
+            s += "    <miditrack>\n";
+            std::snprintf(line, sizeof(line), "      <name>Track %d</name>\n", t + 1);
+            s += line;
+            std::snprintf(line, sizeof(line), "      <height>%d</height>\n", 20 + t);
+            s += line;
+            s += "      <comment>Strings &amp; pads</comment>\n";
+            s += "      <unknownSetting>\n        <a>1</a>\n        <b>2</b>\n      </unknownSetting>\n";
+            for (int p = 0; p < parts; ++p) {
+                  s += "      <part>\n";
+                  std::snprintf(line, sizeof(line), "        <poslen tick=\"%d\" len=\"%d\" />\n", p * 7680, 7680);
+                  s += line;
+                  int tick = 0;
+                  for (int e = 0; e < events; ++e) {
+                        tick += rand() % 240;
+                        std::snprintf(line, sizeof(line),
+                              "        <event tick=\"%d\" len=\"%d\" a=\"%d\" b=\"%d\" />\n",
+                              tick, 24 + rand() % 480, 36 + rand() % 60, 1 + rand() % 127);
+                        s += line;
+                        }
+                  s += "      </part>\n";
+                  }
+            s += "    </miditrack>\n";
+            }
+      s += "  </song>\n</muse>\n";
+      return s;
+      }
+
+enum Mode { Tokens, S1, Reader };
+static const char* modeNames[] = { "tokens", "s1", "reader" };
+
+//---------------------------------------------------------
+//   readEvent
+//---------------------------------------------------------
+
+static long readEvent(MusECore::Xml& xml)
+      {
+      long sum = 0;
+      for (;;) {
+            MusECore::Xml::Token token = xml.parse();
+            const QString& tag = xml.s1();
+            switch (token) {
+                  case MusECore::Xml::Error:
+                  case MusECore::Xml::End:
+                        return sum;
+                  case MusECore::Xml::Attribut:
+                        if (tag == "tick" || tag == "len" || tag == "a" || tag == "b")
+                              sum += xml.s2Int();
+                        break;
+                  case MusECore::Xml::TagEnd:
+                        if (tag == "event")
+                              return sum;
+                  default:
+                        break;
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   read
+//    Returns a checksum, so nothing is optimized away.
+//---------------------------------------------------------
+
+static long read(MusECore::Xml& xml, Mode mode)
+      {
+      long sum = 0;
+      for (;;) {
+            MusECore::Xml::Token token = xml.parse();
+            if (token == MusECore::Xml::Error || token == MusECore::Xml::End)
+                  return sum;
+            if (mode == Tokens) {
+                  ++sum;
+                  continue;
+                  }
+            const QString& tag = xml.s1();
+            if (mode == S1) {
+                  sum += tag.size();
+                  continue;
+                  }
+            if (token != MusECore::Xml::TagStart)
+                  continue;
+            if (tag == "event")
+                  sum += readEvent(xml);
+            else if (tag == "height")
+                  sum += xml.parseInt();
+            else if (tag == "name" || tag == "comment")
+                  sum += xml.parse1().size();
+            else if (tag == "unknownSetting")
+                  xml.skip(tag);
+            }
+      }
+
+} // namespace MusEXmlBench
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      using namespace MusEXmlBench;
+
+      int tracks = 64;
+      int parts = 8;
+      int events = 400;
+      int repeats = 5;
+      const char* path = 0;
+      int c;
+      while ((c = getopt(argc, argv, "t:p:e:r:f:")) != EOF) {
+            switch (c) {
+                  case 't': tracks = atoi(optarg); break;
+                  case 'p': parts = atoi(optarg); break;
+                  case 'e': events = atoi(optarg); break;
+                  case 'r': repeats = atoi(optarg); break;
+                  case 'f': path = optarg; break;
+                  default:  std::fprintf(stderr, "%s: -t <tracks> -p <parts per track> -e <events per part>"
+                              " -r <repeats> -f <song file>\n", argv[0]);
+                            return -1;
+                  }
+            }
+      if (repeats <= 0)
+            repeats = 1;
+
+      std::string song;
+      double megabytes;
+      if (path) {
+            FILE* f = fopen(path, "r");
+            if (!f) {
+                  std::perror(path);
+                  return 1;
+                  }
+            fseek(f, 0, SEEK_END);
+            megabytes = double(ftell(f)) / 1e6;
+            fclose(f);
+            std::printf("%s, %.1f MB, best of %d runs:\n", path, megabytes, repeats);
+            }
+      else {
+            song = makeSong(tracks, parts, events);
+            megabytes = double(song.size()) / 1e6;
+            std::printf("%d tracks x %d parts x %d events, %.1f MB, best of %d runs:\n",
+                  tracks, parts, events, megabytes, repeats);
+            }
+
+      for (int m = Tokens; m <= Reader; ++m) {
+            double best = 0.0;
+            long sum = 0;
+            for (int r = 0; r < repeats; ++r) {
+                  FILE* f = 0;
+                  if (path && !(f = fopen(path, "r"))) {
+                        std::perror(path);
+                        return 1;
+                        }
+                  const double t = nowUs();
+                  if (f) {
+                        MusECore::Xml xml(f);
+                        sum = read(xml, Mode(m));
+                        }
+                  else {
+                        MusECore::Xml xml(song.c_str());
+                        sum = read(xml, Mode(m));
+                        }
+                  const double us = nowUs() - t;
+                  if (f)
+                        fclose(f);
+                  if (r == 0 || us < best)
+                        best = us;
+                  }
+            std::printf("  %-7s %8.2f ms  %7.1f MB/s  (checksum %ld)\n",
+                  modeNames[m], best / 1e3, megabytes / (best / 1e6), sum);
+            }
+      return 0;
+      }
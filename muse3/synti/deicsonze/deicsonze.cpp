@@ -4087,6 +4087,249 @@ void DeicsOnze::processMessages()
   }
 }
 
+//---------------------------------------------------------
+// renderVoice
+//  renders the voice v of the channel c at the n computed
+//  samples of a block and adds them to out. lfoInc and
+//  lfoAmp hold the channel's lfo state at these samples.
+//  Stops when the voice turns off. Returns the last sample
+//  at which the portamento set the channel's lastInc, or -1.
+//---------------------------------------------------------
+int DeicsOnze::renderVoice(int c, Voice* v, int n, const float* lfoInc,
+			   const float* lfoAmp, float* out) {
+  Preset* p = _preset[c];
+  Channel* p_c = &_global.channel[c];
+  float sample;
+  float sampleOp[NBROP];
+  float ampOp[NBROP];
+  int lastIncAt = -1;
+  for(int i = 0; i < n; i++) {
+    //portamento
+    if(v->hasAttractor) lastIncAt = i;
+    portamentoUpdate(p_c, v);
+    //pitch envelope
+    pitchEnvelopeUpdate(v, &p->pitchEg, _global.deiSampleRate);
+    //per op
+    for(int k=0; k<NBROP; k++) {
+      //compute the next index on the wavetable,
+      //without taking account of the feedback and FM modulation
+      v->op[k].index=
+	plusMod(v->op[k].index,
+		v->op[k].inct * lfoInc[i] * v->pitchEnvCoefInct);
+
+      ampOp[k]=v->op[k].amp*COEFLEVEL
+	*(p->sensitivity.ampOn[k]?lfoAmp[i]:1.0)
+	*env2AmpR(_global.deiSampleRate, waveTable[W2], p->eg[k], &v->op[k]);
+    }
+    sample = 0.0;
+    switch(p->algorithm) {
+    case FIRST :
+      sampleOp[3]=ampOp[3]
+	*waveTable[p->oscWave[3]]
+	[(int)plusMod(v->op[3].index,
+		      (float)RESOLUTION
+		      *v->sampleFeedback)];
+      sampleOp[2]=ampOp[2]
+	*waveTable[p->oscWave[2]]
+	[(int)plusMod(v->op[2].index,
+		      (float)RESOLUTION*sampleOp[3])];
+      sampleOp[1]=ampOp[1]
+	*waveTable[p->oscWave[1]]
+	[(int)plusMod(v->op[1].index,
+		      (float)RESOLUTION*sampleOp[2])];
+      sampleOp[0]=ampOp[0]
+	*waveTable[p->oscWave[0]]
+	[(int)plusMod(v->op[0].index,
+		      (float)RESOLUTION*sampleOp[1])];
+
+      sample=sampleOp[0];///COEFLEVEL;
+
+      v->isOn =
+	(v->op[0].envState!=OFF);
+      break;
+    case SECOND :
+      sampleOp[3]=ampOp[3]
+	*waveTable[p->oscWave[3]]
+	[(int)plusMod(v->op[3].index,
+		      (float)RESOLUTION
+		      *v->sampleFeedback)];
+      sampleOp[2]=ampOp[2]
+	*waveTable[p->oscWave[2]]
+	[(int)v->op[2].index];
+      sampleOp[1]=ampOp[1]
+	*waveTable[p->oscWave[1]]
+	[(int)plusMod(v->op[1].index,
+		      (float)RESOLUTION
+		      *(sampleOp[2]+sampleOp[3])/2.0)];
+      sampleOp[0]=ampOp[0]
+	*waveTable[p->oscWave[0]]
+	[(int)plusMod(v->op[0].index,
+		      (float)RESOLUTION
+		      *sampleOp[1])];
+
+      sample=sampleOp[0];///COEFLEVEL;
+
+      v->isOn =
+	(v->op[0].envState!=OFF);
+      break;
+    case THIRD :
+      sampleOp[3]=ampOp[3]
+	*waveTable[p->oscWave[3]]
+	[(int)plusMod(v->op[3].index,
+		      (float)RESOLUTION
+		      *v->sampleFeedback)];
+      sampleOp[2]=ampOp[2]
+	*waveTable[p->oscWave[2]]
+	[(int)v->op[2].index];
+      sampleOp[1]=ampOp[1]
+	*waveTable[p->oscWave[1]]
+	[(int)plusMod(v->op[1].index,
+		      (float)RESOLUTION*sampleOp[2])];
+      sampleOp[0]=ampOp[0]
+	*waveTable[p->oscWave[0]]
+	[(int)plusMod(v->op[0].index,
+		      (float)RESOLUTION
+		      *(sampleOp[3]+sampleOp[1])/2.0)];
+
+      sample=sampleOp[0];///COEFLEVEL;
+
+      v->isOn = 
+	(v->op[0].envState!=OFF);
+      break;
+    case FOURTH :
+      sampleOp[3]=ampOp[3]
+	*waveTable[p->oscWave[3]]
+	[(int)plusMod(v->op[3].index,
+		      (float)RESOLUTION
+		      *v->sampleFeedback)];
+      sampleOp[2]=ampOp[2]
+	*waveTable[p->oscWave[2]]
+	[(int)plusMod(v->op[2].index,
+		      (float)RESOLUTION
+		      *sampleOp[3])];
+      sampleOp[1]=ampOp[1]
+	*waveTable[p->oscWave[1]]
+	[(int)v->op[1].index];
+      sampleOp[0]=ampOp[0]
+	*waveTable[p->oscWave[0]]
+	[(int)plusMod(v->op[0].index,
+		      (float)RESOLUTION
+		      *(sampleOp[1]+sampleOp[2])/2.0)];
+
+      sample=sampleOp[0];///COEFLEVEL;
+
+      v->isOn =
+	(v->op[0].envState!=OFF);
+      break;
+    case FIFTH :
+      sampleOp[3]=ampOp[3]
+	*waveTable[p->oscWave[3]]
+	[(int)plusMod(v->op[3].index,
+		      (float)RESOLUTION
+		      *v->sampleFeedback)];
+      sampleOp[2]=ampOp[2]
+	*waveTable[p->oscWave[2]]
+	[(int)plusMod(v->op[2].index,
+		      (float)RESOLUTION*sampleOp[3])];
+      sampleOp[1]=ampOp[1]
+	*waveTable[p->oscWave[1]]
+	[(int)v->op[1].index];
+      sampleOp[0]=ampOp[0]
+	*waveTable[p->oscWave[0]]
+	[(int)plusMod(v->op[0].index,
+		      (float)RESOLUTION*sampleOp[1])];
+
+      sample=(sampleOp[0]+sampleOp[2])/2.0;///COEFLEVEL;
+
+      v->isOn = 
+	(v->op[0].envState!=OFF
+	 ||v->op[2].envState!=OFF);
+      break;
+    case SIXTH :
+      sampleOp[3]=ampOp[3]
+	*waveTable[p->oscWave[3]]
+	[(int)plusMod(v->op[3].index,
+		      (float)RESOLUTION
+		      *v->sampleFeedback)];
+      sampleOp[2]=ampOp[2]
+	*waveTable[p->oscWave[2]]
+	[(int)plusMod(v->op[2].index,
+		      (float)RESOLUTION*sampleOp[3])];
+      sampleOp[1]=ampOp[1]
+	*waveTable[p->oscWave[1]]
+	[(int)plusMod(v->op[1].index,
+		      (float)RESOLUTION*sampleOp[3])];
+      sampleOp[0]=ampOp[0]
+	*waveTable[p->oscWave[0]]
+	[(int)plusMod(v->op[0].index,
+		      (float)RESOLUTION*sampleOp[3])];
+
+      sample=(sampleOp[0]+sampleOp[1]+sampleOp[2])/3.0;
+
+      v->isOn = 
+	(v->op[0].envState!=OFF);
+      break;
+    case SEVENTH :
+      sampleOp[3]=ampOp[3]
+	*waveTable[p->oscWave[3]]
+	[(int)plusMod(v->op[3].index,
+		      (float)RESOLUTION
+		      *v->sampleFeedback)];
+      sampleOp[2]=ampOp[2]
+	*waveTable[p->oscWave[2]]
+	[(int)plusMod(v->op[2].index,
+		      (float)RESOLUTION*sampleOp[3])];
+      sampleOp[1]=ampOp[1]
+	*waveTable[p->oscWave[1]]
+	[(int)v->op[1].index];
+      sampleOp[0]=ampOp[0]*waveTable[p->oscWave[0]]
+	[(int)v->op[0].index];
+
+      sample=(sampleOp[0]+sampleOp[1]+sampleOp[2])/3.0;
+
+      v->isOn =
+	(v->op[0].envState!=OFF);
+      break;          
+    case EIGHTH :
+      sampleOp[3]=ampOp[3]
+	*waveTable[p->oscWave[3]]
+	[(int)plusMod(v->op[3].index,
+		      (float)RESOLUTION
+		      *v->sampleFeedback)];
+      sampleOp[2]=ampOp[2]
+	*waveTable[p->oscWave[2]]
+	[(int)v->op[2].index];
+      sampleOp[1]=ampOp[1]
+	*waveTable[p->oscWave[1]]
+	[(int)v->op[1].index];
+      sampleOp[0]=ampOp[0]
+	*waveTable[p->oscWave[0]]
+	[(int)v->op[0].index];
+
+      sample=
+	(sampleOp[0]+sampleOp[1]+sampleOp[2]+sampleOp[3])
+	/4.0;
+
+      v->isOn =
+	(v->op[0].envState!=OFF
+	 || v->op[1].envState!=OFF
+	 || v->op[2].envState!=OFF
+	 || v->op[3].envState!=OFF);
+      break;
+    default : printf("Error : No algorithm");
+      break;
+    }
+
+    v->volume=ampOp[0]+ampOp[1]+ampOp[2]+ampOp[3];
+
+    v->sampleFeedback=sampleOp[3]*p_c->feedbackAmp;
+
+    out[i] += sample;
+    if(!v->isOn) break;
+  }
+  return lastIncAt;
+}
+
 //---------------------------------------------------------
 //   write
 //    synthesize n samples into buffer+offset
@@ -4110,275 +4353,78 @@ void DeicsOnze::process(unsigned pos, float** buffer, int offset, int n) {
   float* leftOutput = buffer[0] + offset;
   float* rightOutput = buffer[1] + offset; 
 
-  float sample[MAXNBRVOICES];
+  //positions of the samples computed in the current block, depending on
+  //the quality the others repeat the last computed sample
+  int computed[RENDERBLOCK];
+  //per channel lfo state and output at the computed samples
+  float lfoInc[NBRCHANNELS][RENDERBLOCK];
+  float lfoAmp[NBRCHANNELS][RENDERBLOCK];
+  float channelOutput[NBRCHANNELS][RENDERBLOCK];
   float tempLeftOutput;
   float tempRightOutput;
-  float tempChannelOutput;
   float tempChannelLeftOutput;
   float tempChannelRightOutput;
-  float tempIncChannel; //for optimization
-  float sampleOp[NBROP];
-  for(int i = 0; i < NBROP; i++) sampleOp[i] = 0.0;
-  float ampOp[NBROP];
-  for(int i = 0; i < n; i++) {
-    if(_global.qualityCounter == 0) {
-      tempLeftOutput = 0.0;
-      tempRightOutput = 0.0;
-      _global.lastInputLeftChorusSample = 0.0;
-      _global.lastInputRightChorusSample = 0.0;
-      _global.lastInputLeftReverbSample = 0.0;
-      _global.lastInputRightReverbSample = 0.0;
-      _global.lastInputLeftDelaySample = 0.0;
-      _global.lastInputRightDelaySample = 0.0;
-      //per channel
-      for(int c = 0; c < NBRCHANNELS; c++) {
-	tempChannelOutput = 0.0;
+  for(int b = 0; b < n; b += RENDERBLOCK) {
+    int bn = (n - b < RENDERBLOCK ? n - b : RENDERBLOCK);
+    int nc = 0;
+    int qualityCounter = _global.qualityCounter;
+    for(int i = 0; i < bn; i++) {
+      if(qualityCounter == 0) computed[nc++] = i;
+      qualityCounter++;
+      qualityCounter %= _global.qualityCounterTop;
+    }
+
+    //lfo, trick : we use the first quater of the wave W2
+    //sample by sample then channel by channel, so that the sample and
+    //hold wave draws its random numbers in the same order
+    for(int k = 0; k < nc; k++)
+      for(int c = 0; c < NBRCHANNELS; c++)
 	if(_global.channel[c].isEnable) {
-	  //lfo, trick : we use the first quater of the wave W2
 	  lfoUpdate(_preset[c], &_global.channel[c], waveTable[W2]);
-	  
-	  //optimization
-	  tempIncChannel =
+	  lfoInc[c][k] =
 	    _global.channel[c].lfoCoefInct * _global.channel[c].pitchBendCoef;
-	  
-	  //per voice
-	  for(int j=0; j<_global.channel[c].nbrVoices; j++) {
-	    if (_global.channel[c].voices[j].isOn) {
-	      //portamento
-	      portamentoUpdate(&_global.channel[c],
-			       &_global.channel[c].voices[j]);
-	      //pitch envelope
-	      pitchEnvelopeUpdate(&_global.channel[c].voices[j],
-				  &_preset[c]->pitchEg, _global.deiSampleRate);
-	      //per op
-	      for(int k=0; k<NBROP; k++) {
-		//compute the next index on the wavetable,
-		//without taking account of the feedback and FM modulation
-		_global.channel[c].voices[j].op[k].index=
-		  plusMod(_global.channel[c].voices[j].op[k].index,
-			  _global.channel[c].voices[j].op[k].inct
-			  * tempIncChannel
-			  * _global.channel[c].voices[j].pitchEnvCoefInct);
-		
-		ampOp[k]=_global.channel[c].voices[j].op[k].amp*COEFLEVEL
-		  *(_preset[c]->sensitivity.ampOn[k]?
-		    _global.channel[c].lfoAmp:1.0)
-		  *env2AmpR(_global.deiSampleRate, waveTable[W2],
-			    _preset[c]->eg[k],
-			    &_global.channel[c].voices[j].op[k]);
-	      }
-	      switch(_preset[c]->algorithm) {
-	      case FIRST :
-		sampleOp[3]=ampOp[3]
-		  *waveTable[_preset[c]->oscWave[3]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[3].index,
-				(float)RESOLUTION
-				*_global.channel[c].voices[j].sampleFeedback)];
-		sampleOp[2]=ampOp[2]
-		  *waveTable[_preset[c]->oscWave[2]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[2].index,
-				(float)RESOLUTION*sampleOp[3])];
-		sampleOp[1]=ampOp[1]
-		  *waveTable[_preset[c]->oscWave[1]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[1].index,
-				(float)RESOLUTION*sampleOp[2])];
-		sampleOp[0]=ampOp[0]
-		  *waveTable[_preset[c]->oscWave[0]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[0].index,
-				(float)RESOLUTION*sampleOp[1])];
-		
-		sample[j]=sampleOp[0];///COEFLEVEL;
-		
-		_global.channel[c].voices[j].isOn =
-		  (_global.channel[c].voices[j].op[0].envState!=OFF);
-		break;
-	      case SECOND :
-		sampleOp[3]=ampOp[3]
-		  *waveTable[_preset[c]->oscWave[3]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[3].index,
-				(float)RESOLUTION
-				*_global.channel[c].voices[j].sampleFeedback)];
-		sampleOp[2]=ampOp[2]
-		  *waveTable[_preset[c]->oscWave[2]]
-		  [(int)_global.channel[c].voices[j].op[2].index];
-		sampleOp[1]=ampOp[1]
-		  *waveTable[_preset[c]->oscWave[1]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[1].index,
-				(float)RESOLUTION
-				*(sampleOp[2]+sampleOp[3])/2.0)];
-		sampleOp[0]=ampOp[0]
-		  *waveTable[_preset[c]->oscWave[0]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[0].index,
-				(float)RESOLUTION
-				*sampleOp[1])];
-		
-		sample[j]=sampleOp[0];///COEFLEVEL;
-		
-		_global.channel[c].voices[j].isOn =
-		  (_global.channel[c].voices[j].op[0].envState!=OFF);
-		break;
-	      case THIRD :
-		sampleOp[3]=ampOp[3]
-		  *waveTable[_preset[c]->oscWave[3]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[3].index,
-				(float)RESOLUTION
-				*_global.channel[c].voices[j].sampleFeedback)];
-		sampleOp[2]=ampOp[2]
-		  *waveTable[_preset[c]->oscWave[2]]
-		  [(int)_global.channel[c].voices[j].op[2].index];
-		sampleOp[1]=ampOp[1]
-		  *waveTable[_preset[c]->oscWave[1]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[1].index,
-				(float)RESOLUTION*sampleOp[2])];
-		sampleOp[0]=ampOp[0]
-		  *waveTable[_preset[c]->oscWave[0]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[0].index,
-				(float)RESOLUTION
-				*(sampleOp[3]+sampleOp[1])/2.0)];
-		
-		sample[j]=sampleOp[0];///COEFLEVEL;
-		
-		_global.channel[c].voices[j].isOn = 
-		  (_global.channel[c].voices[j].op[0].envState!=OFF);
-		break;
-	      case FOURTH :
-		sampleOp[3]=ampOp[3]
-		  *waveTable[_preset[c]->oscWave[3]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[3].index,
-				(float)RESOLUTION
-				*_global.channel[c].voices[j].sampleFeedback)];
-		sampleOp[2]=ampOp[2]
-		  *waveTable[_preset[c]->oscWave[2]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[2].index,
-				(float)RESOLUTION
-				*sampleOp[3])];
-		sampleOp[1]=ampOp[1]
-		  *waveTable[_preset[c]->oscWave[1]]
-		  [(int)_global.channel[c].voices[j].op[1].index];
-		sampleOp[0]=ampOp[0]
-		  *waveTable[_preset[c]->oscWave[0]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[0].index,
-				(float)RESOLUTION
-				*(sampleOp[1]+sampleOp[2])/2.0)];
-		
-		sample[j]=sampleOp[0];///COEFLEVEL;
-		
-		_global.channel[c].voices[j].isOn =
-		  (_global.channel[c].voices[j].op[0].envState!=OFF);
-		break;
-	      case FIFTH :
-		sampleOp[3]=ampOp[3]
-		  *waveTable[_preset[c]->oscWave[3]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[3].index,
-				(float)RESOLUTION
-				*_global.channel[c].voices[j].sampleFeedback)];
-		sampleOp[2]=ampOp[2]
-		  *waveTable[_preset[c]->oscWave[2]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[2].index,
-				(float)RESOLUTION*sampleOp[3])];
-		sampleOp[1]=ampOp[1]
-		  *waveTable[_preset[c]->oscWave[1]]
-		  [(int)_global.channel[c].voices[j].op[1].index];
-		sampleOp[0]=ampOp[0]
-		  *waveTable[_preset[c]->oscWave[0]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[0].index,
-				(float)RESOLUTION*sampleOp[1])];
-		
-		sample[j]=(sampleOp[0]+sampleOp[2])/2.0;///COEFLEVEL;
-		
-		_global.channel[c].voices[j].isOn = 
-		  (_global.channel[c].voices[j].op[0].envState!=OFF
-		   ||_global.channel[c].voices[j].op[2].envState!=OFF);
-		break;
-	      case SIXTH :
-		sampleOp[3]=ampOp[3]
-		  *waveTable[_preset[c]->oscWave[3]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[3].index,
-				(float)RESOLUTION
-				*_global.channel[c].voices[j].sampleFeedback)];
-		sampleOp[2]=ampOp[2]
-		  *waveTable[_preset[c]->oscWave[2]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[2].index,
-				(float)RESOLUTION*sampleOp[3])];
-		sampleOp[1]=ampOp[1]
-		  *waveTable[_preset[c]->oscWave[1]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[1].index,
-				(float)RESOLUTION*sampleOp[3])];
-		sampleOp[0]=ampOp[0]
-		  *waveTable[_preset[c]->oscWave[0]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[0].index,
-				(float)RESOLUTION*sampleOp[3])];
-		
-		sample[j]=(sampleOp[0]+sampleOp[1]+sampleOp[2])/3.0;
-		
-		_global.channel[c].voices[j].isOn = 
-		  (_global.channel[c].voices[j].op[0].envState!=OFF);
-		break;
-	      case SEVENTH :
-		sampleOp[3]=ampOp[3]
-		  *waveTable[_preset[c]->oscWave[3]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[3].index,
-				(float)RESOLUTION
-				*_global.channel[c].voices[j].sampleFeedback)];
-		sampleOp[2]=ampOp[2]
-		  *waveTable[_preset[c]->oscWave[2]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[2].index,
-				(float)RESOLUTION*sampleOp[3])];
-		sampleOp[1]=ampOp[1]
-		  *waveTable[_preset[c]->oscWave[1]]
-		  [(int)_global.channel[c].voices[j].op[1].index];
-		sampleOp[0]=ampOp[0]*waveTable[_preset[c]->oscWave[0]]
-		  [(int)_global.channel[c].voices[j].op[0].index];
-		
-		sample[j]=(sampleOp[0]+sampleOp[1]+sampleOp[2])/3.0;
-		
-		_global.channel[c].voices[j].isOn =
-		  (_global.channel[c].voices[j].op[0].envState!=OFF);
-		break;		
-	      case EIGHTH :
-		sampleOp[3]=ampOp[3]
-		  *waveTable[_preset[c]->oscWave[3]]
-		  [(int)plusMod(_global.channel[c].voices[j].op[3].index,
-				(float)RESOLUTION
-				*_global.channel[c].voices[j].sampleFeedback)];
-		sampleOp[2]=ampOp[2]
-		  *waveTable[_preset[c]->oscWave[2]]
-		  [(int)_global.channel[c].voices[j].op[2].index];
-		sampleOp[1]=ampOp[1]
-		  *waveTable[_preset[c]->oscWave[1]]
-		  [(int)_global.channel[c].voices[j].op[1].index];
-		sampleOp[0]=ampOp[0]
-		  *waveTable[_preset[c]->oscWave[0]]
-		  [(int)_global.channel[c].voices[j].op[0].index];
-		
-		sample[j]=
-		  (sampleOp[0]+sampleOp[1]+sampleOp[2]+sampleOp[3])
-		  /4.0;
-		
-		_global.channel[c].voices[j].isOn =
-		  (_global.channel[c].voices[j].op[0].envState!=OFF
-		   || _global.channel[c].voices[j].op[1].envState!=OFF
-		   || _global.channel[c].voices[j].op[2].envState!=OFF
-		   || _global.channel[c].voices[j].op[3].envState!=OFF);
-		break;
-	      default : printf("Error : No algorithm");
-		break;
-	      }
-	      
-	      _global.channel[c].voices[j].volume=
-		ampOp[0]+ampOp[1]+ampOp[2]+ampOp[3];
-	      
-	      _global.channel[c].voices[j].sampleFeedback =
-		sampleOp[3]*_global.channel[c].feedbackAmp;
-	      
-	      tempChannelOutput += sample[j];
-	    }
+	  lfoAmp[c][k] = _global.channel[c].lfoAmp;
+	}
+
+    //per channel, voice by voice over the whole block
+    for(int c = 0; c < NBRCHANNELS; c++) {
+      if(!_global.channel[c].isEnable) continue;
+      for(int k = 0; k < nc; k++) channelOutput[c][k] = 0.0;
+      //sample by sample the last voice to set lastInc was the one
+      //with the latest sample, of those the highest voice
+      int lastIncAt = -1;
+      double lastInc[NBROP];
+      for(int j=0; j<_global.channel[c].nbrVoices; j++)
+	if (_global.channel[c].voices[j].isOn) {
+	  int at = renderVoice(c, &_global.channel[c].voices[j], nc,
+			       lfoInc[c], lfoAmp[c], channelOutput[c]);
+	  if(at >= 0 && at >= lastIncAt) {
+	    lastIncAt = at;
+	    for(int k = 0; k < NBROP; k++)
+	      lastInc[k] = _global.channel[c].lastInc[k];
 	  }
-	  //printf("left out = %f, temp out = %f, left amp = %f\n",
-	  //tempLeftOutput, tempChannelOutput, _global.channel[c].ampLeft);
- 
-	  tempChannelLeftOutput = tempChannelOutput*_global.channel[c].ampLeft;
-	  tempChannelRightOutput=tempChannelOutput*_global.channel[c].ampRight;
+	}
+      if(lastIncAt >= 0)
+	for(int k = 0; k < NBROP; k++)
+	  _global.channel[c].lastInc[k] = lastInc[k];
+    }
+
+    //mix the channels and the effect inputs
+    int k = 0;
+    for(int i = 0; i < bn; i++) {
+      if(k < nc && computed[k] == i) {
+	tempLeftOutput = 0.0;
+	tempRightOutput = 0.0;
+	_global.lastInputLeftChorusSample = 0.0;
+	_global.lastInputRightChorusSample = 0.0;
+	_global.lastInputLeftReverbSample = 0.0;
+	_global.lastInputRightReverbSample = 0.0;
+	_global.lastInputLeftDelaySample = 0.0;
+	_global.lastInputRightDelaySample = 0.0;
+	for(int c = 0; c < NBRCHANNELS; c++) {
+	  if(!_global.channel[c].isEnable) continue;
+	  tempChannelLeftOutput = channelOutput[c][k]*_global.channel[c].ampLeft;
+	  tempChannelRightOutput=channelOutput[c][k]*_global.channel[c].ampRight;
 	  
 	  if(_global.isChorusActivated) {
 	    _global.lastInputLeftChorusSample += tempChannelLeftOutput *
@@ -4401,28 +4447,27 @@ void DeicsOnze::process(unsigned pos, float** buffer, int offset, int n) {
 	  tempLeftOutput += tempChannelLeftOutput;
 	  tempRightOutput += tempChannelRightOutput;
 	}
+	_global.lastLeftSample = tempLeftOutput * _global.masterVolume;
+	_global.lastRightSample = tempRightOutput * _global.masterVolume;
+	k++;
       }
-      _global.lastLeftSample = tempLeftOutput * _global.masterVolume;
-      _global.lastRightSample = tempRightOutput * _global.masterVolume;
-    }
-    leftOutput[i] += _global.lastLeftSample;
-    rightOutput[i] += _global.lastRightSample;
-	  
-    if(_global.isChorusActivated) {
-      tempInputChorus[0][i] = _global.lastInputLeftChorusSample;
-      tempInputChorus[1][i] = _global.lastInputRightChorusSample;
+      leftOutput[b + i] += _global.lastLeftSample;
+      rightOutput[b + i] += _global.lastRightSample;
+
+      if(_global.isChorusActivated) {
+	tempInputChorus[0][b + i] = _global.lastInputLeftChorusSample;
+	tempInputChorus[1][b + i] = _global.lastInputRightChorusSample;
+      }
+      if(_global.isReverbActivated) {
+	tempInputReverb[0][b + i] = _global.lastInputLeftReverbSample;
+	tempInputReverb[1][b + i] = _global.lastInputRightReverbSample;
+      }    
+      if(_global.isDelayActivated) {
+	tempInputDelay[0][b + i] = _global.lastInputLeftDelaySample;
+	tempInputDelay[1][b + i] = _global.lastInputRightDelaySample;
+      }    
     }
-    if(_global.isReverbActivated) {
-      tempInputReverb[0][i] = _global.lastInputLeftReverbSample;
-      tempInputReverb[1][i] = _global.lastInputRightReverbSample;
-    }    
-    if(_global.isDelayActivated) {
-      tempInputDelay[0][i] = _global.lastInputLeftDelaySample;
-      tempInputDelay[1][i] = _global.lastInputRightDelaySample;
-    }    
-    
-    _global.qualityCounter++;
-    _global.qualityCounter %= _global.qualityCounterTop;
+    _global.qualityCounter = qualityCounter;
   }
   //apply Filter
   if(_global.filter) _dryFilter->process(leftOutput, rightOutput, n);
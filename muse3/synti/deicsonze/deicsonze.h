@@ -97,6 +97,7 @@
 #define NBRBANKPRESETS 32
 #define MAXNBRVOICES 64
 #define NBRCHANNELS 16
+#define RENDERBLOCK 64 //number of samples rendered voice by voice at once
 
 #define SYSEX_INIT_DATA 1
 #define SYSEX_INIT_DATA_VERSION 1
@@ -604,6 +605,8 @@ class DeicsOnze : public Mess {
   virtual bool playNote(int channel, int pitch, int velo);
   virtual void processMessages();
   virtual void process(unsigned pos, float** buffer, int offset, int n);
+  int renderVoice(int c, Voice* v, int n, const float* lfoInc,
+		  const float* lfoAmp, float* out);
   
   // GUI interface routines
   virtual bool hasNativeGui() const { return true; }
@@ -52,14 +52,16 @@
 #define SS_DBG_LADSPA(string1) if (SS_DEBUG_LADSPA) fprintf(stderr, "%s:%d:%s: %s\n", __FILE__ , __LINE__ , __PRETTY_FUNCTION__, string1);
 #define SS_DBG_LADSPA2(string1, string2) if (SS_DEBUG_LADSPA) fprintf(stderr, "%s:%d:%s: %s: %s\n", __FILE__ , __LINE__ , __PRETTY_FUNCTION__, string1, string2);
 
-#define SS_SYSEX_INIT_DATA_VERSION           3
+#define SS_SYSEX_INIT_DATA_VERSION           4
 // version 2 added pitching support
 // version 3 added multi-channel routing support (danvd)
+// version 4 added interpolation and polyphonic retrigger settings
 #define SS_SYSEX_EFFECT_INIT_DATA_VERSION    2   // Added Jun 15 2011. Original value was SS_SYSEX_INIT_DATA_VERSION (1). p4.0.27 Tim. 
 
 #define SS_NR_OF_CHANNELS                   16
 #define SS_AUDIO_CHANNELS                    (2 + SS_NR_OF_CHANNELS*2)
 #define SS_NR_OF_SENDEFFECTS                 4
+#define SS_NR_OF_VOICES                      8   // Voices per channel when retriggering polyphonically
 
 // Controller-related:
 #define SS_CHANNEL_CTRL_VOLUME 0
@@ -111,6 +113,14 @@
 
 typedef unsigned char byte;
 
+// Interpolation used when playing samples back at another rate:
+enum SS_Interpolation {
+      SS_INTERPOLATION_LINEAR = 0,
+      SS_INTERPOLATION_CUBIC,
+      SS_INTERPOLATION_SINC,
+      SS_NR_OF_INTERPOLATIONS
+      };
+
 enum {
       SS_SYSEX_LOAD_SAMPLE = 0,   // gui -> synth: tell synth to load sample
       SS_SYSEX_INIT_DATA,         // synth reinitialization, the position of this (1) in the enum must not be changed since this value is written into proj file
@@ -128,7 +138,9 @@ enum {
       SS_SYSEX_ERRORMSG,           // synth -> gui: general error message from synth
       SS_SYSEX_GET_INIT_DATA,      // gui->synth: request init data
       SS_SYSEX_SEND_INIT_DATA,      // synth->gui: give gui init data
-      SS_SYSEX_PITCH_SAMPLE       // gui->synth: set pitch and reload sample
+      SS_SYSEX_PITCH_SAMPLE,      // gui->synth: set pitch of sample
+      SS_SYSEX_SET_INTERPOLATION, // gui->synth: set interpolation of sample playback, synth->gui: update gui
+      SS_SYSEX_SET_RETRIGGER      // gui->synth: set polyphonic retrigger of channel, synth->gui: update gui
       };
 
 extern int SS_segmentSize;
@@ -31,8 +31,9 @@
 
 #include "muse_math.h"
 #include <string.h>
+#include <unistd.h>
+#include <map>
 
-#include <samplerate.h>
 #include <QString>
 #include <QFileDialog>
 
@@ -89,6 +90,140 @@ double rangeToPitch(int value)
    return outValue;
 }
 
+//---------------------------------------------------------
+//   Sample store
+//    Samples are shared between channels (and synth instances)
+//    loading the same file. A sample is freed when the last
+//    channel holding it lets go of it.
+//---------------------------------------------------------
+typedef std::map<std::string, SS_Sample*> SS_SampleMap;
+static SS_SampleMap SS_sampleStore;
+static pthread_mutex_t SS_SampleStoreMutex = PTHREAD_MUTEX_INITIALIZER;
+
+//---------------------------------------------------------
+//   acquireSample
+//    Returns the stored sample for filename with its
+//    reference count raised, or 0 if it is not loaded yet.
+//---------------------------------------------------------
+static SS_Sample* acquireSample(const std::string& filename)
+{
+   SS_Sample* smp = 0;
+   pthread_mutex_lock(&SS_SampleStoreMutex);
+   SS_SampleMap::iterator it = SS_sampleStore.find(filename);
+   if (it != SS_sampleStore.end()) {
+      smp = it->second;
+      smp->refs++;
+   }
+   pthread_mutex_unlock(&SS_SampleStoreMutex);
+   return smp;
+}
+
+//---------------------------------------------------------
+//   storeSample
+//    Adds a freshly loaded sample, held once by the caller.
+//---------------------------------------------------------
+static void storeSample(SS_Sample* smp)
+{
+   pthread_mutex_lock(&SS_SampleStoreMutex);
+   smp->refs = 1;
+   SS_sampleStore[smp->filename] = smp;
+   pthread_mutex_unlock(&SS_SampleStoreMutex);
+}
+
+//---------------------------------------------------------
+//   releaseSample
+//---------------------------------------------------------
+static void releaseSample(SS_Sample* smp)
+{
+   pthread_mutex_lock(&SS_SampleStoreMutex);
+   if (--smp->refs <= 0) {
+      SS_SampleMap::iterator it = SS_sampleStore.find(smp->filename);
+      if (it != SS_sampleStore.end() && it->second == smp)
+         SS_sampleStore.erase(it);
+      delete[] smp->data;
+      delete smp;
+   }
+   pthread_mutex_unlock(&SS_SampleStoreMutex);
+}
+
+//---------------------------------------------------------
+//   Interpolation
+//    Samples are played back at file rate * pitch, reading
+//    between the stored frames. The windowed sinc uses a
+//    Blackman windowed kernel of SS_SINC_TAPS frames, tabled
+//    for SS_SINC_PHASES fractional positions.
+//---------------------------------------------------------
+#define SS_SINC_TAPS   16
+#define SS_SINC_PHASES 256
+
+static float SS_sincTable[SS_SINC_PHASES][SS_SINC_TAPS];
+static bool SS_sincTableInitialized = false;
+
+static void initSincTable()
+{
+   if (SS_sincTableInitialized)
+      return;
+   const double half = SS_SINC_TAPS / 2;
+   for (int p = 0; p < SS_SINC_PHASES; p++) {
+      const double frac = (double) p / (double) SS_SINC_PHASES;
+      for (int t = 0; t < SS_SINC_TAPS; t++) {
+         // Distance of tap frame from the playing position:
+         const double d = (double) (t - SS_SINC_TAPS / 2 + 1) - frac;
+         const double sinc = (fabs(d) < 1e-9) ? 1.0 : sin(M_PI * d) / (M_PI * d);
+         const double window = 0.42 + 0.5 * cos(M_PI * d / half) + 0.08 * cos(2.0 * M_PI * d / half);
+         SS_sincTable[p][t] = (float) (sinc * window);
+      }
+   }
+   SS_sincTableInitialized = true;
+}
+
+static inline float frameValue(const SS_Sample* smp, long frame, int c)
+{
+   if (frame < 0 || frame >= smp->frames)
+      return 0.0f;
+   return smp->data[frame * smp->channels + c];
+}
+
+//---------------------------------------------------------
+//   sampleValue
+//    Value of channel c of smp at the fractional frame pos
+//---------------------------------------------------------
+static inline float sampleValue(const SS_Sample* smp, double pos, int c, SS_Interpolation interpolation)
+{
+   const long frame = (long) pos;
+   const double frac = pos - (double) frame;
+   const float x = (float) frac;
+   switch (interpolation) {
+   case SS_INTERPOLATION_CUBIC:
+   {
+      // Catmull-Rom spline through the four surrounding frames:
+      const float y0 = frameValue(smp, frame - 1, c);
+      const float y1 = frameValue(smp, frame, c);
+      const float y2 = frameValue(smp, frame + 1, c);
+      const float y3 = frameValue(smp, frame + 2, c);
+      return y1 + 0.5f * x * (y2 - y0 + x * (2.0f * y0 - 5.0f * y1 + 4.0f * y2 - y3 + x * (3.0f * (y1 - y2) + y3 - y0)));
+   }
+   case SS_INTERPOLATION_SINC:
+   {
+      // In float a fraction just below 1 would round up to 1, past the last phase.
+      int phase = (int) (frac * SS_SINC_PHASES);
+      if (phase > SS_SINC_PHASES - 1)
+         phase = SS_SINC_PHASES - 1;
+      const float* k = SS_sincTable[phase];
+      const long first = frame - SS_SINC_TAPS / 2 + 1;
+      float v = 0.0f;
+      for (int t = 0; t < SS_SINC_TAPS; t++)
+         v += k[t] * frameValue(smp, first + t, c);
+      return v;
+   }
+   default:
+   {
+      const float y1 = frameValue(smp, frame, c);
+      return y1 + x * (frameValue(smp, frame + 1, c) - y1);
+   }
+   }
+}
+
 /*int pitchToRange(double pitch)
 {
     // inrange 0.5 .. 2
@@ -122,6 +257,9 @@ SimpleSynth::SimpleSynth(int sr)
    setSampleRate(sr);
          
    synth_state = SS_INITIALIZING;
+   processSerial = 0;
+   retiredWrite  = 0;
+   retiredRead   = 0;
    
    MusESimplePlugin::SS_initPlugins(SS_hostConfigPath);
 
@@ -131,11 +269,18 @@ SimpleSynth::SimpleSynth(int sr)
    master_vol = 100.0 / SS_MASTER_VOLUME_QUOT;
    master_vol_ctrlval = 100;
 
+   interpolation = SS_INTERPOLATION_CUBIC;
+   initSincTable();
+
    //initialize
    for (int i=0; i<SS_NR_OF_CHANNELS; i++) {
       channels[i].sample = 0;
-      channels[i].originalSample = 0;
-      channels[i].playoffset = 0;
+      for (int v=0; v<SS_NR_OF_VOICES; v++) {
+         channels[i].voices[v].active = false;
+         channels[i].voices[v].pos = 0.0;
+         channels[i].voices[v].gain_factor = 0.0;
+      }
+      channels[i].poly_retrigger = false;
       channels[i].noteoff_ignore = true /* false */; //ignore note-offs by default (good for drum editors with fixed note lengths)
       channels[i].volume = (double) (100.0/SS_CHANNEL_VOLUME_QUOT );
       channels[i].volume_ctrlval = 100;
@@ -261,10 +406,11 @@ SimpleSynth::~SimpleSynth()
    SS_DBG("Cleaning up sample data");
    for (int i=0; i<SS_NR_OF_CHANNELS; i++) {
       if (channels[i].sample) {
-         delete[] channels[i].sample->data;
-         delete channels[i].sample;
+         releaseSample(channels[i].sample);
+         channels[i].sample = 0;
       }
    }
+   releaseRetiredSamples();
 
    SS_DBG("Deleting plugin instances");
    for (int i=0; i<SS_NR_OF_SENDEFFECTS; i++) {
@@ -352,10 +498,25 @@ bool SimpleSynth::playNote(int /*channel*/, int pitch, int velo)
       if(!noteOff) {
          if (channels[ch].sample) {
             //Turn on the white stuff:
-            channels[ch].playoffset = 0;
-            SWITCH_CHAN_STATE(ch , SS_SAMPLE_PLAYING);
+            SS_Voice* voice = &channels[ch].voices[0];
+            if (channels[ch].poly_retrigger) {
+               // Take a free voice, or else steal the one that has played the longest:
+               for (int v=0; v<SS_NR_OF_VOICES; v++) {
+                  if (!channels[ch].voices[v].active) {
+                     voice = &channels[ch].voices[v];
+                     break;
+                  }
+                  if (channels[ch].voices[v].pos > voice->pos)
+                     voice = &channels[ch].voices[v];
+               }
+            }
+            else
+               stopVoices(ch);
             channels[ch].cur_velo = (double) velo / 127.0;
-            channels[ch].gain_factor = channels[ch].cur_velo * channels[ch].volume;
+            voice->gain_factor = channels[ch].cur_velo * channels[ch].volume;
+            voice->pos = 0.0;
+            voice->active = true;
+            SWITCH_CHAN_STATE(ch , SS_SAMPLE_PLAYING);
             if (SS_DEBUG_MIDI) {
                printf("Playing note %d on channel %d\n", pitch, ch);
             }
@@ -369,7 +530,7 @@ bool SimpleSynth::playNote(int /*channel*/, int pitch, int velo)
                printf("Note off on channel %d\n", ch);
             }
             SWITCH_CHAN_STATE(ch , SS_CHANNEL_INACTIVE);
-            channels[ch].playoffset = 0;
+            stopVoices(ch);
             channels[ch].cur_velo = 0;
          }
       }
@@ -457,15 +618,7 @@ bool SimpleSynth::setController(int channel, int id, int val)
             printf("Received channel ctrl pitch %d for channel %d\n", val, ch);
          channels[ch].pitchInt = val;
          printf("SS_CHANNEL_CTRL_PITCH %d\n", channels[channel].pitchInt);
-
-         if (channels[ch].sample != 0)
-         {
-            std::string bkStr = channels[ch].sample->filename;
-            resample(channels[ch].originalSample,
-                     channels[ch].sample,
-                     rangeToPitch(channels[ch].pitchInt),
-                     sampleRate());
-         }
+         // Pitch is applied while playing, see process()
          break;
 
       case SS_CHANNEL_CTRL_NOFF:
@@ -492,7 +645,7 @@ bool SimpleSynth::setController(int channel, int id, int val)
          }
          else if (val == true && channels[ch].channel_on == false) { // if it actually _was_ off:
             SWITCH_CHAN_STATE(ch, SS_CHANNEL_INACTIVE);
-            channels[ch].playoffset = 0;
+            stopVoices(ch);
             channels[ch].channel_on = val;
          }
          break;
@@ -632,6 +785,27 @@ bool SimpleSynth::sysex(int len, const unsigned char* d)
       break;
    }
 
+   case SS_SYSEX_SET_INTERPOLATION:
+   {
+      if (SS_DEBUG_MIDI) {
+         printf("Sysex cmd set interpolation: %d\n", data[1]);
+      }
+      setInterpolation(data[1]);
+      break;
+   }
+
+   case SS_SYSEX_SET_RETRIGGER:
+   {
+      int ch = data[1];
+      if (ch < SS_NR_OF_CHANNELS) {
+         if (SS_DEBUG_MIDI) {
+            printf("Sysex cmd set retrigger: %d on channel %d\n", data[2], ch);
+         }
+         channels[ch].poly_retrigger = data[2];
+      }
+      break;
+   }
+
    case SS_SYSEX_INIT_DATA:
    {
       parseInitData(data);
@@ -836,14 +1010,12 @@ void SimpleSynth::process(unsigned /*pos*/, float** out, int offset, int len)
             }
       */
 
+   ++processSerial;
    if (synth_state == SS_RUNNING) {
 
       //Temporary mix-doubles
       double out1, out2;
       //double ltemp, rtemp;
-      float* data;
-      // Velocity factor:
-      double gain_factor;
 
 
       // Clear send-channels. Skips if fx not turned on
@@ -870,61 +1042,57 @@ void SimpleSynth::process(unsigned /*pos*/, float** out, int offset, int len)
          if (channels[ch].channel_on == false)
             continue;
 
-         //If sample isn't playing, skip:
-         if (channels[ch].state == SS_SAMPLE_PLAYING) {
+         //If sample isn't playing, skip. Read once, the loader thread may clear it:
+         const SS_Sample* smp = channels[ch].sample;
+         if (channels[ch].state == SS_SAMPLE_PLAYING && smp) {
             memset(processBuffer[0], 0, SS_PROCESS_BUFFER_SIZE * sizeof(double));
             memset(processBuffer[1], 0, SS_PROCESS_BUFFER_SIZE * sizeof(double));
 
-            for (int i=0; i<len; i++) {
-               // Current channel sample data:
-               data = channels[ch].sample->data;
-               gain_factor = channels[ch].gain_factor;
-               // Current velocity factor:
-
-               if (channels[ch].sample->channels == 2) {
-                  //
-                  // Stereo sample:
+            // Play the voices at the sample's own rate, pitched:
+            const double rate = (double) smp->samplerate / (double) sampleRate() / rangeToPitch(channels[ch].pitchInt);
+            const bool stereo = smp->channels >= 2;
+            bool playing = false;
+            for (int v=0; v<SS_NR_OF_VOICES; v++) {
+               SS_Voice* voice = &channels[ch].voices[v];
+               if (!voice->active)
+                  continue;
+               for (int i=0; i<len; i++) {
+                  const float l = sampleValue(smp, voice->pos, 0, interpolation);
+                  const float r = stereo ? sampleValue(smp, voice->pos, 1, interpolation) : l;
+                  processBuffer[0][i]+= (double) (l * voice->gain_factor * channels[ch].balanceFactorL);
+                  processBuffer[1][i]+= (double) (r * voice->gain_factor * channels[ch].balanceFactorR);
+                  voice->pos+= rate;
                   //
-                  // Add from sample:
-                  out1 = (double) (data[channels[ch].playoffset] * gain_factor * channels[ch].balanceFactorL);
-                  out2 = (double) (data[channels[ch].playoffset + 1] * gain_factor * channels[ch].balanceFactorR);
-                  channels[ch].playoffset += 2;
-               }
-               else {
-                  //
-                  // Mono sample:
+                  // If we've reached the last frame, the voice is done
                   //
-                  out1 = (double) (data[channels[ch].playoffset] * gain_factor * channels[ch].balanceFactorL);
-                  out2 = (double) (data[channels[ch].playoffset] * gain_factor * channels[ch].balanceFactorR);
-                  channels[ch].playoffset++;
-               }
-
-               processBuffer[0][i] = out1;
-               processBuffer[1][i] = out2;
-
-               // If send-effects tap is on, tap signal to respective lineout channel
-               for (int j=0; j<SS_NR_OF_SENDEFFECTS; j++) {
-                  if (channels[ch].sendfxlevel[j] != 0.0) {
-                     //If the effect has 2 inputs (stereo in):
-                     if (sendEffects[j].inputs == 2) {
-                        sendFxLineOut[j][0][i]+= (out1 * channels[ch].sendfxlevel[j]);
-                        sendFxLineOut[j][1][i]+= (out2 * channels[ch].sendfxlevel[j]);
-                     }
-                     //If the effect is mono (1 input), only use first fxLineOut
-                     else if (sendEffects[j].inputs == 1) {
-                        sendFxLineOut[j][0][i]+= ((out1 + out2) * channels[ch].sendfxlevel[j] / 2.0);
-                     }
-                     //Effects with 0 or >2 inputs are ignored
+                  if (voice->pos >= smp->frames) {
+                     voice->active = false;
+                     break;
                   }
                }
+               playing |= voice->active;
+            }
+            if (!playing) {
+               SWITCH_CHAN_STATE(ch, SS_CHANNEL_INACTIVE);
+            }
 
-               //
-               // If we've reached the last sample, set state to inactive
-               //
-               if (channels[ch].playoffset >= channels[ch].sample->samples) {
-                  SWITCH_CHAN_STATE(ch, SS_CHANNEL_INACTIVE);
-                  channels[ch].playoffset = 0;
-                  break;
+            // If send-effects tap is on, tap signal to respective lineout channel
+            for (int j=0; j<SS_NR_OF_SENDEFFECTS; j++) {
+               if (channels[ch].sendfxlevel[j] == 0.0)
+                  continue;
+               for (int i=0; i<len; i++) {
+                  out1 = processBuffer[0][i];
+                  out2 = processBuffer[1][i];
+                  //If the effect has 2 inputs (stereo in):
+                  if (sendEffects[j].inputs == 2) {
+                     sendFxLineOut[j][0][i]+= (out1 * channels[ch].sendfxlevel[j]);
+                     sendFxLineOut[j][1][i]+= (out2 * channels[ch].sendfxlevel[j]);
+                  }
+                  //If the effect is mono (1 input), only use first fxLineOut
+                  else if (sendEffects[j].inputs == 1) {
+                     sendFxLineOut[j][0][i]+= ((out1 + out2) * channels[ch].sendfxlevel[j] / 2.0);
+                  }
+                  //Effects with 0 or >2 inputs are ignored
                }
             }
             // Add contribution for this channel, for this frame, to final result:
@@ -980,6 +1148,7 @@ void SimpleSynth::process(unsigned /*pos*/, float** out, int offset, int len)
          out[1][i+offset] = (out[1][i+offset] * master_vol);
       }
    }
+   ++processSerial;
 }
 
 //---------------------------------------------------------
@@ -999,6 +1168,7 @@ void SimpleSynth::showNativeGui(bool val)
 
 void SimpleSynth::guiHeartBeat()
 {
+  releaseRetiredSamples();
   if(gui)
     gui->heartBeat();
 };
@@ -1064,6 +1234,7 @@ void SimpleSynth::getInitData(int* n, const unsigned char** data)
          len++; //Add place for SS_NO_SAMPLE
    }
    len+=3; // 1 place for SS_SYSEX_INIT_DATA, 1 byte for master vol, 1 byte for version data
+   len+=1 + SS_NR_OF_CHANNELS; // 1 byte for interpolation, 1 byte for each channel's retrigger (version 4)
 
    // Effect data length
    len++; //Add place for SS_SYSEX_INIT_DATA_VERSION, as control
@@ -1252,6 +1423,17 @@ void SimpleSynth::getInitData(int* n, const unsigned char** data)
       }
    }
 
+   // Version 4, playback settings:
+   initBuffer[i] = interpolation;
+   if (SS_DEBUG_INIT) {
+      printf("initBuffer[%d]: interpolation=%d\n", i, initBuffer[i]);
+   }
+   i++;
+   for (int ch=0; ch<SS_NR_OF_CHANNELS; ch++) {
+      initBuffer[i] = (byte) channels[ch].poly_retrigger;
+      i++;
+   }
+
    SS_TRACE_OUT
 }
 
@@ -1327,9 +1509,8 @@ void SimpleSynth::parseInitData(const unsigned char* data)
       bool hasSample = *(ptr);
       ptr++;
 
-      channels[ch].sample = 0;
-      channels[ch].playoffset = 0;
       SWITCH_CHAN_STATE(ch, SS_CHANNEL_INACTIVE);
+      stopVoices(ch);
       if (SS_DEBUG_INIT) {
          printf("parseInitData: channel %d, volume: %f pan: %d bfL %f bfR %f chON %d s1: %f s2: %f s3: %f s4: %f\n",
                 ch,
@@ -1450,6 +1631,17 @@ void SimpleSynth::parseInitData(const unsigned char* data)
       }
    }
 
+   if (dataVersion > 3) {
+      setInterpolation(*(ptr));
+      guiUpdateInterpolation(interpolation);
+      ptr++;
+      for (int ch=0; ch<SS_NR_OF_CHANNELS; ch++) {
+         channels[ch].poly_retrigger = *(ptr);
+         guiUpdateRetrigger(ch, channels[ch].poly_retrigger);
+         ptr++;
+      }
+   }
+
    SS_TRACE_OUT
 }
 
@@ -1466,7 +1658,6 @@ bool SimpleSynth::loadSample(int chno, const char* filename)
    loader->channel = ch;
    loader->ch_no   = chno;
    loader->synth = this;
-   loader->sampleRate = sampleRate();
    if (SS_DEBUG) {
       printf("Loader filename is: %s\n", filename);
    }
@@ -1516,47 +1707,6 @@ bool SimpleSynth::loadSample(int chno, const char* filename)
 }
 
 
-void resample(SS_Sample *origSample, SS_Sample* newSample, double pitch, int sample_rate)
-{
-   // Get new nr of frames:
-   double srcratio = (double) sample_rate / (double) origSample->samplerate * pitch;
-   newSample->frames = (long) floor(((double) origSample->frames * srcratio));
-   //smp->frames = (sfi.channels == 1 ? smp->frames * 2 : smp->frames ); // Double nr of new frames if mono->stereo
-   newSample->samples = newSample->frames * newSample->channels;
-   newSample->samplerate = sample_rate;
-
-   // Allocate mem for the new one
-   float* newData = new float[newSample->frames * newSample->channels];
-   memset(newData, 0, sizeof(float)* newSample->frames * newSample->channels);
-
-   // libsamplerate & co (secret rabbits in the code!)
-   SRC_DATA srcdata;
-   srcdata.data_in  = origSample->data;
-   srcdata.data_out = newData;
-   srcdata.input_frames  = origSample->frames;
-   srcdata.output_frames = newSample->frames;
-   srcdata.src_ratio = (double) newSample->samplerate / (double) origSample->samplerate  * pitch;
-
-   if (SS_DEBUG) {
-      printf("Converting sample....\n");
-   }
-
-   if (src_simple(&srcdata, SRC_SINC_BEST_QUALITY, origSample->channels)) {
-      SS_ERROR("Error when resampling, ignoring current sample");
-      //TODO: deallocate and stuff
-   }
-   else if (SS_DEBUG) {
-      printf("Sample converted. %ld input frames used, %ld output frames generated\n",
-             srcdata.input_frames_used,
-             srcdata.output_frames_gen);
-   }
-   float *oldData = newSample->data;
-   newSample->data = newData;
-   if (oldData) {
-      delete oldData;
-   }
-}
-
 /*!
     \fn loadSampleThread(void* p)
     \brief Since process needs to respond within a certain time, loading of samples need to be done in a separate thread
@@ -1574,92 +1724,78 @@ static void* loadSampleThread(void* p)
    
    SS_Channel* ch = loader->channel;
    const int ch_no      = loader->ch_no;
-   const int sample_rate = loader->sampleRate;
+   const char* filename = loader->filename.c_str();
 
-   if (ch->sample) {
-      delete[] ch->sample->data;
-      delete ch->sample;
+   // Let go of the previous sample, the voices playing it are stopped:
+   SS_Sample* prevSample = ch->sample;
+   for (int v=0; v<SS_NR_OF_VOICES; v++)
+      ch->voices[v].active = false;
+   ch->sample = 0;
+   if (prevSample) {
+      synth->waitProcessDone();
+      releaseSample(prevSample);
    }
 
-   SNDFILE* sf;
-   const char* filename = loader->filename.c_str();
-   SF_INFO sfi;
-
    if (SS_DEBUG)
       printf("loadSampleThread: filename = %s\n", filename);
 
-   sf = sf_open(filename, SFM_READ, &sfi);
-   if (sf == 0) {
-      fprintf(stderr,"Error opening file: %s\n", filename);
-      synth->SWITCH_SYNTH_STATE(prevState);
-      synth->guiSendSampleLoaded(false, loader->ch_no, filename);
-      delete ch->sample; ch->sample = 0;
-      delete loader;
-      pthread_mutex_unlock(&SS_LoaderMutex);
-      SS_TRACE_OUT
-            pthread_exit(0);
-   }
+   // Already loaded by another channel? Then share it:
+   SS_Sample* smp = acquireSample(loader->filename);
+   if (smp == 0) {
+      SF_INFO sfi;
+      SNDFILE* sf = sf_open(filename, SFM_READ, &sfi);
+      if (sf == 0) {
+         fprintf(stderr,"Error opening file: %s\n", filename);
+         synth->SWITCH_SYNTH_STATE(prevState);
+         synth->guiSendSampleLoaded(false, loader->ch_no, filename);
+         delete loader;
+         pthread_mutex_unlock(&SS_LoaderMutex);
+         SS_TRACE_OUT
+               pthread_exit(0);
+      }
 
-   //Print some info:
-   if (SS_DEBUG) {
-      printf("Sample info:\n");
-      printf("Frames: \t%ld\n", (long) sfi.frames);
-      printf("Channels: \t%d\n", sfi.channels);
-      printf("Samplerate: \t%d\n", sfi.samplerate);
-   }
-
-   //
-   // Allocate and read the thingie
-   //
-
-   //      // If current samplerate is the same as MusE's and no pitching is needed:
-   //      if (SS_samplerate == sfi.samplerate && (ch->pitch -1.0) < 0.001) {
-   //            smp->data = new float[sfi.channels * sfi.frames];
-   //            sf_count_t n = sf_readf_float(sf, smp->data, sfi.frames);
-   //            smp->frames = sfi.frames;
-   //            smp->samples = (n * sfi.channels);
-   //            smp->channels = sfi.channels;
-   //            if (SS_DEBUG) {
-   //                  printf("%ld frames read\n", (long) n);
-   //                  }
-   //            }
-   //      else  // otherwise, resample:
-   {
-      ch->sample = new SS_Sample;
-      SS_Sample* smp = ch->sample;
-      //smp->data = 0; // reset the data so we won't accidentally delete unallocated data
-      ch->originalSample = new SS_Sample;
-      SS_Sample* origSmp = ch->originalSample;
-
-      smp->channels = sfi.channels;
-      origSmp->channels = sfi.channels;
-
-      // Read to original sample storage:
-      float *origSample = new float[sfi.frames * sfi.channels];
-      int frames_read = sf_readf_float(sf, origSample, sfi.frames);
+      //Print some info:
+      if (SS_DEBUG) {
+         printf("Sample info:\n");
+         printf("Frames: \t%ld\n", (long) sfi.frames);
+         printf("Channels: \t%d\n", sfi.channels);
+         printf("Samplerate: \t%d\n", sfi.samplerate);
+      }
+
+      //
+      // Allocate and read the thingie, it is kept at its own rate
+      // and pitched while playing
+      //
+      float* data = new float[sfi.frames * sfi.channels];
+      sf_count_t frames_read = sf_readf_float(sf, data, sfi.frames);
+      //Just close the dam thing
+      sf_close(sf);
       if (frames_read != sfi.frames) {
          fprintf(stderr,"Error reading sample %s\n", filename);
+         delete[] data;
          synth->guiSendSampleLoaded(false, loader->ch_no, filename);
-         sf_close(sf);
          synth->SWITCH_SYNTH_STATE(prevState);
-         delete ch->sample; ch->sample = 0;
          delete loader;
          pthread_mutex_unlock(&SS_LoaderMutex);
-         pthread_exit(0);
          SS_TRACE_OUT
+               pthread_exit(0);
       }
 
-      origSmp->channels = sfi.channels;
-      origSmp->frames = sfi.frames;
-      origSmp->samplerate = sfi.samplerate;
-      origSmp->data = origSample;
-
-      resample(origSmp, smp, rangeToPitch(ch->pitchInt), sample_rate);
+      smp = new SS_Sample;
+      smp->data       = data;
+      smp->channels   = sfi.channels;
+      smp->frames     = sfi.frames;
+      smp->samples    = sfi.frames * sfi.channels;
+      smp->samplerate = sfi.samplerate;
+      smp->filename   = loader->filename;
+      storeSample(smp);
    }
-   //Just close the dam thing
-   sf_close(sf);
+   else if (SS_DEBUG) {
+      printf("loadSampleThread: sharing already loaded %s\n", filename);
+   }
+
+   ch->sample = smp;
    synth->SWITCH_SYNTH_STATE(prevState);
-   ch->sample->filename = loader->filename;
    synth->guiSendSampleLoaded(true, ch_no, filename);
    delete loader;
    pthread_mutex_unlock(&SS_LoaderMutex);
@@ -2077,14 +2213,11 @@ void SimpleSynth::clearSample(int ch)
       SS_State prevstate = synth_state;
       SWITCH_CHAN_STATE(ch, SS_CHANNEL_INACTIVE);
       SWITCH_SYNTH_STATE(SS_CLEARING_SAMPLE);
-      if (channels[ch].sample->data) {
-         delete[] channels[ch].sample->data;
-         channels[ch].sample->data = 0;
-      }
-      if (channels[ch].sample) {
-         delete channels[ch].sample;
-         channels[ch].sample = 0;
-      }
+      stopVoices(ch);
+      SS_Sample* smp = channels[ch].sample;
+      channels[ch].sample = 0;
+      // Called on the audio thread, which must not lock the store or free.
+      retireSample(smp);
       SWITCH_SYNTH_STATE(prevstate);
       guiNotifySampleCleared(ch);
       if (SS_DEBUG) {
@@ -2094,6 +2227,101 @@ void SimpleSynth::clearSample(int ch)
    SS_TRACE_OUT
 }
 
+/*!
+    \fn SimpleSynth::retireSample(SS_Sample* smp)
+    \brief Hands a sample the audio thread let go of to the gui thread, which releases it
+ */
+void SimpleSynth::retireSample(SS_Sample* smp)
+{
+   const unsigned w = retiredWrite.load();
+   if (w - retiredRead.load() >= SS_RETIRED_SAMPLES) {
+      // Cannot happen unless the gui thread stalls. Keep it rather than free it here.
+      fprintf(stderr, "SimpleDrums: too many cleared samples, %s is not freed\n", smp->filename.c_str());
+      return;
+   }
+   retiredSamples[w % SS_RETIRED_SAMPLES] = smp;
+   retiredWrite.store(w + 1);
+}
+
+/*!
+    \fn SimpleSynth::releaseRetiredSamples()
+    \brief Releases the samples cleared on the audio thread. Gui thread only.
+ */
+void SimpleSynth::releaseRetiredSamples()
+{
+   unsigned r = retiredRead.load();
+   while (r != retiredWrite.load()) {
+      releaseSample(retiredSamples[r % SS_RETIRED_SAMPLES]);
+      retiredRead.store(++r);
+   }
+}
+
+/*!
+    \fn SimpleSynth::waitProcessDone()
+    \brief Returns once a process() which might still see a channel's old sample is done.
+    Call after setting the channel's sample to 0, not on the audio thread.
+ */
+void SimpleSynth::waitProcessDone()
+{
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   const unsigned serial = processSerial.load();
+   if (serial & 1)
+      while (processSerial.load() == serial)
+         usleep(1000);
+}
+
+
+/*!
+    \fn SimpleSynth::stopVoices(int ch)
+ */
+void SimpleSynth::stopVoices(int ch)
+{
+   for (int v=0; v<SS_NR_OF_VOICES; v++) {
+      channels[ch].voices[v].active = false;
+      channels[ch].voices[v].pos = 0.0;
+   }
+}
+
+/*!
+    \fn SimpleSynth::setInterpolation(int val)
+ */
+void SimpleSynth::setInterpolation(int val)
+{
+   if (val < 0 || val >= SS_NR_OF_INTERPOLATIONS) {
+      fprintf(stderr, "SimpleDrums: unknown interpolation %d, ignoring\n", val);
+      return;
+   }
+   interpolation = (SS_Interpolation) val;
+}
+
+/*!
+    \fn SimpleSynth::guiUpdateInterpolation(int val)
+ */
+void SimpleSynth::guiUpdateInterpolation(int val)
+{
+   SS_TRACE_IN
+         byte d[2];
+   d[0] = SS_SYSEX_SET_INTERPOLATION;
+   d[1] = (byte) val;
+   MusECore::MidiPlayEvent ev(0, 0, MusECore::ME_SYSEX, d, 2);
+   gui->writeEvent(ev);
+   SS_TRACE_OUT
+}
+
+/*!
+    \fn SimpleSynth::guiUpdateRetrigger(int ch, bool b)
+ */
+void SimpleSynth::guiUpdateRetrigger(int ch, bool b)
+{
+   SS_TRACE_IN
+         byte d[3];
+   d[0] = SS_SYSEX_SET_RETRIGGER;
+   d[1] = (byte) ch;
+   d[2] = (byte) b;
+   MusECore::MidiPlayEvent ev(0, 0, MusECore::ME_SYSEX, d, 3);
+   gui->writeEvent(ev);
+   SS_TRACE_OUT
+}
 
 /*!
     \fn SimpleSynth::guiNotifySampleCleared(int ch)
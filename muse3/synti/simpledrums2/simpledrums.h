@@ -27,6 +27,7 @@
 #define SIMPLESYNTH_H
 
 #include <sndfile.h>
+#include <atomic>
 #include "libsynti/mess.h"
 #include "common.h"
 #include "common_defs.h"
@@ -39,6 +40,8 @@
 
 #define SS_PROCESS_BUFFER_SIZE SS_segmentSize
 #define SS_SENDFX_BUFFER_SIZE  SS_PROCESS_BUFFER_SIZE
+// Samples cleared on the audio thread wait here to be released on the gui thread
+#define SS_RETIRED_SAMPLES     64
 
 enum SS_ChannelState
 {
@@ -71,10 +74,17 @@ struct SS_SendFx
    int            nrofparameters;
 };
 
+//---------------------------------------------------------
+//   SS_Sample
+//    Samples are kept at their file rate and never changed
+//    once loaded. Channels loading the same file share the
+//    sample, refs counts the channels holding it.
+//---------------------------------------------------------
 struct SS_Sample
 {
-   SS_Sample() { data = 0; }
+   SS_Sample() { data = 0; refs = 0; }
    float*      data;
+   int         refs;
    int         samplerate;
    //int         bits;
    std::string filename;
@@ -90,20 +100,26 @@ enum SS_ChannelRoute
    SS_CHN_ROUTE_CHN,
 };
 
+struct SS_Voice
+{
+   bool            active;
+   double          pos;          // Playing position in sample frames
+   double          gain_factor;  // Velocity * volume at note on
+};
+
 struct SS_Channel
 {
    SS_ChannelState state;
    const char*     name;
    SS_Sample*      sample;
-   SS_Sample*      originalSample;
-   int             playoffset;
+   SS_Voice        voices[SS_NR_OF_VOICES];
+   bool            poly_retrigger; // Let retriggered notes ring out instead of restarting
    bool            noteoff_ignore;
 
    double          volume;
    int             volume_ctrlval;
 
    double          cur_velo;
-   double          gain_factor;
 
    int             pan;
    double          balanceFactorL;
@@ -154,6 +170,7 @@ public:
    bool init(const char* name);
    void guiSendSampleLoaded(bool success, int ch, const char* filename);
    void guiSendError(const char* errorstring);
+   void waitProcessDone();
    
    SS_State synth_state;
 
@@ -191,15 +208,30 @@ private:
    void cleanupPlugin(int id);
    void setFxParameter(int fxid, int param, float val);
    void clearSample(int ch);
+   void stopVoices(int ch);
+   void setInterpolation(int val);
+   void guiUpdateInterpolation(int val);
+   void guiUpdateRetrigger(int ch, bool b);
 
    double master_vol;
    int master_vol_ctrlval;
 
+   SS_Interpolation interpolation;
+
    //Send effects:
    SS_SendFx sendEffects[SS_NR_OF_SENDEFFECTS];
    float* sendFxLineOut[SS_NR_OF_SENDEFFECTS][2]; //stereo output (fed into LADSPA inputs),sent from the individual channels -> LADSPA fx
    float* sendFxReturn[SS_NR_OF_SENDEFFECTS][2];  //stereo inputs, from LADSPA plugins, sent from LADSPA -> SS and added to the mix
    double* processBuffer[2];
+
+   // Odd while process() runs.
+   std::atomic<unsigned> processSerial;
+   // Audio thread -> gui thread.
+   SS_Sample* retiredSamples[SS_RETIRED_SAMPLES];
+   std::atomic<unsigned> retiredWrite;
+   std::atomic<unsigned> retiredRead;
+   void retireSample(SS_Sample* smp);
+   void releaseRetiredSamples();
 };
 
 struct SS_SampleLoader
@@ -208,10 +240,8 @@ struct SS_SampleLoader
    std::string  filename;
    int          ch_no;
    SimpleSynth* synth;
-   int sampleRate;
 };
 
-void resample(SS_Sample *origSmp, SS_Sample* newSample, double pitch, int sample_rate);
 static void* loadSampleThread(void*);
 static pthread_mutex_t SS_LoaderMutex;
 
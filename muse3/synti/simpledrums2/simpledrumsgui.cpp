@@ -364,6 +364,15 @@ SimpleSynthGui::SimpleSynthGui(int sampleRate)
       inchnlLayout->addWidget(nOffIgnore[i]);
       connect(nOffIgnore[i], SIGNAL(channelState(int, bool)),SLOT(channelNoteOffIgnore(int, bool)));
 
+      polyLabel[i] = new QLabel(channelButtonGroups[i]);
+      polyLabel[i]->setText("Poly");
+      inchnlLayout->addWidget(polyLabel[i]);
+
+      polyRetrigger[i] = new QChannelCheckbox(channelButtonGroups[i], i);
+      polyRetrigger[i]->setToolTip("Polyphonic retrigger (let retriggered notes ring out), channel " + QString::number(i + 1));
+      inchnlLayout->addWidget(polyRetrigger[i]);
+      connect(polyRetrigger[i], SIGNAL(channelState(int, bool)),SLOT(channelPolyRetrigger(int, bool)));
+
       panSliders[i] = new QChannelSlider(Qt::Horizontal, i, channelButtonGroups[i]);
       panSliders[i]->setRange(0, 127);
       panSliders[i]->setValue(SS_PANSLDR_DEFAULT_VALUE);
@@ -481,6 +490,15 @@ SimpleSynthGui::SimpleSynthGui(int sampleRate)
    rbLayout->addWidget(saveButton,  4, 1, Qt::AlignCenter | Qt::AlignVCenter);
    rbLayout->addWidget(aboutButton, 6, 1, Qt::AlignCenter | Qt::AlignVCenter);
 
+   interpolationCb = new QComboBox(rbPanel);
+   interpolationCb->addItem(tr("Linear"), QVariant(SS_INTERPOLATION_LINEAR));
+   interpolationCb->addItem(tr("Cubic"), QVariant(SS_INTERPOLATION_CUBIC));
+   interpolationCb->addItem(tr("Sinc"), QVariant(SS_INTERPOLATION_SINC));
+   interpolationCb->setCurrentIndex(SS_INTERPOLATION_CUBIC);
+   interpolationCb->setToolTip(tr("Interpolation of pitched samples"));
+   connect(interpolationCb, SIGNAL(currentIndexChanged(int)), SLOT(interpolationChanged(int)));
+   rbLayout->addWidget(interpolationCb, 5, 1, Qt::AlignCenter | Qt::AlignVCenter);
+
    lastDir = "";
    connect(this->getGuiSignal(),SIGNAL(wakeup()),this,SLOT(readMessage()));
 
@@ -674,6 +692,26 @@ void SimpleSynthGui::processEvent(const MusECore::MidiPlayEvent& ev)
          break;
       }
 
+      case SS_SYSEX_SET_INTERPOLATION: {
+         int val = *(data+1);
+         if (val < SS_NR_OF_INTERPOLATIONS) {
+            interpolationCb->blockSignals(true);
+            interpolationCb->setCurrentIndex(val);
+            interpolationCb->blockSignals(false);
+         }
+         break;
+      }
+
+      case SS_SYSEX_SET_RETRIGGER: {
+         int ch = *(data+1);
+         if (ch < SS_NR_OF_CHANNELS) {
+            polyRetrigger[ch]->blockSignals(true);
+            polyRetrigger[ch]->setChecked(*(data+2));
+            polyRetrigger[ch]->blockSignals(false);
+         }
+         break;
+      }
+
       case SS_SYSEX_SET_PLUGIN_PARAMETER_OK: {
          if (SS_DEBUG_MIDI) {
             printf("SimpleSynthGui - plugin parameter OK on fxid: %d\n", *(data+1));
@@ -778,6 +816,33 @@ void SimpleSynthGui::channelNoteOffIgnore(int channel, bool state)
    sendController(0, SS_CHANNEL_NOFF_CONTROLLER(channel), (int) state);
 }
 
+/*!
+    \fn SimpleSynthGui::channelPolyRetrigger(int channel, bool state)
+ */
+void SimpleSynthGui::channelPolyRetrigger(int channel, bool state)
+{
+   byte d[5];
+   d[0] = MUSE_SYNTH_SYSEX_MFG_ID;
+   d[1] = SIMPLEDRUMS_UNIQUE_ID;
+   d[2] = SS_SYSEX_SET_RETRIGGER;
+   d[3] = (byte) channel;
+   d[4] = (byte) state;
+   sendSysex(d, 5);
+}
+
+/*!
+    \fn SimpleSynthGui::interpolationChanged(int index)
+ */
+void SimpleSynthGui::interpolationChanged(int index)
+{
+   byte d[4];
+   d[0] = MUSE_SYNTH_SYSEX_MFG_ID;
+   d[1] = SIMPLEDRUMS_UNIQUE_ID;
+   d[2] = SS_SYSEX_SET_INTERPOLATION;
+   d[3] = (byte) index;
+   sendSysex(d, 4);
+}
+
 /*!
     \fn SimpleSynthGui::sendFxChanged(int ch, int fxid, int val)
  */
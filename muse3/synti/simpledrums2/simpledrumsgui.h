@@ -194,6 +194,8 @@ class SimpleSynthGui : public QDialog, public Ui::SimpleDrumsGuiBase, public Mes
       QChannelButton*         loadSampleButton[SS_NR_OF_CHANNELS];
       QChannelButton*         clearSampleButton[SS_NR_OF_CHANNELS];
       QLabel*                 nOffLabel[SS_NR_OF_CHANNELS];
+      QChannelCheckbox*       polyRetrigger[SS_NR_OF_CHANNELS];
+      QLabel*                 polyLabel[SS_NR_OF_CHANNELS];
       QLineEdit*              sampleNameLineEdit[SS_NR_OF_CHANNELS];
       
       ///QInvertedSlider*        masterSlider;
@@ -205,6 +207,7 @@ class SimpleSynthGui : public QDialog, public Ui::SimpleDrumsGuiBase, public Mes
       QPushButton*            aboutButton;
       QPushButton*            loadButton;
       QPushButton*            saveButton;
+      QComboBox*              interpolationCb;
 
       QComboBox*              chnRoutingCb[SS_NR_OF_CHANNELS];
       MusEGui::Meter*         chnMeter[SS_NR_OF_CHANNELS];
@@ -245,6 +248,8 @@ class SimpleSynthGui : public QDialog, public Ui::SimpleDrumsGuiBase, public Mes
       void panChanged(int channel, int value);
       void channelOnOff(int channel, bool state);
       void channelNoteOffIgnore(int channel, bool state);
+      void channelPolyRetrigger(int channel, bool state);
+      void interpolationChanged(int index);
       void masterVolChanged(int val);
       void loadSampleDialogue(int channel);
       void readMessage();